@@ -286,8 +286,8 @@ void MonitorFunctionForVariationalMethod(gridT *grid, propT *prop, physT *phys,
   }
 
   // find max_global and normalize
-  MPI_Reduce(&max_gradient_h,&max_gradient_h_global,1,MPI_DOUBLE,MPI_MAX,0,comm);
-  MPI_Bcast(&max_gradient_h_global,1,MPI_DOUBLE,0,comm);
+  MPI_Reduce(&max_gradient_h,&max_gradient_h_global,1,MPI_REALTYPE,MPI_MAX,0,comm);
+  MPI_Bcast(&max_gradient_h_global,1,MPI_REALTYPE,0,comm);
   if(max_gradient_h_global<1){
     max_gradient_h_global=1.0;
   }
@@ -178,10 +178,10 @@ if(prop->subgrid){
  }
 
 
- MPI_Reduce(&mycumvol,&(cumvol),1,MPI_DOUBLE,MPI_SUM,0,comm);
- MPI_Bcast(&cumvol,1,MPI_DOUBLE,0,comm);
- MPI_Reduce(&myuvol,&(uvol),1,MPI_DOUBLE,MPI_SUM,0,comm);
- MPI_Bcast(&uvol,1,MPI_DOUBLE,0,comm);
+ MPI_Reduce(&mycumvol,&(cumvol),1,MPI_REALTYPE,MPI_SUM,0,comm);
+ MPI_Bcast(&cumvol,1,MPI_REALTYPE,0,comm);
+ MPI_Reduce(&myuvol,&(uvol),1,MPI_REALTYPE,MPI_SUM,0,comm);
+ MPI_Bcast(&uvol,1,MPI_REALTYPE,0,comm);
  
 uvol/=cumvol;
 // rather than assigning each cell to receive uniform forcing (u0-uvol), we could account for hill's presence by
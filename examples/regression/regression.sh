@@ -0,0 +1,332 @@
+#!/bin/sh
+########################################################################
+#
+# Shell script to run the suntans test cases for timing and to check
+# that their results have not changed.
+#
+# Usage: sh regression.sh [-n "1 2 4"] [-t tol] [-u] [-p] [case ...]
+#
+#  -n  numbers of processors (default "1 2 4", or 1 without MPIHOME and PARMETISHOME)
+#  -t  relative tolerance of the comparison with the references (default 1e-6)
+#  -u  update the references with the run on the first number of processors
+#  -p  also build with PRECISION=single and report the drift of its norms
+#      from the double-precision run on the first number of processors
+#
+# The cases are listed in cases.dat and all of them are run if none are
+# given.  Each case is built with the Makefile of its example, run with
+# outputsummary=1 on every number of processors (strong scaling) and, if
+# several rundata directories are given, on the i-th number of processors
+# with the i-th directory (weak scaling).  The norms of the fields in the
+# summary of every run (see OutputSummary in main/physio.c) are compared
+# with those in references/<case>.dat, and the timers, the solver
+# iterations and the parallel efficiencies are written to report.txt.
+# The references do not keep the wall-clock timers.
+# The runs are kept in runs/<case>.  After the cases, sunbench (see
+# main/bench.c) is built and run on a small grid on the first number of
+# processors, which fails if it does not exit normally or does not
+# write its results to bench.json.  The exit status is the number of
+# runs that failed or differ from the references.  The single-precision
+# runs of -p are only reported and are not compared with the references.
+#
+########################################################################
+
+SUNTANSHOME=../../main
+SUN=$SUNTANSHOME/sun
+EXAMPLES=..
+
+. $SUNTANSHOME/Makefile.in
+
+casesfile=cases.dat
+refdir=references
+rundir=runs
+report=report.txt
+
+procs="1 2 4"
+tol=1e-6
+update=0
+single=0
+
+while getopts "n:t:up" opt ; do
+    case $opt in
+	n) procs=$OPTARG ;;
+	t) tol=$OPTARG ;;
+	u) update=1 ;;
+	p) single=1 ;;
+	*) echo "Usage: sh $0 [-n \"1 2 4\"] [-t tol] [-u] [-p] [case ...]" ; exit 1 ;;
+    esac
+done
+shift `expr $OPTIND - 1`
+
+if [ "$procs" != "1" ] && ( [ -z "$MPIHOME" ] || [ -z "$PARMETISHOME" ] ) ; then
+    echo Only running on 1 processor since MPIHOME or PARMETISHOME is not set in $SUNTANSHOME/Makefile.in
+    procs="1"
+fi
+
+if [ $# -gt 0 ] ; then
+    cases="$*"
+else
+    cases=`awk '!/^#/ && NF {print $1}' $casesfile`
+fi
+
+# Value of $2 in the summary file $1
+value() {
+    awk -v key=$2 '$1==key {print $2}' $1
+}
+
+# Set $2 to $3 in suntans.dat $1
+setvalue() {
+    awk -v key=$2 -v val=$3 '$1==key {print key"\t"val"\t# set by regression.sh"; found=1; next}
+	{print} END {if(!found) print key"\t"val"\t# set by regression.sh"}' $1 > $1.tmp
+    mv $1.tmp $1
+}
+
+# Build sun with the sources of example $1 and precision $2 (default double).
+# The examples copy their objects (and in some cases uservertcoordinate.c) into
+# main, so main is cleaned first and uservertcoordinate.c is restored afterwards.
+build() {
+    cp $SUNTANSHOME/uservertcoordinate.c $rundir/uservertcoordinate.c
+    make -C $EXAMPLES/$1 clean > /dev/null
+    make -C $SUNTANSHOME clean > /dev/null
+    rm -f $SUN
+    make -C $EXAMPLES/$1 data PRECISION=${2:-double} > $rundir/build-$1.log 2>&1
+    status=$?
+    cp $rundir/uservertcoordinate.c $SUNTANSHOME/uservertcoordinate.c
+    return $status
+}
+
+# Set the key=value pairs $2 of the case in suntans.dat $1
+setvalues() {
+    for kv in $2 ; do
+	setvalue $1 `echo $kv | cut -d= -f1` `echo $kv | cut -d= -f2`
+    done
+}
+
+# Run the case in data directory $1 with $2 processors and $3 steps.  If a
+# restart step $4 is given, the run stops at step $4 and is restarted from
+# its store file for the remaining steps.
+run() {
+    if [ -z "$MPIHOME" ] ; then
+	EXEC=$SUN
+    else
+	EXEC="$MPIHOME/bin/mpirun -np $2 $SUN"
+    fi
+
+    setvalue $1/suntans.dat outputsummary 1
+    rm -f $1/summary.dat
+    if [ -z "$4" ] ; then
+	setvalue $1/suntans.dat nsteps $3
+	$EXEC -g --datadir=$1 > $1/run.log 2>&1 && $EXEC -s --datadir=$1 >> $1/run.log 2>&1
+    else
+	setvalue $1/suntans.dat nsteps $4
+	setvalue $1/suntans.dat ntoutStore $4
+	$EXEC -g --datadir=$1 > $1/run.log 2>&1 && $EXEC -s --datadir=$1 >> $1/run.log 2>&1 || return 1
+	store=`value $1/suntans.dat StoreFile`
+	start=`value $1/suntans.dat StartFile`
+	for f in $1/$store.* ; do
+	    cp $f $1/$start.${f##*.}
+	done
+	rm -f $1/summary.dat
+	setvalue $1/suntans.dat nsteps `expr $3 - $4`
+	$EXEC -s -r --datadir=$1 >> $1/run.log 2>&1
+    fi
+    [ -f $1/summary.dat ]
+}
+
+# Print summary $1 without the wall-clock timers, which change from run to run
+reference() {
+    awk '$1 !~ /^t_/' $1
+}
+
+# Compare the norms in summary $1 with the reference $2 and print those that differ
+compare() {
+    awk -v tol=$tol 'NR==FNR {ref[$1]=$2; next}
+	$1 ~ /_(mean|rms|max)$/ {
+	    if(!($1 in ref)) next;
+	    d=$2-ref[$1]; if(d<0) d=-d;
+	    a=ref[$1]; if(a<0) a=-a;
+	    if(d>tol*a+1e-12) {printf "    %s = %s, reference %s\n",$1,$2,ref[$1]; bad++}
+	} END {exit bad>0}' $2 $1
+}
+
+# Check run $1 of case $2 against its reference and print a line of the report
+check() {
+    if [ ! -f $1/summary.dat ] ; then
+	echo "failed (see $1/run.log)"
+	return 1
+    elif [ ! -f $refdir/$2.dat ] ; then
+	echo "no reference"
+    elif compare $1/summary.dat $refdir/$2.dat > $1/compare.log ; then
+	echo "ok"
+    else
+	echo "differs"
+	cat $1/compare.log
+	return 1
+    fi
+}
+
+# Print the drift of the norms in summary $1 from those in summary $2, relative
+# to the rms of the field in $2 so that means close to zero are not amplified
+drift() {
+    awk 'NR==FNR {ref[$1]=$2; next}
+	$1 ~ /_(mean|rms|max)$/ && ($1 in ref) {
+	    d=$2-ref[$1]; if(d<0) d=-d;
+	    rms=$1; sub(/_(mean|rms|max)$/,"_rms",rms);
+	    a=ref[rms]; if(a<0) a=-a;
+	    r=(a>0)?d/a:d; if(r>rmax) {rmax=r; kmax=$1}
+	    printf "  %-12s %22s %22s %10.3e\n",$1,ref[$1],$2,r
+	} END {printf "  maximum relative drift %.3e (%s)\n",rmax,kmax}' $2 $1
+}
+
+# Print the timers of run $1 relative to base run $2 on $3 and $4 processors.
+# kind is strong or weak.
+timing() {
+    awk -v np=$3 -v npb=$4 -v kind=$5 'NR==FNR {b[$1]=$2; next} {s[$1]=$2}
+	END {
+	    if(kind=="strong") {
+		sp=b["t_sim"]/s["t_sim"]; eff=sp*npb/np
+	    } else {
+		sp=0; eff=(b["t_sim"]*npb/b["cell_layers"])/(s["t_sim"]*np/s["cell_layers"])
+	    }
+	    printf "  %4d %8d %10.3f %7.2f %6.2f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %8d %8d",
+		np,s["cells"],s["t_sim"],sp,eff,s["t_source"],s["t_predictor"],s["t_nonhydro"],
+		s["t_transport"],s["t_turb"],s["t_comm"],s["cg_iters"],s["qcg_iters"]
+	}' $2 $1
+}
+
+header() {
+    printf "  %4s %8s %10s %7s %6s %10s %10s %10s %10s %10s %10s %8s %8s  %s\n" \
+	np cells t_sim speedup eff t_source t_predict t_nonhydro t_transport t_turb t_comm cg qcg check
+}
+
+mkdir -p $rundir $refdir
+echo "SUNTANS regression and scaling report, `date`" > $report
+echo "Processors: $procs, tolerance: $tol" >> $report
+failed=0
+
+for case in $cases ; do
+    line=`awk -v c=$case '!/^#/ && $1==c' $casesfile`
+    if [ -z "$line" ] ; then
+	echo Case $case is not in $casesfile
+	failed=`expr $failed + 1`
+	continue
+    fi
+    example=`echo $line | awk '{print $2}'`
+    rundatas=`echo $line | awk '{print $3}' | tr ',' ' '`
+    nsteps=`echo $line | awk '{print $4}'`
+    strong=`echo $rundatas | awk '{print $1}'`
+    maxprocs=`echo $line | awk '{for(i=5;i<=NF;i++) if($i !~ /=/) print $i}'`
+    values=`echo $line | awk '{for(i=5;i<=NF;i++) if($i ~ /=/ && $i !~ /^restart=/) print $i}'`
+    restart=`echo $line | awk '{for(i=5;i<=NF;i++) if($i ~ /^restart=/) print substr($i,9)}'`
+    caseprocs=`echo $procs | awk -v m=$maxprocs '{for(i=1;i<=NF;i++) if(m=="" || $i<=m) printf "%s ",$i}'`
+
+    echo On $case...
+    if ! build $example ; then
+	echo "  build failed (see $rundir/build-$example.log)"
+	printf "\nCase %s: build failed\n" $case >> $report
+	failed=`expr $failed + 1`
+	continue
+    fi
+
+    printf "\nCase %s (%s, %d steps), strong scaling\n" $case $strong $nsteps >> $report
+    header >> $report
+    base=
+    for np in $caseprocs ; do
+	dir=$rundir/$case/strong-np$np
+	rm -rf $dir
+	mkdir -p $rundir/$case
+	cp -r $EXAMPLES/$example/rundata/$strong $dir
+	setvalues $dir/suntans.dat "$values"
+	echo "  $np processor(s)"
+	run $dir $np $nsteps $restart
+	if [ -z "$base" ] && [ -f $dir/summary.dat ] ; then
+	    base=$dir
+	    basenp=$np
+	    if [ $update -eq 1 ] ; then
+		reference $dir/summary.dat > $refdir/$case.dat
+	    fi
+	fi
+	result=`check $dir $case` || failed=`expr $failed + 1`
+	if [ -f $dir/summary.dat ] ; then
+	    echo "`timing $dir/summary.dat $base/summary.dat $np $basenp strong`  $result" >> $report
+	else
+	    printf "  %4d %s\n" $np "$result" >> $report
+	fi
+    done
+
+    if [ $single -eq 1 ] && [ -n "$base" ] ; then
+	np=`echo $caseprocs | awk '{print $1}'`
+	dir=$rundir/$case/single-np$np
+	rm -rf $dir
+	cp -r $EXAMPLES/$example/rundata/$strong $dir
+	setvalues $dir/suntans.dat "$values"
+	echo "  $np processor(s), single precision"
+	printf "\nCase %s, single precision on %d processor(s), drift from double precision\n" $case $np >> $report
+	if ! build $example single ; then
+	    echo "  build failed (see $rundir/build-$example.log)" >> $report
+	    failed=`expr $failed + 1`
+	elif run $dir $np $nsteps $restart ; then
+	    printf "  %-12s %22s %22s %10s\n" norm double single drift >> $report
+	    drift $dir/summary.dat $rundir/$case/strong-np$np/summary.dat >> $report
+	    header >> $report
+	    echo "`timing $dir/summary.dat $rundir/$case/strong-np$np/summary.dat $np $np strong`" >> $report
+	else
+	    echo "  failed (see $dir/run.log)" >> $report
+	    failed=`expr $failed + 1`
+	fi
+	build $example > /dev/null
+    fi
+
+    if [ `echo $rundatas | wc -w` -gt 1 ] ; then
+	printf "\nCase %s (%s, %d steps), weak scaling\n" $case "$rundatas" $nsteps >> $report
+	header >> $report
+	base=
+	i=1
+	for np in $caseprocs ; do
+	    rundata=`echo $rundatas | awk -v i=$i '{print $i}'`
+	    [ -z "$rundata" ] && break
+	    dir=$rundir/$case/weak-np$np
+	    rm -rf $dir
+	    cp -r $EXAMPLES/$example/rundata/$rundata $dir
+	    setvalues $dir/suntans.dat "$values"
+	    echo "  $rundata on $np processor(s)"
+	    run $dir $np $nsteps $restart
+	    if [ -z "$base" ] && [ -f $dir/summary.dat ] ; then
+		base=$dir
+		basenp=$np
+	    fi
+	    if [ -f $dir/summary.dat ] ; then
+		echo "`timing $dir/summary.dat $base/summary.dat $np $basenp weak`" >> $report
+	    else
+		printf "  %4d failed (see %s/run.log)\n" $np $dir >> $report
+		failed=`expr $failed + 1`
+	    fi
+	    i=`expr $i + 1`
+	done
+    fi
+done
+
+# Smoke run of the kernel benchmark
+echo On sunbench...
+np=`echo $procs | awk '{print $1}'`
+dir=$rundir/sunbench
+rm -rf $dir
+mkdir -p $dir
+if [ -z "$MPIHOME" ] ; then
+    EXEC=$SUNTANSHOME/sunbench
+else
+    EXEC="$MPIHOME/bin/mpirun -np $np $SUNTANSHOME/sunbench"
+fi
+printf "\nsunbench on %d processor(s): " $np >> $report
+make -C $SUNTANSHOME clean > /dev/null
+if ! make -C $SUNTANSHOME bench > $dir/build.log 2>&1 ; then
+    echo "build failed (see $dir/build.log)" >> $report
+    failed=`expr $failed + 1`
+elif $EXEC --datadir=$dir --Nx=8 --Ny=8 --Nkmax=5 --reps=1 --iters=2 > $dir/run.log 2>&1 && [ -s $dir/bench.json ] ; then
+    echo "ok" >> $report
+else
+    echo "failed (see $dir/run.log)" >> $report
+    failed=`expr $failed + 1`
+fi
+
+cat $report
+exit $failed
@@ -556,8 +556,8 @@ static void SegmentArea(propT *prop, gridT *grid, int myproc, MPI_Comm comm){
     }
 
     //Sum the area across processors
-    MPI_Reduce(bound->localsegarea, bound->segarea,(int)bound->Nseg, MPI_DOUBLE, MPI_SUM, 0,comm);
-    MPI_Bcast(bound->segarea,(int)bound->Nseg, MPI_DOUBLE,0,comm);
+    MPI_Reduce(bound->localsegarea, bound->segarea,(int)bound->Nseg, MPI_REALTYPE, MPI_SUM, 0,comm);
+    MPI_Bcast(bound->segarea,(int)bound->Nseg, MPI_REALTYPE,0,comm);
 
 }//End function SegmentArea()
 
@@ -0,0 +1,578 @@
+/*
+ * File: analysis.c
+ * ----------------
+ * In-situ analysis of the model fields, which replaces high-frequency
+ * output that is only used to compute tidal harmonics and statistics:
+ *
+ * analysis             0 - off, 1 - on
+ * ntanalysis           steps between samples
+ * ntanalysisout        steps between checkpoints of the results (0 - only at the end
+ *                      of the run or at blowup)
+ * analysiststart       simulation time in seconds at which sampling starts
+ * AnalysisVariables    comma separated list of the variables, any of the station
+ *                      variables in outputplan.c (default eta,uc,vc)
+ * TidalConstituents    comma separated list of the constituents of the harmonic
+ *                      analysis, e.g. M2,S2,N2,K1,O1 (see TidalFrequency in tides.c).
+ *                      none only computes the statistics, and boundary uses the
+ *                      frequencies omegas read from TideInput.
+ * exceed_<variable>    counts the samples above this threshold, e.g. exceed_eta 1.5
+ * AnalysisNetcdfFile   output file (default analysis.nc)
+ *
+ * At each point (cell for eta, layer of a cell otherwise) the running mean,
+ * variance (Welford's algorithm), minimum, maximum, number of samples and the
+ * exceedance count are accumulated, along with the right-hand sides of the
+ * least-squares normal equations of the harmonic fit
+ *
+ *   f(t) = a0 + sum_j a_j cos(omega_j t) + b_j sin(omega_j t)
+ *
+ * The normal matrix only depends on the sample times and is shared by all
+ * points, so a sample costs O(1+2*Ncon) per point and the fit is solved once
+ * per checkpoint.  t is the netcdf time (seconds since basetime), so the
+ * phases are relative to basetime and no nodal corrections are applied.  Points
+ * that were dry for some of the samples only have statistics.
+ *
+ * The results are written to a netcdf file with a record per checkpoint as
+ * <var>_mean, <var>_var, <var>_min, <var>_max, <var>_count, <var>_exceed and
+ * <var>_<constituent>_amp, <var>_<constituent>_phase (degrees), merged onto
+ * processor 0 with mergeArrays=1 and one file per processor otherwise (see
+ * InitialiseAnalysisNC in mynetcdf.c).  The accumulators are not stored in the
+ * restart file, so a restarted run starts a new analysis.
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "memory.h"
+#include "util.h"
+#include "fileio.h"
+#include "mympi.h"
+#include "tides.h"
+#include "outputplan.h"
+#include "analysis.h"
+#include "mynetcdf.h"
+#include "timestep.h"
+
+static analysisT *analysis = NULL;
+static REAL tfirst, tlast;
+
+static analysisT *InitializeAnalysis(gridT *grid, propT *prop, int myproc);
+static void ReadConstituents(analysisT *an, int myproc);
+static void AddOutput(analysisT *an, int v, int kind, int con, char *suffix, char *longname);
+static void SampleAnalysis(analysisT *an, gridT *grid, physT *phys, propT *prop);
+static void WriteAnalysis(analysisT *an, gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc);
+static int InvertNormalMatrix(analysisT *an, REAL *Ginv);
+static void AnalysisField(analysisT *an, gridT *grid, anoutT *out, REAL *Ginv, int fit);
+static void AllocateAnalysis(analysisT *an, gridT *grid);
+static void FreeAnalysis(analysisT *an, gridT *grid, propT *prop, int myproc);
+
+/*
+ * Function: Analysis
+ * Usage: Analysis(grid,phys,prop,blowup,comm,numprocs,myproc);
+ * ------------------------------------------------------------
+ * Sets up the analysis at the first step, samples the fields every
+ * ntanalysis steps after analysiststart and writes the results every
+ * ntanalysisout steps, at the last step and at blowup.
+ *
+ */
+void Analysis(gridT *grid, physT *phys, propT *prop, int blowup, MPI_Comm comm, int numprocs, int myproc) {
+  int last = (prop->n==prop->nstart+prop->nsteps);
+
+  if(prop->n==1+prop->nstart &&
+     (int)MPI_GetValue(DATAFILE,"analysis","Analysis",myproc))
+    analysis = InitializeAnalysis(grid,prop,myproc);
+  if(!analysis)
+    return;
+
+  if(prop->rtime>=analysis->tstart-SMALL && IntervalDue(prop,analysis->ntsample) && !blowup)
+    SampleAnalysis(analysis,grid,phys,prop);
+
+  if(last || blowup || IntervalDue(prop,analysis->ntout))
+    WriteAnalysis(analysis,grid,prop,comm,numprocs,myproc);
+
+  if(last || blowup) {
+    FreeAnalysis(analysis,grid,prop,myproc);
+    analysis = NULL;
+  }
+}
+
+/*
+ * Function: InitializeAnalysis
+ * Usage: an = InitializeAnalysis(grid,prop,myproc);
+ * -------------------------------------------------
+ * Reads the analysis parameters and allocates the accumulators.
+ *
+ */
+static analysisT *InitializeAnalysis(gridT *grid, propT *prop, int myproc) {
+  int v, j, status;
+  char str[BUFFERLENGTH], filename[BUFFERLENGTH], *tok;
+  REAL val;
+  analysisT *an = (analysisT *)SunMalloc(sizeof(analysisT),"InitializeAnalysis");
+
+  an->ntsample = (int)MPI_GetValue(DATAFILE,"ntanalysis","InitializeAnalysis",myproc);
+  an->ntout = (int)MPI_GetValue(DATAFILE,"ntanalysisout","InitializeAnalysis",myproc);
+  an->tstart = MPI_GetValue(DATAFILE,"analysiststart","InitializeAnalysis",myproc);
+  if(an->ntsample<1)
+    an->ntsample=1;
+
+  ReadConstituents(an,myproc);
+  an->Npar = 1+2*an->Ncon;
+  an->G = (REAL *)SunMalloc(an->Npar*an->Npar*sizeof(REAL),"InitializeAnalysis");
+  an->phi = (REAL *)SunMalloc(an->Npar*sizeof(REAL),"InitializeAnalysis");
+  for(j=0;j<an->Npar*an->Npar;j++)
+    an->G[j]=0;
+  an->nsamples=0;
+
+  GetString(str,DATAFILE,"AnalysisVariables",&status);
+  if(!status)
+    strcpy(str,DEFAULTANALYSISVARIABLES);
+  an->Nvars=0;
+  for(tok=strtok(str,",");tok!=NULL;tok=strtok(NULL,",")) {
+    v=an->Nvars;
+    if(OutputPlanField(tok)<0 || v==MAXPLANVARIABLES) {
+      if(myproc==0) printf("Error in InitializeAnalysis: cannot analyse %s (see outputplan.c).\n",tok);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    strcpy(an->var[v].name,tok);
+    an->var[v].field=OutputPlanField(tok);
+    an->var[v].is3d=OutputPlanIs3D(an->var[v].field);
+    an->Nvars++;
+  }
+
+  for(v=0;v<an->Nvars;v++) {
+    snprintf(str,BUFFERLENGTH,"exceed_%s",an->var[v].name);
+    val = GetValue(DATAFILE,str,&status);
+    an->var[v].exceedance=status;
+    an->var[v].threshold=(status ? val : 0);
+  }
+  AllocateAnalysis(an,grid);
+
+  // Output fields
+  an->Nout=0;
+  an->out = (anoutT *)SunMalloc(an->Nvars*(6+2*an->Ncon)*sizeof(anoutT),"InitializeAnalysis");
+  for(v=0;v<an->Nvars;v++) {
+    AddOutput(an,v,ANMEAN,0,"mean","Mean");
+    AddOutput(an,v,ANVAR,0,"var","Variance");
+    AddOutput(an,v,ANMIN,0,"min","Minimum");
+    AddOutput(an,v,ANMAX,0,"max","Maximum");
+    AddOutput(an,v,ANCOUNT,0,"count","Number of samples");
+    if(an->var[v].exceedance)
+      AddOutput(an,v,ANEXCEED,0,"exceed","Number of samples above the threshold");
+    for(j=0;j<an->Ncon;j++) {
+      snprintf(str,BUFFERLENGTH,"%s_amp",an->con[j]);
+      AddOutput(an,v,ANAMP,j,str,"Harmonic amplitude");
+      snprintf(str,BUFFERLENGTH,"%s_phase",an->con[j]);
+      AddOutput(an,v,ANPHASE,j,str,"Harmonic phase (degrees) relative to basetime");
+    }
+  }
+
+  GetString(str,DATAFILE,"AnalysisNetcdfFile",&status);
+  if(status)
+    MPI_GetFile(filename,DATAFILE,"AnalysisNetcdfFile","InitializeAnalysis",myproc);
+  else if(snprintf(filename,BUFFERLENGTH,"%s/%s",DATADIR,DEFAULTANALYSISNETCDFFILE)>=BUFFERLENGTH) {
+    printf("Error in InitializeAnalysis: the path of %s is longer than %d characters.\n",
+	   DEFAULTANALYSISNETCDFFILE,BUFFERLENGTH-1);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  if(prop->mergeArrays)
+    strcpy(an->file,filename);
+  else if(snprintf(an->file,BUFFERLENGTH,"%s.%d",filename,myproc)>=BUFFERLENGTH) {
+    printf("Error in InitializeAnalysis: the name of the analysis file %s is longer than %d characters.\n",
+	   filename,BUFFERLENGTH-1);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  an->ncid=-1;
+  an->nctimectr=0;
+
+  if(myproc==0 && VERBOSE>1)
+    printf("Analysing %d variables with %d tidal constituents every %d steps.\n",an->Nvars,an->Ncon,an->ntsample);
+  return an;
+}
+
+/*
+ * Function: AllocateAnalysis
+ * Usage: AllocateAnalysis(an,grid);
+ * ---------------------------------
+ * Allocates the points of the variables of an on grid with empty
+ * accumulators, and the work arrays of the output fields.
+ *
+ */
+static void AllocateAnalysis(analysisT *an, gridT *grid) {
+  int i, v, n;
+
+  an->pstart = (int *)SunMalloc((grid->Nc+1)*sizeof(int),"AllocateAnalysis");
+  an->pstart[0]=0;
+  for(i=0;i<grid->Nc;i++)
+    an->pstart[i+1]=an->pstart[i]+grid->Nk[i];
+
+  for(v=0;v<an->Nvars;v++) {
+    n=an->var[v].Npts=(an->var[v].is3d ? an->pstart[grid->Nc] : grid->Nc);
+    an->var[v].n = (int *)SunMalloc(n*sizeof(int),"AllocateAnalysis");
+    an->var[v].exceed = (int *)SunMalloc(n*sizeof(int),"AllocateAnalysis");
+    an->var[v].mean = (REAL *)SunMalloc(n*sizeof(REAL),"AllocateAnalysis");
+    an->var[v].M2 = (REAL *)SunMalloc(n*sizeof(REAL),"AllocateAnalysis");
+    an->var[v].min = (REAL *)SunMalloc(n*sizeof(REAL),"AllocateAnalysis");
+    an->var[v].max = (REAL *)SunMalloc(n*sizeof(REAL),"AllocateAnalysis");
+    an->var[v].b = (REAL *)SunMalloc(n*an->Npar*sizeof(REAL),"AllocateAnalysis");
+    for(i=0;i<n;i++) {
+      an->var[v].n[i]=an->var[v].exceed[i]=0;
+      an->var[v].mean[i]=an->var[v].M2[i]=0;
+      an->var[v].min[i]=INFTY;
+      an->var[v].max[i]=-INFTY;
+    }
+    for(i=0;i<n*an->Npar;i++)
+      an->var[v].b[i]=0;
+  }
+
+  an->work = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *),"AllocateAnalysis");
+  for(i=0;i<grid->Nc;i++)
+    an->work[i] = (REAL *)SunMalloc(grid->Nkmax*sizeof(REAL),"AllocateAnalysis");
+  an->work2d = (REAL *)SunMalloc(grid->Nc*sizeof(REAL),"AllocateAnalysis");
+}
+
+/*
+ * Function: AnalysisRepartition
+ * Usage: an = AnalysisRepartition(grid,&oldan);
+ * ---------------------------------------------
+ * Creates the analysis on the repartitioned grid with the parameters,
+ * normal matrix and output file of the current one, which is returned in
+ * oldan.  Returns NULL if there is no analysis.  The accumulators must be
+ * transferred by the caller (see MigrateAnalysis in rebalance.c), which then
+ * frees oldan with FreeAnalysisArrays.
+ *
+ */
+analysisT *AnalysisRepartition(gridT *grid, analysisT **oldan) {
+  int j;
+
+  *oldan = analysis;
+  if(!analysis)
+    return NULL;
+
+  analysis = (analysisT *)SunMalloc(sizeof(analysisT),"AnalysisRepartition");
+  *analysis = **oldan;
+  analysis->G = (REAL *)SunMalloc(analysis->Npar*analysis->Npar*sizeof(REAL),"AnalysisRepartition");
+  analysis->phi = (REAL *)SunMalloc(analysis->Npar*sizeof(REAL),"AnalysisRepartition");
+  for(j=0;j<analysis->Npar*analysis->Npar;j++)
+    analysis->G[j]=(*oldan)->G[j];
+  analysis->out = (anoutT *)SunMalloc(analysis->Nvars*(6+2*analysis->Ncon)*sizeof(anoutT),"AnalysisRepartition");
+  for(j=0;j<analysis->Nout;j++)
+    analysis->out[j]=(*oldan)->out[j];
+  AllocateAnalysis(analysis,grid);
+  return analysis;
+}
+
+/*
+ * Function: ReadConstituents
+ * Usage: ReadConstituents(an,myproc);
+ * -----------------------------------
+ * Reads the names of the tidal constituents from TidalConstituents and sets
+ * their frequencies.
+ *
+ */
+static void ReadConstituents(analysisT *an, int myproc) {
+  int j, status;
+  char str[BUFFERLENGTH], *tok;
+
+  GetString(str,DATAFILE,"TidalConstituents",&status);
+  if(!status)
+    strcpy(str,DEFAULTTIDALCONSTITUENTS);
+
+  an->Ncon=0;
+  if(!strcmp(str,"none"))
+    return;
+
+  if(!strcmp(str,"boundary")) {
+    if(numtides>MAXCONSTITUENTS || omegas==NULL) {
+      if(myproc==0) printf("Error in ReadConstituents: TidalConstituents boundary requires at most %d tides from TideInput.\n",
+			   MAXCONSTITUENTS);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    for(j=0;j<numtides;j++) {
+      snprintf(an->con[j],BUFFERLENGTH,"tide%d",j);
+      an->omega[j]=omegas[j];
+    }
+    an->Ncon=numtides;
+    return;
+  }
+
+  for(tok=strtok(str,",");tok!=NULL;tok=strtok(NULL,",")) {
+    if(an->Ncon==MAXCONSTITUENTS || TidalFrequency(tok)<0) {
+      if(myproc==0) printf("Error in ReadConstituents: unknown or too many tidal constituents at %s.\n",tok);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    strcpy(an->con[an->Ncon],tok);
+    an->omega[an->Ncon++]=TidalFrequency(tok);
+  }
+}
+
+/*
+ * Function: AddOutput
+ * Usage: AddOutput(an,v,ANAMP,j,"M2_amp","Harmonic amplitude");
+ * -------------------------------------------------------------
+ * Adds the field <variable>_<suffix> to the output fields.
+ *
+ */
+static void AddOutput(analysisT *an, int v, int kind, int con, char *suffix, char *longname) {
+  anoutT *out = &(an->out[an->Nout++]);
+
+  snprintf(out->name,BUFFERLENGTH,"%s_%s",an->var[v].name,suffix);
+  snprintf(out->longname,BUFFERLENGTH,"%s of %s",longname,an->var[v].name);
+  out->var=v;
+  out->kind=kind;
+  out->con=con;
+  out->is3d=an->var[v].is3d;
+}
+
+/*
+ * Function: SampleAnalysis
+ * Usage: SampleAnalysis(an,grid,phys,prop);
+ * -----------------------------------------
+ * Adds the current values of the fields to the accumulators.  Dry layers
+ * are skipped.
+ *
+ */
+static void SampleAnalysis(analysisT *an, gridT *grid, physT *phys, propT *prop) {
+  int i, j, k, l, p, v, Npar=an->Npar;
+  REAL t=prop->nctime, x, delta, *phi=an->phi, *b;
+  anvarT *var;
+
+  phi[0]=1;
+  for(j=0;j<an->Ncon;j++) {
+    phi[2*j+1]=cos(an->omega[j]*t);
+    phi[2*j+2]=sin(an->omega[j]*t);
+  }
+  for(j=0;j<Npar;j++)
+    for(l=0;l<Npar;l++)
+      an->G[j*Npar+l]+=phi[j]*phi[l];
+  if(an->nsamples==0)
+    tfirst=t;
+  tlast=t;
+  an->nsamples++;
+
+  for(v=0;v<an->Nvars;v++) {
+    var=&(an->var[v]);
+    for(i=0;i<grid->Nc;i++)
+      for(k=0;k<(var->is3d ? grid->Nk[i] : 1);k++) {
+	x=OutputPlanValue(grid,phys,var->field,i,k);
+	if(x==(REAL)EMPTY)
+	  continue;
+	p=(var->is3d ? an->pstart[i]+k : i);
+
+	var->n[p]++;
+	delta=x-var->mean[p];
+	var->mean[p]+=delta/var->n[p];
+	var->M2[p]+=delta*(x-var->mean[p]);
+	if(x<var->min[p])
+	  var->min[p]=x;
+	if(x>var->max[p])
+	  var->max[p]=x;
+	if(var->exceedance && x>var->threshold)
+	  var->exceed[p]++;
+
+	b=var->b+p*Npar;
+	for(j=0;j<Npar;j++)
+	  b[j]+=x*phi[j];
+      }
+  }
+}
+
+/*
+ * Function: WriteAnalysis
+ * Usage: WriteAnalysis(an,grid,prop,comm,numprocs,myproc);
+ * --------------------------------------------------------
+ * Solves the harmonic fit and writes the results of all variables to the
+ * next record of the analysis file, which is created at the first call.
+ *
+ */
+static void WriteAnalysis(analysisT *an, gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc) {
+  int o, j, l, fit;
+  REAL *Ginv, dw, T;
+  int writer = (!prop->mergeArrays || myproc==0);
+
+  if(an->nctimectr==0)
+    InitialiseAnalysisNC(prop,grid,an,numprocs,comm,myproc);
+
+  // The fit needs at least as many samples as unknowns and a record that
+  // is long enough to separate the constituents
+  Ginv = (REAL *)SunMalloc(an->Npar*an->Npar*sizeof(REAL),"WriteAnalysis");
+  fit = (an->Ncon>0 && an->nsamples>=an->Npar && InvertNormalMatrix(an,Ginv));
+  if(an->Ncon>0 && myproc==0) {
+    T=tlast-tfirst;
+    for(j=0;j<an->Ncon;j++)
+      for(l=j;l<an->Ncon;l++) {
+	dw=(l==j ? an->omega[j] : fabs(an->omega[j]-an->omega[l]));
+	if(dw*T<2*PI) {
+	  printf("Warning in WriteAnalysis: the record of %.0f s does not resolve %s%s%s.\n",
+		 T,an->con[j],l==j ? "" : " and ",l==j ? "" : an->con[l]);
+	  j=l=an->Ncon;
+	}
+      }
+    if(!fit)
+      printf("Warning in WriteAnalysis: cannot fit the tidal constituents with %d samples.\n",an->nsamples);
+  }
+
+  for(o=0;o<an->Nout;o++) {
+    AnalysisField(an,grid,&(an->out[o]),Ginv,fit);
+    WriteAnalysisFieldNC(prop,grid,an,o,numprocs,comm,myproc);
+  }
+  if(writer)
+    WriteAnalysisTimeNC(prop,an,myproc);
+  an->nctimectr++;
+
+  SunFree(Ginv,an->Npar*an->Npar*sizeof(REAL),"WriteAnalysis");
+}
+
+/*
+ * Function: InvertNormalMatrix
+ * Usage: fit = InvertNormalMatrix(an,Ginv);
+ * -----------------------------------------
+ * Inverts the normal matrix of the harmonic fit column by column with
+ * linsolve in util.c.  Returns 0 if it is singular to working precision.
+ *
+ */
+static int InvertNormalMatrix(analysisT *an, REAL *Ginv) {
+  int j, l, m, N=an->Npar, ok=1;
+  REAL **A, *x, r;
+
+  A = (REAL **)SunMalloc(N*sizeof(REAL *),"InvertNormalMatrix");
+  for(j=0;j<N;j++)
+    A[j] = (REAL *)SunMalloc(N*sizeof(REAL),"InvertNormalMatrix");
+  x = (REAL *)SunMalloc(N*sizeof(REAL),"InvertNormalMatrix");
+
+  for(m=0;m<N && ok;m++) {
+    for(j=0;j<N;j++) {
+      for(l=0;l<N;l++)
+	A[j][l]=an->G[j*N+l];
+      x[j]=(j==m);
+    }
+    linsolve(A,x,N);
+
+    // Residual of column m of G*Ginv=I
+    for(j=0;j<N;j++) {
+      r=(j==m);
+      for(l=0;l<N;l++)
+	r-=an->G[j*N+l]*x[l];
+      if(!(fabs(r)<1e-6))
+	ok=0;
+      Ginv[j*N+m]=x[j];
+    }
+  }
+
+  for(j=0;j<N;j++)
+    SunFree(A[j],N*sizeof(REAL),"InvertNormalMatrix");
+  SunFree(A,N*sizeof(REAL *),"InvertNormalMatrix");
+  SunFree(x,N*sizeof(REAL),"InvertNormalMatrix");
+  return ok;
+}
+
+/*
+ * Function: AnalysisField
+ * Usage: AnalysisField(an,grid,out,Ginv,fit);
+ * -------------------------------------------
+ * Computes an output field from the accumulators into an->work (3-D) or
+ * an->work2d (2-D).  Points without samples hold EMPTY.
+ *
+ */
+static void AnalysisField(analysisT *an, gridT *grid, anoutT *out, REAL *Ginv, int fit) {
+  int i, k, l, p, Npar=an->Npar;
+  REAL val, a, c, *b;
+  anvarT *var=&(an->var[out->var]);
+
+  for(i=0;i<grid->Nc;i++)
+    for(k=0;k<(out->is3d ? grid->Nk[i] : 1);k++) {
+      p=(out->is3d ? an->pstart[i]+k : i);
+      val=(REAL)EMPTY;
+      if(var->n[p]>0)
+	switch(out->kind) {
+	  case ANMEAN:
+	    val=var->mean[p];
+	    break;
+	  case ANVAR:
+	    if(var->n[p]>1)
+	      val=var->M2[p]/(var->n[p]-1);
+	    break;
+	  case ANMIN:
+	    val=var->min[p];
+	    break;
+	  case ANMAX:
+	    val=var->max[p];
+	    break;
+	  case ANCOUNT:
+	    val=var->n[p];
+	    break;
+	  case ANEXCEED:
+	    val=var->exceed[p];
+	    break;
+	  case ANAMP:
+	  case ANPHASE:
+	    if(!fit || var->n[p]<an->nsamples)
+	      break;
+	    b=var->b+p*Npar;
+	    a=c=0;
+	    for(l=0;l<Npar;l++) {
+	      a+=Ginv[(2*out->con+1)*Npar+l]*b[l];
+	      c+=Ginv[(2*out->con+2)*Npar+l]*b[l];
+	    }
+	    if(out->kind==ANAMP)
+	      val=sqrt(a*a+c*c);
+	    else {
+	      val=atan2(c,a)*180.0/PI;
+	      if(val<0)
+		val+=360.0;
+	    }
+	    break;
+	}
+      if(out->is3d)
+	an->work[i][k]=val;
+      else
+	an->work2d[i]=val;
+    }
+}
+
+/*
+ * Function: FreeAnalysis
+ * Usage: FreeAnalysis(an,grid,prop,myproc);
+ * -----------------------------------------
+ * Closes the analysis file and frees the accumulators.
+ *
+ */
+static void FreeAnalysis(analysisT *an, gridT *grid, propT *prop, int myproc) {
+  if(an->nctimectr>0 && (!prop->mergeArrays || myproc==0))
+    MPI_NCClose(an->ncid);
+  FreeAnalysisArrays(an,grid);
+}
+
+/*
+ * Function: FreeAnalysisArrays
+ * Usage: FreeAnalysisArrays(an,grid);
+ * -----------------------------------
+ * Frees the accumulators of an on grid without closing its file.
+ *
+ */
+void FreeAnalysisArrays(analysisT *an, gridT *grid) {
+  int i, v, n;
+
+  for(v=0;v<an->Nvars;v++) {
+    n=an->var[v].Npts;
+    SunFree(an->var[v].n,n*sizeof(int),"FreeAnalysis");
+    SunFree(an->var[v].exceed,n*sizeof(int),"FreeAnalysis");
+    SunFree(an->var[v].mean,n*sizeof(REAL),"FreeAnalysis");
+    SunFree(an->var[v].M2,n*sizeof(REAL),"FreeAnalysis");
+    SunFree(an->var[v].min,n*sizeof(REAL),"FreeAnalysis");
+    SunFree(an->var[v].max,n*sizeof(REAL),"FreeAnalysis");
+    SunFree(an->var[v].b,n*an->Npar*sizeof(REAL),"FreeAnalysis");
+  }
+  for(i=0;i<grid->Nc;i++)
+    SunFree(an->work[i],grid->Nkmax*sizeof(REAL),"FreeAnalysis");
+  SunFree(an->work,grid->Nc*sizeof(REAL *),"FreeAnalysis");
+  SunFree(an->work2d,grid->Nc*sizeof(REAL),"FreeAnalysis");
+  SunFree(an->out,an->Nvars*(6+2*an->Ncon)*sizeof(anoutT),"FreeAnalysis");
+  SunFree(an->pstart,(grid->Nc+1)*sizeof(int),"FreeAnalysis");
+  SunFree(an->G,an->Npar*an->Npar*sizeof(REAL),"FreeAnalysis");
+  SunFree(an->phi,an->Npar*sizeof(REAL),"FreeAnalysis");
+  SunFree(an,sizeof(analysisT),"FreeAnalysis");
+}
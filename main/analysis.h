@@ -0,0 +1,82 @@
+/*
+ * File: analysis.h
+ * ----------------
+ * Header file for analysis.c, which computes tidal harmonics and running
+ * statistics of the model fields during the run.
+ *
+ */
+#ifndef _analysis_h
+#define _analysis_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "outputplan.h"
+
+#define MAXCONSTITUENTS 32
+#define DEFAULTANALYSISVARIABLES "eta,uc,vc"
+#define DEFAULTTIDALCONSTITUENTS "M2,S2,N2,K1,O1"
+#define DEFAULTANALYSISNETCDFFILE "analysis.nc"
+
+/*
+ * Accumulators of one analysed variable at its Npts points, which are the
+ * cells (2-D) or the layers of the cells (3-D, point pstart[i]+k).  The
+ * right-hand sides of the harmonic normal equations are b[p*Npar+j].
+ *
+ */
+typedef struct _anvarT {
+  char name[BUFFERLENGTH];
+  int field, is3d, Npts;
+  REAL threshold;            // exceedance threshold, exceed_<name> in suntans.dat
+  int exceedance;            // 1 if the threshold is given
+  int *n, *exceed;           // number of samples and samples above the threshold
+  REAL *mean, *M2, *min, *max, *b;
+} anvarT;
+
+// Fields computed from the accumulators of a variable
+enum {
+  ANMEAN, ANVAR, ANMIN, ANMAX, ANCOUNT, ANEXCEED, ANAMP, ANPHASE
+};
+
+/*
+ * Field written to the netcdf file, computed from the accumulators of
+ * variable var (see AnalysisField in analysis.c).  con is the constituent
+ * of the harmonic fields.
+ *
+ */
+typedef struct _anoutT {
+  char name[BUFFERLENGTH];
+  char longname[BUFFERLENGTH];
+  int var, kind, con, is3d;
+} anoutT;
+
+typedef struct _analysisT {
+  int ntsample;              // steps between samples
+  int ntout;                 // steps between checkpoints (0 - end of the run only)
+  REAL tstart;               // simulation time at which sampling starts
+
+  int Nvars;
+  anvarT var[MAXPLANVARIABLES];
+  int *pstart;               // first point of cell i of the 3-D variables [Nc]
+
+  int Ncon;                  // number of tidal constituents
+  char con[MAXCONSTITUENTS][BUFFERLENGTH];
+  REAL omega[MAXCONSTITUENTS];
+  int Npar;                  // unknowns of the harmonic fit, 1+2*Ncon
+  REAL *G;                   // normal matrix of the fit [Npar*Npar]
+  REAL *phi;                 // basis functions at the current sample [Npar]
+  int nsamples;
+
+  int Nout;
+  anoutT *out;
+  REAL **work, *work2d;      // values of an output field [Nc][Nkmax] and [Nc]
+
+  char file[BUFFERLENGTH];
+  int ncid, nctimectr;
+} analysisT;
+
+void Analysis(gridT *grid, physT *phys, propT *prop, int blowup, MPI_Comm comm, int numprocs, int myproc);
+analysisT *AnalysisRepartition(gridT *grid, analysisT **oldan);
+void FreeAnalysisArrays(analysisT *an, gridT *grid);
+
+#endif
@@ -46,9 +46,10 @@ void AllocateAverageVariables(gridT *grid, averageT **average, propT *prop)
   (*average)->s_F = (REAL **)SunMalloc(Ne*sizeof(REAL *),"AllocateAverageVariables");
   (*average)->T_F = (REAL **)SunMalloc(Ne*sizeof(REAL *),"AllocateAverageVariables");
 
-  if(prop->calcage)
+  if(prop->calcage) {
       (*average)->agec = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateAverageVariables");
       (*average)->agealpha = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateAverageVariables");
+  }
 
   // cell-centered averageical variables in plan (no vertical direction)
   (*average)->h = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateAverageVariables");
@@ -85,9 +86,10 @@ void AllocateAverageVariables(gridT *grid, averageT **average, propT *prop)
       (*average)->nu_v[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");
      (*average)->kappa_tv[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");
      (*average)->counter[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");
-      if(prop->calcage)
-         (*average)->agec[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");     	
-         (*average)->agealpha[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");     	
+      if(prop->calcage) {
+         (*average)->agec[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");
+         (*average)->agealpha[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateAverageVariables");
+      }
 
   }
   
@@ -457,9 +459,10 @@ void SendRecvAverages(propT *prop, gridT *grid, averageT *average, MPI_Comm comm
     ISendRecvCellData3D(average->rho,grid,myproc,comm);
     ISendRecvCellData3D(average->nu_v,grid,myproc,comm);
     ISendRecvCellData3D(average->kappa_tv,grid,myproc,comm);
-    if(prop->calcage)
+    if(prop->calcage) {
 	ISendRecvCellData3D(average->agec,grid,myproc,comm);
 	ISendRecvCellData3D(average->agealpha,grid,myproc,comm);
+    }
 
     ISendRecvWData(average->w,grid,myproc,comm);
 
@@ -469,3 +472,98 @@ void SendRecvAverages(propT *prop, gridT *grid, averageT *average, MPI_Comm comm
     ISendRecvEdgeData3D(average->T_F,grid,myproc,comm);
      
 }//End of function
+
+/*
+ * Function: AverageRepartition()
+ * ------------------------------
+ * Allocate the average arrays on the repartitioned grid, keeping the
+ * counters of the average output of oldaverage.  The sums of the current
+ * averaging interval must be transferred by the caller (see MigrateAverages
+ * in rebalance.c), which then frees oldaverage with FreeAverageVariables.
+ *
+ */
+void AverageRepartition(gridT *grid, averageT *oldaverage, averageT **average, propT *prop)
+{
+  int avgctr=prop->avgctr, avgtimectr=prop->avgtimectr, avgfilectr=prop->avgfilectr;
+
+  AllocateAverageVariables(grid,average,prop);
+  prop->avgctr=avgctr;
+  prop->avgtimectr=avgtimectr;
+  prop->avgfilectr=avgfilectr;
+  (*average)->initialavgfilectr=oldaverage->initialavgfilectr;
+}//End of function
+
+/*
+ * Function: FreeAverageVariables()
+ * --------------------------------
+ * Free the average arrays allocated on grid by AllocateAverageVariables.
+ *
+ */
+void FreeAverageVariables(gridT *grid, averageT *average, propT *prop)
+{
+  int i, j, Nc=grid->Nc, Ne=grid->Ne;
+
+  for(i=0;i<Nc;i++) {
+    SunFree(average->uc[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->vc[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->w[i],(grid->Nk[i]+1)*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->s[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->T[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->rho[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->nu_v[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->kappa_tv[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->counter[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    if(prop->calcage) {
+      SunFree(average->agec[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+      SunFree(average->agealpha[i],grid->Nk[i]*sizeof(REAL),"FreeAverageVariables");
+    }
+  }
+  SunFree(average->uc,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->vc,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->w,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->s,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->T,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->rho,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->nu_v,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->kappa_tv,Nc*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->counter,Nc*sizeof(REAL *),"FreeAverageVariables");
+  if(prop->calcage) {
+    SunFree(average->agec,Nc*sizeof(REAL *),"FreeAverageVariables");
+    SunFree(average->agealpha,Nc*sizeof(REAL *),"FreeAverageVariables");
+  }
+
+  for(j=0;j<Ne;j++) {
+    SunFree(average->U_F[j],grid->Nke[j]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->s_F[j],grid->Nke[j]*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->T_F[j],grid->Nke[j]*sizeof(REAL),"FreeAverageVariables");
+  }
+  SunFree(average->U_F,Ne*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->s_F,Ne*sizeof(REAL *),"FreeAverageVariables");
+  SunFree(average->T_F,Ne*sizeof(REAL *),"FreeAverageVariables");
+
+  SunFree(average->h,Nc*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average->h_avg,Nc*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average->s_dz,Nc*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average->T_dz,Nc*sizeof(REAL),"FreeAverageVariables");
+  if(prop->metmodel>0) {
+    SunFree(average->Uwind,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Vwind,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Tair,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Pair,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->rain,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->RH,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->cloud,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Hs,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Hl,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Hlw,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->Hsw,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->tau_x,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->tau_y,Nc*sizeof(REAL),"FreeAverageVariables");
+    SunFree(average->EP,Nc*sizeof(REAL),"FreeAverageVariables");
+  }
+
+  SunFree(average->tmpvar,grid->Nc*grid->Nkmax*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average->tmpvarE,grid->Ne*grid->Nkmax*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average->tmpvarW,grid->Nc*(grid->Nkmax+1)*sizeof(REAL),"FreeAverageVariables");
+  SunFree(average,sizeof(averageT),"FreeAverageVariables");
+}//End of function
@@ -78,5 +78,7 @@ void UpdateAverageVariables(gridT *grid, averageT *average, physT *phys, metT *m
 void UpdateAverageScalars(gridT *grid, averageT *average, physT *phys, metT *met, propT *prop,MPI_Comm comm, int myproc);
 void ComputeAverageVariables(gridT *grid, averageT *average, physT *phys, metT *met, int netaverage, propT *prop);
 void SendRecvAverages(propT *prop, gridT *grid, averageT *average, MPI_Comm comm, int myproc);
+void AverageRepartition(gridT *grid, averageT *oldaverage, averageT **average, propT *prop);
+void FreeAverageVariables(gridT *grid, averageT *average, propT *prop);
 
 #endif
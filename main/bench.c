@@ -0,0 +1,624 @@
+/*
+ * File: bench.c
+ * -------------
+ * Standalone benchmark of the kernels of the time step on synthetic grids,
+ * built with "make bench" as sunbench.  It is run like sun, i.e.
+ *
+ *   mpirun -np 4 ./sunbench --datadir=bench --Nx=128 --Ny=128 --Nkmax=20
+ *
+ * with the options
+ *
+ * --datadir=dir     scratch directory for the grid and suntans.dat (default ".")
+ * --Nx=n, --Ny=n    cells (quadrilaterals) or pairs of cells (triangles) in x and y
+ * --Nkmax=n         number of layers
+ * --maxfaces=n      3 for equilateral triangles and 4 or more for quadrilaterals,
+ *                   in which case maxFaces=n pads the cell arrays like a hybrid grid
+ * --reps=n          timed repetitions of each kernel
+ * --iters=n         fixed number of iterations of the conjugate-gradient solvers
+ * --warmup=n        time steps run with Solve before timing so that all of the
+ *                   fields are set
+ * --subgrid=1       also time the subgrid table lookups
+ * --qmixed=1        time CGSolveQ with single-precision inner iterations (qmixed=1)
+ * --json=file       results file (default bench.json in the data directory), which
+ *                   is written as file.tmp and renamed when all of the kernels have
+ *                   run, so that a run that fails leaves no results file
+ * -v                verbose
+ *
+ * Processor 0 writes the grid (points.dat, edges.dat, cells.dat with the
+ * number of faces in the first column and depth.dat-voro) and suntans.dat
+ * into the data directory, which is then partitioned and initialized as with
+ * "sun -g -s".  The time of each repetition is the maximum over the
+ * processors, and the results contain the minimum, mean and maximum over the
+ * repetitions and the mean in nanoseconds per cell (2-D kernels) or per
+ * active cell-layer (3-D kernels) of the whole grid.
+ *
+ */
+#include "suntans.h"
+#include "mympi.h"
+#include "grid.h"
+#include "phys.h"
+#include "physio.h"
+#include "fileio.h"
+#include "memory.h"
+#include "timer.h"
+#include "sendrecv.h"
+#include "subgrid.h"
+
+#define BENCHDX 100.0
+#define BENCHDEPTH 50.0
+#define MAXPOINTEDGES 8
+#define DEFAULTBENCHFILE "bench.json"
+
+typedef struct _benchoptT {
+  int Nx, Ny, Nkmax, maxfaces, reps, iters, warmup, subgrid, qmixed;
+  char json[BUFFERLENGTH], jsontmp[BUFFERLENGTH];
+} benchoptT;
+
+enum {
+  BHCOEFFICIENTS, BOPERATORH, BCGSOLVE, BCGSOLVEQ, BHORIZONTALSOURCE, BUPDATESCALARS,
+  BMY25, BPEROT, BLSQ, BQUAD, BCELL2D, BCELL3D, BEDGE3D, BSUBVEFF, BSUBACEFF,
+  BSUBFLUXHEIGHT, NUMBENCH
+};
+
+static char *benchnames[NUMBENCH] = {
+  "HCoefficients", "OperatorH", "CGSolve", "CGSolveQ", "HorizontalSource",
+  "UpdateScalarsTVD", "my25", "ComputeUCPerot", "ComputeUCLSQ", "ComputeUCQuad",
+  "ISendRecvCellData2D", "ISendRecvCellData3D", "ISendRecvEdgeData3D",
+  "UpdateSubgridVeff", "UpdateSubgridAceff", "UpdateSubgridFluxHeight"
+};
+
+// 1 for the kernels whose cost is given per cell-layer rather than per cell
+static int bench3d[NUMBENCH] = {
+  0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 0, 0, 0
+};
+
+static void ParseBenchFlags(int argc, char *argv[], benchoptT *opt, int myproc);
+static void BenchPath(char *str, char *name, char *function, int myproc);
+static void WriteBenchGrid(benchoptT *opt, int myproc);
+static void WriteBenchData(benchoptT *opt, int myproc);
+static int BenchAvailable(int b, benchoptT *opt, propT *prop);
+static void RunBench(int b, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs,
+    MPI_Comm comm);
+
+int main(int argc, char *argv[])
+{
+  int myproc, numprocs, b, r, i, iptr, k, Nc, Ncells, Nlayers, nk;
+  DREAL t0, t, tmax, tmin, tmean, tmaxr;
+  REAL *hrhs, **qsrc;
+  benchoptT opt;
+  MPI_Comm comm;
+  gridT *grid;
+  physT *phys;
+  propT *prop;
+  FILE *ofile=NULL;
+
+  StartMpi(&argc,&argv,&comm,&myproc,&numprocs);
+
+  ParseBenchFlags(argc,argv,&opt,myproc);
+
+  if(myproc==0) {
+    remove(opt.json);
+    WriteBenchGrid(&opt,myproc);
+    WriteBenchData(&opt,myproc);
+  }
+  MPI_Barrier(comm);
+
+  GRID=1;
+  SOLVE=1;
+  GetGrid(&grid,myproc,numprocs,comm);
+  ReadProperties(&prop,grid,myproc);
+  InitializeVerticalGrid(&grid,myproc);
+  AllocatePhysicalVariables(grid,&phys,prop);
+  AllocateTransferArrays(&grid,myproc,numprocs,comm);
+  OpenFiles(prop,myproc);
+  InitializePhysicalVariables(grid,phys,prop,myproc,comm);
+
+  // Spin up so that the fields and all of the coefficients are set
+  Solve(grid,phys,prop,myproc,numprocs,comm);
+
+  // Fixed right-hand sides of the free-surface and pressure solves
+  Nc=grid->Nc;
+  hrhs = (REAL *)SunMalloc(Nc*sizeof(REAL),"main");
+  qsrc = (REAL **)SunMalloc(Nc*sizeof(REAL *),"main");
+  for(i=0;i<Nc;i++) {
+    hrhs[i]=grid->Ac[i]*sin(2*PI*grid->xv[i]/(opt.Nx*BENCHDX))*cos(2*PI*grid->yv[i]/(opt.Ny*BENCHDX));
+    qsrc[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"main");
+    for(k=0;k<grid->Nk[i];k++)
+      qsrc[i][k]=hrhs[i]*(k+1)/grid->Nk[i];
+  }
+
+  // Size of the whole grid for the cost per point
+  Ncells=Nlayers=0;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    Ncells++;
+    Nlayers+=grid->Nk[i]-grid->ctop[i];
+  }
+  nk=Ncells;
+  MPI_Reduce(&nk,&Ncells,1,MPI_INT,MPI_SUM,0,comm);
+  nk=Nlayers;
+  MPI_Reduce(&nk,&Nlayers,1,MPI_INT,MPI_SUM,0,comm);
+
+  if(myproc==0) {
+    ofile = MPI_FOpen(opt.jsontmp,"w","main",myproc);
+    fprintf(ofile,"{\n");
+    fprintf(ofile,"  \"grid\": {\"Nx\": %d, \"Ny\": %d, \"maxfaces\": %d, \"Nkmax\": %d, \"cells\": %d, \"cell_layers\": %d},\n",
+        opt.Nx,opt.Ny,opt.maxfaces,opt.Nkmax,Ncells,Nlayers);
+    fprintf(ofile,"  \"numprocs\": %d,\n  \"reps\": %d,\n  \"iters\": %d,\n  \"qmixed\": %d,\n",
+        numprocs,opt.reps,opt.iters,opt.qmixed);
+    fprintf(ofile,"  \"kernels\": [");
+  }
+
+  for(b=0;b<NUMBENCH;b++) {
+    if(!BenchAvailable(b,&opt,prop))
+      continue;
+
+    tmin=INFTY;
+    tmean=tmaxr=0;
+    for(r=0;r<opt.reps;r++) {
+      // restore the right-hand sides that the solvers overwrite
+      if(b==BCGSOLVE)
+        for(i=0;i<Nc;i++)
+          phys->htmp[i]=hrhs[i];
+      if(b==BCGSOLVEQ)
+        for(i=0;i<Nc;i++)
+          for(k=0;k<grid->Nk[i];k++) {
+            phys->stmp[i][k]=qsrc[i][k];
+            phys->qc[i][k]=0;
+          }
+
+      MPI_Barrier(comm);
+      t0=Timer();
+      RunBench(b,grid,phys,prop,myproc,numprocs,comm);
+      t=Timer()-t0;
+      MPI_Reduce(&t,&tmax,1,MPI_DOUBLE,MPI_MAX,0,comm);
+
+      if(tmax<tmin) tmin=tmax;
+      if(tmax>tmaxr) tmaxr=tmax;
+      tmean+=tmax/opt.reps;
+    }
+
+    if(myproc==0) {
+      nk=bench3d[b]?Nlayers:Ncells;
+      fprintf(ofile,"%s\n    {\"name\": \"%s\", \"min\": %.6e, \"mean\": %.6e, \"max\": %.6e, \"ns_per_point\": %.4f}",
+          b?",":"",benchnames[b],tmin,tmean,tmaxr,1e9*tmean/nk);
+      if(VERBOSE>0)
+        printf("%-24s mean %.4e s, %.3f ns per point\n",benchnames[b],tmean,1e9*tmean/nk);
+    }
+  }
+
+  if(myproc==0) {
+    fprintf(ofile,"\n  ]\n}\n");
+    fclose(ofile);
+    if(rename(opt.jsontmp,opt.json)) {
+      printf("Error in main: could not rename %s to %s.\n",opt.jsontmp,opt.json);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for(i=0;i<Nc;i++)
+    SunFree(qsrc[i],grid->Nk[i]*sizeof(REAL),"main");
+  SunFree(qsrc,Nc*sizeof(REAL *),"main");
+  SunFree(hrhs,Nc*sizeof(REAL),"main");
+
+  EndMpi(&comm);
+}
+
+/*
+ * Function: ParseBenchFlags
+ * Usage: ParseBenchFlags(argc,argv,&opt,myproc);
+ * ----------------------------------------------
+ * Read the --key=value options of sunbench and set DATADIR and DATAFILE.
+ *
+ */
+static void ParseBenchFlags(int argc, char *argv[], benchoptT *opt, int myproc)
+{
+  int i, j, done=0;
+  char *val;
+
+  opt->Nx=64;
+  opt->Ny=64;
+  opt->Nkmax=20;
+  opt->maxfaces=3;
+  opt->reps=10;
+  opt->iters=50;
+  opt->warmup=2;
+  opt->subgrid=0;
+  opt->qmixed=0;
+  opt->json[0]='\0';
+
+  TRIANGULATE=0;
+  VERBOSE=0;
+  WARNING=0;
+  ASCII=0;
+  RESTART=0;
+  STEPSPERFILE=-1;
+  strcpy(DATADIR,".");
+
+  for(i=1;i<argc;i++) {
+    if(argv[i][0]=='-' && argv[i][1]=='v') {
+      for(j=1;j<strlen(argv[i]);j++)
+        if(argv[i][j]=='v')
+          VERBOSE++;
+        else
+          done=1;
+    } else if(!strncmp(argv[i],"--",2) && (val=strchr(argv[i],'='))!=NULL) {
+      val++;
+      if(!strncmp(argv[i]+2,"datadir=",8))
+        done=(done || snprintf(DATADIR,BUFFERLENGTH,"%s",val)>=BUFFERLENGTH);
+      else if(!strncmp(argv[i]+2,"json=",5))
+        done=(done || snprintf(opt->json,BUFFERLENGTH,"%s",val)>=BUFFERLENGTH);
+      else if(!strncmp(argv[i]+2,"Nx=",3))
+        opt->Nx=atoi(val);
+      else if(!strncmp(argv[i]+2,"Ny=",3))
+        opt->Ny=atoi(val);
+      else if(!strncmp(argv[i]+2,"Nkmax=",6))
+        opt->Nkmax=atoi(val);
+      else if(!strncmp(argv[i]+2,"maxfaces=",9))
+        opt->maxfaces=atoi(val);
+      else if(!strncmp(argv[i]+2,"reps=",5))
+        opt->reps=atoi(val);
+      else if(!strncmp(argv[i]+2,"iters=",6))
+        opt->iters=atoi(val);
+      else if(!strncmp(argv[i]+2,"warmup=",7))
+        opt->warmup=atoi(val);
+      else if(!strncmp(argv[i]+2,"subgrid=",8))
+        opt->subgrid=atoi(val);
+      else if(!strncmp(argv[i]+2,"qmixed=",7))
+        opt->qmixed=atoi(val);
+      else
+        done=1;
+    } else
+      done=1;
+  }
+  BenchPath(DATAFILE,DEFAULTDATAFILE,"ParseBenchFlags",myproc);
+  if(!opt->json[0])
+    BenchPath(opt->json,DEFAULTBENCHFILE,"ParseBenchFlags",myproc);
+  done=(done || snprintf(opt->jsontmp,BUFFERLENGTH,"%s.tmp",opt->json)>=BUFFERLENGTH);
+
+  if(opt->Nx<1 || opt->Ny<1 || opt->Nkmax<1 || opt->maxfaces<3 || opt->reps<1 || opt->iters<1 || opt->warmup<1)
+    done=1;
+
+  if(done) {
+    if(myproc==0) {
+      printf("Usage: %s [-v] [--datadir=dir] [--Nx=n] [--Ny=n] [--Nkmax=n] [--maxfaces=n]\n",argv[0]);
+      printf("       [--reps=n] [--iters=n] [--warmup=n] [--subgrid=0|1] [--qmixed=0|1] [--json=file]\n");
+    }
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+}
+
+/*
+ * Function: BenchPath
+ * Usage: BenchPath(str,"points.dat","WriteBenchGrid",myproc);
+ * -----------------------------------------------------------
+ * Set str to DATADIR/name, which must fit in BUFFERLENGTH characters.
+ *
+ */
+static void BenchPath(char *str, char *name, char *function, int myproc)
+{
+  if(snprintf(str,BUFFERLENGTH,"%s/%s",DATADIR,name)>=BUFFERLENGTH) {
+    if(myproc==0) printf("Error in %s: the path of %s is longer than %d characters.\n",function,name,BUFFERLENGTH-1);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+}
+
+/*
+ * Function: WriteBenchGrid
+ * Usage: WriteBenchGrid(opt,myproc);
+ * ----------------------------------
+ * Write a rectangular grid of Nx by Ny quadrilaterals, or of 2*Nx*Ny
+ * equilateral triangles in a parallelogram, with closed boundaries.  The
+ * depth increases linearly in x so that the number of layers varies.
+ *
+ */
+static void WriteBenchGrid(benchoptT *opt, int myproc)
+{
+  int i, j, n, nf, m, p1, p2, Np, Nc, Ne, nfaces, *cells, *grad, *edges, *padj, *eadj, *neigh;
+  REAL dy, *xp, *yp, xv, yv;
+  char str[BUFFERLENGTH];
+  FILE *ofile;
+
+  nfaces = opt->maxfaces==3?3:4;
+  Np = (opt->Nx+1)*(opt->Ny+1);
+  Nc = nfaces==3?2*opt->Nx*opt->Ny:opt->Nx*opt->Ny;
+  dy = nfaces==3?BENCHDX*sqrt(3.0)/2:BENCHDX;
+
+  xp = (REAL *)SunMalloc(Np*sizeof(REAL),"WriteBenchGrid");
+  yp = (REAL *)SunMalloc(Np*sizeof(REAL),"WriteBenchGrid");
+  cells = (int *)SunMalloc(nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  neigh = (int *)SunMalloc(nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  edges = (int *)SunMalloc(2*nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  grad = (int *)SunMalloc(2*nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  padj = (int *)SunMalloc(MAXPOINTEDGES*Np*sizeof(int),"WriteBenchGrid");
+  eadj = (int *)SunMalloc(MAXPOINTEDGES*Np*sizeof(int),"WriteBenchGrid");
+
+  // Points, with every other row shifted by dx/2 for the triangles
+  for(j=0;j<=opt->Ny;j++)
+    for(i=0;i<=opt->Nx;i++) {
+      n = j*(opt->Nx+1)+i;
+      xp[n]=BENCHDX*i+(nfaces==3 && j%2?0.5*BENCHDX:0);
+      yp[n]=dy*j;
+    }
+
+  // Cells with counter-clockwise points
+  n=0;
+  for(j=0;j<opt->Ny;j++)
+    for(i=0;i<opt->Nx;i++) {
+      p1 = j*(opt->Nx+1)+i;
+      p2 = p1+opt->Nx+1;
+      if(nfaces==4) {
+        cells[4*n]=p1;
+        cells[4*n+1]=p1+1;
+        cells[4*n+2]=p2+1;
+        cells[4*n+3]=p2;
+        n++;
+      } else if(j%2==0) {
+        cells[3*n]=p1;
+        cells[3*n+1]=p1+1;
+        cells[3*n+2]=p2;
+        n++;
+        cells[3*n]=p1+1;
+        cells[3*n+1]=p2+1;
+        cells[3*n+2]=p2;
+        n++;
+      } else {
+        cells[3*n]=p1;
+        cells[3*n+1]=p2+1;
+        cells[3*n+2]=p2;
+        n++;
+        cells[3*n]=p1;
+        cells[3*n+1]=p1+1;
+        cells[3*n+2]=p2+1;
+        n++;
+      }
+    }
+
+  // Edges from the faces of the cells, found with the edges of each point
+  for(n=0;n<MAXPOINTEDGES*Np;n++)
+    padj[n]=-1;
+  Ne=0;
+  for(n=0;n<Nc;n++)
+    for(nf=0;nf<nfaces;nf++) {
+      p1 = Min(cells[nfaces*n+nf],cells[nfaces*n+(nf+1)%nfaces]);
+      p2 = Max(cells[nfaces*n+nf],cells[nfaces*n+(nf+1)%nfaces]);
+      for(m=0;m<MAXPOINTEDGES && padj[MAXPOINTEDGES*p1+m]!=-1;m++)
+        if(padj[MAXPOINTEDGES*p1+m]==p2)
+          break;
+      if(m<MAXPOINTEDGES && padj[MAXPOINTEDGES*p1+m]==p2)
+        grad[2*eadj[MAXPOINTEDGES*p1+m]+1]=n;
+      else {
+        padj[MAXPOINTEDGES*p1+m]=p2;
+        eadj[MAXPOINTEDGES*p1+m]=Ne;
+        edges[2*Ne]=p1;
+        edges[2*Ne+1]=p2;
+        grad[2*Ne]=n;
+        grad[2*Ne+1]=-1;
+        Ne++;
+      }
+    }
+
+  // Neighbor across each face
+  for(n=0;n<nfaces*Nc;n++)
+    neigh[n]=-1;
+  for(n=0;n<Ne;n++)
+    if(grad[2*n+1]!=-1)
+      for(m=0;m<2;m++)
+        for(nf=0;nf<nfaces;nf++)
+          if(neigh[nfaces*grad[2*n+m]+nf]==-1) {
+            neigh[nfaces*grad[2*n+m]+nf]=grad[2*n+1-m];
+            break;
+          }
+
+  BenchPath(str,"points.dat","WriteBenchGrid",myproc);
+  ofile = MPI_FOpen(str,"w","WriteBenchGrid",myproc);
+  for(n=0;n<Np;n++)
+    fprintf(ofile,"%.10e %.10e 0\n",xp[n],yp[n]);
+  fclose(ofile);
+
+  BenchPath(str,"edges.dat","WriteBenchGrid",myproc);
+  ofile = MPI_FOpen(str,"w","WriteBenchGrid",myproc);
+  for(n=0;n<Ne;n++)
+    fprintf(ofile,"%d %d %d %d %d\n",edges[2*n],edges[2*n+1],grad[2*n+1]==-1?1:0,grad[2*n],grad[2*n+1]);
+  fclose(ofile);
+
+  BenchPath(str,"cells.dat","WriteBenchGrid",myproc);
+  ofile = MPI_FOpen(str,"w","WriteBenchGrid",myproc);
+  for(n=0;n<Nc;n++) {
+    xv=yv=0;
+    for(nf=0;nf<nfaces;nf++) {
+      xv+=xp[cells[nfaces*n+nf]]/nfaces;
+      yv+=yp[cells[nfaces*n+nf]]/nfaces;
+    }
+    fprintf(ofile,"%d %.10e %.10e",nfaces,xv,yv);
+    for(nf=0;nf<nfaces;nf++)
+      fprintf(ofile," %d",cells[nfaces*n+nf]);
+    for(nf=0;nf<nfaces;nf++)
+      fprintf(ofile," %d",neigh[nfaces*n+nf]);
+    fprintf(ofile,"\n");
+  }
+  fclose(ofile);
+
+  BenchPath(str,"depth.dat-voro","WriteBenchGrid",myproc);
+  ofile = MPI_FOpen(str,"w","WriteBenchGrid",myproc);
+  for(n=0;n<Nc;n++) {
+    xv=yv=0;
+    for(nf=0;nf<nfaces;nf++) {
+      xv+=xp[cells[nfaces*n+nf]]/nfaces;
+      yv+=yp[cells[nfaces*n+nf]]/nfaces;
+    }
+    fprintf(ofile,"%.10e %.10e %.10e\n",xv,yv,BENCHDEPTH*(1+xv/(BENCHDX*(opt->Nx+1))));
+  }
+  fclose(ofile);
+
+  SunFree(xp,Np*sizeof(REAL),"WriteBenchGrid");
+  SunFree(yp,Np*sizeof(REAL),"WriteBenchGrid");
+  SunFree(cells,nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  SunFree(neigh,nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  SunFree(edges,2*nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  SunFree(grad,2*nfaces*Nc*sizeof(int),"WriteBenchGrid");
+  SunFree(padj,MAXPOINTEDGES*Np*sizeof(int),"WriteBenchGrid");
+  SunFree(eadj,MAXPOINTEDGES*Np*sizeof(int),"WriteBenchGrid");
+}
+
+/*
+ * Function: WriteBenchData
+ * Usage: WriteBenchData(opt,myproc);
+ * ----------------------------------
+ * Write suntans.dat for a stratified, nonhydrostatic run with the MY2.5
+ * turbulence model and TVD advection of salinity.  The conjugate-gradient
+ * tolerances are set so small that the solvers run for exactly iters
+ * iterations, and no output is written during the spin up.  Every other
+ * value takes its default from defaults.h.
+ *
+ */
+static void WriteBenchData(benchoptT *opt, int myproc)
+{
+  int n;
+  char *data[] = {
+    "vertcoord 1", "IntDepth 2", "stairstep 0", "rstretch 1", "CorrectVoronoi 0",
+    "VoronoiRatio 0", "dt 10", "theta 0.55", "beta 1", "gamma 0", "nu 1e-6",
+    "nu_H 0", "kappa_s 0", "kappa_sH 0", "CdB 0.0025", "z0B 0.001", "turbmodel 1",
+    "nonlinear 2", "TVDsalt 4", "nonhydrostatic 1", "cgsolver 1", "qprecond 2",
+    "epsilon 1e-300", "qepsilon 1e-300", "resnorm 0", "relax 1", "amp 0.01",
+    "mergeArrays 0", "outputNetcdf 0", "ntprog 0", "vertgridcorrect 0",
+    "dzsmall 0.1", "scaledepth 0", "scaledepthfactor 0", "thetaramptime 0",
+    "thetaS 0.55", "thetaB 0.55", "kappa_T 0", "kappa_TH 0", "tau_T 0", "z0T 0",
+    "CdT 0", "CdW 0", "Cmax 10", "starttime 20000101.000000",
+    "basetime 20000101.000000", "nstepsperncfile 1000", "ncfilectr 0",
+    "outputNetcdfFile bench.nc", "omega 1.4026e-4", "flux 0", "timescale 0",
+    "volcheck 0", "masscheck 0", "newcells 0", "wetdry 0", "Coriolis_f 1e-4",
+    "sponge_distance 0", "sponge_decay 0", "readSalinity 0", "readTemperature 0",
+    "pslg oned.dat", "points points.dat", "edges edges.dat", "cells cells.dat",
+    "depth depth.dat", "nodes nodes.dat", "celldata celldata.dat",
+    "edgedata edgedata.dat", "vertspace vertspace.dat", "topology topology.dat",
+    "FreeSurfaceFile fs.dat", "HorizontalVelocityFile u.dat",
+    "VerticalVelocityFile w.dat", "SalinityFile s.dat", "BGSalinityFile s0.dat",
+    "TemperatureFile T.dat", "PressureFile q.dat", "VerticalGridFile g.dat",
+    "ConserveFile e.dat", "ProgressFile step.dat", "StoreFile store.dat",
+    "StartFile start.dat", "EddyViscosityFile nut.dat",
+    "ScalarDiffusivityFile kappat.dat", "InitSalinityFile sinit.dat",
+    "InitTemperatureFile Tinit.dat", "ProfileVariables none",
+    "DataLocations dataxy.dat", "ProfileDataFile profdata.dat", "ntoutProfs 0",
+    "NkmaxProfs 0", "numInterpPoints 1", NULL
+  };
+  char *subgriddata[] = {
+    "subgrid 1", "segN 1", "disN 50", "subgridmeth 1", "subgriddpint 0",
+    "subgriddzfmeth 1", "subgrideps 1e-3", "subgriddragpara 0", "subgridhmarshint 0",
+    "subgridcdvint 0", "subgriderosionpara 0", "subgriddelta 0", "depthelev 0",
+    "AcprofFile acprof.dat", "AeffFile subAeff.dat", "AsediFile subAsedi.dat",
+    "FluxhprofFile fluxhprof.dat", "HprofFile hprof.dat", "HprofeFile hprofe.dat",
+    "VeffFile subVeff.dat", "VprofFile vprof.dat", "VsediFile subVsedi.dat",
+    "WetperiprofFile wetperiprof.dat", "cellpFile subcellp.dat",
+    "subDepositionFile subDeposition.dat", "subErosionFile subErosion.dat",
+    "subcdvFile subcdv.dat", "subcdveFile subcdve.dat", "subdmaxFile subdmax.dat",
+    "subpointFile subpoint.dat", "subpointeFile subpointe.dat",
+    "subhmarshFile subhmarsh.dat", "subhmarsheFile subhmarshe.dat", NULL
+  };
+  FILE *ofile = MPI_FOpen(DATAFILE,"w","WriteBenchData",myproc);
+
+  // GetValue needs text after the value, so every line ends with a comment
+  fprintf(ofile,"# suntans.dat written by sunbench\n");
+  for(n=0;data[n]!=NULL;n++)
+    fprintf(ofile,"%s\t# \n",data[n]);
+  if(opt->subgrid)
+    for(n=0;subgriddata[n]!=NULL;n++)
+      fprintf(ofile,"%s\t# \n",subgriddata[n]);
+  fprintf(ofile,"Nkmax %d\t# \nmaxFaces %d\t# \nnsteps %d\t# \n",opt->Nkmax,opt->maxfaces,opt->warmup);
+  fprintf(ofile,"maxiters %d\t# \nqmaxiters %d\t# \n",opt->iters,opt->iters);
+  fprintf(ofile,"qmixed %d\t# \n",opt->qmixed);
+  fprintf(ofile,"ntout %d\t# \nntconserve %d\t# \n",opt->warmup+1,opt->warmup+1);
+  fclose(ofile);
+}
+
+/*
+ * Function: BenchAvailable
+ * Usage: if(BenchAvailable(b,opt,prop)) ...
+ * -----------------------------------------
+ * Returns 1 if kernel b applies to this configuration.
+ *
+ */
+static int BenchAvailable(int b, benchoptT *opt, propT *prop)
+{
+  switch(b) {
+    case BCGSOLVEQ:
+      return prop->nonhydrostatic;
+    case BMY25:
+      return prop->turbmodel==1;
+    case BQUAD:
+      return opt->maxfaces==3;
+    case BSUBVEFF:
+    case BSUBACEFF:
+    case BSUBFLUXHEIGHT:
+      return prop->subgrid;
+    default:
+      return 1;
+  }
+}
+
+/*
+ * Function: RunBench
+ * Usage: RunBench(b,grid,phys,prop,myproc,numprocs,comm);
+ * -----------------------------------------------------------------
+ * Run kernel b once.
+ *
+ */
+static void RunBench(int b, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs,
+    MPI_Comm comm)
+{
+  switch(b) {
+    case BHCOEFFICIENTS:
+      RunKernel(KERNELHCOEFFICIENTS,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BOPERATORH:
+      RunKernel(KERNELOPERATORH,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BCGSOLVE:
+      RunKernel(KERNELCGSOLVE,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BCGSOLVEQ:
+      RunKernel(KERNELCGSOLVEQ,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BHORIZONTALSOURCE:
+      RunKernel(KERNELHORIZONTALSOURCE,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BUPDATESCALARS:
+      RunKernel(KERNELUPDATESCALARS,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BMY25:
+      RunKernel(KERNELEDDYVISCOSITY,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case BPEROT:
+      ComputeUC(phys->uc,phys->vc,phys,grid,myproc,PEROT,prop->kinterp,prop->subgrid);
+      break;
+    case BLSQ:
+      ComputeUC(phys->uc,phys->vc,phys,grid,myproc,LSQ,prop->kinterp,prop->subgrid);
+      break;
+    case BQUAD:
+      ComputeUC(phys->uc,phys->vc,phys,grid,myproc,QUAD,prop->kinterp,prop->subgrid);
+      break;
+    case BCELL2D:
+      ISendRecvCellData2D(phys->h,grid,myproc,comm);
+      break;
+    case BCELL3D:
+      ISendRecvCellData3D(phys->s,grid,myproc,comm);
+      break;
+    case BEDGE3D:
+      ISendRecvEdgeData3D(phys->u,grid,myproc,comm);
+      break;
+    case BSUBVEFF:
+      UpdateSubgridVeff(grid,phys,prop,myproc);
+      break;
+    case BSUBACEFF:
+      UpdateSubgridAceff(grid,phys,prop,myproc);
+      break;
+    case BSUBFLUXHEIGHT:
+      UpdateSubgridFluxHeight(grid,phys,prop,myproc);
+      break;
+    default:
+      break;
+  }
+}
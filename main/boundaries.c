@@ -15,6 +15,7 @@
 #include "sediments.h"
 #include "wave.h"
 #include "subgrid.h"
+#include "tides.h"
 // Local functions
 //static void GetBoundaryVelocity(REAL *ub, int *forced, REAL x, REAL y, REAL t, REAL h, REAL d, REAL omega, REAL amp);
 //static void SetUVWH(gridT *grid, physT *phys, propT *prop, int ib, int j, int boundary_index, REAL boundary_flag);
@@ -23,7 +24,7 @@ static void MatchBndPoints(propT *prop, gridT *grid, int myproc);
 static void FluxtoUV(propT *prop, gridT *grid, int myproc,MPI_Comm comm);
 static void SegmentArea(propT *prop, gridT *grid, int myproc, MPI_Comm comm);
 int isGhostEdge(int j, gridT *grid, int myproc);
-int getTimeRecBnd(REAL nctime, REAL *time, int nt);
+int getTimeRecBnd(DREAL nctime, DREAL *time, int nt);
 
 /*
  * Function: OpenBoundaryFluxes
@@ -193,7 +194,8 @@ void BoundaryVelocities(gridT *grid, physT *phys, propT *prop, int myproc, MPI_C
        UpdateBdyNC(prop,grid,myproc,comm);
        // Wait for all processors
        MPI_Barrier(comm);
-   }
+   }else if(prop->tideforcing)
+       UpdateTideForcing(prop);
 
   // Type-2
   if(prop->netcdfBdy){
@@ -212,6 +214,17 @@ void BoundaryVelocities(gridT *grid, physT *phys, propT *prop, int myproc, MPI_C
      // printf("bound->boundary_u[k][bound->ind2[ii]]=%f\n",bound->boundary_u[k][bound->ind2[ii]]);
     }
   }
+  }else if(prop->tideforcing){ // Tidal forcing (tides.c)
+      for(jptr=grid->edgedist[2];jptr<grid->edgedist[3];jptr++) {
+	jind = jptr-grid->edgedist[2];
+	j = grid->edgep[jptr];
+	TideForcing(jind,&h,&u,&v);
+	for(k=grid->etop[j];k<grid->Nke[j];k++) {
+	    phys->boundary_u[jind][k]=u*rampfac;
+	    phys->boundary_v[jind][k]=v*rampfac;
+	    phys->boundary_w[jind][k]=0;
+	}
+      }
   }else{ // No NetCDF
       for(jptr=grid->edgedist[2];jptr<grid->edgedist[3];jptr++) {
 	jind = jptr-grid->edgedist[2];
@@ -232,6 +245,12 @@ void BoundaryVelocities(gridT *grid, physT *phys, propT *prop, int myproc, MPI_C
 	ii+=1;
 	phys->h[i]=bound->h[bound->ind3[ii]]*rampfac;
       }
+  }else if(prop->tideforcing){ // Tidal forcing (tides.c), after the type-2 edges
+      for(iptr=grid->celldist[1];iptr<grid->celldist[2];iptr++) {
+	i = grid->cellp[iptr];
+	TideForcing(grid->edgedist[3]-grid->edgedist[2]+iptr-grid->celldist[1],&h,&u,&v);
+	phys->h[i]=h*rampfac;
+      }
   }else{ // No NetCDF
      for(iptr=grid->celldist[1];iptr<grid->celldist[2];iptr++) {
 	i = grid->cellp[iptr];
@@ -254,6 +273,15 @@ void BoundaryVelocities(gridT *grid, physT *phys, propT *prop, int myproc, MPI_C
 	  //phys->wc[i][k]=bound->wc[k][bound->ind3[ii]]*rampfac;
 	}
       }
+  }else if(prop->tideforcing){
+      for(iptr=grid->celldist[1];iptr<grid->celldist[2];iptr++) {
+	i = grid->cellp[iptr];
+	TideForcing(grid->edgedist[3]-grid->edgedist[2]+iptr-grid->celldist[1],&h,&u,&v);
+	for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+	  phys->uc[i][k]=u*rampfac;
+	  phys->vc[i][k]=v*rampfac;
+	}
+      }
   }else{//No NetCDF
       for(iptr=grid->celldist[1];iptr<grid->celldist[2];iptr++) {
 	i = grid->cellp[iptr];
@@ -529,8 +557,8 @@ static void SegmentArea(propT *prop, gridT *grid, int myproc, MPI_Comm comm){
     }
 
     //Sum the area across processors
-    MPI_Reduce(bound->localsegarea, bound->segarea,(int)bound->Nseg, MPI_DOUBLE, MPI_SUM, 0,comm);
-    MPI_Bcast(bound->segarea,(int)bound->Nseg, MPI_DOUBLE,0,comm);
+    MPI_Reduce(bound->localsegarea, bound->segarea,(int)bound->Nseg, MPI_REALTYPE, MPI_SUM, 0,comm);
+    MPI_Bcast(bound->segarea,(int)bound->Nseg, MPI_REALTYPE,0,comm);
 
 }//End function SegmentArea()
 
@@ -801,7 +829,7 @@ void AllocateBoundaryData(propT *prop, gridT *grid, boundT **bound, int myproc,
 
     }//endif
 
-    (*bound)->time = (REAL *)SunMalloc(Nt*sizeof(REAL),"AllocateBoundaryData");
+    (*bound)->time = (DREAL *)SunMalloc(Nt*sizeof(DREAL),"AllocateBoundaryData");
     (*bound)->z = (REAL *)SunMalloc(Nk*sizeof(REAL),"AllocateBoundaryData");
 
     // Zero the boundary arrays
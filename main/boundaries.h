@@ -59,7 +59,7 @@ typedef struct _boundT{
   REAL *xv;
   REAL *yv;
   REAL *z;
-  REAL *time;	
+  DREAL *time;	
   REAL *segarea;
   REAL *localsegarea;
 
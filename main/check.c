@@ -19,77 +19,280 @@
 #define DASHES "----------------------------------------------------------------------\n"
 #define CMAXSUGGEST 0.5
 
+// Checks of this processor for the current time step
+static checkT checks;
+
+static void ResetChecks(void);
+static int LocalBlowup(propT *prop);
+static void ReportBlowup(gridT *grid, physT *phys, propT *prop, int myproc);
+
+/*
+ * Function: CheckBegin
+ * Usage: CheckBegin(prop);
+ * ------------------------
+ * Decide whether the current time step is checked and reset the checks.
+ * Steps are checked every checkinterval steps and on the last step, and the
+ * CmaxU and CmaxW printed with the progress are from the last checked step.
+ *
+ */
+void CheckBegin(propT *prop)
+{
+  checks.active = (prop->checkinterval<=1 || !(prop->n%prop->checkinterval) ||
+		   prop->n==prop->nstart+prop->nsteps);
+  checks.pending = 0;
+  ResetChecks();
+}
+
+/*
+ * Function: CheckActive
+ * Usage: if(CheckActive()) {...}
+ * ------------------------------
+ * Returns 1 if the current time step is checked.
+ *
+ */
+int CheckActive(void)
+{
+  return checks.active;
+}
+
+/*
+ * Function: CheckFreeSurface
+ * Usage: CheckFreeSurface(phys,i);
+ * --------------------------------
+ * Check the free surface of cell i for NaNs (checkmode=1).
+ *
+ */
+void CheckFreeSurface(physT *phys, int i)
+{
+  if(!checks.active)
+    return;
+
+  if(phys->h[i]!=phys->h[i] && checks.hflag) {
+    checks.hflag=0;
+    checks.ih=i;
+  }
+}
+
+/*
+ * Function: CheckEdgeColumn
+ * Usage: CheckEdgeColumn(grid,phys,prop,j);
+ * -----------------------------------------
+ * Check the velocity at edge j for NaNs and update the maximum horizontal
+ * Courant number (checkmode=1).
+ *
+ */
+void CheckEdgeColumn(gridT *grid, physT *phys, propT *prop, int j)
+{
+  int k;
+  REAL C, *u=phys->u[j];
+
+  if(!checks.active)
+    return;
+
+  for(k=grid->etop[j];k<grid->Nke[j];k++) {
+    if(u[k]!=u[k] && checks.uflag) {
+      checks.uflag=0;
+      checks.iu=j;
+      checks.ku=k;
+    }
+    C = fabs(u[k])*prop->dt/grid->dg[j];
+    if(C>checks.CmaxU) {
+      checks.icu = j;
+      checks.kcu = k;
+      checks.CmaxU = C;
+    }
+  }
+}
+
+/*
+ * Function: CheckCellColumn
+ * Usage: CheckCellColumn(grid,phys,prop,phys->w,i);
+ * -------------------------------------------------
+ * Check the vertical velocity w in cell i for NaNs and update the maximum
+ * vertical Courant number (checkmode=1).
+ *
+ */
+void CheckCellColumn(gridT *grid, physT *phys, propT *prop, REAL **w, int i)
+{
+  int k;
+  REAL C;
+
+  if(!checks.active)
+    return;
+
+  for(k=0;k<grid->Nk[i];k++)
+    if(w[i][k]!=w[i][k] && checks.wflag) {
+      checks.wflag=0;
+      checks.iw=i;
+      checks.kw=k;
+    }
+
+  if((grid->dv[i]+phys->h[i])<BUFFERHEIGHT)
+    return;
+  for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+    C = 0.5*fabs(w[i][k]+w[i][k+1])*prop->dt/grid->dzz[i][k];
+    if(C>checks.CmaxW && grid->dzz[i][k]>=BUFFERHEIGHT) {
+      checks.icw = i;
+      checks.kcw = k;
+      checks.CmaxW = C;
+    }
+  }
+}
+
+/*
+ * Function: CheckScalarColumn
+ * Usage: CheckScalarColumn(grid,phys->s,i);
+ * -----------------------------------------
+ * Check the scalar in cell i for NaNs (checkmode=1).
+ *
+ */
+void CheckScalarColumn(gridT *grid, REAL **scal, int i)
+{
+  int k;
+
+  if(!checks.active || !checks.sflag)
+    return;
+
+  for(k=0;k<grid->Nk[i];k++)
+    if(scal[i][k]!=scal[i][k]) {
+      checks.sflag=0;
+      checks.is=i;
+      checks.ks=k;
+      break;
+    }
+}
+
+/*
+ * Function: CheckReduce
+ * Usage: CheckReduce(grid,phys,prop,comm);
+ * ----------------------------------------
+ * Post the reduction of the checks accumulated by the kernels (checkmode=1),
+ * which is completed by Check so that it overlaps the work in between.  The
+ * prescribed velocities at the type 2 boundary edges and, for vertcoord!=1,
+ * the vertical velocity which is not computed by Continuity are checked here.
+ *
+ */
+void CheckReduce(gridT *grid, physT *phys, propT *prop, MPI_Comm comm)
+{
+  int i, iptr, jptr;
+
+  if(!prop->checkmode || !checks.active)
+    return;
+
+  for(jptr=grid->edgedist[1];jptr<grid->edgedist[2];jptr++)
+    CheckEdgeColumn(grid,phys,prop,grid->edgep[jptr]);
+
+  if(prop->vertcoord!=1)
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+      CheckCellColumn(grid,phys,prop,phys->w,i);
+    }
+
+  checks.mine[0] = (REAL)LocalBlowup(prop);
+  checks.mine[1] = checks.CmaxU;
+  checks.mine[2] = checks.CmaxW;
+  MPI_Iallreduce(checks.mine,checks.all,3,MPI_REALTYPE,MPI_MAX,comm,&(checks.request));
+  checks.pending = 1;
+}
+
 /*
  * Function: Check
  * Usage: Check(grid,phys,prop,myproc,numprocs,comm);
  * --------------------------------------------------
- * Check to make sure the run isn't blowing up.
+ * Check to make sure the run isn't blowing up.  With checkmode=0 the fields
+ * are scanned here, and with checkmode=1 the reduction posted by CheckReduce
+ * is completed.
  *
- */    
+ */
 int Check(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm)
 {
-  int i, k, icu, kcu, icw, kcw, Nc=grid->Nc, Ne=grid->Ne, ih, is, ks, iu, ku, iw, kw, nc1, nc2,dry;
-  int uflag=1, wflag=1, sflag=1, hflag=1, myalldone, alldone, progout;
-  REAL C, CmaxU, CmaxW, allCmaxU, allCmaxW, dtsuggestU, dtsuggestW;
+  int i, k, n, Nc=grid->Nc, dry;
+  int myalldone, alldone, progout;
+  REAL C, allCmaxU=prop->CmaxU, allCmaxW=prop->CmaxW;
+
+  if(!checks.active)
+    return 0;
+
+  if(prop->checkmode) {
+    if(!checks.pending)
+      return 0;
+    MPI_Wait(&(checks.request),MPI_STATUS_IGNORE);
+    checks.pending=0;
+
+    prop->CmaxU = checks.all[1];
+    prop->CmaxW = checks.all[2];
+    if(checks.all[0]==0)
+      return 0;
+
+    if(LocalBlowup(prop))
+      ReportBlowup(grid,phys,prop,myproc);
+    return 1;
+  }
 
-  icu=kcu=icw=kcw=ih=is=ks=iu=ku=iw=kw=0;
+  ResetChecks();
 
-  for(i=0;i<Nc;i++) 
+  for(i=0;i<Nc;i++)
     if(phys->h[i]!=phys->h[i]) {
-      hflag=0;
-      ih=i;
+      checks.hflag=0;
+      checks.ih=i;
       break;
     }
 
-  for(i=0;i<Nc;i++) {
+  // The isolated dry columns are frozen with activelists=1, so only the
+  // active cells and edges are scanned (see UpdateActiveLists in phys.c)
+  for(n=0;n<phys->Ncwet;n++) {
+    i=phys->wetcells[n];
     for(k=0;k<grid->Nk[i];k++)
       if(phys->s[i][k]!=phys->s[i][k]) {
-        sflag=0;
-        is=i;
-        ks=k;
+        checks.sflag=0;
+        checks.is=i;
+        checks.ks=k;
         break;
       }
-    if(!sflag)
+    if(!checks.sflag)
       break;
   }
 
-  for(i=0;i<Ne;i++) {
+  for(n=0;n<phys->Newet;n++) {
+    i=phys->wetedges[n];
     for(k=0;k<grid->Nke[i];k++)
       if(phys->u[i][k]!=phys->u[i][k]) {
-        uflag=0;
-        iu=i;
-        ku=k;
+        checks.uflag=0;
+        checks.iu=i;
+        checks.ku=k;
         break;
       }
-    if(!uflag)
+    if(!checks.uflag)
       break;
   }
 
-  for(i=0;i<Nc;i++) {
+  for(n=0;n<phys->Ncwet;n++) {
+    i=phys->wetcells[n];
     for(k=0;k<grid->Nk[i];k++)
       if(phys->w[i][k]!=phys->w[i][k]) {
-        wflag=0;
-        iw=i;
-        kw=k;
+        checks.wflag=0;
+        checks.iw=i;
+        checks.kw=k;
         break;
       }
-    if(!wflag)
+    if(!checks.wflag)
       break;
   }
 
-  CmaxU=0;
-  for(i=0;i<Ne;i++) 
+  for(n=0;n<phys->Newet;n++) {
+    i=phys->wetedges[n];
     for(k=grid->etop[i];k<grid->Nke[i];k++) {
       C = fabs(phys->u[i][k])*prop->dt/grid->dg[i];
-      if(C>CmaxU) {
-        icu = i;
-        kcu = k;
-        CmaxU = C;
+      if(C>checks.CmaxU) {
+        checks.icu = i;
+        checks.kcu = k;
+        checks.CmaxU = C;
       }
     }
+  }
 
   /*CmaxU=0;
-  for(i=0;i<Ne;i++) 
+  for(i=0;i<Ne;i++)
   {
     dry=0;
     nc1=grid->grad[2*i];
@@ -110,108 +313,161 @@ int Check(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_C
     }
   }*/
 
-  CmaxW=0;
-  for(i=0;i<Nc;i++) 
+  for(n=0;n<phys->Ncwet;n++) {
+    i=phys->wetcells[n];
     for(k=grid->ctop[i];k<grid->Nk[i];k++) {
       C = 0.5*fabs(phys->w[i][k]+phys->w[i][k+1])*prop->dt/grid->dzz[i][k];
-      if(C>CmaxW && (grid->dv[i]+phys->h[i])>=BUFFERHEIGHT && grid->dzz[i][k]>=BUFFERHEIGHT) {
-        icw = i;
-        kcw = k;
-        CmaxW = C;
+      if(C>checks.CmaxW && (grid->dv[i]+phys->h[i])>=BUFFERHEIGHT && grid->dzz[i][k]>=BUFFERHEIGHT) {
+        checks.icw = i;
+        checks.kcw = k;
+        checks.CmaxW = C;
       }
     }
+  }
 
+  // The adaptive time step needs the Courant numbers on all processors
   progout = (int)(prop->nsteps*(double)prop->ntprog/100);
-  if(progout>0 && !(prop->n%progout)) {
-    MPI_Reduce(&CmaxU,&allCmaxU,1,MPI_DOUBLE,MPI_MAX,0,comm);
-    MPI_Reduce(&CmaxW,&allCmaxW,1,MPI_DOUBLE,MPI_MAX,0,comm);
+  if(prop->adaptivedt) {
+    checks.mine[1] = checks.CmaxU;
+    checks.mine[2] = checks.CmaxW;
+    MPI_Reduce(&(checks.mine[1]),&(checks.all[1]),2,MPI_REALTYPE,MPI_MAX,0,comm);
+    MPI_Bcast(&(checks.all[1]),2,MPI_REALTYPE,0,comm);
+    allCmaxU = checks.all[1];
+    allCmaxW = checks.all[2];
+  } else if(progout>0 && !(prop->n%progout)) {
+    MPI_Reduce(&(checks.CmaxU),&allCmaxU,1,MPI_REALTYPE,MPI_MAX,0,comm);
+    MPI_Reduce(&(checks.CmaxW),&allCmaxW,1,MPI_REALTYPE,MPI_MAX,0,comm);
   }
 
-  if(myproc==0) {
+  if(myproc==0 || prop->adaptivedt) {
     prop->CmaxU = allCmaxU;
     prop->CmaxW = allCmaxW;
   }
 
   myalldone=0;
-  if(!uflag || !wflag || !sflag || !hflag || CmaxU>prop->Cmax || (prop->thetaM<0.5 && CmaxW>prop->Cmax)) {
-    printf(DASHES);
-    printf("Time step %d: Processor %d, Run is blowing up!\n",prop->n,myproc);
-
-    if(CmaxU>prop->Cmax) {
-      nc1 = grid->grad[2*icu];
-      nc2 = grid->grad[2*icu+1];
-      if(nc1==-1) nc1=nc2;
-      if(nc2==-1) nc2=nc1;
-
-      dtsuggestU = CMAXSUGGEST*grid->dg[icu]/fabs(phys->u[icu][kcu]);
-
-      printf("Horizontal Courant number problems:\n");
-      printf("  Grid indices: j=%d k=%d (Nke=%d)\n", icu, kcu, grid->Nke[icu]);
-      printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xe[icu],grid->ye[icu],
-          0.5*(DepthFromDZ(grid,phys,grid->grad[2*icu],kcu)+
-            DepthFromDZ(grid,phys,grid->grad[2*icu+1],kcu)));
-      printf("  Free-surface heights (on either side): %.3e, %.3e\n",phys->h[nc1],phys->h[nc2]);
-      printf("  Depths (on either side): %.3e, %.3e\n",grid->dv[nc1],grid->dv[nc2]);
-      printf("  Salinity (on either side): %.3e, %.3e\n",phys->s[nc1][kcu],phys->s[nc2][kcu]);
-      printf("  Flux-face height = %.3e, CdB = %.3e\n",grid->dzf[icu][kcu],phys->CdB[icu]);
-      printf("  Umax = %.3e\n",phys->u[icu][kcu]);
-      printf("  Horizontal grid spacing grid->dg[%d] = %.3e\n",icu,grid->dg[icu]);
-      printf("  Horizontal Courant number is CmaxU = %.2f.\n",CmaxU);
-      printf("  You specified a maximum of %.2f in suntans.dat\n",prop->Cmax);
-      printf("  Your time step size is %.2f.\n",prop->dt);
-      printf("  Reducing it to at most %.2f (For C=0.5) might solve this problem.\n",dtsuggestU);
-    }
+  if(LocalBlowup(prop)) {
+    ReportBlowup(grid,phys,prop,myproc);
+    myalldone=1;
+  }
 
-    if(!uflag) {
-      printf("Problem with U (U=NaN):\n");
-      printf("  Grid indices: j=%d k=%d (Nke=%d)\n", iu, ku, grid->Nke[iu]);
-      printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xe[iu],grid->ye[iu],
-          0.5*(DepthFromDZ(grid,phys,grid->grad[2*iu],ku)+
-            DepthFromDZ(grid,phys,grid->grad[2*iu+1],ku)));	
-    }
+  MPI_Reduce(&myalldone,&alldone,1,MPI_INT,MPI_SUM,0,comm);
+  MPI_Bcast(&alldone,1,MPI_INT,0,comm);
 
-    if(CmaxW>prop->Cmax && prop->thetaM<0.5) {
-      dtsuggestW = CMAXSUGGEST*grid->dzz[icw][kcw]/fabs(0.5*(phys->w[icw][kcw]+phys->w[icw][kcw]));
-
-      printf("Vertical Courant number problems:\n");
-      printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", icw, kcw, grid->Nkc[icw]);
-      printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xv[icw],grid->yv[icw],DepthFromDZ(grid,phys,icw,kcw));
-      printf("  Free-surface height: %.3e\n",phys->h[icw]);
-      printf("  Depth: %.3e\n",grid->dv[icw]);
-      printf("  Wmax = %.3e (located half-way between faces)\n",0.5*(phys->w[icw][kcw]+phys->w[icw][kcw+1]));
-      printf("  Vertical grid spacing dz = %.3e\n",grid->dzz[icw][kcw]);
-      printf("  Vertical Courant number is CmaxW = %.2f.\n",CmaxW);
-      printf("  You specified a maximum of %.2f in suntans.dat\n",prop->Cmax);
-      printf("  Your time step size is %.2f.\n",prop->dt);
-      printf("  Reducing it to at most %.2f (For C=0.5) might solve this problem.\n",dtsuggestW);
-    }
+  return alldone;
+}
 
-    if(!wflag) {
-      printf("Problem with W (W=NaN):\n");
-      printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", iw, kw, grid->Nkc[iw]);
-      printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xv[iw],grid->yv[iw],DepthFromDZ(grid,phys,iw,kw));
-    }
+/*
+ * Function: ResetChecks
+ * Usage: ResetChecks();
+ * ---------------------
+ * Reset the NaN flags and maximum Courant numbers of this processor.
+ *
+ */
+static void ResetChecks(void)
+{
+  checks.hflag=checks.uflag=checks.wflag=checks.sflag=1;
+  checks.ih=checks.iu=checks.ku=checks.iw=checks.kw=checks.is=checks.ks=0;
+  checks.icu=checks.kcu=checks.icw=checks.kcw=0;
+  checks.CmaxU=checks.CmaxW=0;
+}
 
-    if(!sflag) {
-      printf("Problem with the scalar s (s=NaN):\n");
-      printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", is, ks, grid->Nkc[is]);
-      printf("  Location: x=%.3e, y=%.3e, z=%.3e dv =%.3e h = %.3e\n",grid->xv[is],grid->yv[is],DepthFromDZ(grid,phys,is,ks),grid->dv[is],phys->h[is]);
-    }
+/*
+ * Function: LocalBlowup
+ * Usage: if(LocalBlowup(prop)) ...
+ * --------------------------------
+ * Returns 1 if a NaN was found or the Courant number exceeds Cmax on this processor.
+ *
+ */
+static int LocalBlowup(propT *prop)
+{
+  return (!checks.uflag || !checks.wflag || !checks.sflag || !checks.hflag ||
+	  checks.CmaxU>prop->Cmax || (prop->thetaM<0.5 && checks.CmaxW>prop->Cmax));
+}
 
-    if(!hflag) {
-      printf("Problem with the free surface (h=NaN):\n");
-      printf("  Grid index: i=%d\n", ih);
-      printf("  Location: x=%.3e, y=%.3e\n",grid->xv[ih],grid->yv[ih]);
-    }
-    printf(DASHES);
+/*
+ * Function: ReportBlowup
+ * Usage: ReportBlowup(grid,phys,prop,myproc);
+ * -------------------------------------------
+ * Print where and why the run is blowing up on this processor.
+ *
+ */
+static void ReportBlowup(gridT *grid, physT *phys, propT *prop, int myproc)
+{
+  int nc1, nc2;
+  int icu=checks.icu, kcu=checks.kcu, icw=checks.icw, kcw=checks.kcw, ih=checks.ih,
+    is=checks.is, ks=checks.ks, iu=checks.iu, ku=checks.ku, iw=checks.iw, kw=checks.kw;
+  REAL CmaxU=checks.CmaxU, CmaxW=checks.CmaxW, dtsuggestU, dtsuggestW;
+
+  printf(DASHES);
+  printf("Time step %d: Processor %d, Run is blowing up!\n",prop->n,myproc);
+
+  if(CmaxU>prop->Cmax) {
+    nc1 = grid->grad[2*icu];
+    nc2 = grid->grad[2*icu+1];
+    if(nc1==-1) nc1=nc2;
+    if(nc2==-1) nc2=nc1;
+
+    dtsuggestU = CMAXSUGGEST*grid->dg[icu]/fabs(phys->u[icu][kcu]);
+
+    printf("Horizontal Courant number problems:\n");
+    printf("  Grid indices: j=%d k=%d (Nke=%d)\n", icu, kcu, grid->Nke[icu]);
+    printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xe[icu],grid->ye[icu],
+        0.5*(DepthFromDZ(grid,phys,grid->grad[2*icu],kcu)+
+          DepthFromDZ(grid,phys,grid->grad[2*icu+1],kcu)));
+    printf("  Free-surface heights (on either side): %.3e, %.3e\n",phys->h[nc1],phys->h[nc2]);
+    printf("  Depths (on either side): %.3e, %.3e\n",grid->dv[nc1],grid->dv[nc2]);
+    printf("  Salinity (on either side): %.3e, %.3e\n",phys->s[nc1][kcu],phys->s[nc2][kcu]);
+    printf("  Flux-face height = %.3e, CdB = %.3e\n",grid->dzf[icu][kcu],phys->CdB[icu]);
+    printf("  Umax = %.3e\n",phys->u[icu][kcu]);
+    printf("  Horizontal grid spacing grid->dg[%d] = %.3e\n",icu,grid->dg[icu]);
+    printf("  Horizontal Courant number is CmaxU = %.2f.\n",CmaxU);
+    printf("  You specified a maximum of %.2f in suntans.dat\n",prop->Cmax);
+    printf("  Your time step size is %.2f.\n",prop->dt);
+    printf("  Reducing it to at most %.2f (For C=0.5) might solve this problem.\n",dtsuggestU);
+  }
 
-    myalldone=1;
+  if(!checks.uflag) {
+    printf("Problem with U (U=NaN):\n");
+    printf("  Grid indices: j=%d k=%d (Nke=%d)\n", iu, ku, grid->Nke[iu]);
+    printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xe[iu],grid->ye[iu],
+        0.5*(DepthFromDZ(grid,phys,grid->grad[2*iu],ku)+
+          DepthFromDZ(grid,phys,grid->grad[2*iu+1],ku)));
   }
 
-  MPI_Reduce(&myalldone,&alldone,1,MPI_INT,MPI_SUM,0,comm);
-  MPI_Bcast(&alldone,1,MPI_INT,0,comm);
+  if(CmaxW>prop->Cmax && prop->thetaM<0.5) {
+    dtsuggestW = CMAXSUGGEST*grid->dzz[icw][kcw]/fabs(0.5*(phys->w[icw][kcw]+phys->w[icw][kcw]));
+
+    printf("Vertical Courant number problems:\n");
+    printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", icw, kcw, grid->Nkc[icw]);
+    printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xv[icw],grid->yv[icw],DepthFromDZ(grid,phys,icw,kcw));
+    printf("  Free-surface height: %.3e\n",phys->h[icw]);
+    printf("  Depth: %.3e\n",grid->dv[icw]);
+    printf("  Wmax = %.3e (located half-way between faces)\n",0.5*(phys->w[icw][kcw]+phys->w[icw][kcw+1]));
+    printf("  Vertical grid spacing dz = %.3e\n",grid->dzz[icw][kcw]);
+    printf("  Vertical Courant number is CmaxW = %.2f.\n",CmaxW);
+    printf("  You specified a maximum of %.2f in suntans.dat\n",prop->Cmax);
+    printf("  Your time step size is %.2f.\n",prop->dt);
+    printf("  Reducing it to at most %.2f (For C=0.5) might solve this problem.\n",dtsuggestW);
+  }
 
-  return alldone;
+  if(!checks.wflag) {
+    printf("Problem with W (W=NaN):\n");
+    printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", iw, kw, grid->Nkc[iw]);
+    printf("  Location: x=%.3e, y=%.3e, z=%.3e\n",grid->xv[iw],grid->yv[iw],DepthFromDZ(grid,phys,iw,kw));
+  }
+
+  if(!checks.sflag) {
+    printf("Problem with the scalar s (s=NaN):\n");
+    printf("  Grid indices: i=%d k=%d (Nkc=%d)\n", is, ks, grid->Nkc[is]);
+    printf("  Location: x=%.3e, y=%.3e, z=%.3e dv =%.3e h = %.3e\n",grid->xv[is],grid->yv[is],DepthFromDZ(grid,phys,is,ks),grid->dv[is],phys->h[is]);
+  }
+
+  if(!checks.hflag) {
+    printf("Problem with the free surface (h=NaN):\n");
+    printf("  Grid index: i=%d\n", ih);
+    printf("  Location: x=%.3e, y=%.3e\n",grid->xv[ih],grid->yv[ih]);
+  }
+  printf(DASHES);
 }
 
 /*
@@ -221,13 +477,16 @@ int Check(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_C
  * Check to make sure the vertical grid spacing is >= 0 and that the free surface is
  * not crossing through cells when wetdry != 0.
  *
- */    
+ */
 int CheckDZ(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm)
 {
-  int i, k, iz, kz, iw, kw, Nc=grid->Nc, Ne=grid->Ne,nf,ne;
+  int i, k, iz, kz, iw, kw, Nc=grid->Nc, nf, ne;
   int zflag=1, wflag=1, myalldone, alldone;
   REAL C;
 
+  if(!checks.active)
+    return 0;
+
   iw=kw=iz=kz=0;
 
   for(i=0;i<Nc;i++) {
@@ -287,6 +546,13 @@ int CheckDZ(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI
     myalldone=1;
   }
 
+  // The result is needed on all processors right away to skip the
+  // nonhydrostatic solve, so with checkmode=1 it is not deferred to Check
+  if(prop->checkmode) {
+    MPI_Allreduce(&myalldone,&alldone,1,MPI_INT,MPI_MAX,comm);
+    return alldone;
+  }
+
   MPI_Reduce(&myalldone,&alldone,1,MPI_INT,MPI_SUM,0,comm);
   MPI_Bcast(&alldone,1,MPI_INT,0,comm);
 
@@ -16,6 +16,31 @@
 #include "phys.h"
 #include "mympi.h"
 
+/*
+ * Results of the blow-up checks on this processor.  With checkmode=1 they are
+ * accumulated column by column in the kernels that compute h, u, w and s, and
+ * the blow-up flag and Courant numbers are reduced with a single non-blocking
+ * reduction that is posted by CheckReduce and completed by Check.
+ *
+ */
+typedef struct _checkT {
+  int active;                      // 1 if this time step is checked
+  int pending;                     // 1 if the reduction has been posted
+  int hflag, uflag, wflag, sflag;  // 0 if a NaN was found
+  int ih, iu, ku, iw, kw, is, ks;
+  int icu, kcu, icw, kcw;          // location of the maximum Courant numbers
+  REAL CmaxU, CmaxW;
+  REAL mine[3], all[3];            // blow-up flag, CmaxU and CmaxW before and after the reduction
+  MPI_Request request;
+} checkT;
+
+void CheckBegin(propT *prop);
+int CheckActive(void);
+void CheckFreeSurface(physT *phys, int i);
+void CheckEdgeColumn(gridT *grid, physT *phys, propT *prop, int j);
+void CheckCellColumn(gridT *grid, physT *phys, propT *prop, REAL **w, int i);
+void CheckScalarColumn(gridT *grid, REAL **scal, int i);
+void CheckReduce(gridT *grid, physT *phys, propT *prop, MPI_Comm comm);
 int Check(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 int CheckDZ(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 void Progress(propT *prop, int myproc, int numprocs);
@@ -135,6 +135,10 @@ const int computeSediments_DEFAULT = 0;
 // Latitude - required by solar radiation function
 const int latitude_DEFAULT = 29.0;
 
+// Latitude of the cells for the solar radiation (see radiation.c). 0 - latitude for all cells,
+// 1 - yv is the latitude in degrees, 2 - yv is a northing in metres from the equator
+const int varylatitude_DEFAULT = 0;
+
 // 0 - no meteorological input; 1 - COARE3.0, short and longwave radiation calculated
 const int metmodel_DEFAULT = 0; 
 
@@ -156,6 +160,15 @@ const REAL sill_DEFAULT = 0.9;
 // variogram range parameter. Decorrelation length scale.
 const REAL range_DEFAULT = 1e5;
 
+// Met input. 0 - scattered points (NUwind, NTair, ...); 1 - regular grid with bilinear interpolation
+const int metgrid_DEFAULT = 0;
+
+// Maximum number of nearest met points used to interpolate onto each cell
+const int metnearest_DEFAULT = 12;
+
+// Only use met points within this distance of a cell (the nearest one is always used). 0 - no limit
+const REAL metradius_DEFAULT = 0;
+
 //Output data to netcdf format (0 - binary, 1 - netcdf)
 const int outputNetcdf_DEFAULT = 0;
 
@@ -165,6 +178,126 @@ const int nstepsperncfile_DEFAULT = 999999;
 // File number of first netcdf output file (mergeArray=1 only)
 const int ncfilectr_DEFAULT = 0;
 
+/* ncdeflate, ncshuffle, nczstd, ncfloat, ncsigdigits, ncchunkcells
+   Storage of the time-dependent netcdf output fields.  Each can be set for a
+   single variable with <option>_<variable>, e.g. ncsigdigits_salt.
+   ncdeflate: deflate level (0 - off, 1-9)
+   ncshuffle: byte shuffle filter before compression (0 - off, 1 - on)
+   nczstd: zstandard level used instead of deflate (0 - off, needs netcdf>=4.9)
+   ncfloat: write as 32-bit floats instead of doubles (0 - double, 1 - float)
+   ncsigdigits: significant digits kept by bit grooming (0 - keep all)
+   ncchunkcells: cells (edges) per chunk (0 - all of the processor's cells)
+*/
+const int ncdeflate_DEFAULT = 2;
+const int ncshuffle_DEFAULT = 0;
+const int nczstd_DEFAULT = 0;
+const int ncfloat_DEFAULT = 0;
+const int ncsigdigits_DEFAULT = 0;
+const int ncchunkcells_DEFAULT = 0;
+
+/* ntoutStations, ntoutSubdomain, outputkmin, outputkmax, subxmin, subxmax, subymin, subymax
+   Output plan (see outputplan.c).  The interval of a single netcdf or binary
+   output field can also be set with ntout_<variable>, e.g. ntout_salt (0 - never).
+   ntoutStations: steps between station/transect output (0 - off)
+   ntoutSubdomain: steps between sub-domain output (0 - off)
+   outputkmin, outputkmax: layers outputkmin to outputkmax-1 are written to the
+     station and sub-domain files (outputkmax=0 - Nkmax)
+   subxmin, subxmax, subymin, subymax: bounding box of the sub-domain, which is
+     used when SubdomainPolygon is not given
+*/
+const int ntoutStations_DEFAULT = 0;
+const int ntoutSubdomain_DEFAULT = 0;
+const int outputkmin_DEFAULT = 0;
+const int outputkmax_DEFAULT = 0;
+const REAL subxmin_DEFAULT = -INFTY;
+const REAL subxmax_DEFAULT = INFTY;
+const REAL subymin_DEFAULT = -INFTY;
+const REAL subymax_DEFAULT = INFTY;
+
+/* checkmode, checkinterval
+   Blow-up checks (see check.c).
+   checkmode: 0 - Check scans all fields, 1 - the checks are accumulated in the
+     kernels and reduced with a single non-blocking reduction
+   checkinterval: steps between checks (the last step is always checked)
+*/
+const int checkmode_DEFAULT = 0;
+const int checkinterval_DEFAULT = 1;
+
+/* adaptivedt, dtmin, dtmax, dtCtarget, dtClow, dtChigh, dtgrowth
+   Adaptive time step (see timestep.c).
+   adaptivedt: 0 - fixed dt, 1 - dt adapted to the Courant number
+   dtmin, dtmax: bounds of the time step (0 - dt/10 and 10*dt)
+   dtCtarget: Courant number the time step is adapted to
+   dtClow, dtChigh: the time step is increased below dtClow and decreased above dtChigh
+   dtgrowth: maximum factor by which the time step is increased at once
+*/
+const int adaptivedt_DEFAULT = 0;
+const REAL dtmin_DEFAULT = 0;
+const REAL dtmax_DEFAULT = 0;
+const REAL dtCtarget_DEFAULT = 0.5;
+const REAL dtClow_DEFAULT = 0.35;
+const REAL dtChigh_DEFAULT = 0.7;
+const REAL dtgrowth_DEFAULT = 1.1;
+
+/* analysis, ntanalysis, ntanalysisout, analysiststart
+   In-situ harmonic analysis and running statistics (see analysis.c).
+   analysis: 0 - off, 1 - on
+   ntanalysis: steps between samples
+   ntanalysisout: steps between checkpoints of the results (0 - only at the end)
+   analysiststart: simulation time in seconds at which sampling starts
+*/
+const int analysis_DEFAULT = 0;
+const int ntanalysis_DEFAULT = 1;
+const int ntanalysisout_DEFAULT = 0;
+const REAL analysiststart_DEFAULT = 0;
+
+/* outputsummary
+   Write the timings, the iterations of the conjugate-gradient solvers and the
+   norms of the fields at the end of the run to SummaryFile (see OutputSummary
+   in physio.c).
+   0 - off, 1 - on
+*/
+const int outputsummary_DEFAULT = 0;
+
+/* partitionweights, partitionconstraints, procspernode
+   partitionweights: weights of the cells for the partitioning (see SetCellWeights
+     in grid.c)
+     0 - number of layers, 1 - cost model of the modules, 2 - read from CellCostFile
+   partitionconstraints: 1 - balance the cost, 2 - balance the cost and the memory
+   procspernode: number of processors per node for the two-level partitioning
+     (see GetPartitioning in partition.c), 0 for one level
+*/
+const int partitionweights_DEFAULT = 0;
+const int partitionconstraints_DEFAULT = 1;
+const int procspernode_DEFAULT = 0;
+
+/* rebalance, ntrebalance, rebalancethreshold
+   Dynamic load balancing (see rebalance.c).
+   rebalance: 0 - off, 1 - repartition the grid during the run
+   ntrebalance: steps between checks of the load balance
+   rebalancethreshold: maximum over mean of the computation time of the processors
+     above which the grid is repartitioned
+*/
+const int rebalance_DEFAULT = 0;
+const int ntrebalance_DEFAULT = 100;
+const REAL rebalancethreshold_DEFAULT = 1.2;
+
+/* qmixed, qmixedepsilon
+   Mixed-precision solver for the nonhydrostatic pressure (see CGSolveQMixed in mixedcg.c).
+   qmixed: 0 - double-precision CG, 1 - single-precision inner CG iterations
+     with a double-precision residual correction
+   qmixedepsilon: reduction of the residual in each single-precision inner solve
+*/
+const int qmixed_DEFAULT = 0;
+const REAL qmixedepsilon_DEFAULT = 1e-4;
+
+/* activelists
+   Loop the kernels only over the cells and edges that are wet or next to a wet
+   cell (see UpdateActiveLists in phys.c).
+   0 - all cells and edges, 1 - skip the dry columns that are isolated from the water
+*/
+const int activelists_DEFAULT = 0;
+
 //Light extinction depth [m]
 const REAL Lsw_DEFAULT = 2.0;
 
@@ -180,6 +313,16 @@ const char *basetime_DEFAULT =  "19900101.000000";
 // NetCDF boundary conidtion default
 const int netcdfBdy_DEFAULT = 0;
 
+/* tideforcing, tidenodal
+   Tidal boundary forcing from the constituents in TideFile (see tides.c), used
+   when netcdfBdy=0.
+   tideforcing: 0 - off, 1 - on
+   tidenodal: 0 - phases relative to basetime, 1 - nodal corrections and equilibrium
+     arguments, updated daily
+*/
+const int tideforcing_DEFAULT = 0;
+const int tidenodal_DEFAULT = 1;
+
 // Read initial condition netcdf
 const int readinitialnc_DEFAULT = 0;
 
@@ -239,6 +382,15 @@ const int marshmodel_DEFAULT = 0;
 const int subgrid_DEFAULT = 0;
 
 const REAL subgrideps_DEFAULT = 1e-3;
+
+/* subgridprof, subgridproftol
+   0: linear Ac, V and flux height profiles at disN+1 uniform values of h
+   1: monotone cubic (PCHIP) profiles at no more than disN+1 adaptive breakpoints,
+   which are added until the profiles are within subgridproftol of their
+   largest values
+*/
+const int subgridprof_DEFAULT = 0;
+const REAL subgridproftol_DEFAULT = 1e-4;
 /* im
    which implicit method to use for momentum equation 
    0 as theta method, 1 as AM2, 2 as AI2
@@ -318,6 +470,13 @@ const REAL SSCvprof_DEFAULT=0.0;
 */
 const REAL sedilayerprop_DEFAULT=1;
 
+/* morfac
+  morphological acceleration factor of the sediment bed model.  The bed
+  change over each bed update interval is morfac times the accumulated
+  erosion, deposition and consolidation fluxes.  1 by default.
+*/
+const REAL morfac_DEFAULT=1;
+
 
 /* periodicbc
   whether there is periodic boundary condition in the simulation
@@ -40,8 +40,8 @@ void LaxWendroff(gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm com
       }
 
     if(VERBOSE>2) {
-      MPI_Reduce(&numin,&numinall,1,MPI_DOUBLE,MPI_MAX,0,comm);
-      MPI_Reduce(&numax,&numaxall,1,MPI_DOUBLE,MPI_MAX,0,comm);
+      MPI_Reduce(&numin,&numinall,1,MPI_REALTYPE,MPI_MAX,0,comm);
+      MPI_Reduce(&numax,&numaxall,1,MPI_REALTYPE,MPI_MAX,0,comm);
       
       if(myproc==0) printf("Lax-Wendroff diffusion coefficients: numin = %.3e, numax = %.3e\n",numin,numax);
     }
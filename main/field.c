@@ -0,0 +1,484 @@
+/*
+ * File: field.c
+ * -------------
+ * Reads the spatial fields that are interpolated onto the grid at setup and
+ * interpolates them.  The format of a field is given by the suffix of its file:
+ *
+ *   .flt  raster of 4-byte floats with the ESRI header of the same name with .hdr
+ *         (ncols, nrows, xllcorner/xllcenter, yllcorner/yllcenter, cellsize,
+ *         nodata_value and byteorder), stored from the top row down
+ *   .nc   netCDF raster z(ny,nx) with evenly spaced coordinates x(nx) and y(ny)
+ *   .bin  scattered points stored as x,y,z triples of doubles
+ *   other scattered points stored as x y z on each line of a text file
+ *
+ * Each processor only keeps the part of the field around the extent of the
+ * points it interpolates onto.  Rasters are cropped to the window of pixels
+ * around the extent and are interpolated bilinearly between the pixel centers.
+ * Scattered points are cropped to a box around the extent and are interpolated
+ * with the inverse distance weighting of the np nearest points, which are found
+ * with a k-d tree.  When the nearest points of a location might lie outside of
+ * the box the points are read again with a box that contains them, so that the
+ * result is the same as with all of the points.
+ *
+ */
+#include <ctype.h>
+#include <strings.h>
+#include "suntans.h"
+#include "mympi.h"
+#include "fileio.h"
+#include "memory.h"
+#include "util.h"
+#include "kdtree.h"
+#include "field.h"
+#include "mynetcdf.h"
+
+static int FieldType(char *file, int *binary);
+static void ReadScatter(fieldT *field, REAL *box, int myproc);
+static void AddPoint(fieldT *field, int *size, DREAL x, DREAL y, REAL z);
+static void ReadRasterFlt(fieldT *field, REAL *extent, int myproc);
+static REAL SampleRaster(fieldT *field, DREAL x, DREAL y, int *nodata);
+static REAL SampleScatter(fieldT *field, DREAL x, DREAL y, int np, int *ind, REAL *dist2, REAL *box);
+
+/*
+ * Function: FieldExtent
+ * Usage: FieldExtent(grid->xv,grid->yv,grid->Nc,extent,1);
+ * --------------------------------------------------------
+ * Sets extent to the xmin, xmax, ymin and ymax of the N points x,y, or extends it
+ * to include them if init is 0.
+ *
+ */
+void FieldExtent(DREAL *x, DREAL *y, int N, REAL *extent, int init) {
+  int n;
+
+  if(init) {
+    extent[0]=extent[2]=INFTY;
+    extent[1]=extent[3]=-INFTY;
+  }
+  for(n=0;n<N;n++) {
+    extent[0]=Min(extent[0],x[n]);
+    extent[1]=Max(extent[1],x[n]);
+    extent[2]=Min(extent[2],y[n]);
+    extent[3]=Max(extent[3],y[n]);
+  }
+}
+
+/*
+ * Function: ReadField
+ * Usage: field = ReadField(file,extent,myproc);
+ * ---------------------------------------------
+ * Reads the part of the field in file that is needed to interpolate it onto
+ * points within extent (see FieldExtent).
+ *
+ */
+fieldT *ReadField(char *file, REAL *extent, int myproc) {
+  int binary;
+  REAL box[4], margin;
+  fieldT *field = (fieldT *)SunMalloc(sizeof(fieldT),"ReadField");
+
+  strcpy(field->file,file);
+  field->type = FieldType(file,&binary);
+  field->N = 0;
+  field->z = NULL;
+  field->x = field->y = NULL;
+  field->tree = NULL;
+
+  // No points to interpolate onto
+  if(extent[0]>extent[1])
+    return field;
+
+  if(field->type==FIELDRASTER) {
+    if(binary)
+      ReadRasterFlt(field,extent,myproc);
+    else
+      ReadFieldNC(field,extent,myproc);
+    if(VERBOSE>2) printf("Processor %d read a %d x %d window of the raster %s.\n",myproc,field->nx,field->ny,file);
+  } else {
+    margin = FIELDMARGIN*Max(extent[1]-extent[0],extent[3]-extent[2]);
+    box[0]=extent[0]-margin;
+    box[1]=extent[1]+margin;
+    box[2]=extent[2]-margin;
+    box[3]=extent[3]+margin;
+    ReadScatter(field,box,myproc);
+  }
+  return field;
+}
+
+/*
+ * Function: SampleField
+ * Usage: SampleField(field,grid->xv,grid->yv,grid->dv,grid->Nc,grid->maxfaces+1,myproc);
+ * --------------------------------------------------------------------------------------
+ * Interpolates the field onto the Ni points xi,yi, which must lie within the
+ * extent that the field was read with, and stores the values in zi.  The np
+ * nearest scattered points are used, or the value of a point at the same
+ * location.
+ *
+ */
+void SampleField(fieldT *field, DREAL *xi, DREAL *yi, REAL *zi, int Ni, int np, int myproc) {
+  int n, nodata=0, *ind;
+  REAL *dist2, box[4];
+
+  if(field->type==FIELDRASTER) {
+    for(n=0;n<Ni;n++)
+      zi[n]=SampleRaster(field,xi[n],yi[n],&nodata);
+    if(nodata && VERBOSE>0)
+      printf("Warning: processor %d has %d points without data in %s, which are set to 0.\n",myproc,nodata,field->file);
+    return;
+  }
+
+  ind = (int *)SunMalloc(np*sizeof(int),"SampleField");
+  dist2 = (REAL *)SunMalloc(np*sizeof(REAL),"SampleField");
+
+  // box is extended to contain the nearest points of the locations for which
+  // points outside of field->box might be nearer
+  box[0]=box[2]=INFTY;
+  box[1]=box[3]=-INFTY;
+  for(n=0;n<Ni;n++)
+    zi[n]=SampleScatter(field,xi[n],yi[n],np,ind,dist2,box);
+
+  if(box[0]<box[1]) {
+    if(VERBOSE>2) printf("Processor %d is reading more points of %s.\n",myproc,field->file);
+    box[0]=Min(box[0],field->box[0]);
+    box[1]=Max(box[1],field->box[1]);
+    box[2]=Min(box[2],field->box[2]);
+    box[3]=Max(box[3],field->box[3]);
+    ReadScatter(field,box,myproc);
+    for(n=0;n<Ni;n++)
+      zi[n]=SampleScatter(field,xi[n],yi[n],np,ind,dist2,NULL);
+  }
+
+  SunFree(ind,np*sizeof(int),"SampleField");
+  SunFree(dist2,np*sizeof(REAL),"SampleField");
+}
+
+/*
+ * Function: FreeField
+ * Usage: FreeField(field);
+ * ------------------------
+ * Frees the space allocated by ReadField.
+ *
+ */
+void FreeField(fieldT *field) {
+  if(field->type==FIELDSCATTER) {
+    if(field->tree!=NULL)
+      KDTreeFree(field->tree);
+    free(field->x);
+    free(field->y);
+  }
+  free(field->z);
+  SunFree(field,sizeof(fieldT),"FreeField");
+}
+
+/*
+ * Function: FieldRasterWindow
+ * Usage: nx = FieldRasterWindow(x0,dx,ncols,extent[0],extent[1],&i0);
+ * -------------------------------------------------------------------
+ * Returns the number of pixels, starting at pixel i0, of the n pixel centers
+ * x0+i*dx that are needed to interpolate bilinearly between xmin and xmax.
+ *
+ */
+int FieldRasterWindow(DREAL x0, DREAL dx, int n, REAL xmin, REAL xmax, int *i0) {
+  DREAL a = (xmin-x0)/dx, b = (xmax-x0)/dx;
+  DREAL lo = floor(Min(a,b)), hi = floor(Max(a,b))+1;
+
+  lo = Max(0,Min(lo,n-1));
+  hi = Max(0,Min(hi,n-1));
+  *i0 = (int)lo;
+  return (int)hi-(int)lo+1;
+}
+
+/*
+ * Function: FieldType
+ * Usage: type = FieldType(file,&binary);
+ * --------------------------------------
+ * Returns the type of the field from the suffix of its file and whether it is
+ * stored in binary.
+ *
+ */
+static int FieldType(char *file, int *binary) {
+  char *suffix = strrchr(file,'.');
+
+  *binary=0;
+  if(suffix!=NULL && !strcmp(suffix,".flt")) {
+    *binary=1;
+    return FIELDRASTER;
+  }
+  if(suffix!=NULL && !strcmp(suffix,".nc"))
+    return FIELDRASTER;
+  if(suffix!=NULL && !strcmp(suffix,".bin"))
+    *binary=1;
+  return FIELDSCATTER;
+}
+
+/*
+ * Function: ReadScatter
+ * Usage: ReadScatter(field,box,myproc);
+ * -------------------------------------
+ * Reads the scattered points of field->file that lie within box and builds
+ * their k-d tree, replacing any points that were read before.
+ *
+ */
+static void ReadScatter(fieldT *field, REAL *box, int myproc) {
+  int n, N, size=0, binary;
+  long bytes;
+  double xyz[3];
+  char str[BUFFERLENGTH];
+  FILE *ifile;
+
+  if(field->tree!=NULL) {
+    KDTreeFree(field->tree);
+    free(field->x);
+    free(field->y);
+    free(field->z);
+  }
+  field->N=0;
+  field->x=field->y=NULL;
+  field->z=NULL;
+  field->tree=NULL;
+  for(n=0;n<4;n++)
+    field->box[n]=box[n];
+
+  FieldType(field->file,&binary);
+  if(binary) {
+    ifile = MPI_FOpen(field->file,"rb","ReadField",myproc);
+    fseek(ifile,0,SEEK_END);
+    bytes = ftell(ifile);
+    rewind(ifile);
+    N = bytes/sizeof(xyz);
+    for(n=0;n<N;n++) {
+      if(fread(xyz,sizeof(double),3,ifile)!=3) {
+	printf("Error reading %s on processor %d.\n",field->file,myproc);
+	MPI_Finalize();
+	exit(EXIT_FAILURE);
+      }
+      if(xyz[0]>=box[0] && xyz[0]<=box[1] && xyz[1]>=box[2] && xyz[1]<=box[3])
+	AddPoint(field,&size,xyz[0],xyz[1],xyz[2]);
+    }
+  } else {
+    N = MPI_GetSize(field->file,"ReadField",myproc);
+    ifile = MPI_FOpen(field->file,"r","ReadField",myproc);
+    for(n=0;n<N;n++) {
+      xyz[0]=getfield(ifile,str);
+      xyz[1]=getfield(ifile,str);
+      xyz[2]=getfield(ifile,str);
+      if(xyz[0]>=box[0] && xyz[0]<=box[1] && xyz[1]>=box[2] && xyz[1]<=box[3])
+	AddPoint(field,&size,xyz[0],xyz[1],xyz[2]);
+    }
+  }
+  fclose(ifile);
+
+  // Read all of the points if there are none in the box
+  if(field->N==0 && box[0]>-INFTY) {
+    box[0]=box[2]=-INFTY;
+    box[1]=box[3]=INFTY;
+    ReadScatter(field,box,myproc);
+    return;
+  }
+  if(field->N==0) {
+    printf("Error: there are no points in %s.\n",field->file);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  field->tree = KDTreeBuild(field->x,field->y,NULL,field->N);
+
+  if(VERBOSE>2) printf("Processor %d read %d of the %d points of %s.\n",myproc,field->N,N,field->file);
+}
+
+/*
+ * Function: AddPoint
+ * Usage: AddPoint(field,&size,x,y,z);
+ * -----------------------------------
+ * Appends a scattered point to the field, doubling the size of the arrays when
+ * they are full.
+ *
+ */
+static void AddPoint(fieldT *field, int *size, DREAL x, DREAL y, REAL z) {
+  if(field->N==*size) {
+    *size = (*size==0 ? 1024 : 2*(*size));
+    field->x = (DREAL *)realloc(field->x,*size*sizeof(DREAL));
+    field->y = (DREAL *)realloc(field->y,*size*sizeof(DREAL));
+    field->z = (REAL *)realloc(field->z,*size*sizeof(REAL));
+    if(field->x==NULL || field->y==NULL || field->z==NULL) {
+      printf("Error.  Out of memory reading %s!\n",field->file);
+      exit(1);
+    }
+  }
+  field->x[field->N]=x;
+  field->y[field->N]=y;
+  field->z[field->N]=z;
+  field->N++;
+}
+
+/*
+ * Function: ReadRasterFlt
+ * Usage: ReadRasterFlt(field,extent,myproc);
+ * ------------------------------------------
+ * Reads the window of the .flt raster field->file around extent.
+ *
+ */
+static void ReadRasterFlt(fieldT *field, REAL *extent, int myproc) {
+  int i, j, b, ncols=0, nrows=0, center=0, swap, i0, j0;
+  unsigned int one=1;
+  float *row;
+  unsigned char *byte, tmp;
+  double xll=0, yll=0, cellsize=0, nodata=-9999;
+  char hdrfile[BUFFERLENGTH], key[BUFFERLENGTH], value[BUFFERLENGTH];
+  char order[BUFFERLENGTH] = "LSBFIRST";
+  FILE *ifile;
+
+  // Read the header
+  strcpy(hdrfile,field->file);
+  strcpy(strrchr(hdrfile,'.'),".hdr");
+  ifile = MPI_FOpen(hdrfile,"r","ReadField",myproc);
+  while(fscanf(ifile,"%s %s",key,value)==2) {
+    if(!strcasecmp(key,"ncols"))
+      ncols=atoi(value);
+    else if(!strcasecmp(key,"nrows"))
+      nrows=atoi(value);
+    else if(!strcasecmp(key,"xllcorner") || !strcasecmp(key,"xllcenter")) {
+      xll=atof(value);
+      center=!strcasecmp(key,"xllcenter");
+    } else if(!strcasecmp(key,"yllcorner") || !strcasecmp(key,"yllcenter"))
+      yll=atof(value);
+    else if(!strcasecmp(key,"cellsize"))
+      cellsize=atof(value);
+    else if(!strcasecmp(key,"nodata_value"))
+      nodata=atof(value);
+    else if(!strcasecmp(key,"byteorder"))
+      strcpy(order,value);
+  }
+  fclose(ifile);
+  if(ncols<2 || nrows<2 || cellsize<=0) {
+    printf("Error: %s must have ncols>1, nrows>1 and cellsize>0.\n",hdrfile);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  // Rows are stored from the top down, so the pixel centers are at
+  // x0+i*dx, y0+j*dy with dy<0
+  field->dx = cellsize;
+  field->dy = -cellsize;
+  field->x0 = xll + (center ? 0 : 0.5*cellsize);
+  field->y0 = yll + (center ? 0 : 0.5*cellsize) + (nrows-1)*cellsize;
+  field->nodata = nodata;
+
+  field->nx = FieldRasterWindow(field->x0,field->dx,ncols,extent[0],extent[1],&i0);
+  field->ny = FieldRasterWindow(field->y0,field->dy,nrows,extent[2],extent[3],&j0);
+  field->x0 += i0*field->dx;
+  field->y0 += j0*field->dy;
+  field->N = field->nx*field->ny;
+  field->z = (REAL *)malloc(field->N*sizeof(REAL));
+  row = (float *)SunMalloc(field->nx*sizeof(float),"ReadRasterFlt");
+
+  swap = (toupper(order[0])=='M') == (*(unsigned char *)&one==1);
+  ifile = MPI_FOpen(field->file,"rb","ReadField",myproc);
+  for(j=0;j<field->ny;j++) {
+    fseek(ifile,((long)(j0+j)*ncols+i0)*sizeof(float),SEEK_SET);
+    if(fread(row,sizeof(float),field->nx,ifile)!=field->nx) {
+      printf("Error reading %s on processor %d.\n",field->file,myproc);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    for(i=0;i<field->nx;i++) {
+      if(swap) {
+	byte = (unsigned char *)&row[i];
+	for(b=0;b<2;b++) {
+	  tmp=byte[b];
+	  byte[b]=byte[3-b];
+	  byte[3-b]=tmp;
+	}
+      }
+      field->z[j*field->nx+i]=row[i];
+    }
+  }
+  fclose(ifile);
+  SunFree(row,field->nx*sizeof(float),"ReadRasterFlt");
+
+  // Compare with the nodata value in the precision it was stored in
+  field->nodata = (float)nodata;
+}
+
+/*
+ * Function: SampleRaster
+ * Usage: z = SampleRaster(field,x,y,&nodata);
+ * -------------------------------------------
+ * Bilinear interpolation of the raster between the four pixel centers around
+ * x,y.  Pixels without data are left out, and if none of them have data the
+ * value is 0 and nodata is incremented.
+ *
+ */
+static REAL SampleRaster(fieldT *field, DREAL x, DREAL y, int *nodata) {
+  int i, j, m, n;
+  REAL rx, ry, w, sumw=0, z=0;
+
+  rx = Max(0,Min((x-field->x0)/field->dx,field->nx-1));
+  ry = Max(0,Min((y-field->y0)/field->dy,field->ny-1));
+  i = Min(floor(rx),field->nx-2);
+  j = Min(floor(ry),field->ny-2);
+  if(i<0) i=0;
+  if(j<0) j=0;
+  rx-=i;
+  ry-=j;
+
+  for(n=0;n<2;n++)
+    for(m=0;m<2;m++) {
+      if(i+m>=field->nx || j+n>=field->ny || field->z[(j+n)*field->nx+i+m]==field->nodata)
+	continue;
+      w = (m ? rx : 1-rx)*(n ? ry : 1-ry);
+      z += w*field->z[(j+n)*field->nx+i+m];
+      sumw += w;
+    }
+  if(sumw>0)
+    return z/sumw;
+
+  // A pixel with data that has zero weight
+  for(n=0;n<2;n++)
+    for(m=0;m<2;m++)
+      if(i+m<field->nx && j+n<field->ny && field->z[(j+n)*field->nx+i+m]!=field->nodata)
+	return field->z[(j+n)*field->nx+i+m];
+
+  (*nodata)++;
+  return 0;
+}
+
+/*
+ * Function: SampleScatter
+ * Usage: z = SampleScatter(field,x,y,np,ind,dist2,box);
+ * -----------------------------------------------------
+ * Inverse distance weighting of the np scattered points nearest to x,y, using the
+ * work arrays ind and dist2 of size np.  If box is not NULL and points outside of
+ * field->box might be nearer, box is extended to contain a circle around x,y
+ * that holds np points.
+ *
+ */
+static REAL SampleScatter(fieldT *field, DREAL x, DREAL y, int np, int *ind, REAL *dist2, REAL *box) {
+  int j, n;
+  REAL r, sumw, z, w;
+
+  n = KDTreeKNearest(field->tree,x,y,np,ind,dist2);
+
+  if(box!=NULL) {
+    // Distance to the edge of the box of the points
+    r = Min(Min(x-field->box[0],field->box[1]-x),Min(y-field->box[2],field->box[3]-y));
+    if(n<np) {
+      box[0]=box[2]=-INFTY;
+      box[1]=box[3]=INFTY;
+    } else if(r<0 || dist2[n-1]>r*r) {
+      r = sqrt(dist2[n-1]);
+      box[0]=Min(box[0],x-r);
+      box[1]=Max(box[1],x+r);
+      box[2]=Min(box[2],y-r);
+      box[3]=Max(box[3],y+r);
+    }
+  }
+
+  if(dist2[0]==0)
+    return field->z[ind[0]];
+
+  z=sumw=0;
+  for(j=0;j<n;j++) {
+    w = 1.0/dist2[j];
+    z += w*field->z[ind[j]];
+    sumw += w;
+  }
+  return z/sumw;
+}
@@ -0,0 +1,53 @@
+/*
+ * File: field.h
+ * -------------
+ * Header file for field.c, which reads the spatial fields that are
+ * interpolated onto the grid at setup (depth, subgrid depth, marsh and drag
+ * fields).
+ *
+ */
+#ifndef _field_h
+#define _field_h
+
+#include "suntans.h"
+#include "kdtree.h"
+
+// Field types
+#define FIELDSCATTER 0
+#define FIELDRASTER 1
+
+// Fraction of the size of the extent that is added to it when cropping scattered points
+#define FIELDMARGIN 0.1
+
+/*
+ * Data of a field over the part of the domain that is needed by a processor.
+ * Scattered points (text x y z triples or binary .bin triples of doubles) are
+ * cropped to a box around the extent and searched with a k-d tree, and rasters
+ * (.flt with an ESRI .hdr header or netCDF .nc) are cropped to the window of
+ * pixels around the extent and sampled directly.
+ *
+ */
+typedef struct _fieldT {
+  int type;
+  char file[BUFFERLENGTH];
+  REAL box[4];     // xmin, xmax, ymin, ymax of the scattered points that were read
+  int N;           // Number of values
+  REAL *z;
+
+  // Scattered points
+  DREAL *x, *y;
+  kdtreeT *tree;
+
+  // Raster window, with z[j*nx+i] at pixel center (x0+i*dx, y0+j*dy)
+  int nx, ny;
+  DREAL x0, y0, dx, dy;
+  REAL nodata;
+} fieldT;
+
+void FieldExtent(DREAL *x, DREAL *y, int N, REAL *extent, int init);
+fieldT *ReadField(char *file, REAL *extent, int myproc);
+void SampleField(fieldT *field, DREAL *xi, DREAL *yi, REAL *zi, int Ni, int np, int myproc);
+void FreeField(fieldT *field);
+int FieldRasterWindow(DREAL x0, DREAL dx, int n, REAL xmin, REAL xmax, int *i0);
+
+#endif
@@ -365,6 +365,10 @@ double GetDefaultValue(char *str, int *status) {
     
    return latitude_DEFAULT;
    
+ } else if(!strcmp(str,"varylatitude")) {
+    
+   return varylatitude_DEFAULT;
+   
  } else if(!strcmp(str,"gmtoffset")) {
     
    return gmtoffset_DEFAULT;
@@ -389,6 +393,18 @@ double GetDefaultValue(char *str, int *status) {
     
    return range_DEFAULT;
    
+ } else if(!strcmp(str,"metgrid")) {
+    
+   return metgrid_DEFAULT;
+   
+ } else if(!strcmp(str,"metnearest")) {
+    
+   return metnearest_DEFAULT;
+   
+ } else if(!strcmp(str,"metradius")) {
+    
+   return metradius_DEFAULT;
+   
 } else if(!strcmp(str,"outputNetcdf")) {
     
    return outputNetcdf_DEFAULT;
@@ -401,6 +417,154 @@ double GetDefaultValue(char *str, int *status) {
     
    return ncfilectr_DEFAULT;
 
+} else if(!strcmp(str,"ncdeflate")) {
+    
+   return ncdeflate_DEFAULT;
+
+} else if(!strcmp(str,"ncshuffle")) {
+    
+   return ncshuffle_DEFAULT;
+
+} else if(!strcmp(str,"nczstd")) {
+    
+   return nczstd_DEFAULT;
+
+} else if(!strcmp(str,"ncfloat")) {
+    
+   return ncfloat_DEFAULT;
+
+} else if(!strcmp(str,"ncsigdigits")) {
+    
+   return ncsigdigits_DEFAULT;
+
+} else if(!strcmp(str,"ncchunkcells")) {
+    
+   return ncchunkcells_DEFAULT;
+
+} else if(!strcmp(str,"ntoutStations")) {
+    
+   return ntoutStations_DEFAULT;
+
+} else if(!strcmp(str,"ntoutSubdomain")) {
+    
+   return ntoutSubdomain_DEFAULT;
+
+} else if(!strcmp(str,"outputkmin")) {
+    
+   return outputkmin_DEFAULT;
+
+} else if(!strcmp(str,"outputkmax")) {
+    
+   return outputkmax_DEFAULT;
+
+} else if(!strcmp(str,"subxmin")) {
+    
+   return subxmin_DEFAULT;
+
+} else if(!strcmp(str,"subxmax")) {
+    
+   return subxmax_DEFAULT;
+
+} else if(!strcmp(str,"subymin")) {
+    
+   return subymin_DEFAULT;
+
+} else if(!strcmp(str,"subymax")) {
+    
+   return subymax_DEFAULT;
+
+} else if(!strcmp(str,"checkmode")) {
+    
+   return checkmode_DEFAULT;
+
+} else if(!strcmp(str,"checkinterval")) {
+    
+   return checkinterval_DEFAULT;
+
+} else if(!strcmp(str,"adaptivedt")) {
+    
+   return adaptivedt_DEFAULT;
+
+} else if(!strcmp(str,"dtmin")) {
+    
+   return dtmin_DEFAULT;
+
+} else if(!strcmp(str,"dtmax")) {
+    
+   return dtmax_DEFAULT;
+
+} else if(!strcmp(str,"dtCtarget")) {
+    
+   return dtCtarget_DEFAULT;
+
+} else if(!strcmp(str,"dtClow")) {
+    
+   return dtClow_DEFAULT;
+
+} else if(!strcmp(str,"dtChigh")) {
+    
+   return dtChigh_DEFAULT;
+
+} else if(!strcmp(str,"dtgrowth")) {
+    
+   return dtgrowth_DEFAULT;
+
+} else if(!strcmp(str,"analysis")) {
+    
+   return analysis_DEFAULT;
+
+} else if(!strcmp(str,"ntanalysis")) {
+    
+   return ntanalysis_DEFAULT;
+
+} else if(!strcmp(str,"ntanalysisout")) {
+    
+   return ntanalysisout_DEFAULT;
+
+} else if(!strcmp(str,"analysiststart")) {
+    
+   return analysiststart_DEFAULT;
+
+} else if(!strcmp(str,"outputsummary")) {
+    
+   return outputsummary_DEFAULT;
+
+} else if(!strcmp(str,"partitionweights")) {
+    
+   return partitionweights_DEFAULT;
+
+} else if(!strcmp(str,"partitionconstraints")) {
+    
+   return partitionconstraints_DEFAULT;
+
+} else if(!strcmp(str,"procspernode")) {
+    
+   return procspernode_DEFAULT;
+
+} else if(!strcmp(str,"rebalance")) {
+    
+   return rebalance_DEFAULT;
+
+} else if(!strcmp(str,"ntrebalance")) {
+    
+   return ntrebalance_DEFAULT;
+
+} else if(!strcmp(str,"rebalancethreshold")) {
+    
+   return rebalancethreshold_DEFAULT;
+
+} else if(!strcmp(str,"qmixed")) {
+    
+   return qmixed_DEFAULT;
+
+} else if(!strcmp(str,"qmixedepsilon")) {
+    
+   return qmixedepsilon_DEFAULT;
+
+} else if(!strcmp(str,"activelists")) {
+    
+   return activelists_DEFAULT;
+
 } else if(!strcmp(str,"Lsw")) {
     
    return Lsw_DEFAULT;
@@ -417,6 +581,14 @@ double GetDefaultValue(char *str, int *status) {
     
    return Ch_DEFAULT;   
 
+} else if(!strcmp(str,"tideforcing")) {
+    
+   return tideforcing_DEFAULT;   
+
+} else if(!strcmp(str,"tidenodal")) {
+    
+   return tidenodal_DEFAULT;   
+
 } else if(!strcmp(str,"netcdfBdy")) {
     
    return netcdfBdy_DEFAULT;   
@@ -469,6 +641,14 @@ double GetDefaultValue(char *str, int *status) {
     
     return subgrid_DEFAULT;
  
+ } else if(!strcmp(str,"subgridprof")){
+    
+    return subgridprof_DEFAULT;
+ 
+ } else if(!strcmp(str,"subgridproftol")){
+    
+    return subgridproftol_DEFAULT;
+ 
  } else if(!strcmp(str,"kinterp")){
     
     return kinterp_DEFAULT;
@@ -513,6 +693,10 @@ double GetDefaultValue(char *str, int *status) {
     
     return sedilayerprop_DEFAULT;
  
+ } else if(!strcmp(str,"morfac")){
+    
+    return morfac_DEFAULT;
+ 
  } else if(!strcmp(str,"SSCvprof")){
     
     return SSCvprof_DEFAULT;
@@ -20,9 +20,27 @@
 #include "gridio.h"
 #include "sendrecv.h"
 #include "subgrid.h"
+#include "field.h"
 
 #define VTXDISTMAX 100
 
+// Relative cost and memory of the modules used by the cost model for the
+// partitioning weights (see SetCellWeights).  The costs are in units of one
+// hydrostatic layer and are per layer for the scalars (salt, temperature and
+// each sediment class), the nonhydrostatic solver, the turbulence model and the
+// marsh drag, and per subgrid point or wave spectral bin for the column terms.
+#define SCALARCOST 0.2
+#define SCALARMEMORY 0.1
+#define NONHYDROSTATICCOST 1.0
+#define TURBULENCECOST 0.3
+#define MARSHCOST 0.1
+#define SUBGRIDCOST 0.5
+#define SUBGRIDMEMORY 0.5
+#define WAVECOST 0.05
+#define WAVEMEMORY 0.02
+// Tolerance of the cell centers in CellCostFile relative to the cell centers of the grid
+#define CELLCOSTTOL 1e-6
+
 /*
  * Global variables for halo region for inner-processor boundaries
  */
@@ -95,6 +113,8 @@ static void VoronoiStats(gridT *grid);
 static void ReplacePeriodicBoundaryPair(gridT *maingrid,gridT **grid,int option, int myproc);
 static void FixDZZ(gridT *grid, REAL maxdepth, int Nkmax, int fixdzz, int myproc);
 static int GetNk(REAL *dz, REAL localdepth, int Nkmax);
+static void SetCellWeights(gridT *grid, REAL *dz, int Nkmax, int vertcoord, int maxgridweight, int myproc);
+static void BuildGrid(gridT **localgrid, int *part, int myproc, int numprocs, MPI_Comm comm);
 
 /************************************************************************/
 /*                                                                      */
@@ -111,7 +131,35 @@ static int GetNk(REAL *dz, REAL localdepth, int Nkmax);
  */
 void GetGrid(gridT **localgrid, int myproc, int numprocs, MPI_Comm comm)
 {
-  int Np, Ne, Nc, numcorr, i,j;
+  BuildGrid(localgrid,NULL,myproc,numprocs,comm);
+}
+
+/*
+ * Function: RepartitionGrid
+ * Usage: RepartitionGrid(&grid,part,myproc,numprocs,comm);
+ * --------------------------------------------------------
+ * Create the local grids of a running simulation for the given partitioning
+ * part[i] of the cells of the main grid (see Rebalance in rebalance.c), and 
+ * output them so that a restart reads the new partitioning.  The old local 
+ * grid is not freed.
+ *
+ */
+void RepartitionGrid(gridT **localgrid, int *part, int myproc, int numprocs, MPI_Comm comm)
+{
+  BuildGrid(localgrid,part,myproc,numprocs,comm);
+}
+
+/*
+ * Function: BuildGrid
+ * Usage: BuildGrid(grid,part,myproc,numprocs,comm);
+ * -------------------------------------------------
+ * Read or triangulate the main grid, partition it with GetPartitioning or with
+ * the partitioning part if it is not NULL, and create the local grids.
+ *
+ */
+static void BuildGrid(gridT **localgrid, int *part, int myproc, int numprocs, MPI_Comm comm)
+{
+  int Np, Ne, Nc, numcorr, i;
   gridT *maingrid;
 
   // read in all the filenames from the suntans.dat file
@@ -204,7 +252,7 @@ void GetGrid(gridT **localgrid, int myproc, int numprocs, MPI_Comm comm)
   if(myproc==0 && VERBOSE>0) printf("Partitioning...\n");
   // most important and complicated function to ensure parallelism for grid
   // takes the main grid and redistributes to local grids on each processor
-  Partition(maingrid,localgrid,comm);
+  Partition(maingrid,localgrid,part,comm);
   
   // functions to check to make sure all the communications are set up properly
   //  CheckCommunicateCells(maingrid,*localgrid,myproc,comm);
@@ -214,18 +262,23 @@ void GetGrid(gridT **localgrid, int myproc, int numprocs, MPI_Comm comm)
   if(myproc==0 && VERBOSE>0) printf("Outputting Data...\n");
   OutputGridData(maingrid,*localgrid,myproc,numprocs);
 
-  //FreeGrid(maingrid,numprocs);
+  // the main grid is only freed during a run since ParMETIS frees some of its
+  // arrays in GetPartitioning
+  if(part)
+    FreeGrid(maingrid,numprocs);
 }
 
 /*
  * Function: Partition
- * Usage: Partition(maingrid, localgrid, comm)
+ * Usage: Partition(maingrid, localgrid, part, comm)
  * ------------------------------------------
  * Partitions the cells unto each processor where ParMETIS 
  * colors each cell according to its processor based on 
  * weighting each cell by the depth (so that shallow 
  * regions of the domain which are less computationally
  * expensive are weighted less) in GetPartitioning.  
+ * If part is not NULL the cells are placed on processors 
+ * part[i] instead.
  * Topology determines neighboring processors for each
  * processor and TransferData determines which cells must 
  * have their information passed between processors.
@@ -233,7 +286,7 @@ void GetGrid(gridT **localgrid, int myproc, int numprocs, MPI_Comm comm)
  * 
  *
  */
-void Partition(gridT *maingrid, gridT **localgrid, MPI_Comm comm)
+void Partition(gridT *maingrid, gridT **localgrid, int *part, MPI_Comm comm)
 {
   int j;
   int myproc, numprocs;
@@ -245,17 +298,23 @@ void Partition(gridT *maingrid, gridT **localgrid, MPI_Comm comm)
   MPI_Comm_size(comm, &numprocs);
   MPI_Comm_rank(comm, &myproc);
 
-  if(myproc==0 && VERBOSE>1) printf("\tComputing Graph...\n");
-  // cell graph generates Nge, adjncy, xadj members of maingrid
-  // Useful to create cell graph compatible with ParMETIS to "color" each
-  // cell based on its partitioning on a processor in Partition:GetPartitioning
-  CreateCellGraph(maingrid);
+  if(part) {
+    // partitioning given by Rebalance
+    for(j=0;j<maingrid->Nc;j++)
+      maingrid->part[j]=part[j];
+  } else {
+    if(myproc==0 && VERBOSE>1) printf("\tComputing Graph...\n");
+    // cell graph generates Nge, adjncy, xadj members of maingrid
+    // Useful to create cell graph compatible with ParMETIS to "color" each
+    // cell based on its partitioning on a processor in Partition:GetPartitioning
+    CreateCellGraph(maingrid);
  
-  // use ParMETIS API get get parallelized partioning, this basically 
-  // just assigns each cell to a particular processor number  
-  // (color cells with mapping!)
-  if(myproc==0 && VERBOSE>1) printf("\tComputing Partitioning...\n");
-  GetPartitioning(maingrid,localgrid,myproc,numprocs,comm);
+    // use ParMETIS API get get parallelized partioning, this basically 
+    // just assigns each cell to a particular processor number  
+    // (color cells with mapping!)
+    if(myproc==0 && VERBOSE>1) printf("\tComputing Partitioning...\n");
+    GetPartitioning(maingrid,localgrid,myproc,numprocs,comm);
+  }
 
   // output a list of each cells processor for debugging
   //  PrintVectorToFile(INT, maingrid->part, maingrid->Nc, "CellProcessors.dat",0);
@@ -369,8 +428,8 @@ void InitMainGrid(gridT **grid, int Np, int Ne, int Nc, int myproc)
   (*grid)->periodicbc = MPI_GetValue(DATAFILE,"periodicbc","InitMainGrid",myproc); 
 
   // (x,y) coordinates of vertices
-  (*grid)->xp = (REAL *)SunMalloc((*grid)->Np*sizeof(REAL),"InitMainGrid");
-  (*grid)->yp = (REAL *)SunMalloc((*grid)->Np*sizeof(REAL),"InitMainGrid");
+  (*grid)->xp = (DREAL *)SunMalloc((*grid)->Np*sizeof(DREAL),"InitMainGrid");
+  (*grid)->yp = (DREAL *)SunMalloc((*grid)->Np*sizeof(DREAL),"InitMainGrid");
 
   // periodic bc data
   (*grid)->periodic_point = (int *)SunMalloc((*grid)->Np*sizeof(int),"InitMainGrid");
@@ -379,8 +438,8 @@ void InitMainGrid(gridT **grid, int Np, int Ne, int Nc, int myproc)
   (*grid)->periodic_cell = (int *)SunMalloc((*grid)->Nc*sizeof(int),"InitMainGrid");
 
   // (x,y) coordinates of voronoi points
-  (*grid)->xv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"InitMainGrid");
-  (*grid)->yv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"InitMainGrid");
+  (*grid)->xv = (DREAL *)SunMalloc((*grid)->Nc*sizeof(DREAL),"InitMainGrid");
+  (*grid)->yv = (DREAL *)SunMalloc((*grid)->Nc*sizeof(DREAL),"InitMainGrid");
 
   // Pointers to xp,yp coordinates that define two endpoints of faces (0<edges<Np)
   (*grid)->edges = (int *)SunMalloc(NUMEDGECOLUMNS*(*grid)->Ne*sizeof(int),"InitMainGrid");
@@ -419,8 +478,9 @@ void InitMainGrid(gridT **grid, int Np, int Ne, int Nc, int myproc)
 
   // Depth at Voronoi points
   (*grid)->dv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"InitMainGrid");
-  // Weights for partitioning cell graph
+  // Weights for partitioning cell graph (computational cost and memory)
   (*grid)->vwgt = (int *)SunMalloc((*grid)->Nc*sizeof(int),"InitMainGrid");
+  (*grid)->mwgt = (int *)SunMalloc((*grid)->Nc*sizeof(int),"InitMainGrid");
 
   // Assigned cell partition
   // (this is the number of processor cell is assigned to)
@@ -453,7 +513,8 @@ void InitMainGrid(gridT **grid, int Np, int Ne, int Nc, int myproc)
 void GetDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
 {
   int vertcoord,n, maxgridweight=1000, IntDepth, Nkmax, stairstep, fixdzz, kount=0,subgrid,N,i,segN;
-  REAL *x_sub,*y_sub,*d_sub,dmax;
+  DREAL *x_sub,*y_sub;
+  REAL *d_sub,dmax;
   REAL mindepth, maxdepth, maxdepth0, minimum_depth, *dz;
   char str[BUFFERLENGTH];
   FILE *ofile;
@@ -483,8 +544,8 @@ void GetDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
     {
       segN=MPI_GetValue(DATAFILE,"segN","InterpDepth",myproc);
       N=(grid->maxfaces-2)*(segN+1)*(segN+2)/2;
-      x_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");
-      y_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");
+      x_sub = (DREAL *)SunMalloc(N*sizeof(DREAL),"InterpDepth");
+      y_sub = (DREAL *)SunMalloc(N*sizeof(DREAL),"InterpDepth");
       d_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");    
     }
     for(n=0;n<grid->Nc;n++) {
@@ -557,21 +618,7 @@ void GetDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
 
   if(maxdepth!=maxdepth0 && myproc==0) printf("WARNING!!!!!!!!!  Maximum depth changed after fixing vertical spacing...\n");
 
-  if(Nkmax>1) {
-    if(mindepth!=maxdepth) 
-      for(n=0;n<grid->Nc;n++) {
-	grid->vwgt[n]=(int)(maxgridweight*(float)GetNk(dz,grid->dv[n],Nkmax)/(float)Nkmax);
-	//	grid->vwgt[n] = (int)(maxgridweight*(grid->dv[n]-mindepth)/(maxdepth-mindepth));
-    } else
-      for(n=0;n<grid->Nc;n++) 
-	grid->vwgt[n] = maxgridweight;
-    if(vertcoord!=1 && vertcoord!=5)
-      for(n=0;n<grid->Nc;n++) 
-        grid->vwgt[n] = Nkmax;
-  } else {
-      for(n=0;n<grid->Nc;n++) 
-	grid->vwgt[n] = Nkmax;
-  }
+  SetCellWeights(grid,dz,Nkmax,vertcoord,maxgridweight,myproc);
 
   if(VERBOSE>3) 
     for(n=0;n<grid->Nc;n++) 
@@ -588,6 +635,143 @@ void GetDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
 
 }
 
+/*
+ * Function: SetCellWeights
+ * Usage: SetCellWeights(grid,dz,Nkmax,vertcoord,maxgridweight,myproc);
+ * --------------------------------------------------------------------
+ * Set the weights of the cells for the partitioning.  With partitionweights=0
+ * grid->vwgt is proportional to the number of layers in each cell.  With
+ * partitionweights=1 it is the cost of the cell estimated from the modules that
+ * are turned on in suntans.dat, in units of the cost of one hydrostatic layer, and
+ * with partitionweights=2 it is read from CellCostFile, which contains x, y and
+ * the cost of each cell like depth.dat-voro (e.g. measured in a previous run).
+ * Its rows must be in the order of the cells in the cells file, and the number
+ * of rows and the cell centers x, y are checked against the grid.
+ * grid->mwgt is the memory of each cell estimated from the modules and is only
+ * used when partitionconstraints=2 (see GetPartitioning in partition.c).  Both
+ * are scaled so that the largest weight is maxgridweight.
+ *
+ */
+static void SetCellWeights(gridT *grid, REAL *dz, int Nkmax, int vertcoord, int maxgridweight, int myproc)
+{
+  int n, Nk, nscalars, partitionweights, subgrid, segN=0, wavemodel, Nspectrum=0;
+  REAL layercost, layermemory, columncost, columnmemory, Nsub, *cost, *memory, maxcost=0, maxmemory=0;
+  REAL mindepth=INFTY, maxdepth=0, x, y;
+  char str[BUFFERLENGTH];
+  FILE *ifile;
+
+  partitionweights=(int)MPI_GetValue(DATAFILE,"partitionweights","SetCellWeights",myproc);
+  subgrid=(int)MPI_GetValue(DATAFILE,"subgrid","SetCellWeights",myproc);
+  if(subgrid)
+    segN=(int)MPI_GetValue(DATAFILE,"segN","SetCellWeights",myproc);
+  wavemodel=(int)MPI_GetValue(DATAFILE,"wavemodel","SetCellWeights",myproc);
+  if(wavemodel)
+    Nspectrum=(int)MPI_GetValue(DATAFILE,"Mw","SetCellWeights",myproc)*
+      (int)MPI_GetValue(DATAFILE,"Nw","SetCellWeights",myproc);
+
+  // Cost and memory of each layer and of the depth-independent part of each column
+  nscalars=(MPI_GetValue(DATAFILE,"beta","SetCellWeights",myproc)!=0)+
+    (MPI_GetValue(DATAFILE,"gamma","SetCellWeights",myproc)!=0);
+  if(MPI_GetValue(DATAFILE,"computeSediments","SetCellWeights",myproc))
+    nscalars+=(int)MPI_GetValue(DATAFILE,"Nsize","SetCellWeights",myproc);
+  layercost=1+SCALARCOST*nscalars;
+  layermemory=1+SCALARMEMORY*nscalars;
+  if(MPI_GetValue(DATAFILE,"nonhydrostatic","SetCellWeights",myproc))
+    layercost+=NONHYDROSTATICCOST;
+  if(MPI_GetValue(DATAFILE,"turbmodel","SetCellWeights",myproc))
+    layercost+=TURBULENCECOST;
+  if(MPI_GetValue(DATAFILE,"marshmodel","SetCellWeights",myproc))
+    layercost+=MARSHCOST;
+
+  cost = (REAL *)SunMalloc(grid->Nc*sizeof(REAL),"SetCellWeights");
+  memory = (REAL *)SunMalloc(grid->Nc*sizeof(REAL),"SetCellWeights");
+
+  for(n=0;n<grid->Nc;n++) {
+    if(vertcoord==1 || vertcoord==5)
+      Nk=GetNk(dz,grid->dv[n],Nkmax);
+    else
+      Nk=Nkmax;
+
+    // Number of subgrid points in the cell (see CalculateCellSubgridXY)
+    Nsub=subgrid?(grid->nfaces[n]-2)*(segN+1)*(segN+2)/2:0;
+    columncost=SUBGRIDCOST*Nsub+WAVECOST*Nspectrum;
+    columnmemory=SUBGRIDMEMORY*Nsub+WAVEMEMORY*Nspectrum;
+
+    cost[n]=Nk*layercost+columncost;
+    memory[n]=Nk*layermemory+columnmemory;
+
+    if(grid->dv[n]>maxdepth)
+      maxdepth=grid->dv[n];
+    if(grid->dv[n]<mindepth)
+      mindepth=grid->dv[n];
+  }
+
+  if(partitionweights==2) {
+    MPI_GetFile(str,DATAFILE,"CellCostFile","SetCellWeights",myproc);
+    if((n=MPI_GetSize(str,"SetCellWeights",myproc))!=grid->Nc) {
+      if(myproc==0) printf("Error in SetCellWeights: %s has %d rows but the grid has %d cells.\n",str,n,grid->Nc);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    ifile = MPI_FOpen(str,"r","SetCellWeights",myproc);
+    for(n=0;n<grid->Nc;n++) {
+      x=getfield(ifile,str);
+      y=getfield(ifile,str);
+      if(fabs(x-grid->xv[n])+fabs(y-grid->yv[n])>CELLCOSTTOL*(1+fabs(grid->xv[n])+fabs(grid->yv[n]))) {
+        if(myproc==0) printf("Error in SetCellWeights: row %d of CellCostFile at x=%e, y=%e is not at cell %d (x=%e, y=%e).\n",
+            n+1,x,y,n,grid->xv[n],grid->yv[n]);
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+      }
+      cost[n]=getfield(ifile,str);
+      if(cost[n]<0) {
+        if(myproc==0) printf("Error in SetCellWeights: negative cost %e of cell %d in CellCostFile.\n",cost[n],n);
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+      }
+    }
+    fclose(ifile);
+  }
+
+  for(n=0;n<grid->Nc;n++) {
+    maxcost=Max(maxcost,cost[n]);
+    maxmemory=Max(maxmemory,memory[n]);
+  }
+
+  if(partitionweights==0) {
+    // Weights based on the depth only
+    if(Nkmax>1) {
+      if(mindepth!=maxdepth) 
+        for(n=0;n<grid->Nc;n++) 
+          grid->vwgt[n]=(int)(maxgridweight*(float)GetNk(dz,grid->dv[n],Nkmax)/(float)Nkmax);
+      else
+        for(n=0;n<grid->Nc;n++) 
+          grid->vwgt[n] = maxgridweight;
+      if(vertcoord!=1 && vertcoord!=5)
+        for(n=0;n<grid->Nc;n++) 
+          grid->vwgt[n] = Nkmax;
+    } else {
+      for(n=0;n<grid->Nc;n++) 
+        grid->vwgt[n] = Nkmax;
+    }
+  } else
+    for(n=0;n<grid->Nc;n++) 
+      grid->vwgt[n]=Max(1,(int)(maxgridweight*cost[n]/maxcost));
+
+  for(n=0;n<grid->Nc;n++) 
+    grid->mwgt[n]=Max(1,(int)(maxgridweight*memory[n]/maxmemory));
+
+  if(VERBOSE>2 && myproc==0 && partitionweights) {
+    for(n=0, maxcost=0;n<grid->Nc;n++)
+      maxcost+=grid->vwgt[n];
+    printf("Cell weights from the %s, mean weight %.1f of %d.\n",
+        partitionweights==1?"cost model":"cell cost file",maxcost/grid->Nc,maxgridweight);
+  }
+
+  SunFree(cost,grid->Nc*sizeof(REAL),"SetCellWeights");
+  SunFree(memory,grid->Nc*sizeof(REAL),"SetCellWeights");
+}
+
 /*
  * Function: CreateCellGraph
  * Usage: CreateCellGraph(grid)
@@ -1425,7 +1609,123 @@ static int IsBoundaryCellByNode(int cell, gridT *maingrid, int myproc,
  */
 void InitLocalGrid(gridT **grid)
 {
+  gridT empty = {0};
+
   *grid = (gridT *)SunMalloc(sizeof(gridT),"InitLocalGrid");
+  // pointers are NULL until allocated (see FreeLocalGrid)
+  **grid = empty;
+}
+
+/*
+ * Function: FreeLocalGrid
+ * Usage: FreeLocalGrid(grid);
+ * ---------------------------
+ * Free up the memory of a local grid created by GetGrid or ReadGrid, including
+ * the vertical grid of InitializeVerticalGrid but not the transfer arrays (see 
+ * FreeTransferArrays).  The periodic, eneigh, xi, vwgt and dztop arrays are only 
+ * created by GetGrid.
+ *
+ */
+void FreeLocalGrid(gridT *grid)
+{
+  int i, j, n, neigh, Nc=grid->Nc, Ne=grid->Ne, Np=grid->Np, maxfaces=grid->maxfaces;
+
+  // cells
+  SunFree(grid->mnptr,Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->cells,maxfaces*Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->neigh,maxfaces*Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->normal,maxfaces*Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->face,maxfaces*Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->def,maxfaces*Nc*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->nfaces,Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->xv,Nc*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->yv,Nc*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->dv,Nc*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->Ac,Nc*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->ctop,Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->ctopold,Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->dzbot,Nc*sizeof(REAL),"FreeLocalGrid");
+  for(i=0;i<Nc;i++) {
+    SunFree(grid->dzz[i],grid->Nk[i]*sizeof(REAL),"FreeLocalGrid");
+    SunFree(grid->dzzold[i],grid->Nk[i]*sizeof(REAL),"FreeLocalGrid");
+  }
+  SunFree(grid->dzz,Nc*sizeof(REAL *),"FreeLocalGrid");
+  SunFree(grid->dzzold,Nc*sizeof(REAL *),"FreeLocalGrid");
+  SunFree(grid->Nk,Nc*sizeof(int),"FreeLocalGrid");
+  if(grid->vwgt) SunFree(grid->vwgt,Nc*sizeof(int),"FreeLocalGrid");
+  if(grid->periodic_cell) SunFree(grid->periodic_cell,Nc*sizeof(int),"FreeLocalGrid");
+  if(grid->dztop) SunFree(grid->dztop,Nc*sizeof(REAL),"FreeLocalGrid");
+
+  // edges
+  SunFree(grid->edges,NUMEDGECOLUMNS*Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->mark,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->edge_id,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->eptr,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->grad,2*Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->gradf,2*Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->df,Ne*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->dg,Ne*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->n1,Ne*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->n2,Ne*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->xe,Ne*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->ye,Ne*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->etop,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->etopold,Ne*sizeof(int),"FreeLocalGrid");
+  for(j=0;j<Ne;j++)
+    SunFree(grid->dzf[j],grid->Nkc[j]*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->dzf,Ne*sizeof(REAL *),"FreeLocalGrid");
+  SunFree(grid->hf,Ne*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->dzfB,Ne*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->Nke,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->Nkc,Ne*sizeof(int),"FreeLocalGrid");
+  if(grid->periodic_edge) SunFree(grid->periodic_edge,Ne*sizeof(int),"FreeLocalGrid");
+  if(grid->eneigh) SunFree(grid->eneigh,2*(maxfaces-1)*Ne*sizeof(int),"FreeLocalGrid");
+  if(grid->xi) SunFree(grid->xi,2*(maxfaces-1)*Ne*sizeof(REAL),"FreeLocalGrid");
+
+  // nodes
+  for(n=0;n<Np;n++) {
+    SunFree(grid->ppneighs[n],grid->numppneighs[n]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->peneighs[n],grid->numpeneighs[n]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->pcneighs[n],grid->numpcneighs[n]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->Actotal[n],grid->Nkp[n]*sizeof(REAL),"FreeLocalGrid");
+  }
+  SunFree(grid->ppneighs,Np*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->peneighs,Np*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->pcneighs,Np*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->Actotal,Np*sizeof(REAL *),"FreeLocalGrid");
+  SunFree(grid->numppneighs,Np*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->numpeneighs,Np*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->numpcneighs,Np*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->localtoglobalpoints,Np*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->xp,Np*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->yp,Np*sizeof(DREAL),"FreeLocalGrid");
+  SunFree(grid->Nkp,Np*sizeof(int),"FreeLocalGrid");
+  if(grid->periodic_point) SunFree(grid->periodic_point,Np*sizeof(int),"FreeLocalGrid");
+  if(grid->periodic_point_re) SunFree(grid->periodic_point_re,Np*sizeof(int),"FreeLocalGrid");
+
+  // vertical grid spacing and topology
+  SunFree(grid->dz,grid->Nkmax*sizeof(REAL),"FreeLocalGrid");
+  SunFree(grid->cellp,Nc*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->edgep,Ne*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->celldist,(MAXBCTYPES-1)*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->edgedist,(MAXMARKS-1)*sizeof(int),"FreeLocalGrid");
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    SunFree(grid->cell_send[neigh],grid->num_cells_send[neigh]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->cell_recv[neigh],grid->num_cells_recv[neigh]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->edge_send[neigh],grid->num_edges_send[neigh]*sizeof(int),"FreeLocalGrid");
+    SunFree(grid->edge_recv[neigh],grid->num_edges_recv[neigh]*sizeof(int),"FreeLocalGrid");
+  }
+  SunFree(grid->cell_send,grid->Nneighs*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->cell_recv,grid->Nneighs*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->edge_send,grid->Nneighs*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->edge_recv,grid->Nneighs*sizeof(int *),"FreeLocalGrid");
+  SunFree(grid->num_cells_send,grid->Nneighs*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->num_cells_recv,grid->Nneighs*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->num_edges_send,grid->Nneighs*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->num_edges_recv,grid->Nneighs*sizeof(int),"FreeLocalGrid");
+  SunFree(grid->myneighs,grid->Nneighs*sizeof(int),"FreeLocalGrid");
+
+  SunFree(grid,sizeof(gridT),"FreeLocalGrid");
 }
 
 /*
@@ -1439,12 +1739,13 @@ static void FreeGrid(gridT *grid, int numprocs)
 {
   int proc;
 
-  SunFree(grid->xp,grid->Np*sizeof(REAL),"FreeGrid");
-  SunFree(grid->yp,grid->Np*sizeof(REAL),"FreeGrid");
-  SunFree(grid->xv,grid->Nc*sizeof(REAL),"FreeGrid");
-  SunFree(grid->yv,grid->Nc*sizeof(REAL),"FreeGrid");
+  SunFree(grid->xp,grid->Np*sizeof(DREAL),"FreeGrid");
+  SunFree(grid->yp,grid->Np*sizeof(DREAL),"FreeGrid");
+  SunFree(grid->xv,grid->Nc*sizeof(DREAL),"FreeGrid");
+  SunFree(grid->yv,grid->Nc*sizeof(DREAL),"FreeGrid");
   SunFree(grid->dv,grid->Nc*sizeof(REAL),"FreeGrid");
   SunFree(grid->vwgt,grid->Nc*sizeof(REAL),"FreeGrid");
+  SunFree(grid->mwgt,grid->Nc*sizeof(int),"FreeGrid");
 
   SunFree(grid->edges,NUMEDGECOLUMNS*grid->Ne*sizeof(int),"FreeGrid");
   SunFree(grid->cells,grid->maxfaces*grid->Nc*sizeof(int),"FreeGrid");
@@ -1542,9 +1843,9 @@ static void VertGrid(gridT *maingrid, gridT **localgrid, MPI_Comm comm)
   if(myproc!=0)
     maingrid->dz = (REAL *)SunMalloc(maingrid->Nkmax*sizeof(REAL),"VertGrid");
   // transfer dz, dz0, and dmax to other processors
-  MPI_Bcast((void *)maingrid->dz,maingrid->Nkmax,MPI_DOUBLE,0,comm);
-  MPI_Bcast(&dz0,1,MPI_DOUBLE,0,comm);
-  MPI_Bcast(&dmax,1,MPI_DOUBLE,0,comm);
+  MPI_Bcast((void *)maingrid->dz,maingrid->Nkmax,MPI_REALTYPE,0,comm);
+  MPI_Bcast(&dz0,1,MPI_REALTYPE,0,comm);
+  MPI_Bcast(&dmax,1,MPI_REALTYPE,0,comm);
 
   (*localgrid)->Nkmax = maingrid->Nkmax;
   (*localgrid)->dz = (REAL *)SunMalloc((*localgrid)->Nkmax*sizeof(REAL),"VertGrid");
@@ -1677,18 +1978,21 @@ static void VertGrid(gridT *maingrid, gridT **localgrid, MPI_Comm comm)
   /* compute Nkp for the number of layers for each node*/
   // for each node
   for(i = 0; i < (*localgrid)->Np; i++) {
+    // bogus [TRIANGLE] points have no cell neighbors
+    if((*localgrid)->numpcneighs[i]==0) {
+      (*localgrid)->Nkp[i]=0;
+      continue;
+    }
+
     // look over its cell neighbors and take the max of Nkc
     // for each of the cell neighbors
-    
     maxNk = (*localgrid)->Nk[(*localgrid)->pcneighs[i][0]];
     for(npc = 1; npc < (*localgrid)->numpcneighs[i]; npc++) {
       // find the max
       maxNk = max(maxNk, (*localgrid)->Nk[(*localgrid)->pcneighs[i][npc]]);
     }
-    // set value to max found (-1 if this is a bogus [TRIANGLE] point)
+    // set value to max found
     (*localgrid)->Nkp[i] = maxNk;
-    if((*localgrid)->numpcneighs[i]==0)
-      (*localgrid)->Nkp[i]=0;
   }
 }
 
@@ -2086,9 +2390,9 @@ static void ReOrder(gridT *grid)
   */
 
   // Reorder the data corresponding to cells with the corder array
-  ReOrderRealArray(grid->Ac,corder,tmp,grid->Nc,1,grid->nfaces,grid->grad,grid->maxfaces);
-  ReOrderRealArray(grid->xv,corder,tmp,grid->Nc,1,grid->nfaces,grid->grad,grid->maxfaces);
-  ReOrderRealArray(grid->yv,corder,tmp,grid->Nc,1,grid->nfaces,grid->grad,grid->maxfaces);
+  ReOrderDoubleArray(grid->Ac,corder,(DREAL *)tmp,grid->Nc);
+  ReOrderDoubleArray(grid->xv,corder,(DREAL *)tmp,grid->Nc);
+  ReOrderDoubleArray(grid->yv,corder,(DREAL *)tmp,grid->Nc);
   ReOrderRealArray(grid->dv,corder,tmp,grid->Nc,1,grid->nfaces,grid->grad,grid->maxfaces);
   ReOrderIntArray(grid->cells,corder,(int *)tmp,grid->Nc,grid->maxfaces,grid->nfaces,grid->grad,grid->maxfaces);
   ReOrderIntArray(grid->face,corder,(int *)tmp,grid->Nc,grid->maxfaces,grid->nfaces,grid->grad,grid->maxfaces);
@@ -2099,8 +2403,8 @@ static void ReOrder(gridT *grid)
   ReOrderIntArray(grid->Nk,corder,(int *)tmp,grid->Nc,1,grid->nfaces,grid->grad,grid->maxfaces);
 
   //Reorder the data corresponding to edges with the eorder array
-  ReOrderRealArray(grid->df,eorder,tmp,grid->Ne,1,grid->nfaces,grid->grad,grid->maxfaces);
-  ReOrderRealArray(grid->dg,eorder,tmp,grid->Ne,1,grid->nfaces,grid->grad,grid->maxfaces);
+  ReOrderDoubleArray(grid->df,eorder,(DREAL *)tmp,grid->Ne);
+  ReOrderDoubleArray(grid->dg,eorder,(DREAL *)tmp,grid->Ne);
   ReOrderRealArray(grid->n1,eorder,tmp,grid->Ne,1,grid->nfaces,grid->grad,grid->maxfaces);
   ReOrderRealArray(grid->n2,eorder,tmp,grid->Ne,1,grid->nfaces,grid->grad,grid->maxfaces);
   ReOrderRealArray(grid->xi,eorder,tmp,grid->Ne,2*(grid->maxfaces-1),grid->nfaces,grid->grad,grid->maxfaces);
@@ -2787,13 +3091,13 @@ static void TransferData(gridT *maingrid, gridT **localgrid, int myproc)
       "TransferData");
 
   (*localgrid)->nfaces = (int *)SunMalloc((*localgrid)->Nc*sizeof(int),"TransferData"); //added part
-  (*localgrid)->xv = (REAL *)SunMalloc((*localgrid)->Nc*sizeof(REAL),"TransferData");
-  (*localgrid)->yv = (REAL *)SunMalloc((*localgrid)->Nc*sizeof(REAL),"TransferData");
+  (*localgrid)->xv = (DREAL *)SunMalloc((*localgrid)->Nc*sizeof(DREAL),"TransferData");
+  (*localgrid)->yv = (DREAL *)SunMalloc((*localgrid)->Nc*sizeof(DREAL),"TransferData");
   (*localgrid)->dv = (REAL *)SunMalloc((*localgrid)->Nc*sizeof(REAL),"TransferData");
   (*localgrid)->periodic_cell = (int *)SunMalloc((*localgrid)->Nc*sizeof(int),"TransferData");
 
-  (*localgrid)->xp = (REAL *)SunMalloc(maingrid->Np*sizeof(REAL),"TransferData");
-  (*localgrid)->yp = (REAL *)SunMalloc(maingrid->Np*sizeof(REAL),"TransferData");
+  (*localgrid)->xp = (DREAL *)SunMalloc(maingrid->Np*sizeof(DREAL),"TransferData");
+  (*localgrid)->yp = (DREAL *)SunMalloc(maingrid->Np*sizeof(DREAL),"TransferData");
   (*localgrid)->periodic_point = (int *)SunMalloc(maingrid->Np*sizeof(int),"TransferData");
   (*localgrid)->periodic_point_re = (int *)SunMalloc(maingrid->Np*sizeof(int),"TransferData");
 
@@ -3381,16 +3685,17 @@ static int IsNeighborGlobalByNode(int cell, gridT *maingrid,
 static void Geometry(gridT *maingrid, gridT **grid, int myproc)
 {
   int n, nf, npc, ne, k, j, Nc=(*grid)->Nc, Ne=(*grid)->Ne, Np=(*grid)->Np, p1, p2,grad1,grad2,enei;
-  REAL xt[(*grid)->maxfaces], yt[(*grid)->maxfaces], xc, yc, den, R0, tx, ty, tmag, xdott,dist_x,dist_y;
+  REAL xt[(*grid)->maxfaces], yt[(*grid)->maxfaces], den, R0, tx, ty, tmag, xdott,dist_x,dist_y;
+  DREAL xc, yc;
   
-  (*grid)->Ac = (REAL *)SunMalloc(Nc*sizeof(REAL),"Geometry");
-  (*grid)->df = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
-  (*grid)->dg = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
+  (*grid)->Ac = (DREAL *)SunMalloc(Nc*sizeof(DREAL),"Geometry");
+  (*grid)->df = (DREAL *)SunMalloc(Ne*sizeof(DREAL),"Geometry");
+  (*grid)->dg = (DREAL *)SunMalloc(Ne*sizeof(DREAL),"Geometry");
   (*grid)->def = (REAL *)SunMalloc((*grid)->maxfaces*Nc*sizeof(REAL),"Geometry");
   (*grid)->n1 = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
   (*grid)->n2 = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
-  (*grid)->xe = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
-  (*grid)->ye = (REAL *)SunMalloc(Ne*sizeof(REAL),"Geometry");
+  (*grid)->xe = (DREAL *)SunMalloc(Ne*sizeof(DREAL),"Geometry");
+  (*grid)->ye = (DREAL *)SunMalloc(Ne*sizeof(DREAL),"Geometry");
   (*grid)->xi = (REAL *)SunMalloc(2*((*grid)->maxfaces-1)*Ne*sizeof(REAL),"Geometry");
 
   // add on the total area of all the cells neighboring a point
@@ -3401,12 +3706,15 @@ static void Geometry(gridT *maingrid, gridT **grid, int myproc)
     (*grid)->Actotal[n] = (REAL *)SunMalloc((*grid)->Nkp[n]*sizeof(REAL),"Geometry");
   }
 
-  /* Compute the area of each cell.*/
+  /* Compute the area of each cell, relative to its first vertex so that it
+     is exact in single precision far from the origin.*/
   if(myproc==0 && VERBOSE>2) printf("\t\tComputing cell areas...\n");
   for(n=0;n<Nc;n++) {
+    xc=maingrid->xp[(*grid)->cells[n*(*grid)->maxfaces]];
+    yc=maingrid->yp[(*grid)->cells[n*(*grid)->maxfaces]];
     for(nf=0;nf<(*grid)->nfaces[n];nf++) {
-      xt[nf]=maingrid->xp[(*grid)->cells[n*(*grid)->maxfaces+nf]];
-      yt[nf]=maingrid->yp[(*grid)->cells[n*(*grid)->maxfaces+nf]];
+      xt[nf]=maingrid->xp[(*grid)->cells[n*(*grid)->maxfaces+nf]]-xc;
+      yt[nf]=maingrid->yp[(*grid)->cells[n*(*grid)->maxfaces+nf]]-yc;
     }
     // compute area of cell
     (*grid)->Ac[n] = GetArea(xt,yt,(*grid)->nfaces[n]);
@@ -3709,35 +4017,15 @@ REAL GetArea(REAL *xt, REAL *yt, int Nf)
 
 static void InterpDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
 {
-  int n, Nd, proc, nstart, ncount, scaledepth, subgrid, segN, N, i;
-  REAL *xd, *yd, *d, *x_sub, *y_sub, *d_sub, scaledepthfactor,depthelev,dmax;
-  char str[BUFFERLENGTH];
-  FILE *ifile;
+  int n, proc, nstart, ncount, scaledepth, subgrid, segN=0, N, Nsub, i, m=0;
+  DREAL *x_sub=NULL, *y_sub=NULL;
+  REAL *d_sub=NULL, scaledepthfactor,depthelev,dmax,extent[4];
+  fieldT *field;
   MPI_Status status;
 
   scaledepth=(int)MPI_GetValue(DATAFILE,"scaledepth","InterpDepth",myproc);
   scaledepthfactor=MPI_GetValue(DATAFILE,"scaledepthfactor","InterpDepth",myproc);
   subgrid=MPI_GetValue(DATAFILE,"subgrid","InterpDepth",myproc);
-  if(subgrid)
-  {
-    segN=MPI_GetValue(DATAFILE,"segN","InterpDepth",myproc);
-    N=(grid->maxfaces-2)*(segN+1)*(segN+2)/2;
-    x_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");
-    y_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");
-    d_sub = (REAL *)SunMalloc(N*sizeof(REAL),"InterpDepth");    
-  }
-
-  Nd = MPI_GetSize(INPUTDEPTHFILE,"InterpDepth",myproc);
-  xd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpDepth");
-  yd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpDepth");
-  d = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpDepth");
-
-  ifile = MPI_FOpen(INPUTDEPTHFILE,"r","InterpDepth",myproc);
-  for(n=0;n<Nd;n++) {
-    xd[n]=getfield(ifile,str);
-    yd[n]=getfield(ifile,str);
-    d[n]=getfield(ifile,str);//fabs(getfield(ifile,str));
-  }
 
   nstart = myproc*floor(grid->Nc/numprocs);
   if(myproc==numprocs-1 && grid->Nc%numprocs)
@@ -3745,19 +4033,39 @@ static void InterpDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
   else
     ncount = floor(grid->Nc/numprocs);
 
-  if(!subgrid)
-    Interp(xd,yd,d,Nd,&(grid->xv[nstart]),
-      &(grid->yv[nstart]),&(grid->dv[nstart]),ncount,grid->maxfaces);
-  else {
-    for(n=nstart;n<nstart+ncount;n++)
+  // The subgrid points of all of the cells of this processor, so that they
+  // are interpolated together
+  if(subgrid)
+  {
+    segN=MPI_GetValue(DATAFILE,"segN","InterpDepth",myproc);
+    Nsub=ncount*(grid->maxfaces-2)*(segN+1)*(segN+2)/2;
+    x_sub = (DREAL *)SunMalloc(Nsub*sizeof(DREAL),"InterpDepth");
+    y_sub = (DREAL *)SunMalloc(Nsub*sizeof(DREAL),"InterpDepth");
+    d_sub = (REAL *)SunMalloc(Nsub*sizeof(REAL),"InterpDepth");    
+    for(m=0,n=nstart;n<nstart+ncount;n++) {
+      CalculateCellSubgridXY(&x_sub[m], &y_sub[m], n, segN, grid, myproc);
+      m+=(grid->nfaces[n]-2)*(segN+1)*(segN+2)/2;
+    }
+  }
+
+  // Only read the depth data around the cells of this processor
+  if(!subgrid) {
+    FieldExtent(&(grid->xv[nstart]),&(grid->yv[nstart]),ncount,extent,1);
+    field = ReadField(INPUTDEPTHFILE,extent,myproc);
+    SampleField(field,&(grid->xv[nstart]),&(grid->yv[nstart]),&(grid->dv[nstart]),
+		ncount,grid->maxfaces+1,myproc);
+  } else {
+    FieldExtent(x_sub,y_sub,m,extent,1);
+    field = ReadField(INPUTDEPTHFILE,extent,myproc);
+    SampleField(field,x_sub,y_sub,d_sub,m,grid->maxfaces+1,myproc);
+    for(m=0,n=nstart;n<nstart+ncount;n++)
     {
-      CalculateCellSubgridXY(&x_sub[0], &y_sub[0], n, segN, grid, myproc);
       N=(grid->nfaces[n]-2)*(segN+1)*(segN+2)/2;
-      Interp(xd,yd,d,Nd,&(x_sub[0]), &(y_sub[0]), &(d_sub[0]), N, grid->maxfaces); 
-      dmax=d_sub[0];
+      dmax=d_sub[m];
       for(i=1;i<N;i++)
-        dmax=Max(dmax,d_sub[i]);
+        dmax=Max(dmax,d_sub[m+i]);
       grid->dv[n]=dmax;    
+      m+=N;
     }
   }
 
@@ -3771,7 +4079,7 @@ static void InterpDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
   
  
   if(myproc!=0) 
-    MPI_Send((void *)(&(grid->dv[nstart])),ncount,MPI_DOUBLE,0,1,comm); 
+    MPI_Send((void *)(&(grid->dv[nstart])),ncount,MPI_REALTYPE,0,1,comm); 
   else {
     for(proc=1;proc<numprocs;proc++) {
       nstart = proc*floor(grid->Nc/numprocs);
@@ -3780,14 +4088,12 @@ static void InterpDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm)
       else
 	ncount = floor(grid->Nc/numprocs);
 
-      MPI_Recv((void *)(&(grid->dv[nstart])),ncount,MPI_DOUBLE,proc,1,comm,&status);
+      MPI_Recv((void *)(&(grid->dv[nstart])),ncount,MPI_REALTYPE,proc,1,comm,&status);
     }
   }
-  MPI_Bcast((void *)grid->dv,grid->Nc,MPI_DOUBLE,0,comm);
+  MPI_Bcast((void *)grid->dv,grid->Nc,MPI_REALTYPE,0,comm);
 
-  free(xd);
-  free(yd);
-  free(d);
+  FreeField(field);
   if(subgrid)
   {
     free(x_sub);
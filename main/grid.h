@@ -30,16 +30,16 @@
  *
  */
 typedef struct _gridT {
-  REAL *xp;
-  REAL *yp;
+  DREAL *xp;
+  DREAL *yp;
   int *periodic_point;
   int *periodic_point_re;
   int *periodic_edge;
   int *periodic_cell;
-  REAL *xv;
-  REAL *yv;
-  REAL *xe;
-  REAL *ye;
+  DREAL *xv;
+  DREAL *yv;
+  DREAL *xe;
+  DREAL *ye;
   REAL *dv;
   REAL *dz;
   REAL **dzz;
@@ -116,11 +116,12 @@ typedef struct _gridT {
   int *order;
   int *epart;
   int *vwgt;
+  int *mwgt;
 
-  REAL *df;
-  REAL *dg;
+  DREAL *df;
+  DREAL *dg;
   REAL *def;
-  REAL *Ac;
+  DREAL *Ac;
   REAL *n1;
   REAL *n2;
   REAL *xi;
@@ -166,7 +167,8 @@ typedef enum _boundaryselection{
  *
  */
 void GetGrid(gridT **grid, int myproc, int numprocs, MPI_Comm comm);
-void Partition(gridT *maingrid, gridT **localgrid, MPI_Comm comm);
+void RepartitionGrid(gridT **grid, int *part, int myproc, int numprocs, MPI_Comm comm);
+void Partition(gridT *maingrid, gridT **localgrid, int *part, MPI_Comm comm);
 void InitMainGrid(gridT **grid, int Np, int Ne, int Nc, int myproc);
 void ReadMainGrid(gridT *grid, int myproc);
 void GetDepth(gridT *grid, int myproc, int numprocs, MPI_Comm comm);
@@ -178,5 +180,6 @@ void AllocateTransferArrays(gridT **grid, int myproc, int numprocs, MPI_Comm com
 void FreeTransferArrays(gridT *grid, int myproc, int numprocs, MPI_Comm comm);
 REAL GetArea(REAL *xt, REAL *yt, int Nf);
 void InitLocalGrid(gridT **grid);
+void FreeLocalGrid(gridT *grid);
 
 #endif
@@ -88,10 +88,10 @@ void ReadGrid(gridT **grid, int myproc, int numprocs, MPI_Comm comm)
    *
    */
   (*grid)->nfaces = (int *)SunMalloc((*grid)->Nc*sizeof(REAL),"ReadGrid");	
-  (*grid)->xv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"ReadGrid");
-  (*grid)->yv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"ReadGrid");
+  (*grid)->xv = (DREAL *)SunMalloc((*grid)->Nc*sizeof(DREAL),"ReadGrid");
+  (*grid)->yv = (DREAL *)SunMalloc((*grid)->Nc*sizeof(DREAL),"ReadGrid");
   (*grid)->dv = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"ReadGrid");
-  (*grid)->Ac = (REAL *)SunMalloc((*grid)->Nc*sizeof(REAL),"ReadGrid");
+  (*grid)->Ac = (DREAL *)SunMalloc((*grid)->Nc*sizeof(DREAL),"ReadGrid");
   (*grid)->Nk = (int *)SunMalloc((*grid)->Nc*sizeof(int),"ReadGrid");
 
   //read maxFaces and nfaces from celldata.dat first
@@ -112,12 +112,12 @@ void ReadGrid(gridT **grid, int myproc, int numprocs, MPI_Comm comm)
    *
    * 
    */
-  (*grid)->df = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
-  (*grid)->dg = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
+  (*grid)->df = (DREAL *)SunMalloc((*grid)->Ne*sizeof(DREAL),"ReadGrid");
+  (*grid)->dg = (DREAL *)SunMalloc((*grid)->Ne*sizeof(DREAL),"ReadGrid");
   (*grid)->n1 = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
   (*grid)->n2 = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
-  (*grid)->xe = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
-  (*grid)->ye = (REAL *)SunMalloc((*grid)->Ne*sizeof(REAL),"ReadGrid");
+  (*grid)->xe = (DREAL *)SunMalloc((*grid)->Ne*sizeof(DREAL),"ReadGrid");
+  (*grid)->ye = (DREAL *)SunMalloc((*grid)->Ne*sizeof(DREAL),"ReadGrid");
 
   (*grid)->Nke = (int *)SunMalloc((*grid)->Ne*sizeof(int),"ReadGrid");
   (*grid)->Nkc = (int *)SunMalloc((*grid)->Ne*sizeof(int),"ReadGrid");
@@ -137,8 +137,8 @@ void ReadGrid(gridT **grid, int myproc, int numprocs, MPI_Comm comm)
    *
    */
   Np = (*grid)->Np;
-  (*grid)->xp = (REAL *)SunMalloc(Np*sizeof(REAL),"ReadGrid");
-  (*grid)->yp = (REAL *)SunMalloc(Np*sizeof(REAL),"ReadGrid");
+  (*grid)->xp = (DREAL *)SunMalloc(Np*sizeof(DREAL),"ReadGrid");
+  (*grid)->yp = (DREAL *)SunMalloc(Np*sizeof(DREAL),"ReadGrid");
   (*grid)->localtoglobalpoints = (int*)SunMalloc(Np*sizeof(int),"ReadGrid");
   (*grid)->numppneighs = (int*)SunMalloc(Np*sizeof(int),"ReadGrid");
   (*grid)->ppneighs = (int**)SunMalloc(Np*sizeof(int*),"ReadGrid");
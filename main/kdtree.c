@@ -0,0 +1,321 @@
+/*
+ * File: kdtree.c
+ * --------------
+ * Two-dimensional k-d tree for nearest-neighbor searches on the grid.  The
+ * tree is built once in O(N log N) with a median split and each query costs
+ * O(log N), which replaces the O(N) scans over all cells when locating
+ * stations, profiles and other point data on the grid.
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "memory.h"
+#include "util.h"
+#include "kdtree.h"
+
+static void BuildTree(kdtreeT *tree, int lo, int hi, int depth);
+static void SelectMedian(kdtreeT *tree, int lo, int hi, int mid, int axis);
+static void SwapPoints(kdtreeT *tree, int i, int j);
+static void SearchTree(kdtreeT *tree, int lo, int hi, int depth, DREAL x, DREAL y,
+		       int k, int *n, int *ind, REAL *dist2);
+static int InCell(gridT *grid, int i, DREAL x, DREAL y);
+
+/*
+ * Function: KDTreeBuild
+ * Usage: tree = KDTreeBuild(x,y,index,N);
+ * ---------------------------------------
+ * Builds the tree for the N points x,y.  Queries return index[i] for point i,
+ * or i itself if index is NULL.
+ *
+ */
+kdtreeT *KDTreeBuild(DREAL *x, DREAL *y, int *index, int N) {
+  int i;
+  kdtreeT *tree = (kdtreeT *)SunMalloc(sizeof(kdtreeT),"KDTreeBuild");
+
+  tree->N = N;
+  tree->x = (DREAL *)SunMalloc(N*sizeof(DREAL),"KDTreeBuild");
+  tree->y = (DREAL *)SunMalloc(N*sizeof(DREAL),"KDTreeBuild");
+  tree->index = (int *)SunMalloc(N*sizeof(int),"KDTreeBuild");
+  tree->xmin=tree->ymin=INFTY;
+  tree->xmax=tree->ymax=-INFTY;
+  tree->rmax2=0;
+  for(i=0;i<N;i++) {
+    tree->x[i]=x[i];
+    tree->y[i]=y[i];
+    tree->index[i]=(index==NULL ? i : index[i]);
+    if(x[i]<tree->xmin) tree->xmin=x[i];
+    if(x[i]>tree->xmax) tree->xmax=x[i];
+    if(y[i]<tree->ymin) tree->ymin=y[i];
+    if(y[i]>tree->ymax) tree->ymax=y[i];
+  }
+  BuildTree(tree,0,N,0);
+
+  return tree;
+}
+
+/*
+ * Function: KDTreeFree
+ * Usage: KDTreeFree(tree);
+ * ------------------------
+ * Frees the space allocated by KDTreeBuild.
+ *
+ */
+void KDTreeFree(kdtreeT *tree) {
+  if(tree==NULL)
+    return;
+  SunFree(tree->x,tree->N*sizeof(DREAL),"KDTreeFree");
+  SunFree(tree->y,tree->N*sizeof(DREAL),"KDTreeFree");
+  SunFree(tree->index,tree->N*sizeof(int),"KDTreeFree");
+  SunFree(tree,sizeof(kdtreeT),"KDTreeFree");
+}
+
+/*
+ * Function: KDTreeNearest
+ * Usage: i = KDTreeNearest(tree,x,y,&dist2);
+ * ------------------------------------------
+ * Returns the index of the point nearest to (x,y) and its squared distance
+ * in dist2 if dist2 is not NULL, or -1 if the tree is empty.
+ *
+ */
+int KDTreeNearest(kdtreeT *tree, DREAL x, DREAL y, REAL *dist2) {
+  int ind;
+  REAL d;
+
+  if(KDTreeKNearest(tree,x,y,1,&ind,&d)==0)
+    return -1;
+  if(dist2!=NULL)
+    *dist2=d;
+  return ind;
+}
+
+/*
+ * Function: KDTreeKNearest
+ * Usage: n = KDTreeKNearest(tree,x,y,k,ind,dist2);
+ * ------------------------------------------------
+ * Finds the k points nearest to (x,y), stores their indices and squared distances
+ * in ind and dist2 in order of increasing distance and returns how many were
+ * found, which is less than k only if the tree has fewer than k points.
+ *
+ */
+int KDTreeKNearest(kdtreeT *tree, DREAL x, DREAL y, int k, int *ind, REAL *dist2) {
+  int i, n=0;
+
+  SearchTree(tree,0,tree->N,0,x,y,k,&n,ind,dist2);
+  for(i=0;i<n;i++)
+    ind[i]=tree->index[ind[i]];
+
+  return n;
+}
+
+/*
+ * Function: KDTreeBuildCells
+ * Usage: tree = KDTreeBuildCells(grid);
+ * -------------------------------------
+ * Builds the tree of the Voronoi points of the computational cells on this
+ * processor, i.e. cellp[celldist[0]..celldist[2]), so that queries return
+ * local cell indices and interprocessor boundary cells are never found.  The
+ * bounding box of the tree covers the vertices of these cells, and rmax2 is
+ * the largest squared distance from a Voronoi point to the vertices of its
+ * cell.
+ *
+ */
+kdtreeT *KDTreeBuildCells(gridT *grid) {
+  int i, nf, iptr, N = grid->celldist[2]-grid->celldist[0];
+  DREAL xp, yp, r2, *x = (DREAL *)SunMalloc(N*sizeof(DREAL),"KDTreeBuildCells");
+  DREAL *y = (DREAL *)SunMalloc(N*sizeof(DREAL),"KDTreeBuildCells");
+  int *index = (int *)SunMalloc(N*sizeof(int),"KDTreeBuildCells");
+  kdtreeT *tree;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+    i = grid->cellp[iptr];
+    x[iptr-grid->celldist[0]]=grid->xv[i];
+    y[iptr-grid->celldist[0]]=grid->yv[i];
+    index[iptr-grid->celldist[0]]=i;
+  }
+  tree = KDTreeBuild(x,y,index,N);
+  for(iptr=0;iptr<N;iptr++) {
+    i = index[iptr];
+    for(nf=0;nf<grid->nfaces[i];nf++) {
+      xp = grid->xp[grid->cells[i*grid->maxfaces+nf]];
+      yp = grid->yp[grid->cells[i*grid->maxfaces+nf]];
+      if(xp<tree->xmin) tree->xmin=xp;
+      if(xp>tree->xmax) tree->xmax=xp;
+      if(yp<tree->ymin) tree->ymin=yp;
+      if(yp>tree->ymax) tree->ymax=yp;
+      r2 = (xp-grid->xv[i])*(xp-grid->xv[i])+(yp-grid->yv[i])*(yp-grid->yv[i]);
+      if(r2>tree->rmax2) tree->rmax2=r2;
+    }
+  }
+
+  SunFree(x,N*sizeof(DREAL),"KDTreeBuildCells");
+  SunFree(y,N*sizeof(DREAL),"KDTreeBuildCells");
+  SunFree(index,N*sizeof(int),"KDTreeBuildCells");
+
+  return tree;
+}
+
+/*
+ * Function: KDTreeLocateCell
+ * Usage: i = KDTreeLocateCell(tree,grid,x,y);
+ * -------------------------------------------
+ * Returns the cell in the tree built by KDTreeBuildCells that contains the
+ * point (x,y), or -1 if it is not on this processor.  The containing cell is
+ * usually one of the cells with the nearest Voronoi points, so the
+ * KDTREECANDIDATES nearest cells are tested first.  Since the Voronoi point
+ * of a distorted cell need not be near all of its area, the tree is then
+ * queried again with twice as many cells until the farthest of them is more
+ * than rmax2 away, beyond which no cell can contain the point.
+ *
+ */
+int KDTreeLocateCell(kdtreeT *tree, gridT *grid, DREAL x, DREAL y) {
+  int n, m, k=KDTREECANDIDATES, cell=-1, buf[KDTREECANDIDATES], *ind=buf;
+  REAL dbuf[KDTREECANDIDATES], *dist2=dbuf, dtested=-1;
+
+  if(x<tree->xmin || x>tree->xmax || y<tree->ymin || y>tree->ymax)
+    return -1;
+
+  while(1) {
+    // Cells closer than the farthest of the last query were already tested
+    n = KDTreeKNearest(tree,x,y,k,ind,dist2);
+    for(m=0;m<n;m++)
+      if(dist2[m]>=dtested && InCell(grid,ind[m],x,y)) {
+        cell=ind[m];
+        break;
+      }
+    if(cell!=-1 || n<k || dist2[n-1]>tree->rmax2)
+      break;
+    dtested=dist2[n-1];
+
+    if(ind!=buf) {
+      SunFree(ind,k*sizeof(int),"KDTreeLocateCell");
+      SunFree(dist2,k*sizeof(REAL),"KDTreeLocateCell");
+    }
+    k*=2;
+    ind = (int *)SunMalloc(k*sizeof(int),"KDTreeLocateCell");
+    dist2 = (REAL *)SunMalloc(k*sizeof(REAL),"KDTreeLocateCell");
+  }
+
+  if(ind!=buf) {
+    SunFree(ind,k*sizeof(int),"KDTreeLocateCell");
+    SunFree(dist2,k*sizeof(REAL),"KDTreeLocateCell");
+  }
+  return cell;
+}
+
+/*
+ * Function: InCell
+ * Usage: if(InCell(grid,i,x,y)) {...}
+ * -----------------------------------
+ * Returns 1 if the point (x,y) is inside cell i.  The vertices are taken
+ * relative to (x,y) so that the test is exact in single precision far from
+ * the origin.
+ *
+ */
+static int InCell(gridT *grid, int i, DREAL x, DREAL y) {
+  int nf;
+  REAL xg[grid->maxfaces], yg[grid->maxfaces];
+
+  for(nf=0;nf<grid->nfaces[i];nf++) {
+    xg[nf]=grid->xp[grid->cells[i*grid->maxfaces+nf]]-x;
+    yg[nf]=grid->yp[grid->cells[i*grid->maxfaces+nf]]-y;
+  }
+  return InPolygon(0,0,xg,yg,grid->nfaces[i]);
+}
+
+/*
+ * Function: BuildTree
+ * Usage: BuildTree(tree,0,N,0);
+ * -----------------------------
+ * Orders the points in [lo,hi) so that the median along the splitting axis
+ * is at mid=(lo+hi)/2 with the smaller points before it, and recurses.
+ *
+ */
+static void BuildTree(kdtreeT *tree, int lo, int hi, int depth) {
+  int mid = (lo+hi)/2;
+
+  if(hi-lo<=1)
+    return;
+  SelectMedian(tree,lo,hi,mid,depth%2);
+  BuildTree(tree,lo,mid,depth+1);
+  BuildTree(tree,mid+1,hi,depth+1);
+}
+
+/*
+ * Function: SelectMedian
+ * Usage: SelectMedian(tree,lo,hi,mid,axis);
+ * -----------------------------------------
+ * Quickselect of the point of rank mid in [lo,hi) along axis (0 for x, 1 for y).
+ *
+ */
+static void SelectMedian(kdtreeT *tree, int lo, int hi, int mid, int axis) {
+  int i, store, last;
+  DREAL pivot, *c = (axis==0 ? tree->x : tree->y);
+
+  last = hi-1;
+  while(last>lo) {
+    SwapPoints(tree,(lo+last)/2,last);
+    pivot = c[last];
+    store = lo;
+    for(i=lo;i<last;i++)
+      if(c[i]<pivot)
+	SwapPoints(tree,i,store++);
+    SwapPoints(tree,store,last);
+
+    if(store==mid)
+      return;
+    else if(store<mid)
+      lo = store+1;
+    else
+      last = store-1;
+  }
+}
+
+static void SwapPoints(kdtreeT *tree, int i, int j) {
+  DREAL r;
+  int n;
+
+  r = tree->x[i]; tree->x[i] = tree->x[j]; tree->x[j] = r;
+  r = tree->y[i]; tree->y[i] = tree->y[j]; tree->y[j] = r;
+  n = tree->index[i]; tree->index[i] = tree->index[j]; tree->index[j] = n;
+}
+
+/*
+ * Function: SearchTree
+ * Usage: SearchTree(tree,0,N,0,x,y,k,&n,ind,dist2);
+ * -------------------------------------------------
+ * Recursive k-nearest search.  ind and dist2 hold the n<=k best points found
+ * so far sorted by distance, and the far side of a split is only searched
+ * if it can hold a point closer than the current k-th best.
+ *
+ */
+static void SearchTree(kdtreeT *tree, int lo, int hi, int depth, DREAL x, DREAL y,
+		       int k, int *n, int *ind, REAL *dist2) {
+  int m, mid = (lo+hi)/2;
+  DREAL d, delta;
+
+  if(hi<=lo)
+    return;
+
+  d = (tree->x[mid]-x)*(tree->x[mid]-x)+(tree->y[mid]-y)*(tree->y[mid]-y);
+  if(*n<k || d<dist2[*n-1]) {
+    if(*n<k)
+      (*n)++;
+    for(m=*n-1;m>0 && dist2[m-1]>d;m--) {
+      dist2[m]=dist2[m-1];
+      ind[m]=ind[m-1];
+    }
+    dist2[m]=d;
+    ind[m]=mid;
+  }
+
+  delta = (depth%2==0 ? x-tree->x[mid] : y-tree->y[mid]);
+  if(delta<0) {
+    SearchTree(tree,lo,mid,depth+1,x,y,k,n,ind,dist2);
+    if(*n<k || delta*delta<dist2[*n-1])
+      SearchTree(tree,mid+1,hi,depth+1,x,y,k,n,ind,dist2);
+  } else {
+    SearchTree(tree,mid+1,hi,depth+1,x,y,k,n,ind,dist2);
+    if(*n<k || delta*delta<dist2[*n-1])
+      SearchTree(tree,lo,mid,depth+1,x,y,k,n,ind,dist2);
+  }
+}
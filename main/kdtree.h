@@ -0,0 +1,38 @@
+/*
+ * File: kdtree.h
+ * --------------
+ * Header file for kdtree.c, a two-dimensional k-d tree used to locate
+ * points on the unstructured grid.
+ *
+ */
+#ifndef _kdtree_h
+#define _kdtree_h
+
+#include "suntans.h"
+#include "grid.h"
+
+// Number of nearest cell centers searched first for the cell containing a point
+#define KDTREECANDIDATES 8
+
+/*
+ * Balanced tree stored implicitly in an array: the node of the range [lo,hi)
+ * is mid=(lo+hi)/2, its left subtree is [lo,mid) and its right subtree is
+ * [mid+1,hi), and it splits along x at even depths and along y at odd depths.
+ *
+ */
+typedef struct _kdtreeT {
+  int N;         // number of points
+  DREAL *x, *y;  // point coordinates in tree order
+  int *index;    // index of each point in tree order in the input arrays
+  DREAL xmin, xmax, ymin, ymax; // bounding box of the points, or of the cells for KDTreeBuildCells
+  DREAL rmax2;   // largest squared distance from a Voronoi point to a vertex of its cell (KDTreeBuildCells)
+} kdtreeT;
+
+kdtreeT *KDTreeBuild(DREAL *x, DREAL *y, int *index, int N);
+void KDTreeFree(kdtreeT *tree);
+int KDTreeNearest(kdtreeT *tree, DREAL x, DREAL y, REAL *dist2);
+int KDTreeKNearest(kdtreeT *tree, DREAL x, DREAL y, int k, int *ind, REAL *dist2);
+kdtreeT *KDTreeBuildCells(gridT *grid);
+int KDTreeLocateCell(kdtreeT *tree, gridT *grid, DREAL x, DREAL y);
+
+#endif
@@ -21,6 +21,7 @@
 #include "marsh.h"
 #include "physio.h"
 #include "subgrid.h"
+#include "field.h"
 
 void InterpMarsh(gridT *grid, physT *phys, propT *prop, int myproc,int numprocs);
 void ReadMarshProperties(int myproc);
@@ -62,21 +63,39 @@ void AllocateMarsh(gridT *grid, int myproc)
   marsh->CdV = (REAL *)SunMalloc(grid->Ne*sizeof(REAL),"AllocateMarsh");
 }
 
+/*
+ * Function: MarshRepartition
+ * Usage: MarshRepartition(grid,oldmarsh,myproc);
+ * ----------------------------------------------
+ * Create the marsh model on the repartitioned grid with the parameters of
+ * oldmarsh.  The drag coefficients, marsh heights and marsh tops of oldmarsh
+ * must be transferred by the caller (see MigrateMarsh in rebalance.c), which
+ * then frees it with FreeMarsh.
+ *
+ */
+void MarshRepartition(gridT *grid, marshT *oldmarsh, int myproc)
+{
+  marsh=(marshT *)SunMalloc(sizeof(marshT),"MarshRepartition");
+  *marsh=*oldmarsh;
+  AllocateMarsh(grid,myproc);
+}
+
 /*
  * Function: FreeMarsh
- * Usage: free space for all the variables
- * ----------------------------------------------------
- * Basic sunfree function
+ * Usage: FreeMarsh(oldmarsh,grid,myproc);
+ * ---------------------------------------
+ * Free the marsh model m that was allocated on grid.
  *
  */
-void FreeMarsh(gridT *grid, int myproc)
+void FreeMarsh(marshT *m, gridT *grid, int myproc)
 {
-  free(marsh->CdV);
-  free(marsh->marshtop);
-  free(marsh->hmarsh);
-  free(marsh->hmarshleft);
-  free(marsh->hmarshcenter);
-  free(marsh->CdVcenter);
+  SunFree(m->hmarshcenter,grid->Nc*sizeof(REAL),"FreeMarsh");
+  SunFree(m->CdVcenter,grid->Nc*sizeof(REAL),"FreeMarsh");
+  SunFree(m->marshtop,grid->Ne*sizeof(int),"FreeMarsh");
+  SunFree(m->hmarsh,grid->Ne*sizeof(REAL),"FreeMarsh");
+  SunFree(m->hmarshleft,grid->Ne*sizeof(REAL),"FreeMarsh");
+  SunFree(m->CdV,grid->Ne*sizeof(REAL),"FreeMarsh");
+  SunFree(m,sizeof(marshT),"FreeMarsh");
 }
 
 /*
@@ -153,39 +172,26 @@ void OutputMarsh(gridT *grid,physT *phys, propT *prop,int myproc, int numprocs,
 */
 void InterpMarsh(gridT *grid, physT *phys, propT *prop,int myproc, int numprocs)
 {  
-   int n,Nv,Nh;
-   REAL maxcdv,maxhmarsh,*xv,*yv,*CdVtmp,*xh,*yh,*hmarshtmp;
+   int n;
+   REAL extent[4];
    char str[BUFFERLENGTH],str1[BUFFERLENGTH];
    FILE *fid;
+   fieldT *field;
+
+   FieldExtent(grid->xe,grid->ye,grid->Ne,extent,1);
    // for CdV
    MPI_GetFile(str1,DATAFILE,"InputCdVFile","ReadMarshProperties",myproc);
 
    if(marsh->IntCdV==1){
-     maxcdv=0;
-     Nv = MPI_GetSize(str1,"InterpMarsh",myproc); // change to z0TFILE
-     xv = (REAL *)SunMalloc(Nv*sizeof(REAL),"InterpMarsh");
-     yv = (REAL *)SunMalloc(Nv*sizeof(REAL),"InterpMarsh");
-     CdVtmp = (REAL *)SunMalloc(Nv*sizeof(REAL),"InterpMarsh");
-     fid = MPI_FOpen(str1,"r","InterpMarsh",myproc);
-
-     for(n=0;n<Nv;n++) {
-       xv[n]=getfield(fid,str);
-       yv[n]=getfield(fid,str);
-       CdVtmp[n]=getfield(fid,str); // but cd should be positive already
-       if(maxcdv<CdVtmp[n])
-         maxcdv=CdVtmp[n];
-     }
-     fclose(fid);
-     Interp(xv,yv,CdVtmp,Nv,&(grid->xe[0]), &(grid->ye[0]),&(marsh->CdV[0]),grid->Ne,grid->maxfaces);
+     field = ReadField(str1,extent,myproc);
+     SampleField(field,grid->xe,grid->ye,marsh->CdV,grid->Ne,grid->maxfaces+1,myproc);
+     FreeField(field);
 
      for(n=0;n<grid->Ne;n++)
 	     if(marsh->CdV[n]>=0.95*1.3)
 	       marsh->CdV[n]=1.3;
        else
 	       marsh->CdV[n]=0;
-     free(xv);
-     free(yv);
-     free(CdVtmp);
    } else if(marsh->IntCdV==2){
      if(numprocs==1)
        sprintf(str,"%s-edge",str1);
@@ -216,30 +222,14 @@ void InterpMarsh(gridT *grid, physT *phys, propT *prop,int myproc, int numprocs)
    // for hamrsh
    MPI_GetFile(str1,DATAFILE,"InputhmarshFile","ReadMarshProperties",myproc);
    if(marsh->Inthmarsh==1){
-     maxhmarsh=0;
-     Nh = MPI_GetSize(str1,"InterpMarsh",myproc); 
-     xh = (REAL *)SunMalloc(Nh*sizeof(REAL),"InterpMarsh");
-     yh = (REAL *)SunMalloc(Nh*sizeof(REAL),"InterpMarsh");
-     hmarshtmp = (REAL *)SunMalloc(Nh*sizeof(REAL),"InterpMarsh");
-     fid = MPI_FOpen(str1,"r","InterpMarsh",myproc);
-     for(n=0;n<Nh;n++) {
-       xh[n]=getfield(fid,str);
-       yh[n]=getfield(fid,str);
-       hmarshtmp[n]=getfield(fid,str); // but cd should be positive already
-       if(maxhmarsh<hmarshtmp[n])
-         maxhmarsh=hmarshtmp[n];
-     }
-     fclose(fid);
-     Interp(xh,yh,hmarshtmp,Nh,&(grid->xe[0]), &(grid->ye[0]),&(marsh->hmarsh[0]),grid->Ne,grid->maxfaces);
+     field = ReadField(str1,extent,myproc);
+     SampleField(field,grid->xe,grid->ye,marsh->hmarsh,grid->Ne,grid->maxfaces+1,myproc);
+     FreeField(field);
      for(n=0;n<grid->Ne;n++)
        if(marsh->hmarsh[n]>=0.95*1)
 	       marsh->hmarsh[n]=1;
        else
 	       marsh->CdV[n]=0;
-     free(xh);
-     free(yh);
-     free(hmarshtmp);
-
    } else if(marsh->Inthmarsh==2){
      if(numprocs==1)
        sprintf(str,"%s-edge",str1);
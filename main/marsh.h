@@ -32,8 +32,9 @@ marshT *marsh;
 
 void SetMarshTop(gridT *grid, physT *phys, int myproc);
 void MarshExplicitTerm(gridT *grid, physT *phys, propT *prop, int edgep, REAL theta, REAL dt, int myproc);
-double MarshImplicitTerm(gridT *grid, physT *phys, propT *prop, int edgep, int layer, REAL theta, REAL dt, int myproc);
+REAL MarshImplicitTerm(gridT *grid, physT *phys, propT *prop, int edgep, int layer, REAL theta, REAL dt, int myproc);
 void SetupMarshmodel(gridT *grid,physT *phys, propT *prop,int myproc, int numprocs, MPI_Comm comm);
-void FreeMarsh(gridT *grid, int myproc);
+void MarshRepartition(gridT *grid, marshT *oldmarsh, int myproc);
+void FreeMarsh(marshT *m, gridT *grid, int myproc);
 #endif
 
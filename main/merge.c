@@ -299,7 +299,7 @@ void MergeCellCentered2DArray(REAL *localArray, gridT *grid, int numprocs, int m
 
       localTempMergeArray[iptr-grid->celldist[0]]=localArray[i];
     }
-    MPI_Send(&(localTempMergeArray[0]),grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(&(localTempMergeArray[0]),grid->celldist[2]-grid->celldist[0],MPI_REALTYPE,0,1,comm);       
   } else {
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -308,7 +308,7 @@ void MergeCellCentered2DArray(REAL *localArray, gridT *grid, int numprocs, int m
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(&(localTempMergeArray[0]),Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(&(localTempMergeArray[0]),Nc_all[p],MPI_REALTYPE,p,1,comm,&status);         
 
       for(i=0;i<Nc_all[p];i++) 
 	merged2DArray[mnptr_all[p][i]]=localTempMergeArray[i];
@@ -316,6 +316,43 @@ void MergeCellCentered2DArray(REAL *localArray, gridT *grid, int numprocs, int m
   }
 }
 
+/*
+ * Function: MergeCellCentered2DDouble
+ * Usage: MergeCellCentered2DDouble(grid->xv,mergedArray,grid,numprocs,myproc,comm);
+ * --------------------------------------------------------------------------------
+ * Same as MergeCellCentered2DArray for the DREAL cell coordinates, which are
+ * merged into mergedArray of size mergedGrid->Nc on processor 0.
+ *
+ */
+void MergeCellCentered2DDouble(DREAL *localArray, DREAL *mergedArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm) {
+  int i, p, iptr;
+  DREAL *tmp = (DREAL *)SunMalloc(Nc_max*sizeof(DREAL),"MergeCellCentered2DDouble");
+  MPI_Status status;
+
+  if(myproc!=0) {
+    for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+      i=grid->cellp[iptr];
+
+      tmp[iptr-grid->celldist[0]]=localArray[i];
+    }
+    MPI_Send(tmp,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);
+  } else {
+    for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+      i=grid->cellp[iptr];
+
+      mergedArray[grid->mnptr[i]]=localArray[i];
+    }
+
+    for(p=1;p<numprocs;p++) {
+      MPI_Recv(tmp,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);
+
+      for(i=0;i<Nc_all[p];i++)
+	mergedArray[mnptr_all[p][i]]=tmp[i];
+    }
+  }
+  SunFree(tmp,Nc_max*sizeof(DREAL),"MergeCellCentered2DDouble");
+}
+
 void MergeCellCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm) {
   int i, k, m, p, iptr;
   MPI_Status status;
@@ -329,7 +366,7 @@ void MergeCellCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int
       for(k=0;k<grid->Nk[i];k++)
       	localTempMergeArray[m++]=localArray[i][k];
     }
-    MPI_Send(&(localTempMergeArray[0]),send3DSize[myproc],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(&(localTempMergeArray[0]),send3DSize[myproc],MPI_REALTYPE,0,1,comm);       
   } else {
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -339,7 +376,7 @@ void MergeCellCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(&(localTempMergeArray[0]),send3DSize[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(&(localTempMergeArray[0]),send3DSize[p],MPI_REALTYPE,p,1,comm,&status);         
 
       m=0;
       for(i=0;i<Nc_all[p];i++) {
@@ -361,7 +398,7 @@ void MergeEdgeCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int
       for(k=0;k<grid->Nke[j];k++)
       	localTempEMergeArray[m++]=localArray[j][k];
     }
-    MPI_Send(&(localTempEMergeArray[0]),send3DESize[myproc],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(&(localTempEMergeArray[0]),send3DESize[myproc],MPI_REALTYPE,0,1,comm);       
   } else {
     for(jptr=grid->edgedist[0];jptr<grid->edgedist[EDGEMAX];jptr++) {
       j=grid->edgep[jptr];
@@ -372,7 +409,7 @@ void MergeEdgeCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(&(localTempEMergeArray[0]),send3DESize[p],MPI_DOUBLE,p,1,comm,&status);      
+      MPI_Recv(&(localTempEMergeArray[0]),send3DESize[p],MPI_REALTYPE,p,1,comm,&status);      
       m=0;
       for(j=0;j<Ne_all[p];j++) {
         for(k=0;k<mergedGrid->Nke[eptr_all[p][j]];k++)
@@ -392,6 +429,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   int iptr, i, p, nf, nff, jptr, j;
   int *Ne_int, *Nc_int, *NcNs_int, *Ne2_int;
   REAL *Nc_real, *Ne_real, NcNs_real;
+  DREAL *Nc_dreal, *Ne_dreal;
 
   MPI_Status status;
 
@@ -404,6 +442,8 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
 
   Nc_real=(REAL *)SunMalloc(Nc_max*sizeof(REAL),"MergeGridVariables");
   Ne_real=(REAL *)SunMalloc(Ne_max*sizeof(REAL),"MergeGridVariables");
+  Nc_dreal=(DREAL *)SunMalloc(Nc_max*sizeof(DREAL),"MergeGridVariables");
+  Ne_dreal=(DREAL *)SunMalloc(Ne_max*sizeof(DREAL),"MergeGridVariables");
 
   if(myproc==0){
     // Allocate arrays
@@ -412,10 +452,10 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
 
     // These are all needed to write to netcdf
     mergedGrid->nfaces = (int *)SunMalloc(mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");	
-    mergedGrid->xv = (REAL *)SunMalloc(mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
-    mergedGrid->yv = (REAL *)SunMalloc(mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
+    mergedGrid->xv = (DREAL *)SunMalloc(mergedGrid->Nc*sizeof(DREAL),"MergeGridVariables");
+    mergedGrid->yv = (DREAL *)SunMalloc(mergedGrid->Nc*sizeof(DREAL),"MergeGridVariables");
     mergedGrid->dv = (REAL *)SunMalloc(mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
-    mergedGrid->Ac = (REAL *)SunMalloc(mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
+    mergedGrid->Ac = (DREAL *)SunMalloc(mergedGrid->Nc*sizeof(DREAL),"MergeGridVariables");
   
     mergedGrid->neigh = (int *)SunMalloc(mergedGrid->maxfaces*mergedGrid->Nc*sizeof(int),"MergeGridVariables");
     mergedGrid->face = (int *)SunMalloc(mergedGrid->maxfaces*mergedGrid->Nc*sizeof(int),"MergeGridVariables");
@@ -423,12 +463,12 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     mergedGrid->def = (REAL *)SunMalloc(mergedGrid->maxfaces*mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
     mergedGrid->cells = (int *)SunMalloc(mergedGrid->maxfaces*mergedGrid->Nc*sizeof(REAL),"MergeGridVariables");
 
-    mergedGrid->df = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
-    mergedGrid->dg = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
+    mergedGrid->df = (DREAL *)SunMalloc(mergedGrid->Ne*sizeof(DREAL),"MergeGridVariables");
+    mergedGrid->dg = (DREAL *)SunMalloc(mergedGrid->Ne*sizeof(DREAL),"MergeGridVariables");
     mergedGrid->n1 = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
     mergedGrid->n2 = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
-    mergedGrid->xe = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
-    mergedGrid->ye = (REAL *)SunMalloc(mergedGrid->Ne*sizeof(REAL),"MergeGridVariables");
+    mergedGrid->xe = (DREAL *)SunMalloc(mergedGrid->Ne*sizeof(DREAL),"MergeGridVariables");
+    mergedGrid->ye = (DREAL *)SunMalloc(mergedGrid->Ne*sizeof(DREAL),"MergeGridVariables");
   
     mergedGrid->grad = (int *)SunMalloc(2*mergedGrid->Ne*sizeof(int),"MergeGridVariables");
     mergedGrid->gradf = (int *)SunMalloc(2*mergedGrid->Ne*sizeof(int),"MergeGridVariables");
@@ -469,9 +509,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
-      Nc_real[iptr-grid->celldist[0]]=grid->xv[i];
+      Nc_dreal[iptr-grid->celldist[0]]=grid->xv[i];
     }
-    MPI_Send(Nc_real,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Nc_dreal,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -479,9 +519,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Nc_real,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Nc_dreal,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Nc_all[p];i++)
-	mergedGrid->xv[mnptr_all[p][i]]=Nc_real[i];
+	mergedGrid->xv[mnptr_all[p][i]]=Nc_dreal[i];
     }
   }
 
@@ -489,9 +529,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
-      Nc_real[iptr-grid->celldist[0]]=grid->yv[i];
+      Nc_dreal[iptr-grid->celldist[0]]=grid->yv[i];
     }
-    MPI_Send(Nc_real,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Nc_dreal,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -499,9 +539,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Nc_real,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Nc_dreal,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Nc_all[p];i++)
-        mergedGrid->yv[mnptr_all[p][i]]=Nc_real[i];
+        mergedGrid->yv[mnptr_all[p][i]]=Nc_dreal[i];
     }
   }
 
@@ -509,9 +549,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
    if(myproc!=0) {
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
-      Nc_real[iptr-grid->celldist[0]]=grid->Ac[i];
+      Nc_dreal[iptr-grid->celldist[0]]=grid->Ac[i];
     }
-    MPI_Send(Nc_real,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Nc_dreal,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -519,9 +559,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Nc_real,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Nc_dreal,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Nc_all[p];i++)
-	mergedGrid->Ac[mnptr_all[p][i]]=Nc_real[i];
+	mergedGrid->Ac[mnptr_all[p][i]]=Nc_dreal[i];
     }
   }  
 
@@ -531,7 +571,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
       i=grid->cellp[iptr];
       Nc_real[iptr-grid->celldist[0]]=grid->dv[i];
     }
-    MPI_Send(Nc_real,grid->celldist[2]-grid->celldist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Nc_real,grid->celldist[2]-grid->celldist[0],MPI_REALTYPE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
       i=grid->cellp[iptr];
@@ -539,7 +579,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Nc_real,Nc_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Nc_real,Nc_all[p],MPI_REALTYPE,p,1,comm,&status);         
       for(i=0;i<Nc_all[p];i++)
 	mergedGrid->dv[mnptr_all[p][i]]=Nc_real[i];
     }
@@ -709,9 +749,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
-      Ne_real[iptr-grid->edgedist[0]]=grid->xe[i];
+      Ne_dreal[iptr-grid->edgedist[0]]=grid->xe[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_dreal,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -719,9 +759,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_dreal,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
-	mergedGrid->xe[eptr_all[p][i]]=Ne_real[i];
+	mergedGrid->xe[eptr_all[p][i]]=Ne_dreal[i];
     }
   }
 
@@ -729,9 +769,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
-      Ne_real[iptr-grid->edgedist[0]]=grid->ye[i];
+      Ne_dreal[iptr-grid->edgedist[0]]=grid->ye[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_dreal,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -739,9 +779,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_dreal,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
-	mergedGrid->ye[eptr_all[p][i]]=Ne_real[i];
+	mergedGrid->ye[eptr_all[p][i]]=Ne_dreal[i];
     }
   }
 
@@ -749,9 +789,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
-      Ne_real[iptr-grid->edgedist[0]]=grid->df[i];
+      Ne_dreal[iptr-grid->edgedist[0]]=grid->df[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_dreal,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -759,9 +799,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_dreal,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
-	mergedGrid->df[eptr_all[p][i]]=Ne_real[i];
+	mergedGrid->df[eptr_all[p][i]]=Ne_dreal[i];
     }
   }
 
@@ -769,9 +809,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   if(myproc!=0) {
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
-      Ne_real[iptr-grid->edgedist[0]]=grid->dg[i];
+      Ne_dreal[iptr-grid->edgedist[0]]=grid->dg[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_dreal,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -779,9 +819,9 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_dreal,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
-	mergedGrid->dg[eptr_all[p][i]]=Ne_real[i];
+	mergedGrid->dg[eptr_all[p][i]]=Ne_dreal[i];
     }
   }
 
@@ -791,7 +831,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
       i=grid->edgep[iptr];
       Ne_real[iptr-grid->edgedist[0]]=grid->n1[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_REALTYPE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -799,7 +839,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_real,Ne_all[p],MPI_REALTYPE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
 	mergedGrid->n1[eptr_all[p][i]]=Ne_real[i];
     }
@@ -811,7 +851,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
       i=grid->edgep[iptr];
       Ne_real[iptr-grid->edgedist[0]]=grid->n2[i];
     }
-    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_DOUBLE,0,1,comm);       
+    MPI_Send(Ne_real,grid->edgedist[EDGEMAX]-grid->edgedist[0],MPI_REALTYPE,0,1,comm);       
   } else {//myproc==0
     for(iptr=grid->edgedist[0];iptr<grid->edgedist[EDGEMAX];iptr++) {
       i=grid->edgep[iptr];
@@ -819,7 +859,7 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
     }
 
     for(p=1;p<numprocs;p++) {
-      MPI_Recv(Ne_real,Ne_all[p],MPI_DOUBLE,p,1,comm,&status);         
+      MPI_Recv(Ne_real,Ne_all[p],MPI_REALTYPE,p,1,comm,&status);         
       for(i=0;i<Ne_all[p];i++)
 	mergedGrid->n2[eptr_all[p][i]]=Ne_real[i];
     }
@@ -873,6 +913,8 @@ static void MergeGridVariables(gridT *grid, int numprocs, int myproc, MPI_Comm c
   SunFree(Ne2_int,2*Ne_max*sizeof(int),"MergeGridVariables");
   SunFree(Nc_real,Nc_max*sizeof(REAL),"MergeGridVariables");
   SunFree(Ne_real,Ne_max*sizeof(REAL),"MergeGridVariables");
+  SunFree(Nc_dreal,Nc_max*sizeof(DREAL),"MergeGridVariables");
+  SunFree(Ne_dreal,Ne_max*sizeof(DREAL),"MergeGridVariables");
 
 }
 
@@ -25,6 +25,7 @@ REAL *localTempMergeArray, *localTempEMergeArray, *merged2DArray, **merged3DArra
 
 void InitializeMerging(gridT *grid, int mergeedges, int numprocs, int myproc, MPI_Comm comm);
 void MergeCellCentered2DArray(REAL *localArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm);
+void MergeCellCentered2DDouble(DREAL *localArray, DREAL *mergedArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm);
 void MergeCellCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm);
 void MergeEdgeCentered3DArray(REAL **localArray, gridT *grid, int numprocs, int myproc, MPI_Comm comm);
 void FreeMergingArrays(gridT *grid, int myproc);
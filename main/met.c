@@ -6,22 +6,29 @@
 #include "met.h"
 //#include "phys.h"
 #include "mynetcdf.h"
+#include "kdtree.h"
 
 /* Private functions */
-void calcInterpWeights(gridT *grid, propT *prop, REAL *xo, REAL *yo, int Ns, int **index, REAL **klambda,int myproc);
+static metweightT *MetWeights(gridT *grid, propT *prop, DREAL *x, DREAL *y, int Ns, metweightT **known, int nknown, int myproc);
+static int CompareMetPoints(const void *a, const void *b);
 static REAL semivariogram(int varmodel, REAL nugget, REAL sill, REAL range, REAL D);
-void FindNearestMetStations(propT *prop, gridT *grid, metinT **metin, int myproc);
-void weightInterpArray(REAL **D, REAL **klambda, gridT *grid, int Ns, int **index, int nt, REAL **Dout);
-void weightInterpField(REAL *D, REAL **klambda, gridT *grid, int Ns, int **index, REAL *Dout);
+static void InterpMetFields(gridT *grid, int nf, metweightT **W, REAL **src, REAL **dst);
+static int MetGridInterval(DREAL *x, int n, DREAL xi, REAL *r);
+static void MetGridWindow(gridT *grid, metinT *metin, int myproc);
+static metweightT *MetGridWeights(gridT *grid, metinT *metin, int myproc);
 static REAL specifichumidity(REAL RH, REAL Ta, REAL Pair);
 static REAL qsat(REAL Tw, REAL Pair);
+static REAL dqsat(REAL Tw, REAL Pair);
 static REAL satvap(REAL Ta, REAL Pair);
 static REAL vappres(REAL Ta, REAL RH, REAL Pair);
 static REAL longwave_berliand(REAL Ta, REAL Tw, REAL C_cloud, REAL RH, REAL Pair);
-static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud);
-static void cor30a(REAL *y);
-static REAL psiu_30(REAL zet);
-static REAL psit_30(REAL zet);
+static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud, REAL *dHdTw);
+static void cor30a(coareT *y);
+static REAL psiu_30(REAL zet, REAL *dpsi);
+static REAL psit_30(REAL zet, REAL *dpsi);
+
+// Weights being sorted by CompareMetPoints
+static metweightT *sortweights;
 
 /* Start of functions */
 
@@ -35,37 +42,34 @@ void InitialiseMetFields(propT *prop, gridT *grid, metinT *metin, metT *met, int
  
   int retval;
   int i,j;
+  metweightT *W[NMETVAR];
+  REAL *src[NMETVAR], *dst[NMETVAR];
   
 
  /*  Read in the coordinate data*/
  if(VERBOSE>3 && myproc==0) printf("Reading netcdf coordinate data...\n");
  ReadMetNCcoord(prop,grid,metin, myproc);
 
- /* Find the nearest met points to each grid point */
- FindNearestMetStations(prop, grid, &metin, myproc);
- 
  /* Calculating the interpolation weights for each variable*/
- calcInterpWeights(grid,prop, metin->x_Uwind, metin->y_Uwind, 
-    metin->max_nearest_Uwind, metin->nearest_Uwind, metin->WUwind, myproc);
- calcInterpWeights(grid,prop, metin->x_Vwind, metin->y_Vwind,
-     metin->max_nearest_Vwind, metin->nearest_Vwind, metin->WVwind, myproc);
- calcInterpWeights(grid,prop, metin->x_Tair, metin->y_Tair,
-    metin->max_nearest_Tair, metin->nearest_Tair, metin->WTair, myproc);
- calcInterpWeights(grid,prop, metin->x_Pair, metin->y_Pair,
-    metin->max_nearest_Pair, metin->nearest_Pair, metin->WPair, myproc);
- calcInterpWeights(grid,prop, metin->x_rain, metin->y_rain,
-    metin->max_nearest_rain, metin->nearest_rain, metin->Wrain, myproc);
- calcInterpWeights(grid,prop, metin->x_RH, metin->y_RH,
-    metin->max_nearest_RH, metin->nearest_RH, metin->WRH, myproc);
- calcInterpWeights(grid,prop, metin->x_cloud, metin->y_cloud,
-    metin->max_nearest_cloud, metin->nearest_cloud, metin->Wcloud, myproc);
+ if(prop->metgrid){
+   metin->WUwind = metin->WVwind = metin->WTair = metin->WPair = metin->Wrain = metin->WRH = metin->Wcloud
+     = MetGridWeights(grid,metin,myproc);
+ }else{
+   W[0] = metin->WUwind = MetWeights(grid,prop,metin->x_Uwind,metin->y_Uwind,metin->NUwind,W,0,myproc);
+   W[1] = metin->WVwind = MetWeights(grid,prop,metin->x_Vwind,metin->y_Vwind,metin->NVwind,W,1,myproc);
+   W[2] = metin->WTair = MetWeights(grid,prop,metin->x_Tair,metin->y_Tair,metin->NTair,W,2,myproc);
+   W[3] = metin->WPair = MetWeights(grid,prop,metin->x_Pair,metin->y_Pair,metin->NPair,W,3,myproc);
+   W[4] = metin->Wrain = MetWeights(grid,prop,metin->x_rain,metin->y_rain,metin->Nrain,W,4,myproc);
+   W[5] = metin->WRH = MetWeights(grid,prop,metin->x_RH,metin->y_RH,metin->NRH,W,5,myproc);
+   W[6] = metin->Wcloud = MetWeights(grid,prop,metin->x_cloud,metin->y_cloud,metin->Ncloud,W,6,myproc);
+ }
  
  if(VERBOSE>3 && myproc==0){
     printf("Uwind weights:\n");
     for(i=0;i<grid->Nc;i++){
 	    printf("xv=%f, yv=%f, Weights: ",grid->xv[i],grid->yv[i]);
-	    for(j=0;j<metin->NUwind;j++){
-	      printf("%f, ",metin->WUwind[i][j]);
+	    for(j=metin->WUwind->rowptr[i];j<metin->WUwind->rowptr[i+1];j++){
+	      printf("%d: %f, ",metin->WUwind->col[j],metin->WUwind->w[j]);
 	    }
 	    printf("\n");
     }
@@ -73,14 +77,11 @@ void InitialiseMetFields(propT *prop, gridT *grid, metinT *metin, metT *met, int
  
  /*  Interpolate the heights of some variables */
  if(VERBOSE>1 && myproc==0) printf("Interpolating height coordinates onto grid...");
- weightInterpField(metin->z_Uwind, metin->WUwind, grid,
-    metin->max_nearest_Uwind, metin->nearest_Uwind, met->z_Uwind);
- weightInterpField(metin->z_Vwind, metin->WVwind, grid,
-    metin->max_nearest_Vwind, metin->nearest_Vwind, met->z_Vwind);
- weightInterpField(metin->z_Tair, metin->WTair, grid,
-    metin->max_nearest_Tair, metin->nearest_Tair, met->z_Tair);
- weightInterpField(metin->z_RH, metin->WRH, grid,
-    metin->max_nearest_RH, metin->nearest_RH, met->z_RH);
+ W[0]=metin->WUwind; src[0]=metin->z_Uwind; dst[0]=met->z_Uwind;
+ W[1]=metin->WVwind; src[1]=metin->z_Vwind; dst[1]=met->z_Vwind;
+ W[2]=metin->WTair; src[2]=metin->z_Tair; dst[2]=met->z_Tair;
+ W[3]=metin->WRH; src[3]=metin->z_RH; dst[3]=met->z_RH;
+ InterpMetFields(grid,4,W,src,dst);
  if(VERBOSE>1 && myproc==0) printf("Done.\n");
   
 } // End of InitialiseMetFields
@@ -93,8 +94,10 @@ void InitialiseMetFields(propT *prop, gridT *grid, metinT *metin, metT *met, int
 */
 void updateMetData(propT *prop, gridT *grid, metinT *metin, metT *met, int myproc, MPI_Comm comm){
   
-  int j,i,iptr, t0, t1, t2; 
+  int j,i,iptr,n, t0, t1, t2; 
   REAL dt, r1, r2;
+  metweightT *W[NMETVAR*NTmet];
+  REAL *src[NMETVAR*NTmet], *dst[NMETVAR*NTmet];
    
   t1 = getTimeRec(prop->nctime,metin->time,metin->nt);
     
@@ -108,21 +111,17 @@ void updateMetData(propT *prop, gridT *grid, metinT *metin, metT *met, int mypro
       metin->t0=t1-1;
       metin->t2=t1+1;
       
-      /* Interpolate the two time steps onto the grid*/
-      weightInterpArray(metin->Uwind, metin->WUwind, grid,
-	  metin->max_nearest_Uwind, metin->nearest_Uwind, NTmet, met->Uwind_t);
-      weightInterpArray(metin->Vwind, metin->WVwind, grid,
-	  metin->max_nearest_Vwind, metin->nearest_Vwind, NTmet, met->Vwind_t);
-      weightInterpArray(metin->Tair, metin->WTair, grid,
-	  metin->max_nearest_Tair, metin->nearest_Tair, NTmet, met->Tair_t);
-      weightInterpArray(metin->Pair, metin->WPair, grid,
-      	metin->max_nearest_Pair, metin->nearest_Pair, NTmet, met->Pair_t);
-      weightInterpArray(metin->rain, metin->Wrain, grid,
-	  metin->max_nearest_rain, metin->nearest_rain, NTmet, met->rain_t);
-      weightInterpArray(metin->RH, metin->WRH, grid,
-	  metin->max_nearest_RH, metin->nearest_RH, NTmet, met->RH_t);
-      weightInterpArray(metin->cloud, metin->Wcloud, grid,
-	  metin->max_nearest_cloud, metin->nearest_cloud, NTmet, met->cloud_t);
+      /* Interpolate the time steps of all of the variables onto the grid*/
+      for(n=0;n<NTmet;n++){
+	W[n*NMETVAR]=metin->WUwind; src[n*NMETVAR]=metin->Uwind[n]; dst[n*NMETVAR]=met->Uwind_t[n];
+	W[n*NMETVAR+1]=metin->WVwind; src[n*NMETVAR+1]=metin->Vwind[n]; dst[n*NMETVAR+1]=met->Vwind_t[n];
+	W[n*NMETVAR+2]=metin->WTair; src[n*NMETVAR+2]=metin->Tair[n]; dst[n*NMETVAR+2]=met->Tair_t[n];
+	W[n*NMETVAR+3]=metin->WPair; src[n*NMETVAR+3]=metin->Pair[n]; dst[n*NMETVAR+3]=met->Pair_t[n];
+	W[n*NMETVAR+4]=metin->Wrain; src[n*NMETVAR+4]=metin->rain[n]; dst[n*NMETVAR+4]=met->rain_t[n];
+	W[n*NMETVAR+5]=metin->WRH; src[n*NMETVAR+5]=metin->RH[n]; dst[n*NMETVAR+5]=met->RH_t[n];
+	W[n*NMETVAR+6]=metin->Wcloud; src[n*NMETVAR+6]=metin->cloud[n]; dst[n*NMETVAR+6]=met->cloud_t[n];
+      }
+      InterpMetFields(grid,NMETVAR*NTmet,W,src,dst);
     }
     
     /* Do a linear temporal interpolation */
@@ -186,7 +185,7 @@ void updateMetData(propT *prop, gridT *grid, metinT *metin, metT *met, int mypro
 *
 */
 void AllocateMet(propT *prop, gridT *grid, metT **met , int myproc){
-  int j, k, n;
+  int k, n;
   int Nc = grid->Nc;
   
   if(VERBOSE>3 && myproc==0) printf("Allocating met structure...\n");
@@ -215,8 +214,33 @@ void AllocateMet(propT *prop, gridT *grid, metT **met , int myproc){
   (*met)->Tstar = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
   (*met)->qstar = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
   (*met)->EP = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
-  (*met)->Htmp = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
-  (*met)->xtmp = (REAL *)SunMalloc(19*sizeof(REAL),"AllocateMet"); 
+  (*met)->dHdT = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+
+  (*met)->coare = (coareT *)SunMalloc(sizeof(coareT),"AllocateMet");
+  (*met)->coare->N = 0;
+  (*met)->coare->cell = (int *)SunMalloc(Nc*sizeof(int),"AllocateMet");
+  (*met)->coare->u = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->us = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->ts = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->t = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->Qs = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->dQs = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->Q = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->P = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->zu = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->zt = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->zq = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->hsb = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->hlb = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->dhsb = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->dhlb = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->rhoa = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->usr = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->tsr = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->qsr = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+  (*met)->coare->Cd = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateMet");
+
+  AllocateRadiation(grid,prop,&((*met)->rad),myproc);
 
   (*met)->Uwind_t = (REAL **)SunMalloc(NTmet*sizeof(REAL *),"AllocateMet");
   (*met)->Vwind_t = (REAL **)SunMalloc(NTmet*sizeof(REAL *),"AllocateMet");
@@ -259,7 +283,7 @@ void AllocateMet(propT *prop, gridT *grid, metT **met , int myproc){
       (*met)->Tstar[k] = 0.0;
       (*met)->qstar[k] = 0.0;
       (*met)->EP[k] = 0.0;
-      (*met)->Htmp[k] = 0.0;
+      (*met)->dHdT[k] = 0.0;
       
       for(n=0;n<NTmet;n++){
 	  (*met)->Uwind_t[n][k] = 0.0;
@@ -271,9 +295,6 @@ void AllocateMet(propT *prop, gridT *grid, metT **met , int myproc){
 	  (*met)->cloud_t[n][k] = 0.0;
       }  
   }
-  for(j=0;j<19;j++){
-    (*met)->xtmp[j]=0.0;
-  }
 } // End of function
   
 /*
@@ -283,7 +304,7 @@ void AllocateMet(propT *prop, gridT *grid, metT **met , int myproc){
 *
 */
 void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
-  int j, k, n, retval;
+  int j, n, retval;
   size_t NUwind;
   size_t NVwind;
   size_t NTair;
@@ -299,13 +320,21 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
   
   
   /* Scalars */
-  (*metin)->NUwind = returndimlen(prop->metncid,"NUwind");
-  (*metin)->NVwind = returndimlen(prop->metncid,"NVwind");
-  (*metin)->NTair = returndimlen(prop->metncid,"NTair");
-  (*metin)->NPair = returndimlen(prop->metncid,"NPair");
-  (*metin)->Nrain = returndimlen(prop->metncid,"Nrain");
-  (*metin)->NRH = returndimlen(prop->metncid,"NRH");
-  (*metin)->Ncloud = returndimlen(prop->metncid,"Ncloud");
+  if(prop->metgrid){
+    // All of the variables are at the points of the window of the met grid of this processor
+    ReadMetNCgrid(prop,*metin,myproc);
+    MetGridWindow(grid,*metin,myproc);
+    (*metin)->NUwind = (*metin)->NVwind = (*metin)->NTair = (*metin)->NPair = (*metin)->Nrain
+      = (*metin)->NRH = (*metin)->Ncloud = (*metin)->nxw*(*metin)->nyw;
+  }else{
+    (*metin)->NUwind = returndimlen(prop->metncid,"NUwind");
+    (*metin)->NVwind = returndimlen(prop->metncid,"NVwind");
+    (*metin)->NTair = returndimlen(prop->metncid,"NTair");
+    (*metin)->NPair = returndimlen(prop->metncid,"NPair");
+    (*metin)->Nrain = returndimlen(prop->metncid,"Nrain");
+    (*metin)->NRH = returndimlen(prop->metncid,"NRH");
+    (*metin)->Ncloud = returndimlen(prop->metncid,"Ncloud");
+  }
   (*metin)->nt = returndimlen(prop->metncid,"nt");
 
   (*metin)->t0 = -1;
@@ -335,46 +364,30 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
   }
   /* Allocate the coordinate vectors*/
   //printf("Allocating coordinates...\n");
-  (*metin)->x_Uwind = (REAL *)SunMalloc(NUwind*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_Vwind = (REAL *)SunMalloc(NVwind*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_Tair = (REAL *)SunMalloc(NTair*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_Pair = (REAL *)SunMalloc(NPair*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_rain = (REAL *)SunMalloc(Nrain*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_RH = (REAL *)SunMalloc(NRH*sizeof(REAL),"AllocateMetIn");
-  (*metin)->x_cloud = (REAL *)SunMalloc(Ncloud*sizeof(REAL),"AllocateMetIn");
+  (*metin)->x_Uwind = (DREAL *)SunMalloc(NUwind*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_Vwind = (DREAL *)SunMalloc(NVwind*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_Tair = (DREAL *)SunMalloc(NTair*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_Pair = (DREAL *)SunMalloc(NPair*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_rain = (DREAL *)SunMalloc(Nrain*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_RH = (DREAL *)SunMalloc(NRH*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->x_cloud = (DREAL *)SunMalloc(Ncloud*sizeof(DREAL),"AllocateMetIn");
   
-  (*metin)->y_Uwind = (REAL *)SunMalloc(NUwind*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_Vwind = (REAL *)SunMalloc(NVwind*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_Tair = (REAL *)SunMalloc(NTair*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_Pair = (REAL *)SunMalloc(NPair*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_rain = (REAL *)SunMalloc(Nrain*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_RH = (REAL *)SunMalloc(NRH*sizeof(REAL),"AllocateMetIn");
-  (*metin)->y_cloud = (REAL *)SunMalloc(Ncloud*sizeof(REAL),"AllocateMetIn");
+  (*metin)->y_Uwind = (DREAL *)SunMalloc(NUwind*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_Vwind = (DREAL *)SunMalloc(NVwind*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_Tair = (DREAL *)SunMalloc(NTair*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_Pair = (DREAL *)SunMalloc(NPair*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_rain = (DREAL *)SunMalloc(Nrain*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_RH = (DREAL *)SunMalloc(NRH*sizeof(DREAL),"AllocateMetIn");
+  (*metin)->y_cloud = (DREAL *)SunMalloc(Ncloud*sizeof(DREAL),"AllocateMetIn");
 
   (*metin)->z_Uwind = (REAL *)SunMalloc(NUwind*sizeof(REAL),"AllocateMetIn");
   (*metin)->z_Vwind = (REAL *)SunMalloc(NVwind*sizeof(REAL),"AllocateMetIn");
   (*metin)->z_Tair = (REAL *)SunMalloc(NTair*sizeof(REAL),"AllocateMetIn");
   (*metin)->z_RH = (REAL *)SunMalloc(NRH*sizeof(REAL),"AllocateMetIn"); 
   
-  (*metin)->time = (REAL *)SunMalloc(nt*sizeof(REAL),"AllocateMetIn");
+  (*metin)->time = (DREAL *)SunMalloc(nt*sizeof(DREAL),"AllocateMetIn");
   
-  /* Allocate the 2-D grid based weights */
-  (*metin)->WUwind = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->WVwind = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->WTair = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->WPair = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->Wrain = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->WRH = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  (*metin)->Wcloud = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateMetIn");
-  for(j=0;j<Nc;j++){
-      (*metin)->WUwind[j] = (REAL *)SunMalloc(NUwind*sizeof(REAL),"AllocateMetIn");
-      (*metin)->WVwind[j] = (REAL *)SunMalloc(NVwind*sizeof(REAL),"AllocateMetIn");
-      (*metin)->WTair[j] = (REAL *)SunMalloc(NTair*sizeof(REAL),"AllocateMetIn");
-      (*metin)->WPair[j] = (REAL *)SunMalloc(NPair*sizeof(REAL),"AllocateMetIn");
-      (*metin)->Wrain[j] = (REAL *)SunMalloc(Nrain*sizeof(REAL),"AllocateMetIn");
-      (*metin)->WRH[j] = (REAL *)SunMalloc(NRH*sizeof(REAL),"AllocateMetIn");
-      (*metin)->Wcloud[j] = (REAL *)SunMalloc(Ncloud*sizeof(REAL),"AllocateMetIn");
-  }
+  /* The interpolation weights are allocated by InitialiseMetFields */
   
   /* Allocate the 2-D variable data (NTmet time steps)*/
   (*metin)->Uwind = (REAL **)SunMalloc(NTmet*sizeof(REAL *),"AllocateMetIn");
@@ -401,9 +414,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
       (*metin)->x_Uwind[j]=0.0;
       (*metin)->y_Uwind[j]=0.0;
       (*metin)->z_Uwind[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->WUwind[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->Uwind[n][j]=0.0;
       }
@@ -413,9 +423,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
       (*metin)->x_Vwind[j]=0.0;
       (*metin)->y_Vwind[j]=0.0;
       (*metin)->z_Vwind[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->WVwind[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->Vwind[n][j]=0.0;
       }
@@ -425,9 +432,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
       (*metin)->x_Tair[j]=0.0;
       (*metin)->y_Tair[j]=0.0;
       (*metin)->z_Tair[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->WTair[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->Tair[n][j]=0.0;
       }
@@ -436,9 +440,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
   for(j=0;j<(*metin)->NPair;j++){
       (*metin)->x_Pair[j]=0.0;
       (*metin)->y_Pair[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->WPair[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->Pair[n][j]=0.0;
       }
@@ -447,9 +448,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
   for(j=0;j<(*metin)->Nrain;j++){
       (*metin)->x_rain[j]=0.0;
       (*metin)->y_rain[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->Wrain[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->rain[n][j]=0.0;
       }
@@ -459,9 +457,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
       (*metin)->x_RH[j]=0.0;
       (*metin)->y_RH[j]=0.0;
       (*metin)->z_RH[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->WRH[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->RH[n][j]=0.0;
       }
@@ -470,9 +465,6 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
   for(j=0;j<(*metin)->Ncloud;j++){
       (*metin)->x_cloud[j]=0.0;
       (*metin)->y_cloud[j]=0.0;
-      for(k=0;k<Nc;k++){
-	 (*metin)->Wcloud[k][j]=0.0;
-      }
        for(n=0;n<NTmet;n++){
 	 (*metin)->cloud[n][j]=0.0;
       }
@@ -485,118 +477,411 @@ void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc){
 
 
 /*
-* Function calcInterpWeights()
-* ----------------------------
-* Calculates the interpolation weights for all grid points based on "Ns" interpolants
-* at cooridinates (xo, yo)
+* Function: MetRepartition()
+* --------------------------
+* Creates the met structures on the repartitioned grid, as at the start of a run, but
+* keeps the time records of oldmetin.  The met fields at these records on the cells
+* must be transferred by the caller (see MigrateMet in rebalance.c), since the data
+* of the new met window is only read when the time record changes.
+*
 */
-void calcInterpWeights(gridT *grid, propT *prop, REAL *xo, REAL *yo, int Ns, int **index, REAL **klambda, int myproc){
-    
-    int j, i, jj, ii, iptr, jptr;
-    int Nc = grid->Nc;
-    const REAL inversepower = 2.2;
-    REAL sumgamma, dist, tmp;
-    REAL *gamma;
-    REAL **C, **Ctmp;
-    // Allocate the arrays
-    if(prop->varmodel==0){
-      gamma = (REAL *)SunMalloc(Ns*sizeof(REAL),"CalcInterpWeights");
-    }else{
-	gamma = (REAL *)SunMalloc((Ns+1)*sizeof(REAL),"CalcInterpWeights");
-	C = (REAL **)SunMalloc((Ns+1)*sizeof(REAL),"CalcInterpWeights");
-	Ctmp = (REAL **)SunMalloc((Ns+1)*sizeof(REAL),"CalcInterpWeights");
-	for (j=0;j<Ns+1;j++){
-	  C[j] = (REAL *)SunMalloc((Ns+1)*sizeof(REAL),"CalcInterpWeights");
-	  Ctmp[j] = (REAL *)SunMalloc((Ns+1)*sizeof(REAL),"CalcInterpWeights");
+void MetRepartition(propT *prop, gridT *grid, metinT *oldmetin, metinT **metin, metT **met, int myproc){
+  AllocateMetIn(prop,grid,metin,myproc);
+  AllocateMet(prop,grid,met,myproc);
+  InitialiseMetFields(prop,grid,*metin,*met,myproc);
+
+  (*metin)->t0 = oldmetin->t0;
+  (*metin)->t1 = oldmetin->t1;
+  (*metin)->t2 = oldmetin->t2;
+}
+
+/*
+* Function: FreeMetIn()
+* ---------------------
+* Frees the meteorological input structure and the interpolation weights of grid.
+*
+*/
+void FreeMetIn(metinT *metin, gridT *grid, propT *prop){
+  int n, m, shared;
+  size_t N[NMETVAR] = {metin->NUwind,metin->NVwind,metin->NTair,metin->NPair,metin->Nrain,
+		       metin->NRH,metin->Ncloud};
+  metweightT *W[NMETVAR] = {metin->WUwind,metin->WVwind,metin->WTair,metin->WPair,metin->Wrain,
+			    metin->WRH,metin->Wcloud};
+  DREAL *x[NMETVAR] = {metin->x_Uwind,metin->x_Vwind,metin->x_Tair,metin->x_Pair,metin->x_rain,
+		       metin->x_RH,metin->x_cloud},
+    *y[NMETVAR] = {metin->y_Uwind,metin->y_Vwind,metin->y_Tair,metin->y_Pair,metin->y_rain,
+		   metin->y_RH,metin->y_cloud};
+  REAL **data[NMETVAR] = {metin->Uwind,metin->Vwind,metin->Tair,metin->Pair,metin->rain,
+		       metin->RH,metin->cloud};
+
+  for(n=0;n<NMETVAR;n++) {
+    // Weights that are shared with a previous variable have already been freed
+    for(shared=0,m=0;m<n;m++)
+      shared |= (W[m]==W[n]);
+    if(!shared) {
+      SunFree(W[n]->rowptr,(grid->Nc+1)*sizeof(int),"FreeMetIn");
+      SunFree(W[n]->col,W[n]->Nnz*sizeof(int),"FreeMetIn");
+      SunFree(W[n]->w,W[n]->Nnz*sizeof(REAL),"FreeMetIn");
+      SunFree(W[n],sizeof(metweightT),"FreeMetIn");
+    }
+
+    SunFree(x[n],N[n]*sizeof(DREAL),"FreeMetIn");
+    SunFree(y[n],N[n]*sizeof(DREAL),"FreeMetIn");
+    for(m=0;m<NTmet;m++)
+      SunFree(data[n][m],N[n]*sizeof(REAL),"FreeMetIn");
+    SunFree(data[n],NTmet*sizeof(REAL *),"FreeMetIn");
+  }
+  SunFree(metin->z_Uwind,metin->NUwind*sizeof(REAL),"FreeMetIn");
+  SunFree(metin->z_Vwind,metin->NVwind*sizeof(REAL),"FreeMetIn");
+  SunFree(metin->z_Tair,metin->NTair*sizeof(REAL),"FreeMetIn");
+  SunFree(metin->z_RH,metin->NRH*sizeof(REAL),"FreeMetIn");
+  SunFree(metin->time,metin->nt*sizeof(DREAL),"FreeMetIn");
+  if(prop->metgrid) {
+    SunFree(metin->xg,metin->nx*sizeof(DREAL),"FreeMetIn");
+    SunFree(metin->yg,metin->ny*sizeof(DREAL),"FreeMetIn");
+  }
+  SunFree(metin,sizeof(metinT),"FreeMetIn");
+}
+
+/*
+* Function: FreeMet()
+* -------------------
+* Frees the meteorological structure on the cells of grid.
+*
+*/
+void FreeMet(metT *met, gridT *grid){
+  int n, m, Nc = grid->Nc;
+  coareT *c = met->coare;
+  REAL *cells[] = {met->z_Uwind,met->z_Vwind,met->z_Tair,met->z_RH,
+		   met->Uwind,met->Vwind,met->Tair,met->Pair,met->rain,met->RH,met->cloud,
+		   met->Hs,met->Hl,met->Hlw,met->Hsw,met->tau_x,met->tau_y,met->ustar,
+		   met->Tstar,met->qstar,met->EP,met->dHdT,
+		   c->u,c->us,c->ts,c->t,c->Qs,c->dQs,c->Q,c->P,c->zu,c->zt,c->zq,
+		   c->hsb,c->hlb,c->dhsb,c->dhlb,c->rhoa,c->usr,c->tsr,c->qsr,c->Cd},
+    **times[] = {met->Uwind_t,met->Vwind_t,met->Tair_t,met->Pair_t,met->rain_t,
+		 met->RH_t,met->cloud_t};
+
+  for(n=0;n<(int)(sizeof(cells)/sizeof(REAL *));n++)
+    SunFree(cells[n],Nc*sizeof(REAL),"FreeMet");
+  SunFree(c->cell,Nc*sizeof(int),"FreeMet");
+  SunFree(c,sizeof(coareT),"FreeMet");
+  for(n=0;n<(int)(sizeof(times)/sizeof(REAL **));n++) {
+    for(m=0;m<NTmet;m++)
+      SunFree(times[n][m],Nc*sizeof(REAL),"FreeMet");
+    SunFree(times[n],NTmet*sizeof(REAL *),"FreeMet");
+  }
+  FreeRadiation(met->rad,grid);
+  SunFree(met,sizeof(metT),"FreeMet");
+}
+
+/*
+* Function: MetWeights()
+* ----------------------
+* Returns the sparse interpolation weights from the Ns met points (x,y) to the
+* computational cells.  The weights of the nknown variables that have already been
+* computed are reused if the points are the same, since they only depend on the
+* points.  Otherwise the prop->metnearest nearest points within prop->metradius of
+* each cell are found with a k-d tree and the weights are computed with inverse
+* distance weighting (varmodel=0) or kriging.  The kriging matrix only depends on
+* the points that are used, so the cells are sorted by their set of points and it
+* is factored once for all of the cells with the same set.
+*
+*/
+static metweightT *MetWeights(gridT *grid, propT *prop, DREAL *x, DREAL *y, int Ns, metweightT **known, int nknown, int myproc){
+
+  int i, j, jj, n, m, iptr, nz, nmax, ncells, nfactor, same;
+  int Nc = grid->Nc, Ncomp = grid->celldist[1]-grid->celldist[0];
+  const REAL inversepower = 2.2;
+  REAL sumgamma, dist, r2;
+  int *ind, *cells;
+  REAL *dist2, *gamma, **C;
+  kdtreeT *tree;
+  metweightT *W;
+
+  // Reuse the weights of a variable at the same points
+  for(n=0;n<nknown;n++) {
+    if(known[n]->Ns==Ns) {
+      same=1;
+      for(j=0;j<Ns;j++)
+	if(known[n]->x[j]!=x[j] || known[n]->y[j]!=y[j]) {
+	  same=0;
+	  break;
 	}
+      if(same)
+	return known[n];
     }
-    
-    if(prop->varmodel==0){ // Inverse distance weighting
-      if(VERBOSE>1 && myproc==0) printf("Calculating interpolation weights using inverse distance weighting...\n");     
-      //for(i=0;i<Nc;i++){
-     for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-	i = grid->cellp[iptr];  
-	sumgamma=0.0;
-	for(j=0;j<Ns;j++){
-	    dist = pow(grid->xv[i]-xo[index[i][j]],2) + pow(grid->yv[i]-yo[index[i][j]],2);
-	    gamma[j] = 1.0/pow(dist,inversepower);
-	    sumgamma += gamma[j];
-	    //printf("dist = %f, sum = %f\n",dist,sumgamma);
+  }
+
+  W = (metweightT *)SunMalloc(sizeof(metweightT),"MetWeights");
+  W->Ns = Ns;
+  W->x = x;
+  W->y = y;
+  W->rowptr = (int *)SunMalloc((Nc+1)*sizeof(int),"MetWeights");
+
+  // Find the nearest points to each cell
+  nmax = (int)Min((REAL)prop->metnearest,(REAL)Ns);
+  if(nmax<1) nmax=1;
+  r2 = prop->metradius*prop->metradius;
+  ind = (int *)SunMalloc(nmax*sizeof(int),"MetWeights");
+  dist2 = (REAL *)SunMalloc(nmax*sizeof(REAL),"MetWeights");
+  W->Nnz = Ncomp*nmax;
+  W->col = (int *)SunMalloc(Ncomp*nmax*sizeof(int),"MetWeights");
+  W->w = (REAL *)SunMalloc(Ncomp*nmax*sizeof(REAL),"MetWeights");
+
+  tree = KDTreeBuild(x,y,NULL,Ns);
+  nz=0;
+  for(i=0;i<=Nc;i++)
+    W->rowptr[i]=0;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    n = KDTreeKNearest(tree,grid->xv[i],grid->yv[i],nmax,ind,dist2);
+    if(prop->metradius>0)
+      for(m=1;m<n;m++)
+	if(dist2[m]>r2) {
+	  n=m;
+	  break;
 	}
-	for(j=0;j<Ns;j++){
-	    klambda[i][j] = gamma[j]/sumgamma;
-	    //printf("weight = %f\n",klambda[i][j]);
+    W->rowptr[i+1]=n;
+
+    // Inverse distance weights, or the square of the distance for kriging
+    if(prop->varmodel==0) {
+      if(dist2[0]==0) {
+	for(j=0;j<n;j++)
+	  dist2[j]=(j==0);
+      } else {
+	sumgamma=0.0;
+	for(j=0;j<n;j++) {
+	  dist2[j] = 1.0/pow(dist2[j],inversepower);
+	  sumgamma += dist2[j];
 	}
+	for(j=0;j<n;j++)
+	  dist2[j]/=sumgamma;
       }
-    
-    //SunFree(gamma,Ns,"CalcInterpWeights");
-    
-    }else{ // kriging
-	if(VERBOSE>1 && myproc==0)  printf("Calculating interpolation weights using kriging...\n");
-	
-	// Loop through each model grid point and
-	for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-	  i = grid->cellp[iptr];  
-
-	  // Construct the LHS Matrix C
-	  for(ii=0;ii<Ns+1;ii++){
-	    for(j=0;j<Ns+1;j++){
-	      C[ii][j]=1.0;
-	    }
-	  }
-	  for(ii=0;ii<Ns;ii++){
-	    C[ii][ii]=semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, 0.0);
-	    for(j=ii+1;j<Ns;j++){
-	      dist = sqrt(  pow(xo[index[i][ii]]-xo[index[i][j]],2) + pow(yo[index[i][ii]]-yo[index[i][j]],2) );
-	      C[ii][j] = semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, dist);
-	      C[j][ii]=C[ii][j];
-	    }
-	  }
-	  C[Ns][Ns]=0.0;
-
-
-	  // calculate the  weights
-	  for(jj=0;jj<Ns;jj++){
-	    dist = sqrt( pow(grid->xv[i]-xo[index[i][jj]],2) + pow(grid->yv[i]-yo[index[i][jj]],2) );
-	    gamma[jj] = semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, dist);
-	  }
-	  gamma[Ns]=1.0;
-	  
-	  // Solve the linear system
-	  for(ii=0;ii<Ns+1;ii++){
-	    for(jj=0;jj<Ns+1;jj++){
-	      Ctmp[ii][jj]=C[ii][jj];
-	    }
-	  }
-	  linsolve(Ctmp,gamma,Ns+1);
-	  
-	  // Write to the weights array
-	  for(jj=0;jj<Ns;jj++){
-	    klambda[i][jj] = gamma[jj];
-	  }
-	  
-	  // Check the weights
-	  if(VERBOSE>3 && myproc==0) {
-	    sumgamma=0.0;
-	    printf("W[j]:\n");
-	    for(jj=0;jj<Ns;jj++){ // don't include the last point
-	      sumgamma+=gamma[jj];
-	      printf("%3.6f ",gamma[jj]);
-	    }
-	    printf("\nSumW = %f (should equal 1.000)\n",sumgamma);
-	  }
-	} 
-	
-      // Free up the arrays
-      /*
-      SunFree(gamma,Ns+1,"CalcInterpWeights");
-      for (j=0;j<Ns+1;j++){
-	SunFree(C[j],Ns+1,"CalcInterpWeights");
-	SunFree(Ctmp[j],Ns+1,"CalcInterpWeights");
+    }
+
+    // Store the points of each cell in increasing order
+    for(j=0;j<n;j++) {
+      for(jj=nz+j;jj>nz && W->col[jj-1]>ind[j];jj--) {
+	W->col[jj]=W->col[jj-1];
+	W->w[jj]=W->w[jj-1];
       }
-      */
-    }// end of kriging   
-} // End of calcInterpWeights
+      W->col[jj]=ind[j];
+      W->w[jj]=dist2[j];
+    }
+    nz+=n;
+  }
+  KDTreeFree(tree);
+  SunFree(ind,nmax*sizeof(int),"MetWeights");
+  SunFree(dist2,nmax*sizeof(REAL),"MetWeights");
+
+  // Cells that are not computational cells have no weights
+  for(i=0;i<Nc;i++)
+    W->rowptr[i+1]+=W->rowptr[i];
+
+  if(prop->varmodel==0) {
+    if(VERBOSE>1 && myproc==0) printf("Calculated inverse distance weights of %d met points with %d nonzeros.\n",Ns,nz);
+    return W;
+  }
+
+  // Kriging: order the cells by their set of points
+  cells = (int *)SunMalloc(Ncomp*sizeof(int),"MetWeights");
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++)
+    cells[iptr-grid->celldist[0]]=grid->cellp[iptr];
+  sortweights=W;
+  qsort(cells,Ncomp,sizeof(int),CompareMetPoints);
+
+  gamma = (REAL *)SunMalloc((nmax+1)*sizeof(REAL),"MetWeights");
+  C = (REAL **)SunMalloc((nmax+1)*sizeof(REAL *),"MetWeights");
+  for(j=0;j<nmax+1;j++)
+    C[j] = (REAL *)SunMalloc((nmax+1)*sizeof(REAL),"MetWeights");
+
+  nfactor=0;
+  for(m=0;m<Ncomp;m+=ncells) {
+    for(ncells=1;m+ncells<Ncomp && !CompareMetPoints(&cells[m],&cells[m+ncells]);ncells++);
+
+    i = cells[m];
+    nz = W->rowptr[i];
+    n = W->rowptr[i+1]-nz;
+    if(n==1) {
+      for(j=m;j<m+ncells;j++)
+	W->w[W->rowptr[cells[j]]]=1.0;
+      continue;
+    }
+
+    // Construct the LHS Matrix C and its LU decomposition
+    for(jj=0;jj<n+1;jj++)
+      for(j=0;j<n+1;j++)
+	C[jj][j]=1.0;
+    for(jj=0;jj<n;jj++){
+      C[jj][jj]=semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, 0.0);
+      for(j=jj+1;j<n;j++){
+	dist = sqrt(pow(x[W->col[nz+jj]]-x[W->col[nz+j]],2) + pow(y[W->col[nz+jj]]-y[W->col[nz+j]],2));
+	C[jj][j] = semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, dist);
+	C[j][jj]=C[jj][j];
+      }
+    }
+    C[n][n]=0.0;
+    ludecomp(C,n+1);
+    nfactor++;
+
+    // Solve for the weights of each of the cells with these points
+    for(iptr=m;iptr<m+ncells;iptr++) {
+      i = cells[iptr];
+      nz = W->rowptr[i];
+      for(j=0;j<n;j++) {
+	dist = sqrt(W->w[nz+j]);
+	gamma[j] = semivariogram(prop->varmodel, prop->nugget, prop->sill, prop->range, dist);
+      }
+      gamma[n]=1.0;
+      lusolve(C,gamma,n+1);
+      for(j=0;j<n;j++)
+	W->w[nz+j]=gamma[j];
+    }
+  }
+  if(VERBOSE>1 && myproc==0) printf("Calculated kriging weights of %d met points with %d factorizations for %d cells.\n",Ns,nfactor,Ncomp);
+
+  for(j=0;j<nmax+1;j++)
+    SunFree(C[j],(nmax+1)*sizeof(REAL),"MetWeights");
+  SunFree(C,(nmax+1)*sizeof(REAL *),"MetWeights");
+  SunFree(gamma,(nmax+1)*sizeof(REAL),"MetWeights");
+  SunFree(cells,Ncomp*sizeof(int),"MetWeights");
+
+  return W;
+} // End of MetWeights
+
+/*
+* Function: CompareMetPoints()
+* ----------------------------
+* qsort comparison of two cells by the met points of sortweights that they use.
+*
+*/
+static int CompareMetPoints(const void *a, const void *b){
+  int i = *(const int *)a, j = *(const int *)b;
+  int ni = sortweights->rowptr[i+1]-sortweights->rowptr[i];
+  int nj = sortweights->rowptr[j+1]-sortweights->rowptr[j];
+  int *coli = sortweights->col+sortweights->rowptr[i];
+  int *colj = sortweights->col+sortweights->rowptr[j];
+  int n;
+
+  if(ni!=nj)
+    return ni-nj;
+  for(n=0;n<ni;n++)
+    if(coli[n]!=colj[n])
+      return coli[n]-colj[n];
+  return 0;
+}
+
+/*
+* Function: MetGridInterval()
+* ---------------------------
+* Returns the interval i of the monotonic coordinates x[0..n-1] of the regular met
+* grid that contains xi and the fraction r of the way from x[i] to x[i+1], which is
+* limited to 0<=r<=1 so that points off the met grid take the values at its edge.
+*
+*/
+static int MetGridInterval(DREAL *x, int n, DREAL xi, REAL *r){
+  int lo=0, hi=n-1, mid, up=(x[n-1]>x[0]);
+
+  while(hi-lo>1) {
+    mid=(lo+hi)/2;
+    if((x[mid]<=xi)==up)
+      lo=mid;
+    else
+      hi=mid;
+  }
+  *r = (xi-x[lo])/(x[lo+1]-x[lo]);
+  if(*r<0) *r=0;
+  if(*r>1) *r=1;
+  return lo;
+}
+
+/*
+* Function: MetGridWindow()
+* -------------------------
+* Sets the sub-window i0..i0+nxw-1, j0..j0+nyw-1 of the regular met grid that
+* contains the bilinear interpolation stencils of the computational cells.
+*
+*/
+static void MetGridWindow(gridT *grid, metinT *metin, int myproc){
+  int i, iptr, ix, jy, imin, imax, jmin, jmax;
+  REAL r;
+
+  if(metin->nx<2 || metin->ny<2) {
+    if(myproc==0) printf("Error: the met grid must have at least 2 points in x and y (nx=%d, ny=%d).\n",
+			 (int)metin->nx,(int)metin->ny);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  imin=metin->nx;
+  jmin=metin->ny;
+  imax=jmax=-1;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    ix = MetGridInterval(metin->xg,metin->nx,grid->xv[i],&r);
+    jy = MetGridInterval(metin->yg,metin->ny,grid->yv[i],&r);
+    imin = Min(imin,ix);
+    imax = Max(imax,ix+1);
+    jmin = Min(jmin,jy);
+    jmax = Max(jmax,jy+1);
+  }
+  if(imax<0) { // No computational cells
+    imin=imax=jmin=jmax=0;
+  }
+
+  metin->i0 = imin;
+  metin->j0 = jmin;
+  metin->nxw = imax-imin+1;
+  metin->nyw = jmax-jmin+1;
+}
+
+/*
+* Function: MetGridWeights()
+* --------------------------
+* Returns the bilinear interpolation weights from the four points of the regular
+* met grid around each computational cell, which are the same for all of the
+* variables.
+*
+*/
+static metweightT *MetGridWeights(gridT *grid, metinT *metin, int myproc){
+  int i, iptr, ix, jy, nz;
+  int Nc = grid->Nc, Ncomp = grid->celldist[1]-grid->celldist[0], nxw = metin->nxw;
+  REAL rx, ry;
+  metweightT *W = (metweightT *)SunMalloc(sizeof(metweightT),"MetGridWeights");
+
+  W->Ns = metin->NUwind;
+  W->x = metin->x_Uwind;
+  W->y = metin->y_Uwind;
+  W->rowptr = (int *)SunMalloc((Nc+1)*sizeof(int),"MetGridWeights");
+  W->Nnz = 4*Ncomp;
+  W->col = (int *)SunMalloc(4*Ncomp*sizeof(int),"MetGridWeights");
+  W->w = (REAL *)SunMalloc(4*Ncomp*sizeof(REAL),"MetGridWeights");
+
+  for(i=0;i<=Nc;i++)
+    W->rowptr[i]=0;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    ix = MetGridInterval(metin->xg,metin->nx,grid->xv[i],&rx)-metin->i0;
+    jy = MetGridInterval(metin->yg,metin->ny,grid->yv[i],&ry)-metin->j0;
+    nz = 4*(iptr-grid->celldist[0]);
+    W->rowptr[i+1]=4;
+
+    W->col[nz] = jy*nxw+ix;
+    W->col[nz+1] = jy*nxw+ix+1;
+    W->col[nz+2] = (jy+1)*nxw+ix;
+    W->col[nz+3] = (jy+1)*nxw+ix+1;
+    W->w[nz] = (1-rx)*(1-ry);
+    W->w[nz+1] = rx*(1-ry);
+    W->w[nz+2] = (1-rx)*ry;
+    W->w[nz+3] = rx*ry;
+  }
+  for(i=0;i<Nc;i++)
+    W->rowptr[i+1]+=W->rowptr[i];
+
+  if(VERBOSE>1 && myproc==0) printf("Calculated bilinear weights from a %d x %d window of the %d x %d met grid.\n",
+				    (int)metin->nxw,(int)metin->nyw,(int)metin->nx,(int)metin->ny);
+  return W;
+} // End of MetGridWeights
 
 /*
 * Function: semivariogram()
@@ -620,121 +905,60 @@ static REAL semivariogram(int varmodel, REAL nugget, REAL sill, REAL range, REAL
 }
 
 /*
-* Function: weightInterpArray()
-* -----------------------------
-* Perform weighted interpolation on a field D [2d-array]
+* Function: InterpMetFields()
+* ---------------------------
+* Interpolates the nf fields src[f] at the met points onto the computational cells
+* in dst[f] with the weights W[f].  The fields with the same weights are
+* interpolated together in one pass through the weights.
 *
 */
-void weightInterpArray(REAL **D, REAL **klambda, gridT *grid, int Ns, int **index, int nt, REAL **Dout){
-  int i,j, k, iptr;
-  for(k=0;k<nt;k++){
-    //for(i=0;i<Nc;i++){
-    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-        i = grid->cellp[iptr];  
-	Dout[k][i] = 0.0;
-	for(j=0;j<Ns;j++){
-	    Dout[k][i] += klambda[i][j] * D[k][index[i][j]];
-	}
-    }
-  }
-}
+static void InterpMetFields(gridT *grid, int nf, metweightT **W, REAL **src, REAL **dst){
+  int f, g, i, iptr, j, n, nsame, same[NMETVAR*NTmet];
+  REAL w;
+
+  for(f=0;f<nf;f++) {
+    // Skip the fields that were interpolated with an earlier field
+    for(g=0;g<f;g++)
+      if(W[g]==W[f])
+	break;
+    if(g<f)
+      continue;
+
+    nsame=0;
+    for(g=f;g<nf;g++)
+      if(W[g]==W[f])
+	same[nsame++]=g;
 
-/* 
-* Function: weightInterpField()
-* -----------------------------
-* Perform weighted interpolation on a field D [vector]
-*
-*/
-void weightInterpField(REAL *D, REAL **klambda, gridT *grid, int Ns, int **index, REAL *Dout){
-  int i,j,iptr;
-  
-//  for(i=0;i<Nc;i++){
     for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-      i = grid->cellp[iptr];  
-      Dout[i] = 0.0;
-      for(j=0;j<Ns;j++){
-	  Dout[i] += klambda[i][j] * D[index[i][j]];
+      i = grid->cellp[iptr];
+      for(n=0;n<nsame;n++)
+	dst[same[n]][i]=0.0;
+      for(j=W[f]->rowptr[i];j<W[f]->rowptr[i+1];j++) {
+	w = W[f]->w[j];
+	for(n=0;n<nsame;n++)
+	  dst[same[n]][i] += w*src[same[n]][W[f]->col[j]];
       }
-  }
-}
-
-/* 
-* Function: FindNearestMetStations()
-* -----------------------------
-* Find the N Nearest met stations to each grid cell
-*
-*/
-void FindNearestMetStations(propT *prop, gridT *grid, metinT **metin, int myproc){
-
-    int Nc = grid->Nc;
-    int i,iptr;
-
-    // Determine the maximum points for each variables
-    (*metin)->max_nearest_Uwind =(int)Min((REAL)MAXNEAR, (REAL)(*metin)->NUwind);
-    (*metin)->max_nearest_Vwind =(int)Min((REAL)MAXNEAR, (REAL)(*metin)->NVwind);
-    (*metin)->max_nearest_Tair = (int)Min((REAL)MAXNEAR, (REAL)(*metin)->NTair);
-    (*metin)->max_nearest_Pair = (int)Min((REAL)MAXNEAR, (REAL)(*metin)->NPair);
-    (*metin)->max_nearest_RH = (int)Min((REAL)MAXNEAR, (REAL)(*metin)->NRH);
-    (*metin)->max_nearest_rain = (int)Min((REAL)MAXNEAR, (REAL)(*metin)->Nrain);
-    (*metin)->max_nearest_cloud =(int)Min((REAL)MAXNEAR, (REAL)(*metin)->Ncloud);
-
-    // Allocate the indexing arrays
-    (*metin)->nearest_Uwind = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_Vwind = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_Tair = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_Pair = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_rain = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_RH = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    (*metin)->nearest_cloud = (int **)SunMalloc(Nc*sizeof(int *),"AllocateMetIn");
-    for(i=0;i<Nc;i++){
-        (*metin)->nearest_Uwind[i] = (int *)SunMalloc((*metin)->max_nearest_Uwind*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_Vwind[i] = (int *)SunMalloc((*metin)->max_nearest_Vwind*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_Tair[i] = (int *)SunMalloc((*metin)->max_nearest_Tair*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_Pair[i] = (int *)SunMalloc((*metin)->max_nearest_Pair*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_rain[i] = (int *)SunMalloc((*metin)->max_nearest_rain*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_RH[i] = (int *)SunMalloc((*metin)->max_nearest_RH*sizeof(int),"AllocateMetIn");
-        (*metin)->nearest_cloud[i] = (int *)SunMalloc((*metin)->max_nearest_cloud*sizeof(int),"AllocateMetIn");
     }
-    
-    // Go through and find the N nearest points for each variable
-    //FindNearest(int *points, REAL *x, REAL *y, int N, int np, REAL xi, REAL yi)
-    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-	i = grid->cellp[iptr];  
-
-	FindNearest((*metin)->nearest_Uwind[i], (*metin)->x_Uwind, (*metin)->y_Uwind,
-		(*metin)->NUwind, (*metin)->max_nearest_Uwind, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_Vwind[i], (*metin)->x_Vwind, (*metin)->y_Vwind,
-		(*metin)->NVwind, (*metin)->max_nearest_Vwind, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_Tair[i], (*metin)->x_Tair, (*metin)->y_Tair,
-		(*metin)->NTair, (*metin)->max_nearest_Tair, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_Pair[i], (*metin)->x_Pair, (*metin)->y_Pair,
-		(*metin)->NPair, (*metin)->max_nearest_Pair, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_RH[i], (*metin)->x_RH, (*metin)->y_RH,
-		(*metin)->NRH, (*metin)->max_nearest_RH, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_rain[i], (*metin)->x_rain, (*metin)->y_rain,
-		(*metin)->Nrain, (*metin)->max_nearest_rain, grid->xv[i], grid->yv[i]);
-	FindNearest((*metin)->nearest_cloud[i], (*metin)->x_cloud, (*metin)->y_cloud,
-		(*metin)->Ncloud, (*metin)->max_nearest_cloud, grid->xv[i], grid->yv[i]);
-    
-    }
-
-
-}// End function
+  }
+} // End of InterpMetFields
 
 /*
 * Function: updateAirSeaFluxes()
 * ------------------------------
 * Main routine for calculating the air-sea heat and salt fluxes
 *
-* Computed terms are stored in the met structure array
+* Computed terms are stored in the met structure array, along with dHdT, the
+* derivative of the net surface heat flux Hs+Hl+Hlw with respect to the water
+* temperature that HeatSource uses for the implicit source term.  The surface
+* values of the computational cells are gathered into met->coare and the
+* COARE3.0 fluxes are computed for all of them at once by cor30a.
 *
 * These routines are activated when "metmodel" = 2 or 3 in suntans.dat
 */ 
 void updateAirSeaFluxes(propT *prop, gridT *grid, physT *phys, metT *met,REAL **T){
   
   int i, ktop, iptr, n;
-  int Nc = grid->Nc;
-  REAL *x=met->xtmp; // pointer to vector passed to cor30
+  coareT *y=met->coare; // surface values passed to cor30a
   REAL Umag; // Wind Speed magnitude
   // Constant flux coefficients
   REAL Cd = prop->Cda; // Drag coefficient
@@ -745,154 +969,90 @@ void updateAirSeaFluxes(propT *prop, gridT *grid, physT *phys, metT *met,REAL **
   REAL Lv = 2.50e6; // Latent heat of vaporization
   REAL rhoa = 1.20; // Density of air	
   
-
-  /* Terms in the COARE3.0 input vector
-   REAL u=x[0]; //wind speed (m/s]  at height zu [m]
-   REAL us=x[1]; //surface current speed in the wind direction [m/s]
-   REAL ts=x[2]; //bulk water temperature [C] if jcool=1, interface water T if jcool=0  
-   REAL t=x[3]; //bulk air temperature [C], height zt
-   REAL Qs=x[4]; //bulk water spec hum [kg/kg] if jcool=1, ...
-   REAL Q=x[5]; //bulk air spec hum [kg/kg], height zq
-   REAL Rs=x[6]; //downward solar flux [W/m^2]
-   REAL Rl=x[7]; //downard IR flux [W/m^2]
-   REAL rain=x[8]; //rain rate [mm/hr]
-   REAL zi=x[9]; //PBL depth [m]
-   REAL P=x[10]; //Atmos surface pressure [mb]
-   REAL zu=x[11]; //wind speed measurement height [m]
-   REAL zt=x[12]; //air T measurement height [m]
-   REAL zq=x[13]; //air q measurement height [m]
-   REAL lat=x[14]; //latitude [deg, N=+]
-   REAL jcool=x[15]; //implement cool calculation skin switch, 0=no, 1=yes
-   REAL jwave=x[16]; //implement wave dependent roughness model
-   REAL twave=x[17]; //wave period [s]
-   REAL hwave=x[18]; //wave height [m]
-  */
-  
-  /* The goal is fill up vector x   */ 
-  //x = (REAL *)SunMalloc(19*sizeof(REAL),"updateAirSeaFluxes");
-
-  
-  //if(myproc==0) printf(" j, Hs, Hl, tau, Hlw, Hsw\n"); 
- // for(j=0;j<Nc;j++){
- for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+  // Clear sky shortwave radiation at this time step
+  UpdateSolarGeometry(grid,prop,met->rad);
+
+  // Gather the inputs of the computational cells (see cor30a for the terms).
+  // The rain rate, PBL depth and latitude inputs of cor30.m are constant or
+  // not used, and the cool skin and wave models are switched off.
+  n=0;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
     i = grid->cellp[iptr];  
     ktop = grid->ctop[i];
     // Wind speed
     //Umag = sqrt( pow( (met->Uwind[i]-phys->uc[i][ktop]) ,2) + pow( (met->Vwind[i]-phys->vc[i][ktop]),2) );
     Umag = sqrt( pow(met->Uwind[i],2) + pow(met->Vwind[i],2) );
-    x[0] = Umag;
+
+    y->cell[n] = i;
+    y->u[n] = Umag;
 
     // Surface current speed in wind direction
     // This is the projection of the water velocity vector onto the wind velocity vector
-    //x[1] = 0.0; 
-    x[1] = fabs(phys->uc[i][ktop]*met->Uwind[i]/Umag + phys->vc[i][ktop]*met->Vwind[i]/Umag); 
+    y->us[n] = fabs(phys->uc[i][ktop]*met->Uwind[i]/Umag + phys->vc[i][ktop]*met->Vwind[i]/Umag); 
 
-    // Water temperature
-    x[2] = T[i][ktop];
-    
-    // Air temperature
-    x[3] = met->Tair[i];
+    // Water and air temperature
+    y->ts[n] = T[i][ktop];
+    y->t[n] = met->Tair[i];
     
-    // Water specific humidty
-    x[4] = qsat(T[i][ktop], met->Pair[i]);
+    // Water and air specific humidty
+    y->Qs[n] = qsat(T[i][ktop], met->Pair[i]);
+    y->dQs[n] = dqsat(T[i][ktop], met->Pair[i]);
+    y->Q[n] = specifichumidity(met->RH[i],met->Tair[i],met->Pair[i]);
     
-    // Air specific humidity
-    x[5] = specifichumidity(met->RH[i],met->Tair[i],met->Pair[i]);
+    //Air pressure [mb] and measurement heights of the wind, air temperature and humidity
+    y->P[n] = met->Pair[i];
+    y->zu[n] = met->z_Uwind[i];
+    y->zt[n] = met->z_Tair[i];
+    y->zq[n] = met->z_RH[i];
     
-    // Longwave radiation
-    met->Hlw[i] = longwave(met->Tair[i],T[i][ktop],met->cloud[i]);
+    // Longwave radiation, whose derivative starts dHdT
+    met->Hlw[i] = longwave(met->Tair[i],T[i][ktop],met->cloud[i],&(met->dHdT[i]));
     //met->Hlw[i] = longwave_berliand(met->Tair[i],T[i][ktop],met->cloud[i],met->RH[i],met->Pair[i]);
-    x[6] = met->Hlw[i];
     
     // Shortwave radiation
-    met->Hsw[i] = shortwave(prop->nctime/86400.0,prop->latitude,met->cloud[i],prop->gmtoffset/24.0);
-    x[7] = met->Hsw[i];
-    
-    //rain [mm/hr] (rain heat flux is not included at the moment)
-    x[8] = met->rain[i]*3600;
-    
-    //Air pressure [mb]
-    x[10] = met->Pair[i];
-    
-    //wind speed height
-    x[11] = met->z_Uwind[i];
-    
-    //air temp height
-    x[12] = met->z_Tair[i];
-    
-    //humidity measurement height
-    x[13] = met->z_RH[i];
-    
-     //Set some constant values
-     x[9] = 600.0; 
-     x[14] = prop->latitude;
-     x[15] = 0.0;
-     x[16] = 0.0;
-     x[17] = 0.0;
-     x[18] = 0.0;
-    //printf(" %d, x[0]:%6.6f, x[1]:%6.6f, x[2]:%6.6f, x[3]:%6.6f, x[4]:%6.6f, x[5]:%6.6f\n",j,x[0],x[1],x[2],x[3],x[4],x[5]);
+    met->Hsw[i] = CellShortwave(met->rad,i,met->cloud[i]);
+    n++;
+  }
+  y->N = n;
+
+  /* Calculate the actual fluxes */
+  if (prop->metmodel==2)
+    cor30a(y);
+
+  for(n=0;n<y->N;n++) {
+    i = y->cell[n];
+    ktop = grid->ctop[i];
+    Umag = y->u[n];
+
     if (prop->metmodel==2){
-      /* Calculate the actual fluxes */
-      cor30a(x);
-      /* Output variable back into the input array 
-      x[0] = hsb;
-      x[1] = hlb;
-      x[2] = tau;
-      x[3] = zo;
-      x[4] = zot;
-      x[5] = zoq;
-      x[6] = rhoa;
-      x[7] = usr;
-      x[8] = tsr;
-      x[9] = qsr;
-      x[10] = dter;
-      x[11] = dqer;
-      x[12] = tkt;
-      x[13] = RF;
-      x[14] = ut; // Speed including gustiness
-      x[15] = Cd;
-      x[16] = Ch;
-      x[17] = Ce;
-      x[18] = ug;
-      */
       // Output the fluxes to the met structure array
-      met->Hs[i] = -x[0];//Note the change of sign
-      met->Hl[i] = -x[1];
-      met->ustar[i] = x[7];//These are not used at present
-      met->Tstar[i] = x[8];
-      met->qstar[i] = x[9];
+      met->Hs[i] = -y->hsb[n];//Note the change of sign
+      met->Hl[i] = -y->hlb[n];
+      met->dHdT[i] -= y->dhsb[n] + y->dhlb[n];
+      met->ustar[i] = y->usr[n];//These are not used at present
+      met->Tstar[i] = y->tsr[n];
+      met->qstar[i] = y->qsr[n];
     
       /* Calculate the wind stress components
       * tau_x = rhoa * Cd * S * (Ucurrent - Uwind) : Fairall et al, 1996
       */
       // *** I think this is double counting if the surface currents have already been accounted for above***
-      //met->tau_x[j] = x[6] * x[15] * x[14] * (phys->uc[j][ktop] - met->Uwind[j]);
-      //met->tau_y[j] = x[6] * x[15] * x[14] * (phys->vc[j][ktop] - met->Vwind[j]);
-      //met->tau_x[j] = x[6] * x[15] * x[14] * (met->Uwind[j] - phys->uc[j][ktop]);
-      //met->tau_y[j] = x[6] * x[15] * x[14] * (met->Vwind[j] - phys->vc[j][ktop]);
       // No gust speed in stress term
-      met->tau_x[i] = x[6] * x[10] * Umag * (met->Uwind[i] - phys->uc[i][ktop]);
-      met->tau_y[i] = x[6] * x[10] * Umag * (met->Vwind[i] - phys->vc[i][ktop]);
-
-      //No surface current dependence 
-      //met->tau_x[j] = x[6] * x[15] * x[14] * met->Uwind[j];
-      //met->tau_y[j] = x[6] * x[15] * x[14] * met->Vwind[j];
-      //met->tau_x[j] = 1.2 * 0.0011 * x[14] * met->Uwind[j];
-      //met->tau_y[j] = 1.2 * 0.0011 * x[14] * met->Vwind[j];
-      //printf("%10.6f, %10.6f, %10.6f, %10.6f\n",x[6],x[15],x[14],met->Vwind[j]);
+      met->tau_x[i] = y->rhoa[n] * y->Cd[n] * Umag * (met->Uwind[i] - phys->uc[i][ktop]);
+      met->tau_y[i] = y->rhoa[n] * y->Cd[n] * Umag * (met->Vwind[i] - phys->vc[i][ktop]);
 
     }else if(prop->metmodel>=3){// Compute fluxes with constant parameters
-      met->Hs[i] = - rhoa * cpa * Ch * Umag * (x[2] - x[3]);//T_w > T_a -> Hs is negative
-      met->Hl[i] = - rhoa * Lv * Ce * Umag * (x[4] - x[5]);
+      met->Hs[i] = - rhoa * cpa * Ch * Umag * (y->ts[n] - y->t[n]);//T_w > T_a -> Hs is negative
+      met->Hl[i] = - rhoa * Lv * Ce * Umag * (y->Qs[n] - y->Q[n]);
+      met->dHdT[i] -= rhoa * cpa * Ch * Umag + rhoa * Lv * Ce * Umag * y->dQs[n];
       met->tau_x[i] = rhoa * Cd * Umag * (met->Uwind[i] - phys->uc[i][ktop]); 
       met->tau_y[i] = rhoa * Cd * Umag * (met->Vwind[i] - phys->vc[i][ktop]);
     }
 
-
     // Check for nans and dump the inputs
-    for(n=0;n<8;n++){
-    	if(x[n]!=x[n]){
-	   printf("Error in COARE3.0 Algorithm at i = %d, x[%d] = nan.\n",i,n);
+    if(met->Hs[i]!=met->Hs[i] || met->Hl[i]!=met->Hl[i] || met->Hlw[i]!=met->Hlw[i] ||
+       met->tau_x[i]!=met->tau_x[i] || met->tau_y[i]!=met->tau_y[i] || met->dHdT[i]!=met->dHdT[i]){
+	   printf("Error in COARE3.0 Algorithm at i = %d, flux = nan.\n",i);
 	   printf("Uwind[%d] = %6.10f, z_Uwind = %6.10f m\n",i,met->Uwind[i],met->z_Uwind[i]);
 	   printf("Vwind[%d] = %6.10f, z_Vwind = %6.10f m\n",i,met->Vwind[i],met->z_Vwind[i]);
 	   printf("Tair[%d] = %6.10f, z_Tair = %6.10f m\n",i,met->Tair[i],met->z_Tair[i]);
@@ -903,10 +1063,8 @@ void updateAirSeaFluxes(propT *prop, gridT *grid, physT *phys, metT *met,REAL **
 	   printf("T[%d][%d] = %6.10f\n",i,ktop,T[i][ktop]);
 	   MPI_Finalize();
 	   exit(EXIT_FAILURE);
-	}
     }
   }
-  //SunFree(x,19,"updateAirSeaFluxes");
 } // End updateAirFluxes
 
 
@@ -950,6 +1108,25 @@ static REAL qsat(REAL Tw, REAL Pair){
   return (0.62197*(cff/(Pair-0.378*cff+SMALL)));
 } // End qsat
 
+/*
+* Function: dqsat()
+ ------------------
+* Derivative of qsat with respect to the water temperature.
+*/
+static REAL dqsat(REAL Tw, REAL Pair){
+ REAL cff, dcff, den;
+
+ cff=(1.0007+3.46E-6*Pair)*6.1121* exp(17.502*Tw/(240.97+Tw+SMALL));
+ dcff=cff*17.502*(240.97+SMALL)/pow(240.97+Tw+SMALL,2);
+
+  //  Vapor Pressure reduced for salinity (Kraus & Businger, 1994, pp 42).
+  cff=cff*0.98;
+  dcff=dcff*0.98;
+ 
+  den=Pair-0.378*cff+SMALL;
+  return (0.62197*dcff*(Pair+SMALL)/(den*den));
+} // End dqsat
+
 /*
  * Function: satvap()
  * --------------------
@@ -1012,12 +1189,13 @@ static REAL longwave_berliand(REAL Ta, REAL Tw, REAL C_cloud, REAL RH, REAL Pair
 /*
 * Function: longwave()
 * --------------------
-* Calculate net longwave radiation into water
+* Calculate net longwave radiation into water and its derivative with respect
+* to the water temperature
 *
 * Ref: Martin and McCutcheon, "Hydrodynamics and Transport for Water
 * Quality Modeling", 1999
 */
-static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud){
+static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud, REAL *dHdTw){
   
   // Constants
   const REAL T_ref = 273.16;             // conversion from C to K
@@ -1031,6 +1209,7 @@ static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud){
   
   // Emitted Long Wave Radiation
   H_LE = epsilon_w*sigma*pow(Tw + T_ref,4);
+  *dHdTw = -4*epsilon_w*sigma*pow(Tw + T_ref,3);
   
   //  Incoming Long Wave Radiation
   
@@ -1043,43 +1222,6 @@ static REAL longwave(REAL Ta, REAL Tw, REAL C_cloud){
 
 } // End longwave
 
-/*
-* Function: shortwave()
-* ---------------------
-* Compute solar radiation flux using the Gill, 1982 formulae 
-*
-*/
-REAL shortwave(REAL time, REAL Lat,REAL C_cloud, REAL toffset){
-  
-  const REAL S=1368.0;  //[W m-2]
-  const REAL albedo = 0.06;
-  const REAL R = 0.76;
-  REAL omega1, omega0;
-  REAL delta, singamma, Qsc, Hsw;
-  REAL gmttime;
-
-  omega1 = 2*PI/1.0; // Diurnal cycle
-  omega0 = 2*PI/365.25; // Annual cycle
-
-  // Remove the gmtoffset from the time (assume units are the same)
-  gmttime = time + toffset;
-
-  delta = 23.5*PI/180 * cos(omega0*gmttime - 2.95);
-  singamma = sin(delta)*sin(PI*Lat/180) - cos(delta)*cos(PI*Lat/180)*cos(omega1*gmttime);
-
-  // Clear sky radiation
-  if(singamma >= 0.0){
-      Qsc = R*S*singamma;
-  }else{
-      Qsc = 0;
-  }
-  // Corrected radiation
-  Hsw = (1.0-albedo) * (1.0 - 0.65 * pow(C_cloud,2)) * Qsc;
-
-  return Hsw;
-  
-} // End shortwave
-
 /* Function: bulkflux()
  * ------------------------
  * Calculates air-sea fluxes using bulk flux formulation
@@ -1107,6 +1249,12 @@ REAL shortwave(REAL time, REAL Lat,REAL C_cloud, REAL toffset){
 * -------------------
 * Calculates air-sea fluxes using bulk flux formulation
 *
+* The fluxes of the y->N surface cells are computed in one pass over the
+* arrays of y, and the derivatives of the sensible and latent heat fluxes
+* with respect to the water temperature ts are carried through the first
+* guess and the bulk loop alongside each term (the _T terms).  The cool skin,
+* rain and wave terms of cor30.m are not used (jcool=jwave=0, zi=600 m).
+*
 * References:
 *	Fairall et al, 1996, JGR
 *  	Fairall et al, 2003, Journal of Climate
@@ -1116,44 +1264,20 @@ REAL shortwave(REAL time, REAL Lat,REAL C_cloud, REAL toffset){
 *
 * This code is adapted from cor30.m matlab function
 */
-static void cor30a(REAL *y){
-  
-  /* Get variables from the input vector */
-  REAL u=y[0]; //wind speed (m/s]  at height zu [m]
-  REAL us=y[1]; //surface current speed in the wind direction [m/s]
-  REAL ts=y[2]; //bulk water temperature [C] if jcool=1, interface water T if jcool=0  
-  REAL t=y[3]; //bulk air temperature [C], height zt
-  REAL Qs=y[4]; //bulk water spec hum [kg/kg] if jcool=1, ...
-  REAL Q=y[5]; //bulk air spec hum [kg/kg], height zq
-  REAL Rs=y[6]; //downward solar flux [W/m^2]
-  REAL Rl=y[7]; //downard IR flux [W/m^2]
-  REAL rain=y[8]; //rain rate [mm/hr]
-  REAL zi=y[9]; //PBL depth [m]
-  REAL P=y[10]; //Atmos surface pressure [mb]
-  REAL zu=y[11]; //wind speed measurement height [m]
-  REAL zt=y[12]; //air T measurement height [m]
-  REAL zq=y[13]; //air q measurement height [m]
-  REAL lat=y[14]; //latitude [deg, N=+]
-  REAL jcool=y[15]; //implement cool calculation skin switch, 0=no, 1=yes
-  REAL jwave=y[16]; //implement wave dependent roughness model
-  REAL twave=y[17]; //wave period [s]
-  REAL hwave=y[18]; //wave height [m]
+static void cor30a(coareT *y){
   
-  int nits =3;
-  int i;
+  int n, i, nits;
   
-  REAL Beta, von, fdg, tdk, grav;
-  REAL Rgas, Le, cpa, cpv, rhoa, visa;
-  REAL Al, be, cpw, rhow, visw, tcw, bigc, wetc;
-  REAL lwave, cwave, Rns, Rnl;
-  REAL dt, du, dq, ta, ug, dter, dqer;
+  REAL Beta, von, fdg, tdk, grav, zi;
+  REAL Rgas, Le, cpa, rhoa, visa;
+  REAL u, us, ts, t, Qs, Q, P, zu, zt, zq;
+  REAL dt, du, dq, ta, ug, dpsi, den, num;
   REAL u10, usr, zo10, Cd10, Ch10, Ct10, zot10;
-  REAL Cd, Ct, CC, Ribcu, Ribu, zetu, L10, tsr, qsr, tkt, charn, rr, Bf;
-  REAL hsb, hlb, qout, dels, qcol, alq;
-  REAL xlamx, dwat, dtmp, alfac, RF, wbar, hl_webb, zet;
-  REAL zo, zot, zoq, L, ut, tau, Ch, Ce, Chn_10, Cdn_10, Cen_10;
-  
-  //printf("y[13]:%6.6f, y[14]:%6.6f, y[15]:%6.6f, y[16]:%6.6f, y[17]:%6.6f, y[18]:%6.6f\n",y[13],y[14],y[15],y[16],y[17],y[18]);
+  REAL Cd, Ct, CC, Ribcu, Ribu, zetu, L10, tsr, qsr, charn, Bf;
+  REAL zet, zo, L, ut, tau;
+  // Derivatives with respect to ts
+  REAL Le_T, dt_T, dq_T, Ribu_T, zetu_T, L10_T, usr_T, tsr_T, qsr_T;
+  REAL zet_T, zo_T, L_T, ut_T, ug_T, Bf_T, den_T, num_T;
   
 /**********   set constants *************/
   Beta=1.2;
@@ -1161,234 +1285,184 @@ static void cor30a(REAL *y){
   fdg=1.00;
   tdk=273.16;
   grav=9.81;
+  zi=600.0; //PBL depth [m]
   /*************  air constants ************/
   Rgas=287.1;
-  Le=(2.501-.00237*ts)*1e6;
   cpa=1004.67;
-  cpv=cpa*(1+0.84*Q);
-  rhoa=P*100/(Rgas*(t+tdk)*(1+0.61*Q));
-  visa=1.326e-5*(1+6.542e-3*t+8.301e-6*t*t-4.84e-9*t*t*t);
-   /************  cool skin constants  *******/
-   Al=2.1e-5*pow(ts+3.2,0.79);
-   be=0.026;
-   cpw=4000;
-   rhow=1022;
-   visw=1e-6;
-   tcw=0.6;
-   bigc=16*grav*cpw*pow(rhow*visw,3.0)/(tcw*tcw*rhoa*rhoa);
-   wetc=0.622*Le*Qs/(Rgas*pow(ts+tdk,2.0));
-   
-   zo = 0.0;
-   zot=0.0;
-   zoq=0.0;
-   L=0.0;
-   /***************   wave parameters  *********/
-   //lwave=grav/2/PI*pow(twave,2);
-   //cwave=grav/2/PI*twave;
-   
-   /**************  compute aux stuff *******/
-   //Rns=Rs*.945;
-   //Rnl=0.97*(5.67e-8*pow(ts-0.3*jcool+tdk,4)-Rl);
-   
-   /***************   Begin bulk loop *******/
-   
-   /***************  first guess ************/
-   du=u-us;
-   dt=ts-t-.0098*zt;
-   dq=Qs-Q;
-   ta=t+tdk;
-   ug=.5;
-   dter=0.3; 
-   dqer=wetc*dter;
-   ut=sqrt(du*du+ug*ug);
-   u10=ut*log(10/1e-4)/log(zu/1e-4);
-   usr=.035*u10;
-   zo10=0.011*usr*usr/grav+0.11*visa/usr;
-   Cd10=pow(von/log(10/zo10),2);
-   Ch10=0.00115;
-   Ct10=Ch10/sqrt(Cd10);
-   zot10=10/exp(von/Ct10);
-   Cd=pow(von/log(zu/zo10),2);
-   Ct=von/log(zt/zot10);
-   CC=von*Ct/Cd;
-   Ribcu=-zu/zi/.004/pow(Beta,3);
-   Ribu=-grav*zu/ta*((dt-dter*jcool)+.61*ta*dq)/pow(ut,2);
-
-   if(Ribu<0){
-     zetu=CC*Ribu/(1+Ribu/Ribcu);
-   }else{
-     zetu=CC*Ribu*(1+27/9*Ribu/CC);
-   }
-   
-   L10=zu/zetu;
-   if (zetu>50){
-    nits=1;
-   }
-   usr=ut*von/(log(zu/zo10) - psiu_30(zu/L10));
-   tsr=-dt*von*fdg/(log(zt/zot10)-psit_30(zt/L10));
-   qsr=-dq*von*fdg/(log(zq/zot10)-psit_30(zq/L10));
-   //tsr=-(dt-dter*jcool)*von*fdg/(log(zt/zot10)-psit_30(zt/L10));
-   //qsr=-(dq-wetc*dter*jcool)*von*fdg/(log(zq/zot10)-psit_30(zq/L10));
+
+  for(n=0;n<y->N;n++) {
+    u=y->u[n]; //wind speed (m/s]  at height zu [m]
+    us=y->us[n]; //surface current speed in the wind direction [m/s]
+    ts=y->ts[n]; //interface water T [C]
+    t=y->t[n]; //bulk air temperature [C], height zt
+    Qs=y->Qs[n]; //water spec hum [kg/kg]
+    Q=y->Q[n]; //bulk air spec hum [kg/kg], height zq
+    P=y->P[n]; //Atmos surface pressure [mb]
+    zu=y->zu[n]; //wind speed measurement height [m]
+    zt=y->zt[n]; //air T measurement height [m]
+    zq=y->zq[n]; //air q measurement height [m]
+
+    Le=(2.501-.00237*ts)*1e6;
+    Le_T=-.00237*1e6;
+    rhoa=P*100/(Rgas*(t+tdk)*(1+0.61*Q));
+    visa=1.326e-5*(1+6.542e-3*t+8.301e-6*t*t-4.84e-9*t*t*t);
+
+    /***************  first guess ************/
+    du=u-us;
+    dt=ts-t-.0098*zt;
+    dt_T=1;
+    dq=Qs-Q;
+    dq_T=y->dQs[n];
+    ta=t+tdk;
+    ug=.5;
+    ut=sqrt(du*du+ug*ug);
+    ut_T=0;
+    u10=ut*log(10/1e-4)/log(zu/1e-4);
+    usr=.035*u10;
+    zo10=0.011*usr*usr/grav+0.11*visa/usr;
+    Cd10=pow(von/log(10/zo10),2);
+    Ch10=0.00115;
+    Ct10=Ch10/sqrt(Cd10);
+    zot10=10/exp(von/Ct10);
+    Cd=pow(von/log(zu/zo10),2);
+    Ct=von/log(zt/zot10);
+    CC=von*Ct/Cd;
+    Ribcu=-zu/zi/.004/pow(Beta,3);
+    Ribu=-grav*zu/ta*(dt+.61*ta*dq)/pow(ut,2);
+    Ribu_T=-grav*zu/ta*(dt_T+.61*ta*dq_T)/pow(ut,2);
+
+    if(Ribu<0){
+      zetu=CC*Ribu/(1+Ribu/Ribcu);
+      zetu_T=CC*Ribu_T/pow(1+Ribu/Ribcu,2);
+    }else{
+      zetu=CC*Ribu*(1+27/9*Ribu/CC);
+      zetu_T=CC*Ribu_T*(1+2*(27/9)*Ribu/CC);
+    }
    
-   tkt=.001;
+    L10=zu/zetu;
+    L10_T=-L10*zetu_T/zetu;
+    nits=3;
+    if (zetu>50){
+      nits=1;
+    }
+    den=log(zu/zo10) - psiu_30(zu/L10,&dpsi);
+    den_T=dpsi*zu*L10_T/(L10*L10);
+    usr=ut*von/den;
+    usr_T=-usr*den_T/den;
+    den=log(zt/zot10)-psit_30(zt/L10,&dpsi);
+    den_T=dpsi*zt*L10_T/(L10*L10);
+    tsr=-dt*von*fdg/den;
+    tsr_T=-von*fdg*(dt_T-dt*den_T/den)/den;
+    den=log(zq/zot10)-psit_30(zq/L10,&dpsi);
+    den_T=dpsi*zq*L10_T/(L10*L10);
+    qsr=-dq*von*fdg/den;
+    qsr_T=-von*fdg*(dq_T-dq*den_T/den)/den;
    
-   charn=0.011;
-   if (ut>10.0){
-     charn=0.011+(ut-10)/(18-10)*(0.018-0.011);
-   }
-   if(ut>18.0){
-     charn=0.018;
-   }
+    charn=0.011;
+    if (ut>10.0){
+      charn=0.011+(ut-10)/(18-10)*(0.018-0.011);
+    }
+    if(ut>18.0){
+      charn=0.018;
+    }
    
-   /***************  bulk loop ************/
-  for(i=0;i<nits;i++){
-     zet=von*grav*zu/ta*(tsr*(1+0.61*Q)+.61*ta*qsr)/(usr*usr)/(1+0.61*Q);
-     //Hard-wire it without waves
-     zo=charn*usr*usr/grav+0.11*visa/usr; // Eq. 6
-
-     //if((int)jwave==0){
-     //    zo=charn*usr*usr/grav+0.11*visa/usr;
-     //}
-     //if((int)jwave==1){
-     //    zo=50.0/2.0/PI*lwave*pow(usr/cwave,4.5)+0.11*visa/usr;
-     //} // Oost et al
-     //if((int)jwave==2){
-     //    zo=1200.0*hwave*pow(hwave/lwave,4.5)+0.11*visa/usr;
-     //} // Taylor and Yelland
+    /***************  bulk loop ************/
+    // tsr and qsr keep their first guess, since cor30.m updates them with
+    // zot10 and L10 in the loop
+    for(i=0;i<nits;i++){
+      num=tsr*(1+0.61*Q)+.61*ta*qsr;
+      num_T=tsr_T*(1+0.61*Q)+.61*ta*qsr_T;
+      zet=von*grav*zu/ta*num/(usr*usr)/(1+0.61*Q);
+      zet_T=von*grav*zu/ta*(num_T-2*num*usr_T/usr)/(usr*usr)/(1+0.61*Q);
+      //Hard-wire it without waves
+      zo=charn*usr*usr/grav+0.11*visa/usr; // Eq. 6
+      zo_T=(2*charn*usr/grav-0.11*visa/(usr*usr))*usr_T;
       
-      rr=zo*usr/visa; // Roughness reynolds number (see Eq. 7)
       L=zu/zet;
-      zoq=Min(1.15e-4,5.5e-5/pow(rr,-0.6));// Eq. 28
-      zot=zoq;
-      usr=ut*von/(log(zu/zo)-psiu_30(zu/L));
-      tsr=-dt*von*fdg/(log(zt/zot10)-psit_30(zt/L10));
-      qsr=-dq*von*fdg/(log(zq/zot10)-psit_30(zq/L10));
-      //tsr=-(dt-dter*jcool)*von*fdg/(log(zt/zot)-psit_30(zt/L));
-      //qsr=-(dq-wetc*dter*jcool)*von*fdg/(log(zq/zoq)-psit_30(zq/L));
+      L_T=-L*zet_T/zet;
+      den=log(zu/zo)-psiu_30(zu/L,&dpsi);
+      den_T=-zo_T/zo+dpsi*zu*L_T/(L*L);
+      usr=ut*von/den;
+      usr_T=von*(ut_T-ut*den_T/den)/den;
       Bf=-grav/ta*usr*(tsr+.61*ta*qsr);
+      Bf_T=-grav/ta*(usr_T*(tsr+.61*ta*qsr)+usr*(tsr_T+.61*ta*qsr_T));
       
       if (Bf>0){
 	ug=Beta*pow(Bf*zi,0.333);
+	ug_T=0.333*ug*Bf_T/Bf;
       }else{
 	ug=.2;
+	ug_T=0;
       }
       
       ut=sqrt(du*du+ug*ug);
-      //Rnl=0.97*(5.67e-8*pow(ts-dter*jcool+tdk,4)-Rl);
-      hsb=-rhoa*cpa*usr*tsr;
-      hlb=-rhoa*Le*usr*qsr;
-      /*
-      qout=Rnl+hsb+hlb;
-      dels=Rns*(.065+11*tkt-6.6e-5/tkt*(1-exp(-tkt/8.0e-4))); 	// Eq.16 Shortwave
-      qcol=qout-dels;
-      alq=Al*qcol+be*hlb*cpw/Le;					// Eq. 7 Buoy flux water
-
-     if (alq>0){
-     	xlamx=6/pow(1+pow(bigc*alq/pow(usr,4),0.75),0.333);				// Eq 13 Saunders
-        tkt=xlamx*visw/(sqrt(rhoa/rhow)*usr);			//Eq.11 Sub. thk
-
-     }else{
-       xlamx=6.0;
-       tkt=Min(.01,xlamx*visw/(sqrt(rhoa/rhow)*usr));			// Eq.11 Sub. thk
-     }
-     
-      dter=qcol*tkt/tcw; //  Eq.12 Cool skin
-      dqer=wetc*dter;
-      */
-     
-  }//bulk iter loop
-  
-  tau=rhoa*usr*usr*du/ut;  //stress
-  hsb=-rhoa*cpa*usr*tsr;
-  hlb=-rhoa*Le*usr*qsr;
-  
-  
-  ///****************   rain heat flux ********/
-  //dwat=2.11e-5*pow((t+tdk)/tdk,1.94); // water vapour diffusivity
-  //dtmp=(1.+3.309e-3*t-1.44e-6*t*t)*0.02411/(rhoa*cpa); 	//heat diffusivity
-  //alfac= 1/(1+(wetc*Le*dwat)/(cpa*dtmp));      	// wet bulb factor
-  //RF= rain*alfac*cpw*((ts-t-dter*jcool)+(Qs-Q-dqer*jcool)*Le/cpa)/3600;
-  //
-  ///****************   Webb et al. correection  ************/
-  //wbar=1.61*hlb/Le/(1+1.61*Q)/rhoa+hsb/rhoa/cpa/ta;//formulation in hlb already includes webb
-  //hl_webb=rhoa*wbar*Q*Le;
-  //
-  ///**************   compute transfer coeffs relative to ut @meas. ht **********/
-  Cd=tau/rhoa/ut/Max(.1,du);
-  Ch=-usr*tsr/ut/(dt);
-  Ce=-usr*qsr/(dq)/ut;
-  //Ch=-usr*tsr/ut/(dt-dter*jcool);
-  //Ce=-usr*qsr/(dq-dqer*jcool)/ut;
-  //
-  ///************  10-m neutral coeff realtive to ut ********/
-  //Cdn_10=von*von/log(10/zo)/log(10/zo);
-  //Chn_10=von*von*fdg/log(10/zo)/log(10/zot);
-  //Cen_10=von*von*fdg/log(10/zo)/log(10/zoq);
+      ut_T=ug*ug_T/ut;
+    }//bulk iter loop
   
-  /* Output variable back into the input array */
-  y[0] = hsb;
-  y[1] = hlb;
-  y[2] = tau;
-  y[3] = zo;
-  y[4] = zot;
-  y[5] = zoq;
-  y[6] = rhoa;
-  y[7] = usr;
-  y[8] = tsr;
-  y[9] = qsr;
-  y[10] = Cd;
-  //y[11] = Ch;
-  //y[12] = Ce;
-  //y[10] = dter;
-  //y[11] = dqer;
-  //y[12] = tkt;
-  //y[13] = RF;
-  //y[14] = ut;
-  //y[15] = Cd;
-  //y[16] = Ch;
-  //y[17] = Ce;
-  //y[18] = ug;
+    tau=rhoa*usr*usr*du/ut;  //stress
   
-  //printf("y[13]:%6.6f, y[14]:%6.6f, y[15]:%6.6f, y[16]:%6.6f, y[17]:%6.6f, y[18]:%6.6f\n",y[13],y[14],y[15],y[16],y[17],y[18]);
-  //y=[hsb hlb tau zo zot zoq L usr tsr qsr dter dqer tkt RF wbar Cd Ch Ce Cdn_10 Chn_10 Cen_10 ug ];
-  //   1   2   3   4  5   6  7  8   9  10   11   12  13  14  15  16 17 18    19      20    21  22
+    /* Output variables */
+    y->hsb[n]=-rhoa*cpa*usr*tsr;
+    y->hlb[n]=-rhoa*Le*usr*qsr;
+    y->dhsb[n]=-rhoa*cpa*(usr_T*tsr+usr*tsr_T);
+    y->dhlb[n]=-rhoa*(Le_T*usr*qsr+Le*(usr_T*qsr+usr*qsr_T));
+    y->rhoa[n]=rhoa;
+    y->usr[n]=usr;
+    y->tsr[n]=tsr;
+    y->qsr[n]=qsr;
+    y->Cd[n]=tau/rhoa/ut/Max(.1,du);
+  }
 } // End cor30a
 
-/* Velocity stability function */
-static REAL psiu_30(REAL zet){
+/* Velocity stability function and its derivative */
+static REAL psiu_30(REAL zet, REAL *dpsi){
   
-  REAL x, psik, psic, f, c,  psi;
+  REAL x, y, psik, psic, dpsik, dpsic, f, df, c, psi;
+
+  if(zet>0){
+    c=Min(50.0,0.35*zet);
+    psi=-(pow(1.0+1.0*zet,1.0)+.667*(zet-14.28)/exp(c)+8.525);
+    *dpsi=-(1.0+.667*(1.0-(0.35*zet<50.0 ? 0.35 : 0.0)*(zet-14.28))/exp(c));
+    return psi;
+  }
 
   x=pow(1.0-15.0*zet,0.25);
   psik=2.0*log((1.0+x)/2.0)+log((1+x*x)/2.0)-2*atan(x)+2.0*atan(1.0);
-  x=pow(1-10.15*zet,0.3333);
-  psic=1.5*log((1.0+x+x*x)/3.0)-sqrt(3.0)*atan((1.0+2.0*x)/sqrt(3.0))+4.0*atan(1.0)/sqrt(3.0);
+  dpsik=(2.0/(1.0+x)+2.0*(x-1.0)/(1.0+x*x))*(-3.75*x/(1.0-15.0*zet));
+  y=pow(1-10.15*zet,0.3333);
+  psic=1.5*log((1.0+y+y*y)/3.0)-sqrt(3.0)*atan((1.0+2.0*y)/sqrt(3.0))+4.0*atan(1.0)/sqrt(3.0);
+  dpsic=(1.5*(1.0+2.0*y)/(1.0+y+y*y)-2.0/(1.0+(1.0+2.0*y)*(1.0+2.0*y)/3.0))*(-10.15*0.3333*y/(1-10.15*zet));
   f=zet*zet/(1.0+zet*zet);
+  df=2.0*zet/((1.0+zet*zet)*(1.0+zet*zet));
   psi=(1.0-f)*psik+f*psic;                                               
+  *dpsi=(1.0-f)*dpsik+f*dpsic+df*(psic-psik);
   
-  if(zet>0){
-    c=Min(50.0,0.35*zet);
-    psi=-(pow(1.0+1.0*zet,1.0)+.667*(zet-14.28)/exp(c)+8.525);
-  }
   return psi;
   
 } // End psiu_30
 
-/* Temperature stability function */
-static REAL psit_30(REAL zet){
+/* Temperature stability function and its derivative */
+static REAL psit_30(REAL zet, REAL *dpsi){
  
-  REAL x, psik, psic, f, c,  psi;
+  REAL x, y, psik, psic, dpsik, dpsic, f, df, c, psi;
   
+  if(zet>0){
+    c=Min(50,0.35*zet);
+    psi=-(pow(1+2/3*zet,1.5)+0.6667*(zet-14.28)/exp(c)+8.525);
+    *dpsi=-(1.5*(2/3)*pow(1+2/3*zet,0.5)+0.6667*(1.0-(0.35*zet<50 ? 0.35 : 0.0)*(zet-14.28))/exp(c));
+    return psi;
+  }
+
   x=pow(1.0-15.0*zet,0.5);
   psik=2.0*log((1+x)/2.0);
-  x=pow(1-34.15*zet,0.3333);
-  psic=1.5*log((1.0+x+x*x)/3.0)-sqrt(3.0)*atan((1.0+2.0*x)/sqrt(3.0))+4.0*atan(1.0)/sqrt(3.0);
+  dpsik=2.0/(1.0+x)*(-7.5*x/(1.0-15.0*zet));
+  y=pow(1-34.15*zet,0.3333);
+  psic=1.5*log((1.0+y+y*y)/3.0)-sqrt(3.0)*atan((1.0+2.0*y)/sqrt(3.0))+4.0*atan(1.0)/sqrt(3.0);
+  dpsic=(1.5*(1.0+2.0*y)/(1.0+y+y*y)-2.0/(1.0+(1.0+2.0*y)*(1.0+2.0*y)/3.0))*(-34.15*0.3333*y/(1-34.15*zet));
   f=zet*zet/(1+zet*zet);
+  df=2.0*zet/((1.0+zet*zet)*(1.0+zet*zet));
   psi=(1.0-f)*psik+f*psic;  
+  *dpsi=(1.0-f)*dpsik+f*dpsic+df*(psic-psik);
   
-  if(zet>0){
-    c=Min(50,0.35*zet);
-    psi=-(pow(1+2/3*zet,1.5)+0.6667*(zet-14.28)/exp(c)+8.525);
-  }
   return psi;
 } // End psit_30
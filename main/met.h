@@ -12,10 +12,23 @@
 #include "phys.h"
 #include "util.h"
 #include "sendrecv.h"
+#include "radiation.h"
 //#include "mynetcdf.h"
 
 #define NTmet 3
-#define MAXNEAR 12
+// Number of input variables (Uwind, Vwind, Tair, Pair, rain, RH and cloud)
+#define NMETVAR 7
+
+/* Sparse (CSR) interpolation weights from the met points of a variable to the
+   computational cells, shared by the variables at the same points*/
+typedef struct _metweightT {
+  int Ns;       // Number of met points
+  DREAL *x, *y; // Their coordinates
+  int *rowptr;  // The weights of cell i are w[rowptr[i]..rowptr[i+1]-1] of points col[]
+  int *col;
+  REAL *w;
+  int Nnz;      // Length of col and w
+} metweightT;
 
 /* Structure array for meteorological input data*/
 typedef struct _metinT {
@@ -31,20 +44,20 @@ typedef struct _metinT {
   
   
   // Coordinate vectors for each variable
-  REAL *x_Uwind;
-  REAL *y_Uwind;
-  REAL *x_Vwind;
-  REAL *y_Vwind;
-  REAL *x_Tair;
-  REAL *y_Tair;
-  REAL *x_Pair;
-  REAL *y_Pair;
-  REAL *x_rain;
-  REAL *y_rain;
-  REAL *x_RH;
-  REAL *y_RH;
-  REAL *x_cloud;
-  REAL *y_cloud;
+  DREAL *x_Uwind;
+  DREAL *y_Uwind;
+  DREAL *x_Vwind;
+  DREAL *y_Vwind;
+  DREAL *x_Tair;
+  DREAL *y_Tair;
+  DREAL *x_Pair;
+  DREAL *y_Pair;
+  DREAL *x_rain;
+  DREAL *y_rain;
+  DREAL *x_RH;
+  DREAL *y_RH;
+  DREAL *x_cloud;
+  DREAL *y_cloud;
   
   // Height vectors
   REAL *z_Uwind;
@@ -52,39 +65,29 @@ typedef struct _metinT {
   REAL *z_Tair;
   REAL *z_RH;
   
+  // Regular grid input (metgrid=1), of which the points of each variable are the
+  // sub-window i0..i0+nxw-1, j0..j0+nyw-1 that covers the cells of this processor
+  size_t nx, ny;
+  DREAL *xg, *yg;
+  size_t i0, j0, nxw, nyw;
+  
   // Time records
   size_t nt; //Time
-  REAL *time;
+  DREAL *time;
   
   // Time record locators
   int t0;
   int t1;
   int t2;
   
-  // Interpolation Weights
-  REAL **WUwind;
-  REAL **WVwind;
-  REAL **WTair;
-  REAL **WPair;
-  REAL **Wrain;
-  REAL **WRH;
-  REAL **Wcloud;
-
-  // Pointers from each cell to the index of the MAXNEAR nearest met points
-  int max_nearest_Uwind;
-  int max_nearest_Vwind;
-  int max_nearest_Tair;
-  int max_nearest_Pair;
-  int max_nearest_rain;
-  int max_nearest_RH;
-  int max_nearest_cloud;
-  int **nearest_Uwind;
-  int **nearest_Vwind;
-  int **nearest_Tair;
-  int **nearest_Pair;
-  int **nearest_rain;
-  int **nearest_RH;
-  int **nearest_cloud;
+  // Interpolation Weights (variables at the same points share them)
+  metweightT *WUwind;
+  metweightT *WVwind;
+  metweightT *WTair;
+  metweightT *WPair;
+  metweightT *Wrain;
+  metweightT *WRH;
+  metweightT *Wcloud;
   
 
   
@@ -99,6 +102,36 @@ typedef struct _metinT {
   
 } metinT;
 
+/* Surface cells in structure-of-arrays form for the batched COARE3.0 fluxes*/
+typedef struct _coareT {
+  int N; // Number of surface cells
+  int *cell; // Cell of each entry
+
+  // Inputs (see cor30a)
+  REAL *u;
+  REAL *us;
+  REAL *ts;
+  REAL *t;
+  REAL *Qs;
+  REAL *dQs; // dQs/dts
+  REAL *Q;
+  REAL *P;
+  REAL *zu;
+  REAL *zt;
+  REAL *zq;
+
+  // Outputs and the derivatives of the heat fluxes with respect to ts
+  REAL *hsb;
+  REAL *hlb;
+  REAL *dhsb;
+  REAL *dhlb;
+  REAL *rhoa;
+  REAL *usr;
+  REAL *tsr;
+  REAL *qsr;
+  REAL *Cd;
+} coareT;
+
 /* Meteorological data on SUNTANS grid*/
 
 typedef struct _metT {
@@ -129,8 +162,9 @@ typedef struct _metT {
   REAL *Tstar;
   REAL *qstar;
   REAL *EP;
-  REAL *Htmp;
-  REAL *xtmp;  
+  REAL *dHdT; // Derivative of Hs+Hl+Hlw with respect to the surface temperature
+  coareT *coare;
+  radiationT *rad; // Solar geometry and light attenuation (see radiation.c)
 
   // Data on suntans grid centres (two time steps)
   REAL **Uwind_t;
@@ -148,5 +182,7 @@ void updateMetData(propT *prop, gridT *grid, metinT *metin, metT *met, int mypro
 void AllocateMet(propT *prop, gridT *grid, metT **met, int myproc);
 void AllocateMetIn(propT *prop, gridT *grid, metinT **metin, int myproc);
 void updateAirSeaFluxes(propT *prop, gridT *grid, physT *phys, metT *met,REAL **T);
-REAL shortwave(REAL time, REAL lat,REAL C_cloud, REAL toffset);
+void MetRepartition(propT *prop, gridT *grid, metinT *oldmetin, metinT **metin, metT **met, int myproc);
+void FreeMetIn(metinT *metin, gridT *grid, propT *prop);
+void FreeMet(metT *met, gridT *grid);
 #endif
@@ -0,0 +1,440 @@
+/*
+ * File: mixedcg.c
+ * ---------------
+ * Mixed-precision iterative refinement for the nonhydrostatic pressure solve
+ * (qmixed=1).  The residual of the full system is computed in the precision
+ * of REAL with the operators of phys.c (QCoefficients, OperatorQ and
+ * OperatorQC), and the correction is found with conjugate gradient iterations
+ * on a single-precision copy of the operator in contiguous arrays of phys.
+ *
+ */
+#include "mixedcg.h"
+#include "memory.h"
+#include "util.h"
+#include "sendrecv.h"
+
+// Private functions
+static void QStencilSingle(REAL **coef, REAL **fcoef, gridT *grid, physT *phys, propT *prop);
+static void OperatorQSingle(float *x, float *y, gridT *grid, physT *phys);
+static void PreconditionerSingle(float *x, float *xc, gridT *grid, physT *phys);
+static void TriSolveSingle(float *a, float *b, float *c, float *d, float *u, int N);
+static DREAL InnerProductSingle(float *x, float *y, int *start, gridT *grid, int myproc, 
+    int numprocs, MPI_Comm comm);
+
+/*
+ * Function: AllocateMixedCG
+ * Usage: AllocateMixedCG(grid,phys,prop);
+ * ---------------------------------------
+ * Allocate the single-precision copy of the nonhydrostatic pressure operator
+ * and the vectors of the inner solver, which are only needed when
+ * nonhydrostatic=1 and qmixed=1.  Otherwise the pointers are set to NULL.
+ *
+ */
+void AllocateMixedCG(gridT *grid, physT *phys, propT *prop) {
+
+  int i, N, Nc=grid->Nc;
+
+  phys->qstart = NULL;
+  phys->qdiag = phys->qlower = phys->qupper = phys->qvert = NULL;
+  phys->qface = phys->qcg = phys->qtri = NULL;
+  if(!prop->nonhydrostatic || !prop->qmixed)
+    return;
+
+  phys->qstart = (int *)SunMalloc((Nc+1)*sizeof(int),"AllocateMixedCG");
+  phys->qstart[0]=0;
+  for(i=0;i<Nc;i++)
+    phys->qstart[i+1]=phys->qstart[i]+grid->Nk[i];
+  N=phys->qstart[Nc];
+  phys->qdiag = (float *)SunMalloc(N*sizeof(float),"AllocateMixedCG");
+  phys->qlower = (float *)SunMalloc(N*sizeof(float),"AllocateMixedCG");
+  phys->qupper = (float *)SunMalloc(N*sizeof(float),"AllocateMixedCG");
+  phys->qvert = (float *)SunMalloc(N*sizeof(float),"AllocateMixedCG");
+  phys->qface = (float *)SunMalloc(grid->maxfaces*N*sizeof(float),"AllocateMixedCG");
+  phys->qcg = (float *)SunMalloc(5*N*sizeof(float),"AllocateMixedCG");
+  for(i=0;i<5*N;i++)
+    phys->qcg[i]=0;
+  phys->qtri = (float *)SunMalloc(4*(grid->Nkmax+1)*sizeof(float),"AllocateMixedCG");
+}
+
+/*
+ * Function: FreeMixedCG
+ * Usage: FreeMixedCG(phys);
+ * -------------------------
+ * Free the arrays allocated by AllocateMixedCG.
+ *
+ */
+void FreeMixedCG(physT *phys) {
+  free(phys->qstart);
+  free(phys->qdiag);
+  free(phys->qlower);
+  free(phys->qupper);
+  free(phys->qvert);
+  free(phys->qface);
+  free(phys->qcg);
+  free(phys->qtri);
+}
+
+/*
+ * Function: CGSolveQMixed
+ * Usage: CGSolveQMixed(q,src,c,grid,phys,prop,myproc,numprocs,comm);
+ * -------------------------------------------------------------------
+ * Solve for the nonhydrostatic pressure with mixed-precision iterative refinement,
+ * which is used by CGSolveQ when qmixed=1.  The residual r = src - L(q) is computed
+ * in the precision of REAL with OperatorQ or OperatorQC.  The correction e with
+ * L(e) = r is found with preconditioned conjugate gradient iterations in single
+ * precision on the contiguous copy of the operator set by QStencilSingle.  Each
+ * inner solve stops when its residual has been reduced by qmixedepsilon, and q
+ * is corrected until the residual of the full system is less than qepsilon
+ * (relative to the first residual if resnorm=1) or until qmaxiters inner
+ * iterations have been done in total.
+ *
+ * The preconditioners are the same as in CGSolveQ, and q and src are
+ * modified in the same way.
+ *
+ */
+void CGSolveQMixed(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm) {
+
+  int i, iptr, k, m, n, niters, N=phys->qstart[grid->Nc], *start=phys->qstart;
+  REAL **x, **p, **z;
+  float *e, *r, *rtmp, *ps, *zs;
+  DREAL mu, nu, alpha, eps, eps0, reps, reps0;
+
+  z = phys->stmp2;
+  x = q;
+  p = src;
+  e = phys->qcg;
+  r = e+N;
+  rtmp = e+2*N;
+  ps = e+3*N;
+  zs = e+4*N;
+
+  // Compute the preconditioner and the preconditioned solution
+  // and send it to neighboring processors
+  if(prop->qprecond==1) {
+    ConditionQ(c,grid,phys,prop,myproc,comm);
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+        p[i][k]/=c[i][k];
+        x[i][k]*=c[i][k];
+      }
+    }
+  }
+  ISendRecvCellData3D(x,grid,myproc,comm);
+
+  niters = prop->qmaxiters;
+
+  // Create the coefficients for the operator and its single-precision copy
+  QCoefficients(phys->wtmp,phys->qtmp,c,grid,phys,prop);
+  QStencilSingle(phys->wtmp,phys->qtmp,grid,phys,prop);
+
+  eps0=1;
+  n=0;
+  for(m=0;;m++) {
+
+    // Residual of the full system
+    if(prop->qprecond==1) OperatorQC(phys->wtmp,phys->qtmp,x,z,c,grid,phys,prop);
+    else OperatorQ(phys->wtmp,x,z,c,grid,phys,prop);
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+        r[start[i]+k] = p[i][k]-z[i][k];
+    }
+    eps=InnerProductSingle(r,r,start,grid,myproc,numprocs,comm);
+    if(m==0 && prop->resnorm) eps0=eps;
+
+    if(VERBOSE>2 && myproc==0) printf("CGSolve Pressure refinement: %d, resid=%e\n",m,sqrt(eps/eps0));
+    if(eps==0 || sqrt(eps/eps0)<prop->qepsilon || n>=niters)
+      break;
+
+    // Single-precision iterations for the correction, starting from e=0
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+        e[start[i]+k] = 0;
+    }
+    if(prop->qprecond==2) {
+      PreconditionerSingle(r,rtmp,grid,phys);
+      for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+        i = grid->cellp[iptr];
+
+        for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+          ps[start[i]+k] = rtmp[start[i]+k];
+      }
+      alpha = InnerProductSingle(r,rtmp,start,grid,myproc,numprocs,comm);
+    } else {
+      for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+        i = grid->cellp[iptr];
+
+        for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+          ps[start[i]+k] = r[start[i]+k];
+      }
+      alpha = eps;
+    }
+    reps=reps0=eps;
+
+    while(n<niters) {
+      n++;
+
+      ISendRecvCellData3DSingle(ps,start,grid,myproc,comm);
+      OperatorQSingle(ps,zs,grid,phys);
+
+      mu = 1/alpha;
+      nu = alpha/InnerProductSingle(ps,zs,start,grid,myproc,numprocs,comm);
+
+      for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+        i = grid->cellp[iptr];
+
+        for(k=start[i]+grid->ctop[i];k<start[i]+grid->Nk[i];k++) {
+          e[k] += nu*ps[k];
+          r[k] -= nu*zs[k];
+        }
+      }
+      if(prop->qprecond==2) {
+        PreconditionerSingle(r,rtmp,grid,phys);
+        alpha = InnerProductSingle(r,rtmp,start,grid,myproc,numprocs,comm);
+        mu*=alpha;
+        for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+          i = grid->cellp[iptr];
+
+          for(k=start[i]+grid->ctop[i];k<start[i]+grid->Nk[i];k++) 
+            ps[k] = rtmp[k] + mu*ps[k];
+        }
+        reps = InnerProductSingle(r,r,start,grid,myproc,numprocs,comm);
+      } else {
+        alpha = InnerProductSingle(r,r,start,grid,myproc,numprocs,comm);
+        mu*=alpha;
+        for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+          i = grid->cellp[iptr];
+
+          for(k=start[i]+grid->ctop[i];k<start[i]+grid->Nk[i];k++) 
+            ps[k] = r[k] + mu*ps[k];
+        }
+        reps = alpha;
+      }
+
+      if(VERBOSE>3 && myproc==0) printf("CGSolve Pressure Iteration: %d, inner resid=%e\n",n,sqrt(reps/reps0));
+      if(reps==0 || sqrt(reps/reps0)<prop->qmixedepsilon)
+        break;
+    }
+
+    // Correct the solution and send it to the neighboring processors
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+        x[i][k] += e[start[i]+k];
+    }
+    ISendRecvCellData3D(x,grid,myproc,comm);
+  }
+
+  prop->qcgsolves++;
+  prop->qcgiters+=n;
+  prop->qcgmaxn=Max(prop->qcgmaxn,n);
+
+  if(myproc==0 && VERBOSE>2) {
+    if(eps==0)
+      printf("Warning...Time step %d, norm of pressure source is 0.\n",prop->n);
+    else
+      if(sqrt(eps/eps0)>=prop->qepsilon)  printf("Warning... Time step %d, Pressure iteration not converging after %d steps! RES=%e > %.2e\n",
+          prop->n,n,sqrt(eps/eps0),prop->qepsilon);
+      else printf("Time step %d, CGSolve pressure converged after %d iterations and %d refinements, res=%e < %.2e\n",
+          prop->n,n,m,sqrt(eps/eps0),prop->qepsilon);
+  }
+
+  // Rescale the preconditioned solution 
+  if(prop->qprecond==1) {
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) 
+        x[i][k]/=c[i][k];
+    }
+    ISendRecvCellData3D(x,grid,myproc,comm);
+  }
+}
+
+/*
+ * Function: QStencilSingle
+ * Usage: QStencilSingle(coef,fcoef,grid,phys,prop);
+ * -------------------------------------------------
+ * Store the operator of OperatorQ (or of OperatorQC if qprecond=1) with the 
+ * coefficients from QCoefficients in the single-precision arrays of phys as
+ *
+ * y(k) = qdiag(k)*x(k) + qlower(k)*x(k-1) + qupper(k)*x(k+1) + sum(nf) qface(k,nf)*x(nc,k)
+ *
+ * for the computational cells.  qvert is the part of qdiag from the vertical
+ * derivatives, which together with qlower and qupper gives the tridiagonal
+ * matrix of the qprecond=2 preconditioner.
+ *
+ */
+static void QStencilSingle(REAL **coef, REAL **fcoef, gridT *grid, physT *phys, propT *prop) {
+
+  int i, iptr, k, ik, nf, nc, ne, kmin, maxfaces=grid->maxfaces;
+  REAL f;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+
+    // vertical derivatives with the same boundary conditions as OperatorQ
+    for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+      ik = phys->qstart[i]+k;
+      phys->qlower[ik] = (k>grid->ctop[i]) ? coef[i][k] : 0;
+      phys->qupper[ik] = (k<grid->Nk[i]-1) ? coef[i][k+1] : 0;
+      phys->qvert[ik] = -phys->qlower[ik]-phys->qupper[ik];
+      for(nf=0;nf<maxfaces;nf++)
+        phys->qface[ik*maxfaces+nf]=0;
+    }
+    phys->qvert[phys->qstart[i]+grid->ctop[i]]-=2*coef[i][grid->ctop[i]];
+
+    for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+      ik = phys->qstart[i]+k;
+      phys->qdiag[ik] = (prop->qprecond==1) ? -1 : phys->qvert[ik];
+    }
+
+    // horizontal derivatives
+    for(nf=0;nf<grid->nfaces[i];nf++) 
+      if((nc=grid->neigh[i*grid->maxfaces+nf])!=-1) {
+
+        ne = grid->face[i*grid->maxfaces+nf];
+
+        if(grid->ctop[nc]>grid->ctop[i])
+          kmin = grid->ctop[nc];
+        else
+          kmin = grid->ctop[i];
+
+        for(k=kmin;k<grid->Nke[ne];k++) {
+          ik = phys->qstart[i]+k;
+          if(prop->qprecond==1)
+            f = fcoef[i*grid->maxfaces+nf][k];
+          else {
+            f = grid->dzf[ne][k]*phys->D[ne];
+            phys->qdiag[ik]-=f;
+          }
+          phys->qface[ik*maxfaces+nf]=f;
+        }
+      }
+  }
+}
+
+/*
+ * Function: OperatorQSingle
+ * Usage: OperatorQSingle(x,y,grid,phys);
+ * --------------------------------------
+ * Single-precision version of OperatorQ and OperatorQC with the operator
+ * stored by QStencilSingle.  x and y are indexed with phys->qstart.
+ *
+ */
+static void OperatorQSingle(float *x, float *y, gridT *grid, physT *phys) {
+
+  int i, iptr, k, nf, nc, ne, kmin, s, sc, maxfaces=grid->maxfaces;
+  float *diag=phys->qdiag, *lower=phys->qlower, *upper=phys->qupper, *face=phys->qface;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    s = phys->qstart[i];
+
+    for(k=s+grid->ctop[i];k<s+grid->Nk[i];k++) 
+      y[k]=diag[k]*x[k];
+    for(k=s+grid->ctop[i]+1;k<s+grid->Nk[i];k++)
+      y[k]+=lower[k]*x[k-1];
+    for(k=s+grid->ctop[i];k<s+grid->Nk[i]-1;k++)
+      y[k]+=upper[k]*x[k+1];
+
+    for(nf=0;nf<grid->nfaces[i];nf++) 
+      if((nc=grid->neigh[i*maxfaces+nf])!=-1) {
+
+        ne = grid->face[i*maxfaces+nf];
+        sc = phys->qstart[nc];
+
+        if(grid->ctop[nc]>grid->ctop[i])
+          kmin = grid->ctop[nc];
+        else
+          kmin = grid->ctop[i];
+
+        for(k=kmin;k<grid->Nke[ne];k++) 
+          y[s+k]+=face[(s+k)*maxfaces+nf]*x[sc+k];
+      }
+  }
+}
+
+/*
+ * Function: PreconditionerSingle
+ * Usage: PreconditionerSingle(x,xc,grid,phys);
+ * --------------------------------------------
+ * Single-precision version of Preconditioner, which solves the tridiagonal
+ * system of the vertical derivatives in each column with xc = M^{-1} x.
+ *
+ */
+static void PreconditionerSingle(float *x, float *xc, gridT *grid, physT *phys) {
+
+  int i, iptr, k, s, N=grid->Nkmax+1;
+  float *a = phys->qtri, *b = a+N, *c = b+N, *d = c+N;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    s = phys->qstart[i];
+
+    if(grid->ctop[i]<grid->Nk[i]-1) {
+      for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+        a[k]=phys->qlower[s+k];
+        b[k]=phys->qvert[s+k];
+        c[k]=phys->qupper[s+k];
+        d[k]=x[s+k];
+      }
+      TriSolveSingle(&(a[grid->ctop[i]]),&(b[grid->ctop[i]]),&(c[grid->ctop[i]]),
+          &(d[grid->ctop[i]]),&(xc[s+grid->ctop[i]]),grid->Nk[i]-grid->ctop[i]);
+    } else 
+      xc[s+grid->ctop[i]]=x[s+grid->ctop[i]]/phys->qvert[s+grid->ctop[i]];
+  }
+}
+
+/*
+ * Function: TriSolveSingle
+ * Usage: TriSolveSingle(a,b,c,d,u,N);
+ * -----------------------------------
+ * Single-precision version of TriSolve in util.c.
+ *
+ */
+static void TriSolveSingle(float *a, float *b, float *c, float *d, float *u, int N) {
+
+  int k;
+
+  for(k=1;k<N;k++) {
+    b[k]-=a[k]*c[k-1]/b[k-1];
+    d[k]-=a[k]*d[k-1]/b[k-1];
+  }
+
+  u[N-1]=d[N-1]/b[N-1];
+
+  for(k=N-2;k>=0;k--)
+    u[k] = d[k]/b[k]-c[k]*u[k+1]/b[k];
+}
+
+/*
+ * Function: InnerProductSingle
+ * Usage: InnerProductSingle(x,y,phys->qstart,grid,myproc,numprocs,comm);
+ * ----------------------------------------------------------------------
+ * Same as InnerProduct3 for single-precision vectors indexed with start.
+ * The sum is computed in double precision.
+ *
+ */
+static DREAL InnerProductSingle(float *x, float *y, int *start, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
+
+  int i, k, iptr;
+  DREAL sum, mysum=0;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+
+    for(k=start[i]+grid->ctop[i];k<start[i]+grid->Nk[i];k++)
+      mysum+=(DREAL)x[k]*y[k];
+  }
+  MPI_Reduce(&mysum,&(sum),1,MPI_DOUBLE,MPI_SUM,0,comm);
+  MPI_Bcast(&sum,1,MPI_DOUBLE,0,comm);
+
+  return sum;
+}
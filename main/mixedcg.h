@@ -0,0 +1,20 @@
+/*
+ * File: mixedcg.h
+ * ---------------
+ * Header file for mixedcg.c, which solves for the nonhydrostatic pressure
+ * with mixed-precision iterative refinement when qmixed=1.
+ *
+ */
+#ifndef _mixedcg_h
+#define _mixedcg_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+
+void AllocateMixedCG(gridT *grid, physT *phys, propT *prop);
+void FreeMixedCG(physT *phys);
+void CGSolveQMixed(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, propT *prop,
+    int myproc, int numprocs, MPI_Comm comm);
+
+#endif
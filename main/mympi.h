@@ -21,6 +21,13 @@
 #include "suntans.h"
 #include "fileio.h"
 
+// MPI datatype of REAL
+#ifdef SINGLEPRECISION
+#define MPI_REALTYPE MPI_FLOAT
+#else
+#define MPI_REALTYPE MPI_DOUBLE
+#endif
+
 void StartMpi(int *argc, char **argv[], MPI_Comm *comm, int *myproc, int *numprocs);
 void EndMpi(MPI_Comm *comm);
 REAL MPI_GetValue(char *file, char *str, char *call, int myproc);
@@ -24,7 +24,7 @@ int MPI_NCClose(int ncid){
     return -1;
 }
 
-int getTimeRec(REAL nctime, REAL *time, int nt){
+int getTimeRec(DREAL nctime, DREAL *time, int nt){
     return -1;
 }
 
@@ -36,7 +36,7 @@ size_t returndimlenBC(int ncid, char *dimname){
     return 0;
 }
 
-int getTimeRecBnd(REAL nctime, REAL *time, int nt){
+int getTimeRecBnd(DREAL nctime, DREAL *time, int nt){
     return -1;
 }
 
@@ -72,6 +72,41 @@ void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int bl
   exit(EXIT_FAILURE);
 }
 
+void InitialiseOutputSetNC(propT *prop, gridT *grid, outsetT *set, int myproc){
+
+  printf("Error: NetCDF Libraries required. Set ntoutStations = 0 and ntoutSubdomain = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+void WriteOutputSetNC(propT *prop, outsetT *set, int myproc){
+
+  printf("Error: NetCDF Libraries required. Set ntoutStations = 0 and ntoutSubdomain = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+void InitialiseAnalysisNC(propT *prop, gridT *grid, analysisT *an, int numprocs, MPI_Comm comm, int myproc){
+
+  if(myproc==0) printf("Error: NetCDF Libraries required. Set analysis = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+void WriteAnalysisFieldNC(propT *prop, gridT *grid, analysisT *an, int o, int numprocs, MPI_Comm comm, int myproc){
+
+  if(myproc==0) printf("Error: NetCDF Libraries required. Set analysis = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+void WriteAnalysisTimeNC(propT *prop, analysisT *an, int myproc){
+
+  if(myproc==0) printf("Error: NetCDF Libraries required. Set analysis = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
 void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int myproc){
 
   if(myproc==0) printf("Error: NetCDF Libraries required. Set calcaverge = 0\n");
@@ -92,6 +127,20 @@ void WriteAverageNCmerge(propT *prop, gridT *grid, averageT *average, physT *phy
   exit(EXIT_FAILURE);
 }
 
+void ReadFieldNC(fieldT *field, REAL *extent, int myproc){
+
+  if(myproc==0) printf("Error: NetCDF Libraries required to read %s\n",field->file);
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+void ReadMetNCgrid(propT *prop, metinT *metin, int myproc){
+
+  if(myproc==0) printf("Error: NetCDF Libraries required. Set metmodel = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
 void ReadMetNCcoord(propT *prop, gridT *grid, metinT *metin,int myproc){
 
   if(myproc==0) printf("Error: NetCDF Libraries required. Set metmodel = 0\n");
@@ -7,6 +7,38 @@
 
 #include "mynetcdf.h"
 #include "merge.h"
+#include "timestep.h"
+#include "netcdf_meta.h"
+#if NC_HAS_ZSTD
+#include "netcdf_filter.h"
+#endif
+
+// netCDF functions for REAL arrays, which the library converts to and from the
+// double variables of the files in either precision
+#ifdef SINGLEPRECISION
+#define nc_get_var_real nc_get_var_float
+#define nc_get_vara_real nc_get_vara_float
+#define nc_put_var_real nc_put_var_float
+#define nc_put_vara_real nc_put_vara_float
+#define nc_put_att_real nc_put_att_float
+#else
+#define nc_get_var_real nc_get_var_double
+#define nc_get_vara_real nc_get_vara_double
+#define nc_put_var_real nc_put_var_double
+#define nc_put_vara_real nc_put_vara_double
+#define nc_put_att_real nc_put_att_double
+#endif
+
+// Significant digits of the output fields, recorded when they are defined
+// (see nc_def_outputvar) and dropped when their file is closed, and the
+// scratch buffer for bit grooming them (see nc_put_vara_output)
+typedef struct {
+  int ncid, varid, nsd, isfloat;
+} ncgroomT;
+static ncgroomT *ncgroomvars = NULL;
+static int ncgroomnum = 0, ncgroommax = 0;
+static void *ncgroombuf = NULL;
+static size_t ncgroombytes = 0;
 
 /***********************************************
 * Private functions
@@ -22,17 +54,32 @@ static void nc_addattr_real(int ncid, int varid, char *attname, REAL *attvalue);
 
 void nc_read_3D(int ncid, char *vname, size_t *start, size_t *count, REAL ***tmparray);
 void nc_read_2D(int ncid, char *vname, size_t *start, size_t *count, REAL **tmparray, int myproc);
-void nc_write_double(int ncid, char *vname, REAL *tmparray, int myproc);
+void nc_write_double(int ncid, char *vname, DREAL *tmparray, int myproc);
+void nc_write_real(int ncid, char *vname, REAL *tmparray, int myproc);
 void nc_write_int(int ncid, char *vname, int *tmparray, int myproc);
 void nc_write_intvar(int ncid, char *vname, gridT *grid, int *tmparray, int myproc);
 void nc_write_doublevar(int ncid, char *vname, gridT *grid, REAL *tmparray, int myproc);
+static void nc_write_compflags(int ncid, gridT *grid, int myproc);
+static int nc_outputopt(char *key, char *vname, int value);
+static int nc_def_outputvar(propT *prop, int ncid, char *vname, int ndims, int *dimids, int myproc);
+static void nc_set_sigdigits(int ncid, int varid, int nsd, int isfloat);
+static int nc_put_vara_output(int ncid, int varid, const size_t *start, const size_t *count, const REAL *data);
+static void BitGroom(double *data, size_t n, int nsd);
+static void BitGroomFloat(float *data, size_t n, int nsd);
 
 static void nc_write_2D_merge(int ncid, int tstep, REAL *array, propT *prop, gridT *grid, char *varname, int numprocs, int myproc, MPI_Comm comm);
 static void nc_write_3D_merge(int ncid, int tstep, REAL **array, propT *prop, gridT *grid, char *varname, int isw, int numprocs, int myproc, MPI_Comm comm);
 static void nc_write_3Dedge_merge(int ncid, int tstep, REAL **array, propT *prop, gridT *grid, char *varname,int isw, int numprocs, int myproc, MPI_Comm comm);
 
+static void nc_write_2D_output(int ncid, propT *prop, gridT *grid, REAL *array, char *vname, int blowup);
+static void nc_write_3D_output(int ncid, propT *prop, gridT *grid, physT *phys, REAL **array, char *vname, int isw, int blowup);
+static void nc_write_3Dedge_output(int ncid, propT *prop, gridT *grid, physT *phys, REAL **array, char *vname, int blowup);
+
 static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid, metT *met, int myproc);
 
+static void ReadMetNCwindow(propT *prop, metinT *metin, int t0, int myproc);
+static void ReadMetNCheight(int ncid, char *vname, REAL *z, int N, int myproc);
+
 /*########################################################
 *
 * General functions
@@ -83,9 +130,14 @@ int MPI_NCOpen(char *file, int perms, char *caller, int myproc) {
  * Wrapper function for nc_close()
  */
 int MPI_NCClose(int ncid){
-    int retval;
+    int retval, n, m;
     if ((retval = nc_close(ncid)))
 	ERR(retval);
+    // The id may be reused for the next file
+    for(n=0, m=0;n<ncgroomnum;n++)
+      if(ncgroomvars[n].ncid!=ncid)
+	ncgroomvars[m++]=ncgroomvars[n];
+    ncgroomnum=m;
     return retval;
 }
 
@@ -111,7 +163,7 @@ void nc_read_3D(int ncid, char *vname, size_t start[3], size_t count[3], REAL **
 	ERR(retval);
 //    if ((retval = nc_get_vara_double(ncid, varid, start, count, &tmparray[0][0][0]))) 
 //	ERR(retval);    
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &outdata[0][0][0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &outdata[0][0][0]))) 
 	ERR(retval); 
 
     // Loop through and insert the vector values into an array
@@ -153,7 +205,7 @@ void nc_read_2D(int ncid, char *vname, size_t start[2], size_t count[2], REAL **
     //if ((retval = nc_get_vara_double(ncid, varid, start, count, &tmparray[0][0]))) 
     //  ERR(retval); 
     
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &outdata[0][0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &outdata[0][0]))) 
 	ERR(retval); 
     // Loop through and insert the vector values into an array
     for(n=0;n<(int)count[0];n++){
@@ -175,7 +227,7 @@ void nc_read_2D(int ncid, char *vname, size_t start[2], size_t count[2], REAL **
  * Wrapper function for writing a double variable
  *
  */
-void nc_write_double(int ncid, char *vname, REAL *tmparray, int myproc){
+void nc_write_double(int ncid, char *vname, DREAL *tmparray, int myproc){
     int varid, retval;
 
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
@@ -185,6 +237,23 @@ void nc_write_double(int ncid, char *vname, REAL *tmparray, int myproc){
 
 } //end function
 
+/*
+ * Function: nc_write_real()
+ * --------------------------
+ *
+ * Wrapper function for writing a REAL array to a double variable
+ *
+ */
+void nc_write_real(int ncid, char *vname, REAL *tmparray, int myproc){
+    int varid, retval;
+
+    if ((retval = nc_inq_varid(ncid, vname, &varid)))
+	ERR(retval);
+    if ((retval = nc_put_var_real(ncid, varid, tmparray)))
+      ERR(retval);
+
+} //end function
+
 /*
  * Function: nc_write_int()
  * --------------------------
@@ -230,6 +299,291 @@ void nc_write_intvar(int ncid, char *vname, gridT *grid, int *tmparray, int mypr
 
 } //end function
 
+/*
+ * Function: nc_write_compflags()
+ * ------------------------------
+ *
+ * Writes the cellcomp and edgecomp flags that mark the cells and edges
+ * that are computed (rather than ghost or interprocessor copies) on this
+ * processor, so that sunjoin can pick a single owner for each global index.
+ *
+ */
+static void nc_write_compflags(int ncid, gridT *grid, int myproc){
+    int i, j, iptr, jptr;
+    int *flag;
+
+    flag = (int *)SunMalloc((grid->Nc>grid->Ne ? grid->Nc : grid->Ne)*sizeof(int),"nc_write_compflags");
+
+    for(i=0;i<grid->Nc;i++)
+      flag[i]=0;
+    for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+      i = grid->cellp[iptr];
+      flag[i]=1;
+    }
+    nc_write_int(ncid,"cellcomp",flag,myproc);
+
+    for(j=0;j<grid->Ne;j++)
+      flag[j]=0;
+    for(jptr=grid->edgedist[0];jptr<grid->edgedist[EDGEMAX];jptr++) {
+      j = grid->edgep[jptr];
+      flag[j]=1;
+    }
+    nc_write_int(ncid,"edgecomp",flag,myproc);
+
+    SunFree(flag,(grid->Nc>grid->Ne ? grid->Nc : grid->Ne)*sizeof(int),"nc_write_compflags");
+} //end function
+
+/*
+ * Function: nc_outputopt()
+ * ------------------------
+ *
+ * Returns the storage option key for variable vname, i.e. <key>_<vname>
+ * if it is in suntans.dat, otherwise value (the global setting in prop).
+ *
+ */
+static int nc_outputopt(char *key, char *vname, int value){
+    int status;
+    char str[BUFFERLENGTH];
+    REAL val;
+
+    sprintf(str,"%s_%s",key,vname);
+    val = GetValue(DATAFILE,str,&status);
+    if(status)
+      return (int)val;
+    return value;
+} //end function
+
+/*
+ * Function: nc_def_outputvar()
+ * ----------------------------
+ *
+ * Defines a time-dependent output field (time first, cells or edges last)
+ * with the storage set by ncdeflate, ncshuffle, nczstd, ncfloat, ncsigdigits
+ * and ncchunkcells in suntans.dat.  Chunks hold one time record of all layers
+ * and at most ncchunkcells cells, and the chunk cache holds a whole record so
+ * each chunk is compressed and written once per output step.  Bit grooming
+ * is applied at write time by nc_put_vara_output, triggered by the
+ * significant_digits attribute.  Returns the variable id.
+ *
+ */
+static int nc_def_outputvar(propT *prop, int ncid, char *vname, int ndims, int *dimids, int myproc){
+    int varid, retval, i, deflate, shuffle, zstd, isfloat, nsd, chunkcells;
+    size_t dimlen, nchunks, chunkbytes;
+    size_t chunks[NC_MAX_VAR_DIMS];
+    const REAL FILLVALUE = (REAL)EMPTY;
+    const float FILLVALUEF = (float)EMPTY;
+
+    deflate = nc_outputopt("ncdeflate",vname,prop->ncdeflate);
+    shuffle = nc_outputopt("ncshuffle",vname,prop->ncshuffle);
+    zstd = nc_outputopt("nczstd",vname,prop->nczstd);
+    isfloat = nc_outputopt("ncfloat",vname,prop->ncfloat);
+    nsd = nc_outputopt("ncsigdigits",vname,prop->ncsigdigits);
+    chunkcells = nc_outputopt("ncchunkcells",vname,prop->ncchunkcells);
+
+    if ((retval = nc_def_var(ncid,vname,isfloat ? NC_FLOAT : NC_DOUBLE,ndims,dimids,&varid)))
+      ERR(retval);
+    if(isfloat) {
+      if ((retval = nc_def_var_fill(ncid,varid,0,&FILLVALUEF)))
+	ERR(retval);
+    } else {
+      if ((retval = nc_def_var_fill(ncid,varid,0,&FILLVALUE)))
+	ERR(retval);
+    }
+
+    // One time record per chunk, split into chunkcells along the last dimension
+    chunks[0]=1;
+    nchunks=1;
+    for(i=1;i<ndims;i++) {
+      if ((retval = nc_inq_dimlen(ncid,dimids[i],&dimlen)))
+	ERR(retval);
+      chunks[i]=(dimlen>0 ? dimlen : 1);
+    }
+    if(ndims>1 && chunkcells>0 && chunks[ndims-1]>chunkcells) {
+      nchunks=(chunks[ndims-1]+chunkcells-1)/chunkcells;
+      chunks[ndims-1]=chunkcells;
+    }
+    if ((retval = nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks)))
+      ERR(retval);
+
+    chunkbytes=(isfloat ? sizeof(float) : sizeof(double));
+    for(i=0;i<ndims;i++)
+      chunkbytes*=chunks[i];
+    if ((retval = nc_set_var_chunk_cache(ncid,varid,nchunks*chunkbytes,2*nchunks+1,1.0)))
+      ERR(retval);
+
+    if(zstd>0) {
+#if NC_HAS_ZSTD
+      if ((retval = nc_def_var_zstandard(ncid,varid,zstd)))
+	ERR(retval);
+      deflate=0;
+#else
+      if(myproc==0 && VERBOSE>0)
+	printf("Warning: netcdf library has no zstandard support, using deflate for %s\n",vname);
+      if(deflate==0)
+	deflate=1;
+#endif
+    }
+    if(deflate>0 || shuffle)
+      if ((retval = nc_def_var_deflate(ncid,varid,shuffle,deflate>0,deflate)))
+	ERR(retval);
+
+    if(nsd>0)
+      nc_addattr_int(ncid,varid,"significant_digits",&nsd);
+    nc_set_sigdigits(ncid,varid,nsd,isfloat);
+
+    return varid;
+} //end function
+
+/*
+ * Function: nc_set_sigdigits()
+ * ----------------------------
+ *
+ * Records the significant digits of an output field and whether it is
+ * stored as float, which nc_put_vara_output looks up at every write.
+ *
+ */
+static void nc_set_sigdigits(int ncid, int varid, int nsd, int isfloat){
+    int n;
+    ncgroomT *vars;
+
+    for(n=0;n<ncgroomnum;n++)
+      if(ncgroomvars[n].ncid==ncid && ncgroomvars[n].varid==varid)
+	break;
+    if(n==ncgroommax) {
+      vars=(ncgroomT *)SunMalloc(2*(ncgroommax+8)*sizeof(ncgroomT),"nc_set_sigdigits");
+      if(ncgroomvars) {
+	memcpy(vars,ncgroomvars,ncgroomnum*sizeof(ncgroomT));
+	SunFree(ncgroomvars,ncgroommax*sizeof(ncgroomT),"nc_set_sigdigits");
+      }
+      ncgroomvars=vars;
+      ncgroommax=2*(ncgroommax+8);
+    }
+    if(n==ncgroomnum)
+      ncgroomnum++;
+    ncgroomvars[n].ncid=ncid;
+    ncgroomvars[n].varid=varid;
+    ncgroomvars[n].nsd=nsd;
+    ncgroomvars[n].isfloat=isfloat;
+} //end function
+
+/*
+ * Function: nc_put_vara_output()
+ * ------------------------------
+ *
+ * Wrapper for nc_put_vara_double used for the output fields.  If the
+ * variable has significant digits (see nc_set_sigdigits) a bit-groomed copy
+ * of the data is written instead, so the model arrays are not modified.
+ * The copy is groomed in single precision when the variable is stored as
+ * float or REAL is float, since rounding a groomed double to float would
+ * undo the grooming.
+ *
+ */
+static int nc_put_vara_output(int ncid, int varid, const size_t *start, const size_t *count, const REAL *data){
+    int ndims, i, isfloat;
+    size_t n=1, bytes;
+    ncgroomT *var=NULL;
+
+    for(i=0;i<ncgroomnum;i++)
+      if(ncgroomvars[i].ncid==ncid && ncgroomvars[i].varid==varid) {
+	var=&ncgroomvars[i];
+	break;
+      }
+    if(var==NULL || var->nsd<=0)
+      return nc_put_vara_real(ncid,varid,start,count,data);
+
+    nc_inq_varndims(ncid,varid,&ndims);
+    for(i=0;i<ndims;i++)
+      n*=count[i];
+    isfloat = (var->isfloat || sizeof(REAL)==sizeof(float));
+    bytes = n*(isfloat ? sizeof(float) : sizeof(double));
+    if(bytes>ncgroombytes) {
+      if(ncgroombuf)
+	SunFree(ncgroombuf,ncgroombytes,"nc_put_vara_output");
+      ncgroombuf=SunMalloc(bytes,"nc_put_vara_output");
+      ncgroombytes=bytes;
+    }
+
+    if(isfloat) {
+      for(i=0;i<n;i++)
+	((float *)ncgroombuf)[i]=(float)data[i];
+      BitGroomFloat((float *)ncgroombuf,n,var->nsd);
+      return nc_put_vara_float(ncid,varid,start,count,(float *)ncgroombuf);
+    }
+    for(i=0;i<n;i++)
+      ((double *)ncgroombuf)[i]=data[i];
+    BitGroom((double *)ncgroombuf,n,var->nsd);
+    return nc_put_vara_double(ncid,varid,start,count,(double *)ncgroombuf);
+} //end function
+
+/*
+ * Function: BitGroom()
+ * --------------------
+ *
+ * Keeps nsd significant decimal digits of each value by setting the
+ * trailing mantissa bits alternately to zero and one (bit grooming,
+ * Zender 2016), which leaves the mean unbiased and makes the data much more
+ * compressible.  Fill values (EMPTY) and non-finite values are untouched.
+ *
+ */
+static void BitGroom(double *data, size_t n, int nsd){
+    size_t i;
+    int keepbits;
+    unsigned long long mask;
+    union {
+      double r;
+      unsigned long long u;
+    } v;
+
+    keepbits = (int)ceil(nsd*log(10.0)/log(2.0))+1;
+    if(keepbits>=52)
+      return;
+    mask = ~0ULL << (52-keepbits);
+
+    for(i=0;i<n;i++) {
+      if(data[i]==(double)EMPTY || data[i]==0 || data[i]!=data[i] || fabs(data[i])>1e300)
+	continue;
+      v.r = data[i];
+      if(i%2==0)
+	v.u &= mask;
+      else
+	v.u |= ~mask;
+      data[i] = v.r;
+    }
+} //end function
+
+/*
+ * Function: BitGroomFloat()
+ * -------------------------
+ *
+ * Single-precision version of BitGroom for the 23-bit mantissa of a float.
+ *
+ */
+static void BitGroomFloat(float *data, size_t n, int nsd){
+    size_t i;
+    int keepbits;
+    unsigned int mask;
+    union {
+      float r;
+      unsigned int u;
+    } v;
+
+    keepbits = (int)ceil(nsd*log(10.0)/log(2.0))+1;
+    if(keepbits>=23)
+      return;
+    mask = ~0U << (23-keepbits);
+
+    for(i=0;i<n;i++) {
+      if(data[i]==(float)EMPTY || data[i]==0 || data[i]!=data[i] || fabs(data[i])>1e38)
+	continue;
+      v.r = data[i];
+      if(i%2==0)
+	v.u &= mask;
+      else
+	v.u |= ~mask;
+      data[i] = v.r;
+    }
+} //end function
+
 /*
  * Function: nc_write_doublevar()
  * --------------------------
@@ -253,7 +607,7 @@ void nc_write_doublevar(int ncid, char *vname, gridT *grid, REAL *tmparray, int
     
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_put_var_double(ncid, varid, tmpvar)))
+    if ((retval = nc_put_var_real(ncid, varid, tmpvar)))
       ERR(retval);
 
 } //end function
@@ -265,7 +619,7 @@ void nc_write_doublevar(int ncid, char *vname, gridT *grid, REAL *tmparray, int
 * -----------------------------
 *  Retuns the index of the first preceding time step in the vector time
 */
-int getTimeRec(REAL nctime, REAL *time, int nt){
+int getTimeRec(DREAL nctime, DREAL *time, int nt){
    int j;
    
    for(j=0;j<nt;j++){
@@ -293,7 +647,7 @@ static void nc_write_2D_merge(int ncid, int tstep, REAL *array, propT *prop, gri
     	counttwo[1] = mergedGrid->Nc;
 	if ((retval = nc_inq_varid(ncid, varname, &varid)))
 	    ERR(retval);
-	if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, merged2DArray )))
+	if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, merged2DArray )))
 	    ERR(retval);
     }
 }
@@ -326,7 +680,7 @@ static void nc_write_3D_merge(int ncid, int tstep, REAL **array, propT *prop, gr
 	      }
 	    }
         }
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, &merged3DVector[0])))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, &merged3DVector[0])))
 	    ERR(retval);
     }
 }
@@ -360,7 +714,7 @@ static void nc_write_3Dedge_merge(int ncid, int tstep, REAL **array, propT *prop
 	      }
 	    }
         }
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, &merged3DVector[0])))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, &merged3DVector[0])))
 	    ERR(retval);
     }
 }
@@ -387,7 +741,7 @@ void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int bl
    size_t startthree[] = {prop->nctimectr,0,0};
    size_t countthree[] = {1,grid->Nkmax,grid->Nc};
    const size_t countthreew[] = {1,grid->Nkmax+1,grid->Nc};
-   const REAL time[] = {prop->nctime};
+   const DREAL time[] = {prop->nctime};
    char str[BUFFERLENGTH], filename[BUFFERLENGTH];
 
 
@@ -398,7 +752,7 @@ void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int bl
    //tmpvar = (REAL *)SunMalloc(grid->Nc*grid->Nkmax*sizeof(REAL),"WriteOutputNC");
    //tmpvarE = (REAL *)SunMalloc(grid->Ne*grid->Nkmax*sizeof(REAL),"WriteOutputNC");
    
-   if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart || blowup) {
+   if(IntervalDue(prop,prop->ntout) || prop->n==1+prop->nstart || blowup) {
     
     if(!(prop->nctimectr%prop->nstepsperncfile) || prop->n==1+prop->nstart){
 	if(prop->n > 1+prop->nstart){
@@ -442,7 +796,7 @@ void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int bl
 	/* Write the time data*/
 	if ((retval = nc_inq_varid(ncid, "time", &varid)))
 	    ERR(retval);
-	if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time )))
+	if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time)))
 	    ERR(retval);
 
 	 countthree[2] = mergedGrid->Nc;
@@ -513,29 +867,21 @@ void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int bl
 * Function: WriteOutputNC()
 * -----------------------------
 * Main function for writing SUNTANS output to netcdf file/s
+*
+* A record is written when any field is due (see OutputDue in outputplan.c)
+* and the fields that are not due keep their fill values in that record.
 * 
 */
 void WriteOutputNC(propT *prop, gridT *grid, physT *phys, metT *met, int blowup, int myproc){
    int ncid = prop->outputNetcdfFileID;
-   int varid, retval, k;
-   // Start and count vectors for one, two and three dimensional arrays
+   int varid, retval;
    const size_t startone[] = {prop->nctimectr};
    const size_t countone[] = {1};
-   const size_t starttwo[] = {prop->nctimectr,0};
-   const size_t counttwo[] = {1,grid->Nc};
-   size_t startthree[] = {prop->nctimectr,0,0};
-   size_t countthree[] = {1,grid->Nkmax,grid->Nc};
-   const size_t countthreew[] = {1,grid->Nkmax+1,grid->Nc};
-   const REAL time[] = {prop->nctime};
+   const DREAL time[] = {prop->nctime};
 
    nc_set_log_level(3); // This helps with debugging errors
    
-   //REAL *tmpvar, *tmpvarE;
-   // Need to write the 3-D arrays as vectors
-   //tmpvar = (REAL *)SunMalloc(grid->Nc*grid->Nkmax*sizeof(REAL),"WriteOutputNC");
-   //tmpvarE = (REAL *)SunMalloc(grid->Ne*grid->Nkmax*sizeof(REAL),"WriteOutputNC");
-   
-   if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart || blowup) {
+   if(OutputRecordDue(prop,blowup)) {
 
     if(myproc==0 && VERBOSE>1){ 
       if(!blowup) 
@@ -547,186 +893,468 @@ void WriteOutputNC(propT *prop, gridT *grid, physT *phys, metT *met, int blowup,
     /* Write the time data*/
     if ((retval = nc_inq_varid(ncid, "time", &varid)))
 	ERR(retval);
-    if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time )))
+    if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time)))
 	ERR(retval);
     
     /* Write to the physical variables*/
-    if ((retval = nc_inq_varid(ncid, "eta", &varid)))
-	ERR(retval);
-    if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, phys->h )))
- 	ERR(retval);
-    
-    if ((retval = nc_inq_varid(ncid, "uc", &varid)))
-	ERR(retval);
-    ravel(phys->uc, phys->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	ERR(retval);
-    
-    if ((retval = nc_inq_varid(ncid, "vc", &varid)))
-	ERR(retval);
-    ravel(phys->vc, phys->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	ERR(retval);
-      
+    nc_write_2D_output(ncid, prop, grid, phys->h, "eta", blowup);
+    nc_write_3D_output(ncid, prop, grid, phys, phys->uc, "uc", 0, blowup);
+    nc_write_3D_output(ncid, prop, grid, phys, phys->vc, "vc", 0, blowup);
     // write w at cell top and bottom
-    if ((retval = nc_inq_varid(ncid, "w", &varid)))
-	ERR(retval);
-    ravelW(phys->w, phys->tmpvarW, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthreew, phys->tmpvarW )))
-	ERR(retval);
-
-    if ((retval = nc_inq_varid(ncid, "nu_v", &varid)))
-	ERR(retval);
-    ravel(phys->nu_tv, phys->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	ERR(retval);
+    nc_write_3D_output(ncid, prop, grid, phys, phys->w, "w", 1, blowup);
+    nc_write_3D_output(ncid, prop, grid, phys, phys->nu_tv, "nu_v", 0, blowup);
     
     // Tracers
-     if(prop->beta>0){
-       if ((retval = nc_inq_varid(ncid, "salt", &varid)))
-	  ERR(retval);
-      ravel(phys->s, phys->tmpvar, grid);
-      if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	  ERR(retval);
-     }
+    if(prop->beta>0)
+      nc_write_3D_output(ncid, prop, grid, phys, phys->s, "salt", 0, blowup);
+    if(prop->gamma>0)
+      nc_write_3D_output(ncid, prop, grid, phys, phys->T, "temp", 0, blowup);
+    if( (prop->gamma>0) || (prop->beta>0) )
+      nc_write_3D_output(ncid, prop, grid, phys, phys->rho, "rho", 0, blowup);
+    if(prop->calcage>0){ 
+      nc_write_3D_output(ncid, prop, grid, phys, age->agec, "agec", 0, blowup);
+      nc_write_3D_output(ncid, prop, grid, phys, age->agealpha, "agealpha", 0, blowup);
+    }
+
+    // Vertical grid spacing
+    nc_write_3D_output(ncid, prop, grid, phys, grid->dzz, "dzz", 0, blowup);
+    nc_write_3Dedge_output(ncid, prop, grid, phys, grid->dzf, "dzf", blowup);
+
+    // Edge normal velocity
+    nc_write_3Dedge_output(ncid, prop, grid, phys, phys->u, "U", blowup);
+
+    // Wind variables
+    if(prop->metmodel>0){
+      nc_write_2D_output(ncid, prop, grid, met->Uwind, "Uwind", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Vwind, "Vwind", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Tair, "Tair", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Pair, "Pair", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->rain, "rain", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->RH, "RH", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->cloud, "cloud", blowup);
+
+      // Heat flux variables
+      nc_write_2D_output(ncid, prop, grid, met->Hs, "Hs", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Hl, "Hl", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Hlw, "Hlw", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->Hsw, "Hsw", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->tau_x, "tau_x", blowup);
+      nc_write_2D_output(ncid, prop, grid, met->tau_y, "tau_y", blowup);
+      if(prop->beta > 0.0)
+	nc_write_2D_output(ncid, prop, grid, met->EP, "EP", blowup);
+    }
      
-     if(prop->gamma>0){
-	if ((retval = nc_inq_varid(ncid, "temp", &varid)))
-	  ERR(retval);
-	ravel(phys->T, phys->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	  ERR(retval);
-     }
-      
-     if( (prop->gamma>0) || (prop->beta>0) ){ 
-	if ((retval = nc_inq_varid(ncid, "rho", &varid)))
-	  ERR(retval);
-	ravel(phys->rho, phys->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	  ERR(retval);
-     }
+    /* Update the time counter*/
+    prop->nctimectr += 1;  
+   }
+} // End of function
 
-     if(prop->calcage>0){ 
-	if ((retval = nc_inq_varid(ncid, "agec", &varid)))
-	  ERR(retval);
-	ravel(age->agec, phys->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	  ERR(retval);
+/*
+* Function: nc_write_2D_output()
+* ------------------------------
+* Writes the 2D cell-centered field vname to the current record of the
+* per-processor output file if it is due.
+* 
+*/
+static void nc_write_2D_output(int ncid, propT *prop, gridT *grid, REAL *array, char *vname, int blowup){
+   int varid, retval;
+   const size_t starttwo[] = {prop->nctimectr,0};
+   const size_t counttwo[] = {1,grid->Nc};
 
-	if ((retval = nc_inq_varid(ncid, "agealpha", &varid)))
-	  ERR(retval);
-	ravel(age->agealpha, phys->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
-	  ERR(retval);
-     }
+   if(!OutputDue(prop,vname,blowup))
+     return;
+   if ((retval = nc_inq_varid(ncid, vname, &varid)))
+     ERR(retval);
+   if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, array )))
+     ERR(retval);
+} // End of function
 
-     // Vertical grid spacing
-     if ((retval = nc_inq_varid(ncid, "dzz", &varid)))
+/*
+* Function: nc_write_3D_output()
+* ------------------------------
+* Writes the 3D cell-centered field vname (isw=0), or the field vname at the
+* top and bottom of the cells (isw=1), to the current record if it is due.
+* 
+*/
+static void nc_write_3D_output(int ncid, propT *prop, gridT *grid, physT *phys, REAL **array, char *vname, int isw, int blowup){
+   int varid, retval;
+   const size_t startthree[] = {prop->nctimectr,0,0};
+   const size_t countthree[] = {1,grid->Nkmax+isw,grid->Nc};
+
+   if(!OutputDue(prop,vname,blowup))
+     return;
+   if ((retval = nc_inq_varid(ncid, vname, &varid)))
+     ERR(retval);
+   if(isw) {
+     ravelW(array, phys->tmpvarW, grid);
+     if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, phys->tmpvarW )))
        ERR(retval);
-     ravel(grid->dzz, phys->tmpvar, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvar )))
+   } else {
+     ravel(array, phys->tmpvar, grid);
+     if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, phys->tmpvar )))
        ERR(retval);
+   }
+} // End of function
 
-     countthree[2] = grid->Ne;
-     if ((retval = nc_inq_varid(ncid, "dzf", &varid)))
+/*
+* Function: nc_write_3Dedge_output()
+* ----------------------------------
+* Writes the 3D edge field vname to the current record if it is due.
+* 
+*/
+static void nc_write_3Dedge_output(int ncid, propT *prop, gridT *grid, physT *phys, REAL **array, char *vname, int blowup){
+   int varid, retval;
+   const size_t startthree[] = {prop->nctimectr,0,0};
+   const size_t countthree[] = {1,grid->Nkmax,grid->Ne};
+
+   if(!OutputDue(prop,vname,blowup))
+     return;
+   if ((retval = nc_inq_varid(ncid, vname, &varid)))
+     ERR(retval);
+   ravelEdge(array, phys->tmpvarE, grid);
+   if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, phys->tmpvarE )))
+     ERR(retval);
+} // End of function
+
+/*
+* Function: InitialiseOutputSetNC()
+* ---------------------------------
+* Creates the netcdf file of a station or sub-domain output set (see
+* outputplan.c) on processor 0 and writes the locations of its points.
+* The fields are stored as set by ncdeflate etc. in suntans.dat, with
+* chunks that hold many records since records are small and frequent.
+* 
+*/
+void InitialiseOutputSetNC(propT *prop, gridT *grid, outsetT *set, int myproc){
+   int ncid, retval, varid, v, k, ndims;
+   int dimid_N, dimid_Nk, dimid_time, dimids[3];
+   size_t chunks[3], recordbytes, ntchunk;
+   REAL *z_w, *z_r, fillvalue = (REAL)EMPTY;
+
+   if ((retval = nc_create(set->file, NC_NETCDF4|NC_CLOBBER, &ncid)))
+     ERR(retval);
+   set->ncid = ncid;
+   set->nctimectr = 0;
+
+   nc_addattr(ncid, NC_GLOBAL,"title","SUNTANS NetCDF output file");
+   if(!strcmp(set->name,"station"))
+     nc_addattr(ncid, NC_GLOBAL,"featureType","timeSeriesProfile");
+   nc_addattr_int(ncid, NC_GLOBAL,"output_interval",&(set->ntout));
+   nc_addattr_int(ncid, NC_GLOBAL,"kmin",&(set->kmin));
+   nc_addattr_int(ncid, NC_GLOBAL,"kmax",&(set->kmax));
+
+   if ((retval = nc_def_dim(ncid, set->dimname, set->N, &dimid_N)))
+     ERR(retval);
+   if ((retval = nc_def_dim(ncid, "Nk", set->Nk, &dimid_Nk)))
+     ERR(retval);
+   if ((retval = nc_def_dim(ncid, "time", NC_UNLIMITED, &dimid_time)))
+     ERR(retval);
+
+   // Locations of the points
+   if ((retval = nc_def_var(ncid,"x",NC_DOUBLE,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Easting of the output point");
+   nc_addattr(ncid, varid,"units","m");
+   if ((retval = nc_def_var(ncid,"y",NC_DOUBLE,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Northing of the output point");
+   nc_addattr(ncid, varid,"units","m");
+   if ((retval = nc_def_var(ncid,"xv",NC_DOUBLE,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Easting of the cell Voronoi point");
+   nc_addattr(ncid, varid,"units","m");
+   nc_addattr_real(ncid, varid,"_FillValue",&fillvalue);
+   if ((retval = nc_def_var(ncid,"yv",NC_DOUBLE,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Northing of the cell Voronoi point");
+   nc_addattr(ncid, varid,"units","m");
+   nc_addattr_real(ncid, varid,"_FillValue",&fillvalue);
+   if ((retval = nc_def_var(ncid,"dv",NC_DOUBLE,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Depth of the cell");
+   nc_addattr(ncid, varid,"units","m");
+   nc_addattr_real(ncid, varid,"_FillValue",&fillvalue);
+   if ((retval = nc_def_var(ncid,"cell",NC_INT,1,&dimid_N,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Index of the cell in the full grid or -1 if not in the domain");
+   if(set->transect) {
+     if ((retval = nc_def_var(ncid,"transect",NC_INT,1,&dimid_N,&varid)))
        ERR(retval);
-     ravelEdge(grid->dzf, phys->tmpvarE, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvarE )))
-        ERR(retval);
+     nc_addattr(ncid, varid,"long_name","Index of the transect of the point or -1 for a station");
+   }
 
-     // Edge normal velocity
-     if ((retval = nc_inq_varid(ncid, "U", &varid)))
-	ERR(retval);
-     ravelEdge(phys->u, phys->tmpvarE, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, phys->tmpvarE )))
-        ERR(retval);
+   // Depths of the layers kmin..kmax-1
+   if ((retval = nc_def_var(ncid,"z_r",NC_DOUBLE,1,&dimid_Nk,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"standard_name","ocean_z_coordinate");
+   nc_addattr(ncid, varid,"long_name","depth at layer mid points");
+   nc_addattr(ncid, varid,"units","m");  
+   nc_addattr(ncid, varid,"positive","down");  
+
+   if ((retval = nc_def_var(ncid,"time",NC_DOUBLE,1,&dimid_time,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","time");
+   nc_addattr(ncid, varid,"units","seconds since 1990-01-01 00:00:00");  
+
+   // Fields, with about NCSETCHUNKBYTES per chunk along time
+   dimids[0] = dimid_time;
+   for(v=0;v<set->Nvars;v++) {
+     ndims = (set->is3d[v] ? 3 : 2);
+     dimids[1] = (set->is3d[v] ? dimid_Nk : dimid_N);
+     dimids[2] = dimid_N;
+     varid = nc_def_outputvar(prop,ncid,set->vars[v],ndims,dimids,myproc);
+     nc_addattr(ncid, varid,"coordinates",set->is3d[v] ? "time z_r y x" : "time y x");
+
+     recordbytes = sizeof(REAL)*set->N*(set->is3d[v] ? set->Nk : 1);
+     ntchunk = NCSETCHUNKBYTES/recordbytes;
+     if(ntchunk<1)
+       ntchunk=1;
+     chunks[0]=ntchunk;
+     chunks[1]=(set->is3d[v] ? set->Nk : set->N);
+     chunks[2]=set->N;
+     if ((retval = nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks)))
+       ERR(retval);
+     if ((retval = nc_set_var_chunk_cache(ncid,varid,2*ntchunk*recordbytes,11,1.0)))
+       ERR(retval);
+   }
 
-     // Wind variables
-     if(prop->metmodel>0){
-       if ((retval = nc_inq_varid(ncid, "Uwind", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Uwind )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Vwind", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Vwind )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Tair", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Tair )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Pair", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Pair )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "rain", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->rain )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "RH", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->RH )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "cloud", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->cloud )))
-	 ERR(retval);
-       
-       // Heat flux variables
-       if ((retval = nc_inq_varid(ncid, "Hs", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Hs )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Hl", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Hl )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Hlw", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Hlw )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "Hsw", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->Hsw )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "tau_x", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->tau_x )))
-	 ERR(retval);
-       
-       if ((retval = nc_inq_varid(ncid, "tau_y", &varid)))
-	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->tau_y )))
-	 ERR(retval);
-       
-       if(prop->beta > 0.0){
-	  if ((retval = nc_inq_varid(ncid, "EP", &varid)))
-	     ERR(retval);
-	  if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, met->EP )))
-	     ERR(retval);
-       }
+   if ((retval = nc_enddef(ncid)))
+     ERR(retval);
+
+   nc_write_double(ncid,"x",set->x,myproc);
+   nc_write_double(ncid,"y",set->y,myproc);
+   nc_write_double(ncid,"xv",set->xv,myproc);
+   nc_write_double(ncid,"yv",set->yv,myproc);
+   nc_write_real(ncid,"dv",set->dv,myproc);
+   nc_write_int(ncid,"cell",set->cellid,myproc);
+   if(set->transect)
+     nc_write_int(ncid,"transect",set->transect,myproc);
+
+   z_w = (REAL *)SunMalloc((grid->Nkmax+1)*sizeof(REAL),"InitialiseOutputSetNC");
+   z_r = (REAL *)SunMalloc(set->Nk*sizeof(REAL),"InitialiseOutputSetNC");
+   z_w[0]=0.0;
+   for(k=0;k<grid->Nkmax;k++)
+     z_w[k+1] = z_w[k] + grid->dz[k];
+   for(k=set->kmin;k<set->kmax;k++)
+     z_r[k-set->kmin] = 0.5*(z_w[k]+z_w[k+1]);
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   SunFree(z_w,(grid->Nkmax+1)*sizeof(REAL),"InitialiseOutputSetNC");
+   SunFree(z_r,set->Nk*sizeof(REAL),"InitialiseOutputSetNC");
+} // End of function
+
+/*
+* Function: WriteOutputSetNC()
+* ----------------------------
+* Writes the values gathered in set->data to the next record of the netcdf
+* file of a station or sub-domain output set.
+* 
+*/
+void WriteOutputSetNC(propT *prop, outsetT *set, int myproc){
+   int retval, varid, v;
+   size_t start[] = {set->nctimectr,0,0};
+   size_t count[] = {1,set->Nk,set->N};
+   const DREAL time[] = {prop->nctime};
+   REAL *data = set->data;
+
+   if ((retval = nc_inq_varid(set->ncid, "time", &varid)))
+     ERR(retval);
+   if ((retval = nc_put_vara_double(set->ncid, varid, start, count, time)))
+     ERR(retval);
+
+   for(v=0;v<set->Nvars;v++) {
+     if ((retval = nc_inq_varid(set->ncid, set->vars[v], &varid)))
+       ERR(retval);
+     count[1] = (set->is3d[v] ? set->Nk : set->N);
+     if ((retval = nc_put_vara_output(set->ncid, varid, start, count, data)))
+       ERR(retval);
+     data += (set->is3d[v] ? set->Nk : 1)*set->N;
+   }
+   set->nctimectr++;
+} // End of function
+
+
+/*
+* Function: InitialiseAnalysisNC()
+* --------------------------------
+* Creates the netcdf file of the in-situ analysis (see analysis.c), on
+* processor 0 for the merged grid with mergeArrays=1 and on each processor
+* otherwise, and writes the cell locations and the constituent frequencies.
+* With mergeArrays=1 all processors must call this function.
+* 
+*/
+void InitialiseAnalysisNC(propT *prop, gridT *grid, analysisT *an, int numprocs, MPI_Comm comm, int myproc){
+   int ncid, retval, varid, o, j, k, Nc, *Nk;
+   int dimid_Nc, dimid_Nk, dimid_Ncon, dimid_time, dimids[3];
+   REAL *z_r, z_w;
+   DREAL *coords[] = {grid->xv, grid->yv}, *mergedcoord;
+   char str[BUFFERLENGTH], *coordnames[] = {"xv", "yv"};
+
+   if(prop->mergeArrays && myproc!=0) {
+     for(j=0;j<2;j++)
+       MergeCellCentered2DDouble(coords[j],NULL,grid,numprocs,myproc,comm);
+     MergeCellCentered2DArray(grid->dv,grid,numprocs,myproc,comm);
+     return;
+   }
+
+   Nc = (prop->mergeArrays ? mergedGrid->Nc : grid->Nc);
+   Nk = (prop->mergeArrays ? mergedGrid->Nk : grid->Nk);
+
+   if ((retval = nc_create(an->file, NC_NETCDF4|NC_CLOBBER, &ncid)))
+     ERR(retval);
+   an->ncid = ncid;
+
+   nc_addattr(ncid, NC_GLOBAL,"title","SUNTANS in-situ analysis");
+   nc_addattr_int(ncid, NC_GLOBAL,"sample_interval",&(an->ntsample));
+   nc_addattr_real(ncid, NC_GLOBAL,"analysis_start_time",&(an->tstart));
+
+   if ((retval = nc_def_dim(ncid, "Nc", Nc, &dimid_Nc)))
+     ERR(retval);
+   if ((retval = nc_def_dim(ncid, "Nk", grid->Nkmax, &dimid_Nk)))
+     ERR(retval);
+   if ((retval = nc_def_dim(ncid, "time", NC_UNLIMITED, &dimid_time)))
+     ERR(retval);
+
+   if ((retval = nc_def_var(ncid,"xv",NC_DOUBLE,1,&dimid_Nc,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Easting of the cell Voronoi point");
+   nc_addattr(ncid, varid,"units","m");
+   if ((retval = nc_def_var(ncid,"yv",NC_DOUBLE,1,&dimid_Nc,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Northing of the cell Voronoi point");
+   nc_addattr(ncid, varid,"units","m");
+   if ((retval = nc_def_var(ncid,"dv",NC_DOUBLE,1,&dimid_Nc,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Depth of the cell");
+   nc_addattr(ncid, varid,"units","m");
+   if ((retval = nc_def_var(ncid,"Nkc",NC_INT,1,&dimid_Nc,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","Number of layers of the cell");
+   if ((retval = nc_def_var(ncid,"z_r",NC_DOUBLE,1,&dimid_Nk,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","depth at layer mid points");
+   nc_addattr(ncid, varid,"units","m");  
+   nc_addattr(ncid, varid,"positive","down");  
+
+   if(an->Ncon>0) {
+     if ((retval = nc_def_dim(ncid, "Ncon", an->Ncon, &dimid_Ncon)))
+       ERR(retval);
+     if ((retval = nc_def_var(ncid,"omega",NC_DOUBLE,1,&dimid_Ncon,&varid)))
+       ERR(retval);
+     nc_addattr(ncid, varid,"long_name","Frequency of the tidal constituent");
+     nc_addattr(ncid, varid,"units","rad s-1");
+     str[0]='\0';
+     for(j=0;j<an->Ncon;j++) {
+       if(j>0)
+	 strcat(str," ");
+       strcat(str,an->con[j]);
      }
-     
-    /* Update the time counter*/
-    prop->nctimectr += 1;  
+     nc_addattr(ncid, varid,"constituents",str);
    }
-   
-   // Free the temporary vector
-   //SunFree(tmpvar,grid->Nc*grid->Nkmax*sizeof(REAL),"WriteOuputNC");
-   //SunFree(tmpvarE,grid->Ne*grid->Nkmax*sizeof(REAL),"WriteOuputNC");
-  
+
+   if ((retval = nc_def_var(ncid,"time",NC_DOUBLE,1,&dimid_time,&varid)))
+     ERR(retval);
+   nc_addattr(ncid, varid,"long_name","time of the checkpoint");
+   nc_addattr(ncid, varid,"units","seconds since 1990-01-01 00:00:00");  
+
+   dimids[0] = dimid_time;
+   for(o=0;o<an->Nout;o++) {
+     dimids[1] = (an->out[o].is3d ? dimid_Nk : dimid_Nc);
+     dimids[2] = dimid_Nc;
+     varid = nc_def_outputvar(prop,ncid,an->out[o].name,an->out[o].is3d ? 3 : 2,dimids,myproc);
+     nc_addattr(ncid, varid,"long_name",an->out[o].longname);
+     nc_addattr(ncid, varid,"coordinates",an->out[o].is3d ? "time z_r yv xv" : "time yv xv");
+     if(an->out[o].kind==ANEXCEED)
+       nc_addattr_real(ncid, varid,"threshold",&(an->var[an->out[o].var].threshold));
+   }
+
+   if ((retval = nc_enddef(ncid)))
+     ERR(retval);
+
+   if(prop->mergeArrays) {
+     mergedcoord = (DREAL *)SunMalloc(Nc*sizeof(DREAL),"InitialiseAnalysisNC");
+     for(j=0;j<2;j++) {
+       MergeCellCentered2DDouble(coords[j],mergedcoord,grid,numprocs,myproc,comm);
+       nc_write_double(ncid,coordnames[j],mergedcoord,myproc);
+     }
+     SunFree(mergedcoord,Nc*sizeof(DREAL),"InitialiseAnalysisNC");
+     MergeCellCentered2DArray(grid->dv,grid,numprocs,myproc,comm);
+     nc_write_real(ncid,"dv",merged2DArray,myproc);
+   } else {
+     for(j=0;j<2;j++)
+       nc_write_double(ncid,coordnames[j],coords[j],myproc);
+     nc_write_real(ncid,"dv",grid->dv,myproc);
+   }
+   nc_write_int(ncid,"Nkc",Nk,myproc);
+   if(an->Ncon>0)
+     nc_write_real(ncid,"omega",an->omega,myproc);
+
+   z_r = (REAL *)SunMalloc(grid->Nkmax*sizeof(REAL),"InitialiseAnalysisNC");
+   z_w = 0;
+   for(k=0;k<grid->Nkmax;k++) {
+     z_r[k] = z_w+0.5*grid->dz[k];
+     z_w += grid->dz[k];
+   }
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   SunFree(z_r,grid->Nkmax*sizeof(REAL),"InitialiseAnalysisNC");
 } // End of function
 
+/*
+* Function: WriteAnalysisFieldNC()
+* --------------------------------
+* Writes output field o of the analysis, computed in an->work (3-D) or
+* an->work2d (2-D), to the current record of the analysis file.  With
+* mergeArrays=1 all processors must call this function.
+* 
+*/
+void WriteAnalysisFieldNC(propT *prop, gridT *grid, analysisT *an, int o, int numprocs, MPI_Comm comm, int myproc){
+   int retval, varid;
+   size_t start[] = {an->nctimectr,0,0};
+   size_t count[] = {1,grid->Nkmax,grid->Nc};
+   REAL *tmpvec;
+
+   if(prop->mergeArrays) {
+     if(an->out[o].is3d)
+       nc_write_3D_merge(an->ncid,an->nctimectr,an->work,prop,grid,an->out[o].name,0,numprocs,myproc,comm);
+     else
+       nc_write_2D_merge(an->ncid,an->nctimectr,an->work2d,prop,grid,an->out[o].name,numprocs,myproc,comm);
+     return;
+   }
+
+   if ((retval = nc_inq_varid(an->ncid, an->out[o].name, &varid)))
+     ERR(retval);
+   if(an->out[o].is3d) {
+     tmpvec = (REAL *)SunMalloc(grid->Nkmax*grid->Nc*sizeof(REAL),"WriteAnalysisFieldNC");
+     ravel(an->work,tmpvec,grid);
+     if ((retval = nc_put_vara_output(an->ncid, varid, start, count, tmpvec)))
+       ERR(retval);
+     SunFree(tmpvec,grid->Nkmax*grid->Nc*sizeof(REAL),"WriteAnalysisFieldNC");
+   } else {
+     count[1] = grid->Nc;
+     if ((retval = nc_put_vara_output(an->ncid, varid, start, count, an->work2d)))
+       ERR(retval);
+   }
+} // End of function
+
+/*
+* Function: WriteAnalysisTimeNC()
+* -------------------------------
+* Writes the time of the current record of the analysis file once its
+* fields are written and flushes the file.
+* 
+*/
+void WriteAnalysisTimeNC(propT *prop, analysisT *an, int myproc){
+   int retval, varid;
+   size_t start[] = {an->nctimectr};
+   size_t count[] = {1};
+   const DREAL time[] = {prop->nctime};
+
+   if ((retval = nc_inq_varid(an->ncid, "time", &varid)))
+     ERR(retval);
+   if ((retval = nc_put_vara_double(an->ncid, varid, start, count, time)))
+     ERR(retval);
+   if ((retval = nc_sync(an->ncid)))
+     ERR(retval);
+} // End of function
 
 /*
 * Function: InitialiseOutputNCugridMerge()
@@ -749,15 +1377,11 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    int dimidone[1];
    int dimidtwo[2];
    int dimidthree[3];
-   int nofill=0;
    const size_t starttwo[] = {0,0};
    const size_t counttwo[] = {mergedGrid->Nkmax,mergedGrid->Nc};
    REAL *z_r;
    REAL *z_w;
    int *edges;
-   const int DEFLATE=1;
-   const int DEFLATELEVEL=2;
-   const REAL FILLVALUE = (REAL)EMPTY;
    int num_unlimdims;
 
 
@@ -1122,8 +1746,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    dimidthree[2] = dimid_Nc;
    
    // eta
-   if ((retval = nc_def_var(ncid,"eta",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"eta",2,dimidtwo,myproc);
    nc_addattr(ncid, varid,"long_name","Sea surface elevation");
    nc_addattr(ncid, varid,"units","m");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1131,12 +1754,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    nc_addattr(ncid, varid,"coordinates","time yv xv");
     
    //u
-   if ((retval = nc_def_var(ncid,"uc",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"uc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Eastward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1144,12 +1762,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
    //v
-   if ((retval = nc_def_var(ncid,"vc",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval);   
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"vc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Northward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1158,12 +1771,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    //w
    dimidthree[1] = dimid_Nkw;
-   if ((retval = nc_def_var(ncid,"w",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"w",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Vertical water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1173,12 +1781,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    dimidthree[1] = dimid_Nk;
    
    //nu_v
-   if ((retval = nc_def_var(ncid,"nu_v",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"nu_v",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Vertical eddy viscosity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1187,12 +1790,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    //salinity
    if(prop->beta>0){
-     if ((retval = nc_def_var(ncid,"salt",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"salt",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Salinity");
     nc_addattr(ncid, varid,"units","ppt");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1202,12 +1800,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    //temperature
    if(prop->gamma>0){
-     if ((retval = nc_def_var(ncid,"temp",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval); 
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"temp",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Water temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1217,12 +1810,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    //rho
    if( (prop->gamma>0) || (prop->beta>0) ){
-     if ((retval = nc_def_var(ncid,"rho",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"rho",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Water density");
     nc_addattr(ncid, varid,"units","kg m-3");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1232,24 +1820,14 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    //age
    if(prop->calcage>0){
-     if ((retval = nc_def_var(ncid,"agec",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"agec",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age concentration");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
     nc_addattr(ncid, varid,"location","face");
-    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
-    
-    if ((retval = nc_def_var(ncid,"agealpha",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
+    
+    varid = nc_def_outputvar(prop,ncid,"agealpha",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age alpha parameter");
     nc_addattr(ncid, varid,"units","seconds");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1280,12 +1858,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
 
    //U
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"U",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"U",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Edge normal velocity");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1296,8 +1869,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    
    if(prop->metmodel>0){
     // Uwind
-    if ((retval = nc_def_var(ncid,"Uwind",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Uwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1305,8 +1877,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Vwind
-    if ((retval = nc_def_var(ncid,"Vwind",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Vwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1314,8 +1885,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Tair
-    if ((retval = nc_def_var(ncid,"Tair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"Tair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Air temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1323,8 +1893,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Pair
-    if ((retval = nc_def_var(ncid,"Pair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Pair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Air pressure");
     nc_addattr(ncid, varid,"units","millibar");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1332,8 +1901,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // rain
-    if ((retval = nc_def_var(ncid,"rain",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"rain",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Rain fall rate");
     nc_addattr(ncid, varid,"units","kg m2 s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1341,8 +1909,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //RH
-    if ((retval = nc_def_var(ncid,"RH",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"RH",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Relative humidity");
     nc_addattr(ncid, varid,"units","Percent (%)");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1350,8 +1917,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //cloud
-    if ((retval = nc_def_var(ncid,"cloud",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"cloud",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Cloud cover fraction");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1360,8 +1926,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     
     // Surface flux variables //
     // Hs
-    if ((retval = nc_def_var(ncid,"Hs",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hs",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Sensible heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1370,8 +1935,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hl
-    if ((retval = nc_def_var(ncid,"Hl",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hl",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Latent heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1380,8 +1944,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hlw
-    if ((retval = nc_def_var(ncid,"Hlw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hlw",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Net longwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1390,8 +1953,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hsw
-    if ((retval = nc_def_var(ncid,"Hsw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hsw",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Net shortwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1400,8 +1962,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"positive","down");   
 
     // tau_x
-    if ((retval = nc_def_var(ncid,"tau_x",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_x",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1409,8 +1970,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
     nc_addattr(ncid, varid,"coordinates","time yv xv");   
 
     // tau_y
-    if ((retval = nc_def_var(ncid,"tau_y",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_y",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Northward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1419,8 +1979,7 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
 
     //EP
     if(prop->beta > 0.0){
-	if ((retval = nc_def_var(ncid,"EP",NC_DOUBLE,2,dimidtwo,&varid)))
-	    ERR(retval); 
+	varid = nc_def_outputvar(prop,ncid,"EP",2,dimidtwo,myproc);
 	nc_addattr(ncid, varid,"long_name","Evaporation minus precipiaton");
 	nc_addattr(ncid, varid,"units","m s-1");
 	nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1460,19 +2019,19 @@ static void InitialiseOutputNCugridMerge(propT *prop, physT *phys, gridT *grid,
    nc_write_double(ncid,"yp",grid->yp,myproc);
 
    nc_write_intvar(ncid,"normal",mergedGrid,mergedGrid->normal,myproc);
-   nc_write_double(ncid,"n1",mergedGrid->n1,myproc);
-   nc_write_double(ncid,"n2",mergedGrid->n2,myproc);
+   nc_write_real(ncid,"n1",mergedGrid->n1,myproc);
+   nc_write_real(ncid,"n2",mergedGrid->n2,myproc);
    nc_write_double(ncid,"df",mergedGrid->df,myproc);
    nc_write_double(ncid,"dg",mergedGrid->dg,myproc);
    //nc_write_doublevar(ncid,"def",grid,grid->def,myproc);
    nc_write_double(ncid,"Ac",mergedGrid->Ac,myproc);
 
-   nc_write_double(ncid,"dz",grid->dz,myproc);
-   nc_write_double(ncid,"z_r",z_r,myproc);
-   nc_write_double(ncid,"z_w",z_w,myproc);
+   nc_write_real(ncid,"dz",grid->dz,myproc);
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   nc_write_real(ncid,"z_w",z_w,myproc);
    nc_write_int(ncid,"Nk",mergedGrid->Nk,myproc);
    nc_write_int(ncid,"Nke",mergedGrid->Nke,myproc);
-   nc_write_double(ncid,"dv",mergedGrid->dv,myproc);
+   nc_write_real(ncid,"dv",mergedGrid->dv,myproc);
 
 
       // Free the temporary vectors
@@ -1503,15 +2062,11 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    int dimidone[1];
    int dimidtwo[2];
    int dimidthree[3];
-   int nofill=0;
    const size_t starttwo[] = {0,0};
    const size_t counttwo[] = {grid->Nkmax,grid->Nc};
    REAL *z_r;
    REAL *z_w;
    int *edges;
-   const int DEFLATE=1;
-   const int DEFLATELEVEL=2;
-   const REAL FILLVALUE = (REAL)EMPTY;
 
 
    //REAL *tmpvar;
@@ -1674,6 +2229,18 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     //if ((retval = nc_put_var_int(ncid,varid, grid->eptr)))
     //  ERR(retval);
 
+    //cellcomp
+    dimidone[0] = dimid_Nc;
+    if ((retval = nc_def_var(ncid,"cellcomp",NC_INT,1,dimidone,&varid)))
+      ERR(retval);
+    nc_addattr(ncid, varid,"long_name","Flag for faces that are computed on this processor (used by sunjoin)");
+
+    //edgecomp
+    dimidone[0] = dimid_Ne;
+    if ((retval = nc_def_var(ncid,"edgecomp",NC_INT,1,dimidone,&varid)))
+      ERR(retval);
+    nc_addattr(ncid, varid,"long_name","Flag for edges that are computed on this processor (used by sunjoin)");
+
    /********************************************************************** 
     *
     * Define the grid coordinate variables and attributes 
@@ -1889,12 +2456,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     dimidthree[0] = dimid_time;
     dimidthree[1] = dimid_Nk;
     dimidthree[2] = dimid_Nc;
-    if ((retval = nc_def_var(ncid,"dzz",NC_DOUBLE,3,dimidthree,&varid)))
-       ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-       ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"dzz",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","z layer spacing at faces");
     nc_addattr(ncid, varid,"units","m");
 
@@ -1902,12 +2464,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     dimidthree[0] = dimid_time;
     dimidthree[1] = dimid_Nk;
     dimidthree[2] = dimid_Ne;
-    if ((retval = nc_def_var(ncid,"dzf",NC_DOUBLE,3,dimidthree,&varid)))
-       ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-       ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"dzf",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","z layer spacing at edges");
     nc_addattr(ncid, varid,"units","m");
 
@@ -1934,8 +2491,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    dimidthree[2] = dimid_Nc;
    
    // eta
-   if ((retval = nc_def_var(ncid,"eta",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"eta",2,dimidtwo,myproc);
    nc_addattr(ncid, varid,"long_name","Sea surface elevation");
    nc_addattr(ncid, varid,"units","m");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1943,12 +2499,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    nc_addattr(ncid, varid,"coordinates","time yv xv");
     
    //u
-   if ((retval = nc_def_var(ncid,"uc",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"uc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Eastward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1956,12 +2507,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
    //v
-   if ((retval = nc_def_var(ncid,"vc",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval);   
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"vc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Northward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1970,12 +2516,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    //w
    dimidthree[1] = dimid_Nkw;
-   if ((retval = nc_def_var(ncid,"w",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"w",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Vertical water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1985,12 +2526,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    dimidthree[1] = dimid_Nk;
    
    //nu_v
-   if ((retval = nc_def_var(ncid,"nu_v",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"nu_v",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Vertical eddy viscosity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -1999,12 +2535,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    //salinity
    if(prop->beta>0){
-     if ((retval = nc_def_var(ncid,"salt",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"salt",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Salinity");
     nc_addattr(ncid, varid,"units","ppt");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2014,12 +2545,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    //temperature
    if(prop->gamma>0){
-     if ((retval = nc_def_var(ncid,"temp",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval); 
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"temp",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Water temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2029,12 +2555,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    //rho
    if( (prop->gamma>0) || (prop->beta>0) ){
-     if ((retval = nc_def_var(ncid,"rho",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"rho",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Water density");
     nc_addattr(ncid, varid,"units","kg m-3");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2044,24 +2565,14 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    //age
    if(prop->calcage>0){
-     if ((retval = nc_def_var(ncid,"agec",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"agec",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age concentration");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
     nc_addattr(ncid, varid,"location","face");
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
     
-    if ((retval = nc_def_var(ncid,"agealpha",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"agealpha",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age alpha parameter");
     nc_addattr(ncid, varid,"units","seconds");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2090,12 +2601,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
 
    //U
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"U",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"U",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Edge normal velocity");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2106,8 +2612,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    
    if(prop->metmodel>0){
     // Uwind
-    if ((retval = nc_def_var(ncid,"Uwind",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Uwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2115,8 +2620,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Vwind
-    if ((retval = nc_def_var(ncid,"Vwind",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Vwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2124,8 +2628,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Tair
-    if ((retval = nc_def_var(ncid,"Tair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"Tair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Air temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2133,8 +2636,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Pair
-    if ((retval = nc_def_var(ncid,"Pair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Pair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Air pressure");
     nc_addattr(ncid, varid,"units","millibar");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2142,8 +2644,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // rain
-    if ((retval = nc_def_var(ncid,"rain",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"rain",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Rain fall rate");
     nc_addattr(ncid, varid,"units","kg m2 s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2151,8 +2652,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //RH
-    if ((retval = nc_def_var(ncid,"RH",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"RH",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Relative humidity");
     nc_addattr(ncid, varid,"units","Percent (%)");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2160,8 +2660,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //cloud
-    if ((retval = nc_def_var(ncid,"cloud",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"cloud",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Cloud cover fraction");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2170,8 +2669,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     
     // Surface flux variables //
     // Hs
-    if ((retval = nc_def_var(ncid,"Hs",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hs",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Sensible heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2180,8 +2678,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hl
-    if ((retval = nc_def_var(ncid,"Hl",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hl",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Latent heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2190,8 +2687,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hlw
-    if ((retval = nc_def_var(ncid,"Hlw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hlw",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Net longwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2200,8 +2696,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hsw
-    if ((retval = nc_def_var(ncid,"Hsw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hsw",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Net shortwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2210,8 +2705,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"positive","down");   
 
     // tau_x
-    if ((retval = nc_def_var(ncid,"tau_x",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_x",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Eastward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2219,8 +2713,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
     nc_addattr(ncid, varid,"coordinates","time yv xv");   
 
     // tau_y
-    if ((retval = nc_def_var(ncid,"tau_y",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_y",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Northward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2229,8 +2722,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
 
     //EP
     if(prop->beta > 0.0){
-	if ((retval = nc_def_var(ncid,"EP",NC_DOUBLE,2,dimidtwo,&varid)))
-	    ERR(retval); 
+	varid = nc_def_outputvar(prop,ncid,"EP",2,dimidtwo,myproc);
 	nc_addattr(ncid, varid,"long_name","Evaporation minus precipiaton");
 	nc_addattr(ncid, varid,"units","m s-1");
 	nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2260,6 +2752,7 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    nc_write_int(ncid,"mark",grid->mark,myproc);
    nc_write_int(ncid,"mnptr",grid->mnptr,myproc);
    nc_write_int(ncid,"eptr",grid->eptr,myproc);
+   nc_write_compflags(ncid,grid,myproc);
    
    nc_write_double(ncid,"xv",grid->xv,myproc);
    nc_write_double(ncid,"yv",grid->yv,myproc);
@@ -2269,19 +2762,19 @@ void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, i
    nc_write_double(ncid,"yp",grid->yp,myproc);
 
    nc_write_intvar(ncid,"normal",grid,grid->normal,myproc);
-   nc_write_double(ncid,"n1",grid->n1,myproc);
-   nc_write_double(ncid,"n2",grid->n2,myproc);
+   nc_write_real(ncid,"n1",grid->n1,myproc);
+   nc_write_real(ncid,"n2",grid->n2,myproc);
    nc_write_double(ncid,"df",grid->df,myproc);
    nc_write_double(ncid,"dg",grid->dg,myproc);
    nc_write_doublevar(ncid,"def",grid,grid->def,myproc);
    nc_write_double(ncid,"Ac",grid->Ac,myproc);
 
-   nc_write_double(ncid,"dz",grid->dz,myproc);
-   nc_write_double(ncid,"z_r",z_r,myproc);
-   nc_write_double(ncid,"z_w",z_w,myproc);
+   nc_write_real(ncid,"dz",grid->dz,myproc);
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   nc_write_real(ncid,"z_w",z_w,myproc);
    nc_write_int(ncid,"Nk",grid->Nk,myproc);
    nc_write_int(ncid,"Nke",grid->Nke,myproc);
-   nc_write_double(ncid,"dv",grid->dv,myproc);
+   nc_write_real(ncid,"dv",grid->dv,myproc);
 
 
     // Need to convert the edge array that is stored is NUMEDGECOLUMN*Ne where
@@ -2320,14 +2813,10 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    int dimidone[1];
    int dimidtwo[2];
    int dimidthree[3];
-   int nofill=0;
    const size_t starttwo[] = {0,0};
    const size_t counttwo[] = {mergedGrid->Nkmax,mergedGrid->Nc};
    REAL *z_r;
    REAL *z_w;
-   const int DEFLATE=1;
-   const int DEFLATELEVEL=2;
-   const REAL FILLVALUE = (REAL)EMPTY;
 
 
    //REAL *tmpvar;
@@ -2694,8 +3183,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    dimidthree[2] = dimid_Nc;
    
    // eta average
-   if ((retval = nc_def_var(ncid,"eta_avg",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"eta_avg",2,dimidtwo,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged sea surface elevation");
    nc_addattr(ncid, varid,"units","m");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2703,8 +3191,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    nc_addattr(ncid, varid,"coordinates","time yv xv");
     
    // eta
-   if ((retval = nc_def_var(ncid,"eta",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"eta",2,dimidtwo,myproc);
    nc_addattr(ncid, varid,"long_name","Instantaneous sea surface elevation");
    nc_addattr(ncid, varid,"units","m");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2712,12 +3199,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    nc_addattr(ncid, varid,"coordinates","time yv xv");
  
    //u
-   if ((retval = nc_def_var(ncid,"uc",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"uc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Eastward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2725,12 +3207,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
    //v
-   if ((retval = nc_def_var(ncid,"vc",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval);   
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"vc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Northward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2739,12 +3216,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    
    //w
    dimidthree[1] = dimid_Nkw;
-   if ((retval = nc_def_var(ncid,"w",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"w",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Vertical water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2754,12 +3226,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    dimidthree[1] = dimid_Nk;
    
    //nu_v
-   if ((retval = nc_def_var(ncid,"nu_v",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"nu_v",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Vertical eddy viscosity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2767,12 +3234,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
    
    //kappa_tv
-   if ((retval = nc_def_var(ncid,"kappa_tv",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"kappa_tv",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged vertical tracer diffusivity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2782,12 +3244,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
  
    //salinity
    if(prop->beta>0){
-     if ((retval = nc_def_var(ncid,"salt",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"salt",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Salinity");
     nc_addattr(ncid, varid,"units","ppt");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2795,8 +3252,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
     // Depth-integrated salinity
-    if ((retval = nc_def_var(ncid,"s_dz",NC_DOUBLE,2,dimidtwo,&varid)))
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"s_dz",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Instantaneous depth-integrated salinity");
     nc_addattr(ncid, varid,"units","psu m");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2807,12 +3263,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    
    //temperature
    if(prop->gamma>0){
-     if ((retval = nc_def_var(ncid,"temp",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval); 
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"temp",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Water temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2820,8 +3271,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
      // Depth-integrated temperature
-    if ((retval = nc_def_var(ncid,"T_dz",NC_DOUBLE,2,dimidtwo,&varid)))
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"T_dz",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Instantaneous depth-integrated temperature");
     nc_addattr(ncid, varid,"units","degrees C m");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2832,12 +3282,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    
    //rho
    if( (prop->gamma>0) || (prop->beta>0) ){
-     if ((retval = nc_def_var(ncid,"rho",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"rho",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Water density");
     nc_addattr(ncid, varid,"units","kg m-3");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2847,24 +3292,14 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    
    //age
    if(prop->calcage>0){
-     if ((retval = nc_def_var(ncid,"agec",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"agec",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age concentration");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
     nc_addattr(ncid, varid,"location","face");
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
     
-    if ((retval = nc_def_var(ncid,"agealpha",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"agealpha",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age alpha parameter");
     nc_addattr(ncid, varid,"units","seconds");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2875,12 +3310,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
 
    //U_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"U_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"U_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge flux rate");
    nc_addattr(ncid, varid,"units","m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2889,12 +3319,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
 
     //s_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"s_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"s_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge salt flux rate");
    nc_addattr(ncid, varid,"units","psu m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2903,12 +3328,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
 
     //T_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"T_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"T_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge temperature flux rate");
    nc_addattr(ncid, varid,"units","degreesC m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2919,8 +3339,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    
    if(prop->metmodel>0){
     // Uwind
-    if ((retval = nc_def_var(ncid,"Uwind",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Uwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2928,8 +3347,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Vwind
-    if ((retval = nc_def_var(ncid,"Vwind",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Vwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2937,8 +3355,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Tair
-    if ((retval = nc_def_var(ncid,"Tair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"Tair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Air temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2946,8 +3363,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Pair
-    if ((retval = nc_def_var(ncid,"Pair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Pair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Air pressure");
     nc_addattr(ncid, varid,"units","millibar");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2955,8 +3371,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // rain
-    if ((retval = nc_def_var(ncid,"rain",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"rain",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Rain fall rate");
     nc_addattr(ncid, varid,"units","kg m2 s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2964,8 +3379,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //RH
-    if ((retval = nc_def_var(ncid,"RH",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"RH",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Relative humidity");
     nc_addattr(ncid, varid,"units","Percent (%)");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2973,8 +3387,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //cloud
-    if ((retval = nc_def_var(ncid,"cloud",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"cloud",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Cloud cover fraction");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2983,8 +3396,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     
     // Surface flux variables //
     // Hs
-    if ((retval = nc_def_var(ncid,"Hs",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hs",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Sensible heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -2993,8 +3405,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hl
-    if ((retval = nc_def_var(ncid,"Hl",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hl",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Latent heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3003,8 +3414,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hlw
-    if ((retval = nc_def_var(ncid,"Hlw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hlw",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Net longwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3013,8 +3423,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hsw
-    if ((retval = nc_def_var(ncid,"Hsw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hsw",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Net shortwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3023,8 +3432,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"positive","down");   
 
     // tau_x
-    if ((retval = nc_def_var(ncid,"tau_x",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_x",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3032,8 +3440,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
     nc_addattr(ncid, varid,"coordinates","time yv xv");   
 
     // tau_y
-    if ((retval = nc_def_var(ncid,"tau_y",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_y",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Northward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3042,8 +3449,7 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
 
     //EP
     if(prop->beta > 0.0){
-	if ((retval = nc_def_var(ncid,"EP",NC_DOUBLE,2,dimidtwo,&varid)))
-	    ERR(retval); 
+	varid = nc_def_outputvar(prop,ncid,"EP",2,dimidtwo,myproc);
 	nc_addattr(ncid, varid,"long_name","Time-averaged surface salt flux (S0*EP)");
 	nc_addattr(ncid, varid,"units","psu m s-1");
 	nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3081,19 +3487,19 @@ void InitialiseAverageNCugridMerge(propT *prop, gridT *grid, averageT *average,
    nc_write_double(ncid,"yp",grid->yp,myproc);
 
    nc_write_intvar(ncid,"normal",mergedGrid,mergedGrid->normal,myproc);
-   nc_write_double(ncid,"n1",mergedGrid->n1,myproc);
-   nc_write_double(ncid,"n2",mergedGrid->n2,myproc);
+   nc_write_real(ncid,"n1",mergedGrid->n1,myproc);
+   nc_write_real(ncid,"n2",mergedGrid->n2,myproc);
    nc_write_double(ncid,"df",mergedGrid->df,myproc);
    nc_write_double(ncid,"dg",mergedGrid->dg,myproc);
-   nc_write_double(ncid,"def",mergedGrid->def,myproc);
+   nc_write_real(ncid,"def",mergedGrid->def,myproc);
    nc_write_double(ncid,"Ac",mergedGrid->Ac,myproc);
 
-   nc_write_double(ncid,"dz",grid->dz,myproc);
-   nc_write_double(ncid,"z_r",z_r,myproc);
-   nc_write_double(ncid,"z_w",z_w,myproc);
+   nc_write_real(ncid,"dz",grid->dz,myproc);
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   nc_write_real(ncid,"z_w",z_w,myproc);
    nc_write_int(ncid,"Nk",mergedGrid->Nk,myproc);
    nc_write_int(ncid,"Nke",mergedGrid->Nke,myproc);
-   nc_write_double(ncid,"dv",mergedGrid->dv,myproc);
+   nc_write_real(ncid,"dv",mergedGrid->dv,myproc);
 
   // nc_write_double(ncid,"average_time",(float)prop->ntaverage*prop->dt,myproc);
 
@@ -3119,14 +3525,10 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    int dimidone[1];
    int dimidtwo[2];
    int dimidthree[3];
-   int nofill=0;
    const size_t starttwo[] = {0,0};
    const size_t counttwo[] = {grid->Nkmax,grid->Nc};
    REAL *z_r;
    REAL *z_w;
-   const int DEFLATE=1;
-   const int DEFLATELEVEL=2;
-   const REAL FILLVALUE = (REAL)EMPTY;
 
 
    //REAL *tmpvar;
@@ -3268,6 +3670,18 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     //if ((retval = nc_put_var_int(ncid,varid, grid->eptr)))
     //  ERR(retval);
 
+    //cellcomp
+    dimidone[0] = dimid_Nc;
+    if ((retval = nc_def_var(ncid,"cellcomp",NC_INT,1,dimidone,&varid)))
+      ERR(retval);
+    nc_addattr(ncid, varid,"long_name","Flag for faces that are computed on this processor (used by sunjoin)");
+
+    //edgecomp
+    dimidone[0] = dimid_Ne;
+    if ((retval = nc_def_var(ncid,"edgecomp",NC_INT,1,dimidone,&varid)))
+      ERR(retval);
+    nc_addattr(ncid, varid,"long_name","Flag for edges that are computed on this processor (used by sunjoin)");
+
    /********************************************************************** 
     *
     * Define the grid coordinate variables and attributes 
@@ -3508,8 +3922,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    dimidthree[2] = dimid_Nc;
    
    // eta
-   if ((retval = nc_def_var(ncid,"eta",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"eta",2,dimidtwo,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Sea surface elevation");
    nc_addattr(ncid, varid,"units","m");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3517,12 +3930,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    nc_addattr(ncid, varid,"coordinates","time yv xv");
     
    //u
-   if ((retval = nc_def_var(ncid,"uc",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"uc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Eastward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3530,12 +3938,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
    //v
-   if ((retval = nc_def_var(ncid,"vc",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval);   
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"vc",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Northward water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3544,12 +3947,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    
    //w
    dimidthree[1] = dimid_Nkw;
-   if ((retval = nc_def_var(ncid,"w",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"w",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Vertical water velocity component");
    nc_addattr(ncid, varid,"units","m s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3559,12 +3957,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    dimidthree[1] = dimid_Nk;
    
    //nu_v
-   if ((retval = nc_def_var(ncid,"nu_v",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"nu_v",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged Vertical eddy viscosity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3572,12 +3965,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
    
    //kappa_tv
-   if ((retval = nc_def_var(ncid,"kappa_tv",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"kappa_tv",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged vertical tracer diffusivity");
    nc_addattr(ncid, varid,"units","m2 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3586,12 +3974,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
 
    //salinity
    if(prop->beta>0){
-     if ((retval = nc_def_var(ncid,"salt",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"salt",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Salinity");
     nc_addattr(ncid, varid,"units","ppt");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3599,8 +3982,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
     // Depth-integrated salinity
-    if ((retval = nc_def_var(ncid,"s_dz",NC_DOUBLE,2,dimidtwo,&varid)))
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"s_dz",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Instantaneous depth-integrated salinity");
     nc_addattr(ncid, varid,"units","psu m");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3611,12 +3993,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    
    //temperature
    if(prop->gamma>0){
-     if ((retval = nc_def_var(ncid,"temp",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval); 
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"temp",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Water temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3624,8 +4001,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
 
      // Depth-integrated temperature
-    if ((retval = nc_def_var(ncid,"T_dz",NC_DOUBLE,2,dimidtwo,&varid)))
-       ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"T_dz",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Instantaneous depth-integrated temperature");
     nc_addattr(ncid, varid,"units","degrees C m");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3636,12 +4012,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    
    //rho
    if( (prop->gamma>0) || (prop->beta>0) ){
-     if ((retval = nc_def_var(ncid,"rho",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"rho",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Water density");
     nc_addattr(ncid, varid,"units","kg m-3");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3651,24 +4022,14 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    
    //age
    if(prop->calcage>0){
-     if ((retval = nc_def_var(ncid,"agec",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-     if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-     if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+     varid = nc_def_outputvar(prop,ncid,"agec",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age concentration");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
     nc_addattr(ncid, varid,"location","face");
     nc_addattr(ncid, varid,"coordinates","time z_r yv xv");
     
-    if ((retval = nc_def_var(ncid,"agealpha",NC_DOUBLE,3,dimidthree,&varid)))
-      ERR(retval);
-    if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-    if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"agealpha",3,dimidthree,myproc);
     nc_addattr(ncid, varid,"long_name","Age alpha parameter");
     nc_addattr(ncid, varid,"units","seconds");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3678,12 +4039,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    }
    //U_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"U_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"U_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge flux rate");
    nc_addattr(ncid, varid,"units","m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3692,12 +4048,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
 
     //s_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"s_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"s_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge salt flux rate");
    nc_addattr(ncid, varid,"units","psu m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3706,12 +4057,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
 
     //T_F
    dimidthree[2] = dimid_Ne;
-   if ((retval = nc_def_var(ncid,"T_F",NC_DOUBLE,3,dimidthree,&varid)))
-     ERR(retval); 
-   if ((retval = nc_def_var_fill(ncid,varid,nofill,&FILLVALUE))) // Sets a _FillValue attribute
-      ERR(retval);
-   if ((retval = nc_def_var_deflate(ncid,varid,0,DEFLATE,DEFLATELEVEL))) // Compresses the variable
-      ERR(retval);
+   varid = nc_def_outputvar(prop,ncid,"T_F",3,dimidthree,myproc);
    nc_addattr(ncid, varid,"long_name","Time-averaged edge temperature flux rate");
    nc_addattr(ncid, varid,"units","degreesC m3 s-1");
    nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3723,8 +4069,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    
    if(prop->metmodel>0){
     // Uwind
-    if ((retval = nc_def_var(ncid,"Uwind",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Uwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3732,8 +4077,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Vwind
-    if ((retval = nc_def_var(ncid,"Vwind",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Vwind",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward wind velocity component");
     nc_addattr(ncid, varid,"units","m s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3741,8 +4085,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Tair
-    if ((retval = nc_def_var(ncid,"Tair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval);
+    varid = nc_def_outputvar(prop,ncid,"Tair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Air temperature");
     nc_addattr(ncid, varid,"units","degrees C");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3750,8 +4093,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // Pair
-    if ((retval = nc_def_var(ncid,"Pair",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Pair",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Air pressure");
     nc_addattr(ncid, varid,"units","millibar");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3759,8 +4101,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     // rain
-    if ((retval = nc_def_var(ncid,"rain",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"rain",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Rain fall rate");
     nc_addattr(ncid, varid,"units","kg m2 s-1");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3768,8 +4109,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //RH
-    if ((retval = nc_def_var(ncid,"RH",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"RH",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Relative humidity");
     nc_addattr(ncid, varid,"units","Percent (%)");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3777,8 +4117,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");
 
     //cloud
-    if ((retval = nc_def_var(ncid,"cloud",NC_DOUBLE,2,dimidtwo,&varid)))
-	ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"cloud",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Cloud cover fraction");
     nc_addattr(ncid, varid,"units","");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3787,8 +4126,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     
     // Surface flux variables //
     // Hs
-    if ((retval = nc_def_var(ncid,"Hs",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hs",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Sensible heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3797,8 +4135,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hl
-    if ((retval = nc_def_var(ncid,"Hl",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hl",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Latent heat flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3807,8 +4144,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hlw
-    if ((retval = nc_def_var(ncid,"Hlw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hlw",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Net longwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3817,8 +4153,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"positive","down");   
 
     // Hsw
-    if ((retval = nc_def_var(ncid,"Hsw",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"Hsw",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Net shortwave radiation flux");
     nc_addattr(ncid, varid,"units","W m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3827,8 +4162,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"positive","down");   
 
     // tau_x
-    if ((retval = nc_def_var(ncid,"tau_x",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_x",2,dimidtwo,myproc);
     nc_addattr(ncid, varid,"long_name","Time-averaged Eastward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3836,8 +4170,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
     nc_addattr(ncid, varid,"coordinates","time yv xv");   
 
     // tau_y
-    if ((retval = nc_def_var(ncid,"tau_y",NC_DOUBLE,2,dimidtwo,&varid)))
-      ERR(retval); 
+    varid = nc_def_outputvar(prop,ncid,"tau_y",2,dimidtwo,myproc);
      nc_addattr(ncid, varid,"long_name","Time-averaged Northward component surface wind stress");
     nc_addattr(ncid, varid,"units","N m-2");
     nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3846,8 +4179,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
 
     //EP
     if(prop->beta > 0.0){
-	if ((retval = nc_def_var(ncid,"EP",NC_DOUBLE,2,dimidtwo,&varid)))
-	    ERR(retval); 
+	varid = nc_def_outputvar(prop,ncid,"EP",2,dimidtwo,myproc);
 	nc_addattr(ncid, varid,"long_name","Time-averaged surface salt flux (S0*EP)");
 	nc_addattr(ncid, varid,"units","psu m s-1");
 	nc_addattr(ncid, varid,"mesh","suntans_mesh");
@@ -3875,6 +4207,7 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    nc_write_int(ncid,"grad",grid->grad,myproc);
    nc_write_int(ncid,"mnptr",grid->mnptr,myproc);
    nc_write_int(ncid,"eptr",grid->eptr,myproc);
+   nc_write_compflags(ncid,grid,myproc);
    
    nc_write_double(ncid,"xv",grid->xv,myproc);
    nc_write_double(ncid,"yv",grid->yv,myproc);
@@ -3884,19 +4217,19 @@ void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int m
    nc_write_double(ncid,"yp",grid->yp,myproc);
 
    nc_write_int(ncid,"normal",grid->normal,myproc);
-   nc_write_double(ncid,"n1",grid->n1,myproc);
-   nc_write_double(ncid,"n2",grid->n2,myproc);
+   nc_write_real(ncid,"n1",grid->n1,myproc);
+   nc_write_real(ncid,"n2",grid->n2,myproc);
    nc_write_double(ncid,"df",grid->df,myproc);
    nc_write_double(ncid,"dg",grid->dg,myproc);
-   nc_write_double(ncid,"def",grid->def,myproc);
+   nc_write_real(ncid,"def",grid->def,myproc);
    nc_write_double(ncid,"Ac",grid->Ac,myproc);
 
-   nc_write_double(ncid,"dz",grid->dz,myproc);
-   nc_write_double(ncid,"z_r",z_r,myproc);
-   nc_write_double(ncid,"z_w",z_w,myproc);
+   nc_write_real(ncid,"dz",grid->dz,myproc);
+   nc_write_real(ncid,"z_r",z_r,myproc);
+   nc_write_real(ncid,"z_w",z_w,myproc);
    nc_write_int(ncid,"Nk",grid->Nk,myproc);
    nc_write_int(ncid,"Nke",grid->Nke,myproc);
-   nc_write_double(ncid,"dv",grid->dv,myproc);
+   nc_write_real(ncid,"dv",grid->dv,myproc);
 
   // nc_write_double(ncid,"average_time",(float)prop->ntaverage*prop->dt,myproc);
 
@@ -3919,7 +4252,7 @@ void WriteAverageNCmerge(propT *prop, gridT *grid, averageT *average, physT *phy
    size_t startthree[] = {prop->avgtimectr,0,0};
    size_t countthree[] = {1,grid->Nkmax,grid->Nc};
    const size_t countthreew[] = {1,grid->Nkmax+1,grid->Nc};
-   const REAL time[] = {prop->nctime};
+   const DREAL time[] = {prop->nctime};
    int ntaverage=prop->ntaverage;
     char str[BUFFERLENGTH], filename[BUFFERLENGTH];
 
@@ -3927,7 +4260,7 @@ void WriteAverageNCmerge(propT *prop, gridT *grid, averageT *average, physT *phy
    
    prop->avgctr+=1;
    // Output the first time step but don't compute the average 
-   if(!(prop->n%ntaverage)) {
+   if(IntervalDue(prop,ntaverage)) {
 
     // Work out if we need to open a new averages file or not
     if(!(prop->avgtimectr%prop->nstepsperncfile) || prop->n==1+prop->nstart){
@@ -3981,7 +4314,7 @@ void WriteAverageNCmerge(propT *prop, gridT *grid, averageT *average, physT *phy
     if(myproc==0){
 	if ((retval = nc_inq_varid(ncid, "time", &varid)))
 	    ERR(retval);
-	if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time )))
+	if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time)))
 	    ERR(retval);
 	countthree[2] = mergedGrid->Nc;
 	counttwo[1] = mergedGrid->Nc;
@@ -4078,7 +4411,7 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
    size_t startthree[] = {prop->avgtimectr,0,0};
    size_t countthree[] = {1,grid->Nkmax,grid->Nc};
    const size_t countthreew[] = {1,grid->Nkmax+1,grid->Nc};
-   const REAL time[] = {prop->nctime};
+   const DREAL time[] = {prop->nctime};
    int ntaverage=prop->ntaverage;
 
    nc_set_log_level(3); // This helps with debugging errors
@@ -4094,7 +4427,7 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
    // Output the first time step but don't compute the average 
    //if(!(prop->n%ntaverage) || prop->n==1+prop->nstart) {
 //    if(prop->avgctr==ntaverage || prop->n==1+prop->nstart) {
-   if(!(prop->n%ntaverage)) {
+   if(IntervalDue(prop,ntaverage)) {
      //printf("prop->n/prop->ntaverage=%d\n",prop->n/prop->ntaverage);
      
     //Compute the averages 
@@ -4118,44 +4451,44 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
     /* Write the time data*/
     if ((retval = nc_inq_varid(ncid, "time", &varid)))
 	ERR(retval);
-    if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time )))
+    if ((retval = nc_put_vara_double(ncid, varid, startone, countone, time)))
 	ERR(retval);
     
     /* Write to the physical variables*/
     if ((retval = nc_inq_varid(ncid, "eta", &varid)))
 	ERR(retval);
-    if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->h )))
+    if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->h )))
  	ERR(retval);
     
     if ((retval = nc_inq_varid(ncid, "uc", &varid)))
 	ERR(retval);
     ravel(average->uc, average->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+    if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	ERR(retval);
     
     if ((retval = nc_inq_varid(ncid, "vc", &varid)))
 	ERR(retval);
     ravel(average->vc, average->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+    if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	ERR(retval);
       
     // write w at cell top and bottom
     if ((retval = nc_inq_varid(ncid, "w", &varid)))
 	ERR(retval);
     ravelW(average->w, average->tmpvarW, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthreew, average->tmpvarW )))
+    if ((retval = nc_put_vara_output(ncid, varid, startthree, countthreew, average->tmpvarW )))
 	ERR(retval);
 
     if ((retval = nc_inq_varid(ncid, "nu_v", &varid)))
 	ERR(retval);
     ravel(average->nu_v, average->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+    if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	ERR(retval);
 
     if ((retval = nc_inq_varid(ncid, "kappa_tv", &varid)))
 	ERR(retval);
     ravel(average->kappa_tv, average->tmpvar, grid);
-    if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+    if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	ERR(retval);
     
     // Tracers
@@ -4163,12 +4496,12 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
        if ((retval = nc_inq_varid(ncid, "salt", &varid)))
 	  ERR(retval);
       ravel(average->s, average->tmpvar, grid);
-      if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+      if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	  ERR(retval);
 
 	if ((retval = nc_inq_varid(ncid, "s_dz", &varid)))
 	    ERR(retval);
-	if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->s_dz )))
+	if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->s_dz )))
 	    ERR(retval);
      }
      
@@ -4176,12 +4509,12 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
 	if ((retval = nc_inq_varid(ncid, "temp", &varid)))
 	  ERR(retval);
 	ravel(average->T, average->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	  ERR(retval);
 
 	if ((retval = nc_inq_varid(ncid, "T_dz", &varid)))
 	    ERR(retval);
-	if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->T_dz )))
+	if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->T_dz )))
 	    ERR(retval);
      }
       
@@ -4189,7 +4522,7 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
 	if ((retval = nc_inq_varid(ncid, "rho", &varid)))
 	  ERR(retval);
 	ravel(average->rho, average->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	  ERR(retval);
      }
 
@@ -4197,13 +4530,13 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
 	if ((retval = nc_inq_varid(ncid, "agec", &varid)))
 	  ERR(retval);
 	ravel(average->agec, average->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	  ERR(retval);
 
 	if ((retval = nc_inq_varid(ncid, "agealpha", &varid)))
 	  ERR(retval);
 	ravel(average->agealpha, average->tmpvar, grid);
-	if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvar )))
+	if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvar )))
 	  ERR(retval);
 
     }
@@ -4213,93 +4546,93 @@ void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, me
      if ((retval = nc_inq_varid(ncid, "U_F", &varid)))
 	ERR(retval);
      ravelEdge(average->U_F, average->tmpvarE, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvarE )))
+     if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvarE )))
         ERR(retval);
 
      if ((retval = nc_inq_varid(ncid, "s_F", &varid)))
 	ERR(retval);
      ravelEdge(average->s_F, average->tmpvarE, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvarE )))
+     if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvarE )))
         ERR(retval);
 
      if ((retval = nc_inq_varid(ncid, "T_F", &varid)))
 	ERR(retval);
      ravelEdge(average->T_F, average->tmpvarE, grid);
-     if ((retval = nc_put_vara_double(ncid, varid, startthree, countthree, average->tmpvarE )))
+     if ((retval = nc_put_vara_output(ncid, varid, startthree, countthree, average->tmpvarE )))
         ERR(retval);
 
      // Wind variables
      if(prop->metmodel>0){
        if ((retval = nc_inq_varid(ncid, "Uwind", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Uwind )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Uwind )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Vwind", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Vwind )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Vwind )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Tair", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Tair )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Tair )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Pair", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Pair )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Pair )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "rain", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->rain )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->rain )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "RH", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->RH )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->RH )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "cloud", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->cloud )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->cloud )))
 	 ERR(retval);
        
        // Heat flux variables
        if ((retval = nc_inq_varid(ncid, "Hs", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Hs )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Hs )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Hl", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Hl )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Hl )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Hlw", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Hlw )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Hlw )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "Hsw", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->Hsw )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->Hsw )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "tau_x", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->tau_x )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->tau_x )))
 	 ERR(retval);
        
        if ((retval = nc_inq_varid(ncid, "tau_y", &varid)))
 	 ERR(retval);
-       if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->tau_y )))
+       if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->tau_y )))
 	 ERR(retval);
        
        if(prop->beta > 0.0){
 	  if ((retval = nc_inq_varid(ncid, "EP", &varid)))
 	     ERR(retval);
-	  if ((retval = nc_put_vara_double(ncid, varid, starttwo, counttwo, average->EP )))
+	  if ((retval = nc_put_vara_output(ncid, varid, starttwo, counttwo, average->EP )))
 	     ERR(retval);
        }
      }
@@ -4353,7 +4686,7 @@ static void nc_addattr_int(int ncid, int varid, char *attname, int *attvalue){
  */
 static void nc_addattr_real(int ncid, int varid, char *attname, REAL *attvalue){
     int retval;
-    if ((retval = nc_put_att_double(ncid, varid, attname ,NC_DOUBLE,1,attvalue)))
+    if ((retval = nc_put_att_real(ncid, varid, attname ,NC_DOUBLE,1,attvalue)))
 	ERR(retval);
 	
 }
@@ -4457,6 +4790,11 @@ void ReadMetNC(propT *prop, gridT *grid, metinT *metin,int myproc){
 	metin->t2 = metin->t1+1;
     }
     t0 = metin->t0;
+
+    if(prop->metgrid){
+      ReadMetNCwindow(prop,metin,t0,myproc);
+      return;
+    }
     
     //printf("Model time(0) = %f, time index = %d of %d\n",prop->nctime,t0,metin->nt);
     start[0] = t0;
@@ -4499,19 +4837,130 @@ void ReadMetNC(propT *prop, gridT *grid, metinT *metin,int myproc){
     nc_read_2D(ncid,vname,start,count, metin->cloud, myproc);
 } //End function
 
+/*
+* Function: ReadMetNCwindow()
+* ---------------------------
+* Reads the NTmet time steps from t0 of the sub-window of the regular met grid
+* of this processor (metgrid=1).  The variables are dimensioned (nt,ny,nx), so each
+* time step of the window is read directly into the vector of the variable with
+* the points ordered as (j-j0)*nxw+(i-i0).
+*
+*/
+static void ReadMetNCwindow(propT *prop, metinT *metin, int t0, int myproc){
+    int retval, n, v;
+    int varid;
+    size_t start[3], count[3];
+    int ncid = prop->metncid;
+    char *vnames[] = {"Uwind","Vwind","Tair","Pair","rain","RH","cloud"};
+    REAL **data[] = {metin->Uwind,metin->Vwind,metin->Tair,metin->Pair,metin->rain,metin->RH,metin->cloud};
+
+    start[1] = metin->j0;
+    start[2] = metin->i0;
+    count[0] = 1;
+    count[1] = metin->nyw;
+    count[2] = metin->nxw;
+    for(v=0;v<NMETVAR;v++){
+      if(VERBOSE>2 && myproc==0) printf("Reading variable: %s from netcdf file...\n",vnames[v]);
+      if ((retval = nc_inq_varid(ncid, vnames[v], &varid)))
+	ERR(retval);
+      for(n=0;n<NTmet;n++){
+	start[0] = t0+n;
+	if ((retval = nc_get_vara_real(ncid, varid, start, count, data[v][n])))
+	  ERR(retval);
+      }
+    }
+} //End function
+
+/*
+* Function: ReadMetNCgrid()
+* -------------------------
+* Reads the size nx, ny and the coordinates x(nx) and y(ny) of the regular met grid
+* (metgrid=1).  The coordinates are in the units of the SUNTANS grid (degrees or
+* metres) and must be monotonic.
+*
+*/
+void ReadMetNCgrid(propT *prop, metinT *metin, int myproc){
+    int retval;
+    int varid;
+    int ncid = prop->metncid;
+
+    metin->nx = returndimlen(ncid,"nx");
+    metin->ny = returndimlen(ncid,"ny");
+    metin->xg = (DREAL *)SunMalloc(metin->nx*sizeof(DREAL),"ReadMetNCgrid");
+    metin->yg = (DREAL *)SunMalloc(metin->ny*sizeof(DREAL),"ReadMetNCgrid");
+
+    if(VERBOSE>2 && myproc==0) printf("Reading met grid of %d x %d points...\n",(int)metin->nx,(int)metin->ny);
+    if ((retval = nc_inq_varid(ncid, "x", &varid)))
+	ERR(retval);
+    if ((retval = nc_get_var_double(ncid, varid, metin->xg)))
+      ERR(retval);
+    if ((retval = nc_inq_varid(ncid, "y", &varid)))
+	ERR(retval);
+    if ((retval = nc_get_var_double(ncid, varid, metin->yg)))
+      ERR(retval);
+} //End function
+
+/*
+* Function: ReadMetNCheight()
+* ---------------------------
+* Reads the scalar height vname of a variable on the regular met grid into the N
+* points of the variable.
+*
+*/
+static void ReadMetNCheight(int ncid, char *vname, REAL *z, int N, int myproc){
+    int retval, j;
+    int varid;
+    double height;
+
+    if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
+    if ((retval = nc_inq_varid(ncid, vname, &varid)))
+	ERR(retval);
+    if ((retval = nc_get_var_double(ncid, varid, &height)))
+      ERR(retval);
+    for(j=0;j<N;j++)
+      z[j]=height;
+} //End function
+
 /*
 * Function: ReadMetNCcoord()
 * --------------------------
 * Read the coordinate information from the netcdf file 
 *
+* With a regular met grid (metgrid=1) the coordinates of the points of each
+* variable are those of the sub-window of this processor and the heights
+* z_Uwind, z_Vwind, z_Tair and z_RH are scalars.
+*
 */
 void ReadMetNCcoord(propT *prop, gridT *grid, metinT *metin, int myproc){
   
     /* Read the data from the meteorological netcdf file into the metin structure */
-    int retval, j;
+    int retval, i, j;
     int varid;
     char *vname;
     int ncid = prop->metncid;
+    DREAL *xw[] = {metin->x_Uwind,metin->x_Vwind,metin->x_Tair,metin->x_Pair,metin->x_rain,metin->x_RH,metin->x_cloud};
+    DREAL *yw[] = {metin->y_Uwind,metin->y_Vwind,metin->y_Tair,metin->y_Pair,metin->y_rain,metin->y_RH,metin->y_cloud};
+
+    if(prop->metgrid){
+      for(j=0;j<metin->nyw;j++)
+	for(i=0;i<metin->nxw;i++)
+	  for(varid=0;varid<NMETVAR;varid++){
+	    xw[varid][j*metin->nxw+i] = metin->xg[metin->i0+i];
+	    yw[varid][j*metin->nxw+i] = metin->yg[metin->j0+j];
+	  }
+      ReadMetNCheight(ncid,"z_Uwind",metin->z_Uwind,metin->NUwind,myproc);
+      ReadMetNCheight(ncid,"z_Vwind",metin->z_Vwind,metin->NVwind,myproc);
+      ReadMetNCheight(ncid,"z_Tair",metin->z_Tair,metin->NTair,myproc);
+      ReadMetNCheight(ncid,"z_RH",metin->z_RH,metin->NRH,myproc);
+
+      vname = "Time";
+      if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
+      if ((retval = nc_inq_varid(ncid, vname, &varid)))
+	ERR(retval);
+      if ((retval = nc_get_var_double(ncid, varid,metin->time)))
+	ERR(retval);
+      return;
+    }
 
     /* Get the horizontal coordintates*/
     vname = "x_Uwind";
@@ -4604,25 +5053,25 @@ void ReadMetNCcoord(propT *prop, gridT *grid, metinT *metin, int myproc){
     if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid,metin->z_Uwind))) 
+    if ((retval = nc_get_var_real(ncid, varid,metin->z_Uwind))) 
       ERR(retval); 
     vname = "z_Vwind";
     if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid,metin->z_Vwind))) 
+    if ((retval = nc_get_var_real(ncid, varid,metin->z_Vwind))) 
       ERR(retval); 
     vname = "z_Tair";
     if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid,metin->z_Tair))) 
+    if ((retval = nc_get_var_real(ncid, varid,metin->z_Tair))) 
       ERR(retval); 
     vname = "z_RH";
     if(VERBOSE>2 && myproc==0) printf("Reading variable: %s...\n",vname);
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid,metin->z_RH))) 
+    if ((retval = nc_get_var_real(ncid, varid,metin->z_RH))) 
       ERR(retval); 
     
     /* Time */
@@ -4637,6 +5086,85 @@ void ReadMetNCcoord(propT *prop, gridT *grid, metinT *metin, int myproc){
 
 }// End function
 
+/*###############################################################
+*
+* Spatial field input NetCDF functions
+*
+#################################################################*/
+
+/*
+* Function: ReadFieldNC()
+* -----------------------
+* Reads the window around extent of the raster z(ny,nx) in field->file, which has
+* evenly spaced coordinates x(nx) and y(ny).  Values equal to the _FillValue of z
+* have no data.
+*
+*/
+void ReadFieldNC(fieldT *field, REAL *extent, int myproc){
+    int retval, ncid, varid, dimids[2], i0, j0;
+    size_t nx, ny, start[2], count[2];
+    nc_type type;
+    double x[2], y[2], fill;
+
+    ncid = MPI_NCOpen(field->file,NC_NOWRITE,"ReadField",myproc);
+
+    if ((retval = nc_inq_varid(ncid, "z", &varid)))
+	ERR(retval);
+    if ((retval = nc_inq_vardimid(ncid, varid, dimids)))
+	ERR(retval);
+    if ((retval = nc_inq_dimlen(ncid, dimids[0], &ny)))
+	ERR(retval);
+    if ((retval = nc_inq_dimlen(ncid, dimids[1], &nx)))
+	ERR(retval);
+    if(nx<2 || ny<2){
+      printf("Error: the raster in %s must have at least 2 points in x and y.\n",field->file);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+
+    // Nodata value
+    if(nc_get_att_double(ncid, varid, "_FillValue", &fill)!=NC_NOERR){
+      if ((retval = nc_inq_vartype(ncid, varid, &type)))
+	ERR(retval);
+      fill = (type==NC_FLOAT ? (double)NC_FILL_FLOAT : NC_FILL_DOUBLE);
+    }
+    field->nodata = fill;
+
+    // Pixel centers from the first two coordinates
+    start[0] = 0;
+    count[0] = 2;
+    if ((retval = nc_inq_varid(ncid, "x", &varid)))
+	ERR(retval);
+    if ((retval = nc_get_vara_double(ncid, varid, start, count, x)))
+	ERR(retval);
+    if ((retval = nc_inq_varid(ncid, "y", &varid)))
+	ERR(retval);
+    if ((retval = nc_get_vara_double(ncid, varid, start, count, y)))
+	ERR(retval);
+    field->x0 = x[0];
+    field->dx = x[1]-x[0];
+    field->y0 = y[0];
+    field->dy = y[1]-y[0];
+
+    field->nx = FieldRasterWindow(field->x0,field->dx,nx,extent[0],extent[1],&i0);
+    field->ny = FieldRasterWindow(field->y0,field->dy,ny,extent[2],extent[3],&j0);
+    field->x0 += i0*field->dx;
+    field->y0 += j0*field->dy;
+    field->N = field->nx*field->ny;
+    field->z = (REAL *)malloc(field->N*sizeof(REAL));
+
+    start[0] = j0;
+    start[1] = i0;
+    count[0] = field->ny;
+    count[1] = field->nx;
+    if ((retval = nc_inq_varid(ncid, "z", &varid)))
+	ERR(retval);
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, field->z)))
+	ERR(retval);
+
+    MPI_NCClose(ncid);
+} //End function
+
 /*
 * Function: returndimlen()
 * ------------------------
@@ -4735,11 +5263,11 @@ void ReadBdyNC(propT *prop, gridT *grid, int myproc, MPI_Comm comm){
 	/*
   	// Distribute the data to the other processors
 	sendSize = count[0]*count[1]*count[2];
-	MPI_Bcast(&(bound->boundary_u_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->boundary_v_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->boundary_w_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->boundary_T_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->boundary_S_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
+	MPI_Bcast(&(bound->boundary_u_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->boundary_v_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->boundary_w_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->boundary_T_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->boundary_S_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
 	*/
 
     }
@@ -4783,13 +5311,13 @@ void ReadBdyNC(propT *prop, gridT *grid, int myproc, MPI_Comm comm){
 	/*
   	// Distribute the data to the other processors
 	sendSize = count[0]*count[1]*count[2];
-	MPI_Bcast(&(bound->uc_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->vc_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->wc_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->T_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->S_t[0][0][0]),sendSize,MPI_DOUBLE,0,comm);
+	MPI_Bcast(&(bound->uc_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->vc_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->wc_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->T_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->S_t[0][0][0]),sendSize,MPI_REALTYPE,0,comm);
 	sendSize = count2[0]*count2[1];
-	MPI_Bcast(&(bound->h_t[0][0]),sendSize,MPI_DOUBLE,0,comm);
+	MPI_Bcast(&(bound->h_t[0][0]),sendSize,MPI_REALTYPE,0,comm);
 	*/
 
 
@@ -4840,7 +5368,7 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
     if(VERBOSE>2 && myproc==0) printf("Reading boundary variable: %s...",vname);
     if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid,bound->z))) 
+    if ((retval = nc_get_var_real(ncid, varid,bound->z))) 
       ERR(retval); 
     if(VERBOSE>2 && myproc==0) printf("done.\n");
 
@@ -4850,7 +5378,7 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
 	if(VERBOSE>2 && myproc==0) printf("Reading boundary variable: %s...",vname);
 	if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	    ERR(retval);
-	if ((retval = nc_get_var_double(ncid, varid,bound->xv))) 
+	if ((retval = nc_get_var_real(ncid, varid,bound->xv))) 
 	  ERR(retval); 
 	if(VERBOSE>2 && myproc==0) printf("done.\n");
 
@@ -4858,7 +5386,7 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
 	if(VERBOSE>2 && myproc==0) printf("Reading boundary variable: %s...",vname);
 	if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	    ERR(retval);
-	if ((retval = nc_get_var_double(ncid, varid,bound->yv))) 
+	if ((retval = nc_get_var_real(ncid, varid,bound->yv))) 
 	      ERR(retval); 
 	if(VERBOSE>2 && myproc==0) printf("done.\n");
 
@@ -4877,14 +5405,14 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
 	if(VERBOSE>2 && myproc==0) printf("Reading boundary variable: %s...\n",vname);
 	if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	    ERR(retval);
-	if ((retval = nc_get_var_double(ncid, varid,bound->xe))) 
+	if ((retval = nc_get_var_real(ncid, varid,bound->xe))) 
 	  ERR(retval); 
 
 	vname = "ye";
 	if(VERBOSE>2 && myproc==0) printf("Reading boundary variable: %s...\n",vname);
 	if ((retval = nc_inq_varid(ncid, vname, &varid)))
 	    ERR(retval);
-	if ((retval = nc_get_var_double(ncid, varid,bound->ye))) 
+	if ((retval = nc_get_var_real(ncid, varid,bound->ye))) 
 	  ERR(retval); 
 
 	vname = "edgep";
@@ -4915,15 +5443,15 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
     /*
     //Distribute the arrays
     MPI_Bcast(&(bound->time[0]),bound->Nt,MPI_DOUBLE,0,comm);
-    MPI_Bcast(&(bound->z[0]),bound->Nk,MPI_DOUBLE,0,comm);
+    MPI_Bcast(&(bound->z[0]),bound->Nk,MPI_REALTYPE,0,comm);
     if(bound->hasType3>0){
-	MPI_Bcast(&(bound->xv[0]),bound->Ntype3,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->yv[0]),bound->Ntype3,MPI_DOUBLE,0,comm);
+	MPI_Bcast(&(bound->xv[0]),bound->Ntype3,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->yv[0]),bound->Ntype3,MPI_REALTYPE,0,comm);
 	MPI_Bcast(&(bound->cellp[0]),bound->Ntype3,MPI_INT,0,comm);
     }
     if(bound->hasType2>0){
-	MPI_Bcast(&(bound->xe[0]),bound->Ntype2,MPI_DOUBLE,0,comm);
-	MPI_Bcast(&(bound->ye[0]),bound->Ntype2,MPI_DOUBLE,0,comm);
+	MPI_Bcast(&(bound->xe[0]),bound->Ntype2,MPI_REALTYPE,0,comm);
+	MPI_Bcast(&(bound->ye[0]),bound->Ntype2,MPI_REALTYPE,0,comm);
 	MPI_Bcast(&(bound->edgep[0]),bound->Ntype2,MPI_INT,0,comm);
     }
     if(bound->hasSeg>0){
@@ -5002,10 +5530,10 @@ int getICtime(propT *prop, int Nt, int myproc){
    int retval, varid;
    int ncid = prop->initialNCfileID;
    //REAL time[Nt]; 
-   REAL *ictime;
+   DREAL *ictime;
    char *vname;
 
-   ictime = (REAL *)SunMalloc(Nt*sizeof(REAL),"getICtime");
+   ictime = (DREAL *)SunMalloc(Nt*sizeof(DREAL),"getICtime");
 
    vname = "time";
     if(VERBOSE>2 && myproc==0) printf("Reading initial condition %s...",vname);
@@ -5039,7 +5567,7 @@ void ReturnFreeSurfaceNC(propT *prop, physT *phys, gridT *grid, REAL *htmp, int
    //nc_read_2D(prop->initialNCfileID, "eta", start, count, htmp , myproc);
     if ((retval = nc_inq_varid(ncid, "eta", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &htmp[0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5070,7 +5598,7 @@ void ReturnSalinityNC(propT *prop, physT *phys, gridT *grid, REAL *htmp, int Nci
    if(VERBOSE>1 && myproc==0) printf("Reading salinity initial condition from netcdf file...\n");
     if ((retval = nc_inq_varid(ncid, "salt", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &htmp[0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5102,7 +5630,7 @@ void ReturnTemperatureNC(propT *prop, physT *phys, gridT *grid, REAL *htmp, int
    if(VERBOSE>1 && myproc==0) printf("Reading temperature initial condition from netcdf file...\n");
     if ((retval = nc_inq_varid(ncid, "temp", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &htmp[0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5133,7 +5661,7 @@ void ReturnAgeNC(propT *prop, gridT *grid, REAL *htmp, int Nci, int Nki, int T0,
    if(VERBOSE>1 && myproc==0) printf("Reading agec initial condition from netcdf file...\n");
     if ((retval = nc_inq_varid(ncid, "agec", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &htmp[0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5147,7 +5675,7 @@ void ReturnAgeNC(propT *prop, gridT *grid, REAL *htmp, int Nci, int Nki, int T0,
    if(VERBOSE>1 && myproc==0) printf("Reading agealpha initial condition from netcdf file...\n");
     if ((retval = nc_inq_varid(ncid, "agealpha", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncid, varid, start, count, &htmp[0]))) 
+    if ((retval = nc_get_vara_real(ncid, varid, start, count, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5161,7 +5689,7 @@ void ReturnAgeNC(propT *prop, gridT *grid, REAL *htmp, int Nci, int Nki, int T0,
    if(VERBOSE>1 && myproc==0) printf("Reading agesource term from netcdf file...\n");
     if ((retval = nc_inq_varid(ncid, "agesource", &varid)))
 	ERR(retval);
-    if ((retval = nc_get_var_double(ncid, varid, &htmp[0]))) 
+    if ((retval = nc_get_var_real(ncid, varid, &htmp[0]))) 
 	ERR(retval); 
 
    for(i=0;i<grid->Nc;i++) {
@@ -5180,7 +5708,7 @@ void ReturnAgeNC(propT *prop, gridT *grid, REAL *htmp, int Nci, int Nki, int T0,
 * ------------------
 * Retuns the index of the first preceding time step in the vector time
 */
-int getTimeRecBnd(REAL nctime, REAL *time, int nt){
+int getTimeRecBnd(DREAL nctime, DREAL *time, int nt){
     int j;
 
     for(j=0;j<nt;j++){
@@ -22,22 +22,35 @@
 #include "boundaries.h"
 #include "averages.h"
 #include "age.h"
+#include "outputplan.h"
+#include "analysis.h"
+#include "field.h"
 
 /* Netcdf error */
 #define ERRCODE 2
 #define ERR(e) {printf("Error: %s\n", nc_strerror(e)); MPI_Finalize(); exit(ERRCODE);}
+
+/* Target size of the chunks of the station and sub-domain files */
+#define NCSETCHUNKBYTES 1048576
   
 /* Public functions */
-int getTimeRec(REAL nctime, REAL *time, int nt);
+int getTimeRec(DREAL nctime, DREAL *time, int nt);
 size_t returndimlen(int ncid, char *dimname);
 
 void InitialiseOutputNC(propT *prop, gridT *grid, physT *phys, metT *met, int myproc);
 void InitialiseOutputNCugrid(propT *prop, gridT *grid, physT *phys, metT *met, int myproc);
 void WriteOutputNC(propT *prop, gridT *grid, physT *phys, metT *met,int blowup, int myproc);
 void WriteOutputNCmerge(propT *prop, gridT *grid, physT *phys, metT *met, int blowup, int numprocs, int myproc, MPI_Comm comm);
+void InitialiseOutputSetNC(propT *prop, gridT *grid, outsetT *set, int myproc);
+void WriteOutputSetNC(propT *prop, outsetT *set, int myproc);
+void InitialiseAnalysisNC(propT *prop, gridT *grid, analysisT *an, int numprocs, MPI_Comm comm, int myproc);
+void WriteAnalysisFieldNC(propT *prop, gridT *grid, analysisT *an, int o, int numprocs, MPI_Comm comm, int myproc);
+void WriteAnalysisTimeNC(propT *prop, analysisT *an, int myproc);
 void InitialiseAverageNCugrid(propT *prop, gridT *grid, averageT *average, int myproc);
 void WriteAverageNC(propT *prop, gridT *grid, averageT *average, physT *phys, metT *met, int blowup, MPI_Comm comm, int myproc);
 void WriteAverageNCmerge(propT *prop, gridT *grid, averageT *average, physT *phys, metT *met, int blowup, int numprocs, MPI_Comm comm, int myproc);
+void ReadFieldNC(fieldT *field, REAL *extent, int myproc);
+void ReadMetNCgrid(propT *prop, metinT *metin, int myproc);
 void ReadMetNCcoord(propT *prop, gridT *grid, metinT *metin,int myproc);
 void ReadMetNC(propT *prop, gridT *grid, metinT *metin,int myproc);
 
@@ -45,7 +58,7 @@ void ReadBndNCcoord(int ncid, propT *prop, gridT *grid, int myproc, MPI_Comm com
 void ReadBdyNC(propT *prop, gridT *grid, int myproc, MPI_Comm comm);
 //void UpdateBdyNC(propT *prop, gridT *grid, int myproc,MPI_Comm comm);
 size_t returndimlenBC(int ncid, char *dimname);
-int getTimeRecBnd(REAL nctime, REAL *time, int nt);
+int getTimeRecBnd(DREAL nctime, DREAL *time, int nt);
 void ReadInitialNCcoord(propT *prop, gridT *grid, int *Nci, int *Nki, int *T0, int myproc);
 int getICtime(propT *prop, int Nt, int myproc);
 void ReturnFreeSurfaceNC(propT *prop, physT *phys, gridT *grid, REAL *htmp, int Nci, int T0, int myproc);
@@ -62,11 +62,20 @@ int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_
 
 int MPI_Reduce (void *sendbuf, void *recvbuf, int count, 
 		MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm ) {
-  memcpy(recvbuf,sendbuf,datatype);
+  memcpy(recvbuf,sendbuf,count*datatype);
 
   return 0;
 }
 
+int MPI_Iallreduce (void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		    MPI_Op op, MPI_Comm comm, MPI_Request *request) {
+  memcpy(recvbuf,sendbuf,count*datatype);
+
+  return 0;
+}
+
+int MPI_Wait(MPI_Request *request, MPI_Status *status) { return 0; }
+
 int MPI_Gather (void *sendbuf, int sendcnt, MPI_Datatype sendtype, 
 		void *recvbuf, int recvcount, MPI_Datatype recvtype, 
 		int root, MPI_Comm comm ) {
@@ -75,6 +84,29 @@ int MPI_Gather (void *sendbuf, int sendcnt, MPI_Datatype sendtype,
   return 0;
 }
 
+int MPI_Allreduce (void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		   MPI_Op op, MPI_Comm comm) {
+  if(sendbuf!=MPI_IN_PLACE)
+    memcpy(recvbuf,sendbuf,count*datatype);
+
+  return 0;
+}
+
+int MPI_Alltoall (void *sendbuf, int sendcount, MPI_Datatype sendtype, 
+		  void *recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm) {
+  memcpy(recvbuf,sendbuf,sendcount*sendtype);
+
+  return 0;
+}
+
+int MPI_Alltoallv (void *sendbuf, int *sendcounts, int *sdispls, MPI_Datatype sendtype, 
+		   void *recvbuf, int *recvcounts, int *rdispls, MPI_Datatype recvtype, 
+		   MPI_Comm comm) {
+  memcpy((char *)recvbuf+rdispls[0]*recvtype,(char *)sendbuf+sdispls[0]*sendtype,sendcounts[0]*sendtype);
+
+  return 0;
+}
+
 double MPI_Wtime(void) {
   struct timeval timeval_time;
   gettimeofday(&timeval_time,NULL);
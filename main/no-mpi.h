@@ -13,6 +13,7 @@
 #define _mpi_h
 
 #define MPI_DOUBLE 8
+#define MPI_FLOAT 4
 #define MPI_INT 4
 #define MPI_COMM_WORLD 0
 #define MPI_SUM 3
@@ -47,9 +48,19 @@ int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
 int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]);
 int MPI_Reduce (void *sendbuf, void *recvbuf, int count, 
 		MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm );
+int MPI_Iallreduce (void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		    MPI_Op op, MPI_Comm comm, MPI_Request *request);
+int MPI_Wait(MPI_Request *request, MPI_Status *status);
 int MPI_Gather (void *sendbuf, int sendcnt, MPI_Datatype sendtype, 
 		void *recvbuf, int recvcount, MPI_Datatype recvtype, 
 		int root, MPI_Comm comm );
+int MPI_Allreduce (void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		   MPI_Op op, MPI_Comm comm);
+int MPI_Alltoall (void *sendbuf, int sendcount, MPI_Datatype sendtype, 
+		  void *recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm);
+int MPI_Alltoallv (void *sendbuf, int *sendcounts, int *sdispls, MPI_Datatype sendtype, 
+		   void *recvbuf, int *recvcounts, int *rdispls, MPI_Datatype recvtype, 
+		   MPI_Comm comm);
 double MPI_Wtime(void);
 
 #endif
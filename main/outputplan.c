@@ -0,0 +1,822 @@
+/*
+ * File: outputplan.c
+ * ------------------
+ * Selects what is output and where so that only the data that is analysed
+ * is written:
+ *
+ * ntout_<variable>     output interval of one netcdf or binary output field, i.e.
+ *                      ntout_salt 100 writes salinity every 100 steps and ntout_nu_v 0
+ *                      never writes the eddy viscosity.  The default is ntout.  A
+ *                      netcdf record is written when any field is due, and fields that
+ *                      are not due hold fill values in that record.
+ * ntoutStations        steps between station/transect output (0 - off).  Stations are
+ *                      read from StationFile (x y on each line) and transects from
+ *                      TransectFile (x0 y0 x1 y1 n on each line, n points from (x0,y0)
+ *                      to (x1,y1)).  StationVariables is a comma separated list of
+ *                      the variables written to StationNetcdfFile.
+ * ntoutSubdomain       steps between sub-domain output (0 - off).  The sub-domain holds
+ *                      the cells whose Voronoi points are inside the polygon in
+ *                      SubdomainPolygon (x y on each line) or, if it is not given, inside
+ *                      the box subxmin<=x<=subxmax, subymin<=y<=subymax.
+ *                      SubdomainVariables is written to SubdomainNetcdfFile.
+ * outputkmin           Layers outputkmin to outputkmax-1 are written to the station
+ * outputkmax           and sub-domain files (outputkmax=0 writes down to the bottom).
+ *
+ * The variables of the station and sub-domain files are
+ *   eta, uc, vc, w (at the cell centers), salt, temp, rho, q, nu_v, kappa_tv
+ *
+ * Here is an example of entries in suntans.dat:
+ *
+ * ntout_nu_v		0		# Never output the eddy viscosity
+ * ntoutStations	1		# Output station data every step
+ * StationFile		stations.dat	# x-y locations of the stations
+ * StationVariables	eta,uc,vc	# Variables at the stations
+ * ntoutSubdomain	10		# Output the sub-domain every 10 steps
+ * SubdomainPolygon	bay.dat		# Polygon of the sub-domain
+ * outputkmax		5		# Only the top 5 layers at the stations and in the sub-domain
+ *
+ * Stations are located with a k-d tree of the cell centers (see kdtree.c), and
+ * the station and sub-domain data is gathered onto processor 0 and written to a
+ * single netcdf file (see InitialiseOutputSetNC in mynetcdf.c).
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "memory.h"
+#include "util.h"
+#include "fileio.h"
+#include "mympi.h"
+#include "kdtree.h"
+#include "outputplan.h"
+#include "mynetcdf.h"
+#include "timestep.h"
+
+// Fields that can be written to the station and sub-domain files
+enum {
+  PLANETA, PLANUC, PLANVC, PLANW, PLANSALT, PLANTEMP, PLANRHO, PLANQ, PLANNUV, PLANKAPPA, NUMPLANFIELDS
+};
+static char *planfields[NUMPLANFIELDS] = {
+  "eta", "uc", "vc", "w", "salt", "temp", "rho", "q", "nu_v", "kappa_tv"
+};
+
+// Output intervals read from suntans.dat by OutputDue
+static int numintervals = 0;
+static char intervalnames[MAXPLANINTERVALS][BUFFERLENGTH];
+static int intervals[MAXPLANINTERVALS];
+
+static outsetT *stations = NULL, *subdomain = NULL;
+
+static int OutputInterval(propT *prop, char *vname);
+static outsetT *NewOutputSet(char *name, char *dimname, int ntout, gridT *grid, char *varkey, char *defaultvars,
+			     char *filekey, char *defaultfile, int myproc);
+static outsetT *InitializeStations(gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc);
+static outsetT *InitializeSubdomain(gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc);
+static void GatherOutputSetInfo(outsetT *set, gridT *grid, MPI_Comm comm, int numprocs, int myproc);
+static void WriteOutputSet(outsetT *set, gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numprocs, int myproc);
+static void UnpackOutputSet(outsetT *set, REAL *buf, int Nlocal, int *order);
+static void RepartitionOutputSet(outsetT *set, gridT *oldgrid, gridT *grid, int Nc, MPI_Comm comm, int numprocs,
+				 int myproc);
+static void FreeOutputSetInfo(outsetT *set, int numprocs, int myproc);
+static void FreeOutputSet(outsetT *set, int numprocs, int myproc);
+static DREAL *ReadPoints(char *file, int *N, int myproc);
+
+/*
+ * Function: OutputDue
+ * Usage: if(OutputDue(prop,"salt",blowup)) {...}
+ * ----------------------------------------------
+ * Returns 1 if the output field vname is written at the current step, i.e.
+ * every ntout_<vname> steps (default ntout), at the first step and at blowup,
+ * unless ntout_<vname> is 0.
+ *
+ */
+int OutputDue(propT *prop, char *vname, int blowup) {
+  int interval = OutputInterval(prop,vname);
+
+  return interval>0 && (blowup || prop->n==1+prop->nstart || IntervalDue(prop,interval));
+}
+
+/*
+ * Function: OutputRecordDue
+ * Usage: if(OutputRecordDue(prop,blowup)) {...}
+ * ---------------------------------------------
+ * Returns 1 if any output field is written at the current step.  The
+ * intervals are known after the first step, at which every field is due.
+ *
+ */
+int OutputRecordDue(propT *prop, int blowup) {
+  int i;
+
+  if(blowup || prop->n==1+prop->nstart || IntervalDue(prop,prop->ntout))
+    return 1;
+  for(i=0;i<numintervals;i++)
+    if(IntervalDue(prop,intervals[i]))
+      return 1;
+  return 0;
+}
+
+/*
+ * Function: OutputInterval
+ * Usage: interval = OutputInterval(prop,"salt");
+ * ----------------------------------------------
+ * Returns ntout_<vname> from suntans.dat or ntout if it is not given.  The
+ * values are cached since suntans.dat is otherwise read at every output step.
+ *
+ */
+static int OutputInterval(propT *prop, char *vname) {
+  int i, status;
+  char str[BUFFERLENGTH];
+  REAL val;
+
+  for(i=0;i<numintervals;i++)
+    if(!strcmp(intervalnames[i],vname))
+      return intervals[i];
+
+  snprintf(str,BUFFERLENGTH,"ntout_%s",vname);
+  val = GetValue(DATAFILE,str,&status);
+  if(!status)
+    val = prop->ntout;
+
+  if(numintervals<MAXPLANINTERVALS) {
+    strcpy(intervalnames[numintervals],vname);
+    intervals[numintervals++]=(int)val;
+  }
+  return (int)val;
+}
+
+/*
+ * Function: OutputPlan
+ * Usage: OutputPlan(grid,phys,prop,comm,numprocs,myproc);
+ * -------------------------------------------------------
+ * Sets up the station and sub-domain output at the first step, writes it
+ * every ntoutStations and ntoutSubdomain steps and closes the files at the
+ * last step.
+ *
+ */
+void OutputPlan(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numprocs, int myproc) {
+  int first = (prop->n==1+prop->nstart);
+
+  if(first) {
+    stations = InitializeStations(grid,prop,comm,numprocs,myproc);
+    subdomain = InitializeSubdomain(grid,prop,comm,numprocs,myproc);
+  }
+
+  if(stations && (first || IntervalDue(prop,stations->ntout)))
+    WriteOutputSet(stations,grid,phys,prop,comm,numprocs,myproc);
+  if(subdomain && (first || IntervalDue(prop,subdomain->ntout)))
+    WriteOutputSet(subdomain,grid,phys,prop,comm,numprocs,myproc);
+
+  if(prop->n==prop->nstart+prop->nsteps) {
+    FreeOutputSet(stations,numprocs,myproc);
+    FreeOutputSet(subdomain,numprocs,myproc);
+    stations = subdomain = NULL;
+  }
+}
+
+/*
+ * Function: NewOutputSet
+ * Usage: set = NewOutputSet("station","Nstation",ntout,grid,"StationVariables",...);
+ * -----------------------------------------------------------------------------------
+ * Allocates an output set and reads its variables, output file and layers.
+ *
+ */
+static outsetT *NewOutputSet(char *name, char *dimname, int ntout, gridT *grid, char *varkey, char *defaultvars,
+			     char *filekey, char *defaultfile, int myproc) {
+  int n, status;
+  char str[BUFFERLENGTH], *tok;
+  outsetT *set;
+
+#ifdef NONETCDF
+  if(myproc==0) printf("Error: NetCDF Libraries required. Set ntoutStations = 0 and ntoutSubdomain = 0\n");
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+#endif
+
+  set = (outsetT *)SunMalloc(sizeof(outsetT),"NewOutputSet");
+  strcpy(set->name,name);
+  strcpy(set->dimname,dimname);
+  set->ntout = ntout;
+
+  GetString(str,DATAFILE,filekey,&status);
+  if(status)
+    MPI_GetFile(set->file,DATAFILE,filekey,"NewOutputSet",myproc);
+  else if(snprintf(set->file,BUFFERLENGTH,"%s/%s",DATADIR,defaultfile)>=BUFFERLENGTH) {
+    if(myproc==0) printf("Error in NewOutputSet: the path of %s is longer than %d characters.\n",defaultfile,BUFFERLENGTH-1);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  set->kmin = (int)MPI_GetValue(DATAFILE,"outputkmin","NewOutputSet",myproc);
+  set->kmax = (int)MPI_GetValue(DATAFILE,"outputkmax","NewOutputSet",myproc);
+  if(set->kmin<0)
+    set->kmin=0;
+  if(set->kmax<=0 || set->kmax>grid->Nkmax)
+    set->kmax=grid->Nkmax;
+  if(set->kmin>=set->kmax) {
+    if(myproc==0) printf("Error in NewOutputSet: outputkmin=%d must be less than outputkmax=%d.\n",
+			 set->kmin,set->kmax);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  set->Nk = set->kmax-set->kmin;
+
+  GetString(str,DATAFILE,varkey,&status);
+  if(!status)
+    strcpy(str,defaultvars);
+  set->Nvars=0;
+  set->recordsize=0;
+  for(tok=strtok(str,",");tok!=NULL;tok=strtok(NULL,",")) {
+    n=OutputPlanField(tok);
+    if(n<0 || set->Nvars==MAXPLANVARIABLES) {
+      if(myproc==0) printf("Error in NewOutputSet: cannot output %s in %s (see outputplan.c).\n",tok,varkey);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    strcpy(set->vars[set->Nvars],tok);
+    set->field[set->Nvars]=n;
+    set->is3d[set->Nvars]=OutputPlanIs3D(n);
+    set->recordsize+=(set->is3d[set->Nvars] ? set->Nk : 1);
+    set->Nvars++;
+  }
+
+  set->N=0;
+  set->Nlocal=0;
+  set->Nalloc=0;
+  set->Nmax=0;
+  set->cell=NULL;
+  set->order=NULL;
+  set->send=NULL;
+  set->Nproc=NULL;
+  set->orderproc=NULL;
+  set->recv=set->data=NULL;
+  set->x=set->y=set->xv=set->yv=NULL;
+  set->dv=NULL;
+  set->cellid=set->transect=NULL;
+  set->ncid=-1;
+  set->nctimectr=0;
+
+  return set;
+}
+
+/*
+ * Function: InitializeStations
+ * Usage: stations = InitializeStations(grid,prop,comm,numprocs,myproc);
+ * ---------------------------------------------------------------------
+ * Reads the stations and transects, locates the cell containing each of them
+ * and returns the output set, or NULL if ntoutStations is 0.  A point on the
+ * boundary of two processors belongs to the lower processor, and points that
+ * are not in the domain are written as fill values.
+ *
+ */
+static outsetT *InitializeStations(gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc) {
+  int j, n, m, Nstation, Ntransect, Npoints, status, *owner, *found, missing;
+  DREAL *xy=NULL, *line=NULL;
+  REAL r;
+  char str[BUFFERLENGTH], filename[BUFFERLENGTH];
+  kdtreeT *tree;
+  outsetT *set;
+  int ntout = (int)MPI_GetValue(DATAFILE,"ntoutStations","InitializeStations",myproc);
+
+  if(ntout<=0)
+    return NULL;
+  set = NewOutputSet("station","Nstation",ntout,grid,"StationVariables",DEFAULTSTATIONVARIABLES,
+		     "StationNetcdfFile",DEFAULTSTATIONNETCDFFILE,myproc);
+
+  // Stations and transects (x0 y0 x1 y1 n on each line)
+  Nstation=Ntransect=Npoints=0;
+  GetString(str,DATAFILE,"StationFile",&status);
+  if(status) {
+    MPI_GetFile(filename,DATAFILE,"StationFile","InitializeStations",myproc);
+    xy = ReadPoints(filename,&Nstation,myproc);
+  }
+  GetString(str,DATAFILE,"TransectFile",&status);
+  if(status) {
+    MPI_GetFile(filename,DATAFILE,"TransectFile","InitializeStations",myproc);
+    line = ReadPoints(filename,&Ntransect,myproc);
+    for(n=0;n<Ntransect;n++)
+      Npoints+=(int)line[5*n+4];
+  }
+  set->N = Nstation+Npoints;
+  if(set->N==0) {
+    if(myproc==0) printf("Error in InitializeStations: ntoutStations>0 requires StationFile or TransectFile.\n");
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  set->x = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"InitializeStations");
+  set->y = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"InitializeStations");
+  set->transect = (int *)SunMalloc(set->N*sizeof(int),"InitializeStations");
+  for(n=0;n<Nstation;n++) {
+    set->x[n]=xy[2*n];
+    set->y[n]=xy[2*n+1];
+    set->transect[n]=-1;
+  }
+  m=Nstation;
+  for(n=0;n<Ntransect;n++)
+    for(j=0;j<(int)line[5*n+4];j++) {
+      r = ((int)line[5*n+4]>1 ? (REAL)j/((int)line[5*n+4]-1) : 0);
+      set->x[m]=line[5*n]+r*(line[5*n+2]-line[5*n]);
+      set->y[m]=line[5*n+1]+r*(line[5*n+3]-line[5*n+1]);
+      set->transect[m++]=n;
+    }
+  if(xy) SunFree(xy,2*Nstation*sizeof(DREAL),"InitializeStations");
+  if(line) SunFree(line,5*Ntransect*sizeof(DREAL),"InitializeStations");
+
+  // Locate the points in the computational cells of each processor
+  tree = KDTreeBuildCells(grid);
+  owner = (int *)SunMalloc(set->N*sizeof(int),"InitializeStations");
+  found = (int *)SunMalloc(set->N*sizeof(int),"InitializeStations");
+  set->Nalloc = set->N;
+  set->cell = (int *)SunMalloc(set->Nalloc*sizeof(int),"InitializeStations");
+  for(n=0;n<set->N;n++) {
+    set->cell[n] = KDTreeLocateCell(tree,grid,set->x[n],set->y[n]);
+    found[n] = (set->cell[n]==-1 ? numprocs : myproc);
+  }
+  KDTreeFree(tree);
+  MPI_Reduce(found,owner,set->N,MPI_INT,MPI_MIN,0,comm);
+  MPI_Bcast(owner,set->N,MPI_INT,0,comm);
+
+  set->order = (int *)SunMalloc(set->Nalloc*sizeof(int),"InitializeStations");
+  missing=0;
+  for(n=0;n<set->N;n++) {
+    if(owner[n]==myproc) {
+      set->cell[set->Nlocal]=set->cell[n];
+      set->order[set->Nlocal++]=n;
+    }
+    if(owner[n]==numprocs)
+      missing++;
+  }
+  if(myproc==0 && VERBOSE>0 && missing)
+    printf("Warning in InitializeStations: %d of %d station(s) are not within the computational domain.\n",
+	   missing,set->N);
+  SunFree(owner,set->N*sizeof(int),"InitializeStations");
+  SunFree(found,set->N*sizeof(int),"InitializeStations");
+
+  GatherOutputSetInfo(set,grid,comm,numprocs,myproc);
+  if(myproc==0)
+    InitialiseOutputSetNC(prop,grid,set,myproc);
+  else {
+    SunFree(set->x,set->N*sizeof(DREAL),"InitializeStations");
+    SunFree(set->y,set->N*sizeof(DREAL),"InitializeStations");
+    SunFree(set->transect,set->N*sizeof(int),"InitializeStations");
+    set->x=set->y=NULL;
+    set->transect=NULL;
+  }
+
+  return set;
+}
+
+/*
+ * Function: InitializeSubdomain
+ * Usage: subdomain = InitializeSubdomain(grid,prop,comm,numprocs,myproc);
+ * -----------------------------------------------------------------------
+ * Selects the computational cells inside the sub-domain polygon or box and
+ * returns the output set, or NULL if ntoutSubdomain is 0.  The cells are
+ * written in the order of the processors.
+ *
+ */
+static outsetT *InitializeSubdomain(gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc) {
+  int i, iptr, n, Npoly, status, inside, offset, proc, *Nall;
+  DREAL *poly=NULL;
+  REAL *xg, *yg, xmin=INFTY, xmax=-INFTY, ymin=INFTY, ymax=-INFTY;
+  char str[BUFFERLENGTH], filename[BUFFERLENGTH];
+  outsetT *set;
+  int ntout = (int)MPI_GetValue(DATAFILE,"ntoutSubdomain","InitializeSubdomain",myproc);
+
+  if(ntout<=0)
+    return NULL;
+  set = NewOutputSet("subdomain","Nc",ntout,grid,"SubdomainVariables",DEFAULTSUBDOMAINVARIABLES,
+		     "SubdomainNetcdfFile",DEFAULTSUBDOMAINNETCDFFILE,myproc);
+
+  Npoly=0;
+  GetString(str,DATAFILE,"SubdomainPolygon",&status);
+  if(status) {
+    MPI_GetFile(filename,DATAFILE,"SubdomainPolygon","InitializeSubdomain",myproc);
+    poly = ReadPoints(filename,&Npoly,myproc);
+  } else {
+    xmin = MPI_GetValue(DATAFILE,"subxmin","InitializeSubdomain",myproc);
+    xmax = MPI_GetValue(DATAFILE,"subxmax","InitializeSubdomain",myproc);
+    ymin = MPI_GetValue(DATAFILE,"subymin","InitializeSubdomain",myproc);
+    ymax = MPI_GetValue(DATAFILE,"subymax","InitializeSubdomain",myproc);
+  }
+  xg = (REAL *)SunMalloc((Npoly+1)*sizeof(REAL),"InitializeSubdomain");
+  yg = (REAL *)SunMalloc((Npoly+1)*sizeof(REAL),"InitializeSubdomain");
+  for(n=0;n<Npoly;n++) {
+    xg[n]=poly[2*n];
+    yg[n]=poly[2*n+1];
+  }
+
+  set->Nalloc = grid->celldist[2]-grid->celldist[0]+1;
+  set->cell = (int *)SunMalloc(set->Nalloc*sizeof(int),"InitializeSubdomain");
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+    i = grid->cellp[iptr];
+    if(Npoly>0)
+      inside = InPolygon(grid->xv[i],grid->yv[i],xg,yg,Npoly);
+    else
+      inside = (grid->xv[i]>=xmin && grid->xv[i]<=xmax && grid->yv[i]>=ymin && grid->yv[i]<=ymax);
+    if(inside)
+      set->cell[set->Nlocal++]=i;
+  }
+  if(poly) SunFree(poly,2*Npoly*sizeof(DREAL),"InitializeSubdomain");
+  SunFree(xg,(Npoly+1)*sizeof(REAL),"InitializeSubdomain");
+  SunFree(yg,(Npoly+1)*sizeof(REAL),"InitializeSubdomain");
+
+  // The cells of processor p follow those of processors 0..p-1
+  Nall = (int *)SunMalloc(numprocs*sizeof(int),"InitializeSubdomain");
+  if(myproc!=0)
+    MPI_Send(&(set->Nlocal),1,MPI_INT,0,1,comm);
+  else {
+    Nall[0]=set->Nlocal;
+    for(proc=1;proc<numprocs;proc++)
+      MPI_Recv(&(Nall[proc]),1,MPI_INT,proc,1,comm,MPI_STATUS_IGNORE);
+  }
+  MPI_Bcast(Nall,numprocs,MPI_INT,0,comm);
+  offset=0;
+  for(proc=0;proc<numprocs;proc++) {
+    if(proc==myproc)
+      offset=set->N;
+    set->N+=Nall[proc];
+  }
+  SunFree(Nall,numprocs*sizeof(int),"InitializeSubdomain");
+
+  if(set->N==0) {
+    if(myproc==0) printf("Error in InitializeSubdomain: there are no cells in the sub-domain.\n");
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  set->order = (int *)SunMalloc(set->Nalloc*sizeof(int),"InitializeSubdomain");
+  for(n=0;n<set->Nlocal;n++)
+    set->order[n]=offset+n;
+
+  GatherOutputSetInfo(set,grid,comm,numprocs,myproc);
+  if(myproc==0) {
+    set->x = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"InitializeSubdomain");
+    set->y = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"InitializeSubdomain");
+    for(n=0;n<set->N;n++) {
+      set->x[n]=set->xv[n];
+      set->y[n]=set->yv[n];
+    }
+    InitialiseOutputSetNC(prop,grid,set,myproc);
+  }
+
+  return set;
+}
+
+/*
+ * Function: GatherOutputSetInfo
+ * Usage: GatherOutputSetInfo(set,grid,comm,numprocs,myproc);
+ * ----------------------------------------------------------
+ * Sends the number of points on each processor, their output positions,
+ * global cell indices, Voronoi points and depths to processor 0 and
+ * allocates the buffers used at every output step.
+ *
+ */
+static void GatherOutputSetInfo(outsetT *set, gridT *grid, MPI_Comm comm, int numprocs, int myproc) {
+  int n, p, proc, ninfo;
+  DREAL *info;
+
+  set->send = (REAL *)SunMalloc((set->Nlocal*set->recordsize+1)*sizeof(REAL),"GatherOutputSetInfo");
+
+  ninfo = set->Nlocal;
+  info = (DREAL *)SunMalloc((4*ninfo+1)*sizeof(DREAL),"GatherOutputSetInfo");
+  for(n=0;n<set->Nlocal;n++) {
+    info[4*n]=grid->mnptr[set->cell[n]];
+    info[4*n+1]=grid->xv[set->cell[n]];
+    info[4*n+2]=grid->yv[set->cell[n]];
+    info[4*n+3]=grid->dv[set->cell[n]];
+  }
+
+  if(myproc!=0) {
+    MPI_Send(&(set->Nlocal),1,MPI_INT,0,1,comm);
+    if(set->Nlocal>0) {
+      MPI_Send(set->order,set->Nlocal,MPI_INT,0,1,comm);
+      MPI_Send(info,4*set->Nlocal,MPI_DOUBLE,0,1,comm);
+    }
+  } else {
+    set->Nproc = (int *)SunMalloc(numprocs*sizeof(int),"GatherOutputSetInfo");
+    set->orderproc = (int **)SunMalloc(numprocs*sizeof(int *),"GatherOutputSetInfo");
+    set->cellid = (int *)SunMalloc(set->N*sizeof(int),"GatherOutputSetInfo");
+    set->xv = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"GatherOutputSetInfo");
+    set->yv = (DREAL *)SunMalloc(set->N*sizeof(DREAL),"GatherOutputSetInfo");
+    set->dv = (REAL *)SunMalloc(set->N*sizeof(REAL),"GatherOutputSetInfo");
+    for(n=0;n<set->N;n++) {
+      set->cellid[n]=-1;
+      set->xv[n]=set->yv[n]=set->dv[n]=(REAL)EMPTY;
+    }
+
+    set->Nmax=0;
+    for(proc=0;proc<numprocs;proc++) {
+      if(proc==0)
+	set->Nproc[proc]=set->Nlocal;
+      else
+	MPI_Recv(&(set->Nproc[proc]),1,MPI_INT,proc,1,comm,MPI_STATUS_IGNORE);
+      set->orderproc[proc] = (int *)SunMalloc((set->Nproc[proc]+1)*sizeof(int),"GatherOutputSetInfo");
+      if(set->Nproc[proc]>set->Nmax)
+	set->Nmax=set->Nproc[proc];
+      if(set->Nproc[proc]==0)
+	continue;
+
+      if(proc==0) {
+	for(n=0;n<set->Nlocal;n++)
+	  set->orderproc[0][n]=set->order[n];
+      } else {
+	SunFree(info,(4*ninfo+1)*sizeof(DREAL),"GatherOutputSetInfo");
+	ninfo = set->Nproc[proc];
+	info = (DREAL *)SunMalloc((4*ninfo+1)*sizeof(DREAL),"GatherOutputSetInfo");
+	MPI_Recv(set->orderproc[proc],set->Nproc[proc],MPI_INT,proc,1,comm,MPI_STATUS_IGNORE);
+	MPI_Recv(info,4*set->Nproc[proc],MPI_DOUBLE,proc,1,comm,MPI_STATUS_IGNORE);
+      }
+      for(n=0;n<set->Nproc[proc];n++) {
+	p = set->orderproc[proc][n];
+	set->cellid[p]=(int)info[4*n];
+	set->xv[p]=info[4*n+1];
+	set->yv[p]=info[4*n+2];
+	set->dv[p]=info[4*n+3];
+      }
+    }
+
+    set->recv = (REAL *)SunMalloc((set->Nmax*set->recordsize+1)*sizeof(REAL),"GatherOutputSetInfo");
+    set->data = (REAL *)SunMalloc(set->N*set->recordsize*sizeof(REAL),"GatherOutputSetInfo");
+  }
+  SunFree(info,(4*ninfo+1)*sizeof(DREAL),"GatherOutputSetInfo");
+}
+
+/*
+ * Function: WriteOutputSet
+ * Usage: WriteOutputSet(set,grid,phys,prop,comm,numprocs,myproc);
+ * ---------------------------------------------------------------
+ * Packs the values of the local points as [var][k][point], gathers them on
+ * processor 0 and writes one record to the netcdf file.
+ *
+ */
+static void WriteOutputSet(outsetT *set, gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numprocs, int myproc) {
+  int n, v, k, proc, off=0;
+
+  for(v=0;v<set->Nvars;v++) {
+    if(set->is3d[v]) {
+      for(k=set->kmin;k<set->kmax;k++)
+	for(n=0;n<set->Nlocal;n++)
+	  set->send[off+(k-set->kmin)*set->Nlocal+n]=OutputPlanValue(grid,phys,set->field[v],set->cell[n],k);
+      off+=set->Nk*set->Nlocal;
+    } else {
+      for(n=0;n<set->Nlocal;n++)
+	set->send[off+n]=OutputPlanValue(grid,phys,set->field[v],set->cell[n],0);
+      off+=set->Nlocal;
+    }
+  }
+
+  if(myproc!=0) {
+    if(set->Nlocal>0)
+      MPI_Send(set->send,set->Nlocal*set->recordsize,MPI_REALTYPE,0,1,comm);
+  } else {
+    for(n=0;n<set->N*set->recordsize;n++)
+      set->data[n]=(REAL)EMPTY;
+    UnpackOutputSet(set,set->send,set->Nproc[0],set->orderproc[0]);
+    for(proc=1;proc<numprocs;proc++) {
+      if(set->Nproc[proc]==0)
+	continue;
+      MPI_Recv(set->recv,set->Nproc[proc]*set->recordsize,MPI_REALTYPE,proc,1,comm,MPI_STATUS_IGNORE);
+      UnpackOutputSet(set,set->recv,set->Nproc[proc],set->orderproc[proc]);
+    }
+    WriteOutputSetNC(prop,set,myproc);
+  }
+}
+
+/*
+ * Function: UnpackOutputSet
+ * Usage: UnpackOutputSet(set,buf,Nlocal,order);
+ * ---------------------------------------------
+ * Places the values packed by WriteOutputSet on a processor with Nlocal
+ * points at their output positions in set->data.
+ *
+ */
+static void UnpackOutputSet(outsetT *set, REAL *buf, int Nlocal, int *order) {
+  int n, v, k, off=0, doff=0;
+
+  for(v=0;v<set->Nvars;v++) {
+    if(set->is3d[v]) {
+      for(k=0;k<set->Nk;k++)
+	for(n=0;n<Nlocal;n++)
+	  set->data[doff+k*set->N+order[n]]=buf[off+k*Nlocal+n];
+      off+=set->Nk*Nlocal;
+      doff+=set->Nk*set->N;
+    } else {
+      for(n=0;n<Nlocal;n++)
+	set->data[doff+order[n]]=buf[off+n];
+      off+=Nlocal;
+      doff+=set->N;
+    }
+  }
+}
+
+/*
+ * Function: OutputPlanField
+ * Usage: field = OutputPlanField("salt");
+ * ---------------------------------------
+ * Returns the field with the given name, or -1 if it cannot be output
+ * (see the list of variables above).
+ *
+ */
+int OutputPlanField(char *vname) {
+  int n;
+
+  for(n=0;n<NUMPLANFIELDS;n++)
+    if(!strcmp(vname,planfields[n]))
+      return n;
+  return -1;
+}
+
+/*
+ * Function: OutputPlanIs3D
+ * Usage: if(OutputPlanIs3D(field)) {...}
+ * --------------------------------------
+ * Returns 1 if the field has values in each layer, 0 for the free surface.
+ *
+ */
+int OutputPlanIs3D(int field) {
+  return field!=PLANETA;
+}
+
+/*
+ * Function: OutputPlanValue
+ * Usage: value = OutputPlanValue(grid,phys,field,i,k);
+ * ----------------------------------------------------
+ * Returns field in layer k of cell i, or EMPTY if the layer is dry or
+ * below the bottom.  The vertical velocity is averaged to the cell center.
+ *
+ */
+REAL OutputPlanValue(gridT *grid, physT *phys, int field, int i, int k) {
+  if(field==PLANETA)
+    return phys->h[i];
+  if(k<grid->ctop[i] || k>=grid->Nk[i])
+    return (REAL)EMPTY;
+
+  switch(field) {
+    case PLANUC:
+      return phys->uc[i][k];
+    case PLANVC:
+      return phys->vc[i][k];
+    case PLANW:
+      return 0.5*(phys->w[i][k]+phys->w[i][k+1]);
+    case PLANSALT:
+      return phys->s[i][k];
+    case PLANTEMP:
+      return phys->T[i][k];
+    case PLANRHO:
+      return phys->rho[i][k];
+    case PLANQ:
+      return phys->q[i][k];
+    case PLANNUV:
+      return phys->nu_tv[i][k];
+    case PLANKAPPA:
+      return phys->kappa_tv[i][k];
+    default:
+      return (REAL)EMPTY;
+  }
+}
+
+/*
+ * Function: ReadPoints
+ * Usage: xy = ReadPoints(filename,&N,myproc);
+ * -------------------------------------------
+ * Reads a file with the same number of columns on each line and returns
+ * its values row by row.  N is set to the number of lines.
+ *
+ */
+static DREAL *ReadPoints(char *file, int *N, int myproc) {
+  int n, ncols;
+  char str[BUFFERLENGTH], line[BUFFERLENGTH], *tok;
+  DREAL *xy;
+  FILE *ifile;
+
+  *N = MPI_GetSize(file,"ReadPoints",myproc);
+  ifile = MPI_FOpen(file,"r","ReadPoints",myproc);
+  ncols=0;
+  if(fgets(line,BUFFERLENGTH,ifile)!=NULL)
+    for(tok=strtok(line," \t\n");tok!=NULL;tok=strtok(NULL," \t\n"))
+      ncols++;
+  rewind(ifile);
+
+  xy = (DREAL *)SunMalloc((*N)*ncols*sizeof(DREAL),"ReadPoints");
+  for(n=0;n<(*N)*ncols;n++)
+    xy[n]=getfield(ifile,str);
+  fclose(ifile);
+
+  return xy;
+}
+
+/*
+ * Function: OutputPlanRepartition
+ * Usage: OutputPlanRepartition(oldgrid,grid,Nc,comm,numprocs,myproc);
+ * -------------------------------------------------------------------
+ * Moves the points of the station and sub-domain output from the cells of
+ * oldgrid to the cells of the repartitioned grid, which has Nc cells in the
+ * global grid (see Rebalance in rebalance.c).  The output files and the
+ * output positions of the points do not change.
+ *
+ */
+void OutputPlanRepartition(gridT *oldgrid, gridT *grid, int Nc, MPI_Comm comm, int numprocs, int myproc) {
+  if(stations)
+    RepartitionOutputSet(stations,oldgrid,grid,Nc,comm,numprocs,myproc);
+  if(subdomain)
+    RepartitionOutputSet(subdomain,oldgrid,grid,Nc,comm,numprocs,myproc);
+}
+
+/*
+ * Function: RepartitionOutputSet
+ * Usage: RepartitionOutputSet(set,oldgrid,grid,Nc,comm,numprocs,myproc);
+ * ----------------------------------------------------------------------
+ * Finds the global cell of each output position on oldgrid, assigns it to
+ * the processor that computes that cell on grid and gathers the new
+ * distribution of the points on processor 0.
+ *
+ */
+static void RepartitionOutputSet(outsetT *set, gridT *oldgrid, gridT *grid, int Nc, MPI_Comm comm, int numprocs,
+				 int myproc) {
+  int i, iptr, n, *gcell, *local;
+
+  gcell = (int *)SunMalloc(set->N*sizeof(int),"RepartitionOutputSet");
+  for(n=0;n<set->N;n++)
+    gcell[n]=-1;
+  for(n=0;n<set->Nlocal;n++)
+    gcell[set->order[n]]=oldgrid->mnptr[set->cell[n]];
+  MPI_Allreduce(MPI_IN_PLACE,gcell,set->N,MPI_INT,MPI_MAX,comm);
+
+  local = (int *)SunMalloc(Nc*sizeof(int),"RepartitionOutputSet");
+  for(i=0;i<Nc;i++)
+    local[i]=-1;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+    i = grid->cellp[iptr];
+    local[grid->mnptr[i]]=i;
+  }
+
+  FreeOutputSetInfo(set,numprocs,myproc);
+  SunFree(set->cell,set->Nalloc*sizeof(int),"RepartitionOutputSet");
+  SunFree(set->order,set->Nalloc*sizeof(int),"RepartitionOutputSet");
+  set->Nlocal=0;
+  for(n=0;n<set->N;n++)
+    if(gcell[n]!=-1 && local[gcell[n]]!=-1)
+      set->Nlocal++;
+  set->Nalloc = set->Nlocal+1;
+  set->cell = (int *)SunMalloc(set->Nalloc*sizeof(int),"RepartitionOutputSet");
+  set->order = (int *)SunMalloc(set->Nalloc*sizeof(int),"RepartitionOutputSet");
+  set->Nlocal=0;
+  for(n=0;n<set->N;n++)
+    if(gcell[n]!=-1 && local[gcell[n]]!=-1) {
+      set->cell[set->Nlocal]=local[gcell[n]];
+      set->order[set->Nlocal++]=n;
+    }
+  SunFree(gcell,set->N*sizeof(int),"RepartitionOutputSet");
+  SunFree(local,Nc*sizeof(int),"RepartitionOutputSet");
+
+  GatherOutputSetInfo(set,grid,comm,numprocs,myproc);
+}
+
+/*
+ * Function: FreeOutputSetInfo
+ * Usage: FreeOutputSetInfo(set,numprocs,myproc);
+ * ----------------------------------------------
+ * Frees the arrays allocated by GatherOutputSetInfo.
+ *
+ */
+static void FreeOutputSetInfo(outsetT *set, int numprocs, int myproc) {
+  int proc;
+
+  if(myproc==0) {
+    for(proc=0;proc<numprocs;proc++)
+      SunFree(set->orderproc[proc],(set->Nproc[proc]+1)*sizeof(int),"FreeOutputSetInfo");
+    SunFree(set->orderproc,numprocs*sizeof(int *),"FreeOutputSetInfo");
+    SunFree(set->Nproc,numprocs*sizeof(int),"FreeOutputSetInfo");
+    SunFree(set->recv,(set->Nmax*set->recordsize+1)*sizeof(REAL),"FreeOutputSetInfo");
+    SunFree(set->data,set->N*set->recordsize*sizeof(REAL),"FreeOutputSetInfo");
+    SunFree(set->xv,set->N*sizeof(DREAL),"FreeOutputSetInfo");
+    SunFree(set->yv,set->N*sizeof(DREAL),"FreeOutputSetInfo");
+    SunFree(set->dv,set->N*sizeof(REAL),"FreeOutputSetInfo");
+    SunFree(set->cellid,set->N*sizeof(int),"FreeOutputSetInfo");
+  }
+  SunFree(set->send,(set->Nlocal*set->recordsize+1)*sizeof(REAL),"FreeOutputSetInfo");
+}
+
+/*
+ * Function: FreeOutputSet
+ * Usage: FreeOutputSet(set,numprocs,myproc);
+ * ------------------------------------------
+ * Closes the netcdf file of the set and frees its arrays.
+ *
+ */
+static void FreeOutputSet(outsetT *set, int numprocs, int myproc) {
+  if(set==NULL)
+    return;
+
+  FreeOutputSetInfo(set,numprocs,myproc);
+  if(myproc==0) {
+    MPI_NCClose(set->ncid);
+    SunFree(set->x,set->N*sizeof(DREAL),"FreeOutputSet");
+    SunFree(set->y,set->N*sizeof(DREAL),"FreeOutputSet");
+    if(set->transect)
+      SunFree(set->transect,set->N*sizeof(int),"FreeOutputSet");
+  }
+  SunFree(set->cell,set->Nalloc*sizeof(int),"FreeOutputSet");
+  SunFree(set->order,set->Nalloc*sizeof(int),"FreeOutputSet");
+  SunFree(set,sizeof(outsetT),"FreeOutputSet");
+}
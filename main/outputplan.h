@@ -0,0 +1,70 @@
+/*
+ * File: outputplan.h
+ * ------------------
+ * Header file for outputplan.c, which selects what is output and where:
+ * per-variable output intervals, station/transect time series and a
+ * sub-domain extraction with a subset of the layers.
+ *
+ */
+#ifndef _outputplan_h
+#define _outputplan_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+
+#define MAXPLANVARIABLES 16
+#define MAXPLANINTERVALS 64
+#define DEFAULTSTATIONVARIABLES "eta,uc,vc,salt,temp"
+#define DEFAULTSUBDOMAINVARIABLES "eta,uc,vc,w,salt,temp"
+#define DEFAULTSTATIONNETCDFFILE "stations.nc"
+#define DEFAULTSUBDOMAINNETCDFFILE "subdomain.nc"
+
+/*
+ * A set of cells written to its own netcdf file by processor 0.  Each
+ * processor packs the values of its local cells, which are gathered and
+ * placed at their output positions on processor 0.
+ *
+ */
+typedef struct _outsetT {
+  char name[BUFFERLENGTH];   // "station" or "subdomain"
+  char file[BUFFERLENGTH];   // netcdf file written by processor 0
+  char dimname[BUFFERLENGTH];// name of the dimension of the points in the file
+  int ntout;                 // output interval in time steps
+  int kmin, kmax, Nk;        // layers kmin..kmax-1 are output (Nk=kmax-kmin)
+
+  int Nvars;
+  char vars[MAXPLANVARIABLES][BUFFERLENGTH];
+  int field[MAXPLANVARIABLES];   // fields in outputplan.c
+  int is3d[MAXPLANVARIABLES];
+  int recordsize;            // values per output point, summed over the variables
+
+  int N;                     // number of output points
+  int Nlocal;                // points on this processor
+  int Nalloc;                // allocated length of cell and order
+  int *cell;                 // local cell of each point on this processor [Nlocal]
+  int *order;                // output position of each point on this processor [Nlocal]
+  REAL *send;                // packed values on this processor [Nlocal*recordsize]
+
+  // Processor 0 only
+  int *Nproc, **orderproc;   // number and positions of the points on each processor
+  int Nmax;                  // maximum of Nproc
+  REAL *recv;                // values received from one processor
+  REAL *data;                // output values, [var][k][N] for each variable
+  DREAL *x, *y;              // requested point locations [N]
+  DREAL *xv, *yv;            // Voronoi points of the cells [N]
+  REAL *dv;                  // depths of the cells [N]
+  int *cellid;               // global index of the cells or -1 if not in the domain [N]
+  int *transect;             // transect of a station or -1 [N]
+  int ncid, nctimectr;
+} outsetT;
+
+int OutputDue(propT *prop, char *vname, int blowup);
+int OutputRecordDue(propT *prop, int blowup);
+void OutputPlan(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numprocs, int myproc);
+void OutputPlanRepartition(gridT *oldgrid, gridT *grid, int Nc, MPI_Comm comm, int numprocs, int myproc);
+int OutputPlanField(char *vname);
+int OutputPlanIs3D(int field);
+REAL OutputPlanValue(gridT *grid, physT *phys, int field, int i, int k);
+
+#endif
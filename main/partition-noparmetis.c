@@ -31,3 +31,18 @@ void GetPartitioning(gridT *maingrid, gridT **localgrid, int myproc, int numproc
     for(j=0;j<maingrid->Nc;j++)
       maingrid->part[j]=0;
 }
+
+/*
+ * Function: GetRepartitioning
+ * Usage: GetRepartitioning(grid,vwgt,part,Nc,myproc,numprocs,comm);
+ * -----------------------------------------------------------------
+ * This is a dummy function that is used when the parmetis libraries are not defined.
+ * All cells remain on the single processor.
+ *
+ */
+void GetRepartitioning(gridT *grid, int *vwgt, int *part, int Nc, int myproc, int numprocs, MPI_Comm comm) {
+  int j;
+
+  for(j=0;j<Nc;j++)
+    part[j]=0;
+}
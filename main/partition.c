@@ -12,14 +12,26 @@
 #include "partition.h"
 #include "memory.h"
 #include "grid.h"
+#include "util.h"
+#include "mympi.h"
+#include "sendrecv.h"
 
 //Parmetis 2.0
 #include "parmetis.h"
 //Parmetis 3.1
 //#include "parmetislib.h"
 
-// Private function
-static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm);
+// Private type
+typedef struct _cellkeyT {
+  REAL key;
+  int cell;
+} cellkeyT;
+
+// Private functions
+static void GetGraph(GraphType *graph, gridT *grid, int ncon, MPI_Comm comm);
+static void SplitNodes(gridT *grid, int nnodes, int procspernode);
+static void Bisect(gridT *grid, cellkeyT *keys, int N, int firstpart, int nparts);
+static int CompareKeys(const void *a, const void *b);
 
 /*
  * Function: GetPartitioning
@@ -28,9 +40,21 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm);
  * This function uses the ParMetis libraries to compute the grid partitioning and places
  * the partition number into the maingrid->part array.
  *
+ * With partitionconstraints=2 the cells are balanced with respect to both their cost
+ * (maingrid->vwgt) and their memory (maingrid->mwgt), which requires the multi-constraint
+ * partitioning of ParMETIS 3.  With procspernode>1 the partitioning has two levels: 
+ * ParMETIS partitions the grid into numprocs/procspernode nodes, which minimizes the 
+ * communication between the nodes, and then each node is split into procspernode 
+ * processors with SplitNodes.  Processors myproc=node*procspernode,...,
+ * (node+1)*procspernode-1 are on the same node, which is the default placement of 
+ * mpirun.
+ *
  */
 void GetPartitioning(gridT *maingrid, gridT **localgrid, int myproc, int numprocs, MPI_Comm comm) {
-  int j, proc, numflag=0, wgtflag=0, options[5], edgecut;
+  int j, proc, numflag=0, wgtflag=0, options[5], edgecut, ncon, nparts, procspernode;
+#if defined(PARMETIS_MAJOR_VERSION) && PARMETIS_MAJOR_VERSION>=3
+  float *tpwgts, ubvec[2];
+#endif
   GraphType graph;
   MPI_Status status;
 
@@ -38,18 +62,59 @@ void GetPartitioning(gridT *maingrid, gridT **localgrid, int myproc, int numproc
     options[0] = 0;
     wgtflag = 2;
     numflag = 0;
+
+    ncon=(int)MPI_GetValue(DATAFILE,"partitionconstraints","GetPartitioning",myproc);
+    procspernode=(int)MPI_GetValue(DATAFILE,"procspernode","GetPartitioning",myproc);
+    if(ncon!=1 && ncon!=2) {
+      if(myproc==0) printf("Error in GetPartitioning: partitionconstraints=%d must be 1 or 2.\n",ncon);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+#if !defined(PARMETIS_MAJOR_VERSION) || PARMETIS_MAJOR_VERSION<3
+    if(ncon>1) {
+      if(myproc==0) printf("Warning: partitionconstraints=%d requires ParMETIS 3.  Only balancing the cost.\n",ncon);
+      ncon=1;
+    }
+#endif
+
+    nparts=numprocs;
+    if(procspernode>1) {
+      if(numprocs%procspernode || numprocs==procspernode) {
+        if(myproc==0) printf("Warning: numprocs=%d is not a multiple of procspernode=%d nodes.  Using one-level partitioning.\n",
+            numprocs,procspernode);
+        procspernode=1;
+      } else
+        nparts=numprocs/procspernode;
+    }
     
-    GetGraph(&graph,maingrid,comm);
+    GetGraph(&graph,maingrid,ncon,comm);
     
     (*localgrid)->part = SunMalloc(graph.nvtxs*sizeof(int),"GetPartitioning");
     
     /*
      * Partition the graph and create the part array.
      */
-    if(myproc==0 && VERBOSE>2) printf("Partitioning with ParMETIS_PartKway...\n");
-    ParMETIS_PartKway(graph.vtxdist,graph.xadj,graph.adjncy,graph.vwgt,NULL,
-		      &wgtflag,&numflag,&numprocs,options,&edgecut,
-		      (*localgrid)->part,&comm);
+    if(ncon>1) {
+#if defined(PARMETIS_MAJOR_VERSION) && PARMETIS_MAJOR_VERSION>=3
+      tpwgts = (float *)SunMalloc(ncon*nparts*sizeof(float),"GetPartitioning");
+      for(j=0;j<ncon*nparts;j++)
+        tpwgts[j]=1.0/nparts;
+      for(j=0;j<ncon;j++)
+        ubvec[j]=1.05;
+
+      if(myproc==0 && VERBOSE>2) printf("Partitioning with ParMETIS_V3_PartKway with %d constraints...\n",ncon);
+      ParMETIS_V3_PartKway(graph.vtxdist,graph.xadj,graph.adjncy,graph.vwgt,NULL,
+          &wgtflag,&numflag,&ncon,&nparts,tpwgts,ubvec,options,&edgecut,
+          (*localgrid)->part,&comm);
+
+      SunFree(tpwgts,ncon*nparts*sizeof(float),"GetPartitioning");
+#endif
+    } else {
+      if(myproc==0 && VERBOSE>2) printf("Partitioning with ParMETIS_PartKway...\n");
+      ParMETIS_PartKway(graph.vtxdist,graph.xadj,graph.adjncy,graph.vwgt,NULL,
+          &wgtflag,&numflag,&nparts,options,&edgecut,
+          (*localgrid)->part,&comm);
+    }
     
     if(myproc==0 && VERBOSE>2) printf("Redistributing the partition arrays...\n");
     if(myproc!=0) 
@@ -64,21 +129,195 @@ void GetPartitioning(gridT *maingrid, gridT **localgrid, int myproc, int numproc
     MPI_Bcast((void *)maingrid->part,maingrid->Nc,MPI_INT,0,comm);
 
     SunFree((*localgrid)->part,graph.nvtxs*sizeof(int),"GetPartitioning");
+
+    if(procspernode>1) {
+      if(myproc==0 && VERBOSE>2) printf("Splitting %d nodes into %d processors each...\n",nparts,procspernode);
+      SplitNodes(maingrid,nparts,procspernode);
+    }
   } else {
     for(j=0;j<maingrid->Nc;j++)
       maingrid->part[j]=0;
   }
 }
 
+/*
+ * Function: GetRepartitioning
+ * Usage: GetRepartitioning(grid,vwgt,part,Nc,myproc,numprocs,comm);
+ * -----------------------------------------------------------------
+ * Compute a new partitioning of the current local grids for the cell weights
+ * vwgt[i] of the local cells i and place the processor of every cell of the 
+ * global grid (with Nc cells) into part, which is the same on all processors.
+ * The graph of the cells owned by each processor is built from the local grids,
+ * so the main grid is not needed.  With ParMETIS 3 the adaptive repartitioning
+ * balances the weights while moving as few cells as possible from their current
+ * processors, and with ParMETIS 2 the graph is partitioned from scratch.
+ *
+ */
+void GetRepartitioning(gridT *grid, int *vwgt, int *part, int Nc, int myproc, int numprocs, MPI_Comm comm) {
+  int i, j, n, nf, nc, nvtxs, numflag=0, wgtflag=2, options[5], edgecut, nparts=numprocs;
+  idxtype *vtxdist, *xadj, *adjncy, *gvwgt, *lpart;
+  int *id;
+#if defined(PARMETIS_MAJOR_VERSION) && PARMETIS_MAJOR_VERSION>=3
+  int ncon=1;
+  float *tpwgts, ubvec=1.05, itr=1000.0;
+#endif
+
+  nvtxs=grid->celldist[2];
+  vtxdist = (idxtype *)SunMalloc((numprocs+1)*sizeof(idxtype),"GetRepartitioning");
+  xadj = (idxtype *)SunMalloc((nvtxs+1)*sizeof(idxtype),"GetRepartitioning");
+  adjncy = (idxtype *)SunMalloc(grid->maxfaces*nvtxs*sizeof(idxtype),"GetRepartitioning");
+  gvwgt = (idxtype *)SunMalloc(nvtxs*sizeof(idxtype),"GetRepartitioning");
+  lpart = (idxtype *)SunMalloc(nvtxs*sizeof(idxtype),"GetRepartitioning");
+  id = (int *)SunMalloc(grid->Nc*sizeof(int),"GetRepartitioning");
+
+  // Vertices of each processor are its cells cellp[0],...,cellp[nvtxs-1]
+  vtxdist[0]=0;
+  MPI_Allgather(&nvtxs,1,MPI_INT,vtxdist+1,1,MPI_INT,comm);
+  for(n=0;n<numprocs;n++)
+    vtxdist[n+1]+=vtxdist[n];
+
+  // Global vertex numbers of the owned cells and of the halo cells
+  for(i=0;i<grid->Nc;i++)
+    id[i]=-1;
+  for(n=0;n<nvtxs;n++)
+    id[grid->cellp[n]]=vtxdist[myproc]+n;
+  ISendRecvCellData2DInt(id,grid,myproc,comm);
+
+  xadj[0]=0;
+  for(n=0;n<nvtxs;n++) {
+    i=grid->cellp[n];
+    gvwgt[n]=vwgt[i];
+    xadj[n+1]=xadj[n];
+    for(nf=0;nf<grid->nfaces[i];nf++) 
+      if((nc=grid->neigh[i*grid->maxfaces+nf])!=-1 && id[nc]>=0)
+	adjncy[xadj[n+1]++]=(idxtype)id[nc];
+  }
+
+  options[0]=0;
+#if defined(PARMETIS_MAJOR_VERSION) && PARMETIS_MAJOR_VERSION>=3
+  tpwgts = (float *)SunMalloc(nparts*sizeof(float),"GetRepartitioning");
+  for(n=0;n<nparts;n++)
+    tpwgts[n]=1.0/nparts;
+  if(myproc==0 && VERBOSE>2) printf("Repartitioning with ParMETIS_V3_AdaptiveRepart...\n");
+  ParMETIS_V3_AdaptiveRepart(vtxdist,xadj,adjncy,gvwgt,NULL,NULL,&wgtflag,&numflag,&ncon,&nparts,
+      tpwgts,&ubvec,&itr,options,&edgecut,lpart,&comm);
+  SunFree(tpwgts,nparts*sizeof(float),"GetRepartitioning");
+#else
+  if(myproc==0 && VERBOSE>2) printf("Repartitioning with ParMETIS_PartKway...\n");
+  ParMETIS_PartKway(vtxdist,xadj,adjncy,gvwgt,NULL,&wgtflag,&numflag,&nparts,options,&edgecut,lpart,&comm);
+#endif
+
+  // Every cell is owned by exactly one processor
+  for(j=0;j<Nc;j++)
+    part[j]=-1;
+  for(n=0;n<nvtxs;n++)
+    part[grid->mnptr[grid->cellp[n]]]=lpart[n];
+  MPI_Allreduce(MPI_IN_PLACE,part,Nc,MPI_INT,MPI_MAX,comm);
+
+  SunFree(vtxdist,(numprocs+1)*sizeof(idxtype),"GetRepartitioning");
+  SunFree(xadj,(nvtxs+1)*sizeof(idxtype),"GetRepartitioning");
+  SunFree(adjncy,grid->maxfaces*nvtxs*sizeof(idxtype),"GetRepartitioning");
+  SunFree(gvwgt,nvtxs*sizeof(idxtype),"GetRepartitioning");
+  SunFree(lpart,nvtxs*sizeof(idxtype),"GetRepartitioning");
+  SunFree(id,grid->Nc*sizeof(int),"GetRepartitioning");
+}
+
+/*
+ * Function: SplitNodes
+ * Usage: SplitNodes(grid,nnodes,procspernode);
+ * --------------------------------------------
+ * Split the cells of each node (grid->part[i]=node) into procspernode processors
+ * by recursive coordinate bisection weighted with grid->vwgt, and place the processor
+ * node*procspernode+p into grid->part.  The same partitioning is obtained on every 
+ * processor since grid->part, grid->xv, grid->yv and grid->vwgt are global.
+ *
+ */
+static void SplitNodes(gridT *grid, int nnodes, int procspernode) {
+  int i, node, N;
+  int *nodes = (int *)SunMalloc(grid->Nc*sizeof(int),"SplitNodes");
+  cellkeyT *keys = (cellkeyT *)SunMalloc(grid->Nc*sizeof(cellkeyT),"SplitNodes");
+
+  for(i=0;i<grid->Nc;i++)
+    nodes[i]=grid->part[i];
+
+  for(node=0;node<nnodes;node++) {
+    for(i=0, N=0;i<grid->Nc;i++)
+      if(nodes[i]==node)
+        keys[N++].cell=i;
+    Bisect(grid,keys,N,node*procspernode,procspernode);
+  }
+
+  SunFree(nodes,grid->Nc*sizeof(int),"SplitNodes");
+  SunFree(keys,grid->Nc*sizeof(cellkeyT),"SplitNodes");
+}
+
+/*
+ * Function: Bisect
+ * Usage: Bisect(grid,keys,N,firstpart,nparts);
+ * --------------------------------------------
+ * Place the N cells in keys[i].cell into processors firstpart,...,firstpart+nparts-1 
+ * by recursively splitting them along the longest side of their bounding box into 
+ * two groups with weights in the ratio of the number of processors in each.
+ *
+ */
+static void Bisect(gridT *grid, cellkeyT *keys, int N, int firstpart, int nparts) {
+  int i, m, nleft;
+  REAL xmin=INFTY, xmax=-INFTY, ymin=INFTY, ymax=-INFTY, total=0, sum;
+
+  if(nparts==1 || N<=1) {
+    for(i=0;i<N;i++)
+      grid->part[keys[i].cell]=firstpart;
+    return;
+  }
+
+  for(i=0;i<N;i++) {
+    xmin=Min(xmin,grid->xv[keys[i].cell]);
+    xmax=Max(xmax,grid->xv[keys[i].cell]);
+    ymin=Min(ymin,grid->yv[keys[i].cell]);
+    ymax=Max(ymax,grid->yv[keys[i].cell]);
+    total+=grid->vwgt[keys[i].cell];
+  }
+  for(i=0;i<N;i++)
+    keys[i].key=(xmax-xmin>=ymax-ymin)?grid->xv[keys[i].cell]:grid->yv[keys[i].cell];
+  qsort(keys,N,sizeof(cellkeyT),CompareKeys);
+
+  // First m cells go to the nleft processors on the left
+  nleft=nparts/2;
+  for(m=0, sum=0;m<N && sum<total*nleft/nparts;m++)
+    sum+=grid->vwgt[keys[m].cell];
+  m=Max(m,1);
+  m=Min(m,N-1);
+
+  Bisect(grid,keys,m,firstpart,nleft);
+  Bisect(grid,keys+m,N-m,firstpart+nleft,nparts-nleft);
+}
+
+/*
+ * Function: CompareKeys
+ * Usage: qsort(keys,N,sizeof(cellkeyT),CompareKeys);
+ * --------------------------------------------------
+ * Sort the cells by their key, and by their index if the keys are equal so that
+ * the order does not depend on the qsort implementation.
+ *
+ */
+static int CompareKeys(const void *a, const void *b) {
+  const cellkeyT *ka=(const cellkeyT *)a, *kb=(const cellkeyT *)b;
+
+  if(ka->key<kb->key) return -1;
+  if(ka->key>kb->key) return 1;
+  return ka->cell-kb->cell;
+}
+
 /*
  * Function: GetGraph
- * Usage GetGraph(graph,grid,comm);
- * --------------------------------
+ * Usage GetGraph(graph,grid,ncon,comm);
+ * -------------------------------------
  * This code was adapted from the ParMetis-2.0 code in the ParMetis
- * distribution.
+ * distribution.  With ncon=2 the weights of each vertex are its
+ * cost (grid->vwgt) and its memory (grid->mwgt).
  *
  */
-static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
+static void GetGraph(GraphType *graph, gridT *grid, int ncon, MPI_Comm comm)
 {
   int i, k, l, numprocs, myproc;
   int nvtxs, penum, snvtxs;
@@ -97,7 +336,15 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
     nvtxs = grid->Nc;
     gxadj = grid->xadj;
     gadjncy = grid->adjncy;
-    gvwgt = (idxtype *)grid->vwgt;
+    if(ncon==1)
+      gvwgt = (idxtype *)grid->vwgt;
+    else {
+      gvwgt = idxmalloc(ncon*nvtxs, "ReadGraph: gvwgt");
+      for(i=0;i<nvtxs;i++) {
+        gvwgt[ncon*i]=grid->vwgt[i];
+        gvwgt[ncon*i+1]=grid->mwgt[i];
+      }
+    }
 
     /* Construct vtxdist and send it to all the processors */
     vtxdist[0] = 0;
@@ -113,19 +360,19 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
   graph->gnvtxs = vtxdist[numprocs];
   graph->nvtxs = vtxdist[myproc+1]-vtxdist[myproc];
   graph->xadj = idxmalloc(graph->nvtxs+1, "ReadGraph: xadj");
-  graph->vwgt = idxmalloc(graph->nvtxs, "ReadGraph: vwgt");
+  graph->vwgt = idxmalloc(ncon*graph->nvtxs, "ReadGraph: vwgt");
 
   if (myproc == 0) {
     for (penum=0; penum<numprocs; penum++) {
       snvtxs = vtxdist[penum+1]-vtxdist[penum];
       sxadj = idxmalloc(snvtxs+1, "ReadGraph: sxadj");
-      svwgt = idxmalloc(snvtxs, "ReadGraph: svwgt");
+      svwgt = idxmalloc(ncon*snvtxs, "ReadGraph: svwgt");
 
       idxcopy(snvtxs+1, gxadj+vtxdist[penum], sxadj);
-      idxcopy(snvtxs, gvwgt+vtxdist[penum], svwgt);
+      idxcopy(ncon*snvtxs, gvwgt+ncon*vtxdist[penum], svwgt);
 
       if(VERBOSE>3) 
-	for(k=0;k<snvtxs;k++)
+	for(k=0;k<ncon*snvtxs;k++)
 	  printf("svwgt[%d]=%d\n",k,svwgt[k]);
 
       for (i=snvtxs; i>=0; i--)
@@ -135,10 +382,10 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
 
       if (penum == myproc) {
         idxcopy(snvtxs+1, sxadj, graph->xadj);
-	idxcopy(snvtxs, svwgt, graph->vwgt);
+	idxcopy(ncon*snvtxs, svwgt, graph->vwgt);
       } else {
         MPI_Send((void *)sxadj, snvtxs+1, IDX_DATATYPE, penum, 1, comm); 
-        MPI_Send((void *)svwgt, snvtxs, IDX_DATATYPE, penum, 1, comm); 
+        MPI_Send((void *)svwgt, ncon*snvtxs, IDX_DATATYPE, penum, 1, comm); 
       }
 
       free(sxadj);
@@ -147,11 +394,11 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
   }
   else {
     MPI_Recv((void *)graph->xadj, graph->nvtxs+1, IDX_DATATYPE, 0, 1, comm, &status);
-    MPI_Recv((void *)graph->vwgt, graph->nvtxs, IDX_DATATYPE, 0, 1, comm, &status);
+    MPI_Recv((void *)graph->vwgt, ncon*graph->nvtxs, IDX_DATATYPE, 0, 1, comm, &status);
   }
   if(VERBOSE>3) {
     printf("Weights on each processor after MPI_Recv\n");
-    for(k=0;k<graph->nvtxs;k++)
+    for(k=0;k<ncon*graph->nvtxs;k++)
       printf("vwgt[%d]=%d\n",k,graph->vwgt[k]);
   }
 
@@ -167,6 +414,8 @@ static void GetGraph(GraphType *graph, gridT *grid, MPI_Comm comm)
     }
 
     free(ssize);
+    if(ncon>1)
+      free(gvwgt);
   }
   else 
     MPI_Recv((void *)graph->adjncy, graph->nedges, IDX_DATATYPE, 0, 1, comm, &status);
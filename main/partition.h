@@ -15,5 +15,6 @@
 #include "grid.h"
 
 void GetPartitioning(gridT *maingrid, gridT **localgrid, int myproc, int numprocs, MPI_Comm comm);
+void GetRepartitioning(gridT *grid, int *vwgt, int *part, int Nc, int myproc, int numprocs, MPI_Comm comm);
 
 #endif
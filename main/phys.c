@@ -21,6 +21,9 @@
 #include "scalars.h"
 #include "timer.h"
 #include "profiles.h"
+#include "outputplan.h"
+#include "analysis.h"
+#include "timestep.h"
 #include "state.h"
 #include "diffusion.h"
 #include "sources.h"
@@ -35,7 +38,12 @@
 #include "culvert.h"
 #include "wave.h"
 #include "subgrid.h"
+#include "rebalance.h"
+#include "tides.h"
+#include "field.h"
 #include "sendrecv.h"
+#include "reconstruct.h"
+#include "mixedcg.h"
 /*
  * Private Function declarations.
  *
@@ -49,31 +57,25 @@ static void ComputeQSource(REAL **src, gridT *grid, physT *phys, propT *prop,
     int myproc, int numprocs);
 static void CGSolve(gridT *grid, physT *phys, propT *prop, 
     int myproc, int numprocs, MPI_Comm comm);
-static void HPreconditioner(REAL *x, REAL *y, gridT *grid, physT *phys, propT *prop);
+static void HPreconditioner(DREAL *x, DREAL *y, gridT *grid, physT *phys, propT *prop);
 static void HCoefficients(REAL *coef, REAL *fcoef, gridT *grid, physT *phys, 
     propT *prop);
 static void CGSolveQ(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, 
     propT *prop, 
     int myproc, int numprocs, MPI_Comm comm);
-static void ConditionQ(REAL **x, gridT *grid, physT *phys, propT *prop, int myproc, 
-    MPI_Comm comm);
 static void Preconditioner(REAL **x, REAL **xc, REAL **coef, gridT *grid, physT *phys, 
     propT *prop);
 static void GuessQ(REAL **q, REAL **wold, REAL **w, gridT *grid, physT *phys, 
     propT *prop, int myproc, int numprocs, MPI_Comm comm);
 static void GSSolve(gridT *grid, physT *phys, propT *prop, 
     int myproc, int numprocs, MPI_Comm comm);
-static REAL InnerProduct(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, 
+static DREAL InnerProduct(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, 
     MPI_Comm comm);
-static REAL InnerProduct3(REAL **x, REAL **y, gridT *grid, int myproc, int numprocs, 
+static DREAL InnerProductDouble(DREAL *x, DREAL *y, gridT *grid, int myproc, int numprocs, 
     MPI_Comm comm);
-static void OperatorH(REAL *x, REAL *y, REAL *coef, REAL *fcoef, gridT *grid, 
-    physT *phys, propT *prop);
-static void OperatorQC(REAL **coef, REAL **fcoef, REAL **x, REAL **y, REAL **c, 
-    gridT *grid, physT *phys, propT *prop);
-static void QCoefficients(REAL **coef, REAL **fcoef, REAL **c, gridT *grid, 
-    physT *phys, propT *prop);
-static void OperatorQ(REAL **coef, REAL **x, REAL **y, REAL **c, gridT *grid, 
+static DREAL InnerProduct3(REAL **x, REAL **y, gridT *grid, int myproc, int numprocs, 
+    MPI_Comm comm);
+static void OperatorH(DREAL *x, DREAL *y, REAL *coef, REAL *fcoef, gridT *grid, 
     physT *phys, propT *prop);
 static void Continuity(REAL **w, gridT *grid, physT *phys, propT *prop);
 void Continuity(REAL **w, gridT *grid, physT *phys, propT *prop);
@@ -86,16 +88,6 @@ static void NewCells(gridT *grid, physT *phys, propT *prop);
 static void WPredictor(gridT *grid, physT *phys, propT *prop,
     int myproc, int numprocs, MPI_Comm comm);
 void ComputeUC(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc, interpolation interp, int kinterp, int subgridmodel);
-static void ComputeUCPerot(REAL **u, REAL **uc, REAL **vc, REAL *h, int kinterp, int subgridmodel, gridT *grid);
-static void ComputeUCLSQ(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys);
-static void ComputeUCRT(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc);
-static void ComputeNodalVelocity(physT *phys, gridT *grid, interpolation interp, int myproc);
-static void  ComputeTangentialVelocity(physT *phys, gridT *grid, interpolation ninterp, interpolation tinterp,int myproc);
-static void  ComputeQuadraticInterp(REAL x, REAL y, int ic, int ik, REAL **uc, 
-    REAL **vc, physT *phys, gridT *grid, interpolation ninterp, 
-    interpolation tinterp, int myproc);
-static void ComputeRT0Velocity(REAL* tempu, REAL* tempv, REAL e1n1, REAL e1n2, 
-    REAL e2n1, REAL e2n2, REAL Uj1, REAL Uj2);
 static void BarycentricCoordsFromCartesian(gridT *grid, int cell, 
     REAL x, REAL y, REAL* lambda);
 static void BarycentricCoordsFromCartesianEdge(gridT *grid, int cell, 
@@ -106,12 +98,15 @@ static REAL HFaceFlux(int j, int k, REAL *phi, REAL **u, gridT *grid, REAL dt,
     int method);
 //static void SetFluxHeight(gridT *grid, physT *phys, propT *prop);
 void SetFluxHeight(gridT *grid, physT *phys, propT *prop);
+static void AllocateActiveLists(gridT *grid, physT *phys);
+static void SetListFlags(gridT *grid, physT *phys, int i);
 static void GetMomentumFaceValues(REAL **uface, REAL **ui, REAL **boundary_ui, REAL **U, gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int myproc, int nonlinear);
 static void getTsurf(gridT *grid, physT *phys);
 static void getchangeT(gridT *grid, physT *phys);
 // added drag function Yun Zhang
 static void InterpDrag(gridT *grid, physT *phys, propT *prop, int myproc);
 static void OutputDrag(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
+static void SetupRebalancedGrid(gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm);
 /*
  * Function: AllocatePhysicalVariables
  * Usage: AllocatePhysicalVariables(grid,phys,prop);
@@ -191,11 +186,16 @@ void AllocatePhysicalVariables(gridT *grid, physT **phys, propT *prop)
   (*phys)->dhdt = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->hcorr = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->active = (unsigned char *)SunMalloc(Nc*sizeof(char),"AllocatePhysicalVariables");
+  AllocateActiveLists(grid,*phys);
   (*phys)->hold = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->h_old = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->htmp = (REAL *)SunMalloc(10*Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->htmp2 = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->htmp3 = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
+  (*phys)->hcg = (DREAL *)SunMalloc(5*Nc*sizeof(DREAL),"AllocatePhysicalVariables");
+  for(i=0;i<5*Nc;i++)
+    (*phys)->hcg[i]=0;
+  AllocateMixedCG(grid,*phys,prop);
   (*phys)->hcoef = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->hfcoef = (REAL *)SunMalloc(grid->maxfaces*Nc*sizeof(REAL),"AllocatePhysicalVariables");
   (*phys)->Tsurf = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocatePhysicalVariables");
@@ -387,6 +387,10 @@ void AllocatePhysicalVariables(gridT *grid, physT **phys, propT *prop)
       (*phys)->Apr[i] = (REAL *)SunMalloc(2*sizeof(REAL),"AllocatePhysicalVariables");  
   }
 
+  // work space of the turbulence models
+  (*phys)->turbulence=NULL;
+  if(prop->turbmodel>=1)
+    AllocateTurbulence(grid,*phys,prop);
 }
 
 /*
@@ -413,6 +417,7 @@ void FreePhysicalVariables(gridT *grid, physT *phys, propT *prop)
       free(phys->nRT1v[i][j]);
     }
   }
+  FreeReconstructionOperators();
   // over each edge
   for(i=0; i < Ne; i++) {
     free(phys->tRT1[i]);
@@ -477,9 +482,19 @@ void FreePhysicalVariables(gridT *grid, physT *phys, propT *prop)
   free(phys->user_def_nc_nk);
   free(phys->h);
   free(phys->hcorr);
+  free(phys->wetcellp);
+  free(phys->wetcellptr);
+  free(phys->wetedgep);
+  free(phys->wetcells);
+  free(phys->wetedges);
+  free(phys->deepcells);
+  free(phys->cellflags);
+  free(phys->edgeflags);
   free(phys->htmp);
   free(phys->htmp2);
   free(phys->htmp3);
+  free(phys->hcg);
+  FreeMixedCG(phys);
   free(phys->h_old);
   free(phys->hold);
   free(phys->hcoef);
@@ -513,6 +528,7 @@ void FreePhysicalVariables(gridT *grid, physT *phys, propT *prop)
     free(phys->lT);
     free(phys->qT_old);
     free(phys->lT_old);
+    FreeTurbulence(grid,phys,prop);
   }  
   free(phys->stmp);
   free(phys->stmp2);
@@ -640,7 +656,7 @@ void InitializePhysicalVariables(gridT *grid, physT *phys, propT *prop, int mypr
 
   for(j=0;j<grid->Ne;j++)
     for(k=0;k<grid->Nke[j];k++)
-      phys->u[i][j]=0;  
+      phys->u[j][k]=0;  
 
   // Initialize the temperature, salinity, and background salinity
   // distributions.  Since z is not stored, need to use dz[k] to get
@@ -884,35 +900,18 @@ void SetDragCoefficients(gridT *grid, physT *phys, propT *prop) {
 */
 static void InterpDrag(gridT *grid, physT *phys, propT *prop,int myproc)
 {
-   int n, Nb, Nt;
-   REAL *xb, *yb, *z0b, *xt, *yt, *z0t;
+   int n;
+   REAL extent[4];
    char str[BUFFERLENGTH];
    FILE *fid;
+   fieldT *field;
+
+   FieldExtent(grid->xe,grid->ye,grid->Ne,extent,1);
    // for z0B
    if(prop->Intz0B==1){
-     Nb = MPI_GetSize(prop->INPUTZ0BFILE,"InterpDrag",myproc);
-     xb = (REAL *)SunMalloc(Nb*sizeof(REAL),"InterpDrag");
-     yb = (REAL *)SunMalloc(Nb*sizeof(REAL),"InterpDrag");
-     z0b = (REAL *)SunMalloc(Nb*sizeof(REAL),"InterpDrag");
-     fid = MPI_FOpen(prop->INPUTZ0BFILE,"r","InterpDrag",myproc);
-     for(n=0;n<Nb;n++) {
-       xb[n]=getfield(fid,str);
-       yb[n]=getfield(fid,str);
-       z0b[n]=getfield(fid,str); // but cd should be positive already
-     }
-     
-     fclose(fid);
-     // grid have xe ye
-    /* for(n=0;n<grid->Ne;n++){
-       // get the middle point of each edge
-       xe[n]=0.5*(grid->xp[grid->edges[n*NUMEDGECOLUMNS]]+grid->xp[grid->edges[n*NUMEDGECOLUMNS+1]]);
-       ye[n]=0.5*(grid->yp[grid->edges[n*NUMEDGECOLUMNS]]+grid->yp[grid->edges[n*NUMEDGECOLUMNS+1]]);
-     }*/
-
-     Interp(xb,yb,z0b,Nb,&(grid->xe[0]), &(grid->ye[0]), &(phys->z0B[0]), grid->Ne, grid->maxfaces);
-     free(xb);
-     free(yb);
-     free(z0b);
+     field = ReadField(prop->INPUTZ0BFILE,extent,myproc);
+     SampleField(field,grid->xe,grid->ye,phys->z0B,grid->Ne,grid->maxfaces+1,myproc);
+     FreeField(field);
 
    } else if(prop->Intz0B==2){
      sprintf(str,"%s-edge",prop->INPUTZ0BFILE);
@@ -934,22 +933,9 @@ static void InterpDrag(gridT *grid, physT *phys, propT *prop,int myproc)
 
    // for z0T
    if(prop->Intz0T==1){
-
-     Nt = MPI_GetSize(prop->INPUTZ0TFILE,"InterpDrag",myproc); // change to z0TFILE
-     xt = (REAL *)SunMalloc(Nt*sizeof(REAL),"InterpDrag");
-     yt = (REAL *)SunMalloc(Nt*sizeof(REAL),"InterpDrag");
-     z0t = (REAL *)SunMalloc(Nt*sizeof(REAL),"InterpDrag");
-     fid = MPI_FOpen(prop->INPUTZ0TFILE,"r","InterpDrag",myproc);
-     for(n=0;n<Nt;n++) {
-       xt[n]=getfield(fid,str);
-       yt[n]=getfield(fid,str);
-       z0t[n]=getfield(fid,str); // but cd should be positive already
-     }
-     fclose(fid);
-     Interp(xt,yt,z0t,Nt,&(grid->xe[0]), &(grid->ye[0]),&(phys->z0T[0]),grid->Ne,grid->maxfaces);
-     free(xt);
-     free(yt);
-     free(z0t);
+     field = ReadField(prop->INPUTZ0TFILE,extent,myproc);
+     SampleField(field,grid->xe,grid->ye,phys->z0T,grid->Ne,grid->maxfaces+1,myproc);
+     FreeField(field);
 
    } else if(prop->Intz0T==2){
      sprintf(str,"%s-edge",prop->INPUTZ0TFILE);
@@ -1104,6 +1090,9 @@ void UpdateDZ(gridT *grid, physT *phys, propT *prop, int option)
 
   // don't need to recompute for linearized FS
   if(prop->linearFS) {
+    for(i=0;i<Nc;i++)
+      SetListFlags(grid,phys,i);
+    UpdateActiveLists(grid,phys,prop,0);
     return;
   }
 
@@ -1176,10 +1165,13 @@ void UpdateDZ(gridT *grid, physT *phys, propT *prop, int option)
             grid->dzz[i][k]=0;
         }
       }
+      SetListFlags(grid,phys,i);
     }
   } else 
-    for(i=0;i<Nc;i++) 
+    for(i=0;i<Nc;i++) {
       grid->dzz[i][0]=grid->dv[i]+phys->h[i];
+      SetListFlags(grid,phys,i);
+    }
 
   // Now set grid->etop and ctop which store the index of the top cell  
   for(j=0;j<grid->Ne;j++) {
@@ -1238,6 +1230,8 @@ void UpdateDZ(gridT *grid, physT *phys, propT *prop, int option)
       grid->dzfB[j] = Min(dzz1,dzz2);
     }
   }
+
+  UpdateActiveLists(grid,phys,prop,0);
 }
 
 /*
@@ -1276,7 +1270,8 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
 {
 
   int i,k,j, n, blowup=0,ne,id,nc1,nc2,nf;
-  REAL t0,sum1,v_average,flux,normal;
+  REAL sum1,v_average,flux,normal;
+  DREAL t0;
   metinT *metin;
   metT *met;
   averageT *average;
@@ -1294,11 +1289,16 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
   // initialize the timers
   t_start=Timer();
   t_source=t_predictor=t_nonhydro=t_turb=t_transport=t_io=t_comm=t_check=0;
+  prop->cgsolves=prop->cgiters=prop->cgmaxn=prop->qcgsolves=prop->qcgiters=prop->qcgmaxn=0;
 
   // Set all boundary values at time t=nstart*dt;
   prop->n=prop->nstart;
   // initialize the time (often used for boundary/initial conditions)
   prop->rtime=prop->nstart*prop->dt;
+  InitializeTimeStep(prop,myproc);
+  // Flags of the initial state for the active lists, which are then updated
+  // where h and ctop change
+  UpdateActiveLists(grid,phys,prop,1);
  
   // Initialise the netcdf time (moved to InitializePhysicalVariables)
   // Get the toffSet property
@@ -1312,6 +1312,9 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
     AllocateBoundaryData(prop, grid, &bound, myproc,comm);
     InitBoundaryData(prop, grid, myproc,comm);
   }
+  // Initialise the tidal boundary forcing (tides.c)
+  else if(prop->tideforcing)
+    InitTideForcing(grid,prop,myproc);
 
   // get the boundary velocities (boundaries.c)
   BoundaryVelocities(grid,phys,prop,myproc, comm); 
@@ -1441,11 +1444,10 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
   // main time loop
   for(n=prop->nstart+1;n<=prop->nsteps+prop->nstart;n++) {
     prop->n = n;
-    // compute the runtime 
-    prop->rtime = n*prop->dt;
-    
-    // netcdf file time
-    prop->nctime = prop->toffSet*86400.0 + n*prop->dt;
+    // Decide whether this step is checked for blow-ups
+    CheckBegin(prop);
+    // compute the runtime and netcdf file time
+    AdvanceTime(prop);
     //prop->nctime +=  n*prop->dt;
     //prop->nctime += prop->rtime;
     // Set nsteps<0 for debugging i/o without hydro/seds/etc...
@@ -1598,8 +1600,6 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
           getchangeT(grid,phys);
         }
         ISendRecvCellData3D(phys->T,grid,myproc,comm);	
-        ISendRecvCellData3D(phys->Ttmp,grid,myproc,comm);
-        ISendRecvCellData2D(phys->dT,grid,myproc,comm);
         ISendRecvCellData2D(phys->Tsurf,grid,myproc,comm);
 
         t_transport+=Timer()-t0;
@@ -1678,8 +1678,7 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
           ComputeUl(grid, prop, phys, myproc);
           // compute zc gradient
           // zf is calculate in ComputeZc function
-          ComputeCellAveragedHorizontalGradient(vert->dzdx, 0, vert->zf, grid, prop, phys, myproc);
-          ComputeCellAveragedHorizontalGradient(vert->dzdy, 1, vert->zf, grid, prop, phys, myproc); 
+          ComputeCellAveragedHorizontalGradients(&vert->dzdx, &vert->dzdy, &vert->zf, 1, grid);
  
           // compute U3
           ComputeOmega(grid, prop, phys,-1, myproc);
@@ -1740,8 +1739,7 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
           ComputeUl(grid, prop, phys, myproc);
           // compute zc gradient
           // zf is calculate in ComputeZc function
-          ComputeCellAveragedHorizontalGradient(vert->dzdx, 0, vert->zf, grid, prop, phys, myproc);
-          ComputeCellAveragedHorizontalGradient(vert->dzdy, 1, vert->zf, grid, prop, phys, myproc); 
+          ComputeCellAveragedHorizontalGradients(&vert->dzdx, &vert->dzdy, &vert->zf, 1, grid);
 
         }
 
@@ -1756,6 +1754,10 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
         ISendRecvWData(vert->U3,grid,myproc,comm);
       }
 
+      // Post the reduction of the blow-up checks (checkmode=1), which is
+      // completed in Check
+      CheckReduce(grid,phys,prop,comm);
+
       // Set scalar and wind stress boundary values at new time step n; 
       // (n-1) is old time step.
       // BoundaryVelocities and OpenBoundaryFluxes were called in UPredictor to set the
@@ -1828,12 +1830,27 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
     }
     InterpData(grid,phys,prop,comm,numprocs,myproc);
 
+    // Station, transect and sub-domain output
+    OutputPlan(grid,phys,prop,comm,numprocs,myproc);
+
+    // In-situ harmonic analysis and statistics
+    Analysis(grid,phys,prop,blowup,comm,numprocs,myproc);
+
     t_io+=Timer()-t0;
+
+    // Time step of the next step when adaptivedt=1
+    UpdateTimeStep(prop,myproc);
+
     // Output progress
     Progress(prop,myproc,numprocs);
     if(blowup)
       break;
 
+    // Repartition the grid if the load is unbalanced (see rebalance.c)
+    if(CheckLoadBalance(grid,phys,prop,myproc,numprocs,comm) &&
+       Rebalance(&grid,&phys,&metin,&met,&average,prop,myproc,numprocs,comm))
+      SetupRebalancedGrid(grid,phys,prop,myproc,comm);
+
     //Close all open netcdf file
     /*
     if(prop->n==prop->nsteps+prop->nstart) {
@@ -1857,12 +1874,34 @@ void Solve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_
     */
   }
 
+  // Timings, solver iterations and norms of the fields (see physio.c)
+  if(prop->outputsummary)
+    OutputSummary(grid,phys,prop,myproc,numprocs,comm);
+
   if(prop->mergeArrays) {
     if(VERBOSE>2 && myproc==0) printf("Freeing merging arrays...\n");
     FreeMergingArrays(grid,myproc);
   }
 }
 
+/*
+ * Function: SetupRebalancedGrid
+ * Usage: SetupRebalancedGrid(grid,phys,prop,myproc,comm);
+ * -------------------------------------------------------
+ * Set the boundary values on the grid created by Rebalance.  The rest of the
+ * state, including the flux heights and the drag coefficients, is moved from
+ * the old grid by Rebalance.
+ *
+ */
+static void SetupRebalancedGrid(gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm)
+{
+  BoundaryVelocities(grid,phys,prop,myproc,comm); 
+  OpenBoundaryFluxes(NULL,phys->u,NULL,grid,phys,prop);
+  BoundaryScalars(grid,phys,prop,myproc,comm);
+  if(prop->computeSediments)
+    BoundarySediment(grid,phys,prop);
+}
+
 /*
  * Function: StoreVariables
  * Usage: StoreVariables(grid,phys);
@@ -1959,8 +1998,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
   // Update with old AB term
   // correct velocity based on non-hydrostatic pressure
   // over all computational edges
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr]; 
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr]; 
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -1999,9 +2038,9 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
 
   // 3D Coriolis terms
   // note that this uses linear interpolation to the faces from the cell centers
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) 
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) 
   {
-    j = grid->edgep[jptr];
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -2020,8 +2059,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
 
   // Baroclinic term
   // over computational cells
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr];
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -2083,9 +2122,9 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
     {
       if(vert->dJdtmeth==1)
       {
-        for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) 
+        for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) 
         {
-           j = grid->edgep[jptr];
+           j = phys->wetedgep[jptr];
            nc1 = grid->grad[2*j];
            nc2 = grid->grad[2*j+1];
            def1 = grid->def[nc1*grid->maxfaces+grid->gradf[2*j]];
@@ -2097,9 +2136,9 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
         }
       }
     } else {
-      for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) 
+      for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) 
       {
-        j = grid->edgep[jptr];
+        j = phys->wetedgep[jptr];
         nc1 = grid->grad[2*j];
         nc2 = grid->grad[2*j+1];
         def1 = grid->def[nc1*grid->maxfaces+grid->gradf[2*j]];
@@ -2133,8 +2172,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
       }
 
     // Now compute the cell-centered source terms and put them into stmp
-    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-      i=grid->cellp[iptr];
+    for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+      i=phys->wetcellp[iptr];
       // Store dzz in a since for conservative scheme need to divide by depth (since ut is a flux)
       if(prop->conserveMomentum) {
         for(k=grid->ctop[i];k<grid->Nk[i];k++)
@@ -2188,8 +2227,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
       }
 
     // Now compute the cell-centered source terms and put them into stmp.
-    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-      i=grid->cellp[iptr];
+    for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+      i=phys->wetcellp[iptr];
 
       for(k=0;k<grid->Nk[i];k++) 
         phys->stmp2[i][k]=0;
@@ -2240,8 +2279,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
 
     if(prop->thetaM<0 && prop->vertcoord==1) {
       // Now do vertical advection of momentum
-      for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-        i=grid->cellp[iptr];
+      for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+        i=phys->wetcellp[iptr];
         switch(prop->nonlinear) {
       	  case 1:
             for(k=grid->ctop[i]+1;k<grid->Nk[i];k++) {
@@ -2316,8 +2355,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
     // add explicit form for vertical momentum advection
     if(prop->thetaM<0 && prop->vertcoord!=1) {
       // Now do vertical advection of momentum
-      for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-        i=grid->cellp[iptr];
+      for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+        i=phys->wetcellp[iptr];
         switch(prop->nonlinear) {
           case 1:
             for(k=grid->ctop[i]+1;k<grid->Nk[i];k++) {
@@ -2440,8 +2479,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
 
   // Now add on horizontal diffusion to stmp and stmp2
   // for the computational cells
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr];
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -2581,8 +2620,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
   }
 
   // computational cells
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr]; 
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr]; 
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -2637,8 +2676,8 @@ static void HorizontalSource(gridT *grid, physT *phys, propT *prop,
   // note that we now basically have the term dt*F_j,k in Equation 33
   // update utmp 
   // this will complete the adams-bashforth time stepping
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr]; 
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr]; 
 
     for(k=grid->etop[j];k<grid->Nke[j];k++){
       phys->utmp[j][k]+=fab1*phys->Cn_U[j][k];
@@ -2974,9 +3013,10 @@ static void WPredictor(gridT *grid, physT *phys, propT *prop,
   }
 
   // Vertical advection using Lax-Wendroff
+  // over the active cells with more than one layer (see UpdateActiveLists)
   if(prop->nonlinear==4 && (prop->vertcoord==1 || (prop->vertcoord!=1 && !prop->wetdry))) 
-    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-      i = grid->cellp[iptr]; 
+    for(iptr=0;iptr<phys->Ncdeep;iptr++) {
+      i = phys->deepcells[iptr];
       if(prop->vertcoord==1)
         for(k=grid->ctop[i]+1;k<grid->Nk[i]+1;k++) {
           Cz = 0.5*(phys->w[i][k-1]+phys->w[i][k])*prop->dt/grid->dzz[i][k-1];
@@ -3224,12 +3264,20 @@ static void ComputeQSource(REAL **src, gridT *grid, physT *phys, propT *prop, in
  * This function replaces q with x and src with p.  phys->uc and phys->vc
  * are used as temporary arrays as well to store z and r.
  *
+ * With qmixed=1 the solve is done by CGSolveQMixed.
+ *
  */
 static void CGSolveQ(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm) {
 
   int i, iptr, k, n, niters;
 
-  REAL **x, **r, **rtmp, **p, **z, mu, nu, alpha, alpha0, eps, eps0;
+  REAL **x, **r, **rtmp, **p, **z;
+  DREAL mu, nu, alpha, alpha0, eps, eps0;
+
+  if(prop->qmixed) {
+    CGSolveQMixed(q,src,c,grid,phys,prop,myproc,numprocs,comm);
+    return;
+  }
 
   z = phys->stmp2;
   x = q;
@@ -3341,6 +3389,10 @@ static void CGSolveQ(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, p
       break;
   }
 
+  prop->qcgsolves++;
+  prop->qcgiters+=n;
+  prop->qcgmaxn=Max(prop->qcgmaxn,n);
+
   if(myproc==0 && VERBOSE>2) {
     if(eps==0)
       printf("Warning...Time step %d, norm of pressure source is 0.\n",prop->n);
@@ -3376,8 +3428,10 @@ static void CGSolveQ(REAL **q, REAL **src, REAL **c, gridT *grid, physT *phys, p
  */
 static void EddyViscosity(gridT *grid, physT *phys, propT *prop, REAL **wnew, MPI_Comm comm, int myproc)
 {
-  if(prop->turbmodel==1)
+  if(prop->turbmodel==TURBMY25)
     my25(grid,phys,prop,wnew,phys->qT,phys->qT_old,phys->lT,phys->lT_old,phys->Cn_q,phys->Cn_l,phys->nu_tv,phys->kappa_tv,comm,myproc);
+  else if(prop->turbmodel==TURBKEPSILON)
+    kepsilon(grid,phys,prop,wnew,phys->qT,phys->qT_old,phys->lT,phys->lT_old,phys->nu_tv,phys->kappa_tv,comm,myproc);
 }
 
 /*
@@ -3456,8 +3510,8 @@ static void UPredictor(gridT *grid, physT *phys,
   }
 
   // Update the velocity in the interior nodes with the old free-surface gradient
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr];
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -3481,8 +3535,8 @@ static void UPredictor(gridT *grid, physT *phys,
   //alpha=0;
 
   // for each of the computational edges
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr];
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -4350,8 +4404,8 @@ static void UPredictor(gridT *grid, physT *phys,
 
   // Add back the implicit barotropic term to obtain the 
   // hydrostatic horizontal velocity field.
-  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
-    j = grid->edgep[jptr];
+  for(jptr=phys->wetedgedist[0];jptr<phys->wetedgedist[1];jptr++) {
+    j = phys->wetedgep[jptr];
 
     nc1 = grid->grad[2*j];
     nc2 = grid->grad[2*j+1];
@@ -4366,6 +4420,10 @@ static void UPredictor(gridT *grid, physT *phys,
     if(grid->etop[j]==grid->Nke[j]-1 && grid->dzz[nc1][grid->etop[j]]<=1*DRYCELLHEIGHT &&
         grid->dzz[nc2][grid->etop[j]]<=1*DRYCELLHEIGHT)
       phys->u[j][grid->etop[j]]=0;
+
+    // NaN and Courant number checks while the column is in cache
+    if(prop->checkmode)
+      CheckEdgeColumn(grid,phys,prop,j);
   }
 
   // correct cells drying below DRYCELLHEIGHT above the 
@@ -4408,6 +4466,8 @@ static void UPredictor(gridT *grid, physT *phys,
   for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
     i = grid->cellp[iptr];
     phys->dhdt[i]=(phys->h[i]-phys->dhdt[i])/dt;
+    if(prop->checkmode)
+      CheckFreeSurface(phys,i);
   }
 
   // added culvert part
@@ -4541,10 +4601,12 @@ static void UPredictor(gridT *grid, physT *phys,
           sum+=grid->dzz[i][k];
         if(fabs(sum-(phys->h[i]+grid->dv[i]))>1e-6)
           printf("n %d something wrong on the cell depth calculation at cell %d error %e sum %e H %e\n",prop->n, i,fabs(sum-(phys->h[i]+grid->dv[i])),sum,phys->h[i]+grid->dv[i]);
+        SetListFlags(grid,phys,i);
     }
 
     // compute the new zc
     ComputeZc(grid,prop,phys,1,myproc);
+    UpdateActiveLists(grid,phys,prop,0);
   }
   // update vertical ac for scalar transport
   if(prop->subgrid)
@@ -4564,13 +4626,14 @@ static void UPredictor(gridT *grid, physT *phys,
 static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm) {
 
   int i, iptr, n, niters;
-  REAL *x, *r, *rtmp, *p, *z, mu, nu, eps, eps0, alpha, alpha0;
+  DREAL *x, *r, *rtmp, *p, *z, mu, nu, eps, eps0, alpha, alpha0;
 
-  x = phys->h;
-  r = phys->hold;
-  rtmp = phys->htmp2;
-  z = phys->htmp3;
-  p = phys->htmp;
+  // The solver works in double precision on the vectors in phys->hcg
+  x = phys->hcg;
+  r = x+grid->Nc;
+  rtmp = x+2*grid->Nc;
+  z = x+3*grid->Nc;
+  p = x+4*grid->Nc;
 
   niters = prop->maxiters;
 
@@ -4581,6 +4644,12 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
     CulvertHCoefficients(phys->hcoef,phys->hfcoef,grid,phys,prop,myproc);
   }
 
+  // The initial guess is the free surface and the source term is in phys->htmp
+  for(i=0;i<grid->Nc;i++) {
+    x[i]=phys->h[i];
+    p[i]=phys->htmp[i];
+  }
+
   // For the boundary term (marker of type 3):
   // 1) Need to set x to zero in the interior points, but
   //    leave it as is for the boundary points.
@@ -4597,7 +4666,7 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
 
     x[i]=0;
   }
-  ISendRecvCellData2D(x,grid,myproc,comm);
+  ISendRecvCellData2DDouble(x,grid,myproc,comm);
   OperatorH(x,z,phys->hcoef,phys->hfcoef,grid,phys,prop);
 
   // 2) b = b-z
@@ -4623,30 +4692,30 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
 
       p[i] = rtmp[i];
     }
-    alpha = alpha0 = InnerProduct(r,rtmp,grid,myproc,numprocs,comm);
+    alpha = alpha0 = InnerProductDouble(r,rtmp,grid,myproc,numprocs,comm);
   } else {
     for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
       i = grid->cellp[iptr];
 
       p[i] = r[i];
     }
-    alpha = alpha0 = InnerProduct(r,r,grid,myproc,numprocs,comm);
+    alpha = alpha0 = InnerProductDouble(r,r,grid,myproc,numprocs,comm);
   }
   if(!prop->resnorm) alpha0 = 1;
 
   if(prop->hprecond==1)
-    eps=eps0=InnerProduct(r,r,grid,myproc,numprocs,comm);
+    eps=eps0=InnerProductDouble(r,r,grid,myproc,numprocs,comm);
   else
     eps=eps0=alpha0;
 
   // Iterate until residual is less than prop->epsilon
   for(n=0;n<niters && eps!=0 && alpha!=0;n++) {
 
-    ISendRecvCellData2D(p,grid,myproc,comm);
+    ISendRecvCellData2DDouble(p,grid,myproc,comm);
     OperatorH(p,z,phys->hcoef,phys->hfcoef,grid,phys,prop);
 
     mu = 1/alpha;
-    nu = alpha/InnerProduct(p,z,grid,myproc,numprocs,comm);
+    nu = alpha/InnerProductDouble(p,z,grid,myproc,numprocs,comm);
 
     for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
       i = grid->cellp[iptr];
@@ -4656,7 +4725,7 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
     }
     if(prop->hprecond==1) {
       HPreconditioner(r,rtmp,grid,phys,prop);
-      alpha = InnerProduct(r,rtmp,grid,myproc,numprocs,comm);
+      alpha = InnerProductDouble(r,rtmp,grid,myproc,numprocs,comm);
       mu*=alpha;
       for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
         i = grid->cellp[iptr];
@@ -4664,7 +4733,7 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
         p[i] = rtmp[i] + mu*p[i];
       }
     } else {
-      alpha = InnerProduct(r,r,grid,myproc,numprocs,comm);
+      alpha = InnerProductDouble(r,r,grid,myproc,numprocs,comm);
       mu*=alpha;
       for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
         i = grid->cellp[iptr];
@@ -4674,7 +4743,7 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
     }
 
     if(prop->hprecond==1)
-      eps=InnerProduct(r,r,grid,myproc,numprocs,comm);
+      eps=InnerProductDouble(r,r,grid,myproc,numprocs,comm);
     else
       eps=alpha;
 
@@ -4682,6 +4751,11 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
     if(sqrt(eps/eps0)<prop->epsilon) 
       break;
   }
+
+  prop->cgsolves++;
+  prop->cgiters+=n;
+  prop->cgmaxn=Max(prop->cgmaxn,n);
+
   if(myproc==0 && VERBOSE>2){
     if(eps==0){
       printf("Warning...Time step %d, norm of free-surface source is 0.\n",prop->n);
@@ -4693,7 +4767,9 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
     }
   }
   // Send the solution to the neighboring processors
-  ISendRecvCellData2D(x,grid,myproc,comm);
+  ISendRecvCellData2DDouble(x,grid,myproc,comm);
+  for(i=0;i<grid->Nc;i++)
+    phys->h[i]=x[i];
 }
 
 /*
@@ -4704,7 +4780,7 @@ static void CGSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
  * xc = M^{-1} x
  *
  */
-static void HPreconditioner(REAL *x, REAL *y, gridT *grid, physT *phys, propT *prop) {
+static void HPreconditioner(DREAL *x, DREAL *y, gridT *grid, physT *phys, propT *prop) {
   int i, iptr;
 
   for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
@@ -4772,21 +4848,50 @@ static void HCoefficients(REAL *coef, REAL *fcoef, gridT *grid, physT *phys, pro
  * Usage: InnerProduct(x,y,grid,myproc,numprocs,comm);
  * ---------------------------------------------------
  * Compute the inner product of two one-dimensional arrays x and y.
- * Used for the CG method to solve for the free surface.
+ * The sum is accumulated in double precision.
+ *
+ */
+static DREAL InnerProduct(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
+
+  int i, iptr;
+  DREAL sum, mysum=0, t0;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+
+    mysum+=x[i]*y[i];
+  }
+  t0=Timer();
+  MPI_Reduce(&mysum,&(sum),1,MPI_DOUBLE,MPI_SUM,0,comm);
+  MPI_Bcast(&sum,1,MPI_DOUBLE,0,comm);
+  t_comm+=Timer()-t0;
+
+  return sum;
+}  
+
+/*
+ *
+ * Function: InnerProductDouble
+ * Usage: InnerProductDouble(x,y,grid,myproc,numprocs,comm);
+ * ---------------------------------------------------------
+ * Compute the inner product of two one-dimensional double-precision arrays
+ * x and y.  Used for the CG method to solve for the free surface.
  *
  */
-static REAL InnerProduct(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
+static DREAL InnerProductDouble(DREAL *x, DREAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
 
   int i, iptr;
-  REAL sum, mysum=0;
+  DREAL sum, mysum=0, t0;
 
   for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
     i = grid->cellp[iptr];
 
     mysum+=x[i]*y[i];
   }
+  t0=Timer();
   MPI_Reduce(&mysum,&(sum),1,MPI_DOUBLE,MPI_SUM,0,comm);
   MPI_Bcast(&sum,1,MPI_DOUBLE,0,comm);
+  t_comm+=Timer()-t0;
 
   return sum;
 }  
@@ -4799,10 +4904,10 @@ static REAL InnerProduct(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs
  * Used for the CG method to solve for the nonhydrostatic pressure.
  *
  */
-static REAL InnerProduct3(REAL **x, REAL **y, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
+static DREAL InnerProduct3(REAL **x, REAL **y, gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
 
   int i, k, iptr;
-  REAL sum, mysum=0;
+  DREAL sum, mysum=0;
 
   for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
     i = grid->cellp[iptr];
@@ -4829,7 +4934,7 @@ static REAL InnerProduct3(REAL **x, REAL **y, gridT *grid, int myproc, int numpr
  * where tmp = prop->grav*(theta*dt)^2
  *
  */
-static void OperatorH(REAL *x, REAL *y, REAL *coef, REAL *fcoef, gridT *grid, physT *phys, propT *prop) {
+static void OperatorH(DREAL *x, DREAL *y, REAL *coef, REAL *fcoef, gridT *grid, physT *phys, propT *prop) {
 
   int i, j, iptr, jptr, ne, nf;
   REAL tmp = prop->grav*pow(prop->theta*prop->dt,2), h0, boundary_flag;
@@ -4858,7 +4963,7 @@ static void OperatorH(REAL *x, REAL *y, REAL *coef, REAL *fcoef, gridT *grid, ph
  * are computed before the iteration in QCoefficients. The array c stores the preconditioner.
  *
  */
-static void OperatorQC(REAL **coef, REAL **fcoef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop) {
+void OperatorQC(REAL **coef, REAL **fcoef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop) {
 
   int i, iptr, k, ne, nf, nc, kmin, kmax;
   REAL *a = phys->a;
@@ -4914,7 +5019,7 @@ static void OperatorQC(REAL **coef, REAL **fcoef, REAL **x, REAL **y, REAL **c,
  * at the horizontal faces for vertical derivatives of q.
  *
  */
-static void QCoefficients(REAL **coef, REAL **fcoef, REAL **c, gridT *grid, 
+void QCoefficients(REAL **coef, REAL **fcoef, REAL **c, gridT *grid, 
     physT *phys, propT *prop) {
 
   int i, iptr, k, kmin, nf, nc, ne;
@@ -4989,7 +5094,7 @@ static void QCoefficients(REAL **coef, REAL **fcoef, REAL **c, gridT *grid,
  * The preconditioner stored in c is not used.
  *
  */
-static void OperatorQ(REAL **coef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop) {
+void OperatorQ(REAL **coef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop) {
 
   int i, iptr, k, ne, nf, nc, kmin, kmax;
 
@@ -5124,7 +5229,7 @@ static void Preconditioner(REAL **x, REAL **xc, REAL **coef, gridT *grid, physT
  * for the pressure-Poisson equation and place it into x after taking its square root.
  *
  */
-static void ConditionQ(REAL **x, gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm) {
+void ConditionQ(REAL **x, gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm) {
 
   int i, iptr, k, ne, nf, nc, kmin, warn=0;
   REAL *a = phys->a;
@@ -5225,8 +5330,8 @@ static void GSSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
   //
   //      myNsrc+=pow(hsrc[i],2);
   //    }
-  //    MPI_Reduce(&myNsrc,&(Nsrc),1,MPI_DOUBLE,MPI_SUM,0,comm);
-  //    MPI_Bcast(&Nsrc,1,MPI_DOUBLE,0,comm);
+  //    MPI_Reduce(&myNsrc,&(Nsrc),1,MPI_REALTYPE,MPI_SUM,0,comm);
+  //    MPI_Bcast(&Nsrc,1,MPI_REALTYPE,0,comm);
   //    Nsrc=sqrt(Nsrc);
 
   for(n=0;n<niters;n++) {
@@ -5279,9 +5384,9 @@ static void GSSolve(gridT *grid, physT *phys, propT *prop, int myproc, int numpr
       // compute the residual
       myresid+=pow(hold[i]/coef-h[i],2);
     }
-    MPI_Reduce(&myresid,&(resid),1,MPI_DOUBLE,MPI_SUM,0,comm);
+    MPI_Reduce(&myresid,&(resid),1,MPI_REALTYPE,MPI_SUM,0,comm);
     // - is this line necessary?
-    MPI_Bcast(&resid,1,MPI_DOUBLE,0,comm);
+    MPI_Bcast(&resid,1,MPI_REALTYPE,0,comm);
     resid=sqrt(resid);
 
     // send all final results out to each processor now
@@ -5353,6 +5458,10 @@ void Continuity(REAL **w, gridT *grid, physT *phys, propT *prop)
             grid->df[ne]*grid->normal[i*grid->maxfaces+nf]/Ac/fac1*grid->dzf[ne][k];
       }
     }
+
+    // Only the vertical velocity at the new time step is checked, not wnew
+    if(prop->checkmode && w==phys->w)
+      CheckCellColumn(grid,phys,prop,w,i);
   }
 
   // calculate w_im for update scalar
@@ -5381,7 +5490,8 @@ void ComputeConservatives(gridT *grid, physT *phys, propT *prop, int myproc, int
 			  MPI_Comm comm)
 {
   int i, iptr, k;
-  REAL mass, volume, volh, height, Ep;
+  REAL height;
+  DREAL mass, volume, volh, Ep;
 
   if(myproc==0) phys->mass=0;
   if(myproc==0) phys->volume=0;
@@ -5433,74 +5543,6 @@ void ComputeConservatives(gridT *grid, physT *phys, propT *prop, int myproc, int
   }
 }
 
-/*
- * Function: ComputeUCPerot
- * Usage: ComputeUCPerot(u,uc,vc,grid);
- * -------------------------------------------
- * Compute the cell-centered components of the velocity vector and place them
- * into uc and vc.  This function estimates the velocity vector with
- *
- * u = 1/Area * Sum_{faces} u_{face} normal_{face} df_{face}*d_{ef,face}
- *
- */
-static void ComputeUCPerot(REAL **u, REAL **uc, REAL **vc, REAL *h, int kinterp, int subgridmodel, gridT *grid) {
-
-  int k, n, ne, nf, iptr;
-  REAL sum;
-
-  // for each computational cell (non-stage defined)
-  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-    // get cell pointer transfering from boundary coordinates 
-    // to grid coordinates
-    n=grid->cellp[iptr];
-
-    // initialize over all depths
-    for(k=0;k<grid->Nk[n];k++) {
-      uc[n][k]=0;
-      vc[n][k]=0;
-    }
-    // over all interior cells
-    for(k=grid->ctop[n]+1;k<grid->Nk[n];k++) {
-      // over each face
-      for(nf=0;nf<grid->nfaces[n];nf++) {
-        ne = grid->face[n*grid->maxfaces+nf];
-        if(!(grid->smoothbot) || k<grid->Nke[ne]){
-          uc[n][k]+=u[ne][k]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]*grid->dzf[ne][k];
-          vc[n][k]+=u[ne][k]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]*grid->dzf[ne][k];
-        }else{ 
-          uc[n][k]+=u[ne][grid->Nke[ne]-1]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]*grid->dzf[ne][grid->Nke[ne]-1];
-          vc[n][k]+=u[ne][grid->Nke[ne]-1]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]*grid->dzf[ne][grid->Nke[ne]-1];
-        }
-      }
-
-      // In case of divide by zero (shouldn't happen)
-      if (grid->dzz[n][k] > DRYCELLHEIGHT) {
-          uc[n][k]/=(grid->Ac[n]*grid->dzz[n][k]);
-          vc[n][k]/=(grid->Ac[n]*grid->dzz[n][k]);
-      } else {
-          uc[n][k] = 0;
-          vc[n][k] = 0;
-      }
-    }
-
-    //top cell only - don't account for depth
-    k=grid->ctop[n];
-    // over each face
-    for(nf=0;nf<grid->nfaces[n];nf++) {
-      ne = grid->face[n*grid->maxfaces+nf];
-      if(!(grid->smoothbot) || k<grid->Nke[ne]){
-        uc[n][k]+=u[ne][k]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-        vc[n][k]+=u[ne][k]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-      }else{ 
-        uc[n][k]+=u[ne][grid->Nke[ne]-1]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-        vc[n][k]+=u[ne][grid->Nke[ne]-1]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];       
-      }
-    }
-    uc[n][k]/=grid->Ac[n];
-    vc[n][k]/=grid->Ac[n];
-  }
-}
-
 
 /*static void ComputeUCPerot(REAL **u, REAL **uc, REAL **vc, REAL *h, int kinterp, int subgridmodel, gridT *grid) {
 
@@ -5629,6 +5671,10 @@ void ReadProperties(propT **prop, gridT *grid, int myproc)
   (*prop)->turbmodel = (int)MPI_GetValue(DATAFILE,"turbmodel","ReadProperties",myproc);
   (*prop)->dt = MPI_GetValue(DATAFILE,"dt","ReadProperties",myproc);
   (*prop)->Cmax = MPI_GetValue(DATAFILE,"Cmax","ReadProperties",myproc);
+  (*prop)->checkmode = (int)MPI_GetValue(DATAFILE,"checkmode","ReadProperties",myproc);
+  (*prop)->checkinterval = (int)MPI_GetValue(DATAFILE,"checkinterval","ReadProperties",myproc);
+  (*prop)->adaptivedt = (int)MPI_GetValue(DATAFILE,"adaptivedt","ReadProperties",myproc);
+  (*prop)->outputsummary = (int)MPI_GetValue(DATAFILE,"outputsummary","ReadProperties",myproc);
   (*prop)->nsteps = (int)MPI_GetValue(DATAFILE,"nsteps","ReadProperties",myproc);
   (*prop)->ntout = (int)MPI_GetValue(DATAFILE,"ntout","ReadProperties",myproc);
   (*prop)->ntoutStore = (int)MPI_GetValue(DATAFILE,"ntoutStore","ReadProperties",myproc);
@@ -5645,6 +5691,8 @@ void ReadProperties(propT **prop, gridT *grid, int myproc)
   (*prop)->qprecond = (int)MPI_GetValue(DATAFILE,"qprecond","ReadProperties",myproc);
   (*prop)->epsilon = MPI_GetValue(DATAFILE,"epsilon","ReadProperties",myproc);
   (*prop)->qepsilon = MPI_GetValue(DATAFILE,"qepsilon","ReadProperties",myproc);
+  (*prop)->qmixed = (int)MPI_GetValue(DATAFILE,"qmixed","ReadProperties",myproc);
+  (*prop)->qmixedepsilon = MPI_GetValue(DATAFILE,"qmixedepsilon","ReadProperties",myproc);
   (*prop)->resnorm = MPI_GetValue(DATAFILE,"resnorm","ReadProperties",myproc);
   (*prop)->relax = MPI_GetValue(DATAFILE,"relax","ReadProperties",myproc);
   (*prop)->amp = MPI_GetValue(DATAFILE,"amp","ReadProperties",myproc);
@@ -5655,6 +5703,7 @@ void ReadProperties(propT **prop, gridT *grid, int myproc)
   (*prop)->masscheck = MPI_GetValue(DATAFILE,"masscheck","ReadProperties",myproc);
   (*prop)->nonlinear = MPI_GetValue(DATAFILE,"nonlinear","ReadProperties",myproc);
   (*prop)->wetdry = MPI_GetValue(DATAFILE,"wetdry","ReadProperties",myproc);
+  (*prop)->activelists = (int)MPI_GetValue(DATAFILE,"activelists","ReadProperties",myproc);
   (*prop)->Coriolis_f = MPI_GetValue(DATAFILE,"Coriolis_f","ReadProperties",myproc);
   (*prop)->sponge_distance = MPI_GetValue(DATAFILE,"sponge_distance","ReadProperties",myproc);
   (*prop)->sponge_decay = MPI_GetValue(DATAFILE,"sponge_decay","ReadProperties",myproc);
@@ -5727,26 +5776,39 @@ void ReadProperties(propT **prop, gridT *grid, int myproc)
   if ((*prop)->calcaverage)
       (*prop)->ntaverage = (int)MPI_GetValue(DATAFILE,"ntaverage","ReadProperties",myproc);
   (*prop)->latitude = MPI_GetValue(DATAFILE,"latitude","ReadProperties",myproc);
+  (*prop)->varylatitude = (int)MPI_GetValue(DATAFILE,"varylatitude","ReadProperties",myproc);
   (*prop)->gmtoffset = MPI_GetValue(DATAFILE,"gmtoffset","ReadProperties",myproc);
   (*prop)->metmodel = (int)MPI_GetValue(DATAFILE,"metmodel","ReadProperties",myproc);
   (*prop)->varmodel = (int)MPI_GetValue(DATAFILE,"varmodel","ReadProperties",myproc);
   (*prop)->nugget = MPI_GetValue(DATAFILE,"nugget","ReadProperties",myproc);
   (*prop)->sill = MPI_GetValue(DATAFILE,"sill","ReadProperties",myproc);
   (*prop)->range = MPI_GetValue(DATAFILE,"range","ReadProperties",myproc);
+  (*prop)->metgrid = (int)MPI_GetValue(DATAFILE,"metgrid","ReadProperties",myproc);
+  (*prop)->metnearest = (int)MPI_GetValue(DATAFILE,"metnearest","ReadProperties",myproc);
+  (*prop)->metradius = MPI_GetValue(DATAFILE,"metradius","ReadProperties",myproc);
   (*prop)->outputNetcdf = (int)MPI_GetValue(DATAFILE,"outputNetcdf","ReadProperties",myproc);
   (*prop)->netcdfBdy = (int)MPI_GetValue(DATAFILE,"netcdfBdy","ReadProperties",myproc);
+  (*prop)->tideforcing = (int)MPI_GetValue(DATAFILE,"tideforcing","ReadProperties",myproc);
+  (*prop)->tidenodal = (int)MPI_GetValue(DATAFILE,"tidenodal","ReadProperties",myproc);
   (*prop)->readinitialnc = (int)MPI_GetValue(DATAFILE,"readinitialnc","ReadProperties",myproc);
   (*prop)->Lsw = MPI_GetValue(DATAFILE,"Lsw","ReadProperties",myproc);
   (*prop)->Cda = MPI_GetValue(DATAFILE,"Cda","ReadProperties",myproc);
   (*prop)->Ce = MPI_GetValue(DATAFILE,"Ce","ReadProperties",myproc);
   (*prop)->Ch = MPI_GetValue(DATAFILE,"Ch","ReadProperties",myproc);
-  if((*prop)->outputNetcdf > 0 || (*prop)->netcdfBdy > 0 || (*prop)->readinitialnc > 0){ 
+  if((*prop)->outputNetcdf > 0 || (*prop)->netcdfBdy > 0 || (*prop)->readinitialnc > 0 || (*prop)->tideforcing > 0){ 
       MPI_GetString((*prop)->starttime,DATAFILE,"starttime","ReadProperties",myproc);
       MPI_GetString((*prop)->basetime,DATAFILE,"basetime","ReadProperties",myproc);
 
       (*prop)->nstepsperncfile=(int)MPI_GetValue(DATAFILE,"nstepsperncfile","ReadProperties",myproc);
       (*prop)->ncfilectr=(int)MPI_GetValue(DATAFILE,"ncfilectr","ReadProperties",myproc);
   }
+  // Storage of the netcdf output and average fields
+  (*prop)->ncdeflate=(int)MPI_GetValue(DATAFILE,"ncdeflate","ReadProperties",myproc);
+  (*prop)->ncshuffle=(int)MPI_GetValue(DATAFILE,"ncshuffle","ReadProperties",myproc);
+  (*prop)->nczstd=(int)MPI_GetValue(DATAFILE,"nczstd","ReadProperties",myproc);
+  (*prop)->ncfloat=(int)MPI_GetValue(DATAFILE,"ncfloat","ReadProperties",myproc);
+  (*prop)->ncsigdigits=(int)MPI_GetValue(DATAFILE,"ncsigdigits","ReadProperties",myproc);
+  (*prop)->ncchunkcells=(int)MPI_GetValue(DATAFILE,"ncchunkcells","ReadProperties",myproc);
   
   if((*prop)->nonlinear==2) {
     (*prop)->laxWendroff = MPI_GetValue(DATAFILE,"laxWendroff","ReadProperties",myproc);
@@ -5925,6 +5987,190 @@ void SetDensity(gridT *grid, physT *phys, propT *prop) {
   }
 }
 
+/*
+ * Function: AllocateActiveLists
+ * Usage: AllocateActiveLists(grid,phys);
+ * --------------------------------------
+ * Allocate the lists of the active cells and edges and set them to all of the
+ * cells and edges, which is what they remain with activelists=0.  The cells
+ * and edges that are exchanged with the other processors are flagged so that
+ * they are always active.
+ *
+ */
+static void AllocateActiveLists(gridT *grid, physT *phys)
+{
+  int i, iptr, j, n, Nc=grid->Nc, Ne=grid->Ne;
+
+  phys->wetcellp = (int *)SunMalloc(Nc*sizeof(int),"AllocateActiveLists");
+  phys->wetcellptr = (int *)SunMalloc(Nc*sizeof(int),"AllocateActiveLists");
+  phys->wetedgep = (int *)SunMalloc(Ne*sizeof(int),"AllocateActiveLists");
+  phys->wetcells = (int *)SunMalloc(Nc*sizeof(int),"AllocateActiveLists");
+  phys->wetedges = (int *)SunMalloc(Ne*sizeof(int),"AllocateActiveLists");
+  phys->deepcells = (int *)SunMalloc(Nc*sizeof(int),"AllocateActiveLists");
+  phys->cellflags = (unsigned char *)SunMalloc(Nc*sizeof(unsigned char),"AllocateActiveLists");
+  phys->edgeflags = (unsigned char *)SunMalloc(Ne*sizeof(unsigned char),"AllocateActiveLists");
+
+  // Cells that are not in cellp are the ghost cells of the other processors
+  for(i=0;i<Nc;i++)
+    phys->cellflags[i]=LIST_WET|LIST_DEEP|LIST_ACTIVE|LIST_HALO;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++)
+    phys->cellflags[grid->cellp[iptr]]&=~LIST_HALO;
+  for(j=0;j<Ne;j++)
+    phys->edgeflags[j]=LIST_ACTIVE;
+  phys->listschanged=1;
+  for(n=0;n<grid->Nneighs;n++) {
+    for(i=0;i<grid->num_cells_send[n];i++)
+      phys->cellflags[grid->cell_send[n][i]]|=LIST_HALO;
+    for(i=0;i<grid->num_cells_recv[n];i++)
+      phys->cellflags[grid->cell_recv[n][i]]|=LIST_HALO;
+    for(j=0;j<grid->num_edges_send[n];j++)
+      phys->edgeflags[grid->edge_send[n][j]]|=LIST_HALO;
+    for(j=0;j<grid->num_edges_recv[n];j++)
+      phys->edgeflags[grid->edge_recv[n][j]]|=LIST_HALO;
+  }
+
+  for(iptr=0;iptr<grid->celldist[2];iptr++) {
+    phys->wetcellp[iptr]=grid->cellp[iptr];
+    phys->wetcellptr[iptr]=iptr;
+  }
+  for(n=0;n<MAXBCTYPES-1;n++)
+    phys->wetcelldist[n]=grid->celldist[n];
+  for(j=0;j<grid->edgedist[MAXMARKS-2];j++)
+    phys->wetedgep[j]=grid->edgep[j];
+  for(n=0;n<MAXMARKS-1;n++)
+    phys->wetedgedist[n]=grid->edgedist[n];
+  for(i=0;i<Nc;i++)
+    phys->wetcells[i]=i;
+  for(j=0;j<Ne;j++)
+    phys->wetedges[j]=j;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++)
+    phys->deepcells[iptr-grid->celldist[0]]=grid->cellp[iptr];
+  phys->Ncwet=Nc;
+  phys->Ncdeep=grid->celldist[1]-grid->celldist[0];
+  phys->Newet=Ne;
+}
+
+/*
+ * Function: SetListFlags
+ * Usage: SetListFlags(grid,phys,i);
+ * ---------------------------------
+ * Set the LIST_WET and LIST_DEEP flags of cell i from its free surface and
+ * ctop, and mark the active lists for rebuilding when either of them changes.
+ * This is called in the loops in which h and ctop are updated (UpdateDZ and
+ * UPredictor).
+ *
+ */
+static void SetListFlags(gridT *grid, physT *phys, int i)
+{
+  unsigned char state=0;
+
+  if(phys->h[i]+grid->dv[i]>BUFFERHEIGHT)
+    state|=LIST_WET;
+  if(grid->ctop[i]<grid->Nk[i]-1)
+    state|=LIST_DEEP;
+  if((phys->cellflags[i]&(LIST_WET|LIST_DEEP))!=state) {
+    phys->cellflags[i]=(phys->cellflags[i]&~(LIST_WET|LIST_DEEP))|state;
+    phys->listschanged=1;
+  }
+}
+
+/*
+ * Function: UpdateActiveLists
+ * Usage: UpdateActiveLists(grid,phys,prop,0);
+ * -------------------------------------------
+ * Update the lists of the cells and edges over which the kernels loop with
+ * activelists=1.  A cell is wet when its depth is above BUFFERHEIGHT, since
+ * the free surface of the cells that CGSolve clamps to DRYCELLHEIGHT drifts
+ * above it by round-off.  An edge is active when one of its cells is wet,
+ * and a cell is active when one of its edges is active, so that the dry
+ * cells next to the water, which can be wetted in the free-surface solve of
+ * this time step, are kept.  The dry columns that are isolated from
+ * the water are frozen until a neighbor wets, and the state of an edge is
+ * left as it is when it is removed from the lists.  The wet and deep flags
+ * of the cells are set by SetListFlags where h and ctop change, and the
+ * lists are only rebuilt when one of them changed since the last call.
+ * With rebuild=1 the flags of every cell are set first, which is used for
+ * the initial state and when the state was replaced (see MigrateState in
+ * rebalance.c).
+ *
+ */
+void UpdateActiveLists(gridT *grid, physT *phys, propT *prop, int rebuild)
+{
+  int i, iptr, j, jptr, n, m, nf, nc1, nc2, Nc=grid->Nc, Ne=grid->Ne;
+  unsigned char *cellflags=phys->cellflags, *edgeflags=phys->edgeflags;
+
+  if(!prop->activelists)
+    return;
+
+  if(rebuild)
+    for(i=0;i<Nc;i++)
+      SetListFlags(grid,phys,i);
+  if(!rebuild && !phys->listschanged)
+    return;
+  phys->listschanged=0;
+
+  for(j=0;j<Ne;j++) {
+    nc1 = grid->grad[2*j];
+    nc2 = grid->grad[2*j+1];
+    if(nc1==-1) nc1=nc2;
+    if(nc2==-1) nc2=nc1;
+
+    if((edgeflags[j]&LIST_HALO) || (cellflags[nc1]&LIST_WET) || (cellflags[nc2]&LIST_WET))
+      edgeflags[j]|=LIST_ACTIVE;
+    else
+      edgeflags[j]&=~LIST_ACTIVE;
+  }
+
+  for(i=0;i<Nc;i++) {
+    cellflags[i]&=~LIST_ACTIVE;
+    if(cellflags[i]&(LIST_WET|LIST_HALO))
+      cellflags[i]|=LIST_ACTIVE;
+    else
+      for(nf=0;nf<grid->nfaces[i];nf++)
+        if(edgeflags[grid->face[i*grid->maxfaces+nf]]&LIST_ACTIVE) {
+          cellflags[i]|=LIST_ACTIVE;
+          break;
+        }
+  }
+
+  m=0;
+  for(n=0;n<MAXBCTYPES-2;n++) {
+    phys->wetcelldist[n]=m;
+    for(iptr=grid->celldist[n];iptr<grid->celldist[n+1];iptr++) {
+      i = grid->cellp[iptr];
+      if(cellflags[i]&LIST_ACTIVE) {
+        phys->wetcellp[m]=i;
+        phys->wetcellptr[m++]=iptr;
+      }
+    }
+  }
+  phys->wetcelldist[MAXBCTYPES-2]=m;
+
+  m=0;
+  for(n=0;n<MAXMARKS-2;n++) {
+    phys->wetedgedist[n]=m;
+    for(jptr=grid->edgedist[n];jptr<grid->edgedist[n+1];jptr++) {
+      j = grid->edgep[jptr];
+      if(edgeflags[j]&LIST_ACTIVE)
+        phys->wetedgep[m++]=j;
+    }
+  }
+  phys->wetedgedist[MAXMARKS-2]=m;
+
+  phys->Ncdeep=0;
+  for(m=phys->wetcelldist[0];m<phys->wetcelldist[1];m++)
+    if(cellflags[phys->wetcellp[m]]&LIST_DEEP)
+      phys->deepcells[phys->Ncdeep++]=phys->wetcellp[m];
+
+  phys->Ncwet=phys->Newet=0;
+  for(i=0;i<Nc;i++)
+    if(cellflags[i]&LIST_ACTIVE)
+      phys->wetcells[phys->Ncwet++]=i;
+  for(j=0;j<Ne;j++)
+    if(edgeflags[j]&LIST_ACTIVE)
+      phys->wetedges[phys->Newet++]=j;
+}
+
 /*
  * Function: SetFluxHeight
  * Usage: SetFluxHeight(grid,phys,prop);
@@ -6043,6 +6289,53 @@ void SetFluxHeight(gridT *grid, physT *phys, propT *prop) {
   if(grid->smoothbot && prop->vertcoord==1)
     for(i=0;i<grid->Nc;i++)
       grid->dzz[i][grid->Nk[i]-1]=Max(grid->dzz[i][grid->Nk[i]-1],dzsmall*grid->dz[grid->Nk[i]-1]);
+
+  UpdateActiveLists(grid,phys,prop,0);
+}
+
+/*
+ * Function: RunKernel
+ * Usage: RunKernel(KERNELCGSOLVE,grid,phys,prop,myproc,numprocs,comm);
+ * ---------------------------------------------------------------------
+ * Run one kernel of the time step on the current state, as it is called in
+ * Solve, so that it can be timed in isolation (see bench.c).  The free-surface
+ * solve uses the right-hand side in phys->htmp and the pressure solve the source
+ * term in phys->stmp, both of which are overwritten by the solvers.
+ *
+ */
+void RunKernel(kernelT kernel, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm)
+{
+  REAL **wnew = prop->vertcoord==1?phys->w_im:vert->omega_im;
+
+  switch(kernel) {
+    case KERNELHCOEFFICIENTS:
+      HCoefficients(phys->hcoef,phys->hfcoef,grid,phys,prop);
+      break;
+    case KERNELOPERATORH:
+      OperatorH(phys->hcg,phys->hcg+3*grid->Nc,phys->hcoef,phys->hfcoef,grid,phys,prop);
+      break;
+    case KERNELCGSOLVE:
+      CGSolve(grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case KERNELCGSOLVEQ:
+      CGSolveQ(phys->qc,phys->stmp,phys->stmp3,grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case KERNELHORIZONTALSOURCE:
+      if(prop->vertcoord!=1)
+        VertCoordinateHorizontalSource(grid,phys,prop,myproc,numprocs,comm);
+      HorizontalSource(grid,phys,prop,myproc,numprocs,comm);
+      break;
+    case KERNELUPDATESCALARS:
+      UpdateScalars(grid,phys,prop,wnew,phys->s,phys->s_old,phys->boundary_s,phys->Cn_R,
+          prop->kappa_s,prop->kappa_sH,phys->kappa_tv,prop->theta,
+          NULL,NULL,NULL,NULL,0,0,comm,myproc,1,prop->TVDsalt);
+      break;
+    case KERNELEDDYVISCOSITY:
+      EddyViscosity(grid,phys,prop,wnew,comm,myproc);
+      break;
+    default:
+      break;
+  }
 }
 
 /*
@@ -6050,7 +6343,7 @@ void SetFluxHeight(gridT *grid, physT *phys, propT *prop) {
  * Usage: ComputeUC(u,uc,vc,grid);
  * -------------------------------------------
  * Compute the cell-centered components of the velocity vector and place them
- * into uc and vc.  
+ * into uc and vc with the reconstruction operators in reconstruct.c.
  *
  */
 //inline static void ComputeUC(physT *phys, gridT *grid, int myproc) {
@@ -6059,13 +6352,13 @@ void ComputeUC(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc, inter
   switch(interp) {
     case QUAD:
       // using Wang et al 2011 methods
-      ComputeUCRT(ui, vi, phys,grid, myproc);
+      ReconstructUCRT(ui, vi, phys,grid, myproc);
       break;
     case PEROT:
-      ComputeUCPerot(phys->u,ui,vi,phys->h,kinterp,subgridmodel,grid);
+      ReconstructUCPerot(phys->u,ui,vi,grid,phys);
       break;
     case LSQ:
-      ComputeUCLSQ(phys->u,ui,vi,grid,phys);
+      ReconstructUCLSQ(phys->u,ui,vi,grid,phys);
       break;
     default:
       break;
@@ -6073,429 +6366,6 @@ void ComputeUC(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc, inter
 
 }
 
-/*
- * Function: ComputeUCRT
- * Usage: ComputeUCRT(u,uc,vc,grid);
- * -------------------------------------------
- * Compute the cell-centered components of the velocity vector and place them
- * into uc and vc.  This function estimates the velocity vector with
- * methods outlined in Wang et al, 2011
- *
- */
-static void ComputeUCRT(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc) {
-
-  int k, n, ne, nf, iptr;
-  REAL sum;
-
-  // first we need to reconstruct the nodal velocities using the RT0 basis functions
-  //  if(myproc==0) printf("ComputeNodalVelocity\n");
-  ComputeNodalVelocity(phys, grid, nRT2, myproc);
-
-  // now we can get the tangential velocities from these results
-  //  if(myproc==0) printf("ComputeTangentialVelocity\n");
-  ComputeTangentialVelocity(phys, grid, nRT2, tRT2, myproc);
-
-  // for each computational cell (non-stage defined)
-  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-    // get cell pointer transfering from boundary coordinates 
-    // to grid coordinates
-    n=grid->cellp[iptr];
-
-    // initialize over all depths
-    for(k=0;k<grid->Nk[n];k++) {
-      phys->uc[n][k]=0;
-      phys->vc[n][k]=0;
-    }
-
-    // over the entire depth (cell depth)
-    // possible mistake here- make sure to the get the right value for the start
-    // of the loop (etop?)
-    //    if(myproc==0) printf("ComputeQuadraticInterp\n");
-    if(grid->nfaces[n]==3){
-      for(k=grid->ctop[n];k<grid->Nk[n];k++) {
-        // now we can compute the quadratic interpolated velocity from these results
-        ComputeQuadraticInterp(grid->xv[n], grid->yv[n], n, k, ui, 
-            vi, phys, grid, nRT2, tRT2, myproc);
-      }
-    } else {
-       // over the entire depth (cell depth)
-       for(k=grid->ctop[n];k<grid->Nk[n];k++) {
-        // over each face
-        for(nf=0;nf<grid->nfaces[n];nf++) {
-          ne = grid->face[n*grid->maxfaces+nf];
-          if(!(grid->smoothbot) || k<grid->Nke[ne]){
-            phys->uc[n][k]+=phys->u[ne][k]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-            phys->vc[n][k]+=phys->u[ne][k]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-          }
-          else{	
-            phys->uc[n][k]+=phys->u[ne][grid->Nke[ne]-1]*grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-            phys->vc[n][k]+=phys->u[ne][grid->Nke[ne]-1]*grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne];
-          }
-        }
-
-        phys->uc[n][k]/=grid->Ac[n];
-        phys->vc[n][k]/=grid->Ac[n];
-      }
-    }
-  } 
-}
-
-/*
- * Function: ComputeUCLSQ
- * Usage: ComputeUCRT(u,uc,vc,grid);
- * -------------------------------------------
- * Compute the cell-centered components of the velocity vector and place them
- * into uc and vc.  This function estimates the velocity vector with the least square method
- *
- */
-static void ComputeUCLSQ(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys){
-  int k, n, ne, nf, iptr;
-  REAL sum;
-  int ii,jj,kk;
-  REAL **A = phys->A;
-  REAL **AT = phys->AT;
-  REAL **Apr = phys->Apr;
-  REAL *bpr = phys->bpr;
-
-  // for each computational cell (non-stage defined)
-  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-    // get cell pointer transfering from boundary coordinates 
-    // to grid coordinates
-    n=grid->cellp[iptr];
-
-    // initialize over all depths
-    for(k=0;k<grid->Nk[n];k++) {
-      uc[n][k]=0;
-      vc[n][k]=0;
-    }
-    for(nf=0;nf<grid->nfaces[n];nf++) {
-
-        ne = grid->face[n*grid->maxfaces+nf];
-        
-        // Construct the normal array - A
-        A[nf][0] = grid->n1[ne];
-        A[nf][1] = grid->n2[ne];
-
-        // Construct A transpose
-        AT[0][nf] = A[nf][0];
-        AT[1][nf] = A[nf][1];
-    }
-
-    for(k=grid->ctop[n];k<grid->Nk[n];k++) {
-        
-        // Multiply A' = A^T*A 
-        // This can't be moved outside of this for loop because A' is
-        // modified by linsolve()
-        for(ii=0;ii<2;ii++){
-            for(jj=0;jj<2;jj++){
-                sum=0;
-                for(nf=0;nf<grid->nfaces[n];nf++) {
-                    sum += AT[ii][nf]*A[nf][jj];
-                }
-                Apr[ii][jj]=sum;
-            }
-        }
-        // Compute b' = A^T * b
-        for(ii=0;ii<2;ii++){
-            sum=0;
-            for(nf=0;nf<grid->nfaces[n];nf++) {
-                ne = grid->face[n*grid->maxfaces+nf];
-                if(!(grid->smoothbot) || k<grid->Nke[ne]){
-                    sum += AT[ii][nf]*u[ne][k];
-                    //sum += AT[ii][nf]*u[ne][k]*grid->dzf[ne][k];
-                } else{
-                    sum += AT[ii][nf]*u[ne][grid->Nke[ne]-1];
-                    //sum += AT[ii][nf]*u[ne][grid->Nke[ne]-1]*grid->dzf[ne][grid->Nke[ne]-1];
-                }
-            }
-            bpr[ii]=sum;
-        }
-        // Now solve the problem (A'A)x = (A'b)
-        linsolve(Apr,bpr,2);
-       
-        uc[n][k]=bpr[0];
-        vc[n][k]=bpr[1];        
-        //if (grid->dzz[n][k]  > 1e-3) {
-        //    uc[n][k]=bpr[0]/grid->dzz[n][k];
-        //    vc[n][k]=bpr[1]/grid->dzz[n][k];
-        //}else{
-        //    uc[n][k]=0;
-        //    vc[n][k]=0;
-        //}
-    }
-
-  }
-}
-
-
-/*
- * Function: ComputeQuadraticInterp
- * Usage: ComputeQuadraticInterp(U, V, un, grid, ninterp, tinterp, myproc)
- * -------------------------------------------
- * Compute the quadratic interpolation of the velocity based on
- * a choice for tinterp.
- * Two options presently exist based on choice of tinterp:
- *  1. tRT1
- *  2. tRT2
- * which are outlined in Wang et al, 2011.
- *
- */
-static void  ComputeQuadraticInterp(REAL x, REAL y, int ic, int ik, REAL **uc, 
-    REAL **vc, physT *phys, gridT *grid, interpolation ninterp, 
-    interpolation tinterp, int myproc) {
-  // this formulation considers a specific cell ic and a specific level ik
-  // for computation of uc and vc
-
-  // we need to have several pieces for this to work: 
-  // we need to be able to quickly compute the area subsets in the triangle
-  // A12, A13, A23; we need nodal velocity vectors (nRT2), and tangential
-  // velocity vectors
-  REAL points[2][grid->nfaces[ic]];
-  REAL xt[3], yt[3];
-  REAL SubArea[grid->nfaces[ic]];
-  REAL nu[grid->nfaces[ic]], nv[grid->nfaces[ic]];
-  REAL eu[grid->nfaces[ic]], ev[grid->nfaces[ic]];
-  int np[grid->nfaces[ic]], ne[grid->nfaces[ic]], nf, ie, ip;
-  const REAL TotalArea = grid->Ac[ic];
-
-  // loop over each of the faces 
-  // possible error if NUMEDGECOLUMNS != NFACES!!
-  for( nf=0; nf < grid->nfaces[ic]; nf ++) {
-    // get the index for the vertex of the cell
-    np[nf] = grid->cells[grid->maxfaces*ic + nf];
-    // get the index for the cell edge
-    ne[nf] = grid->face[grid->maxfaces*ic + nf];
-
-    // get the coordinates for the points for the vertex
-    // to compute the area of the subtriangle
-    points[0][nf] = grid->xp[np[nf]];
-    points[1][nf] = grid->yp[np[nf]];
-  }
-  // now we have the points for each node: points[x/y][nf=0,1,2]
-  // and also the edges via grid->face[NFACES*ic + nf=0,1,2] for
-  // each cell ic
-
-  // now all that remains is to store the velocities and then
-  // get A12, A13, A23 and we can 
-  // use the formula after getting the vector values for the 
-  // velocities at each of the points
-
-  for( nf=0; nf < grid->nfaces[ic]; nf++) {
-    // get the points for each vertex of the triangle
-    xt[0] = points[0][nf];
-    yt[0] = points[1][nf];
-    // wrap the next one if it goes out of bounds
-    xt[1] = points[0][(nf+1)%grid->nfaces[ic]]; 
-    yt[1] = points[1][(nf+1)%grid->nfaces[ic]];
-    // the interpolated center
-    xt[2] = x;
-    yt[2] = y;
-
-    // get the area from the points where 
-    // nf=0 => A12, nf=1 => A23, nf=2 => A13 from Wang et al 2011
-    // note that this is normalized
-    SubArea[nf] = GetArea(xt, yt, 3)/TotalArea;
-    //          printf("nf = %d Area=%e\n", nf, SubArea[nf]);
-  }
-
-  // get the nodal and edge velocities projected unto global x,y coords
-  for (nf=0; nf < grid->nfaces[ic]; nf++) {
-    // node and edge indexes
-    ip = np[nf]; ie = ne[nf];
-    // get the nodal velocity components 
-    nu[nf] = phys->nRT2u[ip][ik];
-    nv[nf] = phys->nRT2v[ip][ik];
-    // get the tangential velocity components
-    if(tinterp == tRT2) {
-      eu[nf] = phys->u[ie][ik]*grid->n1[ie] + phys->tRT2[ie][ik]*grid->n2[ie];
-      ev[nf] = phys->u[ie][ik]*grid->n2[ie] - phys->tRT2[ie][ik]*grid->n1[ie];
-    }
-    else if(tinterp == tRT1) {
-      // need to have the specific cell neighbor here!  Current implementation 
-      // is not correct.  This seems like the easiest way to make sure 
-      // that this works
-      eu[nf] = phys->u[ie][ik]*grid->n1[ie] + phys->tRT1[ie][ik]*grid->n2[ie];
-      ev[nf] = phys->u[ie][ik]*grid->n2[ie] - phys->tRT1[ie][ik]*grid->n1[ie];
-    }
-  }
-
-  // now perform interpolation from the results via Wang et al 2011 eq 12
-  uc[ic][ik] = 
-    (2*SubArea[1]-1)*SubArea[1]*nu[0] 
-    + (2*SubArea[2]-1)*SubArea[2]*nu[1]
-    + (2*SubArea[0]-1)*SubArea[0]*nu[2]
-    + 4*SubArea[2]*SubArea[1]*eu[0]
-    + 4*SubArea[0]*SubArea[2]*eu[1]
-    + 4*SubArea[0]*SubArea[1]*eu[2];
-  vc[ic][ik] = 
-    (2*SubArea[1]-1)*SubArea[1]*nv[0] 
-    + (2*SubArea[2]-1)*SubArea[2]*nv[1]
-    + (2*SubArea[0]-1)*SubArea[0]*nv[2]
-    + 4*SubArea[2]*SubArea[1]*ev[0]
-    + 4*SubArea[0]*SubArea[2]*ev[1]
-    + 4*SubArea[0]*SubArea[1]*ev[2];
-
-}
-
-/*
- * Function: ComputeTangentialVelocity
- * Usage: ComputeTangentialVelocity(phys, grid, ninterp, tinterp, myproc)
- * -------------------------------------------
- * Compute the tangential velocity from nodal velocities (interp determines type)
- * Two options presently exist based on choice of tinterp:
- *  1. tRT1
- *  2. tRT2
- * which are outlined in Wang et al, 2011.
- *
- */
-static void  ComputeTangentialVelocity(physT *phys, gridT *grid, 
-    interpolation ninterp, interpolation tinterp, int myproc) {
-  int ie, in, ic, tn, ink;
-  int nodes[2], cells[2];
-  REAL tempu, tempv, tempA; 
-  int tempnode, tempcell;
-
-
-  if(tinterp == tRT2) {
-    // for each edge, we must compute the value of its tangential velocity 
-    for(ie = 0; ie < grid->Ne; ie++) {
-
-      // get the nodes on either side of the edge
-      nodes[0] = grid->edges[NUMEDGECOLUMNS*ie];
-      nodes[1] = grid->edges[NUMEDGECOLUMNS*ie+1];
-      //     printf("nodes = %d %d\n", nodes[0], nodes[1]);
-
-      // for each layer at the edge
-      for (ink = 0; ink < grid->Nkc[ie]; ink++) {
-        // initialize temporary values
-        tempu = tempv = tempA = 0;
-
-        // for each node
-        for (in = 0; in < 2; in++) {
-          // get particular value for node 
-          tempnode = nodes[in];
-
-          // ensure that the node exists at the level 
-          // before continuing
-          if(ink < grid->Nkp[tempnode]) {
-            // accumulate the velocity area-weighted values and 
-            // cell area
-            tempA += grid->Actotal[tempnode][ink];
-            tempu += grid->Actotal[tempnode][ink]*phys->nRT2u[tempnode][ink];
-            tempv += grid->Actotal[tempnode][ink]*phys->nRT2v[tempnode][ink];
-          }
-        }
-        // area-average existing nodal velocities
-        if(tempA == 0) {
-          phys->tRT2[ie][ink] = 0;
-        }
-        else {
-          tempu /= tempA;
-          tempv /= tempA;
-          // get the correct component in the tangential direction to store it
-          phys->tRT2[ie][ink] = grid->n2[ie]*tempu - grid->n1[ie]*tempv;
-        }
-      }
-
-    }
-
-  }
-}
-
-/*
- * Function: ComputeNodalVelocity
- * Usage: ComputeNodalVelocity(phys, grid, interp, myproc)
- * -------------------------------------------
- * Compute the nodal velocity using RT0 basis functions.  
- * Two options presently exist based on choice of interp:
- *  1. nRT1
- *  2. nRT2
- * which are outlined in Wang et al, 2011.
- *
- */
-static void ComputeNodalVelocity(physT *phys, gridT *grid, interpolation interp, int myproc) {
-  //  int in, ink, e1, e2, cell, cp1, cp2;
-  int in, ink, inpc, ie, intemp, cell, cp1, cp2,
-      e1, e2, n1, n2, onode;
-  REAL tempu, tempv, Atemp, tempAu, tempAv;
-
-
-  /* compute the nodal velocity for RT1 elements */
-  // for each node compute its nodal value
-  for(in = 0; in < grid->Np; in++) {/*{{{*/
-    // there are Nkp vertical layers for each node, so much compute over each 
-    // of these
-
-    for(ink = 0; ink < grid->Nkp[in]; ink++) {
-      // there will be numpcneighs values for each node at a
-      //particular layer so we must compute each separately
-
-      if(interp == nRT2) { Atemp = tempAu = tempAv = 0; }
-      for(inpc = 0; inpc < grid->numpcneighs[in]; inpc++) {
-
-        // check to make sure that the cell under consideration exists at the given z-level
-        if (ink < grid->Nk[grid->pcneighs[in][inpc]]) { 
-          // if so get neighbors to the node
-          e1 = grid->peneighs[in][2*inpc];
-          e2 = grid->peneighs[in][2*inpc+1];
-
-          // compute the RT0 reconstructed nodal value for the edges
-          ComputeRT0Velocity(&tempu, &tempv, 
-              grid->n1[e1], grid->n2[e1], grid->n1[e2], grid->n2[e2], phys->u[e1][ink], phys->u[e2][ink]);
-
-          // store the computed values
-          phys->nRT1u[in][ink][inpc] = tempu;
-          phys->nRT1v[in][ink][inpc] = tempv;
-          if(interp == nRT2) {
-            // accumulate area and weighted values
-            Atemp += grid->Ac[grid->pcneighs[in][inpc]];
-            tempAu += grid->Ac[grid->pcneighs[in][inpc]]*tempu;
-            tempAv += grid->Ac[grid->pcneighs[in][inpc]]*tempv;
-          }
-
-        } 
-        else { // cell neighbor doesn't exist at this level
-          phys->nRT1u[in][ink][inpc] = 0;
-          phys->nRT1v[in][ink][inpc] = 0;
-        }
-      }
-      // compute nRT2 from nRT1 values if desired  (area-weighted average of all cells)
-      if(interp == nRT2) {
-        if(Atemp == 0) {
-          printf("Error as Atemp is 0 in nodal calc!! at in,ink,Nkp=%d,%d,%d\n",in, ink, grid->Nkp[in]);
-          // print all nodal neighbors
-          printf("cell neighbors = ");
-          for(inpc = 0; inpc < grid->numpcneighs[in]; inpc++) {
-            printf(" %d(%d)", grid->pcneighs[in][inpc], grid->Nk[grid->pcneighs[in][inpc]]);
-
-          }
-          printf("\n");
-
-        }
-        /* now we can compute the area-averaged values with nRT1 elements */
-        phys->nRT2u[in][ink] = tempAu/Atemp;
-        phys->nRT2v[in][ink] = tempAv/Atemp;
-      }
-    }
-  }
-}
-
-/*
- * Function: ComputeRT0Velocity
- * Usage: ComputeRT0Velocity(REAL* tempu, REAL* tempv, int e1, int e2, physT* phys);
- * -------------------------------------------
- * Compute the nodal velocity using RT0 basis functions (Appendix B, Wang et al 2011)
- *
- */
-static void ComputeRT0Velocity(REAL *tempu, REAL *tempv, REAL e1n1, REAL e1n2, 
-    REAL e2n1, REAL e2n2, REAL Uj1, REAL Uj2) 
-{
-  const REAL det = e1n1*e2n2 - e1n2*e2n1;
-  // compute using the basis functions directly with inverted 2x2 matrix
-  *tempu = (e2n2*Uj1 - e1n2*Uj2)/det;
-  *tempv = (e1n1*Uj2 - e2n1*Uj1)/det;
-}
-
 /*
  * Function: HFaceFlux
  * Usage: HFaceFlux(j,k,phi,phys->u,grid,prop->dt,prop->nonlinear);
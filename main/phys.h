@@ -28,6 +28,12 @@ typedef enum _interpolation {
   QUAD, PEROT, LSQ
 } interpolation;
 
+// kernels of the time step that can be run in isolation with RunKernel
+typedef enum _kernelT {
+  KERNELHCOEFFICIENTS, KERNELOPERATORH, KERNELCGSOLVE, KERNELCGSOLVEQ,
+  KERNELHORIZONTALSOURCE, KERNELUPDATESCALARS, KERNELEDDYVISCOSITY
+} kernelT;
+
 /*
  * Main physical variable struct.
  *
@@ -72,6 +78,18 @@ typedef struct _physT {
   REAL *h;
   REAL *hcorr;
   unsigned char *active;
+
+  // Lists of the active cells and edges for activelists=1 (see UpdateActiveLists).
+  // wetcellp and wetedgep hold the active entries of grid->cellp and grid->edgep,
+  // split by wetcelldist and wetedgedist in the same way, and wetcellptr their
+  // positions in grid->cellp.  wetcells and wetedges hold the active cells and
+  // edges in natural order, and deepcells the active computational cells with
+  // more than one layer.
+  int *wetcellp, *wetcellptr, wetcelldist[MAXBCTYPES-1];
+  int *wetedgep, wetedgedist[MAXMARKS-1];
+  int *wetcells, *wetedges, *deepcells, Ncwet, Newet, Ncdeep;
+  unsigned char *cellflags, *edgeflags; // LIST_* flags below
+  int listschanged; // a LIST_WET or LIST_DEEP flag changed since the lists were built
   
   REAL **boundary_u;
   REAL **boundary_v;
@@ -97,12 +115,12 @@ typedef struct _physT {
   REAL **qT_old; //store qT^n-1
   REAL **lT_old; // store lT^n-1
 
-  REAL mass;
-  REAL mass0;
-  REAL volume;
-  REAL volume0;
-  REAL Ep;
-  REAL Ep0;
+  DREAL mass;
+  DREAL mass0;
+  DREAL volume;
+  DREAL volume0;
+  DREAL Ep;
+  DREAL Ep0;
   REAL Ek;
   REAL Eflux1;
   REAL Eflux2;
@@ -117,6 +135,14 @@ typedef struct _physT {
   REAL *h_old;
   REAL *htmp2;
   REAL *htmp3;
+  DREAL *hcg;  // vectors of the free-surface solver, 5*Nc (see CGSolve)
+  // Single-precision copy of the nonhydrostatic pressure operator for qmixed=1 (see CGSolveQMixed).
+  // The column of cell i starts at qstart[i] and the arrays are indexed with qstart[i]+k.
+  int *qstart;
+  float *qdiag, *qlower, *qupper, *qvert; // diagonal, k-1, k+1 and vertical part of the diagonal
+  float *qface;  // coefficients of the neighbors, maxfaces per layer
+  float *qcg;    // vectors of the inner solver, 5*qstart[Nc]
+  float *qtri;   // work arrays of the tridiagonal preconditioner, 4*(Nkmax+1)
   REAL *hcoef;
   REAL *hfcoef;
   REAL **stmp;
@@ -142,6 +168,7 @@ typedef struct _physT {
   REAL *user_def_nc;
   REAL **user_def_nc_nk;
   REAL **qtmp;
+  struct _turbulenceT *turbulence; // work space of the turbulence models (see turbulence.h)
   //GLS Turbulence variables
   REAL **TP;
   REAL **TB;
@@ -189,32 +216,42 @@ typedef struct _physT {
 
 } physT;
 
+// Flags of the cells and edges in the active lists
+#define LIST_WET 1     // deeper than BUFFERHEIGHT
+#define LIST_DEEP 2    // more than one layer below the free surface
+#define LIST_HALO 4    // exchanged with another processor, always active
+#define LIST_ACTIVE 8  // in the active lists
+
 /*
  * Main property struct.
  *
  */
 typedef struct _propT {
-  REAL dt, Cmax, rtime, amp, omega, flux, timescale, theta0, theta, thetaM, 
-       thetaS, thetaB, nu, nu_H, tau_T, z0T, CdT, z0B, CdB, CdW, relax, epsilon, qepsilon, resnorm, 
+  REAL dt, Cmax, amp, omega, flux, timescale, theta0, theta, thetaM, 
+       thetaS, thetaB, nu, nu_H, tau_T, z0T, CdT, z0B, CdB, CdW, relax, epsilon, qepsilon, qmixedepsilon, resnorm, 
        dzsmall, beta, kappa_s, kappa_sH, gamma, kappa_T, kappa_TH, grav, Coriolis_f, CmaxU, CmaxW, 
        laxWendroff_Vertical, latitude,exfac1,exfac2,exfac3,imfac1,imfac2,imfac3;
   int ntout, ntoutStore, ntprog, nsteps, nstart, n, ntconserve, nonhydrostatic, cgsolver, maxiters, 
-      qmaxiters, hprecond, qprecond, volcheck, masscheck, nonlinear,im, linearFS, newcells, wetdry, sponge_distance,subgrid,
+      qmaxiters, hprecond, qprecond, qmixed, volcheck, masscheck, nonlinear,im, linearFS, newcells, wetdry, activelists, sponge_distance,subgrid,
     sponge_decay, thetaramptime, readSalinity, readTemperature, turbmodel, 
     TVD, horiTVD, vertTVD, TVDsalt, TVDtemp, TVDturb, laxWendroff, stairstep, ex, TVDmomentum, conserveMomentum,
-    mergeArrays, computeSediments,Intz0B, Intz0T, marshmodel,wavemodel,culvertmodel,vertcoord;
+    mergeArrays, computeSediments,Intz0B, Intz0T, marshmodel,wavemodel,culvertmodel,vertcoord,
+    checkmode, checkinterval, adaptivedt, outputsummary;
+  int cgsolves, cgiters, cgmaxn, qcgsolves, qcgiters, qcgmaxn; // iterations of the free-surface and pressure solves
+  DREAL rtime; // simulation time, in double precision for all builds
   FILE *CdBFID, *CdTFID, *FreeSurfaceFID, *HorizontalVelocityFID, *VerticalVelocityFID, *SalinityFID, *BGSalinityFID, 
        *InitSalinityFID, *InitTemperatureFID, *TemperatureFID, *PressureFID, *VerticalGridFID, *ConserveFID,    
        *StoreFID, *StartFID, *EddyViscosityFID, *ScalarDiffusivityFID, *UserDefVarFID; 
   interpolation interp; 
   int prettyplot;
   int kinterp;
-  int metmodel,  varmodel, outputNetcdf,  metncid, netcdfBdy, netcdfBdyFileID, readinitialnc, initialNCfileID, calcage, agemethod, calcaverage;
+  int metmodel,  varmodel, metgrid, metnearest, varylatitude, outputNetcdf,  metncid, netcdfBdy, netcdfBdyFileID, tideforcing, tidenodal, readinitialnc, initialNCfileID, calcage, agemethod, calcaverage;
   int outputNetcdfFileID, averageNetcdfFileID;
   int output_user_var;
-  REAL nctime, toffSet, gmtoffset;
+  DREAL nctime, toffSet, gmtoffset;
   int nctimectr, avgtimectr, avgctr, avgfilectr, ntaverage, nstepsperncfile, ncfilectr;
-  REAL nugget, sill, range, Lsw, Cda, Ce, Ch;
+  int ncdeflate, ncshuffle, nczstd, ncfloat, ncsigdigits, ncchunkcells;
+  REAL nugget, sill, range, metradius, Lsw, Cda, Ce, Ch;
   char  starttime[15], basetime[15]; 
   char  INPUTZ0BFILE[BUFFERLENGTH], INPUTZ0TFILE[BUFFERLENGTH];
 } propT;
@@ -235,7 +272,14 @@ REAL DepthFromDZ(gridT *grid, physT *phys, int i, int kind);
 REAL InterpToFace(int j, int k, REAL **phi, REAL **u, gridT *grid);
 void ComputeUC(REAL **ui, REAL **vi, physT *phys, gridT *grid, int myproc, interpolation interp,int kinterp,int subgridmodel) ;
 void UpdateDZ(gridT *grid, physT *phys, propT *prop, int option);
+void UpdateActiveLists(gridT *grid, physT *phys, propT *prop, int rebuild);
 void ComputeConservatives(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 void SetDensity(gridT *grid, physT *phys, propT *prop);
+void RunKernel(kernelT kernel, gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
+// Operators of the nonhydrostatic pressure solve, also used by CGSolveQMixed in mixedcg.c
+void ConditionQ(REAL **x, gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm);
+void QCoefficients(REAL **coef, REAL **fcoef, REAL **c, gridT *grid, physT *phys, propT *prop);
+void OperatorQ(REAL **coef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop);
+void OperatorQC(REAL **coef, REAL **fcoef, REAL **x, REAL **y, REAL **c, gridT *grid, physT *phys, propT *prop);
 
 #endif
@@ -15,6 +15,8 @@
 #include "merge.h"
 #include "mynetcdf.h"
 #include "sendrecv.h"
+#include "timestep.h"
+#include "timer.h"
 
 /************************************************************************/
 /*                                                                      */
@@ -257,13 +259,13 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
   REAL *tmp = (REAL *)SunMalloc(grid->Ne*sizeof(REAL),"OutputData"), 
     *array2DPointer, **array3DPointer;
   FILE *ofile,*ofile1;
-  if(!(prop->n%prop->ntconserve) && !blowup) {
+  if(IntervalDue(prop,prop->ntconserve) && !blowup) {
     ComputeConservatives(grid,phys,prop,myproc,numprocs,comm);
     if(myproc==0)
       fprintf(prop->ConserveFID,"%e %e %e %e %e %e %e %e\n",prop->rtime,phys->mass,phys->volume,
           phys->Ep-phys->Ep0,phys->Eflux1,phys->Eflux2,phys->Eflux3,phys->Eflux4);
   }
-  if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart || blowup) {
+  if(OutputRecordDue(prop,blowup)) {
     
     if(myproc==0 && VERBOSE>1) {
       if(!blowup)  
@@ -272,8 +274,10 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
         printf("Outputting blowup data at step %d of %d\n",prop->n,prop->nsteps+prop->nstart);
     }
 
-    Write2DData(phys->h,prop->mergeArrays,prop->FreeSurfaceFID,"Error outputting free-surface data!\n",
-    		grid,numprocs,myproc,comm);
+    // Each file is written every ntout_<variable> steps (see outputplan.c)
+    if(OutputDue(prop,"eta",blowup))
+      Write2DData(phys->h,prop->mergeArrays,prop->FreeSurfaceFID,"Error outputting free-surface data!\n",
+		  grid,numprocs,myproc,comm);
 
     // compute quadratic interpolated estimates for velocity using pretty plot and don't redo work
     if(prop->prettyplot==1 && prop->interp != QUAD) {
@@ -289,20 +293,23 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
               "Error outputting user_def_nc_nk data!\n",grid,numprocs,myproc,comm);            
 
     // Output u, v, w.  Interpolate w from faces to obtain it at the cell-centers first
-    for(i=0;i<grid->Nc;i++)
-      for(k=0;k<grid->Nk[i];k++)
-	phys->stmp2[i][k]=0.5*(phys->w[i][k]+phys->w[i][k+1]);
-
-    Write3DData(phys->uc,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
-		"Error outputting uc-data!\n",grid,numprocs,myproc,comm);
-    Write3DData(phys->vc,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
-		"Error outputting vc-data!\n",grid,numprocs,myproc,comm);
-    Write3DData(phys->stmp2,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
-		"Error outputting wc-data!\n",grid,numprocs,myproc,comm);
+    if(OutputDue(prop,"uc",blowup)) {
+      for(i=0;i<grid->Nc;i++)
+	for(k=0;k<grid->Nk[i];k++)
+	  phys->stmp2[i][k]=0.5*(phys->w[i][k]+phys->w[i][k+1]);
+
+      Write3DData(phys->uc,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
+		  "Error outputting uc-data!\n",grid,numprocs,myproc,comm);
+      Write3DData(phys->vc,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
+		  "Error outputting vc-data!\n",grid,numprocs,myproc,comm);
+      Write3DData(phys->stmp2,phys->htmp,prop->mergeArrays,prop->HorizontalVelocityFID,
+		  "Error outputting wc-data!\n",grid,numprocs,myproc,comm);
+    }
 
     // Output face-centered vertical velocity data
-    Write3DData(phys->w,phys->htmp,prop->mergeArrays,prop->VerticalVelocityFID,
-		"Error outputting vertical velocity data!\n",grid,numprocs,myproc,comm);
+    if(OutputDue(prop,"w",blowup))
+      Write3DData(phys->w,phys->htmp,prop->mergeArrays,prop->VerticalVelocityFID,
+		  "Error outputting vertical velocity data!\n",grid,numprocs,myproc,comm);
 
     // Background salinity field
     if(prop->n==1+prop->nstart)
@@ -310,23 +317,28 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
 		  "Error outputting background salinity data!\n",grid,numprocs,myproc,comm);
 
     // Salinity field
-    Write3DData(phys->s,phys->htmp,prop->mergeArrays,prop->SalinityFID,
-		"Error outputting salinity data!\n",grid,numprocs,myproc,comm);
+    if(OutputDue(prop,"salt",blowup))
+      Write3DData(phys->s,phys->htmp,prop->mergeArrays,prop->SalinityFID,
+		  "Error outputting salinity data!\n",grid,numprocs,myproc,comm);
 
     // Temperature field
-    Write3DData(phys->T,phys->htmp,prop->mergeArrays,prop->TemperatureFID,
-		"Error outputting temperature data!\n",grid,numprocs,myproc,comm);
+    if(OutputDue(prop,"temp",blowup))
+      Write3DData(phys->T,phys->htmp,prop->mergeArrays,prop->TemperatureFID,
+		  "Error outputting temperature data!\n",grid,numprocs,myproc,comm);
 
     // Nonhydrostatic pressure
-    Write3DData(phys->q,phys->htmp,prop->mergeArrays,prop->PressureFID,
-		"Error outputting nonhydrostatic pressure data!\n",grid,numprocs,myproc,comm);
+    if(OutputDue(prop,"q",blowup))
+      Write3DData(phys->q,phys->htmp,prop->mergeArrays,prop->PressureFID,
+		  "Error outputting nonhydrostatic pressure data!\n",grid,numprocs,myproc,comm);
 
     if(prop->turbmodel) {
       // Eddy-viscosity
-      Write3DData(phys->nu_tv,phys->htmp,prop->mergeArrays,prop->EddyViscosityFID,
-		  "Error outputting eddy-viscosity data!\n",grid,numprocs,myproc,comm);
-      Write3DData(phys->kappa_tv,phys->htmp,prop->mergeArrays,prop->ScalarDiffusivityFID,
-		  "Error outputting scalar-diffusivity data!\n",grid,numprocs,myproc,comm);
+      if(OutputDue(prop,"nu_v",blowup))
+	Write3DData(phys->nu_tv,phys->htmp,prop->mergeArrays,prop->EddyViscosityFID,
+		    "Error outputting eddy-viscosity data!\n",grid,numprocs,myproc,comm);
+      if(OutputDue(prop,"kappa_tv",blowup))
+	Write3DData(phys->kappa_tv,phys->htmp,prop->mergeArrays,prop->ScalarDiffusivityFID,
+		    "Error outputting scalar-diffusivity data!\n",grid,numprocs,myproc,comm);
     }
 
     // No longer outputting vertical grid data
@@ -347,7 +359,7 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
   }
 
   // probably should change to make a distinction between blowup and restarts
-  if(!(prop->n%prop->ntoutStore) || blowup) {
+  if(IntervalDue(prop,prop->ntoutStore) || blowup) {
     if(VERBOSE>1 && myproc==0) 
       printf("Outputting restart data at step %d\n",prop->n);
 
@@ -356,6 +368,7 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
     prop->StoreFID = MPI_FOpen(str,"w","OpenFiles",myproc);
 
     nwritten=fwrite(&(prop->n),sizeof(int),1,prop->StoreFID);
+    StoreTimeStep(prop,prop->StoreFID);
 
     fwrite(phys->h,sizeof(REAL),grid->Nc,prop->StoreFID);
     fwrite(phys->h_old,sizeof(REAL),grid->Nc,prop->StoreFID);
@@ -431,6 +444,10 @@ void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop,int myproc, i
       for(j=0;j<sediments->Nsize;j++)
         for(i=0;i<grid->Nc;i++) 
           fwrite(sediments->Layerthickness[j][i],sizeof(REAL),sediments->Nlayer,prop->StoreFID);      
+      // bed fluxes accumulated since the last bed update (see BedChange)
+      for(j=0;j<sediments->Nsize;j++)
+        for(i=0;i<grid->Nc;i++) 
+          fwrite(sediments->Bedflux[j][i],sizeof(REAL),sediments->Nlayer,prop->StoreFID);
     }
 
     // add new part for new vertical coordinate restart data
@@ -475,6 +492,7 @@ void ReadPhysicalVariables(gridT *grid, physT *phys, propT *prop, int myproc, MP
 
   if(fread(&(prop->nstart),sizeof(int),1,prop->StartFID) != 1)
     printf("Error reading prop->nstart\n");
+  ReadTimeStep(prop,prop->StartFID);
 
   if(fread(phys->h,sizeof(REAL),grid->Nc,prop->StartFID) != grid->Nc)
     printf("Error reading phys->h\n");
@@ -591,8 +609,14 @@ void ReadPhysicalVariables(gridT *grid, physT *phys, propT *prop, int myproc, MP
     // read layerthickness for each fraction
     for(j=0;j<sediments->Nsize;j++)
       for(i=0;i<grid->Nc;i++)      
-        if(fread(sediments->Layerthickness[j][i],sizeof(REAL),grid->Nc,prop->StartFID)!= sediments->Nlayer)
+        if(fread(sediments->Layerthickness[j][i],sizeof(REAL),sediments->Nlayer,prop->StartFID)!= sediments->Nlayer)
           printf("Error reading sediments->Layerthickness[i]\n");
+
+    // read the bed fluxes that are pending since the last bed update
+    for(j=0;j<sediments->Nsize;j++)
+      for(i=0;i<grid->Nc;i++)      
+        if(fread(sediments->Bedflux[j][i],sizeof(REAL),sediments->Nlayer,prop->StartFID)!= sediments->Nlayer)
+          printf("Error reading sediments->Bedflux[i]\n");
     
     // setup sediment bed model part
     ComputeSedimentsBedRestart(grid,phys,prop,myproc);
@@ -635,3 +659,113 @@ void ReadPhysicalVariables(gridT *grid, physT *phys, propT *prop, int myproc, MP
   // Set the density from s and T using the equation of state
   SetDensity(grid,phys,prop);
 }
+
+/*
+ * Function: OutputSummary
+ * Usage: OutputSummary(grid,phys,prop,myproc,numprocs,comm);
+ * ----------------------------------------------------------
+ * Write a summary of the run to SummaryFile (default summary.dat) with one
+ * "name value" pair per line, i.e.
+ *
+ *   numprocs, cells, cell_layers, steps    size of the run
+ *   precision                              single or double (see REAL in suntans.h)
+ *   t_sim, t_source, t_predictor, ...      timers of timer.h, maximum over the processors
+ *   cg_solves, cg_iters, cg_maxiters       iterations of the free-surface solver
+ *   qcg_solves, qcg_iters, qcg_maxiters    iterations of the pressure solver
+ *   <field>_mean, _rms, _max               area (eta) or volume-weighted mean and rms and
+ *                                          the maximum absolute value of eta, uc, vc, w, salt,
+ *                                          temp, q and the eddy viscosity nut at the last step
+ *
+ * which is used by examples/regression to compare runs against references.
+ *
+ */
+void OutputSummary(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm)
+{
+  int i, iptr, k, m, nf, status, count[2], allcount[2];
+  REAL v, w, vmax, allvmax;
+  DREAL timers[10], alltimers[10], sums[3], allsums[3];
+  char str[BUFFERLENGTH], filename[BUFFERLENGTH];
+  char *timernames[] = {"t_sim", "t_source", "t_predictor", "t_nonhydro", "t_transport",
+                        "t_turb", "t_check", "t_io", "t_comm", "t_rem"};
+  char *fields[] = {"eta", "uc", "vc", "w", "salt", "temp", "q", "nut"};
+  REAL **field3d[] = {NULL, phys->uc, phys->vc, phys->w, phys->s, phys->T, phys->q, phys->nu_tv};
+  FILE *ofile;
+
+  timers[0]=Timer()-t_start;
+  timers[1]=t_source;
+  timers[2]=t_predictor;
+  timers[3]=t_nonhydro;
+  timers[4]=t_transport;
+  timers[5]=t_turb;
+  timers[6]=t_check;
+  timers[7]=t_io;
+  timers[8]=t_comm;
+  timers[9]=timers[0]-t_source-t_predictor-t_nonhydro-t_transport-t_turb-t_check-t_io;
+  MPI_Reduce(timers,alltimers,10,MPI_DOUBLE,MPI_MAX,0,comm);
+
+  count[0]=count[1]=0;
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    count[0]++;
+    count[1]+=grid->Nk[i]-grid->ctop[i];
+  }
+  MPI_Reduce(count,allcount,2,MPI_INT,MPI_SUM,0,comm);
+
+  if(myproc==0) {
+    GetString(str,DATAFILE,"SummaryFile",&status);
+    if(status)
+      MPI_GetFile(filename,DATAFILE,"SummaryFile","OutputSummary",myproc);
+    else if(snprintf(filename,BUFFERLENGTH,"%s/%s",DATADIR,DEFAULTSUMMARYFILE)>=BUFFERLENGTH) {
+      printf("Error in OutputSummary: the path of %s is longer than %d characters.\n",DEFAULTSUMMARYFILE,BUFFERLENGTH-1);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    ofile = MPI_FOpen(filename,"w","OutputSummary",myproc);
+
+    fprintf(ofile,"numprocs %d\ncells %d\ncell_layers %d\nsteps %d\n",numprocs,allcount[0],allcount[1],
+        prop->n-prop->nstart);
+    fprintf(ofile,"precision %s\n",sizeof(REAL)==sizeof(float)?"single":"double");
+    for(m=0;m<10;m++)
+      fprintf(ofile,"%s %.6e\n",timernames[m],alltimers[m]);
+    fprintf(ofile,"cg_solves %d\ncg_iters %d\ncg_maxiters %d\n",prop->cgsolves,prop->cgiters,prop->cgmaxn);
+    fprintf(ofile,"qcg_solves %d\nqcg_iters %d\nqcg_maxiters %d\n",prop->qcgsolves,prop->qcgiters,prop->qcgmaxn);
+  }
+
+  for(nf=0;nf<8;nf++) {
+    sums[0]=sums[1]=sums[2]=0;
+    vmax=0;
+    for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+      i = grid->cellp[iptr];
+      if(!field3d[nf]) {
+        v=phys->h[i];
+        sums[0]+=grid->Ac[i];
+        sums[1]+=grid->Ac[i]*v;
+        sums[2]+=grid->Ac[i]*v*v;
+        vmax=Max(vmax,fabs(v));
+      } else
+        for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+          // w is at the faces so use its cell-centered value
+          v=field3d[nf]==phys->w?0.5*(phys->w[i][k]+phys->w[i][k+1]):field3d[nf][i][k];
+          w=grid->Ac[i]*grid->dzz[i][k];
+          sums[0]+=w;
+          sums[1]+=w*v;
+          sums[2]+=w*v*v;
+          vmax=Max(vmax,fabs(v));
+        }
+    }
+    MPI_Reduce(sums,allsums,3,MPI_DOUBLE,MPI_SUM,0,comm);
+    MPI_Reduce(&vmax,&allvmax,1,MPI_REALTYPE,MPI_MAX,0,comm);
+
+    if(myproc==0) {
+      if(allsums[0]>0) {
+        allsums[1]/=allsums[0];
+        allsums[2]=sqrt(allsums[2]/allsums[0]);
+      }
+      fprintf(ofile,"%s_mean %.15e\n%s_rms %.15e\n%s_max %.15e\n",fields[nf],allsums[1],
+          fields[nf],allsums[2],fields[nf],allvmax);
+    }
+  }
+
+  if(myproc==0)
+    fclose(ofile);
+}
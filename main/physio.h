@@ -17,6 +17,8 @@
 #include "grid.h"
 #include "mympi.h"
 
+#define DEFAULTSUMMARYFILE "summary.dat"
+
 void Write2DData(REAL *array, int merge, FILE *fid, char *error_message, 
 		 gridT *grid, int numprocs, int myproc, MPI_Comm comm);
 void Write3DData(REAL **array, REAL *temp_array, int merge, FILE *fid, char *error_message, 
@@ -25,5 +27,6 @@ void OpenFiles(propT *prop, int myproc);
 void ReadPhysicalVariables(gridT *grid, physT *phys, propT *prop, int myproc, MPI_Comm comm);
 void OutputPhysicalVariables(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, 
 			     int blowup, MPI_Comm comm);
+void OutputSummary(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 
 #endif
@@ -18,15 +18,14 @@
 #include "suntans.h"
 #include "profiles.h"
 #include "sediments.h"
+#include "kdtree.h"
+#include "timestep.h"
 
 /*
  * All functions are private except for InterpData which is called from phys.c
  *
  */
 void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int myproc);
-static int IsOnGrid(REAL x, REAL y, REAL *xp, REAL *yp, 
-		    int *cells, int *celldist, int *cellp, int *nfaces, int maxfaces, int Np, int Nc);
-static int InPolygon(REAL x, REAL y, REAL *xg, REAL *yg, int N);
 static void OpenDataFiles(int myproc);
 static void CloseDataFiles(void);
 static void AllInitialWriteToFiles(gridT *grid, propT *prop, MPI_Comm comm, int numprocs, int myproc);
@@ -108,7 +107,7 @@ void InterpData(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numpro
   }
 
   // Output the profile data at the frequency specified by ntoutProfs
-  if(existProfs && !(prop->n%ntoutProfs)) 
+  if(existProfs && IntervalDue(prop,ntoutProfs)) 
     WriteAllProfileData(grid,phys,prop,comm,numprocs,myproc);
 
   // Free up arrays associated with the profile data and close the
@@ -129,10 +128,11 @@ void InterpData(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int numpro
  *
  */
 void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int myproc) {
-  int i, ni, Ndata, Np, *cells, nf, total2dtemp, total3dtemp, proc, tempSum;
-  REAL x, y, *xp, *yp;
+  int i, j, total2dtemp, total3dtemp, proc, tempSum;
+  REAL x, y, *dist2;
   char filename[BUFFERLENGTH], str[BUFFERLENGTH];
   FILE *ifid;
+  kdtreeT *celltree, *alltree;
 
   // Get ntoutProfs, which is the frequency that output profiles is desired
   ntoutProfs = MPI_GetValue(DATAFILE,"ntoutProfs","InitializeOutputIndices",myproc);
@@ -146,41 +146,10 @@ void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int mypro
   // Number of nearest neighbors required for the interpolation
   numInterpPoints = MPI_GetValue(DATAFILE,"numInterpPoints","InitializeOutputIndices",myproc);
 
-  // Read in the cells data for this proc since it is not available anymore
-  // as part of the grid struct.
-  MPI_GetFile(str,DATAFILE,"cells","InitializeOutputIndices",myproc);
-  sprintf(filename,"%s.%d",str,myproc);
-
-  cells = (int *)SunMalloc(grid->maxfaces*grid->Nc*sizeof(int),"InitializeOutputIndices");
-
-  ifid = fopen(filename,"r");
-  for(i=0;i<grid->Nc;i++) {
-    getfield(ifid,str);
-    getfield(ifid,str);
-    getfield(ifid,str);
-    for(nf=0;nf<grid->nfaces[i];nf++) {
-      cells[i*grid->maxfaces+nf]=(int)getfield(ifid,str);
-      //printf("%d,%d\n",(i*grid->maxfaces+nf),cells[i*grid->maxfaces+nf]);
-    }
-    for(nf=0;nf<grid->nfaces[i];nf++)
-      getfield(ifid,str);
-  }
-  fclose(ifid);
-
-  // Points are also not avialable anymore in the grid struct.
-  MPI_GetFile(filename,DATAFILE,"points","InitializeOutputIndices",myproc);
-  Np = MPI_GetSize(filename,"InitializeOutputIndices",myproc);
-
-  xp = (REAL *)SunMalloc(Np*sizeof(REAL),"InitializeOutputIndices");
-  yp = (REAL *)SunMalloc(Np*sizeof(REAL),"InitializeOutputIndices");
-
-  ifid=fopen(filename,"r");
-  for(i=0;i<Np;i++) {
-    xp[i]=getfield(ifid,str);
-    yp[i]=getfield(ifid,str);
-    getfield(ifid,str);
-  }
-  fclose(ifid);
+  // Spatial indices of the computational cells, used to find the cell containing each
+  // point, and of all cells, used for the nearest neighbors.
+  celltree = KDTreeBuildCells(grid);
+  alltree = KDTreeBuild(grid->xv,grid->yv,NULL,grid->Nc);
 
   // Load in the x-y coordinates of the profile locations.
   MPI_GetFile(filename,DATAFILE,"DataLocations","InitializeOutputIndices",myproc);
@@ -197,7 +166,7 @@ void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int mypro
   for(i=0;i<numTotalDataPoints;i++) {
     x = getfield(ifid,str);
     y = getfield(ifid,str);
-    if(IsOnGrid(x,y,xp,yp,cells,grid->celldist,grid->cellp,grid->nfaces,grid->maxfaces,Np,grid->Nc)) {
+    if(KDTreeLocateCell(celltree,grid,x,y)!=-1) {
       dataIndices[numLocalDataPoints]=i;
       dataXY[2*numLocalDataPoints]=x;
       dataXY[2*numLocalDataPoints+1]=y;
@@ -216,10 +185,14 @@ void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int mypro
 
   // Now determine the indices for the interpolation using a nearest-neighbor search.
   interpIndices = (int *)SunMalloc(numInterpPoints*numLocalDataPoints*sizeof(int),"InitializeOutputIndices");
+  dist2 = (REAL *)SunMalloc(numInterpPoints*sizeof(REAL),"InitializeOutputIndices");
 
-  for(i=0;i<numLocalDataPoints;i++) 
-    FindNearest(&(interpIndices[i*numInterpPoints]),grid->xv,grid->yv,grid->Nc,
-    		numInterpPoints,dataXY[2*i],dataXY[2*i+1]);
+  for(i=0;i<numLocalDataPoints;i++) {
+    for(j=0;j<numInterpPoints;j++)
+      interpIndices[i*numInterpPoints+j]=-1;
+    KDTreeKNearest(alltree,dataXY[2*i],dataXY[2*i+1],numInterpPoints,
+		   &(interpIndices[i*numInterpPoints]),dist2);
+  }
 
   // Processor 0 needs to know about everyones sizes.  total2d stores the
   // number of points that are output in two dimensions on each processor, while total3d stores
@@ -262,63 +235,10 @@ void InitializeOutputIndices(gridT *grid, MPI_Comm comm, int numprocs, int mypro
   merge_tmp = (REAL *)SunMalloc(3*all2d*NkmaxProfs*sizeof(REAL),"WriteAllProfileData");
   merge_tmp2 = (REAL *)SunMalloc(3*all2d*NkmaxProfs*sizeof(REAL),"WriteAllProfileData");
 
-  // Only free up space associated with the grid since this is no longer needed.
-  SunFree(xp,Np*sizeof(REAL),"InitializeOutputIndices");
-  SunFree(yp,Np*sizeof(REAL),"InitializeOutputIndices");
-  SunFree(cells,grid->maxfaces*grid->Nc*sizeof(int),"InitializeOutputIndices");
-}
-
-/*
- * Function: IsOnGrid
- * Usage: if(IsOnGrid(x,y,xp,yp,cells,grid->celldist,grid->cellp,Np,grid->Nc)) {} ...
- * ----------------------------------------------------------------------------------
- * Determines if the point (x,y) is on the grid associated with the current processor.
- * If so, it returns 1, otherwise 0.
- *
- */
-static int IsOnGrid(REAL x, REAL y, REAL *xp, REAL *yp, int *cells, int *celldist, int *cellp, int *nfaces, int maxfaces, int Np, int Nc) {
-  int i, iptr, nf;
-  REAL xg[maxfaces], yg[maxfaces];
-
-  // Need to make sure only check the computational cells, not the interprocessor boundary
-  // cells.
-  for(iptr=celldist[0];iptr<celldist[2];iptr++) {
-    i = cellp[iptr];
-    for(nf=0;nf<nfaces[i];nf++) {
-      //printf("%d, %d\n",nf,cells[(i*maxfaces+nf)]);
-      xg[nf]=xp[cells[i*maxfaces+nf]];
-      yg[nf]=yp[cells[i*maxfaces+nf]]; 
-    }
-
-    if(InPolygon(x,y,xg,yg,nfaces[i]))
-      return 1;
-  }
-  return 0;
-}
-
-/*
- * Function: InPolygon
- * Usage: if(InPolygon(x,y,xg,yg,N))
- * ---------------------------------
- * Returns true if the point (x,y) is contained within the polygon defined by the
- * N points defined by xg,yg.
- *
- * Copyright (c) 1970-2003, Wm. Randolph Franklin
- * http://www.ecse.rpi.edu/Homepages/wrf/Research/Short_Notes/pnpoly.html
- *
- */
-static int InPolygon(REAL x, REAL y, REAL *xg, REAL *yg, int N) {
-
-  int i, j=0, in=0;
-
-  for (i=0; i<N; i++) {
-    j++; if (j==N) j=0;
-    if ((yg[i]<y && yg[j]>=y) || (yg[j]<y && yg[i]>=y)) 
-      if (xg[i]+(y-yg[i])/(yg[j]-yg[i])*(xg[j]-xg[i])<x) 
-        in=!in;
-  }
-
-  return in;
+  // The spatial indices are no longer needed.
+  KDTreeFree(celltree);
+  KDTreeFree(alltree);
+  SunFree(dist2,numInterpPoints*sizeof(REAL),"InitializeOutputIndices");
 }
 
 /*
@@ -714,14 +634,14 @@ static int Merge2dRealData(REAL *local, int N, REAL *global, int *allN, MPI_Comm
   int i, offset, proc;
 
   if(myproc!=0) {
-    MPI_Send((void *)local,N,MPI_DOUBLE,0,1,comm);     
+    MPI_Send((void *)local,N,MPI_REALTYPE,0,1,comm);     
   } else {
     for(i=0;i<N;i++) 
       global[i]=local[i];
 
     offset=N;
     for(proc=1;proc<numprocs;proc++) {
-      MPI_Recv((void *)(&(global[offset])),allN[proc],MPI_DOUBLE,proc,1,comm,MPI_STATUS_IGNORE);
+      MPI_Recv((void *)(&(global[offset])),allN[proc],MPI_REALTYPE,proc,1,comm,MPI_STATUS_IGNORE);
       offset+=allN[proc];
     }
   }
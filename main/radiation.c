@@ -0,0 +1,217 @@
+/*
+ * File: radiation.c
+ * -----------------
+ * Incoming shortwave radiation and its penetration into the water column for
+ * the heat flux models (metmodel>0).
+ *
+ * The solar declination and hour angle only depend on time, so they are
+ * computed once per time step in UpdateSolarGeometry and the clear sky
+ * radiation Qsc of each cell is stored, after which the shortwave radiation of
+ * a cell only requires the cloud correction in CellShortwave.  The latitude of
+ * the cells is set with
+ *
+ * varylatitude  0 - latitude for all of the cells
+ *               1 - the grid is in degrees and yv is the latitude
+ *               2 - yv is a northing in metres from the equator (e.g. UTM)
+ *
+ * The radiation penetrates the water column as Hsw*exp(ksw*z), with z=0 at the
+ * free surface, and ShortwaveSource adds the divergence of this flux over each
+ * layer, (E_top-E_bot)/dzz*Hsw/rhocp, to the heat source.  The exponentials
+ * at the layer faces follow from the recurrence E_bot = E_top*exp(-ksw*dzz)
+ * starting from E=1 at the free surface, and the exp(-ksw*dzz) of each layer
+ * are stored and only recomputed when the thickness of the layer or ksw
+ * changes, which is only in the top layers for a fixed vertical grid.
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "memory.h"
+#include "util.h"
+#include "radiation.h"
+
+// Solar constant [W m-2], albedo of the sea surface and atmospheric transmission
+static const REAL S=1368.0;
+static const REAL albedo = 0.06;
+static const REAL R = 0.76;
+
+/*
+ * Function: AllocateRadiation
+ * Usage: AllocateRadiation(grid,prop,&met->rad,myproc);
+ * ------------------------------------------------------
+ * Allocate the radiation arrays and set the latitude of the cells.
+ *
+ */
+void AllocateRadiation(gridT *grid, propT *prop, radiationT **rad, int myproc) {
+  int i, k, Nc=grid->Nc;
+  REAL lat;
+
+  *rad = (radiationT *)SunMalloc(sizeof(radiationT),"AllocateRadiation");
+
+  (*rad)->sinlat = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateRadiation");
+  (*rad)->coslat = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateRadiation");
+  (*rad)->Qsc = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateRadiation");
+  (*rad)->kswdecay = (REAL *)SunMalloc(Nc*sizeof(REAL),"AllocateRadiation");
+  (*rad)->decay = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateRadiation");
+  (*rad)->dzzdecay = (REAL **)SunMalloc(Nc*sizeof(REAL *),"AllocateRadiation");
+
+  for(i=0;i<Nc;i++) {
+    if(prop->varylatitude==1)
+      lat = grid->yv[i];
+    else if(prop->varylatitude==2)
+      lat = grid->yv[i]/RADIUSEARTH*180/PI;
+    else
+      lat = prop->latitude;
+
+    (*rad)->sinlat[i] = sin(PI*lat/180);
+    (*rad)->coslat[i] = cos(PI*lat/180);
+    (*rad)->Qsc[i] = 0;
+
+    // ksw=0 and negative thicknesses force the first computation of the attenuation
+    (*rad)->kswdecay[i] = 0;
+    (*rad)->decay[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateRadiation");
+    (*rad)->dzzdecay[i] = (REAL *)SunMalloc(grid->Nk[i]*sizeof(REAL),"AllocateRadiation");
+    for(k=0;k<grid->Nk[i];k++) {
+      (*rad)->decay[i][k] = 0;
+      (*rad)->dzzdecay[i][k] = -1;
+    }
+  }
+
+  (*rad)->time = -INFTY;
+  (*rad)->night = 0;
+}
+
+/*
+ * Function: FreeRadiation
+ * Usage: FreeRadiation(met->rad,grid);
+ * ------------------------------------
+ * Free the radiation arrays of the cells of grid.
+ *
+ */
+void FreeRadiation(radiationT *rad, gridT *grid) {
+  int i, Nc=grid->Nc;
+
+  for(i=0;i<Nc;i++) {
+    SunFree(rad->decay[i],grid->Nk[i]*sizeof(REAL),"FreeRadiation");
+    SunFree(rad->dzzdecay[i],grid->Nk[i]*sizeof(REAL),"FreeRadiation");
+  }
+  SunFree(rad->decay,Nc*sizeof(REAL *),"FreeRadiation");
+  SunFree(rad->dzzdecay,Nc*sizeof(REAL *),"FreeRadiation");
+  SunFree(rad->sinlat,Nc*sizeof(REAL),"FreeRadiation");
+  SunFree(rad->coslat,Nc*sizeof(REAL),"FreeRadiation");
+  SunFree(rad->Qsc,Nc*sizeof(REAL),"FreeRadiation");
+  SunFree(rad->kswdecay,Nc*sizeof(REAL),"FreeRadiation");
+  SunFree(rad,sizeof(radiationT),"FreeRadiation");
+}
+
+/*
+ * Function: UpdateSolarGeometry
+ * Usage: UpdateSolarGeometry(grid,prop,met->rad);
+ * -----------------------------------------------
+ * Compute the clear sky radiation Qsc of the cells at time prop->nctime with the
+ * Gill, 1982 formulae.  Nothing is done if it is already up to date, so that
+ * this can be called by each of the heat flux computations of a time step.
+ *
+ */
+void UpdateSolarGeometry(gridT *grid, propT *prop, radiationT *rad) {
+  int i;
+  REAL time, toffset, gmttime, omega1, omega0, delta, sindelta, cosdelta, coshour, singamma;
+
+  if(prop->nctime==rad->time)
+    return;
+  rad->time = prop->nctime;
+
+  time = prop->nctime/86400.0;
+  toffset = prop->gmtoffset/24.0;
+
+  omega1 = 2*PI/1.0; // Diurnal cycle
+  omega0 = 2*PI/365.25; // Annual cycle
+
+  // Remove the gmtoffset from the time (assume units are the same)
+  gmttime = time + toffset;
+
+  delta = 23.5*PI/180 * cos(omega0*gmttime - 2.95);
+  sindelta = sin(delta);
+  cosdelta = cos(delta);
+  coshour = cos(omega1*gmttime);
+
+  rad->night = 1;
+  for(i=0;i<grid->Nc;i++) {
+    singamma = sindelta*rad->sinlat[i] - cosdelta*rad->coslat[i]*coshour;
+
+    // Clear sky radiation
+    if(singamma >= 0.0) {
+      rad->Qsc[i] = R*S*singamma;
+      rad->night = 0;
+    } else
+      rad->Qsc[i] = 0;
+  }
+}
+
+/*
+ * Function: CellShortwave
+ * Usage: met->Hsw[i] = CellShortwave(met->rad,i,met->cloud[i]);
+ * -------------------------------------------------------------
+ * Shortwave radiation at cell i with cloud cover C_cloud, using the clear sky
+ * radiation of the last call to UpdateSolarGeometry.
+ *
+ */
+REAL CellShortwave(radiationT *rad, int i, REAL C_cloud) {
+  return (1.0-albedo) * (1.0 - 0.65 * pow(C_cloud,2)) * rad->Qsc[i];
+}
+
+/*
+ * Function: ShortwaveSource
+ * Usage: ShortwaveSource(A,met->Hsw,rhocp,grid,prop,met->rad);
+ * ------------------------------------------------------------
+ * Add the heating due to the penetrating shortwave radiation Hsw to A in each
+ * of the computational cells.  The extinction depth is prop->Lsw unless it is
+ * more than half of the depth of the water column.
+ *
+ */
+void ShortwaveSource(REAL **A, REAL *Hsw, REAL rhocp, gridT *grid, propT *prop, radiationT *rad) {
+  int i, iptr, k, ktop, newksw;
+  REAL depth, ksw1, E, Ebot, dzz;
+
+  if(rad->night)
+    return;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
+    i = grid->cellp[iptr];
+    if(Hsw[i]==0)
+      continue;
+    ktop = grid->ctop[i];
+
+    //Calculate the local depth (accounts for free surface)
+    depth=0;
+    for(k=ktop;k<grid->Nk[i];k++)
+      depth += grid->dzz[i][k];
+
+    // Set the light extinction coefficient - ensure that the extinction depth is less than the water depth
+    ksw1 = 1.0 / Min(prop->Lsw, 0.5*depth);
+
+    if(ksw1!=ksw1){
+      printf("Error NaN computed in shortwave radiation term - too shallow!\n");
+      exit(EXIT_FAILURE);
+    }
+
+    newksw = (ksw1!=rad->kswdecay[i]);
+    rad->kswdecay[i] = ksw1;
+
+    E=1.0; // exp(ksw1*z) at the top face of layer k
+    for(k=ktop;k<grid->Nk[i];k++) {
+      dzz = grid->dzz[i][k];
+      if(newksw || dzz!=rad->dzzdecay[i][k]) {
+        rad->decay[i][k] = exp(-ksw1*dzz);
+        rad->dzzdecay[i][k] = dzz;
+      }
+      Ebot = E*rad->decay[i][k];
+
+      // Discrete form of dQ_sw/dz
+      if(dzz>0)
+        A[i][k] += (E-Ebot)/dzz*Hsw[i]/rhocp;
+
+      E = Ebot;
+    }
+  }
+}
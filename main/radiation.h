@@ -0,0 +1,38 @@
+/*
+ * File: radiation.h
+ * -----------------
+ * Header file for radiation.c, which computes the incoming shortwave radiation
+ * and its penetration into the water column.
+ *
+ */
+#ifndef _radiation_h
+#define _radiation_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+
+// Mean radius of the earth [m], used when varylatitude=2
+#define RADIUSEARTH 6.371e6
+
+/* Solar geometry and light attenuation of the local cells */
+typedef struct _radiationT {
+  DREAL time;     // prop->nctime at which Qsc was computed
+  int night;      // 1 if the sun is below the horizon at all of the local cells
+  REAL *sinlat;   // Sine and cosine of the latitude of each cell
+  REAL *coslat;
+  REAL *Qsc;      // Clear sky radiation at each cell [W m-2]
+
+  // Attenuation exp(-ksw*dzz) over each layer and the ksw and dzz it was computed with
+  REAL **decay;
+  REAL **dzzdecay;
+  REAL *kswdecay;
+} radiationT;
+
+void AllocateRadiation(gridT *grid, propT *prop, radiationT **rad, int myproc);
+void FreeRadiation(radiationT *rad, gridT *grid);
+void UpdateSolarGeometry(gridT *grid, propT *prop, radiationT *rad);
+REAL CellShortwave(radiationT *rad, int i, REAL C_cloud);
+void ShortwaveSource(REAL **A, REAL *Hsw, REAL rhocp, gridT *grid, propT *prop, radiationT *rad);
+
+#endif
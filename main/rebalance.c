@@ -0,0 +1,1005 @@
+/*
+ * File: rebalance.c
+ * -----------------
+ * Dynamic load balancing.  In wetting and drying runs the number of wet
+ * layers on each processor changes over the tidal cycle, so that a static
+ * partitioning leaves some of the processors idle.  With
+ *
+ * rebalance            0 - off, 1 - on
+ * ntrebalance          steps between checks of the load balance
+ * rebalancethreshold   imbalance (maximum over mean of the computation time of
+ *                      the processors) above which the grid is repartitioned
+ *
+ * the computation time of each processor (the time step timers of timer.h
+ * less the communication time t_comm) is measured over ntrebalance steps
+ * along with the cost of each of its cells, which is REBALANCECOLUMNCOST plus
+ * the number of wet layers, summed over the steps.  When the imbalance exceeds
+ * rebalancethreshold the cell weights are set to the cost of each cell scaled
+ * by the measured time per unit cost of its processor, and the grid is
+ * repartitioned with ParMETIS adaptive repartitioning (GetRepartitioning in
+ * partition.c).  The local grids, the send/receive lists and the merging arrays
+ * are then rebuilt and the complete state at the end of the time step is moved
+ * to the new processors (see MigrateState), so that the run continues as it
+ * would have on the old partitioning.  The new local grids are written
+ * to the grid files, so that the store file written at the end of the run
+ * restarts with the new partitioning.
+ *
+ * The subgrid, marsh, sediment and met modules and the averages are created
+ * again on the new grid as at the start of the run and their state is moved
+ * along with that of the solver.  The accumulators of the analysis are moved
+ * in the same way, and the points of the station and sub-domain output are
+ * assigned to the processors that compute their cells on the new grid.  The
+ * other modules that keep their own state on the local grid (culvert, waves,
+ * age, netcdf and tidal boundaries and profiles) and output that is not
+ * merged (mergeArrays=0) are not supported, and the run stops with an error
+ * when rebalance=1 is used with any of them.  User-defined sources and
+ * boundary conditions must not keep arrays on the local grid between time
+ * steps either.
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "memory.h"
+#include "util.h"
+#include "fileio.h"
+#include "mympi.h"
+#include "timer.h"
+#include "timestep.h"
+#include "sendrecv.h"
+#include "partition.h"
+#include "profiles.h"
+#include "vertcoordinate.h"
+#include "merge.h"
+#include "sources.h"
+#include "reconstruct.h"
+#include "subgrid.h"
+#include "marsh.h"
+#include "sediments.h"
+#include "averages.h"
+#include "outputplan.h"
+#include "analysis.h"
+#include "rebalance.h"
+
+/*
+ * Private type: the items (cells or edges) that are moved from their old
+ * processors to their new processors.  Items send[senddispls[p]],... are sent
+ * to processor p and items recv[recvdispls[p]],... are received from p.
+ *
+ */
+typedef struct _migrateT {
+  int Nsend, Nrecv;
+  int *sendcounts, *senddispls, *recvcounts, *recvdispls;
+  int *send;   // local index on the old grid of the items to send [Nsend]
+  int *recv;   // local index on the new grid of the received items [Nrecv]
+} migrateT;
+
+static int ntrebalance = 0;
+static REAL threshold;
+static DREAL tlast, *cost = NULL;
+static int Ncost;
+
+static int RebalanceSupported(propT *prop, int myproc, int numprocs);
+static DREAL ComputationTime(void);
+static void ResetLoad(gridT *grid);
+static void MigrateState(gridT *oldgrid, physT *oldphys, gridT *grid, physT *phys, metinT **metin,
+			 metT **met, averageT **average, propT *prop, int Nc, int Ne, int myproc,
+			 int numprocs, MPI_Comm comm);
+static void CreateMigration(migrateT *m, int *mptr, int N, int *owner, int *local, int numprocs,
+			    MPI_Comm comm);
+static void FreeMigration(migrateT *m, int numprocs);
+static void MigrationCounts(migrateT *m, int *oldN, int *newN, int extra, int *sendcounts,
+			    int *senddispls, int *recvcounts, int *recvdispls, int numprocs);
+static void Migrate2D(migrateT *m, REAL *oldf, REAL *newf, int numprocs, MPI_Comm comm);
+static void Migrate3D(migrateT *m, REAL **oldf, int *oldN, REAL **newf, int *newN, int extra,
+		      int numprocs, MPI_Comm comm);
+static void MigrateIndex(migrateT *m, int *oldf, int *newf, int numprocs, MPI_Comm comm);
+static void MigratePoints(migrateT *m, void *oldf, int *oldstart, void *newf, int *newstart, int width,
+			  MPI_Datatype type, int size, int numprocs, MPI_Comm comm);
+static void MigrateVertCoordinate(migrateT *cells, migrateT *edges, vertT *oldvert, gridT *oldgrid,
+				  gridT *grid, int numprocs, MPI_Comm comm);
+static void MigrateSubgrid(migrateT *cells, migrateT *edges, subgridT *oldsubgrid, gridT *oldgrid,
+			   gridT *grid, propT *prop, int numprocs, MPI_Comm comm);
+static void MigrateMarsh(migrateT *cells, migrateT *edges, marshT *oldmarsh, int numprocs, MPI_Comm comm);
+static void MigrateSediments(migrateT *cells, sedimentsT *oldsediments, gridT *oldgrid, gridT *grid,
+			     int numprocs, MPI_Comm comm);
+static void MigrateMet(migrateT *cells, metT *oldmet, metT *met, int numprocs, MPI_Comm comm);
+static void MigrateAverages(migrateT *cells, migrateT *edges, averageT *oldaverage, averageT *average,
+			    gridT *oldgrid, gridT *grid, propT *prop, int numprocs, MPI_Comm comm);
+static void MigrateAnalysis(migrateT *cells, analysisT *oldan, analysisT *an, gridT *oldgrid, gridT *grid,
+			    int numprocs, MPI_Comm comm);
+
+/*
+ * Function: CheckLoadBalance
+ * Usage: if(CheckLoadBalance(grid,phys,prop,myproc,numprocs,comm)) {...}
+ * ----------------------------------------------------------------------
+ * Reads the rebalancing parameters at the first step, accumulates the cost of
+ * the cells at every step and returns 1 every ntrebalance steps if the
+ * imbalance of the computation time is above rebalancethreshold, in which case
+ * Rebalance must be called.  Returns 0 at the last step.
+ *
+ */
+int CheckLoadBalance(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm) {
+  int i, iptr;
+  DREAL tcomp, tmax, tsum;
+  REAL imbalance;
+
+  if(prop->n==prop->nstart+1) {
+    ntrebalance=0;
+    if((int)MPI_GetValue(DATAFILE,"rebalance","CheckLoadBalance",myproc) &&
+       RebalanceSupported(prop,myproc,numprocs)) {
+      ntrebalance=(int)MPI_GetValue(DATAFILE,"ntrebalance","CheckLoadBalance",myproc);
+      threshold=MPI_GetValue(DATAFILE,"rebalancethreshold","CheckLoadBalance",myproc);
+      ResetLoad(grid);
+    }
+  }
+  if(ntrebalance<=0)
+    return 0;
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+    i = grid->cellp[iptr];
+    cost[i]+=REBALANCECOLUMNCOST;
+    if(phys->h[i]+grid->dv[i]>DRYCELLHEIGHT)
+      cost[i]+=grid->Nk[i]-grid->ctop[i];
+  }
+
+  if(!IntervalDue(prop,ntrebalance) || prop->n==prop->nstart+prop->nsteps)
+    return 0;
+
+  tcomp=ComputationTime()-tlast;
+  MPI_Allreduce(&tcomp,&tmax,1,MPI_DOUBLE,MPI_MAX,comm);
+  MPI_Allreduce(&tcomp,&tsum,1,MPI_DOUBLE,MPI_SUM,comm);
+  imbalance=(tsum>0)?tmax*numprocs/tsum:1;
+
+  if(myproc==0 && VERBOSE>1)
+    printf("Load imbalance at step %d: %.3f (maximum computation time %.2e s)\n",prop->n,imbalance,tmax);
+
+  if(imbalance>threshold)
+    return 1;
+  ResetLoad(grid);
+  return 0;
+}
+
+/*
+ * Function: Rebalance
+ * Usage: if(Rebalance(&grid,&phys,&metin,&met,&average,prop,myproc,numprocs,comm)) {...}
+ * --------------------------------------------------------------------------------------
+ * Repartition the grid with the cost measured since the last check, create the
+ * new local grid, physical variables, merging arrays and sponge layer, move the
+ * prognostic variables to them and free the old ones.  The met structures and
+ * the averages are replaced as well when metmodel>0 and calcaverage=1.  Returns
+ * 1 if the grid changed, in which case the boundary values must be set up
+ * again (see Solve).
+ *
+ */
+int Rebalance(gridT **grid, physT **phys, metinT **metin, metT **met, averageT **average, propT *prop,
+	      int myproc, int numprocs, MPI_Comm comm) {
+  int i, iptr, Nc, Ne, moved, *vwgt, *part;
+  DREAL tcomp, costsum=0, w, wmax;
+  gridT *oldgrid = *grid, *newgrid;
+  physT *oldphys = *phys, *newphys;
+
+  // Cell weights, which are the cost per unit time on each processor
+  for(iptr=oldgrid->celldist[0];iptr<oldgrid->celldist[2];iptr++)
+    costsum+=cost[oldgrid->cellp[iptr]];
+  tcomp=ComputationTime()-tlast;
+  w=(costsum>0)?tcomp/costsum:0;
+  for(i=0;i<oldgrid->Nc;i++)
+    cost[i]*=w;
+  for(iptr=oldgrid->celldist[0], w=0;iptr<oldgrid->celldist[2];iptr++)
+    w=Max(w,cost[oldgrid->cellp[iptr]]);
+  MPI_Allreduce(&w,&wmax,1,MPI_DOUBLE,MPI_MAX,comm);
+
+  vwgt = (int *)SunMalloc(oldgrid->Nc*sizeof(int),"Rebalance");
+  for(i=0;i<oldgrid->Nc;i++)
+    vwgt[i]=(wmax>0)?Max(1,(int)(MAXREBALANCEWEIGHT*cost[i]/wmax)):1;
+
+  // Size of the global grid
+  for(i=0, Nc=0;i<oldgrid->Nc;i++)
+    Nc=Max(Nc,oldgrid->mnptr[i]+1);
+  for(i=0, Ne=0;i<oldgrid->Ne;i++)
+    Ne=Max(Ne,oldgrid->eptr[i]+1);
+  MPI_Allreduce(MPI_IN_PLACE,&Nc,1,MPI_INT,MPI_MAX,comm);
+  MPI_Allreduce(MPI_IN_PLACE,&Ne,1,MPI_INT,MPI_MAX,comm);
+
+  part = (int *)SunMalloc(Nc*sizeof(int),"Rebalance");
+  GetRepartitioning(oldgrid,vwgt,part,Nc,myproc,numprocs,comm);
+  SunFree(vwgt,oldgrid->Nc*sizeof(int),"Rebalance");
+
+  for(iptr=oldgrid->celldist[0], moved=0;iptr<oldgrid->celldist[2];iptr++)
+    if(part[oldgrid->mnptr[oldgrid->cellp[iptr]]]!=myproc)
+      moved++;
+  MPI_Allreduce(MPI_IN_PLACE,&moved,1,MPI_INT,MPI_SUM,comm);
+
+  if(moved) {
+    if(myproc==0 && VERBOSE>0) printf("Rebalancing at step %d: moving %d of %d cells...\n",prop->n,moved,Nc);
+
+    RepartitionGrid(&newgrid,part,myproc,numprocs,comm);
+    InitializeVerticalGrid(&newgrid,myproc);
+    AllocatePhysicalVariables(newgrid,&newphys,prop);
+    AllocateTransferArrays(&newgrid,myproc,numprocs,comm);
+
+    // The reconstruction operators are rebuilt for the new grid at their next use
+    FreeReconstructionOperators();
+    MigrateState(oldgrid,oldphys,newgrid,newphys,metin,met,average,prop,Nc,Ne,myproc,numprocs,comm);
+    OutputPlanRepartition(oldgrid,newgrid,Nc,comm,numprocs,myproc);
+
+    // Merging arrays and sponge layer on the new grid
+    FreeMergingArrays(oldgrid,myproc);
+    InitializeMerging(newgrid,prop->outputNetcdf,numprocs,myproc,comm);
+    SunFree(rSponge,oldgrid->Ne*sizeof(REAL),"Rebalance");
+    InitSponge(newgrid,myproc);
+
+    FreePhysicalVariables(oldgrid,oldphys,prop);
+    FreeTransferArrays(oldgrid,myproc,numprocs,comm);
+    FreeLocalGrid(oldgrid);
+    *grid = newgrid;
+    *phys = newphys;
+  } else if(myproc==0 && VERBOSE>0)
+    printf("Rebalancing at step %d: the partitioning did not change.\n",prop->n);
+
+  SunFree(part,Nc*sizeof(int),"Rebalance");
+  ResetLoad(*grid);
+  return moved>0;
+}
+
+/*
+ * Function: RebalanceSupported
+ * Usage: if(RebalanceSupported(prop,myproc,numprocs)) {...}
+ * ---------------------------------------------------------
+ * Returns 0 if the run has a single processor, and stops with an error if
+ * it uses a module whose state cannot be moved to the new grid.
+ *
+ */
+static int RebalanceSupported(propT *prop, int myproc, int numprocs) {
+  char *module = NULL;
+
+  if(numprocs==1)
+    return 0;
+
+  if(!prop->mergeArrays)
+    module="mergeArrays=0";
+  else if(prop->culvertmodel)
+    module="culvertmodel";
+  else if(prop->wavemodel)
+    module="wavemodel";
+  else if(prop->calcage)
+    module="calcage";
+  else if(prop->netcdfBdy)
+    module="netcdfBdy";
+  else if(prop->tideforcing)
+    module="tideforcing";
+  else if(existProfs)
+    module="ProfileVariables";
+
+  if(module) {
+    if(myproc==0) printf("Error: rebalance=1 is not supported with %s.\n",module);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  return 1;
+}
+
+/*
+ * Function: ComputationTime
+ * Usage: t = ComputationTime();
+ * -----------------------------
+ * Time spent in the time step without the communication.
+ *
+ */
+static DREAL ComputationTime(void) {
+  return t_source+t_predictor+t_nonhydro+t_turb+t_transport-t_comm;
+}
+
+/*
+ * Function: ResetLoad
+ * Usage: ResetLoad(grid);
+ * -----------------------
+ * Start a new measurement of the load on the grid.
+ *
+ */
+static void ResetLoad(gridT *grid) {
+  int i;
+
+  if(cost)
+    SunFree(cost,Ncost*sizeof(DREAL),"ResetLoad");
+  Ncost=grid->Nc;
+  cost = (DREAL *)SunMalloc(Ncost*sizeof(DREAL),"ResetLoad");
+  for(i=0;i<Ncost;i++)
+    cost[i]=0;
+  tlast=ComputationTime();
+}
+
+/*
+ * Function: MigrateState
+ * Usage: MigrateState(oldgrid,oldphys,grid,phys,metin,met,average,prop,Nc,Ne,myproc,numprocs,comm);
+ * -------------------------------------------------------------------------------------------------
+ * Move the state of the solver at the end of the time step from the old grid
+ * to the new grid, including the layer thicknesses, the top indices, the
+ * tendencies of the previous steps, the vertical coordinate, the state of
+ * the subgrid, marsh, sediment and met modules, the averages and the
+ * analysis, so that the run continues as it would have without
+ * repartitioning.  Nc and Ne are
+ * the numbers of cells and edges of the global grid.  Every cell and edge of
+ * the new grid, including its halo, is received from the processor that
+ * computes it on the old grid.
+ *
+ */
+static void MigrateState(gridT *oldgrid, physT *oldphys, gridT *grid, physT *phys, metinT **metin,
+			 metT **met, averageT **average, propT *prop, int Nc, int Ne, int myproc,
+			 int numprocs, MPI_Comm comm) {
+  int i, j, n, iptr, nc, *owner, *local, *owned;
+  migrateT cells, edges;
+  vertT *oldvert;
+  subgridT *oldsubgrid;
+  marshT *oldmarsh;
+  sedimentsT *oldsediments;
+  metinT *oldmetin;
+  metT *oldmet;
+  averageT *oldaverage;
+  analysisT *oldan, *an;
+  // State of the solver at the end of a time step
+  REAL *oldc2[] = {oldphys->h,oldphys->h_old,oldphys->hold,oldphys->hcorr,oldphys->dhdt,
+		   oldphys->htmp2,oldphys->htmp3,oldphys->hcoef,oldphys->user_def_nc},
+    *newc2[] = {phys->h,phys->h_old,phys->hold,phys->hcorr,phys->dhdt,
+		phys->htmp2,phys->htmp3,phys->hcoef,phys->user_def_nc};
+  REAL **oldc3[] = {oldphys->uc,oldphys->vc,oldphys->wc,oldphys->uold,oldphys->vold,oldphys->q,
+		    oldphys->qc,oldphys->s,oldphys->T,oldphys->s_old,oldphys->T_old,oldphys->s0,
+		    oldphys->rho,oldphys->Cn_R,oldphys->Cn_T,oldphys->stmp,oldphys->stmp2,
+		    oldphys->stmp3,oldphys->nu_tv,oldphys->kappa_tv,oldphys->nu_lax,oldphys->gradSx,
+		    oldphys->gradSy,oldphys->user_def_nc_nk,oldgrid->dzz,oldgrid->dzzold},
+    **newc3[] = {phys->uc,phys->vc,phys->wc,phys->uold,phys->vold,phys->q,
+		 phys->qc,phys->s,phys->T,phys->s_old,phys->T_old,phys->s0,
+		 phys->rho,phys->Cn_R,phys->Cn_T,phys->stmp,phys->stmp2,
+		 phys->stmp3,phys->nu_tv,phys->kappa_tv,phys->nu_lax,phys->gradSx,
+		 phys->gradSy,phys->user_def_nc_nk,grid->dzz,grid->dzzold};
+  REAL **oldw3[] = {oldphys->w,oldphys->wnew,oldphys->wtmp,oldphys->w_old,oldphys->w_old2,
+		    oldphys->w_im,oldphys->Cn_W,oldphys->Cn_W2},
+    **neww3[] = {phys->w,phys->wnew,phys->wtmp,phys->w_old,phys->w_old2,
+		 phys->w_im,phys->Cn_W,phys->Cn_W2};
+  REAL **oldturb[] = {oldphys->Cn_q,oldphys->Cn_l,oldphys->qT,oldphys->lT,oldphys->qT_old,
+		      oldphys->lT_old},
+    **newturb[] = {phys->Cn_q,phys->Cn_l,phys->qT,phys->lT,phys->qT_old,phys->lT_old};
+  REAL *olde2[] = {oldphys->D,oldphys->CdB,oldphys->CdT,oldphys->z0B,oldphys->z0T,
+		   oldphys->tau_B,oldphys->tau_T,oldgrid->hf,oldgrid->dzfB},
+    *newe2[] = {phys->D,phys->CdB,phys->CdT,phys->z0B,phys->z0T,
+		phys->tau_B,phys->tau_T,grid->hf,grid->dzfB};
+  REAL **olde3[] = {oldphys->u,oldphys->utmp,oldphys->u_old,oldphys->u_old2,oldphys->ut,
+		    oldphys->Cn_U,oldphys->Cn_U2,oldphys->SfHp,oldphys->SfHm,oldphys->tRT1,
+		    oldphys->tRT2,oldgrid->dzf},
+    **newe3[] = {phys->u,phys->utmp,phys->u_old,phys->u_old2,phys->ut,
+		 phys->Cn_U,phys->Cn_U2,phys->SfHp,phys->SfHm,phys->tRT1,
+		 phys->tRT2,grid->dzf};
+  int *oldctop[] = {oldgrid->ctop,oldgrid->ctopold}, *newctop[] = {grid->ctop,grid->ctopold};
+  int *oldetop[] = {oldgrid->etop,oldgrid->etopold}, *newetop[] = {grid->etop,grid->etopold};
+
+  owner = (int *)SunMalloc(Max(Nc,Ne)*sizeof(int),"MigrateState");
+  local = (int *)SunMalloc(Max(Nc,Ne)*sizeof(int),"MigrateState");
+  owned = (int *)SunMalloc(oldgrid->Nc*sizeof(int),"MigrateState");
+
+  // Cells are sent by the processor that owns them
+  for(i=0;i<oldgrid->Nc;i++)
+    owned[i]=0;
+  for(iptr=oldgrid->celldist[0];iptr<oldgrid->celldist[2];iptr++)
+    owned[oldgrid->cellp[iptr]]=1;
+  for(i=0;i<Nc;i++)
+    owner[i]=local[i]=-1;
+  for(i=0;i<oldgrid->Nc;i++)
+    if(owned[i]) {
+      owner[oldgrid->mnptr[i]]=myproc;
+      local[oldgrid->mnptr[i]]=i;
+    }
+  MPI_Allreduce(MPI_IN_PLACE,owner,Nc,MPI_INT,MPI_MAX,comm);
+  CreateMigration(&cells,grid->mnptr,grid->Nc,owner,local,numprocs,comm);
+
+  // Edges are sent by the processor that owns their first cell
+  for(j=0;j<Ne;j++)
+    owner[j]=local[j]=-1;
+  for(j=0;j<oldgrid->Ne;j++) {
+    nc=(oldgrid->grad[2*j]!=-1)?oldgrid->grad[2*j]:oldgrid->grad[2*j+1];
+    if(owned[nc]) {
+      owner[oldgrid->eptr[j]]=myproc;
+      local[oldgrid->eptr[j]]=j;
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE,owner,Ne,MPI_INT,MPI_MAX,comm);
+  CreateMigration(&edges,grid->eptr,grid->Ne,owner,local,numprocs,comm);
+
+  SunFree(owner,Max(Nc,Ne)*sizeof(int),"MigrateState");
+  SunFree(local,Max(Nc,Ne)*sizeof(int),"MigrateState");
+  SunFree(owned,oldgrid->Nc*sizeof(int),"MigrateState");
+
+  // Sets dzbot and corrects dv for fixdzz on the new grid, after which the
+  // layer thicknesses are overwritten with the migrated ones.  This is done
+  // with h=0, so the active lists are rebuilt below from the migrated state.
+  UpdateDZ(grid,phys,prop,-1);
+
+  for(n=0;n<(int)(sizeof(oldc2)/sizeof(REAL *));n++)
+    Migrate2D(&cells,oldc2[n],newc2[n],numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldc3)/sizeof(REAL **));n++)
+    Migrate3D(&cells,oldc3[n],oldgrid->Nk,newc3[n],grid->Nk,0,numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldw3)/sizeof(REAL **));n++)
+    Migrate3D(&cells,oldw3[n],oldgrid->Nk,neww3[n],grid->Nk,1,numprocs,comm);
+  if(prop->turbmodel>=1)
+    for(n=0;n<(int)(sizeof(oldturb)/sizeof(REAL **));n++)
+      Migrate3D(&cells,oldturb[n],oldgrid->Nk,newturb[n],grid->Nk,0,numprocs,comm);
+  for(n=0;n<(int)(sizeof(olde2)/sizeof(REAL *));n++)
+    Migrate2D(&edges,olde2[n],newe2[n],numprocs,comm);
+  for(n=0;n<(int)(sizeof(olde3)/sizeof(REAL **));n++)
+    Migrate3D(&edges,olde3[n],oldgrid->Nkc,newe3[n],grid->Nkc,0,numprocs,comm);
+  for(n=0;n<2;n++) {
+    MigrateIndex(&cells,oldctop[n],newctop[n],numprocs,comm);
+    MigrateIndex(&edges,oldetop[n],newetop[n],numprocs,comm);
+  }
+
+  if(prop->vertcoord!=1) {
+    oldvert=vert;
+    VertCoordinateRepartition(grid,prop,phys,oldvert,myproc);
+    MigrateVertCoordinate(&cells,&edges,oldvert,oldgrid,grid,numprocs,comm);
+    FreeVertCoordinate(oldvert,oldgrid,prop);
+  }
+
+  // Every cell and edge, including the halo, now has the state of the old
+  // grid, from which the lists of the active cells and edges are rebuilt
+  UpdateActiveLists(grid,phys,prop,1);
+
+  // Modules that keep their own state on the local grid, in the order in
+  // which they are set up by Solve
+  if(prop->marshmodel) {
+    oldmarsh=marsh;
+    MarshRepartition(grid,oldmarsh,myproc);
+    MigrateMarsh(&cells,&edges,oldmarsh,numprocs,comm);
+    FreeMarsh(oldmarsh,oldgrid,myproc);
+  }
+  if(prop->subgrid) {
+    oldsubgrid=subgrid;
+    SubgridRepartition(grid,phys,prop,oldsubgrid,myproc,numprocs,comm);
+    MigrateSubgrid(&cells,&edges,oldsubgrid,oldgrid,grid,prop,numprocs,comm);
+    FreeSubgrid(oldsubgrid,oldgrid,prop,myproc);
+  }
+  if(prop->metmodel>0) {
+    oldmetin=*metin;
+    oldmet=*met;
+    MetRepartition(prop,grid,oldmetin,metin,met,myproc);
+    MigrateMet(&cells,oldmet,*met,numprocs,comm);
+    FreeMetIn(oldmetin,oldgrid,prop);
+    FreeMet(oldmet,oldgrid);
+  }
+  if(prop->computeSediments) {
+    oldsediments=sediments;
+    SedimentsRepartition(grid,prop,oldsediments,myproc);
+    MigrateSediments(&cells,oldsediments,oldgrid,grid,numprocs,comm);
+    FreeSedimentArrays(oldsediments,oldgrid);
+  }
+  if(prop->calcaverage) {
+    oldaverage=*average;
+    AverageRepartition(grid,oldaverage,average,prop);
+    MigrateAverages(&cells,&edges,oldaverage,*average,oldgrid,grid,prop,numprocs,comm);
+    FreeAverageVariables(oldgrid,oldaverage,prop);
+  }
+  if((an=AnalysisRepartition(grid,&oldan))!=NULL) {
+    MigrateAnalysis(&cells,oldan,an,oldgrid,grid,numprocs,comm);
+    FreeAnalysisArrays(oldan,oldgrid);
+  }
+
+  FreeMigration(&cells,numprocs);
+  FreeMigration(&edges,numprocs);
+
+  // Conserved quantities of the initial state (see ComputeConservatives)
+  phys->mass0=oldphys->mass0;
+  phys->mass=oldphys->mass;
+  phys->volume0=oldphys->volume0;
+  phys->volume=oldphys->volume;
+  phys->Ep0=oldphys->Ep0;
+  phys->Ep=oldphys->Ep;
+  phys->Ek=oldphys->Ek;
+  phys->Eflux1=oldphys->Eflux1;
+  phys->Eflux2=oldphys->Eflux2;
+  phys->Eflux3=oldphys->Eflux3;
+  phys->Eflux4=oldphys->Eflux4;
+  phys->smin=oldphys->smin;
+  phys->smax=oldphys->smax;
+}
+
+/*
+ * Function: CreateMigration
+ * Usage: CreateMigration(m,grid->mnptr,grid->Nc,owner,local,numprocs,comm);
+ * -------------------------------------------------------------------------
+ * Set up the transfer of the N items of the new local grid with global indices
+ * mptr[i] from the processors owner[mptr[i]] that have them at the local index
+ * local[mptr[i]] on the old grid.
+ *
+ */
+static void CreateMigration(migrateT *m, int *mptr, int N, int *owner, int *local, int numprocs,
+			    MPI_Comm comm) {
+  int i, p, n, *gsend, *grecv, *next;
+
+  m->sendcounts = (int *)SunMalloc(numprocs*sizeof(int),"CreateMigration");
+  m->senddispls = (int *)SunMalloc(numprocs*sizeof(int),"CreateMigration");
+  m->recvcounts = (int *)SunMalloc(numprocs*sizeof(int),"CreateMigration");
+  m->recvdispls = (int *)SunMalloc(numprocs*sizeof(int),"CreateMigration");
+  next = (int *)SunMalloc(numprocs*sizeof(int),"CreateMigration");
+
+  // Sort the items by their old processor
+  for(p=0;p<numprocs;p++)
+    m->recvcounts[p]=0;
+  for(i=0;i<N;i++)
+    m->recvcounts[owner[mptr[i]]]++;
+  m->recvdispls[0]=0;
+  for(p=1;p<numprocs;p++)
+    m->recvdispls[p]=m->recvdispls[p-1]+m->recvcounts[p-1];
+  m->Nrecv=N;
+  m->recv = (int *)SunMalloc(N*sizeof(int),"CreateMigration");
+  grecv = (int *)SunMalloc(N*sizeof(int),"CreateMigration");
+  for(p=0;p<numprocs;p++)
+    next[p]=m->recvdispls[p];
+  for(i=0;i<N;i++) {
+    n=next[owner[mptr[i]]]++;
+    m->recv[n]=i;
+    grecv[n]=mptr[i];
+  }
+
+  // Request the items from their old processors
+  MPI_Alltoall(m->recvcounts,1,MPI_INT,m->sendcounts,1,MPI_INT,comm);
+  m->senddispls[0]=0;
+  for(p=1;p<numprocs;p++)
+    m->senddispls[p]=m->senddispls[p-1]+m->sendcounts[p-1];
+  m->Nsend=m->senddispls[numprocs-1]+m->sendcounts[numprocs-1];
+  gsend = (int *)SunMalloc(Max(m->Nsend,1)*sizeof(int),"CreateMigration");
+  MPI_Alltoallv(grecv,m->recvcounts,m->recvdispls,MPI_INT,
+		gsend,m->sendcounts,m->senddispls,MPI_INT,comm);
+
+  m->send = (int *)SunMalloc(Max(m->Nsend,1)*sizeof(int),"CreateMigration");
+  for(n=0;n<m->Nsend;n++)
+    m->send[n]=local[gsend[n]];
+
+  SunFree(gsend,Max(m->Nsend,1)*sizeof(int),"CreateMigration");
+  SunFree(grecv,N*sizeof(int),"CreateMigration");
+  SunFree(next,numprocs*sizeof(int),"CreateMigration");
+}
+
+/*
+ * Function: FreeMigration
+ * Usage: FreeMigration(m,numprocs);
+ * ---------------------------------
+ * Free the arrays allocated by CreateMigration.
+ *
+ */
+static void FreeMigration(migrateT *m, int numprocs) {
+  SunFree(m->sendcounts,numprocs*sizeof(int),"FreeMigration");
+  SunFree(m->senddispls,numprocs*sizeof(int),"FreeMigration");
+  SunFree(m->recvcounts,numprocs*sizeof(int),"FreeMigration");
+  SunFree(m->recvdispls,numprocs*sizeof(int),"FreeMigration");
+  SunFree(m->send,Max(m->Nsend,1)*sizeof(int),"FreeMigration");
+  SunFree(m->recv,m->Nrecv*sizeof(int),"FreeMigration");
+}
+
+/*
+ * Function: MigrationCounts
+ * Usage: MigrationCounts(m,oldgrid->Nk,grid->Nk,1,sendcounts,senddispls,recvcounts,recvdispls,numprocs);
+ * ------------------------------------------------------------------------------------------------------
+ * Numbers of values sent to and received from each processor when each item has
+ * oldN[i]+extra values on the old grid and newN[i]+extra values on the new grid,
+ * or one value if oldN and newN are NULL.
+ *
+ */
+static void MigrationCounts(migrateT *m, int *oldN, int *newN, int extra, int *sendcounts,
+			    int *senddispls, int *recvcounts, int *recvdispls, int numprocs) {
+  int p, n;
+
+  for(p=0;p<numprocs;p++) {
+    sendcounts[p]=recvcounts[p]=0;
+    for(n=m->senddispls[p];n<m->senddispls[p]+m->sendcounts[p];n++)
+      sendcounts[p]+=oldN?oldN[m->send[n]]+extra:1;
+    for(n=m->recvdispls[p];n<m->recvdispls[p]+m->recvcounts[p];n++)
+      recvcounts[p]+=newN?newN[m->recv[n]]+extra:1;
+  }
+  senddispls[0]=recvdispls[0]=0;
+  for(p=1;p<numprocs;p++) {
+    senddispls[p]=senddispls[p-1]+sendcounts[p-1];
+    recvdispls[p]=recvdispls[p-1]+recvcounts[p-1];
+  }
+}
+
+/*
+ * Function: Migrate2D
+ * Usage: Migrate2D(&cells,oldphys->h,phys->h,numprocs,comm);
+ * ----------------------------------------------------------
+ * Move the 2-D array oldf on the old grid to newf on the new grid.
+ *
+ */
+static void Migrate2D(migrateT *m, REAL *oldf, REAL *newf, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL *sendbuf = (REAL *)SunMalloc(Max(m->Nsend,1)*sizeof(REAL),"Migrate2D");
+  REAL *recvbuf = (REAL *)SunMalloc(Max(m->Nrecv,1)*sizeof(REAL),"Migrate2D");
+
+  for(n=0;n<m->Nsend;n++)
+    sendbuf[n]=oldf[m->send[n]];
+  MPI_Alltoallv(sendbuf,m->sendcounts,m->senddispls,MPI_REALTYPE,
+		recvbuf,m->recvcounts,m->recvdispls,MPI_REALTYPE,comm);
+  for(n=0;n<m->Nrecv;n++)
+    newf[m->recv[n]]=recvbuf[n];
+
+  SunFree(sendbuf,Max(m->Nsend,1)*sizeof(REAL),"Migrate2D");
+  SunFree(recvbuf,Max(m->Nrecv,1)*sizeof(REAL),"Migrate2D");
+}
+
+/*
+ * Function: Migrate3D
+ * Usage: Migrate3D(&cells,oldphys->w,oldgrid->Nk,phys->w,grid->Nk,1,numprocs,comm);
+ * ---------------------------------------------------------------------------------
+ * Move the 3-D array oldf with oldN[i]+extra values in item i of the old grid
+ * to newf with newN[i]+extra values in item i of the new grid.
+ *
+ */
+static void Migrate3D(migrateT *m, REAL **oldf, int *oldN, REAL **newf, int *newN, int extra,
+		      int numprocs, MPI_Comm comm) {
+  int n, k, i, Nsend, Nrecv;
+  int *sendcounts = (int *)SunMalloc(4*numprocs*sizeof(int),"Migrate3D"),
+    *senddispls = sendcounts+numprocs, *recvcounts = sendcounts+2*numprocs,
+    *recvdispls = sendcounts+3*numprocs;
+  REAL *sendbuf, *recvbuf;
+
+  MigrationCounts(m,oldN,newN,extra,sendcounts,senddispls,recvcounts,recvdispls,numprocs);
+  Nsend=Max(senddispls[numprocs-1]+sendcounts[numprocs-1],1);
+  Nrecv=Max(recvdispls[numprocs-1]+recvcounts[numprocs-1],1);
+  sendbuf = (REAL *)SunMalloc(Nsend*sizeof(REAL),"Migrate3D");
+  recvbuf = (REAL *)SunMalloc(Nrecv*sizeof(REAL),"Migrate3D");
+
+  for(n=0, k=0;n<m->Nsend;n++)
+    for(i=0;i<oldN[m->send[n]]+extra;i++)
+      sendbuf[k++]=oldf[m->send[n]][i];
+  MPI_Alltoallv(sendbuf,sendcounts,senddispls,MPI_REALTYPE,
+		recvbuf,recvcounts,recvdispls,MPI_REALTYPE,comm);
+  for(n=0, k=0;n<m->Nrecv;n++)
+    for(i=0;i<newN[m->recv[n]]+extra;i++)
+      newf[m->recv[n]][i]=recvbuf[k++];
+
+  SunFree(sendbuf,Nsend*sizeof(REAL),"Migrate3D");
+  SunFree(recvbuf,Nrecv*sizeof(REAL),"Migrate3D");
+  SunFree(sendcounts,4*numprocs*sizeof(int),"Migrate3D");
+}
+
+/*
+ * Function: MigrateIndex
+ * Usage: MigrateIndex(&cells,oldgrid->ctop,grid->ctop,numprocs,comm);
+ * -------------------------------------------------------------------
+ * Move the integer array oldf on the old grid to newf on the new grid.
+ *
+ */
+static void MigrateIndex(migrateT *m, int *oldf, int *newf, int numprocs, MPI_Comm comm) {
+  int n;
+  int *sendbuf = (int *)SunMalloc(Max(m->Nsend,1)*sizeof(int),"MigrateIndex");
+  int *recvbuf = (int *)SunMalloc(Max(m->Nrecv,1)*sizeof(int),"MigrateIndex");
+
+  for(n=0;n<m->Nsend;n++)
+    sendbuf[n]=oldf[m->send[n]];
+  MPI_Alltoallv(sendbuf,m->sendcounts,m->senddispls,MPI_INT,
+		recvbuf,m->recvcounts,m->recvdispls,MPI_INT,comm);
+  for(n=0;n<m->Nrecv;n++)
+    newf[m->recv[n]]=recvbuf[n];
+
+  SunFree(sendbuf,Max(m->Nsend,1)*sizeof(int),"MigrateIndex");
+  SunFree(recvbuf,Max(m->Nrecv,1)*sizeof(int),"MigrateIndex");
+}
+
+/*
+ * Function: MigratePoints
+ * Usage: MigratePoints(&cells,oldan->var[v].b,oldan->pstart,an->var[v].b,an->pstart,an->Npar,
+ *                      MPI_REALTYPE,sizeof(REAL),numprocs,comm);
+ * ----------------------------------------------------------------------------------------
+ * Move the flat array oldf, in which item i of the old grid has the values
+ * width*oldstart[i],...,width*oldstart[i+1]-1 of type with size bytes each, to
+ * newf, in which item i of the new grid has the values width*newstart[i],...
+ *
+ */
+static void MigratePoints(migrateT *m, void *oldf, int *oldstart, void *newf, int *newstart, int width,
+			  MPI_Datatype type, int size, int numprocs, MPI_Comm comm) {
+  int p, n, i, k, len, Nsend, Nrecv;
+  int *sendcounts = (int *)SunMalloc(4*numprocs*sizeof(int),"MigratePoints"),
+    *senddispls = sendcounts+numprocs, *recvcounts = sendcounts+2*numprocs,
+    *recvdispls = sendcounts+3*numprocs;
+  char *sendbuf, *recvbuf, *oldv = (char *)oldf, *newv = (char *)newf;
+
+  for(p=0;p<numprocs;p++) {
+    sendcounts[p]=recvcounts[p]=0;
+    for(n=m->senddispls[p];n<m->senddispls[p]+m->sendcounts[p];n++)
+      sendcounts[p]+=width*(oldstart[m->send[n]+1]-oldstart[m->send[n]]);
+    for(n=m->recvdispls[p];n<m->recvdispls[p]+m->recvcounts[p];n++)
+      recvcounts[p]+=width*(newstart[m->recv[n]+1]-newstart[m->recv[n]]);
+  }
+  senddispls[0]=recvdispls[0]=0;
+  for(p=1;p<numprocs;p++) {
+    senddispls[p]=senddispls[p-1]+sendcounts[p-1];
+    recvdispls[p]=recvdispls[p-1]+recvcounts[p-1];
+  }
+  Nsend=Max(senddispls[numprocs-1]+sendcounts[numprocs-1],1);
+  Nrecv=Max(recvdispls[numprocs-1]+recvcounts[numprocs-1],1);
+  sendbuf = (char *)SunMalloc(Nsend*size,"MigratePoints");
+  recvbuf = (char *)SunMalloc(Nrecv*size,"MigratePoints");
+
+  for(n=0, k=0;n<m->Nsend;n++) {
+    i=m->send[n];
+    len=width*(oldstart[i+1]-oldstart[i]);
+    memcpy(sendbuf+k*size,oldv+width*oldstart[i]*size,len*size);
+    k+=len;
+  }
+  MPI_Alltoallv(sendbuf,sendcounts,senddispls,type,recvbuf,recvcounts,recvdispls,type,comm);
+  for(n=0, k=0;n<m->Nrecv;n++) {
+    i=m->recv[n];
+    len=width*(newstart[i+1]-newstart[i]);
+    memcpy(newv+width*newstart[i]*size,recvbuf+k*size,len*size);
+    k+=len;
+  }
+
+  SunFree(sendbuf,Nsend*size,"MigratePoints");
+  SunFree(recvbuf,Nrecv*size,"MigratePoints");
+  SunFree(sendcounts,4*numprocs*sizeof(int),"MigratePoints");
+}
+
+/*
+ * Function: MigrateVertCoordinate
+ * Usage: MigrateVertCoordinate(&cells,&edges,oldvert,oldgrid,grid,numprocs,comm);
+ * -------------------------------------------------------------------------------
+ * Move the state of the vertical coordinate oldvert on the old grid to the
+ * global vert created for the new grid by VertCoordinateRepartition.  The layer
+ * locations and velocities are moved rather than recomputed so that the run
+ * continues with the same values as without repartitioning.
+ *
+ */
+static void MigrateVertCoordinate(migrateT *cells, migrateT *edges, vertT *oldvert, gridT *oldgrid,
+				  gridT *grid, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL **oldlayers[] = {oldvert->omegac,oldvert->zc,oldvert->zcold,oldvert->f_r,oldvert->dvdx,
+			oldvert->dudy,oldvert->dudx,oldvert->dvdy,oldvert->dwdx,oldvert->dwdy,
+			oldvert->dzdy,oldvert->dzdx,oldvert->dqdy,oldvert->dqdx,oldvert->Mc,
+			oldvert->dzztmp},
+    **newlayers[] = {vert->omegac,vert->zc,vert->zcold,vert->f_r,vert->dvdx,
+		     vert->dudy,vert->dudx,vert->dvdy,vert->dwdx,vert->dwdy,
+		     vert->dzdy,vert->dzdx,vert->dqdy,vert->dqdx,vert->Mc,
+		     vert->dzztmp};
+  REAL **oldtops[] = {oldvert->ul,oldvert->vl,oldvert->omega,oldvert->omega_im,oldvert->omega_old,
+		      oldvert->omega_old2,oldvert->U3,oldvert->U3_old,oldvert->U3_old2,oldvert->zl},
+    **newtops[] = {vert->ul,vert->vl,vert->omega,vert->omega_im,vert->omega_old,
+		   vert->omega_old2,vert->U3,vert->U3_old,vert->U3_old2,vert->zl};
+  REAL **oldedges[] = {oldvert->uf,oldvert->vf,oldvert->wf,oldvert->qcf,oldvert->omegaf,
+		       oldvert->zf,oldvert->f_re},
+    **newedges[] = {vert->uf,vert->vf,vert->wf,vert->qcf,vert->omegaf,
+		    vert->zf,vert->f_re};
+
+  for(n=0;n<(int)(sizeof(oldlayers)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldlayers[n],oldgrid->Nk,newlayers[n],grid->Nk,0,numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldtops)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldtops[n],oldgrid->Nk,newtops[n],grid->Nk,1,numprocs,comm);
+  Migrate2D(cells,oldvert->Msum,vert->Msum,numprocs,comm);
+
+  for(n=0;n<(int)(sizeof(oldedges)/sizeof(REAL **));n++)
+    Migrate3D(edges,oldedges[n],oldgrid->Nkc,newedges[n],grid->Nkc,0,numprocs,comm);
+  Migrate3D(edges,oldvert->Me_l,oldgrid->Nkc,vert->Me_l,grid->Nkc,1,numprocs,comm);
+  Migrate2D(edges,oldvert->zfb,vert->zfb,numprocs,comm);
+  MigrateIndex(edges,oldvert->Nkeb,vert->Nkeb,numprocs,comm);
+}
+
+/*
+ * Function: MigrateSubgrid
+ * Usage: MigrateSubgrid(&cells,&edges,oldsubgrid,oldgrid,grid,prop,numprocs,comm);
+ * --------------------------------------------------------------------------------
+ * Move the effective areas, volumes and heights of oldsubgrid, which depend on
+ * the free surface of the last time steps, to the global subgrid created for
+ * the new grid by SubgridRepartition.
+ *
+ */
+static void MigrateSubgrid(migrateT *cells, migrateT *edges, subgridT *oldsubgrid, gridT *oldgrid,
+			   gridT *grid, propT *prop, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL *oldc2[] = {oldsubgrid->Aceff,oldsubgrid->Aceffold,oldsubgrid->Heff,oldsubgrid->Heffold,
+		   oldsubgrid->Veff,oldsubgrid->Veffold,oldsubgrid->Acwet,oldsubgrid->Verr},
+    *newc2[] = {subgrid->Aceff,subgrid->Aceffold,subgrid->Heff,subgrid->Heffold,
+		subgrid->Veff,subgrid->Veffold,subgrid->Acwet,subgrid->Verr};
+  REAL *oldsedi[] = {oldsubgrid->Cdmean,oldsubgrid->Asedi,oldsubgrid->Vsedi,oldsubgrid->delta},
+    *newsedi[] = {subgrid->Cdmean,subgrid->Asedi,subgrid->Vsedi,subgrid->delta};
+  REAL **oldc3[] = {oldsubgrid->Acceff,oldsubgrid->Acceffold,oldsubgrid->fluxp,oldsubgrid->fluxn},
+    **newc3[] = {subgrid->Acceff,subgrid->Acceffold,subgrid->fluxp,subgrid->fluxn};
+  REAL **oldw3[] = {oldsubgrid->Acveff,oldsubgrid->Acveffold,oldsubgrid->Acveffold2},
+    **neww3[] = {subgrid->Acveff,subgrid->Acveffold,subgrid->Acveffold2};
+  REAL *olde2[] = {oldsubgrid->he,oldsubgrid->dzboteff}, *newe2[] = {subgrid->he,subgrid->dzboteff};
+
+  for(n=0;n<(int)(sizeof(oldc2)/sizeof(REAL *));n++)
+    Migrate2D(cells,oldc2[n],newc2[n],numprocs,comm);
+  if(prop->computeSediments)
+    for(n=0;n<(int)(sizeof(oldsedi)/sizeof(REAL *));n++)
+      Migrate2D(cells,oldsedi[n],newsedi[n],numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldc3)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldc3[n],oldgrid->Nk,newc3[n],grid->Nk,0,numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldw3)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldw3[n],oldgrid->Nk,neww3[n],grid->Nk,1,numprocs,comm);
+  for(n=0;n<(int)(sizeof(olde2)/sizeof(REAL *));n++)
+    Migrate2D(edges,olde2[n],newe2[n],numprocs,comm);
+}
+
+/*
+ * Function: MigrateMarsh
+ * Usage: MigrateMarsh(&cells,&edges,oldmarsh,numprocs,comm);
+ * ----------------------------------------------------------
+ * Move the marsh heights, drag coefficients and marsh tops of oldmarsh to the
+ * global marsh created for the new grid by MarshRepartition.
+ *
+ */
+static void MigrateMarsh(migrateT *cells, migrateT *edges, marshT *oldmarsh, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL *olde2[] = {oldmarsh->CdV,oldmarsh->hmarsh,oldmarsh->hmarshleft},
+    *newe2[] = {marsh->CdV,marsh->hmarsh,marsh->hmarshleft};
+
+  for(n=0;n<(int)(sizeof(olde2)/sizeof(REAL *));n++)
+    Migrate2D(edges,olde2[n],newe2[n],numprocs,comm);
+  MigrateIndex(edges,oldmarsh->marshtop,marsh->marshtop,numprocs,comm);
+  Migrate2D(cells,oldmarsh->hmarshcenter,marsh->hmarshcenter,numprocs,comm);
+  Migrate2D(cells,oldmarsh->CdVcenter,marsh->CdVcenter,numprocs,comm);
+}
+
+/*
+ * Function: MigrateSediments
+ * Usage: MigrateSediments(&cells,oldsediments,oldgrid,grid,numprocs,comm);
+ * ------------------------------------------------------------------------
+ * Move the concentrations, the bed and the pending fluxes of oldsediments to
+ * the global sediments created for the new grid by SedimentsRepartition.
+ *
+ */
+static void MigrateSediments(migrateT *cells, sedimentsT *oldsediments, gridT *oldgrid, gridT *grid,
+			     int numprocs, MPI_Comm comm) {
+  int i, j, n, *oldNl, *newNl;
+  REAL **oldc3[] = {oldsediments->SediKappa_tv}, **newc3[] = {sediments->SediKappa_tv};
+  REAL *oldc2[] = {oldsediments->kb,oldsediments->z0b,oldsediments->z0r,oldsediments->z0s,
+		   oldsediments->Seditb,oldsediments->Seditbmax,oldsediments->Totalthickness,
+		   oldsediments->Reposangle,oldsediments->Taubexp},
+    *newc2[] = {sediments->kb,sediments->z0b,sediments->z0r,sediments->z0s,
+		sediments->Seditb,sediments->Seditbmax,sediments->Totalthickness,
+		sediments->Reposangle,sediments->Taubexp};
+
+  // The bed arrays have Nlayer values in each cell
+  oldNl = (int *)SunMalloc(oldgrid->Nc*sizeof(int),"MigrateSediments");
+  newNl = (int *)SunMalloc(grid->Nc*sizeof(int),"MigrateSediments");
+  for(j=0;j<oldgrid->Nc;j++)
+    oldNl[j]=sediments->Nlayer;
+  for(j=0;j<grid->Nc;j++)
+    newNl[j]=sediments->Nlayer;
+
+  for(i=0;i<sediments->Nsize;i++) {
+    REAL **oldf3[] = {oldsediments->SediC[i],oldsediments->SediC_old[i]},
+      **newf3[] = {sediments->SediC[i],sediments->SediC_old[i]},
+      **oldbed[] = {oldsediments->Erosion[i],oldsediments->Erosion_old[i],
+		    oldsediments->Layerthickness[i],oldsediments->Bedflux[i]},
+      **newbed[] = {sediments->Erosion[i],sediments->Erosion_old[i],
+		    sediments->Layerthickness[i],sediments->Bedflux[i]},
+      *oldf2[] = {oldsediments->Deposition[i],oldsediments->Deposition_old[i],
+		  oldsediments->alphaSSC[i],oldsediments->Toplayerratio[i]},
+      *newf2[] = {sediments->Deposition[i],sediments->Deposition_old[i],
+		  sediments->alphaSSC[i],sediments->Toplayerratio[i]};
+
+    for(n=0;n<(int)(sizeof(oldf3)/sizeof(REAL **));n++)
+      Migrate3D(cells,oldf3[n],oldgrid->Nk,newf3[n],grid->Nk,0,numprocs,comm);
+    Migrate3D(cells,oldsediments->Ws[i],oldgrid->Nk,sediments->Ws[i],grid->Nk,1,numprocs,comm);
+    for(n=0;n<(int)(sizeof(oldbed)/sizeof(REAL **));n++)
+      Migrate3D(cells,oldbed[n],oldNl,newbed[n],newNl,0,numprocs,comm);
+    for(n=0;n<(int)(sizeof(oldf2)/sizeof(REAL *));n++)
+      Migrate2D(cells,oldf2[n],newf2[n],numprocs,comm);
+  }
+  for(n=0;n<(int)(sizeof(oldc3)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldc3[n],oldgrid->Nk,newc3[n],grid->Nk,0,numprocs,comm);
+  Migrate3D(cells,oldsediments->Wnewsedi,oldgrid->Nk,sediments->Wnewsedi,grid->Nk,1,numprocs,comm);
+  Migrate3D(cells,oldsediments->Thicknesslayer,oldNl,sediments->Thicknesslayer,newNl,0,numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldc2)/sizeof(REAL *));n++)
+    Migrate2D(cells,oldc2[n],newc2[n],numprocs,comm);
+  MigrateIndex(cells,oldsediments->Layertop,sediments->Layertop,numprocs,comm);
+
+  SunFree(oldNl,oldgrid->Nc*sizeof(int),"MigrateSediments");
+  SunFree(newNl,grid->Nc*sizeof(int),"MigrateSediments");
+}
+
+/*
+ * Function: MigrateMet
+ * Usage: MigrateMet(&cells,oldmet,met,numprocs,comm);
+ * ---------------------------------------------------
+ * Move the met fields of the current time step and of the time records of the
+ * met input, and the heat fluxes, from oldmet to met created for the new grid
+ * by MetRepartition.
+ *
+ */
+static void MigrateMet(migrateT *cells, metT *oldmet, metT *met, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL *oldc2[] = {oldmet->Uwind,oldmet->Vwind,oldmet->Tair,oldmet->Pair,oldmet->rain,oldmet->RH,
+		   oldmet->cloud,oldmet->Hs,oldmet->Hl,oldmet->Hlw,oldmet->Hsw,oldmet->tau_x,
+		   oldmet->tau_y,oldmet->ustar,oldmet->Tstar,oldmet->qstar,oldmet->EP,oldmet->dHdT},
+    *newc2[] = {met->Uwind,met->Vwind,met->Tair,met->Pair,met->rain,met->RH,
+		met->cloud,met->Hs,met->Hl,met->Hlw,met->Hsw,met->tau_x,
+		met->tau_y,met->ustar,met->Tstar,met->qstar,met->EP,met->dHdT};
+
+  for(n=0;n<(int)(sizeof(oldc2)/sizeof(REAL *));n++)
+    Migrate2D(cells,oldc2[n],newc2[n],numprocs,comm);
+  for(n=0;n<NTmet;n++) {
+    Migrate2D(cells,oldmet->Uwind_t[n],met->Uwind_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->Vwind_t[n],met->Vwind_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->Tair_t[n],met->Tair_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->Pair_t[n],met->Pair_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->rain_t[n],met->rain_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->RH_t[n],met->RH_t[n],numprocs,comm);
+    Migrate2D(cells,oldmet->cloud_t[n],met->cloud_t[n],numprocs,comm);
+  }
+}
+
+/*
+ * Function: MigrateAverages
+ * Usage: MigrateAverages(&cells,&edges,oldaverage,average,oldgrid,grid,prop,numprocs,comm);
+ * -----------------------------------------------------------------------------------------
+ * Move the sums of the current averaging interval from oldaverage to the
+ * average created for the new grid by AverageRepartition.
+ *
+ */
+static void MigrateAverages(migrateT *cells, migrateT *edges, averageT *oldaverage, averageT *average,
+			    gridT *oldgrid, gridT *grid, propT *prop, int numprocs, MPI_Comm comm) {
+  int n;
+  REAL **oldc3[] = {oldaverage->uc,oldaverage->vc,oldaverage->s,oldaverage->T,oldaverage->rho,
+		    oldaverage->nu_v,oldaverage->kappa_tv,oldaverage->counter},
+    **newc3[] = {average->uc,average->vc,average->s,average->T,average->rho,
+		 average->nu_v,average->kappa_tv,average->counter};
+  REAL *oldc2[] = {oldaverage->h,oldaverage->h_avg,oldaverage->s_dz,oldaverage->T_dz},
+    *newc2[] = {average->h,average->h_avg,average->s_dz,average->T_dz};
+  REAL *oldmet2[] = {oldaverage->Uwind,oldaverage->Vwind,oldaverage->Tair,oldaverage->Pair,
+		     oldaverage->rain,oldaverage->RH,oldaverage->cloud,oldaverage->Hs,oldaverage->Hl,
+		     oldaverage->Hlw,oldaverage->Hsw,oldaverage->tau_x,oldaverage->tau_y,oldaverage->EP},
+    *newmet2[] = {average->Uwind,average->Vwind,average->Tair,average->Pair,
+		  average->rain,average->RH,average->cloud,average->Hs,average->Hl,
+		  average->Hlw,average->Hsw,average->tau_x,average->tau_y,average->EP};
+  REAL **olde3[] = {oldaverage->U_F,oldaverage->s_F,oldaverage->T_F},
+    **newe3[] = {average->U_F,average->s_F,average->T_F};
+
+  for(n=0;n<(int)(sizeof(oldc3)/sizeof(REAL **));n++)
+    Migrate3D(cells,oldc3[n],oldgrid->Nk,newc3[n],grid->Nk,0,numprocs,comm);
+  Migrate3D(cells,oldaverage->w,oldgrid->Nk,average->w,grid->Nk,1,numprocs,comm);
+  for(n=0;n<(int)(sizeof(oldc2)/sizeof(REAL *));n++)
+    Migrate2D(cells,oldc2[n],newc2[n],numprocs,comm);
+  if(prop->metmodel>0)
+    for(n=0;n<(int)(sizeof(oldmet2)/sizeof(REAL *));n++)
+      Migrate2D(cells,oldmet2[n],newmet2[n],numprocs,comm);
+  for(n=0;n<(int)(sizeof(olde3)/sizeof(REAL **));n++)
+    Migrate3D(edges,olde3[n],oldgrid->Nke,newe3[n],grid->Nke,0,numprocs,comm);
+}
+
+/*
+ * Function: MigrateAnalysis
+ * Usage: MigrateAnalysis(&cells,oldan,an,oldgrid,grid,numprocs,comm);
+ * -------------------------------------------------------------------
+ * Move the accumulators of the analysis oldan to an, created for the new grid
+ * by AnalysisRepartition.  The points of the 3-D variables of cell i start at
+ * pstart[i] and those of the 2-D variables at i.
+ *
+ */
+static void MigrateAnalysis(migrateT *cells, analysisT *oldan, analysisT *an, gridT *oldgrid, gridT *grid,
+			    int numprocs, MPI_Comm comm) {
+  int i, n, v, *oldcells, *newcells, *oldstart, *newstart;
+
+  oldcells = (int *)SunMalloc((oldgrid->Nc+1)*sizeof(int),"MigrateAnalysis");
+  newcells = (int *)SunMalloc((grid->Nc+1)*sizeof(int),"MigrateAnalysis");
+  for(i=0;i<=oldgrid->Nc;i++)
+    oldcells[i]=i;
+  for(i=0;i<=grid->Nc;i++)
+    newcells[i]=i;
+
+  for(v=0;v<an->Nvars;v++) {
+    REAL *oldf[] = {oldan->var[v].mean,oldan->var[v].M2,oldan->var[v].min,oldan->var[v].max},
+      *newf[] = {an->var[v].mean,an->var[v].M2,an->var[v].min,an->var[v].max};
+
+    oldstart=(an->var[v].is3d ? oldan->pstart : oldcells);
+    newstart=(an->var[v].is3d ? an->pstart : newcells);
+    for(n=0;n<(int)(sizeof(oldf)/sizeof(REAL *));n++)
+      MigratePoints(cells,oldf[n],oldstart,newf[n],newstart,1,MPI_REALTYPE,sizeof(REAL),numprocs,comm);
+    MigratePoints(cells,oldan->var[v].b,oldstart,an->var[v].b,newstart,an->Npar,MPI_REALTYPE,sizeof(REAL),
+		  numprocs,comm);
+    MigratePoints(cells,oldan->var[v].n,oldstart,an->var[v].n,newstart,1,MPI_INT,sizeof(int),numprocs,comm);
+    MigratePoints(cells,oldan->var[v].exceed,oldstart,an->var[v].exceed,newstart,1,MPI_INT,sizeof(int),
+		  numprocs,comm);
+  }
+
+  SunFree(oldcells,(oldgrid->Nc+1)*sizeof(int),"MigrateAnalysis");
+  SunFree(newcells,(grid->Nc+1)*sizeof(int),"MigrateAnalysis");
+}
@@ -0,0 +1,26 @@
+/*
+ * File: rebalance.h
+ * -----------------
+ * Header file for rebalance.c, which repartitions the grid during the run
+ * when the computational load of the processors becomes unbalanced.
+ *
+ */
+#ifndef _rebalance_h
+#define _rebalance_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "met.h"
+#include "averages.h"
+
+// Cost of a water column relative to that of one of its wet layers
+#define REBALANCECOLUMNCOST 1.0
+// Largest cell weight passed to ParMETIS
+#define MAXREBALANCEWEIGHT 1000
+
+int CheckLoadBalance(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
+int Rebalance(gridT **grid, physT **phys, metinT **metin, metT **met, averageT **average, propT *prop,
+	      int myproc, int numprocs, MPI_Comm comm);
+
+#endif
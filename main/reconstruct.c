@@ -0,0 +1,600 @@
+/*
+ * File: reconstruct.c
+ * -------------------
+ * Reconstruction of the cell-centered velocity (uc,vc) from the edge-normal
+ * velocity u with the Perot (interp=0), quadratic RT2 (interp=1, Wang et al
+ * 2011) and least-squares (interp=2) methods.
+ *
+ * The weights of the edges of each cell only depend on the geometry of the
+ * grid, so they are computed once, when the method is first used, and stored
+ * in a sparse operator (see ucoperatorT in reconstruct.h).  Each call then
+ * applies the operator to all layers of a cell at once, one edge at a time,
+ * instead of recomputing the normals, face lengths and areas (and for the
+ * least-squares method solving the normal equations, and for RT2 the
+ * sub-triangle areas) for every layer.  The layers in which the edge
+ * velocities are summed are set at each call from ctop and the face heights,
+ * so wetting and drying do not require the operators to be rebuilt; they are
+ * rebuilt if grid->smoothbot changes, since it sets the deepest layer of the
+ * edges that is used.
+ *
+ * Only the active computational cells are reconstructed (see
+ * UpdateActiveLists in phys.c), which are all of them with activelists=0.
+ *
+ * The edges of a cell are summed in the same order as in the original
+ * layer-by-layer loops.  The RT2 interpolation gives identical results, and
+ * the Perot and least-squares methods agree to round-off since the edge weights
+ * are premultiplied (and for least squares, the 2x2 system is solved once per
+ * cell for the edge weights).
+ *
+ */
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+#include "memory.h"
+#include "util.h"
+#include "reconstruct.h"
+
+static ucoperatorT perot, lsq, rt;
+static REAL *Atemp;   // nodal areas for each layer used by the RT2 operator
+static int NAtemp;
+
+static int NeedsBuild(ucoperatorT *op, gridT *grid);
+static void BuildRows(ucoperatorT *op, gridT *grid);
+static void BuildPerotOperator(gridT *grid);
+static void BuildLSQOperator(gridT *grid, physT *phys);
+static void BuildRTOperator(gridT *grid);
+static void FreeOperator(ucoperatorT *op);
+static void ComputeNodalVelocity(physT *phys, gridT *grid, int myproc);
+static void ComputeTangentialVelocity(physT *phys, gridT *grid, interpolation tinterp);
+
+/*
+ * Function: ReconstructUCPerot
+ * Usage: ReconstructUCPerot(u,uc,vc,grid,phys);
+ * ---------------------------------------------
+ * Compute the cell-centered components of the velocity vector and place them
+ * into uc and vc with
+ *
+ * u = 1/Area * Sum_{faces} u_{face} normal_{face} df_{face}*d_{ef,face}
+ *
+ * in which the face fluxes are weighted by the face heights dzf and divided
+ * by the cell height dzz below the top cell.
+ *
+ */
+void ReconstructUCPerot(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys) {
+  int r, iptr, m, n, ne, k, kb, ktop, Nk;
+  REAL wx, wy, ub;
+
+  if(NeedsBuild(&perot,grid))
+    BuildPerotOperator(grid);
+
+  for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+    n=phys->wetcellp[iptr];
+    r=phys->wetcellptr[iptr]-grid->celldist[0];
+    Nk=grid->Nk[n];
+    ktop=grid->ctop[n];
+
+    for(k=0;k<Nk;k++) {
+      uc[n][k]=0;
+      vc[n][k]=0;
+    }
+
+    for(m=perot.start[r];m<perot.start[r+1];m++) {
+      ne=perot.edge[m];
+      kb=perot.kbot[m];
+      wx=perot.wx[m];
+      wy=perot.wy[m];
+
+      // top cell only - don't account for depth
+      ub=u[ne][ktop<kb ? ktop : kb];
+      uc[n][ktop]+=ub*wx;
+      vc[n][ktop]+=ub*wy;
+
+      for(k=ktop+1;k<Nk && k<=kb;k++) {
+        uc[n][k]+=u[ne][k]*wx*grid->dzf[ne][k];
+        vc[n][k]+=u[ne][k]*wy*grid->dzf[ne][k];
+      }
+      // below the bottom of the edge with smoothbot
+      for(;k<Nk;k++) {
+        uc[n][k]+=u[ne][kb]*wx*grid->dzf[ne][kb];
+        vc[n][k]+=u[ne][kb]*wy*grid->dzf[ne][kb];
+      }
+    }
+
+    for(k=ktop+1;k<Nk;k++) {
+      // In case of divide by zero (shouldn't happen)
+      if(grid->dzz[n][k]>DRYCELLHEIGHT) {
+        uc[n][k]/=grid->dzz[n][k];
+        vc[n][k]/=grid->dzz[n][k];
+      } else {
+        uc[n][k]=0;
+        vc[n][k]=0;
+      }
+    }
+  }
+}
+
+/*
+ * Function: ReconstructUCLSQ
+ * Usage: ReconstructUCLSQ(u,uc,vc,grid,phys);
+ * -------------------------------------------
+ * Compute the cell-centered components of the velocity vector and place them
+ * into uc and vc with the least-squares fit to the edge-normal velocities,
+ * whose weights are the rows of (A^T A)^{-1} A^T for the matrix A of the edge
+ * normals of each cell.
+ *
+ */
+void ReconstructUCLSQ(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys) {
+  int r, iptr, m, n, ne, k, kb, ktop, Nk;
+  REAL wx, wy;
+
+  if(NeedsBuild(&lsq,grid))
+    BuildLSQOperator(grid,phys);
+
+  for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+    n=phys->wetcellp[iptr];
+    r=phys->wetcellptr[iptr]-grid->celldist[0];
+    Nk=grid->Nk[n];
+    ktop=grid->ctop[n];
+
+    for(k=0;k<Nk;k++) {
+      uc[n][k]=0;
+      vc[n][k]=0;
+    }
+
+    for(m=lsq.start[r];m<lsq.start[r+1];m++) {
+      ne=lsq.edge[m];
+      kb=lsq.kbot[m];
+      wx=lsq.wx[m];
+      wy=lsq.wy[m];
+
+      for(k=ktop;k<Nk && k<=kb;k++) {
+        uc[n][k]+=wx*u[ne][k];
+        vc[n][k]+=wy*u[ne][k];
+      }
+      for(;k<Nk;k++) {
+        uc[n][k]+=wx*u[ne][kb];
+        vc[n][k]+=wy*u[ne][kb];
+      }
+    }
+  }
+}
+
+/*
+ * Function: ReconstructUCRT
+ * Usage: ReconstructUCRT(uc,vc,phys,grid,myproc);
+ * -----------------------------------------------
+ * Compute the cell-centered components of the velocity vector and place them
+ * into uc and vc with the quadratic interpolation of the RT2 nodal and
+ * tangential velocities outlined in Wang et al, 2011 (eq. 12) in triangular
+ * cells, and with the Perot method without the face heights in other cells.
+ *
+ */
+void ReconstructUCRT(REAL **uc, REAL **vc, physT *phys, gridT *grid, int myproc) {
+  int r, iptr, m, n, ne, np, k, kb, ktop, Nk;
+  REAL wx, wy, wn, ub;
+
+  if(NeedsBuild(&rt,grid))
+    BuildRTOperator(grid);
+
+  // first we need to reconstruct the nodal velocities using the RT0 basis functions
+  ComputeNodalVelocity(phys,grid,myproc);
+
+  // now we can get the tangential velocities from these results
+  ComputeTangentialVelocity(phys,grid,tRT2);
+
+  for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[1];iptr++) {
+    n=phys->wetcellp[iptr];
+    r=phys->wetcellptr[iptr]-grid->celldist[0];
+    Nk=grid->Nk[n];
+    ktop=grid->ctop[n];
+
+    for(k=0;k<Nk;k++) {
+      uc[n][k]=0;
+      vc[n][k]=0;
+    }
+
+    if(rt.tri[r]) {
+      // nodal terms, then edge terms, as in Wang et al 2011 eq 12
+      for(m=rt.start[r];m<rt.start[r+1];m++) {
+        np=rt.node[m];
+        wn=rt.wn[m];
+        for(k=ktop;k<Nk;k++) {
+          uc[n][k]+=wn*phys->nRT2u[np][k];
+          vc[n][k]+=wn*phys->nRT2v[np][k];
+        }
+      }
+      for(m=rt.start[r];m<rt.start[r+1];m++) {
+        ne=rt.edge[m];
+        wx=rt.wx[m];
+        for(k=ktop;k<Nk;k++) {
+          uc[n][k]+=wx*(phys->u[ne][k]*grid->n1[ne] + phys->tRT2[ne][k]*grid->n2[ne]);
+          vc[n][k]+=wx*(phys->u[ne][k]*grid->n2[ne] - phys->tRT2[ne][k]*grid->n1[ne]);
+        }
+      }
+    } else {
+      for(m=rt.start[r];m<rt.start[r+1];m++) {
+        ne=rt.edge[m];
+        kb=rt.kbot[m];
+        wx=rt.wx[m];
+        wy=rt.wy[m];
+        for(k=ktop;k<Nk && k<=kb;k++) {
+          uc[n][k]+=phys->u[ne][k]*wx;
+          vc[n][k]+=phys->u[ne][k]*wy;
+        }
+        for(;k<Nk;k++) {
+          ub=phys->u[ne][kb];
+          uc[n][k]+=ub*wx;
+          vc[n][k]+=ub*wy;
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Function: FreeReconstructionOperators
+ * Usage: FreeReconstructionOperators();
+ * -------------------------------------
+ * Frees the space allocated for the reconstruction operators.
+ *
+ */
+void FreeReconstructionOperators(void) {
+  FreeOperator(&perot);
+  FreeOperator(&lsq);
+  FreeOperator(&rt);
+  if(NAtemp) {
+    SunFree(Atemp,NAtemp*sizeof(REAL),"FreeReconstructionOperators");
+    NAtemp=0;
+  }
+}
+
+/*
+ * Function: NeedsBuild
+ * Usage: if(NeedsBuild(&perot,grid)) ...
+ * --------------------------------------
+ * Returns 1 if the operator has not been built or was built for another
+ * value of smoothbot, in which case the old one is freed.
+ *
+ */
+static int NeedsBuild(ucoperatorT *op, gridT *grid) {
+  if(op->built && op->smoothbot==grid->smoothbot)
+    return 0;
+  FreeOperator(op);
+  return 1;
+}
+
+/*
+ * Function: BuildRows
+ * Usage: BuildRows(&perot,grid);
+ * ------------------------------
+ * Allocates the operator with one row per computational cell and one entry
+ * per face and sets the edges of the entries and their deepest layers.
+ *
+ */
+static void BuildRows(ucoperatorT *op, gridT *grid) {
+  int r, m, n, nf, ne;
+
+  op->Nrows=grid->celldist[1]-grid->celldist[0];
+  op->Nentries=0;
+  for(r=0;r<op->Nrows;r++)
+    op->Nentries+=grid->nfaces[grid->cellp[grid->celldist[0]+r]];
+
+  op->start=(int *)SunMalloc((op->Nrows+1)*sizeof(int),"BuildRows");
+  op->edge=(int *)SunMalloc(op->Nentries*sizeof(int),"BuildRows");
+  op->kbot=(int *)SunMalloc(op->Nentries*sizeof(int),"BuildRows");
+  op->wx=(REAL *)SunMalloc(op->Nentries*sizeof(REAL),"BuildRows");
+  op->wy=(REAL *)SunMalloc(op->Nentries*sizeof(REAL),"BuildRows");
+
+  m=0;
+  for(r=0;r<op->Nrows;r++) {
+    n=grid->cellp[grid->celldist[0]+r];
+    op->start[r]=m;
+    for(nf=0;nf<grid->nfaces[n];nf++) {
+      ne=grid->face[n*grid->maxfaces+nf];
+      op->edge[m]=ne;
+      op->kbot[m]=(grid->smoothbot ? grid->Nke[ne]-1 : grid->Nk[n]-1);
+      m++;
+    }
+  }
+  op->start[op->Nrows]=m;
+  op->smoothbot=grid->smoothbot;
+  op->built=1;
+}
+
+/*
+ * Function: BuildPerotOperator
+ * Usage: BuildPerotOperator(grid);
+ * --------------------------------
+ * The Perot weights n df d_{ef}/Area of the faces of each cell.
+ *
+ */
+static void BuildPerotOperator(gridT *grid) {
+  int r, m, n, nf, ne;
+
+  BuildRows(&perot,grid);
+  for(r=0;r<perot.Nrows;r++) {
+    n=grid->cellp[grid->celldist[0]+r];
+    for(nf=0, m=perot.start[r];nf<grid->nfaces[n];nf++, m++) {
+      ne=perot.edge[m];
+      perot.wx[m]=grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[n];
+      perot.wy[m]=grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[n];
+    }
+  }
+}
+
+/*
+ * Function: BuildLSQOperator
+ * Usage: BuildLSQOperator(grid,phys);
+ * -----------------------------------
+ * The weights of the least-squares fit are the columns of (A^T A)^{-1} A^T,
+ * obtained by solving (A^T A) x = A^T e_nf for each face nf with linsolve.
+ * The arrays phys->A, AT, Apr and bpr are used as temporary storage.
+ *
+ */
+static void BuildLSQOperator(gridT *grid, physT *phys) {
+  int r, m, n, nf, mf, ne, ii, jj;
+  REAL sum, **A=phys->A, **AT=phys->AT, **Apr=phys->Apr, *bpr=phys->bpr;
+
+  BuildRows(&lsq,grid);
+  for(r=0;r<lsq.Nrows;r++) {
+    n=grid->cellp[grid->celldist[0]+r];
+    for(nf=0;nf<grid->nfaces[n];nf++) {
+      ne=lsq.edge[lsq.start[r]+nf];
+      A[nf][0]=grid->n1[ne];
+      A[nf][1]=grid->n2[ne];
+      AT[0][nf]=A[nf][0];
+      AT[1][nf]=A[nf][1];
+    }
+
+    for(mf=0, m=lsq.start[r];mf<grid->nfaces[n];mf++, m++) {
+      // A' = A^T*A, which is modified by linsolve()
+      for(ii=0;ii<2;ii++)
+        for(jj=0;jj<2;jj++) {
+          sum=0;
+          for(nf=0;nf<grid->nfaces[n];nf++)
+            sum+=AT[ii][nf]*A[nf][jj];
+          Apr[ii][jj]=sum;
+        }
+      for(ii=0;ii<2;ii++)
+        bpr[ii]=AT[ii][mf];
+      linsolve(Apr,bpr,2);
+
+      lsq.wx[m]=bpr[0];
+      lsq.wy[m]=bpr[1];
+    }
+  }
+}
+
+/*
+ * Function: BuildRTOperator
+ * Usage: BuildRTOperator(grid);
+ * -----------------------------
+ * Triangular cells store the weights of the nodal and edge velocities in the
+ * quadratic interpolation of Wang et al 2011 (eq. 12), which are functions of
+ * the areas of the sub-triangles formed by the Voronoi point and each face,
+ * and other cells store the Perot weights.  Also builds the nodal operator
+ * with the edge pairs of the cell neighbors of each node that are used by the
+ * RT0 reconstruction of the nodal velocities.
+ *
+ */
+static void BuildRTOperator(gridT *grid) {
+  int r, m, n, nf, ne, in, inpc;
+  REAL xt[3], yt[3], SubArea[3];
+
+  BuildRows(&rt,grid);
+  rt.tri=(int *)SunMalloc(rt.Nrows*sizeof(int),"BuildRTOperator");
+  rt.node=(int *)SunMalloc(rt.Nentries*sizeof(int),"BuildRTOperator");
+  rt.wn=(REAL *)SunMalloc(rt.Nentries*sizeof(REAL),"BuildRTOperator");
+
+  for(r=0;r<rt.Nrows;r++) {
+    n=grid->cellp[grid->celldist[0]+r];
+    rt.tri[r]=(grid->nfaces[n]==3);
+    m=rt.start[r];
+
+    if(rt.tri[r]) {
+      // nf=0 => A12, nf=1 => A23, nf=2 => A13 from Wang et al 2011
+      // note that this is normalized
+      for(nf=0;nf<3;nf++) {
+        xt[0]=grid->xp[grid->cells[grid->maxfaces*n+nf]];
+        yt[0]=grid->yp[grid->cells[grid->maxfaces*n+nf]];
+        xt[1]=grid->xp[grid->cells[grid->maxfaces*n+(nf+1)%3]];
+        yt[1]=grid->yp[grid->cells[grid->maxfaces*n+(nf+1)%3]];
+        xt[2]=grid->xv[n];
+        yt[2]=grid->yv[n];
+        SubArea[nf]=GetArea(xt,yt,3)/grid->Ac[n];
+      }
+      for(nf=0;nf<3;nf++) {
+        rt.node[m+nf]=grid->cells[grid->maxfaces*n+nf];
+        rt.wn[m+nf]=(2*SubArea[(nf+1)%3]-1)*SubArea[(nf+1)%3];
+        rt.wy[m+nf]=0;
+      }
+      rt.wx[m]=4*SubArea[2]*SubArea[1];
+      rt.wx[m+1]=4*SubArea[0]*SubArea[2];
+      rt.wx[m+2]=4*SubArea[0]*SubArea[1];
+    } else {
+      for(nf=0;nf<grid->nfaces[n];nf++, m++) {
+        ne=rt.edge[m];
+        rt.node[m]=-1;
+        rt.wn[m]=0;
+        rt.wx[m]=grid->n1[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[n];
+        rt.wy[m]=grid->n2[ne]*grid->def[n*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[n];
+      }
+    }
+  }
+
+  rt.Np=grid->Np;
+  rt.Nnodeentries=0;
+  for(in=0;in<grid->Np;in++)
+    rt.Nnodeentries+=grid->numpcneighs[in];
+  rt.nstart=(int *)SunMalloc((grid->Np+1)*sizeof(int),"BuildRTOperator");
+  rt.pcell=(int *)SunMalloc(rt.Nnodeentries*sizeof(int),"BuildRTOperator");
+  rt.e1=(int *)SunMalloc(rt.Nnodeentries*sizeof(int),"BuildRTOperator");
+  rt.e2=(int *)SunMalloc(rt.Nnodeentries*sizeof(int),"BuildRTOperator");
+  rt.e1n1=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+  rt.e1n2=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+  rt.e2n1=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+  rt.e2n2=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+  rt.det=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+  rt.Apc=(REAL *)SunMalloc(rt.Nnodeentries*sizeof(REAL),"BuildRTOperator");
+
+  m=0;
+  for(in=0;in<grid->Np;in++) {
+    rt.nstart[in]=m;
+    for(inpc=0;inpc<grid->numpcneighs[in];inpc++, m++) {
+      rt.pcell[m]=grid->pcneighs[in][inpc];
+      rt.e1[m]=grid->peneighs[in][2*inpc];
+      rt.e2[m]=grid->peneighs[in][2*inpc+1];
+      rt.e1n1[m]=grid->n1[rt.e1[m]];
+      rt.e1n2[m]=grid->n2[rt.e1[m]];
+      rt.e2n1[m]=grid->n1[rt.e2[m]];
+      rt.e2n2[m]=grid->n2[rt.e2[m]];
+      rt.det[m]=rt.e1n1[m]*rt.e2n2[m] - rt.e1n2[m]*rt.e2n1[m];
+      rt.Apc[m]=grid->Ac[rt.pcell[m]];
+    }
+  }
+  rt.nstart[grid->Np]=m;
+
+  if(!NAtemp) {
+    NAtemp=grid->Nkmax;
+    Atemp=(REAL *)SunMalloc(NAtemp*sizeof(REAL),"BuildRTOperator");
+  }
+}
+
+/*
+ * Function: FreeOperator
+ * Usage: FreeOperator(&perot);
+ * ----------------------------
+ * Frees the arrays of an operator and marks it as not built.
+ *
+ */
+static void FreeOperator(ucoperatorT *op) {
+  if(!op->built)
+    return;
+
+  SunFree(op->start,(op->Nrows+1)*sizeof(int),"FreeOperator");
+  SunFree(op->edge,op->Nentries*sizeof(int),"FreeOperator");
+  SunFree(op->kbot,op->Nentries*sizeof(int),"FreeOperator");
+  SunFree(op->wx,op->Nentries*sizeof(REAL),"FreeOperator");
+  SunFree(op->wy,op->Nentries*sizeof(REAL),"FreeOperator");
+  if(op->tri!=NULL) {
+    SunFree(op->tri,op->Nrows*sizeof(int),"FreeOperator");
+    SunFree(op->node,op->Nentries*sizeof(int),"FreeOperator");
+    SunFree(op->wn,op->Nentries*sizeof(REAL),"FreeOperator");
+  }
+  if(op->nstart!=NULL) {
+    SunFree(op->nstart,(op->Np+1)*sizeof(int),"FreeOperator");
+    SunFree(op->pcell,op->Nnodeentries*sizeof(int),"FreeOperator");
+    SunFree(op->e1,op->Nnodeentries*sizeof(int),"FreeOperator");
+    SunFree(op->e2,op->Nnodeentries*sizeof(int),"FreeOperator");
+    SunFree(op->e1n1,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+    SunFree(op->e1n2,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+    SunFree(op->e2n1,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+    SunFree(op->e2n2,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+    SunFree(op->det,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+    SunFree(op->Apc,op->Nnodeentries*sizeof(REAL),"FreeOperator");
+  }
+  op->tri=op->node=NULL;
+  op->wn=NULL;
+  op->nstart=NULL;
+  op->built=0;
+}
+
+/*
+ * Function: ComputeNodalVelocity
+ * Usage: ComputeNodalVelocity(phys,grid,myproc);
+ * ----------------------------------------------
+ * Compute the nodal velocity using RT0 basis functions (nRT1, Appendix B of
+ * Wang et al 2011) for each cell neighbor of a node, and their area-weighted
+ * average nRT2.
+ *
+ */
+static void ComputeNodalVelocity(physT *phys, gridT *grid, int myproc) {
+  int in, ink, inpc, m, e1, e2, Nkp, Nkc;
+  REAL tempu, tempv;
+
+  for(in=0;in<grid->Np;in++) {
+    Nkp=grid->Nkp[in];
+    for(ink=0;ink<Nkp;ink++) {
+      phys->nRT2u[in][ink]=0;
+      phys->nRT2v[in][ink]=0;
+      Atemp[ink]=0;
+    }
+
+    for(m=rt.nstart[in];m<rt.nstart[in+1];m++) {
+      inpc=m-rt.nstart[in];
+      e1=rt.e1[m];
+      e2=rt.e2[m];
+      // the cell neighbor only exists in its Nk layers
+      Nkc=(grid->Nk[rt.pcell[m]]<Nkp ? grid->Nk[rt.pcell[m]] : Nkp);
+
+      for(ink=0;ink<Nkc;ink++) {
+        // compute using the basis functions directly with inverted 2x2 matrix
+        tempu=(rt.e2n2[m]*phys->u[e1][ink] - rt.e1n2[m]*phys->u[e2][ink])/rt.det[m];
+        tempv=(rt.e1n1[m]*phys->u[e2][ink] - rt.e2n1[m]*phys->u[e1][ink])/rt.det[m];
+        phys->nRT1u[in][ink][inpc]=tempu;
+        phys->nRT1v[in][ink][inpc]=tempv;
+        Atemp[ink]+=rt.Apc[m];
+        phys->nRT2u[in][ink]+=rt.Apc[m]*tempu;
+        phys->nRT2v[in][ink]+=rt.Apc[m]*tempv;
+      }
+      for(;ink<Nkp;ink++) {
+        phys->nRT1u[in][ink][inpc]=0;
+        phys->nRT1v[in][ink][inpc]=0;
+      }
+    }
+
+    // area-weighted average of the nRT1 values of all cells
+    for(ink=0;ink<Nkp;ink++) {
+      if(Atemp[ink]==0) {
+        printf("Error as Atemp is 0 in nodal calc!! at in,ink,Nkp=%d,%d,%d\n",in,ink,Nkp);
+        printf("cell neighbors = ");
+        for(inpc=0;inpc<grid->numpcneighs[in];inpc++)
+          printf(" %d(%d)",grid->pcneighs[in][inpc],grid->Nk[grid->pcneighs[in][inpc]]);
+        printf("\n");
+      }
+      phys->nRT2u[in][ink]/=Atemp[ink];
+      phys->nRT2v[in][ink]/=Atemp[ink];
+    }
+  }
+}
+
+/*
+ * Function: ComputeTangentialVelocity
+ * Usage: ComputeTangentialVelocity(phys,grid,tRT2);
+ * -------------------------------------------------
+ * Compute the tangential velocity on each edge from the area-weighted
+ * average of the nRT2 velocities at its nodes (tRT2 in Wang et al, 2011).
+ *
+ */
+static void ComputeTangentialVelocity(physT *phys, gridT *grid, interpolation tinterp) {
+  int ie, in, ink, tempnode, nodes[2];
+  REAL tempu, tempv, tempA;
+
+  if(tinterp==tRT2) {
+    for(ie=0;ie<grid->Ne;ie++) {
+      nodes[0]=grid->edges[NUMEDGECOLUMNS*ie];
+      nodes[1]=grid->edges[NUMEDGECOLUMNS*ie+1];
+
+      for(ink=0;ink<grid->Nkc[ie];ink++) {
+        tempu=tempv=tempA=0;
+        for(in=0;in<2;in++) {
+          tempnode=nodes[in];
+          // ensure that the node exists at the level
+          if(ink<grid->Nkp[tempnode]) {
+            tempA+=grid->Actotal[tempnode][ink];
+            tempu+=grid->Actotal[tempnode][ink]*phys->nRT2u[tempnode][ink];
+            tempv+=grid->Actotal[tempnode][ink]*phys->nRT2v[tempnode][ink];
+          }
+        }
+        if(tempA==0)
+          phys->tRT2[ie][ink]=0;
+        else {
+          tempu/=tempA;
+          tempv/=tempA;
+          // get the correct component in the tangential direction to store it
+          phys->tRT2[ie][ink]=grid->n2[ie]*tempu - grid->n1[ie]*tempv;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,46 @@
+/*
+ * File: reconstruct.h
+ * -------------------
+ * Header file for reconstruct.c, which computes the cell-centered velocity
+ * from the edge-normal velocity with precomputed reconstruction operators.
+ *
+ */
+#ifndef _reconstruct_h
+#define _reconstruct_h
+
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+
+/*
+ * Sparse edge-to-cell reconstruction operator in compressed-row form.  Row r
+ * is the computational cell cellp[celldist[0]+r] and its entries
+ * start[r]..start[r+1]-1 hold the edges of the cell with the weights wx and wy
+ * of the x and y components.  kbot is the deepest layer of the edge whose
+ * velocity is used, which is Nke-1 with smoothbot and Nk of the cell
+ * otherwise.  For the quadratic (RT2) operator, node and wn hold the nodes of
+ * triangular cells and the weights of the nodal velocities, and the nodal
+ * operator is stored per node in the same form with nstart, the cell
+ * neighbors pcell and the normals and determinants of the edge pairs.
+ *
+ */
+typedef struct _ucoperatorT {
+  int built;        // 1 once the operator has been built
+  REAL smoothbot;   // value of grid->smoothbot the operator was built for
+  int Nrows, Nentries;
+  int *start, *edge, *kbot;
+  REAL *wx, *wy;
+  int *tri;         // 1 for rows computed with the quadratic interpolation
+  int *node;
+  REAL *wn;
+  int Np, Nnodeentries;
+  int *nstart, *pcell, *e1, *e2;
+  REAL *e1n1, *e1n2, *e2n1, *e2n2, *det, *Apc;
+} ucoperatorT;
+
+void ReconstructUCPerot(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys);
+void ReconstructUCLSQ(REAL **u, REAL **uc, REAL **vc, gridT *grid, physT *phys);
+void ReconstructUCRT(REAL **uc, REAL **vc, physT *phys, gridT *grid, int myproc);
+void FreeReconstructionOperators(void);
+
+#endif
@@ -14,6 +14,7 @@
 #include "tvd.h"
 #include "subgrid.h"
 #include "initialization.h"
+#include "check.h"
 
 #define SMALL_CONSISTENCY 1e-5
 
@@ -117,8 +118,9 @@ void UpdateScalars(gridT *grid, physT *phys, propT *prop, REAL **w_im, REAL **sc
     HorizontalFaceScalars(grid,phys,prop,scal,boundary_scal,prop->TVD,comm,myproc); 
 
   //for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
-    i = grid->cellp[iptr];
+  // over the active cells (see UpdateActiveLists in phys.c)
+  for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[2];iptr++) {
+    i = phys->wetcellp[iptr];
     Ac = grid->Ac[i];
 
     if(grid->ctop[i]>=grid->ctopold[i]) {
@@ -479,6 +481,9 @@ void UpdateScalars(gridT *grid, physT *phys, propT *prop, REAL **w_im, REAL **sc
     // update scal^old
     for(k=0;k<grid->Nk[i];k++) 
       scal_old[i][k]=phys->stmp[i][k];
+
+    if(prop->checkmode && scal==phys->s)
+      CheckScalarColumn(grid,scal,i);
   }
 
   // Code to check divergence change CHECKCONSISTENCY to 1 in suntans.h
@@ -501,10 +506,10 @@ void UpdateScalars(gridT *grid, physT *phys, propT *prop, REAL **w_im, REAL **sc
           }
         }
       }
-      MPI_Reduce(&smin,&smin_value,1,MPI_DOUBLE,MPI_MIN,0,comm);
-      MPI_Reduce(&smax,&smax_value,1,MPI_DOUBLE,MPI_MAX,0,comm);
-      MPI_Bcast(&smin_value,1,MPI_DOUBLE,0,comm);
-      MPI_Bcast(&smax_value,1,MPI_DOUBLE,0,comm);
+      MPI_Reduce(&smin,&smin_value,1,MPI_REALTYPE,MPI_MIN,0,comm);
+      MPI_Reduce(&smax,&smax_value,1,MPI_REALTYPE,MPI_MAX,0,comm);
+      MPI_Bcast(&smin_value,1,MPI_REALTYPE,0,comm);
+      MPI_Bcast(&smax_value,1,MPI_REALTYPE,0,comm);
 
       if(myproc==0)
         printf("Minimum scalar: %.2f, maximum: %.2f\n",smin_value,smax_value);
@@ -25,23 +25,27 @@
 #include "wave.h"
 #include "culvert.h"
 #include "timer.h"
+#include "timestep.h"
+#include "sendrecv.h"
  
 void ReadSediProperties(int myproc);
 void InitializeSediment(gridT *grid, physT *phys, propT *prop,int myproc);
 void AllocateSediment(gridT *grid, int myproc);
 void FreeSediment(gridT *grid, int myproc);
 void BedChange(gridT *grid, physT *phys, propT *prop, int myproc);
-void SedimentSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop,int Nosize, REAL theta);
-void SedimentVerticalVelocity(gridT *grid, physT *phys,int Nosize,int symbol, int myproc);
+void SedimentSource(REAL *A, REAL *B, gridT *grid, propT *prop, int Nosize, int i, REAL theta);
+void UpdateSedimentClasses(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int myproc);
 void CalculateSedimentKb(gridT *grid, physT *phys, int myproc);
 void RouseCurveAlpha(gridT *grid, physT *phys, propT *prop, int myproc);
 void OpenSediFiles(propT *prop, int myproc);
 void OutputSediment(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, int blowup, MPI_Comm comm);
-void CalculateSediDiffusivity(gridT *grid, physT *phys,int Nosize,int myproc); 
+void CalculateSediDiffusivity(gridT *grid, physT *phys, int myproc); 
 void ISendRecvSediBedData3D(REAL **celldata, gridT *grid, int nlayer, int myproc, MPI_Comm comm);
 void SettlingVelocity(gridT *grid, physT *phys, propT *prop, int myproc);
 void CalculateErosion(gridT *grid, physT *phys, propT *prop,  int myproc);
-void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int myproc); //used by calculateerosion and Bedchange
+void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int accumulate, int myproc); //used by calculateerosion and Bedchange
+void BedLayerParameters(propT *prop);
+void UpdateBedLayers(gridT *grid);
 
 /*
  * Function: ReadSediProperties
@@ -63,12 +67,18 @@ void ReadSediProperties(int myproc) {
   sediments->bedComplex= MPI_GetValue(DATAFILE,"bedComplex","ReadSediProperties",myproc);
   sediments->ParabolKappa= MPI_GetValue(DATAFILE,"ParabolKappa","ReadSediProperties",myproc);
   sediments->layerprop=MPI_GetValue(DATAFILE,"sedilayerprop","ReadSediProperties",myproc);
+  sediments->morfac=MPI_GetValue(DATAFILE,"morfac","ReadSediProperties",myproc);
   if(sediments->bedComplex==1){
     printf("because bedComplex==1, so set bedInterval=1 automatically");
     sediments->bedInterval=1;
   }
   
   // condition check
+  if(sediments->morfac<=0){
+    printf("morfac = %f must be positive.\n",sediments->morfac);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
   if(sediments->readSediment==1 && sediments->Nsize>3){
     printf("Nsize = %d>1, but readSediment==1 which means Nsize==1. You should set readSediment as 0 or Nsize==1.\n",sediments->Nsize);
     MPI_Finalize();
@@ -176,6 +186,7 @@ void AllocateSediment(gridT *grid, int myproc) {
   sediments->Deposition_old = (REAL **)SunMalloc(sediments->Nsize*sizeof(REAL *), "AllocateSediVariables");
   sediments->Toplayerratio = (REAL **)SunMalloc(sediments->Nsize*sizeof(REAL *), "AllocateSediVariables");
   sediments->Layerthickness = (REAL ***)SunMalloc(sediments->Nsize*sizeof(REAL **), "AllocateSediVariables");
+  sediments->Bedflux = (REAL ***)SunMalloc(sediments->Nsize*sizeof(REAL **), "AllocateSediVariables");
   sediments->Seditb = (REAL *)SunMalloc(grid->Nc*sizeof(REAL), "AllocateSediVariables");
   sediments->Totalthickness = (REAL *)SunMalloc(grid->Nc*sizeof(REAL), "AllocateSediVariables");
   sediments->Reposangle = (REAL *)SunMalloc(grid->Nc*sizeof(REAL), "AllocateSediVariables");
@@ -194,19 +205,28 @@ void AllocateSediment(gridT *grid, int myproc) {
     sediments->Erosion[i] = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
     sediments->Erosion_old[i] = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
     sediments->Layerthickness[i] = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
+    sediments->Bedflux[i] = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
+    // the bed layers of a fraction are stored contiguously, cell by cell
+    sediments->Erosion[i][0] = (REAL *)SunMalloc(grid->Nc*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables"); 
+    sediments->Erosion_old[i][0] = (REAL *)SunMalloc(grid->Nc*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables"); 
+    sediments->Layerthickness[i][0] = (REAL *)SunMalloc(grid->Nc*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+    sediments->Bedflux[i][0] = (REAL *)SunMalloc(grid->Nc*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
     for(j=0;j<grid->Nc;j++){
       sediments->SediC[i][j] = (REAL *)SunMalloc(grid->Nk[j]*sizeof(REAL), "AllocateSediVariables");
       sediments->SediC_old[i][j] = (REAL *)SunMalloc(grid->Nk[j]*sizeof(REAL), "AllocateSediVariables");
-      sediments->Erosion[i][j] = (REAL *)SunMalloc(sediments->Nlayer*sizeof(REAL), "AllocateSediVariables"); 
-      sediments->Erosion_old[i][j] = (REAL *)SunMalloc(sediments->Nlayer*sizeof(REAL), "AllocateSediVariables"); 
-      sediments->Layerthickness[i][j]= (REAL *)SunMalloc(sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
-      // allocate boundary value
-      for(jptr=grid->edgedist[2];jptr<grid->edgedist[5];jptr++) {
-        k=grid->edgep[jptr];  
-        sediments->boundary_sediC[i][jptr-grid->edgedist[2]] = (REAL *)SunMalloc(grid->Nke[k]*sizeof(REAL), "AllocateSediVariables");
-      }
+      sediments->Erosion[i][j] = sediments->Erosion[i][0]+j*sediments->Nlayer;
+      sediments->Erosion_old[i][j] = sediments->Erosion_old[i][0]+j*sediments->Nlayer;
+      sediments->Layerthickness[i][j] = sediments->Layerthickness[i][0]+j*sediments->Nlayer;
+      sediments->Bedflux[i][j] = sediments->Bedflux[i][0]+j*sediments->Nlayer;
       sediments->Ws[i][j] = (REAL *)SunMalloc((grid->Nk[j]+1)*sizeof(REAL), "AllocateSediVariables"); 
     }
+    // allocate boundary value
+    for(jptr=grid->edgedist[2];jptr<grid->edgedist[5];jptr++) {
+      j=grid->edgep[jptr];
+      sediments->boundary_sediC[i][jptr-grid->edgedist[2]] = (REAL *)SunMalloc(grid->Nke[j]*sizeof(REAL), "AllocateSediVariables");
+      for(k=0;k<grid->Nke[j];k++)
+        sediments->boundary_sediC[i][jptr-grid->edgedist[2]][k]=0;
+    }
   }
   sediments->Thicknesslayer = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
   sediments->SediKappa_tv = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
@@ -216,6 +236,102 @@ void AllocateSediment(gridT *grid, int myproc) {
     sediments->Wnewsedi[i]= (REAL *)SunMalloc((grid->Nk[i]+1)*sizeof(REAL), "AllocateSediVariables");
     sediments->SediKappa_tv[i]= (REAL *)SunMalloc((grid->Nk[i])*sizeof(REAL), "AllocateSediVariables");
   }
+
+  // work space of UpdateSedimentClasses
+  sediments->SfHp = (REAL ***)SunMalloc(sediments->Nsize*sizeof(REAL **), "AllocateSediVariables");
+  sediments->SfHm = (REAL ***)SunMalloc(sediments->Nsize*sizeof(REAL **), "AllocateSediVariables");
+  for(i=0;i<sediments->Nsize;i++){
+    sediments->SfHp[i] = (REAL **)SunMalloc(grid->Ne*sizeof(REAL *), "AllocateSediVariables");
+    sediments->SfHm[i] = (REAL **)SunMalloc(grid->Ne*sizeof(REAL *), "AllocateSediVariables");
+    for(j=0;j<grid->Ne;j++){
+      sediments->SfHp[i][j] = (REAL *)SunMalloc(grid->Nke[j]*sizeof(REAL), "AllocateSediVariables");
+      sediments->SfHm[i][j] = (REAL *)SunMalloc(grid->Nke[j]*sizeof(REAL), "AllocateSediVariables");
+      for(k=0;k<grid->Nke[j];k++)
+        sediments->SfHp[i][j][k]=sediments->SfHm[i][j][k]=0;
+    }
+  }
+  sediments->SumQC = (REAL ***)SunMalloc((sediments->Nsize+1)*sizeof(REAL **), "AllocateSediVariables");
+  for(i=0;i<sediments->Nsize+1;i++){
+    sediments->SumQC[i] = (REAL **)SunMalloc(grid->Nc*sizeof(REAL *), "AllocateSediVariables");
+    for(j=0;j<grid->Nc;j++){
+      sediments->SumQC[i][j] = (REAL *)SunMalloc(grid->Nk[j]*sizeof(REAL), "AllocateSediVariables");
+      for(k=0;k<grid->Nk[j];k++)
+        sediments->SumQC[i][j][k]=0;
+    }
+  }
+  sediments->Atri = (REAL *)SunMalloc(grid->Nkmax*sediments->Nsize*sizeof(REAL), "AllocateSediVariables");
+  sediments->Btri = (REAL *)SunMalloc(grid->Nkmax*sediments->Nsize*sizeof(REAL), "AllocateSediVariables");
+  sediments->Ctri = (REAL *)SunMalloc(grid->Nkmax*sediments->Nsize*sizeof(REAL), "AllocateSediVariables");
+  sediments->Dtri = (REAL *)SunMalloc(grid->Nkmax*sediments->Nsize*sizeof(REAL), "AllocateSediVariables");
+  sediments->Xtri = (REAL *)SunMalloc(grid->Nkmax*sediments->Nsize*sizeof(REAL), "AllocateSediVariables");
+  sediments->Apsedi = (REAL *)SunMalloc((grid->Nkmax+1)*sizeof(REAL), "AllocateSediVariables");
+  sediments->Amsedi = (REAL *)SunMalloc((grid->Nkmax+1)*sizeof(REAL), "AllocateSediVariables");
+  sediments->bdsedi = (REAL *)SunMalloc((grid->Nkmax+1)*sizeof(REAL), "AllocateSediVariables");
+  sediments->Hsedi = (REAL *)SunMalloc(grid->Nkmax*sizeof(REAL), "AllocateSediVariables");
+  sediments->Cnsedi = (REAL *)SunMalloc(grid->Nkmax*sizeof(REAL), "AllocateSediVariables");
+  sediments->Fhsedi = (REAL *)SunMalloc(grid->maxfaces*grid->Nkmax*sizeof(REAL), "AllocateSediVariables");
+  sediments->Fhup = (int *)SunMalloc(grid->maxfaces*grid->Nkmax*sizeof(int), "AllocateSediVariables");
+
+  // the boundary values of a cell next to type 2 or 3 boundaries come from its last boundary edge
+  sediments->Bedge = (int *)SunMalloc(grid->Nc*sizeof(int), "AllocateSediVariables");
+  for(i=0;i<grid->Nc;i++)
+    sediments->Bedge[i]=-1;
+  for(jptr=grid->edgedist[2];jptr<grid->edgedist[5];jptr++)
+    sediments->Bedge[grid->grad[2*grid->edgep[jptr]]]=jptr-grid->edgedist[2];
+
+  // time-invariant parameters of the bed layers set by BedLayerParameters
+  sediments->Taubexp = (REAL *)SunMalloc(grid->Nc*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedtaue = (REAL *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedinvtaue = (REAL *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedesoft = (REAL *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedmmax = (REAL *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedinvrho = (REAL *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Bedsoft = (int *)SunMalloc(sediments->Nsize*sediments->Nlayer*sizeof(int), "AllocateSediVariables");
+  sediments->Bedconsolid = (REAL *)SunMalloc(sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+  sediments->Tstarcoef = (REAL *)SunMalloc(sediments->Nlayer*sizeof(REAL), "AllocateSediVariables");
+}
+
+/*
+ * Function: BedLayerParameters
+ * Usage: BedLayerParameters(prop);
+ * ----------------------------------------------------
+ * Compute the parameters of the erosion rate, the thickness limit, the
+ * consolidation and the bed roughness of each layer, which do not change
+ * during the run, so that CalculateErosion, CalculateDeposition, BedChange
+ * and CalculateSedimentKb only evaluate the shear stress dependence.
+ *
+ */
+void BedLayerParameters(propT *prop) {
+  int i,k,m,Nlayer=sediments->Nlayer;
+  REAL a1=0.068;
+
+  for(i=0;i<sediments->Nsize;i++)
+    for(k=0;k<Nlayer;k++){
+      m=i*Nlayer+k;
+      sediments->Bedtaue[m]=sediments->Taue[i][k];
+      sediments->Bedinvtaue[m]=1/sediments->Taue[i][k];
+      sediments->Bedsoft[m]=(sediments->Softhard[k]==0);
+      sediments->Bedesoft[m]=sediments->E0[i][k]*exp(-ESOFT*sediments->Taue[i][k]);
+      sediments->Bedmmax[m]=sediments->Drydensity[i][k]/sediments->morfac;
+      sediments->Bedinvrho[m]=1/sediments->Drydensity[i][k];
+    }
+
+  // each layer gains the consolidation of the layer above it and loses its own,
+  // and a single layer loses half of its own as in its trapezoidal update
+  for(k=0;k<Nlayer;k++)
+    sediments->Bedconsolid[k]=-sediments->Consolid[k];
+  for(k=1;k<Nlayer;k++)
+    sediments->Bedconsolid[k]+=sediments->Consolid[k-1];
+  if(Nlayer==1)
+    sediments->Bedconsolid[0]*=0.5;
+
+  for(k=0;k<Nlayer;k++){
+    sediments->Tstarcoef[k]=0;
+    for(i=0;i<sediments->Nsize;i++)
+      sediments->Tstarcoef[k]+=1/sediments->Taue[i][k]/sediments->Nsize;
+  }
+  sediments->Kba1=0.056*sediments->ds50*a1;
+  sediments->Kba2=0.0204*pow(log(sediments->ds50),2)+0.022*log(sediments->ds50)+0.0709;
 }
 
 /*
@@ -287,6 +403,7 @@ void InitializeSediment(gridT *grid, physT *phys, propT *prop,  int myproc) {
         sediments->Erosion[i][j][k]=0;
         sediments->Erosion_old[i][j][k]=0;
         sediments->Layerthickness[i][j][k]=0;
+        sediments->Bedflux[i][j][k]=0;
       }
     }
   
@@ -375,10 +492,11 @@ void InitializeSediment(gridT *grid, physT *phys, propT *prop,  int myproc) {
     sediments->z0r[i] = 0;
     sediments->kb[i] = 30*sediments->z0s[i];
   }
+  BedLayerParameters(prop);
     
   // calculate initial Deposition & deposition
   CalculateErosion(grid,phys,prop,myproc);
-  CalculateDeposition(grid,phys,prop,myproc);
+  CalculateDeposition(grid,phys,prop,0,myproc);
 }
 
 /*
@@ -415,6 +533,118 @@ void RouseCurveAlpha(gridT *grid, physT *phys, propT *prop, int myproc){
     } 
 }
 
+/*
+ * Function: SedimentsRepartition
+ * Usage: SedimentsRepartition(grid,prop,oldsediments,myproc);
+ * -----------------------------------------------------------
+ * Create the sediment model on the repartitioned grid with the properties and
+ * the output files of oldsediments.  The concentrations and the bed of
+ * oldsediments must be transferred by the caller (see MigrateSediments in
+ * rebalance.c), which then frees its arrays with FreeSedimentArrays.
+ *
+ */
+void SedimentsRepartition(gridT *grid, propT *prop, sedimentsT *oldsediments, int myproc) {
+  sediments=(sedimentsT *)SunMalloc(sizeof(sedimentsT),"SedimentsRepartition");
+  *sediments=*oldsediments;
+  AllocateSediment(grid,myproc);
+  BedLayerParameters(prop);
+}
+
+/*
+ * Function: FreeSedimentArrays
+ * Usage: FreeSedimentArrays(oldsediments,grid);
+ * ---------------------------------------------
+ * Free the sediment model s and the arrays that were allocated on grid by
+ * AllocateSediment.  The properties read by ReadSediProperties, which are
+ * shared with the sediment model of a repartitioned grid, are kept.
+ *
+ */
+void FreeSedimentArrays(sedimentsT *s, gridT *grid) {
+  int i, j, n, Nb=grid->edgedist[5]-grid->edgedist[2], NL=s->Nsize*s->Nlayer;
+  REAL ***cellarrays[] = {s->SediC,s->SediC_old},
+    ***bedarrays[] = {s->Erosion,s->Erosion_old,s->Layerthickness,s->Bedflux},
+    **fractions[] = {s->Deposition,s->alphaSSC,s->Deposition_old,s->Toplayerratio},
+    *cells[] = {s->kb,s->z0b,s->z0r,s->z0s,s->Seditb,s->Totalthickness,s->Reposangle,
+		s->Seditbmax,s->Taubexp},
+    *layers[] = {s->Bedtaue,s->Bedinvtaue,s->Bedesoft,s->Bedmmax,s->Bedinvrho};
+
+  for(i=0;i<s->Nsize;i++) {
+    for(n=0;n<(int)(sizeof(cellarrays)/sizeof(REAL ***));n++) {
+      for(j=0;j<grid->Nc;j++)
+	SunFree(cellarrays[n][i][j],grid->Nk[j]*sizeof(REAL),"FreeSedimentArrays");
+      SunFree(cellarrays[n][i],grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+    }
+    for(j=0;j<grid->Nc;j++)
+      SunFree(s->Ws[i][j],(grid->Nk[j]+1)*sizeof(REAL),"FreeSedimentArrays");
+    SunFree(s->Ws[i],grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+    for(n=0;n<(int)(sizeof(bedarrays)/sizeof(REAL ***));n++) {
+      SunFree(bedarrays[n][i][0],grid->Nc*s->Nlayer*sizeof(REAL),"FreeSedimentArrays");
+      SunFree(bedarrays[n][i],grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+    }
+    for(n=0;n<(int)(sizeof(fractions)/sizeof(REAL **));n++)
+      SunFree(fractions[n][i],grid->Nc*sizeof(REAL),"FreeSedimentArrays");
+    for(j=0;j<Nb;j++)
+      SunFree(s->boundary_sediC[i][j],grid->Nke[grid->edgep[j+grid->edgedist[2]]]*sizeof(REAL),
+	      "FreeSedimentArrays");
+    SunFree(s->boundary_sediC[i],Nb*sizeof(REAL *),"FreeSedimentArrays");
+    for(j=0;j<grid->Ne;j++) {
+      SunFree(s->SfHp[i][j],grid->Nke[j]*sizeof(REAL),"FreeSedimentArrays");
+      SunFree(s->SfHm[i][j],grid->Nke[j]*sizeof(REAL),"FreeSedimentArrays");
+    }
+    SunFree(s->SfHp[i],grid->Ne*sizeof(REAL *),"FreeSedimentArrays");
+    SunFree(s->SfHm[i],grid->Ne*sizeof(REAL *),"FreeSedimentArrays");
+  }
+  for(i=0;i<s->Nsize+1;i++) {
+    for(j=0;j<grid->Nc;j++)
+      SunFree(s->SumQC[i][j],grid->Nk[j]*sizeof(REAL),"FreeSedimentArrays");
+    SunFree(s->SumQC[i],grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+  }
+  for(n=0;n<(int)(sizeof(cellarrays)/sizeof(REAL ***));n++)
+    SunFree(cellarrays[n],s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  for(n=0;n<(int)(sizeof(bedarrays)/sizeof(REAL ***));n++)
+    SunFree(bedarrays[n],s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  for(n=0;n<(int)(sizeof(fractions)/sizeof(REAL **));n++)
+    SunFree(fractions[n],s->Nsize*sizeof(REAL *),"FreeSedimentArrays");
+  SunFree(s->Ws,s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  SunFree(s->boundary_sediC,s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  SunFree(s->SfHp,s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  SunFree(s->SfHm,s->Nsize*sizeof(REAL **),"FreeSedimentArrays");
+  SunFree(s->SumQC,(s->Nsize+1)*sizeof(REAL **),"FreeSedimentArrays");
+
+  for(j=0;j<grid->Nc;j++) {
+    SunFree(s->Thicknesslayer[j],s->Nlayer*sizeof(REAL),"FreeSedimentArrays");
+    SunFree(s->Wnewsedi[j],(grid->Nk[j]+1)*sizeof(REAL),"FreeSedimentArrays");
+    SunFree(s->SediKappa_tv[j],grid->Nk[j]*sizeof(REAL),"FreeSedimentArrays");
+  }
+  SunFree(s->Thicknesslayer,grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+  SunFree(s->Wnewsedi,grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+  SunFree(s->SediKappa_tv,grid->Nc*sizeof(REAL *),"FreeSedimentArrays");
+  for(n=0;n<(int)(sizeof(cells)/sizeof(REAL *));n++)
+    SunFree(cells[n],grid->Nc*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Layertop,grid->Nc*sizeof(int),"FreeSedimentArrays");
+  SunFree(s->Bedge,grid->Nc*sizeof(int),"FreeSedimentArrays");
+
+  SunFree(s->Atri,grid->Nkmax*s->Nsize*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Btri,grid->Nkmax*s->Nsize*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Ctri,grid->Nkmax*s->Nsize*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Dtri,grid->Nkmax*s->Nsize*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Xtri,grid->Nkmax*s->Nsize*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Apsedi,(grid->Nkmax+1)*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Amsedi,(grid->Nkmax+1)*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->bdsedi,(grid->Nkmax+1)*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Hsedi,grid->Nkmax*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Cnsedi,grid->Nkmax*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Fhsedi,grid->maxfaces*grid->Nkmax*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Fhup,grid->maxfaces*grid->Nkmax*sizeof(int),"FreeSedimentArrays");
+
+  for(n=0;n<(int)(sizeof(layers)/sizeof(REAL *));n++)
+    SunFree(layers[n],NL*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Bedsoft,NL*sizeof(int),"FreeSedimentArrays");
+  SunFree(s->Bedconsolid,s->Nlayer*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s->Tstarcoef,s->Nlayer*sizeof(REAL),"FreeSedimentArrays");
+  SunFree(s,sizeof(sedimentsT),"FreeSedimentArrays");
+}
+
 /*
  * Function: FreeSediment
  * Usage: free space for all the variables
@@ -423,47 +653,12 @@ void RouseCurveAlpha(gridT *grid, physT *phys, propT *prop, int myproc){
  *
  */
 void FreeSediment(gridT *grid, int myproc) {
-  int i,j;
+  int i;
 
-  for(i=0;i<sediments->Nsize;i++){
-    for(j=0;j<grid->Nc;j++){
-      free(sediments->SediC[i][j]);
-      free(sediments->Ws[i][j]);
-      free(sediments->Layerthickness[i][j]);
-      free(sediments->Erosion[i][j]);
-      free(sediments->Erosion_old[i][j]);
-    }
-    free(sediments->SediC[i]);
-    free(sediments->Ws[i]);
-    free(sediments->Layerthickness[i]);
-    free(sediments->Toplayerratio[i]);
-    free(sediments->Erosion[i]);
-    free(sediments->Erosion_old);
-    free(sediments->Deposition[i]);
-    free(sediments->alphaSSC[i]);
-    free(sediments->Deposition_old[i]);
-  }
-  free(sediments->SediC);
-  free(sediments->Erosion);
-  free(sediments->Erosion_old);
-  free(sediments->Ws);
-  free(sediments->Deposition);
-  free(sediments->alphaSSC);
-  free(sediments->Deposition_old);
-  for(i=0;i<grid->Nc;i++){
-    free(sediments->Thicknesslayer[i]);
-    free(sediments->Wnewsedi[i]);
-    free(sediments->SediKappa_tv[i]);
-  }
-  free(sediments->Thicknesslayer);
-  free(sediments->SediKappa_tv);
-  free(sediments->Wnewsedi);
-  free(sediments->Layerthickness);
-  free(sediments->Toplayerratio);
-  free(sediments->Reposangle);
   free(sediments->Ds);
   free(sediments->Ws0);
   free(sediments->Gsedi);
+  free(sediments->Anglerepos);
   free(sediments->Prt);
   free(sediments->Consolid);
   for(i=0;i<sediments->Nsize;i++){
@@ -478,10 +673,7 @@ void FreeSediment(gridT *grid, int myproc) {
   free(sediments->Drydensity);
   free(sediments->Thickness);
   free(sediments->Softhard);
-  free(sediments->Seditb);
-  free(sediments->Seditbmax);
-  free(sediments->Layertop);
-  free(sediments->Totalthickness);
+  FreeSedimentArrays(sediments,grid);
 }
 
 /*
@@ -548,18 +740,18 @@ void SettlingVelocity(gridT *grid, physT *phys, propT *prop,  int myproc) {
  * ----------------------------------------------------
  * for two types, hard and soft
  * coefficients based on Mike21
+ * The soft rate E0*exp(ESOFT*(taub-taue)) is evaluated as
+ * Bedesoft*exp(ESOFT*taub), so there is one exponential per cell for all of
+ * the fractions and layers, and the hard rate is linear in taub/taue-1.
  */
 void CalculateErosion(gridT *grid, physT *phys, propT *prop, int myproc) { 
-  int i,j,k;
-  REAL taub,utmp,taubtmp1,taubtmp2,em,alpha,ratio, depotmp, nettmp, erosionmax,ds90,dzh;
+  int i,j,k,Nlayer=sediments->Nlayer;
+  REAL taub,utmp,taubtmp1,taubtmp2,ex,e,emax,dzh,morfac=sediments->morfac,invdt=1/prop->dt,*er,*erold,*lt,*fl,*taue,*invtaue,*esoft,*e0,*bedmmax,*invrho;
+  int *soft;
   // assume ks=3*ds90
   //ds90=MPI_GetValue(DATAFILE,"Ds90","CalculationErosion",myproc);
   
   // use sediments->kb 
-  // coefficient for hard erosion
-  em=1.0;
-  // coefficient for soft erosion
-  alpha=4.2;  // 4.2 to 25.6 according to MIKE21
 
   for(j=0;j<grid->Nc;j++){
     // calculate taub
@@ -626,61 +818,84 @@ void CalculateErosion(gridT *grid, physT *phys, propT *prop, int myproc) {
         taub=0;
 
     sediments->Seditb[j]=taub;
+    sediments->Taubexp[j]=exp(ESOFT*taub);
 
     if(sediments->Seditbmax[j]<=taub)
       sediments->Seditbmax[j]=taub;
   }
 
+  // one branch-free pass over the contiguous layers of each fraction
   for(i=0;i<sediments->Nsize;i++){
-    erosionmax=0;
-    for(j=0;j<grid->Nc;j++){
+    er=sediments->Erosion[i][0];
+    erold=sediments->Erosion_old[i][0];
+    lt=sediments->Layerthickness[i][0];
+    fl=sediments->Bedflux[i][0];
+    taue=sediments->Bedtaue+i*Nlayer;
+    invtaue=sediments->Bedinvtaue+i*Nlayer;
+    esoft=sediments->Bedesoft+i*Nlayer;
+    bedmmax=sediments->Bedmmax+i*Nlayer;
+    soft=sediments->Bedsoft+i*Nlayer;
+    invrho=sediments->Bedinvrho+i*Nlayer;
+    e0=sediments->E0[i];
+    for(j=0;j<grid->Nc;j++,er+=Nlayer,erold+=Nlayer,lt+=Nlayer,fl+=Nlayer){
       taub=sediments->Seditb[j];
-      for(k=0;k<sediments->Nlayer;k++){
-        erosionmax=sediments->Layerthickness[i][j][k]*sediments->Drydensity[i][k]/prop->dt;
-        sediments->Erosion_old[i][j][k]=sediments->Erosion[i][j][k];
-        sediments->Erosion[i][j][k]=0;
-        if(taub>sediments->Taue[i][k]){
-          if(sediments->Softhard[k]==0){
-	          // soft erosion
-            sediments->Erosion[i][j][k]=sediments->E0[i][k]*exp(alpha*(taub-sediments->Taue[i][k]));
-          } else {
-            // hard erosion
-            ratio=Max(taub/sediments->Taue[i][k]-1,0);
-            sediments->Erosion[i][j][k]=sediments->E0[i][k]*pow(ratio,em);
-          }
-        }
-        if(sediments->Erosion[i][j][k]>erosionmax)
-          sediments->Erosion[i][j][k]=erosionmax;
-      }     
-
-      if(sediments->bedComplex==1){
-        nettmp=0;
-        //assume last layer cannot be flushed away
-        for(k=sediments->Nlayer-2;k>0;k--){
-          nettmp=sediments->Layerthickness[i][j][k]*sediments->Drydensity[i][k]/prop->dt-sediments->Erosion[i][j][k]+sediments->Erosion[i][j][k+1]+sediments->Consolid[k-1]-sediments->Consolid[k]; //here can use theta method.
-          if(nettmp<0)
-            sediments->Erosion[i][j][k]+=nettmp;
-        }
-
-        // calculate erosion limit for the first layer
-        nettmp=0;
-        if(sediments->Nlayer>1)
-          nettmp=sediments->Layerthickness[i][j][0]*sediments->Drydensity[i][0]/prop->dt-sediments->Erosion[i][j][0]+sediments->Erosion[i][j][1]+sediments->Deposition[i][j]-sediments->Consolid[0];
-        if(nettmp<0)   
-          sediments->Erosion[i][j][0]+=nettmp;
+      ex=sediments->Taubexp[j];
+      for(k=0;k<Nlayer;k++){
+        erold[k]=er[k];
+        e=soft[k] ? esoft[k]*ex : e0[k]*(taub*invtaue[k]-1);
+        e=taub>taue[k] ? e : 0;
+        // the layer mass includes the change that is pending in Bedflux
+        emax=(lt[k]+morfac*fl[k]*invrho[k])*bedmmax[k]*invdt;
+        er[k]=e<emax ? e : emax;
       }
+      if(sediments->bedComplex==1)
+        LimitBedErosion(i,j,invdt);
     }
   }
 }
+
+/*
+ * Function: LimitBedErosion
+ * Usage: LimitBedErosion(i,j,invdt);
+ * ----------------------------------------------------
+ * When bedComplex==1, reduce the erosion of fraction i in the layers of
+ * cell j so that the net loss of each layer in one bed step does not exceed
+ * its mass at the current time step, invdt=1/dt.  The last layer cannot be
+ * flushed away.
+ *
+ */
+void LimitBedErosion(int i, int j, REAL invdt) {
+  int k, Nlayer=sediments->Nlayer;
+  REAL nettmp, *lt=sediments->Layerthickness[i][j], *er=sediments->Erosion[i][j], *fl=sediments->Bedflux[i][j],
+    *bedmmax=sediments->Bedmmax+i*Nlayer, *invrho=sediments->Bedinvrho+i*Nlayer, *consolid=sediments->Bedconsolid;
+
+  for(k=Nlayer-2;k>0;k--){
+    nettmp=(lt[k]+sediments->morfac*fl[k]*invrho[k])*bedmmax[k]*invdt-er[k]+er[k+1]+consolid[k]; //here can use theta method.
+    if(nettmp<0)
+      er[k]+=nettmp;
+  }
+
+  // calculate erosion limit for the first layer
+  if(Nlayer>1){
+    nettmp=(lt[0]+sediments->morfac*fl[0]*invrho[0])*bedmmax[0]*invdt-er[0]+er[1]+sediments->Deposition[i][j]+consolid[0];
+    if(nettmp<0)   
+      er[0]+=nettmp;
+  }
+}
 /*
  * Function: CalculateDeposition
  * Usage: calculate deposition
  * ----------------------------------------------------
  * based on settling velocity and SediConcentration
+ * When accumulate is 1 the net erosion, deposition and consolidation fluxes
+ * of the layers over this time step are added to Bedflux in the same pass,
+ * with the same time discretization as the one-step update of BedChange, so
+ * that BedChange applies the fluxes of all of the steps since the last bed
+ * update.
  */
-void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int myproc) {
-  int i,j;
-  REAL alpha;
+void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int accumulate, int myproc) {
+  int i,j,k,Nlayer=sediments->Nlayer;
+  REAL alpha,dt=prop->dt,*fl,*er,*erold,*consolid=sediments->Bedconsolid;
   for(i=0;i<sediments->Nsize;i++){
     for(j=0;j<grid->Nc;j++){
       sediments->Deposition_old[i][j]=sediments->Deposition[i][j];
@@ -697,6 +912,22 @@ void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int myproc) {
       sediments->Deposition[i][j]*=alpha;
       if(!phys->active[j])
         sediments->Deposition[i][j]=0;
+
+      if(accumulate){
+        fl=sediments->Bedflux[i][j];
+        er=sediments->Erosion[i][j];
+        erold=sediments->Erosion_old[i][j];
+        alpha=1.0;
+        if(prop->subgrid)
+          alpha=subgrid->Aceff[j]/grid->Ac[j];
+        // the gravity effects only happen for the layertop part in BedChange
+        if(Nlayer>1)
+          fl[0]+=dt*(alpha*(-0.5*er[0]-0.5*erold[0]+0.5*er[1]+0.5*erold[1]+0.5*sediments->Deposition[i][j]+0.5*sediments->Deposition_old[i][j])+consolid[0]);
+        else
+          fl[0]+=dt*(0.5*alpha*(-er[0]-erold[0]+sediments->Deposition[i][j]+sediments->Deposition_old[i][j])+consolid[0]);
+        for(k=1;k<Nlayer-1;k++)
+          fl[k]+=dt*(alpha*(-er[k]+er[k+1])+consolid[k]);
+      }
     }
   }
 }
@@ -711,36 +942,33 @@ void CalculateDeposition(gridT *grid, physT *phys, propT *prop, int myproc) {
  * assume the last layer cannot be flushed away 
  * when bedComplex=1, Bedchange will be calculated every time step
  * there may some error in extreme condition
+ * The fluxes accumulated by CalculateDeposition since the last update are
+ * multiplied by the morphological factor morfac, so that each bed step
+ * represents morfac times the hydrodynamic time.
  */
 void BedChange(gridT *grid, physT *phys, propT *prop, int myproc) {
  
-  int i,j,k,nf,nc1,nc2;
-  REAL grad,angle,bedflux,ratio,alpha;
+  int i,j,k,nc1,nc2,Nlayer=sediments->Nlayer;
+  REAL grad,ratio,bedflux,morfac=sediments->morfac,*lt,*fl,*invrho;
   // update thickness
   // assume Drydensity for each fraction is constant for each layer 
   // the only thing change is the thickness(mass) for each fraction
   // the erosion will be divided into different parts according to the ration of thickness for each layer
   // the gravity effects only happen for the layertop part
   for(i=0;i<sediments->Nsize;i++){
-    for(j=0;j<grid->Nc;j++){
-      alpha=1.0;
-      if(prop->subgrid)
-        alpha=subgrid->Aceff[j]/grid->Ac[j];
-      // no gravity effects
-      if(sediments->Nlayer>1){
-        // here can use theta method
-        sediments->Layerthickness[i][j][0]+=sediments->bedInterval*prop->dt/sediments->Drydensity[i][0]*(alpha*(-0.5*sediments->Erosion[i][j][0]-0.5*sediments->Erosion_old[i][j][0]+0.5*sediments->Erosion[i][j][1]+0.5*sediments->Erosion_old[i][j][1]+0.5*sediments->Deposition[i][j]+0.5*sediments->Deposition_old[i][j])-sediments->Consolid[0]);
-      } else {
-        // if there is one layer, no consolidation and erosion[j][1];
-        // because here we use deposition n+1 step, so there may be some error to make Layerthickness<0
-        sediments->Layerthickness[i][j][0]+=0.5*sediments->bedInterval*prop->dt/sediments->Drydensity[i][0]*(alpha*(-sediments->Erosion[i][j][0]-sediments->Erosion_old[i][j][0]+sediments->Deposition[i][j]+sediments->Deposition_old[i][j])-sediments->Consolid[0]); 
-      }
+    lt=sediments->Layerthickness[i][0];
+    fl=sediments->Bedflux[i][0];
+    invrho=sediments->Bedinvrho+i*Nlayer;
+    for(j=0;j<grid->Nc;j++,lt+=Nlayer,fl+=Nlayer){
+      // because here we use deposition n+1 step, so there may be some error to make Layerthickness<0
+      lt[0]+=morfac*fl[0]*invrho[0];
+      fl[0]=0;
 
       // update other layers without gravity and deposition
-      for(k=1;k<sediments->Nlayer-1;k++){
-        sediments->Layerthickness[i][j][k]+=sediments->bedInterval*prop->dt/sediments->Drydensity[i][k]*(alpha*(-sediments->Erosion[i][j][k]+sediments->Erosion[i][j][k+1])+sediments->Consolid[k-1]-sediments->Consolid[k]);
-        if(sediments->Layerthickness[i][j][k]<0)
-          sediments->Layerthickness[i][j][k]=0;
+      for(k=1;k<Nlayer-1;k++){
+        lt[k]+=morfac*fl[k]*invrho[k];
+        lt[k]=lt[k]<0 ? 0 : lt[k];
+        fl[k]=0;
       }
     }
   }
@@ -777,96 +1005,88 @@ void BedChange(gridT *grid, physT *phys, propT *prop, int myproc) {
     }
   }
 
-  // update Layertop, Thicknesslayer and Totalthickness
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++){
-      if(i==0)
-        sediments->Totalthickness[j]=0;
-      for(k=0;k<sediments->Nlayer;k++){
-        if(i==0)
-          sediments->Thicknesslayer[j][k]=0;
+  UpdateBedLayers(grid);
+}
+
+/*
+ * Function: UpdateBedLayers
+ * Usage: UpdateBedLayers(grid);
+ * ----------------------------------------------------
+ * Update Thicknesslayer, Totalthickness, Layertop, Toplayerratio and
+ * Reposangle from the thickness of each fraction in each layer.  When all of
+ * the layers of a cell are empty Layertop is Nlayer and the ratios of the
+ * last layer are kept.
+ *
+ */
+void UpdateBedLayers(gridT *grid) {
+  int i,j,k,Nlayer=sediments->Nlayer;
+
+  for(j=0;j<grid->Nc;j++){
+    sediments->Totalthickness[j]=0;
+    for(k=0;k<Nlayer;k++){
+      sediments->Thicknesslayer[j][k]=0;
+      for(i=0;i<sediments->Nsize;i++)
         sediments->Thicknesslayer[j][k]+=sediments->Layerthickness[i][j][k];
-        if(i==sediments->Nsize-1)
-          sediments->Totalthickness[j]+=sediments->Thicknesslayer[j][k];
-      }
-      if(i==sediments->Nsize-1){
-        sediments->Layertop[j]=0;
-        while(sediments->Thicknesslayer[j][sediments->Layertop[j]]<=0 && sediments->Layertop[j]<sediments->Nlayer){
-          sediments->Layertop[j]++;
-        }
-      }
+      sediments->Totalthickness[j]+=sediments->Thicknesslayer[j][k];
     }
 
-  // update Toplayerratio
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++)
-      sediments->Toplayerratio[i][j]=sediments->Layerthickness[i][j][sediments->Layertop[j]]/sediments->Thicknesslayer[j][sediments->Layertop[j]];
-
-  // update Reposangle
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++)
+    k=0;
+    while(k<Nlayer && sediments->Thicknesslayer[j][k]<=0)
+      k++;
+    sediments->Layertop[j]=k;
+
+    if(k==Nlayer)
+      k=Nlayer-1;
+    sediments->Reposangle[j]=0;
+    for(i=0;i<sediments->Nsize;i++){
+      if(sediments->Thicknesslayer[j][k]>0)
+        sediments->Toplayerratio[i][j]=sediments->Layerthickness[i][j][k]/sediments->Thicknesslayer[j][k];
       sediments->Reposangle[j]+=sediments->Toplayerratio[i][j]*sediments->Anglerepos[i];
-
+    }
+  }
 }
 
 /*
  * Function: SedimentSource
- * Usage: dT/dt + u dot grad T = d/dz ( kappaT dT/dz) + A + B*T
+ * Usage: SedimentSource(&A,&B,grid,prop,Nosize,i,prop->theta);
  *--------------------------------------------------------------
- * same use as Heatsource, add new parameter Nosize to represent the No. of Nsize for fraction
+ * Source terms of fraction Nosize in the bottom cell of column i, where
+ * dC/dt + u dot grad C = d/dz ( kappa dC/dz) + A + B*C as for the heat source.
+ * A is the erosion and B is the deposition, and both are zero in the other
+ * cells of the column.
  *
  */
-void SedimentSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop,int Nosize, REAL theta) {
-  int i, k;
+void SedimentSource(REAL *A, REAL *B, gridT *grid, propT *prop, int Nosize, int i, REAL theta) {
+  int Nk=grid->Nk[i];
   REAL alpha;
-  for(i=0;i<grid->Nc;i++) {
-    for(k=grid->ctop[i];k<grid->Nk[i]-1;k++) {
-      B[i][k]=0;
-      A[i][k]=0;
-    }
 
-    //advection
-    alpha=1.0;
-    if(prop->subgrid)
-    {
-      alpha=subgrid->Aceff[i]/subgrid->Acceff[i][grid->Nk[i]-1];
-      if(subgrid->erosionpara)
-        alpha*=subgrid->delta[i];
+  //advection
+  alpha=1.0;
+  if(prop->subgrid)
+  {
+    alpha=subgrid->Aceff[i]/subgrid->Acceff[i][Nk-1];
+    if(subgrid->erosionpara)
+      alpha*=subgrid->delta[i];
 
-      if(subgrid->Acceff[i][grid->Nk[i]-1]==0)
-        alpha=0;
-    }
+    if(subgrid->Acceff[i][Nk-1]==0)
+      alpha=0;
+  }
     
-    //if(grid->Nkmax==1)
-    // alpha is included in deposition np matter whether there is only one layer
-    alpha*=sediments->alphaSSC[Nosize][i];
+  //if(grid->Nkmax==1)
+  // alpha is included in deposition np matter whether there is only one layer
+  alpha*=sediments->alphaSSC[Nosize][i];
 
-    B[i][grid->Nk[i]-1]=alpha*sediments->Ws[Nosize][i][grid->Nk[i]]/grid->dzz[i][k]; 
+  *B=alpha*sediments->Ws[Nosize][i][Nk]/grid->dzz[i][Nk-1]; 
 
-    //erosion
-    alpha=1.0;
-    if(prop->subgrid)
-    {
-      alpha=subgrid->Aceff[i]/subgrid->Acceff[i][grid->Nk[i]-1];
-      if(subgrid->Acceff[i][grid->Nk[i]-1]==0)
-        alpha=0;
-    }
-    A[i][grid->Nk[i]-1]=alpha*((1-theta)*sediments->Erosion_old[Nosize][i][0]+theta*sediments->Erosion[Nosize][i][0])/grid->dzz[i][grid->Nk[i]-1];
+  //erosion
+  alpha=1.0;
+  if(prop->subgrid)
+  {
+    alpha=subgrid->Aceff[i]/subgrid->Acceff[i][Nk-1];
+    if(subgrid->Acceff[i][Nk-1]==0)
+      alpha=0;
   }
-}
-
-/*
- * Function: SedimentVerticalVelocity
- * Usage: wnewsedi=phys->wnew-ws, woldsedi=phys->w_old-ws, ws is explicit
- *--------------------------------------------------------------
- * provide the vertical velocity field for updatescalar function
- *
- */
-void SedimentVerticalVelocity(gridT *grid, physT *phys,int Nosize,int symbol, int myproc) {
-  int i,k;
-  for(i=0;i<grid->Nc;i++) 
-    for(k=0;k<grid->Nk[i]+1;k++)
-      sediments->Wnewsedi[i][k]=phys->w_im[i][k]-sediments->Ws[Nosize][i][k];
+  *A=alpha*((1-theta)*sediments->Erosion_old[Nosize][i][0]+theta*sediments->Erosion[Nosize][i][0])/grid->dzz[i][Nk-1];
 }
 
 /*
@@ -924,7 +1144,7 @@ void OutputSediment(gridT *grid, physT *phys, propT *prop,
   FILE *ofile;
   REAL thicktmp;
 
-  if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart || blowup) {
+  if(IntervalDue(prop,prop->ntout) || prop->n==1+prop->nstart || blowup) {
     
     for(nosize=0;nosize<sediments->Nsize;nosize++){
       sprintf(str,"Error outputting SSC data for size class %d of %d.\n",nosize+1,sediments->Nsize);
@@ -958,9 +1178,10 @@ void OutputSediment(gridT *grid, physT *phys, propT *prop,
  * calculate sediment diffusivity 
  *--------------------------------------------------------------
  * may use phys->kappa_tv directly from my25 function or 
- * use parabolic diffusivity
+ * use parabolic diffusivity.  This is the diffusivity for Prt=1, which is
+ * divided by the Prandtl number of each fraction in UpdateSedimentClasses
  */
-void CalculateSediDiffusivity(gridT *grid, physT *phys,int Nosize,int myproc) {  
+void CalculateSediDiffusivity(gridT *grid, physT *phys, int myproc) {  
   int ii, kk;
   REAL z;
   
@@ -969,7 +1190,7 @@ void CalculateSediDiffusivity(gridT *grid, physT *phys,int Nosize,int myproc) {
       z=grid->dv[ii]+phys->h[ii]-0.5*grid->dzz[ii][0];
       for(kk=0;kk<grid->Nk[ii];kk++){
 	if(phys->CdB[ii]!=-1)
-	  sediments->SediKappa_tv[ii][kk]=z*(1-z/(grid->dv[ii]+phys->h[ii]))*phys->uc[ii][grid->Nk[ii]-1]*sqrt(phys->CdB[ii])*0.41/sediments->Prt[Nosize];
+	  sediments->SediKappa_tv[ii][kk]=z*(1-z/(grid->dv[ii]+phys->h[ii]))*phys->uc[ii][grid->Nk[ii]-1]*sqrt(phys->CdB[ii])*0.41;
 	if(kk!=grid->Nk[ii]-1)
 	  z-=0.5*(grid->dzz[ii][kk]+grid->dzz[ii][kk+1]);
       }
@@ -977,7 +1198,7 @@ void CalculateSediDiffusivity(gridT *grid, physT *phys,int Nosize,int myproc) {
   } else {
     for(ii=0;ii<grid->Nc;ii++)
       for(kk=0;kk<grid->Nk[ii];kk++)
-	sediments->SediKappa_tv[ii][kk]=phys->kappa_tv[ii][kk]/sediments->Prt[Nosize];
+	sediments->SediKappa_tv[ii][kk]=phys->kappa_tv[ii][kk];
   }
 }
 
@@ -991,7 +1212,7 @@ void CalculateSediDiffusivity(gridT *grid, physT *phys,int Nosize,int myproc) {
  */
 void ISendRecvSediBedData3D(REAL **celldata, gridT *grid, int nlayer,int myproc,MPI_Comm comm) {
   int k, n, nstart, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
   
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
@@ -1003,13 +1224,13 @@ void ISendRecvSediBedData3D(REAL **celldata, gridT *grid, int nlayer,int myproc,
       nstart+=nlayer;
     }
     
-    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_send[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_send[neigh],MPI_REALTYPE,neighproc,1,
 	      comm,&(grid->request[neigh])); 
   }
   
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recv[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recv[neigh],MPI_REALTYPE,neighproc,1,
 	      comm,&(grid->request[grid->Nneighs+neigh]));
   }
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
@@ -1036,15 +1257,13 @@ void ISendRecvSediBedData3D(REAL **celldata, gridT *grid, int nlayer,int myproc,
 void CalculateSedimentKb(gridT *grid, physT *phys, int myproc)
 {
   int i,n;
-  REAL alpha, tauw, lambda_ano, eta_ano, d0, lambda_orb, lamda;
-  REAL A1, A2, A3, B1, B2, B3, F, eta, ar, a1, a2, Tstar, tmp;
+  REAL tauw, lambda_ano, eta_ano, d0, lambda_orb, lamda;
+  REAL A1, A2, A3, B1, B2, B3, F, eta, ar, Tstar, tmp;
 
-  alpha = 0.056;
+  // alpha = 0.056, a1 = 0.068 and a2 are in sediments->Kba1 and Kba2
   lambda_ano = 535*sediments->ds50;
   eta_ano = 0.171*lambda_ano;
  
-  a1 = 0.068;
-  a2 = 0.0204*pow(log(sediments->ds50),2)+0.022*log(sediments->ds50)+0.0709;
   ar = 0.267;
   
   A1 = 0.095;
@@ -1083,12 +1302,11 @@ void CalculateSedimentKb(gridT *grid, physT *phys, int myproc)
     }
     */
     // roughness due to shear stress
-    Tstar=0;
-    for(n=0;n<sediments->Nsize;n++)
-      Tstar += sediments->Seditb[i]/sediments->Taue[n][sediments->Layertop[i]]/sediments->Nsize;
+    n=sediments->Layertop[i]<sediments->Nlayer ? sediments->Layertop[i] : sediments->Nlayer-1;
+    Tstar=sediments->Seditb[i]*sediments->Tstarcoef[n];
 
     if (Tstar > 1.0)
-      sediments->z0b[i] = alpha*sediments->ds50*a1*Tstar/(1+a2*Tstar);
+      sediments->z0b[i] = sediments->Kba1*Tstar/(1+sediments->Kba2*Tstar);
     
     //update kb
     sediments->kb[i] = 30*Max(sediments->z0s[i], sediments->z0b[i]+sediments->z0r[i]);
@@ -1097,6 +1315,332 @@ void CalculateSedimentKb(gridT *grid, physT *phys, int myproc)
 }
 
 
+/*
+ * Function: UpdateSedimentClasses
+ * Usage: UpdateSedimentClasses(grid,phys,prop,comm,myproc);
+ * ---------------------------------------------------------
+ * Compute the n+1 concentration of all of the fractions.  This is the same
+ * scheme as UpdateScalars with no molecular diffusivity and no surface or
+ * bottom fluxes, in which the fractions only differ in their settling
+ * velocity, Prandtl number and bed source terms.  So the fluxes through the
+ * faces of a cell and their upwind side are computed once for all of the
+ * fractions, the tridiagonal systems of the fractions in a column are solved
+ * together, and the new concentrations are exchanged in one message.
+ *
+ */
+void UpdateSedimentClasses(gridT *grid, physT *phys, propT *prop, MPI_Comm comm, int myproc)
+{
+  int i, iptr, k, m, n, nf, ne, nc1, nc2, normal, ktop, Nk, N, jb;
+  int M=sediments->Nsize, Nkmax=grid->Nkmax, TVD=prop->TVDtemp, *up=sediments->Fhup;
+  REAL Ac, dt=prop->dt, dznew, alpha, A, B, U, Prt, fac1, fac2, sp, val, 
+    *a=sediments->Atri, *b=sediments->Btri, *c=sediments->Ctri, *d=sediments->Dtri, *x=sediments->Xtri,
+    *ap=sediments->Apsedi, *am=sediments->Amsedi, *bd=sediments->bdsedi, *hs=sediments->Hsedi,
+    *cn=sediments->Cnsedi, *q=sediments->Fhsedi, **w=sediments->Wnewsedi, **kt=sediments->SediKappa_tv,
+    **stmp, **scal;
+
+  // same settings as UpdateScalars
+  prop->TVD=TVD;
+  fac1=prop->thetaS;
+  fac2=1-prop->thetaS;
+
+  // SediC_old stores the concentration at step n while SediC is updated
+  for(n=0;n<M;n++)
+    for(i=0;i<grid->Nc;i++)
+      for(k=0;k<grid->Nk[i];k++)
+        sediments->SediC_old[n][i][k]=sediments->SediC[n][i][k];
+
+  if(TVD)
+    HorizontalFaceScalarClasses(grid,phys,prop,sediments->SediC_old,sediments->boundary_sediC,M,
+        sediments->SumQC,sediments->SfHp,sediments->SfHm,TVD,comm,myproc);
+
+  for(iptr=phys->wetcelldist[0];iptr<phys->wetcelldist[2];iptr++) {
+    i = phys->wetcellp[iptr];
+    Ac = grid->Ac[i];
+    Nk = grid->Nk[i];
+
+    if(grid->ctop[i]>=grid->ctopold[i]) {
+      ktop=grid->ctop[i];
+      dznew=grid->dzz[i][ktop];
+    } else {
+      ktop=grid->ctopold[i];
+      dznew=0;
+      for(k=grid->ctop[i];k<=grid->ctopold[i];k++) 
+        dznew+=grid->dzz[i][k];      
+    }
+    N=Nk-ktop;
+
+    // Fluxes through the faces and the upwind side of each face, which are
+    // the same for all of the fractions
+    for(nf=0;nf<grid->nfaces[i];nf++) {
+      ne = grid->face[i*grid->maxfaces+nf];
+      normal = grid->normal[i*grid->maxfaces+nf];
+      nc1 = grid->grad[2*ne];
+      nc2 = grid->grad[2*ne+1];
+      if(nc1==-1) nc1=nc2;
+      if(nc2==-1) nc2=nc1;
+
+      for(k=0;k<grid->Nke[ne];k++) {
+        q[nf*Nkmax+k]=dt*grid->df[ne]*normal/Ac*(prop->imfac1*phys->u[ne][k]+prop->imfac2*phys->u_old[ne][k]+prop->imfac3*phys->u_old2[ne][k]);
+
+        // 0 takes the value at nc1, 1 the value on the other side and 2 the larger one
+        U = prop->imfac2*phys->u_old[ne][k]+prop->imfac1*phys->u[ne][k]+prop->imfac3*phys->u_old2[ne][k];
+        if(U>0)
+          up[nf*Nkmax+k]=1;
+        else if(U<0 || TVD)
+          up[nf*Nkmax+k]=0;
+        else
+          up[nf*Nkmax+k]=2;
+        if(!TVD) {
+          if(k<grid->ctopold[nc1])
+            up[nf*Nkmax+k]=1;
+          if(k<grid->ctopold[nc2])
+            up[nf*Nkmax+k]=0;
+        }
+      }
+    }
+
+    for(n=0;n<M;n++) {
+      stmp = sediments->SediC_old[n];
+      Prt = sediments->Prt[n];
+      SedimentSource(&A,&B,grid,prop,n,i,prop->theta);
+
+      for(k=0;k<Nk+1;k++)
+        w[i][k]=phys->w_im[i][k]-sediments->Ws[n][i][k];
+
+      // These are the advective components of the tridiagonal
+      // at the new time step.
+      if(!TVD)
+        for(k=0;k<Nk+1;k++) {
+          if(prop->subgrid)
+            alpha=subgrid->Acveff[i][k]/Ac;
+          else
+            alpha=1.0;
+          ap[k] = alpha*0.5*(w[i][k]+fabs(w[i][k]));
+          am[k] = alpha*0.5*(w[i][k]-fabs(w[i][k])); 
+        }
+      else {
+        GetApAm(ap,am,phys->wp,phys->wm,phys->Cp,phys->Cm,phys->rp,phys->rm,
+            w,grid->dzz,stmp,i,Nk,ktop,dt,TVD);
+        for(k=0;k<Nk+1;k++) {
+          if(prop->subgrid)
+            alpha=subgrid->Acveff[i][k]/Ac;
+          else
+            alpha=1.0;
+          ap[k]= ap[k]*alpha;
+          am[k]= am[k]*alpha;
+        }
+      }
+
+      for(k=ktop+1;k<Nk;k++) {
+        if(prop->subgrid)
+          alpha=subgrid->Acceff[i][k]/Ac;
+        else
+          alpha=1.0;
+        a[(k-ktop)*M+n]=fac1*dt*am[k];
+        b[(k-ktop)*M+n]=alpha*grid->dzz[i][k]+fac1*dt*(ap[k]-am[k+1]);
+        c[(k-ktop)*M+n]=-fac1*dt*ap[k+1];
+      }
+
+      // Top cell advection
+      if(prop->subgrid)
+        alpha=subgrid->Acceff[i][ktop]/Ac;
+      else
+        alpha=1.0;
+      a[n]=0;
+      b[n]=alpha*dznew-fac1*dt*am[ktop+1];
+      c[n]=-fac1*dt*ap[ktop+1];
+
+      // Bottom cell no-flux boundary condition for advection
+      b[(N-1)*M+n]+=c[(N-1)*M+n];
+
+      // Implicit vertical diffusion terms
+      for(k=ktop+1;k<Nk;k++) {
+        if(prop->subgrid)
+          alpha=subgrid->Acveff[i][k]/Ac;
+        else
+          alpha=1.0;
+        bd[k]=alpha*(kt[i][k-1]/Prt+kt[i][k]/Prt)/(grid->dzz[i][k-1]+grid->dzz[i][k]);
+      }
+
+      for(k=ktop+1;k<Nk-1;k++) {
+        a[(k-ktop)*M+n]-=fac1*dt*bd[k];
+        b[(k-ktop)*M+n]+=fac1*dt*(bd[k]+bd[k+1]);
+        c[(k-ktop)*M+n]-=fac1*dt*bd[k+1];
+      }
+
+      // Implicit deposition in the bottom cell
+      if(prop->subgrid)
+        alpha=subgrid->Acceff[i][Nk-1]/Ac;
+      else
+        alpha=1.0;
+      b[(N-1)*M+n]+=alpha*B*fac1*dt*grid->dzz[i][Nk-1];
+
+      // Diffusive fluxes only when more than 1 layer
+      if(N>1) {
+        b[n]+=fac1*dt*bd[ktop+1];
+        c[n]-=fac1*dt*bd[ktop+1];
+        a[(N-1)*M+n]-=fac1*dt*bd[Nk-1];
+        b[(N-1)*M+n]+=fac1*dt*bd[Nk-1];
+      }
+
+      // Explicit part into source term d[] 
+      for(k=ktop+1;k<Nk;k++) {
+        if(prop->subgrid)
+          alpha=subgrid->Acceffold[i][k]/Ac;
+        else 
+          alpha=1.0;
+        d[(k-ktop)*M+n]=alpha*grid->dzzold[i][k]*stmp[i][k];
+      }
+      if(N>1) {
+        if(prop->subgrid)
+          alpha=subgrid->Acceff[i][Nk-1]/Ac;
+        else 
+          alpha=1.0;
+        d[(N-1)*M+n]-=alpha*B*dt*grid->dzz[i][Nk-1]*(fac2*stmp[i][Nk-1]);
+      }
+
+      d[n]=0;
+      if(grid->ctopold[i]<=grid->ctop[i]) {
+        for(k=grid->ctopold[i];k<=grid->ctop[i];k++) {
+          if(prop->subgrid)
+            alpha=subgrid->Acceffold[i][k]/Ac;
+          else
+            alpha=1.0;
+          d[n]+=alpha*grid->dzzold[i][k]*stmp[i][k];
+        }
+        if(grid->ctop[i]==Nk-1) {
+          if(prop->subgrid)
+            alpha=subgrid->Acceff[i][Nk-1]/Ac;
+          else
+            alpha=1.0;
+          d[n]-=alpha*B*dt*(fac2*stmp[i][Nk-1])*grid->dzz[i][Nk-1];
+        }
+      } else {
+        if(prop->subgrid)
+          alpha=subgrid->Acceffold[i][ktop]/Ac;
+        else
+          alpha=1.0;      
+        d[n]=alpha*grid->dzzold[i][ktop]*stmp[i][ktop];
+        if(ktop==Nk-1) {
+          if(prop->subgrid)
+            alpha=subgrid->Acceff[i][ktop]/Ac;
+          else
+            alpha=1.0;          
+          d[n]-=alpha*grid->dzz[i][ktop]*B*dt*(fac2*stmp[i][ktop]);
+        }
+      }
+
+      // Explicit advection and diffusion
+      for(k=ktop+1;k<Nk-1;k++) 
+        d[(k-ktop)*M+n]-=dt*(am[k]*(fac2*stmp[i][k-1])+(ap[k]-am[k+1])*(fac2*stmp[i][k])-ap[k+1]*(fac2*stmp[i][k+1]))-
+          dt*(bd[k]*(fac2*stmp[i][k-1])-(bd[k]+bd[k+1])*(fac2*stmp[i][k])+bd[k+1]*(fac2*stmp[i][k+1]));
+
+      if(N>1) {
+        //Flux through bottom of top cell
+        k=ktop;
+        d[n]=d[n]-dt*(-am[k+1]*(fac2*stmp[i][k])-ap[k+1]*(fac2*stmp[i][k+1]))+
+          dt*(-bd[k+1]*(fac2*stmp[i][k])+bd[k+1]*(fac2*stmp[i][k+1]));
+
+        // Through top of bottom cell
+        k=Nk-1;
+        d[(N-1)*M+n]-=dt*(am[k]*(fac2*stmp[i][k-1])+ap[k]*(fac2*stmp[i][k]))-
+          dt*(bd[k]*(fac2*stmp[i][k-1])-bd[k]*(fac2*stmp[i][k]));
+      }
+
+      // Erosion into the bottom cell
+      for(m=0;m<N;m++)
+        cn[m]=0;
+      if(prop->subgrid)
+        alpha=subgrid->Acceff[i][Nk-1]/Ac;
+      else 
+        alpha=1.0; 
+      cn[N-1]=alpha*dt*A*grid->dzz[i][Nk-1];
+
+      // Horizontal advection with the shared face fluxes
+      for(k=0;k<Nk;k++)
+        hs[k]=0;
+      for(nf=0;nf<grid->nfaces[i];nf++) {
+        ne = grid->face[i*grid->maxfaces+nf];
+        nc1 = grid->grad[2*ne];
+        nc2 = grid->grad[2*ne+1];
+        if(nc1==-1) nc1=nc2;
+        jb=-1;
+        if(nc2==-1) {
+          nc2=nc1;
+          if(grid->mark[ne]==2 || grid->mark[ne]==3)
+            jb=sediments->Bedge[nc1];
+        }
+
+        for(k=0;k<grid->Nke[ne];k++) {
+          if(TVD) {
+            if(up[nf*Nkmax+k])
+              val=sediments->SfHp[n][ne][k];
+            else
+              val=sediments->SfHm[n][ne][k];
+          } else {
+            if(grid->mark[ne]==2 || grid->mark[ne]==3)
+              sp=(jb>=0 && k>=grid->ctop[nc1]) ? sediments->boundary_sediC[n][jb][k] : 0;
+            else
+              sp=stmp[nc2][k];
+            if(up[nf*Nkmax+k]==1)
+              val=sp;
+            else if(up[nf*Nkmax+k]==0)
+              val=stmp[nc1][k];
+            else
+              val=Max(stmp[nc1][k],sp);
+          }
+          hs[k]+=q[nf*Nkmax+k]*val*grid->dzf[ne][k];
+        }
+      }
+
+      for(k=ktop+1;k<Nk;k++) 
+        cn[k-ktop]-=hs[k];
+      for(k=0;k<=ktop;k++) 
+        cn[0]-=hs[k];
+
+      for(m=0;m<N;m++) 
+        d[m*M+n]+=cn[m];
+    }
+
+    if(N>1) {
+      TriSolveBatch(a,b,c,d,x,N,M);
+      for(n=0;n<M;n++)
+        for(m=0;m<N;m++)
+          sediments->SediC[n][i][ktop+m]=x[m*M+n];
+    } else if(prop->n>1) {
+      for(n=0;n<M;n++)
+        if(b[n]>0 && phys->active[i])
+          sediments->SediC[n][i][ktop]=d[n]/b[n];
+        else 
+          sediments->SediC[n][i][ktop]=sediments->SediC_old[n][i][ktop];
+    }
+
+    for(n=0;n<M;n++) {
+      scal = sediments->SediC[n];
+      stmp = sediments->SediC_old[n];
+
+      if(N>1 && !phys->active[i])
+        for(k=ktop;k<Nk;k++)
+          scal[i][k]=stmp[i][k];
+
+      // subgrid flux check for each layer of cell as in UpdateScalars
+      if(prop->subgrid)
+        if(ktop!=Nk-1)
+          for(k=ktop;k<Nk;k++)
+            if(subgrid->fluxn[i][k]>grid->dzz[i][k]*subgrid->Acceff[i][k])
+              scal[i][k]=stmp[i][k];
+
+      for(k=0;k<grid->ctop[i];k++)
+        scal[i][k]=0;
+
+      for(k=grid->ctop[i];k<grid->ctopold[i];k++) 
+        scal[i][k]=scal[i][ktop];
+    }
+  }
+
+  ISendRecvCellData3DN(sediments->SediC,M,grid,myproc,comm);
+}
+
 /*
  * Function: ComputeSedimentsRestart
  * Usage: ComputeSedimentsRestart(grid,phys,prop, myproc, numproc, blowup, comm);
@@ -1137,42 +1681,15 @@ void ComputeSedimentsBedRestart(gridT *grid, physT *phys, propT *prop, int mypro
         sediments->SediC_old[j][i][k]=sediments->SediC[j][i][k];
 
   // compute bed layer model
-  // update Layertop, Thicknesslayer and Totalthickness
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++){
-      if(i==0)
-        sediments->Totalthickness[j]=0;
-      for(k=0;k<sediments->Nlayer;k++){
-          if(i==0)
-          sediments->Thicknesslayer[j][k]=0;
-        sediments->Thicknesslayer[j][k]+=sediments->Layerthickness[i][j][k];
-        if(i==sediments->Nsize-1)
-          sediments->Totalthickness[j]+=sediments->Thicknesslayer[j][k];
-      }
-      if(i==sediments->Nsize-1){
-        sediments->Layertop[j]=0;
-        while(sediments->Thicknesslayer[j][sediments->Layertop[j]]<=0 && sediments->Layertop[j]<sediments->Nlayer){
-          sediments->Layertop[j]++;
-        }
-      }
-    }
-
-  // update Toplayerratio
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++)
-      sediments->Toplayerratio[i][j]=sediments->Layerthickness[i][j][sediments->Layertop[j]]/sediments->Thicknesslayer[j][sediments->Layertop[j]];
-
-  // update Reposangle
-  for(i=0;i<sediments->Nsize;i++)
-    for(j=0;j<grid->Nc;j++)
-      sediments->Reposangle[j]+=sediments->Toplayerratio[i][j]*sediments->Anglerepos[i];          
+  // update Layertop, Thicknesslayer, Totalthickness, Toplayerratio and Reposangle
+  UpdateBedLayers(grid);
 
   // calculate settling velocity
   if(sediments->WSconstant==0)
     SettlingVelocity(grid,phys,prop,myproc);
   // calculate initial erosion and deposition
   CalculateErosion(grid,phys,prop,myproc);    
-  CalculateDeposition(grid,phys,prop,myproc);
+  CalculateDeposition(grid,phys,prop,0,myproc);
 }
 
 
@@ -1187,8 +1704,6 @@ void ComputeSedimentsBedRestart(gridT *grid, physT *phys, propT *prop, int mypro
 */
 void ComputeSediments(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, int blowup, MPI_Comm comm)
 {
-  int k,i;
-
   // when computeSediments=2 means the suntans use restart run
   if(prop->n==1+prop->nstart && prop->computeSediments!=2){
 
@@ -1224,24 +1739,15 @@ void ComputeSediments(gridT *grid, physT *phys, propT *prop, int myproc, int num
   if(grid->Nkmax==1 && sediments->sscvprof==1)
     RouseCurveAlpha(grid, phys,prop, myproc);
 
-  // calculate n+1 Sediment concentration field
-  for(k=0;k<sediments->Nsize;k++){
-    SedimentSource(phys->wtmp,phys->uold,grid,phys,prop,k,prop->theta);
-    SedimentVerticalVelocity(grid,phys,k,1,myproc);
-    CalculateSediDiffusivity(grid,phys,k,myproc);
-    UpdateScalars(grid,phys,prop,sediments->Wnewsedi,sediments->SediC[k],sediments->SediC_old[k],
-      sediments->boundary_sediC[k],phys->Cn_T,
-      0,0,sediments->SediKappa_tv,prop->theta,
-      phys->uold,phys->wtmp,NULL,NULL,0,0,comm,myproc,0,prop->TVDtemp);
-    //SedimentVerticalVelocity(grid,phys,k,-1,myproc);
-    ISendRecvCellData3D(sediments->SediC[k],grid,myproc,comm);
-  }          
+  // calculate n+1 Sediment concentration field of all of the fractions
+  CalculateSediDiffusivity(grid,phys,myproc);
+  UpdateSedimentClasses(grid,phys,prop,comm,myproc);
   if(sediments->WSconstant==0)
     SettlingVelocity(grid,phys,prop,myproc);
-  // update Deposition
-  CalculateDeposition(grid,phys,prop,myproc);
+  // update Deposition and accumulate the bed fluxes
+  CalculateDeposition(grid,phys,prop,sediments->bedInterval>0,myproc);
   // update bed change
-  if(prop->n%sediments->bedInterval==0 && sediments->bedInterval>0)
+  if(IntervalDue(prop,sediments->bedInterval))
     BedChange(grid,phys,prop,myproc);   
   // get the boundary value for the next time step
   BoundarySediment(grid,phys,prop);
@@ -14,6 +14,9 @@
 #include "grid.h"
 #include "phys.h"
 
+// Exponent of the excess shear stress in the soft erosion rate E0*exp(ESOFT*(taub-taue))
+#define ESOFT 4.2
+
 typedef struct _sedimentsT {
 REAL ***SediC,// sediment concentration for time step n [fraction][cell][Nkmax]
      ***SediC_old,// sediment concentration for time step n-1 [fraction][cell][Nkmax]
@@ -34,8 +37,14 @@ REAL ***SediC,// sediment concentration for time step n [fraction][cell][Nkmax]
      ***Erosion, // erosion term in first layer is for suspended sediment transport [fraction][cell][Nlayer]
      ***Erosion_old, //added
      //**Woldsedi, //vertical velocity for sediment particles [cell][Nkmax+1]
-     **Wnewsedi, // calculated by SedimentVerticalVelocity
-     **SediKappa_tv, // tubulent sediment diffusivity [cell][Nkmax]
+     **Wnewsedi, // vertical velocity of the class being computed in UpdateSedimentClasses [cell][Nkmax+1]
+     **SediKappa_tv, // tubulent sediment diffusivity for Prt=1 [cell][Nkmax]
+     ***SfHp, ***SfHm, // face values of each class for the TVD scheme [fraction][edge][Nkmax]
+     ***SumQC, // TVD limiter sums of each class, with the shared inflow flux in SumQC[Nsize] [fraction+1][cell][Nkmax]
+     *Atri, *Btri, *Ctri, *Dtri, *Xtri, // tridiagonal systems of all of the classes in a column [Nkmax*fraction]
+     *Apsedi, *Amsedi, *bdsedi, // vertical advection and diffusion coefficients of a class in a column [Nkmax+1]
+     *Hsedi, *Cnsedi, // horizontal advection and explicit terms of a class in a column [Nkmax]
+     *Fhsedi, // fluxes through the faces of a cell, shared by all of the classes [maxfaces*Nkmax]
      //**Erosiontotal, // total erosion for each cell each layer [cell][Nlayer]
      //**Erosiontotal_old, // store former step [cell][Nlayer]
      //**Neterosion,  // store the net erosion in Bedinterval steps [cell][Nlayer]
@@ -58,11 +67,24 @@ REAL ***SediC,// sediment concentration for time step n [fraction][cell][Nkmax]
      *Softhard,  // the layer is soft or hard-> given in sedi.dat [Layer] 
      **Drydensity, // dry density for each layer, constant [fraction][Nlayer]
      ds50,
+     ***Bedflux, // net mass flux into each layer accumulated since the last bed update [fraction][cell][Nlayer]
+     *Taubexp, // exp(ESOFT*taub), shared by all of the soft layers of a cell [cell]
+     *Bedtaue, *Bedinvtaue, // critical erosion stress and its inverse [fraction*Nlayer]
+     *Bedesoft, // E0*exp(-ESOFT*taue) of the soft layers [fraction*Nlayer]
+     *Bedmmax, // Drydensity/morfac, divided by dt the erosion rate that removes a unit thickness in one bed step [fraction*Nlayer]
+     *Bedinvrho, // 1/Drydensity [fraction*Nlayer]
+     *Bedconsolid, // net consolidation into each layer [Nlayer]
+     *Tstarcoef, // sum of 1/(Taue*Nsize) over the fractions of each layer for CalculateSedimentKb [Nlayer]
+     Kba1, Kba2, // coefficients of the shear stress roughness in CalculateSedimentKb
+     morfac, // morphological acceleration factor of the bed change
      Kbed, // diffusion coefficient for bed layerthickness
      Chind, // concentration for hindered settling velocity
      Cfloc; // concentration for flocuation for settling velocity
 
 int *Layertop,  // store the first layer number for each cell [cell]
+    *Fhup, // upwind side of the faces of a cell, shared by all of the classes [maxfaces*Nkmax]
+    *Bedge, // last type 2 or 3 boundary edge of each cell, or -1 [cell]
+    *Bedsoft, // whether each layer of each fraction is soft [fraction*Nlayer]
     Nlayer, // number of bed layer -> given in sedi.dat
     Nsize,  // number of fractions -> given in sedi.dat
     sscvprof, // the switch to decide the vertical profile of SSC for 2d OR 1d model, 1 rouse curve 2 constant
@@ -82,6 +104,9 @@ sedimentsT *sediments;
 void ComputeSediments(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, int blowup, MPI_Comm comm);
 void ComputeSedimentsRestart(gridT *grid, physT *phys, propT *prop, int myproc);
 void ComputeSedimentsBedRestart(gridT *grid, physT *phys, propT *prop, int myproc);
+void LimitBedErosion(int i, int j, REAL invdt);
+void SedimentsRepartition(gridT *grid, propT *prop, sedimentsT *oldsediments, int myproc);
+void FreeSedimentArrays(sedimentsT *s, gridT *grid);
 #endif
 
 
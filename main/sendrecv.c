@@ -20,6 +20,10 @@ static void SendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Com
 static void SendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm);
 static void SendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Comm comm);
 
+// Buffers for ISendRecvCellData3DN, which hold NsendN fields for each neighbor
+static REAL **sendN=NULL, **recvN=NULL;
+static int NsendN=0;
+
 /************************************************************************/
 /*                                                                      */
 /*               Public functions (used to be in grid.c)                */
@@ -111,6 +115,16 @@ void FreeTransferArrays(gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
     SunFree(grid->send[neigh],maxtosend*sizeof(REAL),"FreeTransferArrays");
     SunFree(grid->recv[neigh],maxtorecv*sizeof(REAL),"FreeTransferArrays");
   }
+  if(NsendN) {
+    for(neigh=0;neigh<grid->Nneighs;neigh++) {
+      SunFree(sendN[neigh],NsendN*grid->total_cells_send[neigh]*sizeof(REAL),"FreeTransferArrays");
+      SunFree(recvN[neigh],NsendN*grid->total_cells_recv[neigh]*sizeof(REAL),"FreeTransferArrays");
+    }
+    SunFree(sendN,grid->Nneighs*sizeof(REAL *),"FreeTransferArrays");
+    SunFree(recvN,grid->Nneighs*sizeof(REAL *),"FreeTransferArrays");
+    NsendN=0;
+  }
+
   SunFree(grid->total_cells_send,grid->Nneighs*sizeof(int),"FreeTransferArrays");
   SunFree(grid->total_cells_recv,grid->Nneighs*sizeof(int),"FreeTransferArrays");
   SunFree(grid->total_cells_sendW,grid->Nneighs*sizeof(int),"FreeTransferArrays");
@@ -134,7 +148,7 @@ void FreeTransferArrays(gridT *grid, int myproc, int numprocs, MPI_Comm comm) {
 void ISendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm comm)
 {
   int n, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
 
   // for each neighbor
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
@@ -146,6 +160,45 @@ void ISendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm comm)
       grid->send[neigh][n]=celldata[grid->cell_send[neigh][n]];
 
     MPI_Isend((void *)(grid->send[neigh]),grid->num_cells_send[neigh],
+	     MPI_REALTYPE,neighproc,1,comm,&(grid->request[neigh])); 
+  }
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->num_cells_recv[neigh],
+	     MPI_REALTYPE,neighproc,1,comm,&(grid->request[grid->Nneighs+neigh]));
+  }
+  MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    for(n=0;n<grid->num_cells_recv[neigh];n++)
+      celldata[grid->cell_recv[neigh][n]]=grid->recv[neigh][n];
+  }
+  t_comm+=Timer()-t0;
+}
+
+/*
+ * Function: ISendRecvCellData2DDouble
+ * Usage: ISendRecvCellData2DDouble(phys->hcg,grid,myproc,comm);
+ * -------------------------------------------------------------
+ * Same as ISendRecvCellData2D for double-precision cell data, which is used by
+ * the free-surface solver when REAL is float.  The transfer buffers hold at
+ * least two REALs per cell (see AllocateTransferArrays) and so one double.
+ *
+ */
+void ISendRecvCellData2DDouble(DREAL *celldata, gridT *grid, int myproc, MPI_Comm comm)
+{
+  int n, neigh, neighproc;
+  DREAL t0=Timer(), *send, *recv;
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    send = (DREAL *)grid->send[neigh];
+
+    for(n=0;n<grid->num_cells_send[neigh];n++)
+      send[n]=celldata[grid->cell_send[neigh][n]];
+
+    MPI_Isend((void *)send,grid->num_cells_send[neigh],
 	     MPI_DOUBLE,neighproc,1,comm,&(grid->request[neigh])); 
   }
 
@@ -157,8 +210,49 @@ void ISendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm comm)
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    recv = (DREAL *)grid->recv[neigh];
     for(n=0;n<grid->num_cells_recv[neigh];n++)
-      celldata[grid->cell_recv[neigh][n]]=grid->recv[neigh][n];
+      celldata[grid->cell_recv[neigh][n]]=recv[n];
+  }
+  t_comm+=Timer()-t0;
+}
+
+/*
+ * Function: ISendRecvCellData2DInt
+ * Usage: ISendRecvCellData2DInt(id,grid,myproc,comm);
+ * ---------------------------------------------------
+ * Same as ISendRecvCellData2D for integer cell data, such as global cell
+ * numbers, which are not exact as REAL when REAL is float and they exceed 2^24.
+ * An int is no larger than a REAL, so it fits in the transfer buffers.
+ *
+ */
+void ISendRecvCellData2DInt(int *celldata, gridT *grid, int myproc, MPI_Comm comm)
+{
+  int n, neigh, neighproc, *send, *recv;
+  DREAL t0=Timer();
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    send = (int *)grid->send[neigh];
+
+    for(n=0;n<grid->num_cells_send[neigh];n++)
+      send[n]=celldata[grid->cell_send[neigh][n]];
+
+    MPI_Isend((void *)send,grid->num_cells_send[neigh],
+	     MPI_INT,neighproc,1,comm,&(grid->request[neigh])); 
+  }
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->num_cells_recv[neigh],
+	     MPI_INT,neighproc,1,comm,&(grid->request[grid->Nneighs+neigh]));
+  }
+  MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    recv = (int *)grid->recv[neigh];
+    for(n=0;n<grid->num_cells_recv[neigh];n++)
+      celldata[grid->cell_recv[neigh][n]]=recv[n];
   }
   t_comm+=Timer()-t0;
 }
@@ -174,7 +268,7 @@ void ISendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm comm)
 void ISendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm)
 {
   int k, n, nstart, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
@@ -186,13 +280,13 @@ void ISendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm
       nstart+=grid->Nk[grid->cell_send[neigh][n]];
     }
 
-    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_send[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_send[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[neigh])); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recv[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recv[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[grid->Nneighs+neigh]));
   }
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
@@ -208,6 +302,124 @@ void ISendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm
   t_comm+=Timer()-t0;
 }
 
+/*
+ * Function: ISendRecvCellData3DN
+ * Usage: ISendRecvCellData3DN(sediments->SediC,sediments->Nsize,grid,myproc,comm);
+ * ---------------------------------------------------------------------------------
+ * Same as ISendRecvCellData3D for the N 3D cell fields celldata[0..N-1], which
+ * are packed into one message for each neighbor.  The buffers are kept between
+ * calls and are only reallocated when more fields are sent than before.
+ *
+ */
+void ISendRecvCellData3DN(REAL ***celldata, int N, gridT *grid, int myproc, MPI_Comm comm)
+{
+  int i, k, m, n, nstart, neigh, neighproc;
+  DREAL t0=Timer();
+
+  if(N>NsendN) {
+    if(NsendN) {
+      for(neigh=0;neigh<grid->Nneighs;neigh++) {
+        SunFree(sendN[neigh],NsendN*grid->total_cells_send[neigh]*sizeof(REAL),"ISendRecvCellData3DN");
+        SunFree(recvN[neigh],NsendN*grid->total_cells_recv[neigh]*sizeof(REAL),"ISendRecvCellData3DN");
+      }
+    } else {
+      sendN = (REAL **)SunMalloc(grid->Nneighs*sizeof(REAL *),"ISendRecvCellData3DN");
+      recvN = (REAL **)SunMalloc(grid->Nneighs*sizeof(REAL *),"ISendRecvCellData3DN");
+    }
+    for(neigh=0;neigh<grid->Nneighs;neigh++) {
+      sendN[neigh] = (REAL *)SunMalloc(N*grid->total_cells_send[neigh]*sizeof(REAL),"ISendRecvCellData3DN");
+      recvN[neigh] = (REAL *)SunMalloc(N*grid->total_cells_recv[neigh]*sizeof(REAL),"ISendRecvCellData3DN");
+    }
+    NsendN=N;
+  }
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+
+    nstart=0;
+    for(n=0;n<grid->num_cells_send[neigh];n++) {
+      i = grid->cell_send[neigh][n];
+      for(m=0;m<N;m++) {
+        for(k=0;k<grid->Nk[i];k++) 
+          sendN[neigh][nstart+k]=celldata[m][i][k];
+        nstart+=grid->Nk[i];
+      }
+    }
+
+    MPI_Isend((void *)(sendN[neigh]),N*grid->total_cells_send[neigh],MPI_REALTYPE,neighproc,1,
+        comm,&(grid->request[neigh])); 
+  }
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    MPI_Irecv((void *)(recvN[neigh]),N*grid->total_cells_recv[neigh],MPI_REALTYPE,neighproc,1,
+        comm,&(grid->request[grid->Nneighs+neigh]));
+  }
+  MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    nstart=0;
+    for(n=0;n<grid->num_cells_recv[neigh];n++) {
+      i = grid->cell_recv[neigh][n];
+      for(m=0;m<N;m++) {
+        for(k=0;k<grid->Nk[i];k++) 
+          celldata[m][i][k]=recvN[neigh][nstart+k];
+        nstart+=grid->Nk[i];
+      }
+    }
+  }
+  t_comm+=Timer()-t0;
+}
+
+/*
+ * Function: ISendRecvCellData3DSingle
+ * Usage: ISendRecvCellData3DSingle(phys->qcg,phys->qstart,grid,myproc,comm);
+ * --------------------------------------------------------------------------
+ * Same as ISendRecvCellData3D for single-precision cell data stored in one
+ * contiguous array, in which the column of cell i starts at start[i].  This is
+ * used by the mixed-precision solver for the nonhydrostatic pressure.
+ *
+ */
+void ISendRecvCellData3DSingle(float *celldata, int *start, gridT *grid, int myproc, MPI_Comm comm)
+{
+  int k, n, nstart, neigh, neighproc;
+  float *send, *recv;
+  DREAL t0=Timer();
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    send = (float *)grid->send[neigh];
+
+    nstart=0;
+    for(n=0;n<grid->num_cells_send[neigh];n++) {
+      for(k=0;k<grid->Nk[grid->cell_send[neigh][n]];k++) 
+        send[nstart+k]=celldata[start[grid->cell_send[neigh][n]]+k];
+      nstart+=grid->Nk[grid->cell_send[neigh][n]];
+    }
+
+    MPI_Isend((void *)send,grid->total_cells_send[neigh],MPI_FLOAT,neighproc,1,
+        comm,&(grid->request[neigh])); 
+  }
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    neighproc = grid->myneighs[neigh];
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recv[neigh],MPI_FLOAT,neighproc,1,
+        comm,&(grid->request[grid->Nneighs+neigh]));
+  }
+  MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
+
+  for(neigh=0;neigh<grid->Nneighs;neigh++) {
+    recv = (float *)grid->recv[neigh];
+    nstart=0;
+    for(n=0;n<grid->num_cells_recv[neigh];n++) {
+      for(k=0;k<grid->Nk[grid->cell_recv[neigh][n]];k++) 
+        celldata[start[grid->cell_recv[neigh][n]]+k]=recv[nstart+k];
+      nstart+=grid->Nk[grid->cell_recv[neigh][n]];
+    }
+  }
+  t_comm+=Timer()-t0;
+}
+
 /*
  * Function: ISendRecvWData
  * Usage: ISendRecvWData(grid->w,grid,myproc,comm);
@@ -219,7 +431,7 @@ void ISendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm
 void ISendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm)
 {
   int k, n, nstart, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
@@ -231,13 +443,13 @@ void ISendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm)
       nstart+=(1+grid->Nk[grid->cell_send[neigh][n]]);
     }
 
-    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_sendW[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Isend((void *)(grid->send[neigh]),grid->total_cells_sendW[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[neigh])); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recvW[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_cells_recvW[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[grid->Nneighs+neigh]));
   }
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
@@ -264,7 +476,7 @@ void ISendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm)
 void ISendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Comm comm)
 {
   int k, n, nstart, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
@@ -276,13 +488,13 @@ void ISendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Comm comm
       nstart+=grid->Nke[grid->edge_send[neigh][n]];
     }
 
-    MPI_Isend((void *)(grid->send[neigh]),grid->total_edges_send[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Isend((void *)(grid->send[neigh]),grid->total_edges_send[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[neigh])); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_edges_recv[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_edges_recv[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[grid->Nneighs+neigh]));
   }
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
@@ -310,7 +522,7 @@ void ISendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Comm comm
 void ISendRecvEdgeData2D(REAL *edgedata, gridT *grid, int myproc, MPI_Comm comm)
 {
   int k, n, neigh, neighproc;
-  REAL t0=Timer();
+  DREAL t0=Timer();
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
@@ -319,13 +531,13 @@ void ISendRecvEdgeData2D(REAL *edgedata, gridT *grid, int myproc, MPI_Comm comm)
       grid->send[neigh][n]=edgedata[grid->edge_send[neigh][n]];
     }
 
-    MPI_Isend((void *)(grid->send[neigh]),grid->total_edges_send[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Isend((void *)(grid->send[neigh]),grid->total_edges_send[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[neigh])); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_edges_recv[neigh],MPI_DOUBLE,neighproc,1,
+    MPI_Irecv((void *)(grid->recv[neigh]),grid->total_edges_recv[neigh],MPI_REALTYPE,neighproc,1,
         comm,&(grid->request[grid->Nneighs+neigh]));
   }
   MPI_Waitall(2*grid->Nneighs,grid->request,grid->status);
@@ -549,13 +761,13 @@ static void SendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm
       send[neigh][n]=celldata[grid->cell_send[neigh][n]];
 
     MPI_Send((void *)(send[neigh]),num_send[neigh],
-	     MPI_DOUBLE,neighproc,1,comm); 
+	     MPI_REALTYPE,neighproc,1,comm); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
     MPI_Recv((void *)(recv[neigh]),num_recv[neigh],
-	     MPI_DOUBLE,neighproc,1,comm,&status);
+	     MPI_REALTYPE,neighproc,1,comm,&status);
   }
   MPI_Barrier(comm);
 
@@ -614,12 +826,12 @@ static void SendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Com
       nstart+=grid->Nk[grid->cell_send[neigh][n]];
     }
 
-    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_DOUBLE,neighproc,1,comm); 
+    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_REALTYPE,neighproc,1,comm); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_DOUBLE,neighproc,1,comm,&status);
+    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_REALTYPE,neighproc,1,comm,&status);
   }
   MPI_Barrier(comm);
 
@@ -684,12 +896,12 @@ static void SendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm com
       nstart+=(1+grid->Nk[grid->cell_send[neigh][n]]);
     }
 
-    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_DOUBLE,neighproc,1,comm); 
+    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_REALTYPE,neighproc,1,comm); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_DOUBLE,neighproc,1,comm,&status);
+    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_REALTYPE,neighproc,1,comm,&status);
   }
   MPI_Barrier(comm);
 
@@ -754,12 +966,12 @@ static void SendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Com
       nstart+=grid->Nke[grid->edge_send[neigh][n]];
     }
 
-    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_DOUBLE,neighproc,1,comm); 
+    MPI_Send((void *)(send[neigh]),Nsend[neigh],MPI_REALTYPE,neighproc,1,comm); 
   }
 
   for(neigh=0;neigh<grid->Nneighs;neigh++) {
     neighproc = grid->myneighs[neigh];
-    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_DOUBLE,neighproc,1,comm,&status);
+    MPI_Recv((void *)(recv[neigh]),Nrecv[neigh],MPI_REALTYPE,neighproc,1,comm,&status);
   }
   MPI_Barrier(comm);
 
@@ -18,7 +18,11 @@
 void AllocateTransferArrays(gridT **grid, int myproc, int numprocs, MPI_Comm comm);
 void FreeTransferArrays(gridT *grid, int myproc, int numprocs, MPI_Comm comm);
 void ISendRecvCellData2D(REAL *celldata, gridT *grid, int myproc, MPI_Comm comm);
+void ISendRecvCellData2DDouble(DREAL *celldata, gridT *grid, int myproc, MPI_Comm comm);
+void ISendRecvCellData2DInt(int *celldata, gridT *grid, int myproc, MPI_Comm comm);
 void ISendRecvCellData3D(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm);
+void ISendRecvCellData3DN(REAL ***celldata, int N, gridT *grid, int myproc, MPI_Comm comm);
+void ISendRecvCellData3DSingle(float *celldata, int *start, gridT *grid, int myproc, MPI_Comm comm);
 void ISendRecvWData(REAL **celldata, gridT *grid, int myproc, MPI_Comm comm);
 void ISendRecvEdgeData3D(REAL **edgedata, gridT *grid, int myproc, MPI_Comm comm);
 void ISendRecvEdgeData2D(REAL *edgedata, gridT *grid, int myproc, MPI_Comm comm);
@@ -199,6 +199,9 @@ void HeatSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop, metT
    */
  // GetAtmosphericProperties(Ta,M,U2,rh,grid,phys,prop);
 
+  // Clear sky shortwave radiation at this time step
+  UpdateSolarGeometry(grid,prop,met->rad);
+
   /*
    * Incoming longwave radiation
    * 
@@ -213,7 +216,7 @@ void HeatSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop, metT
     M = met->cloud[i];
     Ta = met->Tair[i];
     U2 = sqrt( pow(met->Uwind[i],2.0) + pow(met->Vwind[i],2.0) );
-    met->Hsw[i] = shortwave(prop->nctime/86400.0,prop->latitude,met->cloud[i],prop->gmtoffset/24.0);
+    met->Hsw[i] = CellShortwave(met->rad,i,met->cloud[i]);
     H_SW = met->Hsw[i];
     rh = met->RH[i]/100.0;
     //H_LW = met->Hlw[i];
@@ -364,22 +367,18 @@ void HeatSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop, metT
 }else if(prop->metmodel==2 || prop->metmodel==3){ // COARE3.0 HeatFlux Algorithm or constant flux coefficients
    int i, k, ktop, iptr;
    REAL dztop;
-   REAL *H0=met->Htmp;
+   REAL H0;
 
    REAL c_p = 4186.0;     // Specific heat of water at standard conditions (J kg^{-1})
    REAL rhocp = RHO0*c_p;
    REAL dHdT;
    REAL eps = 1e-14;
    REAL dzmin_heatflux = 0.1;  // Minimum allowable depth of top cell for computation of   
-   // shortwave constants
-   REAL ksw1; // light extinction coefficient
-   REAL depth, z, topface, botface;
-   REAL wave1, wave1term1, wave1term2, wave1term3;
-   REAL F_SW;
-   REAL dT;
    
    
-  // for(j=0;j<grid->Nc;j++){
+   // Evaluate the implicit source term with the fluxes and their derivative
+   // with respect to the surface temperature from updateAirSeaFluxes
+  // for(j=0;j<grid->Nc;j++){  
   for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
     i = grid->cellp[iptr];
      ktop = grid->ctop[i];
@@ -388,80 +387,18 @@ void HeatSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop, metT
          A[i][k]=B[i][k]=0.0;
   
      // Set the flux terms in the top cell for the present time step
-     H0[i] = ( met->Hs[i] + met->Hl[i] + met->Hlw[i] );
-     
-     // Calculate T+dt array
-    //if(phys->dT[i]<=0.0){
-    //   phys->dT[i]=Min(-1e-4,phys->dT[i]);
-    // }else{
-    //   phys->dT[i]=Max(1e-4,phys->dT[i]);
-    // }
-    phys->dT[i] = 0.001; //Hard-wire for stability 
-    
-     phys->Ttmp[i][ktop] = phys->T[i][ktop] + phys->dT[i];
-   }
-   
-   //Communicate the temporary Temperature array
-   ISendRecvCellData3D(phys->Ttmp,grid,myproc,comm);
-
-   // Evaluate flux terms when the temperature is T + dT
-   updateAirSeaFluxes(prop, grid, phys, met, phys->Ttmp);
-   
-   // Evaluate the implicit source term
-  // for(j=0;j<grid->Nc;j++){  
-  for(iptr=grid->celldist[0];iptr<grid->celldist[1];iptr++) {
-    i = grid->cellp[iptr];
-     ktop = grid->ctop[i];
+     H0 = ( met->Hs[i] + met->Hl[i] + met->Hlw[i] );
      
      // Put the temperature gradient flux terms into B
-     if(fabs(phys->dT[i]) < 1e-5){
-      dHdT=0;
-     }else{
-   dHdT = ( (met->Hs[i] + met->Hl[i] + met->Hlw[i]) - H0[i]) / phys->dT[i];
-     }
+     dHdT = met->dHdT[i];
      
-     A[i][ktop] = H0[i] - dHdT * phys->T[i][ktop];
+     A[i][ktop] = H0 - dHdT * phys->T[i][ktop];
      B[i][ktop] = -dHdT;
 
      dztop = Max(dzmin_heatflux,grid->dzz[i][ktop]);
      A[i][ktop]/=(rhocp*dztop);
      B[i][ktop]/=(rhocp*dztop);
 
-     /*******************************************************
-     // Evaluate the shortwave radiation terms and put into A
-     ********************************************************/
-     
-     //Calculate the local depth (accounts for free surface) 
-     depth=0;
-     for(k=ktop;k<grid->Nk[i];k++) 
-  depth += grid->dzz[i][k]; 
-     
-     // Set the light extinction coefficient - ensure that thhe extinction depth is less than the water depth
-     ksw1 = 1.0 / Min(prop->Lsw, 0.5*depth);
-
-     if(ksw1!=ksw1){
-      printf("Error NaN computed in shortwave radiation term - too shallow!\n");
-  exit(EXIT_FAILURE);
-     }
-
-     z=0.0; // Reference from the free-surface
-     for(k=ktop;k<grid->Nk[i];k++) {
-       z-=grid->dzz[i][k]/2.0;
- 
-       topface = z + grid->dzz[i][k]/2.0; //Depth of the top face of a cell from the surface
-       botface = z - grid->dzz[i][k]/2.0; //Depth of the bottom face of a cell from the surface
- 
-       // Discrete form of dQ_sw/dz
-       wave1 = (exp(topface*ksw1) - exp(botface*ksw1))/(topface - botface);
- 
-       F_SW = wave1 * met->Hsw[i] / rhocp;
-       
-       B[i][k] += 0.0;
-       A[i][k] += F_SW;
-       
-       z-=grid->dzz[i][k]/2;
-       
-     }
      /********************************************
       *   Original shortwave code
       ********************************************
@@ -502,6 +439,9 @@ void HeatSource(REAL **A, REAL **B, gridT *grid, physT *phys, propT *prop, metT
      }
      */
    }
+
+   // Penetrating shortwave radiation
+   ShortwaveSource(A,met->Hsw,rhocp,grid,prop,met->rad);
  }else{ //Set flux terms to zero
   int i,k,iptr;
     //for(i=0;i<grid->Nc;i++)
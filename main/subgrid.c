@@ -26,6 +26,8 @@
 #include "marsh.h"
 #include "culvert.h"
 #include "vertcoordinate.h"
+#include "timestep.h"
+#include "field.h"
 
 void ReadSubgridProperties(propT *prop, int myproc);
 void AllocateandInitializeSubgrid(gridT *grid, propT *prop, int myproc);
@@ -34,22 +36,31 @@ void CalculateSubgridCellp(gridT *grid, int myproc);
 void InterpolateSubgridDepth(gridT *grid,physT *phys, propT *prop,int myproc,int numprocs);
 void InterpolateSubgridHmarsh(gridT *grid,physT *phys, int myproc, int numprocs);
 void InterpolateSubgridCdV(gridT *grid,physT *phys, int myproc, int numprocs);
+static void SampleSubgridField(char *file, REAL *zp, REAL *zpe, gridT *grid, int myproc);
 void CalculateVolumeProfile(gridT *grid, int myproc);
 void CalculateHProfile(gridT *grid, int myproc);
 void CalculateAcProfile(gridT *grid, int myproc);
 void CalculateAreaRatio(gridT *grid, int myproc);
 void CalculateFluxHeightProfile(gridT *grid, int myproc);
 void CalculateWetperimeterProfile(gridT *grid, int myproc);
+void CalculateMonotoneProfiles(gridT *grid, int myproc);
+static void PchipSlopes(REAL *x, REAL *y, REAL *d, int n);
+static int PchipInterval(REAL *x, int n, REAL xi);
+static REAL PchipValue(REAL *x, REAL *y, REAL *d, int i, REAL xi, REAL *dy);
+static REAL PchipIntegral(REAL *x, REAL *y, REAL *d, int i, REAL xi);
+static void CellWetAreas(gridT *grid, int nc, REAL *h, REAL **A, int nh);
+static void EdgeFluxHeights(gridT *grid, int ne, REAL *h, REAL **y, int nh);
+static int CompareErrors(const void *a, const void *b);
+static int AdaptiveProfile(gridT *grid, int n, REAL hlo, REAL hhi, int ny, REAL *h, REAL **y, REAL **d,
+    int nmax, REAL *work, void (*func)(gridT *, int, REAL *, REAL **, int));
 void SubgridCheck(gridT *grid, int myproc);
 REAL CalculateWetArea(int nc, int nfaces, int maxfaces, REAL h);
 REAL CalculateWetperimeter(int ne, REAL h);
 REAL CalculateFluxHeight(int ne, REAL h);
 REAL UpdateFluxHeight(int ne, REAL h);
 REAL UpdateWetperi(int ne, REAL h);
-REAL UpdateAceff(int nc, REAL h);
-REAL UpdateVeff(int nc, REAL h);
-REAL UpdateFreeSurface(int nc, REAL V);
 void OutputSubgrid(gridT *grid, physT *phys, propT *prop,int myproc, int numprocs, MPI_Comm comm);
+static void SubgridGeometry(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 
 /*
  * Function: ReadSubgridProperties
@@ -59,6 +70,17 @@ void OutputSubgrid(gridT *grid, physT *phys, propT *prop,int myproc, int numproc
  * subgrid model
  */
 void ReadSubgridProperties(propT *prop, int myproc) {
+#ifdef SINGLEPRECISION
+  // the height of a dry cell (DRYCELLHEIGHT) is lost next to its depth in
+  // single precision, leaving dry cells with zero thickness
+  if(prop->wetdry) {
+    if(myproc==0)
+      printf("ERROR: the subgrid model with wetting and drying requires double precision.\n"
+          "Rebuild without -DSINGLEPRECISION or set wetdry=0.\n");
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+#endif
   subgrid->segN = MPI_GetValue(DATAFILE,"segN","ReadSubgridProperties",myproc); 
   subgrid->disN = MPI_GetValue(DATAFILE,"disN","ReadSubgridProperties",myproc); 
   subgrid->meth = MPI_GetValue(DATAFILE,"subgridmeth","ReadSubgridProperties",myproc); 
@@ -66,6 +88,8 @@ void ReadSubgridProperties(propT *prop, int myproc) {
   subgrid->dpint =MPI_GetValue(DATAFILE,"subgriddpint","ReadSubgridProperties",myproc); 
   subgrid->dragpara =MPI_GetValue(DATAFILE,"subgriddragpara","ReadSubgridProperties",myproc); 
   subgrid->eps =MPI_GetValue(DATAFILE,"subgrideps","ReadSubgridProperties",myproc); 
+  subgrid->prof =MPI_GetValue(DATAFILE,"subgridprof","ReadSubgridProperties",myproc); 
+  subgrid->proftol =MPI_GetValue(DATAFILE,"subgridproftol","ReadSubgridProperties",myproc); 
   
   if(prop->marshmodel)
   {
@@ -246,6 +270,25 @@ void AllocateandInitializeSubgrid(gridT *grid, propT *prop, int myproc) {
   for(i=0;i<grid->Ne;i++)
     subgrid->dzboteff[i]=0.0;  
 
+  // slopes and number of breakpoints of the monotone cubic profiles
+  if(subgrid->prof) {
+    subgrid->dAcprof = (REAL *)SunMalloc(grid->Nc*(subgrid->disN+1)*sizeof(REAL),"AllocateSubgrid");
+    subgrid->dfluxhprof = (REAL *)SunMalloc(Ntotal*sizeof(REAL),"AllocateSubgrid");
+    subgrid->dWetperiprof = (REAL *)SunMalloc(Ntotal*sizeof(REAL),"AllocateSubgrid");
+    subgrid->nprof = (int *)SunMalloc(grid->Nc*sizeof(int),"AllocateSubgrid");
+    subgrid->nprofe = (int *)SunMalloc(grid->Ne*sizeof(int),"AllocateSubgrid");
+    for(i=0;i<grid->Nc*(subgrid->disN+1);i++)
+      subgrid->dAcprof[i]=0.0;
+    for(i=0;i<Ntotal;i++) {
+      subgrid->dfluxhprof[i]=0.0;
+      subgrid->dWetperiprof[i]=0.0;
+    }
+    for(i=0;i<grid->Nc;i++)
+      subgrid->nprof[i]=subgrid->disN+1;
+    for(i=0;i<grid->Ne;i++)
+      subgrid->nprofe[i]=subgrid->disN+1;
+  }
+
   // allocate the backup of original Ac and effective wet Ac
   subgrid->Acbackup = (REAL *)SunMalloc(grid->Nc*sizeof(REAL),"AllocateSubgrid");
   subgrid->Acwet = (REAL *)SunMalloc(grid->Nc*sizeof(REAL),"AllocateSubgrid");
@@ -401,7 +444,7 @@ void OpenSubgridFiles(int computeSediments, int mergeArrays, int myproc)
    int i, j, jptr, k, nwritten, arraySize, writeProc,nc1,nc2;
    char str[BUFFERLENGTH], filename[BUFFERLENGTH];
 
-   if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart) {
+   if(IntervalDue(prop,prop->ntout) || prop->n==1+prop->nstart) {
      Write2DData(subgrid->Aceff,prop->mergeArrays,subgrid->AceffFID,"Error outputting subgrid Aceff data!\n",
        grid,numprocs,myproc,comm);
      Write2DData(subgrid->Veff,prop->mergeArrays,subgrid->VeffFID,"Error outputting subgrid Veff data!\n",
@@ -501,7 +544,7 @@ void CalculateSubgridXY(gridT *grid, int myproc)
  * use for grid.c to interpolate depth should input 
  * cell index n, segment number segN, x, y
  */
-void CalculateCellSubgridXY(REAL *x, REAL *y, int n, int segN, gridT *grid, int myproc)
+void CalculateCellSubgridXY(DREAL *x, DREAL *y, int n, int segN, gridT *grid, int myproc)
 {
   int i,j,k,l,m,base;
   REAL dx1,dx2,dy1,dy2;
@@ -595,6 +638,67 @@ void CalculateSubgridCellp(gridT *grid, int myproc)
   }
 }
 
+/*
+ * Function: SampleSubgridField
+ * Usage: SampleSubgridField(str,subgrid->dp,subgrid->dpe,grid,myproc);
+ * --------------------------------------------------------------------
+ * Read the part of the field in file that covers the local subcell and
+ * subedge points and interpolate it onto the subcell points zp and the
+ * subedge points zpe.  Only the subcell points that exist in each cell are
+ * sampled.
+ *
+ */
+static void SampleSubgridField(char *file, REAL *zp, REAL *zpe, gridT *grid, int myproc)
+{
+  int nc, j, n, m, N, Ne, ncount, base;
+  REAL extent[4], *z;
+  DREAL *x, *y;
+  fieldT *field;
+
+  // The subcell and subedge points are gathered into one array so that the
+  // field is read and, if needed, extended only once (see SampleField)
+  Ne=grid->Ne*(subgrid->segN+1);
+  N=Ne;
+  for(nc=0;nc<grid->Nc;nc++)
+    N+=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+  x = (DREAL *)SunMalloc(N*sizeof(DREAL),"SampleSubgridField");
+  y = (DREAL *)SunMalloc(N*sizeof(DREAL),"SampleSubgridField");
+  z = (REAL *)SunMalloc(N*sizeof(REAL),"SampleSubgridField");
+
+  n=0;
+  for(nc=0;nc<grid->Nc;nc++){
+    ncount=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+    base=nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+    for(m=0;m<ncount;m++,n++){
+      x[n]=subgrid->xp[base+m];
+      y[n]=subgrid->yp[base+m];
+    }
+  }
+  for(j=0;j<Ne;j++,n++){
+    x[n]=subgrid->xpe[j];
+    y[n]=subgrid->ype[j];
+  }
+
+  FieldExtent(x,y,N,extent,1);
+  field = ReadField(file,extent,myproc);
+  SampleField(field,x,y,z,N,grid->maxfaces+1,myproc);
+  FreeField(field);
+
+  n=0;
+  for(nc=0;nc<grid->Nc;nc++){
+    ncount=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+    base=nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+    for(m=0;m<ncount;m++,n++)
+      zp[base+m]=z[n];
+  }
+  for(j=0;j<Ne;j++,n++)
+    zpe[j]=z[n];
+
+  SunFree(x,N*sizeof(DREAL),"SampleSubgridField");
+  SunFree(y,N*sizeof(DREAL),"SampleSubgridField");
+  SunFree(z,N*sizeof(REAL),"SampleSubgridField");
+}
+
 /*
  * Function: InterpolateSubgridHmarsh
  * Usage: calculate vegetation height for all subpoints
@@ -605,29 +709,16 @@ void CalculateSubgridCellp(gridT *grid, int myproc)
  */
 void InterpolateSubgridHmarsh(gridT *grid, physT *phys, int myproc, int numprocs)
 {
-  int i, j, n, nc,nc1,nc2,ne, Nd, scaledepth,ncount,base,k,intdd,ntotal,base1;
-  REAL *xd, *yd, *d,intd,min;
+  int i, j, n, nc,nc1,nc2,ne, scaledepth,ncount,base,k,intdd,ntotal,base1;
+  REAL intd,min;
   char str[BUFFERLENGTH],str1[BUFFERLENGTH];
   FILE *ifile;
 
   if(subgrid->hmarshint==1)
   {   
     MPI_GetFile(str,DATAFILE,"InputhmarshFile","InterpolateSubgridHmarsh",myproc);
-    Nd = MPI_GetSize(str,"InterpolateSubgridHmarsh",myproc);
-    xd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridHmarsh");
-    yd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridHmarsh");
-    d = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridHmarsh");
-
-    ifile = MPI_FOpen(str,"r","InterpolateSubgridHmarsh",myproc);
-    for(n=0;n<Nd;n++) {
-      xd[n]=getfield(ifile,str);
-      yd[n]=getfield(ifile,str);
-      d[n]=getfield(ifile,str);//fabs(getfield(ifile,str));   
-    }
-    fclose(ifile);
-    // interpolate subcell depth
-    ncount=grid->Nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
-    Interp(xd,yd,d,Nd,&(subgrid->xp[0]), &(subgrid->yp[0]),&(subgrid->hmarshp[0]),ncount,grid->maxfaces);
+    // interpolate subcell and subedge marsh height
+    SampleSubgridField(str,subgrid->hmarshp,subgrid->hmarshpe,grid,myproc);
 
     for(nc=0;nc<grid->Nc;nc++){
       ncount=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
@@ -641,9 +732,7 @@ void InterpolateSubgridHmarsh(gridT *grid, physT *phys, int myproc, int numprocs
       }
     }
 
-    // interpolate subedge depth
     ncount=grid->Ne*(subgrid->segN+1);
-    Interp(xd,yd,d,Nd,&(subgrid->xpe[0]), &(subgrid->ype[0]),&(subgrid->hmarshpe[0]),ncount,grid->maxfaces);
 
     for(n=0;n<ncount;n++)
     {
@@ -796,29 +885,16 @@ void InterpolateSubgridHmarsh(gridT *grid, physT *phys, int myproc, int numprocs
  */
 void InterpolateSubgridCdV(gridT *grid, physT *phys, int myproc, int numprocs)
 {
-  int i, j, n, nc,nc1,nc2,ne, Nd, scaledepth,ncount,base,k,intdd,ntotal,base1;
-  REAL *xd, *yd, *d,intd,min;
+  int i, j, n, nc,nc1,nc2,ne, scaledepth,ncount,base,k,intdd,ntotal,base1;
+  REAL intd,min;
   char str[BUFFERLENGTH],str1[BUFFERLENGTH];
   FILE *ifile;
 
   if(subgrid->cdvint==1)
   {   
     MPI_GetFile(str,DATAFILE,"InputCdVFile","InterpolateSubgridCdV",myproc);
-    Nd = MPI_GetSize(str,"InterpolateSubgridCdv",myproc);
-    xd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridCdV");
-    yd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridCdV");
-    d = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridCdV");
-
-    ifile = MPI_FOpen(str,"r","InterpolateSubgridCdv",myproc);
-    for(n=0;n<Nd;n++) {
-      xd[n]=getfield(ifile,str);
-      yd[n]=getfield(ifile,str);
-      d[n]=getfield(ifile,str);//fabs(getfield(ifile,str));   
-    }
-    fclose(ifile);
-    // interpolate subcell depth
-    ncount=grid->Nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
-    Interp(xd,yd,d,Nd,&(subgrid->xp[0]), &(subgrid->yp[0]),&(subgrid->cdvp[0]),ncount,grid->maxfaces);
+    // interpolate subcell and subedge drag coefficient
+    SampleSubgridField(str,subgrid->cdvp,subgrid->cdvpe,grid,myproc);
 
     for(nc=0;nc<grid->Nc;nc++){
       ncount=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
@@ -832,9 +908,7 @@ void InterpolateSubgridCdV(gridT *grid, physT *phys, int myproc, int numprocs)
       }
     }
 
-    // interpolate subedge depth
     ncount=grid->Ne*(subgrid->segN+1);
-    Interp(xd,yd,d,Nd,&(subgrid->xpe[0]), &(subgrid->ype[0]),&(subgrid->cdvpe[0]),ncount,grid->maxfaces);
 
     for(n=0;n<ncount;n++)
     {
@@ -983,8 +1057,8 @@ void InterpolateSubgridCdV(gridT *grid, physT *phys, int myproc, int numprocs)
  */
 void InterpolateSubgridDepth(gridT *grid, physT *phys, propT *prop, int myproc,int numprocs)
 {
-  int i, j, n, nc,nc1,nc2,ne, Nd, scaledepth,ncount,base,base1,k,intdd,ntotal;
-  REAL *xd, *yd, *d, scaledepthfactor,depthelev,intd,min,d1,d2,d3,d0;
+  int i, j, n, nc,nc1,nc2,ne, scaledepth,ncount,base,base1,k,intdd,ntotal;
+  REAL scaledepthfactor,depthelev,intd,min,d1,d2,d3,d0;
   char str[BUFFERLENGTH],str1[BUFFERLENGTH];
   FILE *ifile;
 
@@ -995,24 +1069,21 @@ void InterpolateSubgridDepth(gridT *grid, physT *phys, propT *prop, int myproc,i
   if(subgrid->dpint==1)
   {
     MPI_GetFile(str,DATAFILE,"subgriddFile","InterpolateSubgridDepth",myproc);
-    Nd = MPI_GetSize(str,"InterpolateSubgridDepth",myproc);
-    xd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridDepth");
-    yd = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridDepth");
-    d = (REAL *)SunMalloc(Nd*sizeof(REAL),"InterpolateSubgridDepth");
-
-    ifile = MPI_FOpen(str,"r","InterpolateSubgridDepth",myproc);
-    for(n=0;n<Nd;n++) {
-      xd[n]=getfield(ifile,str);
-      yd[n]=getfield(ifile,str);
-      d[n]=getfield(ifile,str);//fabs(getfield(ifile,str));
+    // interpolate subcell and subedge depth, scaling the interpolated depths
+    // since the interpolation weights sum to one
+    SampleSubgridField(str,subgrid->dp,subgrid->dpe,grid,myproc);
+    ncount=grid->Nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
+    for(n=0;n<ncount;n++) {
       if(scaledepth)
-        d[n]*=scaledepthfactor;
-      d[n]+=depthelev;    
+        subgrid->dp[n]*=scaledepthfactor;
+      subgrid->dp[n]+=depthelev;
+    }
+    ncount=grid->Ne*(subgrid->segN+1);
+    for(n=0;n<ncount;n++) {
+      if(scaledepth)
+        subgrid->dpe[n]*=scaledepthfactor;
+      subgrid->dpe[n]+=depthelev;
     }
-    fclose(ifile);
-    // interpolate subcell depth
-    ncount=grid->Nc*(grid->maxfaces-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
-    Interp(xd,yd,d,Nd,&(subgrid->xp[0]), &(subgrid->yp[0]),&(subgrid->dp[0]),ncount,grid->maxfaces);
 
     for(nc=0;nc<grid->Nc;nc++){
       ncount=(grid->nfaces[nc]-2)*(subgrid->segN+1)*(subgrid->segN+2)/2;
@@ -1074,9 +1145,7 @@ void InterpolateSubgridDepth(gridT *grid, physT *phys, propT *prop, int myproc,i
       }
     }
 
-    // interpolate subedge depth
     ncount=grid->Ne*(subgrid->segN+1);
-    Interp(xd,yd,d,Nd,&(subgrid->xpe[0]), &(subgrid->ype[0]),&(subgrid->dpe[0]),ncount,grid->maxfaces);
 
     for(n=0;n<ncount;n++)
     {
@@ -1808,6 +1877,373 @@ void CalculateVolumeProfile(gridT *grid, int myproc)
   }
 }
 
+/*
+ * Function: PchipSlopes
+ * Usage: PchipSlopes(x,y,d,n);
+ * ----------------------------
+ * Slopes d of the monotone piecewise cubic Hermite (PCHIP) interpolant of
+ * the n points (x,y) with the weighted harmonic mean of Fritsch and Butland
+ * at interior points and the shape-preserving three-point formula at the
+ * ends, so that the curve is monotone wherever the data are.
+ *
+ */
+static void PchipSlopes(REAL *x, REAL *y, REAL *d, int n)
+{
+  int k;
+  REAL h0, h1, del0, del1, w1, w2;
+
+  if(n==1) {
+    d[0]=0;
+    return;
+  }
+  if(n==2) {
+    d[0]=d[1]=(y[1]-y[0])/(x[1]-x[0]);
+    return;
+  }
+
+  for(k=1;k<n-1;k++) {
+    h0=x[k]-x[k-1];
+    h1=x[k+1]-x[k];
+    del0=(y[k]-y[k-1])/h0;
+    del1=(y[k+1]-y[k])/h1;
+    if(del0*del1<=0)
+      d[k]=0;
+    else {
+      w1=2*h1+h0;
+      w2=h1+2*h0;
+      d[k]=(w1+w2)/(w1/del0+w2/del1);
+    }
+  }
+
+  // ends
+  h0=x[1]-x[0];
+  h1=x[2]-x[1];
+  del0=(y[1]-y[0])/h0;
+  del1=(y[2]-y[1])/h1;
+  d[0]=((2*h0+h1)*del0-h0*del1)/(h0+h1);
+  if(d[0]*del0<=0)
+    d[0]=0;
+  else if(del0*del1<=0 && fabs(d[0])>fabs(3*del0))
+    d[0]=3*del0;
+
+  h0=x[n-1]-x[n-2];
+  h1=x[n-2]-x[n-3];
+  del0=(y[n-1]-y[n-2])/h0;
+  del1=(y[n-2]-y[n-3])/h1;
+  d[n-1]=((2*h0+h1)*del0-h0*del1)/(h0+h1);
+  if(d[n-1]*del0<=0)
+    d[n-1]=0;
+  else if(del0*del1<=0 && fabs(d[n-1])>fabs(3*del0))
+    d[n-1]=3*del0;
+}
+
+/*
+ * Function: PchipInterval
+ * Usage: i=PchipInterval(x,n,xi);
+ * -------------------------------
+ * Binary search for the interval x[i]<=xi<x[i+1] of the n>=2 increasing
+ * breakpoints x, for x[0]<=xi<x[n-1].
+ *
+ */
+static int PchipInterval(REAL *x, int n, REAL xi)
+{
+  int lo=0, hi=n-1, mid;
+
+  while(hi-lo>1) {
+    mid=(lo+hi)/2;
+    if(xi<x[mid])
+      hi=mid;
+    else
+      lo=mid;
+  }
+  return lo;
+}
+
+/*
+ * Function: PchipValue
+ * Usage: y=PchipValue(x,y,d,i,xi,&dy);
+ * ------------------------------------
+ * Value and slope dy of the cubic Hermite curve with values y and slopes d
+ * at xi in the interval x[i]<=xi<=x[i+1].
+ *
+ */
+static REAL PchipValue(REAL *x, REAL *y, REAL *d, int i, REAL xi, REAL *dy)
+{
+  REAL dx=x[i+1]-x[i], s=(xi-x[i])/dx, s1=1-s;
+
+  *dy=(6*s*s1*(y[i+1]-y[i])/dx+d[i]*s1*(1-3*s)+d[i+1]*s*(3*s-2));
+  return (1+2*s)*s1*s1*y[i]+s*s1*s1*dx*d[i]+s*s*(3-2*s)*y[i+1]+s*s*(s-1)*dx*d[i+1];
+}
+
+/*
+ * Function: PchipIntegral
+ * Usage: V=PchipIntegral(x,y,d,i,xi);
+ * -----------------------------------
+ * Integral of the cubic Hermite curve with values y and slopes d from
+ * x[i] to xi in the interval x[i]<=xi<=x[i+1].
+ *
+ */
+static REAL PchipIntegral(REAL *x, REAL *y, REAL *d, int i, REAL xi)
+{
+  REAL dx=x[i+1]-x[i], s=(xi-x[i])/dx, s2=s*s, s3=s2*s, s4=s3*s;
+
+  return dx*(y[i]*(s-s3+0.5*s4)+dx*d[i]*(0.5*s2-2.0/3.0*s3+0.25*s4)
+             +y[i+1]*(s3-0.5*s4)+dx*d[i+1]*(0.25*s4-s3/3));
+}
+
+/*
+ * Function: CellWetAreas
+ * Usage: CellWetAreas(grid,nc,h,A,nh);
+ * ------------------------------------
+ * Wet area A[0][j] of cell nc at the nh values h[j], as computed by
+ * CalculateWetArea.  With subgridmeth=1 the sub-cells are visited once for
+ * all of the values of h, and the wet fraction of a sub-cell with sorted
+ * depths d1<=d2<=d3 is the quadratic of u=h+d3 clipped to [0,d3-d1] on
+ * either side of d3-d2, which is evaluated without branches.
+ *
+ */
+static void CellWetAreas(gridT *grid, int nc, REAL *h, REAL **A, int nh)
+{
+  int i, j, N=subgrid->segN, ntotal, base, nfaces=grid->nfaces[nc], maxfaces=grid->maxfaces;
+  REAL ac1, d3, a, b, ia, ib, u, f, *Ac=A[0];
+
+  if(subgrid->meth!=1) {
+    for(j=0;j<nh;j++)
+      Ac[j]=CalculateWetArea(nc,nfaces,maxfaces,h[j]);
+  } else {
+    ntotal=(nfaces-2)*N*N;
+    base=nc*(maxfaces-2)*N*N;
+    for(j=0;j<nh;j++)
+      Ac[j]=0;
+
+    for(i=0;i<ntotal;i++) {
+      ac1=subgrid->Acbackup[nc]/N/N*subgrid->Acratio[nc*(maxfaces-2)+i/(N*N)];
+      d3=subgrid->d3[base+i];
+      a=d3-subgrid->d2[base+i];
+      b=d3-subgrid->d1[base+i];
+      ia=(a>0)?1/(a*b):0;
+      ib=(b>a)?1/(b*(b-a)):0;
+      for(j=0;j<nh;j++) {
+        u=Min(Max(h[j]+d3,0),b);
+        f=(u<a)?u*u*ia:1-(b-u)*(b-u)*ib;
+        f=(b>0)?f:((h[j]+d3>=0)?1:0);
+        Ac[j]+=ac1*f;
+      }
+    }
+  }
+
+  for(j=0;j<nh;j++)
+    if(Ac[j]>subgrid->Acbackup[nc])
+      Ac[j]=subgrid->Acbackup[nc];
+}
+
+/*
+ * Function: EdgeFluxHeights
+ * Usage: EdgeFluxHeights(grid,ne,h,y,nh);
+ * ---------------------------------------
+ * Flux height y[0][j] and wetted perimeter y[1][j] of edge ne at the nh
+ * values h[j].
+ *
+ */
+static void EdgeFluxHeights(gridT *grid, int ne, REAL *h, REAL **y, int nh)
+{
+  int j;
+
+  for(j=0;j<nh;j++) {
+    y[0][j]=CalculateFluxHeight(ne,h[j]);
+    y[1][j]=CalculateWetperimeter(ne,h[j]);
+  }
+}
+
+/*
+ * Function: CompareErrors
+ * Usage: qsort(err,N,sizeof(REAL),CompareErrors);
+ * -----------------------------------------------
+ * Sort interpolation errors in decreasing order.
+ *
+ */
+static int CompareErrors(const void *a, const void *b)
+{
+  REAL ea=*(const REAL *)a, eb=*(const REAL *)b;
+
+  return (ea<eb)-(ea>eb);
+}
+
+/*
+ * Function: AdaptiveProfile
+ * Usage: N=AdaptiveProfile(grid,n,hlo,hhi,ny,h,y,d,nmax,work,func);
+ * ------------------------------------------------------------------
+ * Place at most nmax breakpoints h in [hlo,hhi] for the ny<=2 monotone curves
+ * y[m](h) of cell or edge n, whose exact values are computed by func, and
+ * return their number.  work holds 5*nmax values.  Starting from three uniform breakpoints, the
+ * midpoint of every interval in which a PCHIP curve through the breakpoints
+ * misses the exact value by more than proftol times the largest value of the
+ * curve is added until no interval does.  When there are more such intervals
+ * than room, the worst ones are split.  On return d[m] holds the PCHIP slopes.
+ *
+ */
+static int AdaptiveProfile(gridT *grid, int n, REAL hlo, REAL hhi, int ny, REAL *h, REAL **y, REAL **d,
+    int nmax, REAL *work, void (*func)(gridT *, int, REAL *, REAL **, int))
+{
+  int i, j, k, m, N, nadd, room;
+  REAL dy, err, scale, threshold, *hm=work, *errs=work+nmax, *sorted=work+2*nmax, *ym[2];
+
+  ym[0]=work+3*nmax;
+  ym[1]=work+4*nmax;
+
+  if(hhi<=hlo) {
+    h[0]=hlo;
+    func(grid,n,h,y,1);
+    for(m=0;m<ny;m++)
+      d[m][0]=0;
+    return 1;
+  }
+
+  N=(nmax>=3)?3:2;
+  for(j=0;j<N;j++)
+    h[j]=hlo+(hhi-hlo)*j/(N-1);
+  h[N-1]=hhi;
+  func(grid,n,h,y,N);
+
+  while(1) {
+    for(m=0;m<ny;m++)
+      PchipSlopes(h,y[m],d[m],N);
+    if(N==nmax)
+      break;
+
+    for(j=0;j<N-1;j++)
+      hm[j]=0.5*(h[j]+h[j+1]);
+    func(grid,n,hm,ym,N-1);
+
+    // largest error of the curves relative to their largest values
+    nadd=0;
+    for(j=0;j<N-1;j++) {
+      errs[j]=0;
+      for(m=0;m<ny;m++) {
+        scale=fabs(y[m][N-1]);
+        if(scale>0) {
+          err=fabs(PchipValue(h,y[m],d[m],j,hm[j],&dy)-ym[m][j])/scale;
+          if(err>errs[j])
+            errs[j]=err;
+        }
+      }
+      if(errs[j]>subgrid->proftol)
+        nadd++;
+    }
+    if(nadd==0)
+      break;
+
+    // split only the worst intervals if there is not room for all of them
+    room=nmax-N;
+    threshold=subgrid->proftol;
+    if(nadd>room) {
+      for(j=0;j<N-1;j++)
+        sorted[j]=errs[j];
+      qsort(sorted,N-1,sizeof(REAL),CompareErrors);
+      threshold=sorted[room-1];
+    }
+
+    // merge the midpoints of the split intervals from the end
+    nadd=0;
+    for(j=0;j<N-1;j++)
+      if(errs[j]>subgrid->proftol && errs[j]>=threshold && nadd<room) {
+        errs[j]=1;
+        nadd++;
+      } else
+        errs[j]=0;
+    k=N-1+nadd;
+    for(i=N-1;i>=0;i--) {
+      h[k]=h[i];
+      for(m=0;m<ny;m++)
+        y[m][k]=y[m][i];
+      k--;
+      if(i>0 && errs[i-1]>0) {
+        h[k]=hm[i-1];
+        for(m=0;m<ny;m++)
+          y[m][k]=ym[m][i-1];
+        k--;
+      }
+    }
+    N+=nadd;
+  }
+  return N;
+}
+
+/*
+ * Function: CalculateMonotoneProfiles
+ * Usage: CalculateMonotoneProfiles(grid,myproc);
+ * ----------------------------------------------
+ * With subgridprof=1, replace the linear profiles of CalculateAcProfile,
+ * CalculateVolumeProfile, CalculateFluxHeightProfile and
+ * CalculateWetperimeterProfile by PCHIP curves on adaptive breakpoints in
+ * the range of h from CalculateHProfile.  The Ac curve is exact at the
+ * breakpoints and Vprof is its analytic integral, so that dV/dh=Aceff
+ * exactly.  The arrays keep their disN+1 entries per cell and edge, and the
+ * entries beyond nprof and nprofe repeat the last breakpoint.
+ *
+ */
+void CalculateMonotoneProfiles(gridT *grid, int myproc)
+{
+  int i, nc, ne, N, base, nmax=subgrid->disN+1, Ntotal=0;
+  REAL *y[2], *d[2], *work;
+
+  work=(REAL *)SunMalloc(5*nmax*sizeof(REAL),"CalculateMonotoneProfiles");
+
+  for(nc=0;nc<grid->Nc;nc++) {
+    base=nc*nmax;
+    y[0]=subgrid->Acprof+base;
+    d[0]=subgrid->dAcprof+base;
+    N=AdaptiveProfile(grid,nc,subgrid->hprof[base],subgrid->hprof[base+subgrid->disN],1,
+        subgrid->hprof+base,y,d,nmax,work,CellWetAreas);
+    subgrid->Acprof[base+N-1]=subgrid->Acbackup[nc];
+    if(N>1)
+      PchipSlopes(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,N);
+
+    subgrid->Vprof[base]=0;
+    for(i=1;i<N;i++)
+      subgrid->Vprof[base+i]=subgrid->Vprof[base+i-1]+
+        PchipIntegral(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i-1,subgrid->hprof[base+i]);
+
+    for(i=N;i<nmax;i++) {
+      subgrid->hprof[base+i]=subgrid->hprof[base+N-1];
+      subgrid->Acprof[base+i]=subgrid->Acprof[base+N-1];
+      subgrid->Vprof[base+i]=subgrid->Vprof[base+N-1];
+      subgrid->dAcprof[base+i]=0;
+    }
+    subgrid->nprof[nc]=N;
+    Ntotal+=N;
+  }
+
+  for(ne=0;ne<grid->Ne;ne++) {
+    base=ne*nmax;
+    y[0]=subgrid->fluxhprof+base;
+    y[1]=subgrid->Wetperiprof+base;
+    d[0]=subgrid->dfluxhprof+base;
+    d[1]=subgrid->dWetperiprof+base;
+    N=AdaptiveProfile(grid,ne,subgrid->hprofe[base],subgrid->hprofe[base+subgrid->disN],2,
+        subgrid->hprofe+base,y,d,nmax,work,EdgeFluxHeights);
+    if(subgrid->Wetperiprof[base+N-1]<grid->df[ne]) {
+      subgrid->Wetperiprof[base+N-1]=grid->df[ne];
+      if(N>1)
+        PchipSlopes(subgrid->hprofe+base,subgrid->Wetperiprof+base,subgrid->dWetperiprof+base,N);
+    }
+
+    for(i=N;i<nmax;i++) {
+      subgrid->hprofe[base+i]=subgrid->hprofe[base+N-1];
+      subgrid->fluxhprof[base+i]=subgrid->fluxhprof[base+N-1];
+      subgrid->Wetperiprof[base+i]=subgrid->Wetperiprof[base+N-1];
+      subgrid->dfluxhprof[base+i]=0;
+      subgrid->dWetperiprof[base+i]=0;
+    }
+    subgrid->nprofe[ne]=N;
+  }
+
+  SunFree(work,5*nmax*sizeof(REAL),"CalculateMonotoneProfiles");
+  if(myproc==0)
+    printf("Monotone subgrid profiles with %.1f breakpoints per cell on average (disN+1=%d)\n",
+        (REAL)Ntotal/Max(grid->Nc,1),nmax);
+}
+
 /*
  * Function: SubgridCheck
  * Usage: check whether nan happens for subgrid method
@@ -1914,6 +2350,45 @@ void SubgridBasic(gridT *grid, physT *phys, propT *prop, int myproc, int numproc
   //open subgrid outputfiles
   OpenSubgridFiles(prop->computeSediments,prop->mergeArrays,myproc);
 
+  // subcells, depths and profiles
+  SubgridGeometry(grid,phys,prop,myproc,numprocs,comm);
+  
+  if(myproc==0)
+    printf("finish subgrid basic module preparation\n");
+}
+
+/*
+ * Function: SubgridRepartition
+ * Usage: SubgridRepartition(grid,phys,prop,oldsubgrid,myproc,numprocs,comm);
+ * --------------------------------------------------------------------------
+ * Create the subgrid model on the repartitioned grid with the parameters and
+ * the output files of oldsubgrid, and compute its subcells, depths and profiles
+ * as in a restart.  The effective areas and volumes of oldsubgrid must be
+ * transferred by the caller (see MigrateSubgrid in rebalance.c), which then
+ * frees it with FreeSubgrid.
+ *
+ */
+void SubgridRepartition(gridT *grid, physT *phys, propT *prop, subgridT *oldsubgrid, int myproc,
+			int numprocs, MPI_Comm comm)
+{
+  subgrid=(subgridT *)SunMalloc(sizeof(subgridT),"SubgridRepartition");
+  *subgrid=*oldsubgrid;
+
+  AllocateandInitializeSubgrid(grid, prop, myproc);
+  SubgridGeometry(grid,phys,prop,myproc,numprocs,comm);
+}
+
+/*
+ * Function: SubgridGeometry
+ * Usage: SubgridGeometry(grid,phys,prop,myproc,numprocs,comm);
+ * ------------------------------------------------------------
+ * Compute the subcells and subedges of the local grid, interpolate their depths
+ * and compute the wet area, volume, flux height and wet perimeter profiles,
+ * which do not change during the run.
+ *
+ */
+static void SubgridGeometry(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm)
+{
   // calculate all the x y for subcell and subedege
   CalculateSubgridXY(grid, myproc);
 
@@ -1929,17 +2404,22 @@ void SubgridBasic(gridT *grid, physT *phys, propT *prop, int myproc, int numproc
   // calculate the Area ratio between different sub triangles for each cell A_sub/Ac
   CalculateAreaRatio(grid, myproc);
   
-  // calculate the wet area profile for future use
-  CalculateAcProfile(grid, myproc);
+  if(subgrid->prof) {
+    // monotone cubic wet area, volume, flux height and wet perimeter profiles
+    CalculateMonotoneProfiles(grid, myproc);
+  } else {
+    // calculate the wet area profile for future use
+    CalculateAcProfile(grid, myproc);
 
-  // calculate the cell volume profile for future use
-  CalculateVolumeProfile(grid, myproc);
+    // calculate the cell volume profile for future use
+    CalculateVolumeProfile(grid, myproc);
 
-  // calculate the edge flux height profile for future use
-  CalculateFluxHeightProfile(grid, myproc);
+    // calculate the edge flux height profile for future use
+    CalculateFluxHeightProfile(grid, myproc);
   
-  // calculate wet perimeter profile for the last layer
-  CalculateWetperimeterProfile(grid,myproc);
+    // calculate wet perimeter profile for the last layer
+    CalculateWetperimeterProfile(grid,myproc);
+  }
 
   // calculate subgrid marsh setup for all subcell and subedge
   if(prop->marshmodel && subgrid->dragpara)
@@ -1953,9 +2433,6 @@ void SubgridBasic(gridT *grid, physT *phys, propT *prop, int myproc, int numproc
   
   // output subgrid for test
   OutputSubgrid(grid,phys,prop,myproc,numprocs,comm);
-  
-  if(myproc==0)
-    printf("finish subgrid basic module preparation\n");
 }
 
 /*
@@ -1992,10 +2469,24 @@ void UpdateSubgridVeff(gridT *grid, physT *phys, propT *prop, int myproc)
  */
 REAL UpdateVeff(int nc, REAL h)
 {
-  int  i,base;
+  int  i,base,N;
   REAL dh,V,dV,dac,ac;
 
   base=nc*(subgrid->disN+1); 
+  if(subgrid->prof) {
+    // analytic integral of the monotone cubic Ac profile
+    N=subgrid->nprof[nc];
+    if(h<subgrid->hprof[base])
+      V=0;
+    else if(h>=subgrid->hprof[base+N-1])
+      V=subgrid->Vprof[base+N-1]+(h-subgrid->hprof[base+N-1])*subgrid->Acbackup[nc];
+    else {
+      i=PchipInterval(subgrid->hprof+base,N,h);
+      V=subgrid->Vprof[base+i]+PchipIntegral(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i,h);
+    }
+    return V;
+  }
+
   if(h<subgrid->hprof[base])
     V=0;
   else if(h>=subgrid->hprof[base+subgrid->disN])
@@ -2027,10 +2518,40 @@ REAL UpdateVeff(int nc, REAL h)
  */
 REAL UpdateFreeSurface(int nc, REAL V)
 {
-  int  i,base;
-  REAL dh,h,dV,dac,ac,temp;
+  int  i,base,N,iter;
+  REAL dh,h,dV,dac,ac,temp,hlo,hhi,hnew;
 
   base=nc*(subgrid->disN+1); 
+  if(subgrid->prof) {
+    // invert the analytic volume with Newton's method and dV/dh=Ac, safeguarded by
+    // bisection in the interval of the breakpoints that contains V
+    N=subgrid->nprof[nc];
+    if(V<=0)
+      return subgrid->hprof[base];
+    if(V>=subgrid->Vprof[base+N-1])
+      return subgrid->hprof[base+N-1]+(V-subgrid->Vprof[base+N-1])/subgrid->Acbackup[nc];
+    i=PchipInterval(subgrid->Vprof+base,N,V);
+    hlo=subgrid->hprof[base+i];
+    hhi=subgrid->hprof[base+i+1];
+    h=hlo+(V-subgrid->Vprof[base+i])/(subgrid->Vprof[base+i+1]-subgrid->Vprof[base+i])*(hhi-hlo);
+    for(iter=0;iter<50;iter++) {
+      dV=subgrid->Vprof[base+i]+PchipIntegral(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i,h)-V;
+      if(dV>0)
+        hhi=h;
+      else
+        hlo=h;
+      ac=PchipValue(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i,h,&dac);
+      hnew=(ac>0)?h-dV/ac:hlo;
+      if(hnew<=hlo || hnew>=hhi)
+        hnew=0.5*(hlo+hhi);
+      dh=fabs(hnew-h);
+      h=hnew;
+      if(dh<=1e-12*(subgrid->hprof[base+i+1]-subgrid->hprof[base+i]))
+        break;
+    }
+    return h;
+  }
+
   if(V==0)
     h=subgrid->hprof[base];
   else if(V>=subgrid->Vprof[base+subgrid->disN])
@@ -2173,10 +2694,23 @@ void SubgridCulverttopArea(gridT *grid, propT *prop, int myproc)
  */
 REAL UpdateAceff(int nc, REAL h)
 {
-  int i, base;
+  int i, base, N;
   REAL dh,Ac,dac;
    
   base=nc*(subgrid->disN+1);
+
+  if(subgrid->prof) {
+    N=subgrid->nprof[nc];
+    if(h<subgrid->hprof[base])
+      Ac=0;
+    else if(h>=subgrid->hprof[base+N-1])
+      Ac=subgrid->Acbackup[nc];
+    else {
+      i=PchipInterval(subgrid->hprof+base,N,h);
+      Ac=PchipValue(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i,h,&dac);
+    }
+    return Ac;
+  }
     
   if(h<subgrid->hprof[base])
     Ac=0;
@@ -2198,6 +2732,36 @@ REAL UpdateAceff(int nc, REAL h)
   return Ac;
 }
 
+/*
+ * Function: UpdateDAceff
+ * Usage: dAdh=UpdateDAceff(nc,h);
+ * -------------------------------
+ * The derivative dAc/dh of the wet area profile of cell nc at h, which is the
+ * analytic slope of the monotone cubic profile with subgridprof=1 and the
+ * slope of the linear segment otherwise.  It is zero outside of the profile.
+ * Together with dV/dh=UpdateAceff it gives the second-order terms of Newton
+ * iterations for the free surface.
+ *
+ */
+REAL UpdateDAceff(int nc, REAL h)
+{
+  int i, base, N;
+  REAL dAdh;
+
+  base=nc*(subgrid->disN+1);
+  N=subgrid->prof ? subgrid->nprof[nc] : subgrid->disN+1;
+
+  if(h<subgrid->hprof[base] || h>=subgrid->hprof[base+N-1])
+    return 0;
+  
+  i=PchipInterval(subgrid->hprof+base,N,h);
+  if(subgrid->prof)
+    PchipValue(subgrid->hprof+base,subgrid->Acprof+base,subgrid->dAcprof+base,i,h,&dAdh);
+  else
+    dAdh=(subgrid->Acprof[base+i+1]-subgrid->Acprof[base+i])/(subgrid->hprof[base+i+1]-subgrid->hprof[base+i]);
+  return dAdh;
+}
+
 /*
  * Function: UpdateSubgridVerticalAceff
  * Usage: update vertical Aceff for each cell and layer to represent the change of wet area
@@ -2479,9 +3043,22 @@ void UpdateSubgridFluxHeight(gridT *grid, physT *phys, propT *prop, int myproc)
  */
 REAL UpdateFluxHeight(int ne, REAL h)
 {
-  int base,i;
+  int base,i,N;
   REAL fh,dh,dfh;
   base=ne*(subgrid->disN+1); 
+
+  if(subgrid->prof) {
+    N=subgrid->nprofe[ne];
+    if(h<subgrid->hprofe[base])
+      fh=0;
+    else if(h>=subgrid->hprofe[base+N-1])
+      fh=subgrid->fluxhprof[base+N-1]+h-subgrid->hprofe[base+N-1];
+    else {
+      i=PchipInterval(subgrid->hprofe+base,N,h);
+      fh=PchipValue(subgrid->hprofe+base,subgrid->fluxhprof+base,subgrid->dfluxhprof+base,i,h,&dfh);
+    }
+    return fh;
+  }
    
   if(h<subgrid->hprofe[base])
   {
@@ -2515,9 +3092,22 @@ REAL UpdateFluxHeight(int ne, REAL h)
  */
 REAL UpdateWetperi(int ne, REAL h)
 {
-  int base,i;
+  int base,i,N;
   REAL fh,dh,dfh;
   base=ne*(subgrid->disN+1); 
+
+  if(subgrid->prof) {
+    N=subgrid->nprofe[ne];
+    if(h<subgrid->hprofe[base])
+      fh=0;
+    else if(h>=subgrid->hprofe[base+N-1])
+      fh=subgrid->Wetperiprof[base+N-1];
+    else {
+      i=PchipInterval(subgrid->hprofe+base,N,h);
+      fh=PchipValue(subgrid->hprofe+base,subgrid->Wetperiprof+base,subgrid->dWetperiprof+base,i,h,&dfh);
+    }
+    return fh;
+  }
    
   if(h<subgrid->hprofe[base])
   {
@@ -2917,16 +3507,15 @@ void UpdateSubgridHeff(gridT *grid, physT *phys, propT *prop, int myproc)
  * use derived parameterization
  * ----------------------------------------------------
  * Can only be used for grid->Nkmax=1
+ * The erosion rates use the layer parameters of BedLayerParameters in
+ * sediments.c, with one exponential per sub cell for all of the fractions
+ * and soft layers.
  */
 void CalculateSubgridActiveErosion(gridT *grid, physT *phys, propT *prop, int myproc)
 {
-  REAL utmp,ratio, em, alpha, erosionmax, nettmp; 
+  REAL utmp, erosionmax, ex, e; 
   REAL taubtmp2, taubtmp1, epslon, taub, taub0, max, mean, Hmean,taub1;
-  int i,j,k,l,base,ntotal,n; 
-  // coefficient for hard erosion
-  em=1.0;
-  // coefficient for soft erosion
-  alpha=4.2;  // 4.2 to 25.6 according to MIKE21
+  int i,j,k,l,m,base,ntotal,n,Nlayer=sediments->Nlayer; 
   
   // calculate taub for each sub cell
   for(j=0;j<grid->Nc;j++)
@@ -3007,66 +3596,49 @@ void CalculateSubgridActiveErosion(gridT *grid, physT *phys, propT *prop, int my
     }
   } 
 
-  for(i=0;i<sediments->Nsize;i++)
+  for(j=0;j<grid->Nc;j++)
   {
-    for(j=0;j<grid->Nc;j++)
-    {
-      base=j*(grid->maxfaces-2)*subgrid->segN*subgrid->segN;
-      ntotal=(grid->nfaces[j]-2)*subgrid->segN*subgrid->segN;
-      erosionmax=0;
-      // calculate erosion for each layer
-      for(k=0;k<sediments->Nlayer;k++)
+    base=j*(grid->maxfaces-2)*subgrid->segN*subgrid->segN;
+    ntotal=(grid->nfaces[j]-2)*subgrid->segN*subgrid->segN;
+    for(i=0;i<sediments->Nsize;i++)
+      for(k=0;k<Nlayer;k++)
       {
-        erosionmax=sediments->Layerthickness[i][j][k]*sediments->Drydensity[i][k]*subgrid->Asedi[j]/grid->Ac[j]/prop->dt;
         sediments->Erosion_old[i][j][k]=sediments->Erosion[i][j][k];
         sediments->Erosion[i][j][k]=0.0;
-        n=0;
-        // only calculate when the mean bottom shear stress >0
-        if(sediments->Seditbmax[j]>sediments->Taue[i][k])
-          for(l=0;l<ntotal;l++)
-          {
-            if(subgrid->taubsub[base+l]>sediments->Taue[i][k])
-            {
-              n++;
-              if(sediments->Softhard[k]==0){
-                // soft erosion
-                sediments->Erosion[i][j][k]+=subgrid->A_sub[base+l]*sediments->E0[i][k]*
-                  exp(alpha*(subgrid->taubsub[base+l]-sediments->Taue[i][k]));
-              } else {
-                // hard erosion
-                ratio=subgrid->taubsub[base+l]/sediments->Taue[i][k]-1;
-                sediments->Erosion[i][j][k]+=subgrid->A_sub[base+l]*
-                  sediments->E0[i][k]*pow(ratio,em);
-              }               
-            }
-          }
+      }
 
-        // check the total mass for each layer
-        if(n==0)
-          sediments->Erosion[i][j][k]=0.0;
-        else
-          sediments->Erosion[i][j][k]/=subgrid->Asedi[j];
+    // sum the erosion of the sub cells for each layer
+    for(l=0;l<ntotal;l++)
+    {
+      taub=subgrid->taubsub[base+l];
+      if(taub<=0)
+        continue;
+      ex=exp(ESOFT*taub);
+      for(i=0;i<sediments->Nsize;i++)
+        for(k=0;k<Nlayer;k++)
+        {
+          m=i*Nlayer+k;
+          e=sediments->Bedsoft[m] ? sediments->Bedesoft[m]*ex : sediments->E0[i][k]*(taub*sediments->Bedinvtaue[m]-1);
+          if(taub>sediments->Bedtaue[m])
+            sediments->Erosion[i][j][k]+=subgrid->A_sub[base+l]*e;
+        }
+    }
 
+    // check the total mass for each layer
+    for(i=0;i<sediments->Nsize;i++)
+    {
+      for(k=0;k<Nlayer;k++)
+      {
+        m=i*Nlayer+k;
+        erosionmax=(sediments->Layerthickness[i][j][k]+sediments->morfac*sediments->Bedflux[i][j][k]*sediments->Bedinvrho[m])*
+          sediments->Bedmmax[m]/prop->dt*subgrid->Asedi[j]/grid->Ac[j];
+        if(sediments->Erosion[i][j][k]>0)
+          sediments->Erosion[i][j][k]/=subgrid->Asedi[j];
         if(sediments->Erosion[i][j][k]>erosionmax)
           sediments->Erosion[i][j][k]=erosionmax; 
-
-        if(sediments->bedComplex==1){
-          nettmp=0;
-          //assume last layer cannot be flushed away
-          for(k=sediments->Nlayer-2;k>0;k--){
-            nettmp=sediments->Layerthickness[i][j][k]*sediments->Drydensity[i][k]/prop->dt-sediments->Erosion[i][j][k]+sediments->Erosion[i][j][k+1]+sediments->Consolid[k-1]-sediments->Consolid[k]; //here can use theta method.
-            if(nettmp<0)
-              sediments->Erosion[i][j][k]+=nettmp;
-          }
-
-          // calculate erosion limit for the first layer
-          nettmp=0;
-          if(sediments->Nlayer>1)
-            nettmp=sediments->Layerthickness[i][j][0]*sediments->Drydensity[i][0]/prop->dt-sediments->Erosion[i][j][0]+sediments->Erosion[i][j][1]+sediments->Deposition[i][j]-sediments->Consolid[0];
-          if(nettmp<0)   
-            sediments->Erosion[i][j][0]+=nettmp; 
-        }  
       }
+      if(sediments->bedComplex==1)
+        LimitBedErosion(i,j,1/prop->dt);
     }
   }
 }
@@ -3337,73 +3909,92 @@ void CalculateSubgridCdmean(gridT *grid, physT *phys, propT *prop)
 
 /*
  * Function: FreeSubgrid
- * Usage: free space for all the variables
- * ----------------------------------------------------
- * Basic sunfree function
+ * Usage: FreeSubgrid(oldsubgrid,grid,prop,myproc);
+ * ------------------------------------------------
+ * Free the subgrid model s that was allocated on grid by
+ * AllocateandInitializeSubgrid.  The output files are not closed.
  *
  */
-void FreeSubgrid(gridT *grid, int myproc) {
-  int i,j;
-  free(subgrid->xp);
-  free(subgrid->yp);
-  free(subgrid->dp);
-  free(subgrid->dc);
-  free(subgrid->varNc);
-  free(subgrid->rhs);
-  free(subgrid->residual);
-  free(subgrid->d1);
-  free(subgrid->H_sub);
-  free(subgrid->A_sub);
-  free(subgrid->d2);
-  free(subgrid->d3);
-  free(subgrid->hmarshpe);
-  free(subgrid->hmarshe);
-  free(subgrid->de);
-  free(subgrid->dpe);
-  free(subgrid->hmarshp);
-  free(subgrid->hmarshc);
-  free(subgrid->he);
-  free(subgrid->hprof);
-  free(subgrid->hprofe);
-  free(subgrid->hmin);
-  free(subgrid->hmax);
-  free(subgrid->Vprof);
-  free(subgrid->Acprof);
-  free(subgrid->Wetperiprof);
-  free(subgrid->Acbackup);
-  free(subgrid->Aceff);
-  //free(subgrid->Cdmean);
-  free(subgrid->Cdratio);
-  free(subgrid->taubsub);
-  //free(subgrid->delta);
-  free(subgrid->Aceffold);
-  free(subgrid->Heff);
-  free(subgrid->Heffold);
-  free(subgrid->Acwet);
-  free(subgrid->Veff);
-  //free(subgrid->Vsedi);
-  //free(subgrid->Asedi);
-  free(subgrid->Veffold);
-  free(subgrid->dzboteff);
-  free(subgrid->fluxhprof);
-  free(subgrid->cellp);
-  for(i=0;i<grid->Nc;i++)
-  {
-    free(subgrid->Acceff[i]);
-    free(subgrid->fluxp[i]);
-    free(subgrid->fluxn[i]);
-    free(subgrid->Acceffold[i]);
-    free(subgrid->Acveff[i]);
-    free(subgrid->Acveffold[i]);
-    free(subgrid->Acveffold2[i]);
-  } 
-  free(subgrid->fluxn);
-  free(subgrid->fluxp);  
-  free(subgrid->Acceffold);
-  free(subgrid->Acceff);
-  free(subgrid->Acveffold);
-  free(subgrid->Acveffold2);
-  free(subgrid->Acveff);
+void FreeSubgrid(subgridT *s, gridT *grid, propT *prop, int myproc) {
+  int i, n, N=grid->Nc*(grid->maxfaces-2), Np, Nsub, Npe, Nse, Nc1, Ne1;
+  REAL **cellarrays[] = {s->Acceff,s->Acceffold,s->fluxp,s->fluxn},
+    **toparrays[] = {s->Acveff,s->Acveffold,s->Acveffold2},
+    *cells[] = {s->hmin,s->hmax,s->hiter,s->hiter_min,s->Acbackup,s->Acwet,s->varNc,s->rhs,
+		s->residual,s->Verr,s->Aceff,s->Aceffold,s->Heff,s->Heffold,s->Veff,s->Veffold};
+
+  Np=N*(s->segN+1)*(s->segN+2)/2;
+  Nsub=N*s->segN*s->segN;
+  Npe=grid->Ne*(s->segN+1);
+  Nse=grid->Ne*s->segN;
+  Nc1=grid->Nc*(s->disN+1);
+  Ne1=grid->Ne*(s->disN+1);
+
+  SunFree(s->xp,Np*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->yp,Np*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->dp,Np*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->dc,Nsub*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->d1,Nsub*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->d2,Nsub*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->d3,Nsub*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->H_sub,Nsub*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->A_sub,Nsub*sizeof(REAL),"FreeSubgrid");
+  if(s->erosionpara) {
+    SunFree(s->Cdratio,Nsub*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->taubsub,Nsub*sizeof(REAL),"FreeSubgrid");
+  }
+  SunFree(s->xpe,Npe*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->ype,Npe*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->dpe,Npe*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->de,Nse*sizeof(REAL),"FreeSubgrid");
+  if(prop->marshmodel) {
+    SunFree(s->hmarshp,Np*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->cdvp,Np*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->hmarshc,Nsub*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->cdvc,Nsub*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->hmarshpe,Npe*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->cdvpe,Npe*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->hmarshe,Nse*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->cdve,Nse*sizeof(REAL),"FreeSubgrid");
+  }
+  SunFree(s->cellp,3*Nsub*sizeof(int),"FreeSubgrid");
+  SunFree(s->he,grid->Ne*sizeof(REAL),"FreeSubgrid");
+
+  SunFree(s->hprof,Nc1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->Vprof,Nc1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->Acprof,Nc1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->fluxhprof,Ne1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->hprofe,Ne1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->Wetperiprof,Ne1*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->dzboteff,grid->Ne*sizeof(REAL),"FreeSubgrid");
+  if(s->prof) {
+    SunFree(s->dAcprof,Nc1*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->dfluxhprof,Ne1*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->dWetperiprof,Ne1*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->nprof,grid->Nc*sizeof(int),"FreeSubgrid");
+    SunFree(s->nprofe,grid->Ne*sizeof(int),"FreeSubgrid");
+  }
+
+  for(i=0;i<(int)(sizeof(cells)/sizeof(REAL *));i++)
+    SunFree(cells[i],grid->Nc*sizeof(REAL),"FreeSubgrid");
+  SunFree(s->Acratio,(grid->maxfaces-2)*grid->Nc*sizeof(REAL),"FreeSubgrid");
+  if(prop->computeSediments) {
+    SunFree(s->Asedi,grid->Nc*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->Vsedi,grid->Nc*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->delta,grid->Nc*sizeof(REAL),"FreeSubgrid");
+    SunFree(s->Cdmean,grid->Nc*sizeof(REAL),"FreeSubgrid");
+  }
+
+  for(i=0;i<grid->Nc;i++) {
+    for(n=0;n<(int)(sizeof(cellarrays)/sizeof(REAL **));n++)
+      SunFree(cellarrays[n][i],grid->Nk[i]*sizeof(REAL),"FreeSubgrid");
+    for(n=0;n<(int)(sizeof(toparrays)/sizeof(REAL **));n++)
+      SunFree(toparrays[n][i],(grid->Nk[i]+1)*sizeof(REAL),"FreeSubgrid");
+  }
+  for(n=0;n<(int)(sizeof(cellarrays)/sizeof(REAL **));n++)
+    SunFree(cellarrays[n],grid->Nc*sizeof(REAL *),"FreeSubgrid");
+  for(n=0;n<(int)(sizeof(toparrays)/sizeof(REAL **));n++)
+    SunFree(toparrays[n],grid->Nc*sizeof(REAL *),"FreeSubgrid");
+  SunFree(s,sizeof(subgridT),"FreeSubgrid");
 }
 
 
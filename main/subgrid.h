@@ -54,6 +54,9 @@ REAL *varNc, // variable [Nc] to store any thing you want to output
      *Vprof, // the total volume profile for each cell [Nc*(disN+1)]
      *Acprof, // the effective wet area profile for each cell [Nc*(disN+1)]
      *Wetperiprof, // the wetted parameter for the last layer [Ne*(disN+1)]
+     *dAcprof, // the slope dAc/dh of the monotone cubic Ac profile at each breakpoint [Nc*(disN+1)]
+     *dfluxhprof, // the slope of the monotone cubic flux height profile [Ne*(disN+1)]
+     *dWetperiprof, // the slope of the monotone cubic wetted perimeter profile [Ne*(disN+1)]
      *Acbackup, // store the original cell Area [Nc]
      *Aceff,  // store the top wet area at h=phys->h[nc] to use when use iteration method 
      *Acratio, // store the ratio of Ac_subpolygon/Ac_total when nf>3 for unstructured grid [Nc*(grid->maxfaces-2)]
@@ -88,7 +91,8 @@ REAL *varNc, // variable [Nc] to store any thing you want to output
      *hiter_min, // store the iterative h for minimum residual    
      *fluxhprof; // the effective flux height profile for each cell [Ne*disN]
 
-REAL eps; // the convergence requirement for maximum residual
+REAL eps, // the convergence requirement for maximum residual
+     proftol; // the relative tolerance of the monotone cubic profiles
 
 int *cellp, // index of sub points for each subgrid [(Nc*N^2+2*Nquad*N^2)*3] (Nquad number of quad grid)
     segN, // the number of segments of each edge to generate subgrid 
@@ -99,7 +103,10 @@ int *cellp, // index of sub points for each subgrid [(Nc*N^2+2*Nquad*N^2)*3] (Nq
     hmarshint, // 1 for interpolation, 2 for user defined function
     cdvint, // 1 for interpolation, 2 for user defined function
     erosionpara, // whether to use the new method to calculate sediment erosion (1) or not(0)
-    dragpara; // whether to use the new method to calculate bottom shear stress
+    dragpara, // whether to use the new method to calculate bottom shear stress
+    prof, // 0 for linear profiles at disN+1 uniform values of h, 1 for monotone cubic profiles at adaptive breakpoints
+    *nprof, // the number of breakpoints of the profile of each cell [Nc]
+    *nprofe; // the number of breakpoints of the profile of each edge [Ne]
 
 FILE *VeffFID, *AceffFID,*AsediFID,*VsediFID, *subDepositionFID,*subErosionFID;
 } subgridT;
@@ -121,12 +128,18 @@ void StoreSubgridOldAceffandVeff(gridT *grid, int myproc);
 void SubgridCulverttopArea(gridT *grid, propT *prop, int myproc);
 void CalculateSubgridActiveErosion(gridT *grid, physT *phys, propT *prop, int myproc);
 void CalculateSubgridCdmean(gridT *grid, physT *phys, propT *prop);
-void FreeSubgrid(gridT *grid, int myproc);
-void CalculateCellSubgridXY(REAL *x, REAL *y, int n, int segN, gridT *grid, int myproc);
+void SubgridRepartition(gridT *grid, physT *phys, propT *prop, subgridT *oldsubgrid, int myproc,
+			int numprocs, MPI_Comm comm);
+void FreeSubgrid(subgridT *s, gridT *grid, propT *prop, int myproc);
+void CalculateCellSubgridXY(DREAL *x, DREAL *y, int n, int segN, gridT *grid, int myproc);
 //void SubgridCellAverageTau(gridT *grid,physT *phys,propT *prop, metT *met, int myproc, int numprocs);
 void OpenSubgridFiles(int computeSediments, int mergeArrays,int myproc);
 void OutputSubgridVariables(gridT *grid, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 void SubgridFluxCheck(gridT *grid, physT *phys, propT *prop,int myproc);
+REAL UpdateVeff(int nc, REAL h);
+REAL UpdateAceff(int nc, REAL h);
+REAL UpdateDAceff(int nc, REAL h);
+REAL UpdateFreeSurface(int nc, REAL V);
 #endif
 
 
@@ -4,554 +4,788 @@
  * --------------------------------
  * Suntans netcdf joining post-processing program
  *
+ * Joins the per-processor netcdf output files (outputNetcdfFile.<proc>)
+ * into files on the unpartitioned grid.  Only the per-processor files are
+ * needed: the global grid size and the partition maps are recovered from
+ * the mnptr/eptr variables and the cellcomp/edgecomp ownership flags that
+ * are written by InitialiseOutputNCugrid.
+ *
+ * The joined output is split into blocks of STEPSPERFILE time records
+ * (basefile_001.nc, basefile_002.nc, ...) which are distributed across the
+ * MPI ranks, so that each rank reads, joins and writes its own files.  Each
+ * variable is streamed through a buffer holding as many time records as
+ * fit in --buffer megabytes, so that memory use does not depend on the
+ * length of the run.
+ *
+ * Usage: mpirun -np <nranks> sunjoin --datadir=<dir> --np=<nprocs> [options]
+ *   --np=<n>        Number of per-processor files (processors used by sun)
+ *   --steps=<n>     Records per joined file (default: spread over ranks)
+ *   --file=<key>    suntans.dat key of the file to join (default outputNetcdfFile)
+ *   --deflate=<n>   Deflate level of the joined files (0 to turn off)
+ *   --buffer=<n>    Size of the read/write buffer in MB
+ *   -v, -vv         Verbose output
+ *
  */
+#include <sys/stat.h>
 #include "sunjoin.h"
-#include "suntans.h"
 #include "mympi.h"
-#include "grid.h"
-#include "phys.h"
-#include "report.h"
+#include "memory.h"
 #include "mynetcdf.h"
 
- 
-void JoinNetcdf(propT *prop, gridT *grid, physT *phys, metT *met);
-static void alloc_mnptr(int ncproc, int Nclocal, ptrT *ptr, int myproc);
-static void alloc_eptr(int ncproc, int Nelocal, ptrT *ptr, int myproc);
-static void alloc_ptr(int Nc[NUMPROCS], int Ne[NUMPROCS], gridT *grid, ptrT **ptr);
-void read_cell_2D(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc);
-void read_cell_3D(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc);
-void read_cell_3Dw(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc);
-void read_edge_3D(int ncproc, int Ne, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc);
-void read_cell_int_2D(int ncproc, int Nrows, int Ndim, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc);
-void read_edge_int_2D(int ncproc, int Nrows, int Ndim, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc);
-void read_edge_1D(int ncproc, int Nrows,  char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc);
-void read_cell_1D(int ncproc, int Nrows,  char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc);
-void read_cell_int_1D(int ncproc, int nrows, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc);
-void read_cell_2Dall(int ncproc, int Nc, int Ndim, char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc);
-
-main(int argc, char *argv[])
+static void ParseJoinFlags(int argc, char *argv[], joinT *join, char *key, int myproc);
+static void ReadJoinMaps(joinT *join, int myproc, int numprocs, MPI_Comm comm);
+static void ReadJoinVariables(joinT *join, int myproc);
+static int OpenProcFile(joinT *join, int proc, int myproc);
+static void CloseProcFile(joinT *join, int proc);
+static void JoinFile(joinT *join, int filenum, int myproc);
+static int CreateJoinedFile(joinT *join, char *outfile, int myproc);
+static void JoinVariable(joinT *join, joinvarT *var, int ncout, int t0, int t1, int myproc);
+static void CopyVariable(joinT *join, joinvarT *var, int ncout, int t0, int t1, int myproc);
+static size_t JoinDimLen(int ncid, char *dimname);
+static void JoinReadInt(int ncid, char *vname, int *tmparray);
+
+int main(int argc, char *argv[])
 {
-  int myproc, numprocs, j;
+  int myproc, numprocs, filenum;
   MPI_Comm comm;
-  gridT *grid;
-  physT *phys;
-  propT *prop;
-  metT *met;
-  REAL t0,t1;
-
-  t0=time(NULL);
-  printf("###############################################\n");
-  printf(" Initiating SUNTANS NetCDF joining program...\n");
-  printf("###############################################\n");
+  joinT *join;
+  char key[BUFFERLENGTH];
+  double t0;
 
   StartMpi(&argc,&argv,&comm,&myproc,&numprocs);
-  // Same steps as suntans
-  ParseFlags(argc,argv,myproc);
-  GetGrid(&grid,myproc,numprocs,comm);
-  ReadProperties(&prop,myproc);
-  InitializeVerticalGrid(&grid,myproc);
-  AllocatePhysicalVariables(grid,&phys,prop);
-  AllocateMet(prop,grid,&met,myproc);
-  // Joining function
-  JoinNetcdf(prop,grid,phys,met);
-  
-  t1=time(NULL);
-  printf("###############################################\n");
-  printf(" Finished joining output files.\n");
-  printf("\nTotal elapsed time: %.2f s\n",t1-t0);
-  printf("###############################################\n");
+  t0=MPI_Wtime();
+
+  if(myproc==0) {
+    printf("###############################################\n");
+    printf(" Initiating SUNTANS NetCDF joining program...\n");
+    printf("###############################################\n");
+  }
+
+  join = (joinT *)SunMalloc(sizeof(joinT),"main");
+  ParseJoinFlags(argc,argv,join,key,myproc);
+
+  // Read the partition maps and variable descriptions
+  ReadJoinMaps(join,myproc,numprocs,comm);
+  ReadJoinVariables(join,myproc);
+
+  // Split the time records into files and distribute them over the ranks
+  if(STEPSPERFILE>0)
+    join->stepsperfile=STEPSPERFILE;
+  else
+    join->stepsperfile=(join->ntime+numprocs-1)/numprocs;
+  if(join->stepsperfile<1)
+    join->stepsperfile=1;
+  join->nfiles=(join->ntime+join->stepsperfile-1)/join->stepsperfile;
+  if(join->nfiles<1)
+    join->nfiles=1;
+
+  if(myproc==0) {
+    printf("Joining %d files with Nc = %d, Ne = %d and %d time records\n",
+	   join->Nproc,join->Nc,join->Ne,join->ntime);
+    printf("Writing %d joined files of %d records on %d ranks\n",
+	   join->nfiles,join->stepsperfile,numprocs);
+  }
+
+  for(filenum=myproc;filenum<join->nfiles;filenum+=numprocs)
+    JoinFile(join,filenum,myproc);
+
+  MPI_Barrier(comm);
+  if(myproc==0) {
+    printf("###############################################\n");
+    printf(" Finished joining output files.\n");
+    printf("\nTotal elapsed time: %.2f s\n",MPI_Wtime()-t0);
+    printf("###############################################\n");
+  }
   EndMpi(&comm);
+  return 0;
 } // End of main
 
 /*
- * Function: JoinNetcdf()
- * ----------------------
- * Main function for joining netcdf files together
+ * Function: ParseJoinFlags
+ * Usage: ParseJoinFlags(argc,argv,join,key,myproc);
+ * -------------------------------------------------
+ * Parse the command line options of sunjoin.  This sets the globals
+ * DATADIR, DATAFILE, NUMPROCS, STEPSPERFILE and VERBOSE in the same way
+ * as ParseFlags in report.c.
  *
  */
-void JoinNetcdf(propT *prop, gridT *grid, physT *phys, metT *met){
-
-    int myproc, i, j, n;
-    int ntime, varid, retval;
-    int timectr, filenum;
-    int ncid[NUMPROCS], Nc[NUMPROCS], Ne[NUMPROCS];
-    char str[BUFFERLENGTH], filename[BUFFERLENGTH], outfile[BUFFERLENGTH]; 
-    char *basefile;
-    size_t start1[1], count1[1];
-    int blowup=0;
-
-    // Step 1: Open all of the netcdf files
-    for(myproc=0;myproc<NUMPROCS;myproc++){
-	MPI_GetFile(filename,DATAFILE,"outputNetcdfFile","OpenFiles",myproc);
-	sprintf(str,"%s.%d",filename,myproc);
-	printf("Opening netcdf file: %s...\n",str);
-	ncid[myproc] = MPI_NCOpen(str,NC_NOWRITE,"OpenFiles",myproc);
-
-	// Read the length of the dimensions for each file
-	Nc[myproc] = returndimlen(ncid[myproc],"Nc");
-	Ne[myproc] = returndimlen(ncid[myproc],"Ne");
-    }
-
-    // Step 2: Read the number of time steps from the first file
-    ntime = returndimlen(ncid[0],"time"); 
-    printf("Total time steps = %d.\n",ntime);
-
-    // Step 3: Update the mnptr and eptr arrays 
-    alloc_ptr(Nc,Ne,grid,&ptr);
-    for(myproc=0;myproc<NUMPROCS;myproc++){ 
-        printf("Reading partitioned array pointers (proc: %d)\n",myproc);
-    	alloc_mnptr(ncid[myproc],Nc[myproc],ptr,myproc);
-    	alloc_eptr(ncid[myproc],Ne[myproc],ptr,myproc);
-    }
-
-    // Step 4: Reallocate the grid variables
-    for(myproc=0;myproc<NUMPROCS;myproc++){ 
-	read_cell_int_2D(ncid[myproc], Nc[myproc], NFACES, "cells", ptr, grid, grid->cells, myproc);
-	read_cell_int_2D(ncid[myproc], Nc[myproc], NFACES, "face", ptr, grid, grid->face, myproc);
-	read_cell_int_2D(ncid[myproc], Nc[myproc], NFACES, "neigh", ptr, grid, grid->neigh, myproc);
-	read_cell_int_2D(ncid[myproc], Nc[myproc], NFACES, "normal", ptr, grid, grid->normal, myproc);
-	read_cell_int_1D(ncid[myproc], Nc[myproc], "Nk",ptr, grid, grid->Nk, myproc);
-
-	read_edge_int_2D(ncid[myproc], Ne[myproc], 2, "edges", ptr, grid, grid->edges, myproc);
-	read_edge_int_2D(ncid[myproc], Ne[myproc], 2, "grad", ptr, grid, grid->grad, myproc);
-	read_edge_int_2D(ncid[myproc], Ne[myproc], 1, "Nke", ptr, grid, grid->Nke, myproc);
-
-	read_cell_1D(ncid[myproc], Nc[myproc], "xv", ptr, grid, grid->xv, myproc);
-	read_cell_1D(ncid[myproc], Nc[myproc], "yv", ptr, grid, grid->yv, myproc);
-	read_cell_1D(ncid[myproc], Nc[myproc], "Ac", ptr, grid, grid->Ac, myproc);
-	read_cell_1D(ncid[myproc], Nc[myproc], "dv", ptr, grid, grid->dv, myproc);
-
-	read_edge_1D(ncid[myproc], Ne[myproc], "xe", ptr, grid, grid->xe, myproc);
-	read_edge_1D(ncid[myproc], Ne[myproc], "ye", ptr, grid, grid->ye, myproc);
-	read_edge_1D(ncid[myproc], Ne[myproc], "n1", ptr, grid, grid->n1, myproc);
-	read_edge_1D(ncid[myproc], Ne[myproc], "n2", ptr, grid, grid->n2, myproc);
-	read_edge_1D(ncid[myproc], Ne[myproc], "df", ptr, grid, grid->df, myproc);
-	read_edge_1D(ncid[myproc], Ne[myproc], "dg", ptr, grid, grid->dg, myproc);
-
-	read_cell_2Dall(ncid[myproc], Nc[myproc], NFACES, "def", ptr, grid, grid->def, myproc);
-    }
-
-    // Step 5: Initialise the first combined file
-    filenum=1;
-    basefile=strndup(filename,strlen(filename)-3);
-    //printf("Filename=%s\n",basefile);
-
-    // This generates the file
-    sprintf(outfile,"%s_%03d.nc",basefile,filenum);
-    printf("\tCreating filename=%s\n",outfile);
-    prop->outputNetcdfFileID = MPI_NCOpen(outfile,NC_NETCDF4|NC_CLASSIC_MODEL,"OpenFiles",myproc);
-    InitialiseOutputNCugrid(prop, grid, phys, met, myproc);
-
-    // Step 6: Loop through the time steps
-    count1[0]=1;
-    timectr=0;
-    for(n=0;n<ntime;n++){
-        timectr += 1;
-    	// Read the time variable
-	start1[0]=n;
-	if ((retval = nc_inq_varid(ncid[0], "time", &varid)))
-	    ERR(retval);
-	if ((retval = nc_get_vara_double(ncid[0], varid, start1, count1, &prop->nctime )))
-	    ERR(retval);
-
-	 printf("Joining step: %d of %d, nctime: %f...\n",n,ntime,prop->nctime);
-
-	 // Update the file
-	 if(timectr==STEPSPERFILE){
-	    timectr=0;	 
-	    filenum+=1;
-	    //Close the old file
-	    MPI_NCClose(prop->outputNetcdfFileID);
-
-	    //Create the new file	    
-	    sprintf(outfile,"%s_%03d.nc",basefile,filenum);
-	    printf("\tCreating filename=%s\n",outfile);
-	    prop->outputNetcdfFileID = MPI_NCOpen(outfile,NC_NETCDF4|NC_CLASSIC_MODEL,"OpenFiles",myproc);
-	    InitialiseOutputNCugrid(prop, grid, phys, met, myproc);
-	 }
-
-
-
-	 // Read the other variables for each processor...
-	for(myproc=0;myproc<NUMPROCS;myproc++){ 
-	   read_cell_2D(ncid[myproc], Nc[myproc], n, "eta", ptr, grid, phys->h, myproc);
-	   read_cell_3D(ncid[myproc], Nc[myproc], n, "uc", ptr, grid, phys->uc, myproc);
-	   read_cell_3D(ncid[myproc], Nc[myproc], n, "vc", ptr, grid, phys->vc, myproc);
-	   read_cell_3Dw(ncid[myproc], Nc[myproc], n, "w", ptr, grid, phys->w, myproc);
-	   read_cell_3D(ncid[myproc], Nc[myproc], n, "nu_v", ptr, grid, phys->nu_tv, myproc);
-	   read_cell_3D(ncid[myproc], Nc[myproc], n, "dzz", ptr, grid, grid->dzz, myproc);
-	   if(prop->beta>0)
-	       read_cell_3D(ncid[myproc], Nc[myproc], n, "salt", ptr, grid, phys->s, myproc);
-	   if(prop->gamma>0)
-	       read_cell_3D(ncid[myproc], Nc[myproc], n, "temp", ptr, grid, phys->T, myproc);
-	   if( (prop->gamma>0) || (prop->beta>0) )
-	       read_cell_3D(ncid[myproc], Nc[myproc], n, "rho", ptr, grid, phys->rho, myproc);
-	   read_edge_3D(ncid[myproc], Ne[myproc], n, "dzf", ptr, grid, grid->dzf, myproc);
-	   read_edge_3D(ncid[myproc], Ne[myproc], n, "U", ptr, grid, phys->u, myproc);
-	   if(prop->metmodel>0){
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Uwind", ptr, grid, met->Uwind, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Vwind", ptr, grid, met->Vwind, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Tair", ptr, grid, met->Tair, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Pair", ptr, grid, met->Pair, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "rain", ptr, grid, met->rain, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "RH", ptr, grid, met->RH, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "cloud", ptr, grid, met->cloud, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Hs", ptr, grid, met->Hs, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Hl", ptr, grid, met->Hl, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Hlw", ptr, grid, met->Hlw, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "Hsw", ptr, grid, met->Hsw, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "tau_x", ptr, grid, met->tau_x, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "tau_y", ptr, grid, met->tau_y, myproc);
-	       read_cell_2D(ncid[myproc], Nc[myproc], n, "EP", ptr, grid, met->EP, myproc);
-	   }
-	}
-
-	 // Write the data to the file
-	  WriteOuputNC(prop, grid, phys, met, blowup, myproc);
- 
-
+static void ParseJoinFlags(int argc, char *argv[], joinT *join, char *key, int myproc)
+{
+  int i, j, js, done=0;
+  struct stat filestat;
+  char str[BUFFERLENGTH], val[BUFFERLENGTH];
+  char *ext;
+
+  VERBOSE=0;
+  NUMPROCS=1;
+  STEPSPERFILE=-1;
+  join->deflatelevel=JOINDEFLATELEVEL;
+  join->bufferbytes=(size_t)JOINBUFFERMB*1048576;
+  sprintf(key,"outputNetcdfFile");
+
+  sprintf(DATADIR,".");
+  sprintf(DATAFILE,"%s/%s",DATADIR,DEFAULTDATAFILE);
+
+  for(i=1;i<argc;i++) {
+    if(argv[i][0]=='-' && argv[i][1]=='v') {
+      for(j=1;j<strlen(argv[i]);j++)
+	if(argv[i][j]=='v')
+	  VERBOSE++;
+	else
+	  done=1;
+    } else if(argv[i][0]=='-' && argv[i][1]=='-' && strchr(argv[i],'=')) {
+      j=js=2;
+      while(argv[i][j]!='=') {
+	str[j-js]=argv[i][j];
+	j++;
+      }
+      str[j-js]='\0';
+      sprintf(val,"%s",argv[i]+j+1);
+
+      if(!strcmp(str,"datadir")) {
+	sprintf(DATADIR,"%s",val);
+	sprintf(DATAFILE,"%s/%s",DATADIR,DEFAULTDATAFILE);
+      } else if(!strcmp(str,"np"))
+	NUMPROCS=atoi(val);
+      else if(!strcmp(str,"steps"))
+	STEPSPERFILE=atoi(val);
+      else if(!strcmp(str,"file"))
+	sprintf(key,"%s",val);
+      else if(!strcmp(str,"deflate"))
+	join->deflatelevel=atoi(val);
+      else if(!strcmp(str,"buffer"))
+	join->bufferbytes=(size_t)atoi(val)*1048576;
+      else
+	done=1;
+    } else
+      done=1;
+  }
+
+  if(done || NUMPROCS<1 || join->deflatelevel<0 || join->deflatelevel>9) {
+    if(myproc==0) {
+      printf("Usage: %s --datadir=<dir> --np=<nprocs> [--steps=<n>] [--file=<key>]\n",argv[0]);
+      printf("          [--deflate=<0-9>] [--buffer=<MB>] [-v]\n");
     }
-
-}// End JoinNetcdf
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  if(stat(DATAFILE,&filestat)==-1) {
+    sprintf(str,"Error opening data file %s on processor %d",DATAFILE,myproc);
+    perror(str);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  join->Nproc=NUMPROCS;
+  join->keepopen=(NUMPROCS<=JOINMAXOPENFILES);
+  if(join->bufferbytes<1)
+    join->bufferbytes=1;
+
+  // Joined files are basefile_001.nc, basefile_002.nc, ...
+  MPI_GetFile(join->infile,DATAFILE,key,"ParseJoinFlags",myproc);
+  sprintf(join->basefile,"%s",join->infile);
+  ext=strrchr(join->basefile,'.');
+  if(ext!=NULL && !strcmp(ext,".nc"))
+    *ext='\0';
+}
 
 /*
- * Function: read_edge_3D()
- * -------------------------
- * Read a 3D edge based double array onto the phys variable
+ * Function: OpenProcFile
+ * Usage: ncid = OpenProcFile(join,proc,myproc);
+ * ---------------------------------------------
+ * Returns the id of the file written by processor proc, opening it if
+ * it is not already open.
+ *
  */
-void read_edge_3D(int ncproc, int Ne, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc){
-    int j, jloc, ind, k, retval, varid;
-    size_t start[]={tstep,0,0};
-    size_t count[]={1,grid->Nkmax,Ne};
-    //REAL tmpvar[1][grid->Nkmax][Ne];
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
-	ERR(retval);
-
-    for(j=0;j<Ne;j++){
-    	jloc=ptr->eptr[myproc][j];
-	for(k=0;k<grid->Nke[jloc];k++){
-	    ind = k*Ne+j;
-	    tmp3d[jloc][k]=ptr->ncscratch[ind];
-	    //tmp3d[jloc][k]=tmpvar[0][k][j];
-	}
+static int OpenProcFile(joinT *join, int proc, int myproc)
+{
+  int retval;
+  char str[BUFFERLENGTH];
+
+  if(join->ncid[proc]<0) {
+    sprintf(str,"%s.%d",join->infile,proc);
+    if(VERBOSE>2) printf("Processor %d opening netcdf file: %s\n",myproc,str);
+    if ((retval = nc_open(str,NC_NOWRITE,&(join->ncid[proc])))) {
+      printf("Error opening %s on processor %d\n",str,myproc);
+      ERR(retval);
     }
-
-}//End function
+  }
+  return join->ncid[proc];
+}
 
 /*
- * Function: read_cell_3D()
- * -------------------------
- * Read a 3D cell based double array onto the phys variable
+ * Function: CloseProcFile
+ * Usage: CloseProcFile(join,proc);
+ * --------------------------------
+ * Closes the file written by processor proc unless all of the files
+ * fit within JOINMAXOPENFILES and are kept open.
+ *
  */
-void read_cell_3D(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    size_t start[]={tstep,0,0};
-    size_t count[]={1,grid->Nkmax,Nc};
-    //REAL tmpvar[1][grid->Nkmax][Nc];
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
-    //if ((retval = nc_get_vara_double(ncproc, varid, start, count, &tmpvar[0][0][0] )))
-	ERR(retval);
-
-    for(i=0;i<Nc;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	for(k=0;k<grid->Nkmax;k++){
-	    ind = k*Nc+i;
-	    if(k < grid->Nk[iloc])
-		tmp3d[iloc][k]=ptr->ncscratch[ind];
-	    //tmp3d[iloc][k]=tmpvar[0][k][i];
-	}
-    }
+static void CloseProcFile(joinT *join, int proc)
+{
+  int retval;
 
-}//End function
+  if(!join->keepopen && join->ncid[proc]>=0) {
+    if ((retval = nc_close(join->ncid[proc])))
+      ERR(retval);
+    join->ncid[proc]=-1;
+  }
+}
 
 /*
- * Function: read_cell_3Dw()
- * -------------------------
- * Read a 3D cell based double array onto the phys variable
+ * Function: ReadJoinMaps
+ * Usage: ReadJoinMaps(join,myproc,numprocs,comm);
+ * -----------------------------------------------
+ * Reads the mnptr/eptr maps and the cellcomp/edgecomp ownership flags of
+ * every per-processor file.  Each rank reads the files proc=myproc mod
+ * numprocs and broadcasts them to the other ranks.  Files written before
+ * the ownership flags existed are joined with every cell and edge of each
+ * processor, so that ghost values are overwritten by later processors.
+ *
  */
-void read_cell_3Dw(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL **tmp3d, int myproc){
-    int i, iloc, ind, k, retval, varid;
-    size_t start[]={tstep,0,0};
-    size_t count[]={1,grid->Nkmax+1,Nc};
-    //REAL tmpvar[1][grid->Nkmax+1][Nc];
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
-	ERR(retval);
-
-    for(i=0;i<Nc;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	for(k=0;k<grid->Nk[iloc]+1;k++){
-	    ind = k*Nc+i;
-	    tmp3d[iloc][k]=ptr->ncscratch[ind];
-	    //tmp3d[iloc][k]=tmpvar[0][k][i];
-	}
+static void ReadJoinMaps(joinT *join, int myproc, int numprocs, MPI_Comm comm)
+{
+  int p, i, n, ncid, varid, root, size[5];
+  int *flag;
+
+  join->ncid = (int *)SunMalloc(join->Nproc*sizeof(int),"ReadJoinMaps");
+  join->Ncp = (int *)SunMalloc(join->Nproc*sizeof(int),"ReadJoinMaps");
+  join->Nep = (int *)SunMalloc(join->Nproc*sizeof(int),"ReadJoinMaps");
+  join->Ncown = (int *)SunMalloc(join->Nproc*sizeof(int),"ReadJoinMaps");
+  join->Neown = (int *)SunMalloc(join->Nproc*sizeof(int),"ReadJoinMaps");
+  join->mnptr = (int **)SunMalloc(join->Nproc*sizeof(int *),"ReadJoinMaps");
+  join->eptr = (int **)SunMalloc(join->Nproc*sizeof(int *),"ReadJoinMaps");
+  join->cellown = (int **)SunMalloc(join->Nproc*sizeof(int *),"ReadJoinMaps");
+  join->edgeown = (int **)SunMalloc(join->Nproc*sizeof(int *),"ReadJoinMaps");
+
+  for(p=0;p<join->Nproc;p++)
+    join->ncid[p]=-1;
+
+  join->Nc=0;
+  join->Ne=0;
+  join->ntime=0;
+  for(p=0;p<join->Nproc;p++) {
+    root=p%numprocs;
+    if(myproc==root) {
+      ncid=OpenProcFile(join,p,myproc);
+      size[0]=(int)JoinDimLen(ncid,"Nc");
+      size[1]=(int)JoinDimLen(ncid,"Ne");
+      size[4]=(int)JoinDimLen(ncid,"time");
+      join->mnptr[p]=(int *)SunMalloc(size[0]*sizeof(int),"ReadJoinMaps");
+      join->eptr[p]=(int *)SunMalloc(size[1]*sizeof(int),"ReadJoinMaps");
+      join->cellown[p]=(int *)SunMalloc(size[0]*sizeof(int),"ReadJoinMaps");
+      join->edgeown[p]=(int *)SunMalloc(size[1]*sizeof(int),"ReadJoinMaps");
+      flag=(int *)SunMalloc((size[0]>size[1]?size[0]:size[1])*sizeof(int),"ReadJoinMaps");
+
+      JoinReadInt(ncid,"mnptr",join->mnptr[p]);
+      JoinReadInt(ncid,"eptr",join->eptr[p]);
+
+      if(nc_inq_varid(ncid,"cellcomp",&varid)==NC_NOERR)
+	JoinReadInt(ncid,"cellcomp",flag);
+      else
+	for(i=0;i<size[0];i++)
+	  flag[i]=1;
+      for(i=0,n=0;i<size[0];i++)
+	if(flag[i])
+	  join->cellown[p][n++]=i;
+      size[2]=n;
+
+      if(nc_inq_varid(ncid,"edgecomp",&varid)==NC_NOERR)
+	JoinReadInt(ncid,"edgecomp",flag);
+      else
+	for(i=0;i<size[1];i++)
+	  flag[i]=1;
+      for(i=0,n=0;i<size[1];i++)
+	if(flag[i])
+	  join->edgeown[p][n++]=i;
+      size[3]=n;
+
+      SunFree(flag,(size[0]>size[1]?size[0]:size[1])*sizeof(int),"ReadJoinMaps");
+      CloseProcFile(join,p);
     }
 
-}//End function
-
+    MPI_Bcast(size,5,MPI_INT,root,comm);
+    join->Ncp[p]=size[0];
+    join->Nep[p]=size[1];
+    join->Ncown[p]=size[2];
+    join->Neown[p]=size[3];
+    if(p==0)
+      join->ntime=size[4];
+    else if(size[4]!=join->ntime && myproc==0)
+      printf("Warning: file %d has %d time records, file 0 has %d\n",p,size[4],join->ntime);
+
+    if(myproc!=root) {
+      join->mnptr[p]=(int *)SunMalloc(size[0]*sizeof(int),"ReadJoinMaps");
+      join->eptr[p]=(int *)SunMalloc(size[1]*sizeof(int),"ReadJoinMaps");
+      join->cellown[p]=(int *)SunMalloc(size[0]*sizeof(int),"ReadJoinMaps");
+      join->edgeown[p]=(int *)SunMalloc(size[1]*sizeof(int),"ReadJoinMaps");
+    }
+    MPI_Bcast(join->mnptr[p],size[0],MPI_INT,root,comm);
+    MPI_Bcast(join->eptr[p],size[1],MPI_INT,root,comm);
+    MPI_Bcast(join->cellown[p],size[2],MPI_INT,root,comm);
+    MPI_Bcast(join->edgeown[p],size[3],MPI_INT,root,comm);
+
+    for(i=0;i<size[0];i++)
+      if(join->mnptr[p][i]+1>join->Nc)
+	join->Nc=join->mnptr[p][i]+1;
+    for(i=0;i<size[1];i++)
+      if(join->eptr[p][i]+1>join->Ne)
+	join->Ne=join->eptr[p][i]+1;
+
+    if(VERBOSE>1 && myproc==0)
+      printf("Processor %d: Nc = %d (%d computed), Ne = %d (%d computed)\n",
+	     p,size[0],size[2],size[1],size[3]);
+  }
+}
 
 /*
- * Function: read_cell_2D()
- * -------------------------
- * Read a 2D cell based double array onto the phys variable
+ * Function: ReadJoinVariables
+ * Usage: ReadJoinVariables(join,myproc);
+ * --------------------------------------
+ * Reads the description of every variable in the file of processor 0
+ * and classifies it as a cell, edge or other (global) variable by its
+ * dimensions.  The partition maps and ownership flags are not joined.
+ *
  */
-void read_cell_2D(int ncproc, int Nc, int tstep, char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc){
-    int i, iloc, retval, varid;
-    size_t start[]={tstep,0};
-    size_t count[]={1,Nc};
-    //REAL tmpvar[1][Nc];
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
-	ERR(retval);
-
-    for(i=0;i<Nc;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	tmp2d[iloc]=ptr->ncscratch[i];
+static void ReadJoinVariables(joinT *join, int myproc)
+{
+  int ncid, retval, nvars, varid, i, natts;
+  int dimid_Nc, dimid_Ne, dimid_time;
+  joinvarT *var;
+
+  ncid=OpenProcFile(join,0,myproc);
+  if ((retval = nc_inq_dimid(ncid,"Nc",&dimid_Nc)))
+    ERR(retval);
+  if ((retval = nc_inq_dimid(ncid,"Ne",&dimid_Ne)))
+    ERR(retval);
+  if ((retval = nc_inq_dimid(ncid,"time",&dimid_time)))
+    ERR(retval);
+  if ((retval = nc_inq_nvars(ncid,&nvars)))
+    ERR(retval);
+
+  join->var = (joinvarT *)SunMalloc(nvars*sizeof(joinvarT),"ReadJoinVariables");
+  join->Nvar=0;
+  for(varid=0;varid<nvars;varid++) {
+    var=&(join->var[join->Nvar]);
+    if ((retval = nc_inq_varndims(ncid,varid,&(var->ndims))))
+      ERR(retval);
+    if(var->ndims>8) {
+      printf("Error in ReadJoinVariables: variable %d has more than 8 dimensions\n",varid);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    if ((retval = nc_inq_var(ncid,varid,var->name,&(var->xtype),&(var->ndims),var->dimids,&natts)))
+      ERR(retval);
+
+    if(!strcmp(var->name,"mnptr") || !strcmp(var->name,"eptr") ||
+       !strcmp(var->name,"cellcomp") || !strcmp(var->name,"edgecomp"))
+      continue;
+
+    var->itime=-1;
+    var->igrid=-1;
+    var->type=JOINOTHER;
+    for(i=0;i<var->ndims;i++) {
+      if(var->dimids[i]==dimid_time)
+	var->itime=i;
+      else if(var->dimids[i]==dimid_Nc && var->igrid<0) {
+	var->igrid=i;
+	var->type=JOINCELL;
+      } else if(var->dimids[i]==dimid_Ne && var->igrid<0) {
+	var->igrid=i;
+	var->type=JOINEDGE;
+      }
+    }
+    if(var->itime>0) {
+      if(myproc==0)
+	printf("Warning: time is not the first dimension of %s, skipping it\n",var->name);
+      continue;
     }
 
-}//End function
+    // Connectivity arrays hold local indices (see InitialiseOutputNCugrid)
+    if(!strcmp(var->name,"face"))
+      var->remap=JOINREMAPEDGE;
+    else if(!strcmp(var->name,"neigh") || !strcmp(var->name,"grad"))
+      var->remap=JOINREMAPCELL;
+    else if(!strcmp(var->name,"mark"))
+      var->remap=JOINREMAPMARK;
+    else
+      var->remap=JOINNOREMAP;
+
+    join->Nvar++;
+  }
+  CloseProcFile(join,0);
+}
 
 /*
- * Function: read_cell_1D()
- * -------------------------
- * Read a 2D cell based double array onto the phys variable
+ * Function: JoinFile
+ * Usage: JoinFile(join,filenum,myproc);
+ * -------------------------------------
+ * Creates joined file number filenum and joins records
+ * filenum*stepsperfile to (filenum+1)*stepsperfile-1 into it, one
+ * variable at a time.
+ *
  */
-void read_cell_1D(int ncproc, int Nrows,  char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    //REAL tmpvar[1][Nc];
-    size_t start[]={0};
-    size_t count[]={Nrows};
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
-	ERR(retval);
-
-    for(i=0;i<Nrows;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	tmp2d[iloc]=ptr->ncscratch[i];
-    }
-
-}//End function
+static void JoinFile(joinT *join, int filenum, int myproc)
+{
+  int n, ncout, t0, t1, retval;
+  char outfile[BUFFERLENGTH];
+  double tstart=MPI_Wtime();
+
+  t0=filenum*join->stepsperfile;
+  t1=t0+join->stepsperfile;
+  if(t1>join->ntime)
+    t1=join->ntime;
+
+  sprintf(outfile,"%s_%03d.nc",join->basefile,filenum+1);
+  if(VERBOSE>0)
+    printf("Processor %d joining records %d to %d into %s\n",myproc,t0,t1-1,outfile);
+
+  ncout=CreateJoinedFile(join,outfile,myproc);
+  for(n=0;n<join->Nvar;n++) {
+    if(VERBOSE>1)
+      printf("Processor %d joining %s...\n",myproc,join->var[n].name);
+    if(join->var[n].type==JOINOTHER)
+      CopyVariable(join,&(join->var[n]),ncout,t0,t1,myproc);
+    else
+      JoinVariable(join,&(join->var[n]),ncout,t0,t1,myproc);
+  }
+  if ((retval = nc_close(ncout)))
+    ERR(retval);
+
+  if(VERBOSE>0)
+    printf("Processor %d finished %s in %.2f s\n",myproc,outfile,MPI_Wtime()-tstart);
+}
 
 /*
- * Function: read_edge_1D()
- * -------------------------
- * Read a 2D cell based double array onto the phys variable
+ * Function: CreateJoinedFile
+ * Usage: ncout = CreateJoinedFile(join,outfile,myproc);
+ * -----------------------------------------------------
+ * Creates a netcdf-4 file with the dimensions, variables and attributes
+ * of the file of processor 0 on the joined grid.  Variables are chunked
+ * by single time records with the cell or edge dimension split into
+ * chunks of about JOINCHUNKBYTES, and compressed with the shuffle and
+ * deflate filters when deflatelevel>0.
+ *
  */
-void read_edge_1D(int ncproc, int Nrows,  char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    //REAL tmpvar[1][Nc];
-    size_t start[]={0};
-    size_t count[]={Nrows};
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
+static int CreateJoinedFile(joinT *join, char *outfile, int myproc)
+{
+  int ncin, ncout, retval, ndims, natts, d, i, n, varid;
+  int dimid_Nc, dimid_Ne, dimid_time;
+  int *outdim;
+  int dimids[8];
+  size_t len, dimlen[8], chunks[8], other;
+  char name[NC_MAX_NAME+1];
+  joinvarT *var;
+
+  ncin=OpenProcFile(join,0,myproc);
+  if ((retval = nc_create(outfile,NC_NETCDF4|NC_CLOBBER,&ncout)))
+    ERR(retval);
+
+  // Global attributes
+  if ((retval = nc_inq_natts(ncin,&natts)))
+    ERR(retval);
+  for(i=0;i<natts;i++) {
+    if ((retval = nc_inq_attname(ncin,NC_GLOBAL,i,name)))
+      ERR(retval);
+    if ((retval = nc_copy_att(ncin,NC_GLOBAL,name,ncout,NC_GLOBAL)))
+      ERR(retval);
+  }
+
+  // Dimensions, with Nc and Ne replaced by the size of the joined grid
+  if ((retval = nc_inq_dimid(ncin,"Nc",&dimid_Nc)))
+    ERR(retval);
+  if ((retval = nc_inq_dimid(ncin,"Ne",&dimid_Ne)))
+    ERR(retval);
+  if ((retval = nc_inq_dimid(ncin,"time",&dimid_time)))
+    ERR(retval);
+  if ((retval = nc_inq_ndims(ncin,&ndims)))
+    ERR(retval);
+  outdim = (int *)SunMalloc(ndims*sizeof(int),"CreateJoinedFile");
+  for(d=0;d<ndims;d++) {
+    if ((retval = nc_inq_dim(ncin,d,name,&len)))
+      ERR(retval);
+    if(d==dimid_time)
+      len=NC_UNLIMITED;
+    else if(d==dimid_Nc)
+      len=join->Nc;
+    else if(d==dimid_Ne)
+      len=join->Ne;
+    if ((retval = nc_def_dim(ncout,name,len,&(outdim[d]))))
+      ERR(retval);
+  }
+
+  // Variables
+  for(n=0;n<join->Nvar;n++) {
+    var=&(join->var[n]);
+    other=1;
+    for(i=0;i<var->ndims;i++) {
+      dimids[i]=outdim[var->dimids[i]];
+      if(var->dimids[i]==dimid_Nc)
+	dimlen[i]=join->Nc;
+      else if(var->dimids[i]==dimid_Ne)
+	dimlen[i]=join->Ne;
+      else if(i==var->itime)
+	dimlen[i]=1;
+      else if ((retval = nc_inq_dimlen(ncin,var->dimids[i],&(dimlen[i]))))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
+      if(i!=var->igrid)
+	other*=dimlen[i];
+    }
+    if ((retval = nc_def_var(ncout,var->name,var->xtype,var->ndims,dimids,&varid)))
+      ERR(retval);
+
+    if(var->ndims>0) {
+      for(i=0;i<var->ndims;i++)
+	chunks[i]=(dimlen[i]>0 ? dimlen[i] : 1);
+      if(var->igrid>=0) {
+	chunks[var->igrid]=JOINCHUNKBYTES/(sizeof(DREAL)*(other>0 ? other : 1));
+	if(chunks[var->igrid]<1)
+	  chunks[var->igrid]=1;
+	if(chunks[var->igrid]>dimlen[var->igrid])
+	  chunks[var->igrid]=dimlen[var->igrid];
+      }
+      if ((retval = nc_def_var_chunking(ncout,varid,NC_CHUNKED,chunks)))
 	ERR(retval);
-
-    for(i=0;i<Nrows;i++){
-    	iloc=ptr->eptr[myproc][i];
-	tmp2d[iloc]=ptr->ncscratch[i];
+      if(join->deflatelevel>0)
+	if ((retval = nc_def_var_deflate(ncout,varid,1,1,join->deflatelevel)))
+	  ERR(retval);
     }
 
-}//End function
-
-/*
- * Function: read_cell_2Dall()
- * -------------------------
- * Read a 2D cell based double array onto the phys variable
- */
-void read_cell_2Dall(int ncproc, int Nc, int Ndim, char *vname, ptrT *ptr, gridT *grid, REAL *tmp2d, int myproc){
-    int i, iloc, k, retval, varid;
-    size_t start[]={0,0};
-    size_t count[]={Nc,Ndim};
-    //REAL tmpvar[1][Nc];
-
-    //printf("Reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
+    if ((retval = nc_inq_varid(ncin,var->name,&i)))
+      ERR(retval);
+    if ((retval = nc_inq_varnatts(ncin,i,&natts)))
+      ERR(retval);
+    for(d=0;d<natts;d++) {
+      if ((retval = nc_inq_attname(ncin,i,d,name)))
 	ERR(retval);
-    if ((retval = nc_get_vara_double(ncproc, varid, start, count, &ptr->ncscratch[0] )))
+      if ((retval = nc_copy_att(ncin,i,name,ncout,varid)))
 	ERR(retval);
-
-    for(i=0;i<Nc;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	for(k=0;k<Ndim;k++){
-	     tmp2d[iloc*Ndim+k]=ptr->ncscratch[i*Ndim+k];
-	 }
     }
+  }
+  SunFree(outdim,ndims*sizeof(int),"CreateJoinedFile");
 
-}//End function
-
-/*
- * function: read_cell_int_2d()
- * -------------------------
- * read a 2d cell based double array onto the phys variable
- */
-void read_cell_int_2D(int ncproc, int nrows, int ndim, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    //real tmpvar[1][nc];
-    size_t start[]={0,0};
-    size_t count[]={nrows,ndim};
-
-    //printf("reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	err(retval);
-    if ((retval = nc_get_vara_int(ncproc, varid, start, count, &ptr->nctmpint[0] )))
-	err(retval);
-
-    for(i=0;i<nrows;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	for(k=0;k<ndim;k++){
-	     tmp2d[iloc*ndim+k]=ptr->nctmpint[i*ndim+k];
-	 }
-    }
-
-}//end function
-
-/*
- * function: read_cell_int_1d()
- * -------------------------
- * read a 2d cell based double array onto the phys variable
- */
-void read_cell_int_1D(int ncproc, int nrows, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    //real tmpvar[1][nc];
-    size_t start[]={0};
-    size_t count[]={nrows};
-
-    //printf("reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	err(retval);
-    if ((retval = nc_get_vara_int(ncproc, varid, start, count, &ptr->nctmpint[0] )))
-	err(retval);
-
-    for(i=0;i<nrows;i++){
-    	iloc=ptr->mnptr[myproc][i];
-	tmp2d[iloc]=ptr->nctmpint[i];
-    }
-
-}//end function
+  if ((retval = nc_enddef(ncout)))
+    ERR(retval);
+  CloseProcFile(join,0);
 
+  return ncout;
+}
 
 /*
- * function: read_edge_int_2d()
- * -------------------------
- * read a 2d cell based double array onto the phys variable
+ * Function: CopyVariable
+ * Usage: CopyVariable(join,var,ncout,t0,t1,myproc);
+ * -------------------------------------------------
+ * Copies a variable that does not depend on the partition (e.g. time,
+ * z_r or the node coordinates) from the file of processor 0.
+ *
  */
-void read_edge_int_2D(int ncproc, int nrows, int ndim, char *vname, ptrT *ptr, gridT *grid, int *tmp2d, int myproc){
-    int i, iloc, k, ind, retval, varid;
-    //real tmpvar[1][nc];
-    size_t start[]={0,0};
-    size_t count[]={nrows,ndim};
-
-    //printf("reading variable: %s on processor: %d...\n",vname,myproc);
-    if ((retval = nc_inq_varid(ncproc, vname, &varid)))
-	err(retval);
-    if ((retval = nc_get_vara_int(ncproc, varid, start, count, &ptr->nctmpint[0] )))
-	err(retval);
-
-    for(i=0;i<nrows;i++){
-    	iloc=ptr->eptr[myproc][i];
-	for(k=0;k<ndim;k++){
-	     tmp2d[iloc*ndim+k]=ptr->nctmpint[i*ndim+k];
-	 }
-    }
-
-}//end function
-
-
+static void CopyVariable(joinT *join, joinvarT *var, int ncout, int t0, int t1, int myproc)
+{
+  int ncin, retval, varid, outid, i;
+  size_t start[8], count[8], outstart[8], size=1;
+  DREAL *buf;
+
+  if(var->itime>=0 && t1<=t0)
+    return;
+
+  ncin=OpenProcFile(join,0,myproc);
+  if ((retval = nc_inq_varid(ncin,var->name,&varid)))
+    ERR(retval);
+  if ((retval = nc_inq_varid(ncout,var->name,&outid)))
+    ERR(retval);
+
+  for(i=0;i<var->ndims;i++) {
+    outstart[i]=start[i]=0;
+    if(i==var->itime) {
+      start[i]=t0;
+      count[i]=t1-t0;
+    } else if ((retval = nc_inq_dimlen(ncin,var->dimids[i],&(count[i]))))
+      ERR(retval);
+    size*=count[i];
+  }
+
+  buf=(DREAL *)SunMalloc((size>0 ? size : 1)*sizeof(DREAL),"CopyVariable");
+  if ((retval = nc_get_vara_double(ncin,varid,start,count,buf)))
+    ERR(retval);
+  if ((retval = nc_put_vara_double(ncout,outid,outstart,count,buf)))
+    ERR(retval);
+  SunFree(buf,(size>0 ? size : 1)*sizeof(DREAL),"CopyVariable");
+
+  CloseProcFile(join,0);
+}
 
 /*
- * Function: alloc_ptr()
- * -------------------------
+ * Function: JoinVariable
+ * Usage: JoinVariable(join,var,ncout,t0,t1,myproc);
+ * -------------------------------------------------
+ * Joins records t0 to t1-1 of a cell or edge variable.  The records are
+ * read in blocks that fit in join->bufferbytes; for each block the
+ * processors are read in turn and the values at the cells (edges) they
+ * own are scattered into the global block, which is then written.
+ * Connectivity variables (face, neigh, grad) are mapped from local to
+ * global indices on the way, and interprocessor edges (mark=5) become
+ * computational edges (mark=0).
  *
  */
-static void alloc_ptr(int Nc[NUMPROCS], int Ne[NUMPROCS], gridT *grid, ptrT **ptr){
-    int myproc, i, j;
-    *ptr = (ptrT *)SunMalloc(sizeof(ptrT),"JoinNetcdf");
-    (*ptr)->mnptr = (int **)SunMalloc(NUMPROCS*sizeof(int *),"JoinNetcdf");
-    (*ptr)->eptr = (int **)SunMalloc(NUMPROCS*sizeof(int *),"JoinNetcdf");
+static void JoinVariable(joinT *join, joinvarT *var, int ncout, int t0, int t1, int myproc)
+{
+  int ncin, retval, varid, outid, i, p, t, nrec, nrecbuf, Nloc, Nlocmax, Nglobal, Nown;
+  int *map, *own, *remap, Nremap, r, o, n, j, iloc, iv;
+  size_t start[8], count[8], outer=1, inner=1, recsize, gsize, lsize;
+  DREAL *gbuf, *lbuf, *src, *dst;
 
+  Nglobal=(var->type==JOINCELL ? join->Nc : join->Ne);
 
-    for(myproc=0;myproc<NUMPROCS;myproc++){ 
-        printf("myproc: %d, Nc: %d, Ne: %d\n",myproc,Nc[myproc],Ne[myproc]);
-	(*ptr)->mnptr[myproc] = (int *)SunMalloc(Nc[myproc]*sizeof(int),"JoinNetcdf");
-	(*ptr)->eptr[myproc] = (int *)SunMalloc(Ne[myproc]*sizeof(int),"JoinNetcdf");
+  ncin=OpenProcFile(join,0,myproc);
+  for(i=0;i<var->ndims;i++)
+    if(i!=var->itime && i!=var->igrid) {
+      if ((retval = nc_inq_dimlen(ncin,var->dimids[i],&(count[i]))))
+	ERR(retval);
+      if(i<var->igrid)
+	outer*=count[i];
+      else
+	inner*=count[i];
     }
-    
-    for(myproc=0;myproc<NUMPROCS;myproc++){ 
-    	for(i=0;i<Nc[myproc];i++) (*ptr)->mnptr[myproc][i] = 0.0;
-    	for(j=0;j<Ne[myproc];j++) (*ptr)->eptr[myproc][j] = 0.0;
+  CloseProcFile(join,0);
+
+  if(var->itime>=0) {
+    nrec=t1-t0;
+    if(nrec<=0)
+      return;
+  } else
+    nrec=1;
+
+  // Number of records that fit in the buffer
+  recsize=outer*Nglobal*inner;
+  nrecbuf=(int)(join->bufferbytes/(recsize*sizeof(DREAL)));
+  if(nrecbuf<1)
+    nrecbuf=1;
+  if(nrecbuf>nrec)
+    nrecbuf=nrec;
+
+  Nlocmax=0;
+  for(p=0;p<join->Nproc;p++) {
+    Nloc=(var->type==JOINCELL ? join->Ncp[p] : join->Nep[p]);
+    if(Nloc>Nlocmax)
+      Nlocmax=Nloc;
+  }
+  gsize=nrecbuf*recsize;
+  lsize=nrecbuf*outer*Nlocmax*inner;
+  gbuf=(DREAL *)SunMalloc(gsize*sizeof(DREAL),"JoinVariable");
+  lbuf=(DREAL *)SunMalloc((lsize>0 ? lsize : 1)*sizeof(DREAL),"JoinVariable");
+
+  if ((retval = nc_inq_varid(ncout,var->name,&outid)))
+    ERR(retval);
+
+  for(t=0;t<nrec;t+=nrecbuf) {
+    r=(nrec-t<nrecbuf ? nrec-t : nrecbuf);
+    for(i=0;i<r*recsize;i++)
+      gbuf[i]=(DREAL)EMPTY;
+
+    for(p=0;p<join->Nproc;p++) {
+      if(var->type==JOINCELL) {
+	Nloc=join->Ncp[p];
+	map=join->mnptr[p];
+	own=join->cellown[p];
+	Nown=join->Ncown[p];
+      } else {
+	Nloc=join->Nep[p];
+	map=join->eptr[p];
+	own=join->edgeown[p];
+	Nown=join->Neown[p];
+      }
+      if(var->remap==JOINREMAPCELL) {
+	remap=join->mnptr[p];
+	Nremap=join->Ncp[p];
+      } else if(var->remap==JOINREMAPEDGE) {
+	remap=join->eptr[p];
+	Nremap=join->Nep[p];
+      } else {
+	remap=NULL;
+	Nremap=0;
+      }
+
+      ncin=OpenProcFile(join,p,myproc);
+      if ((retval = nc_inq_varid(ncin,var->name,&varid)))
+	ERR(retval);
+      for(i=0;i<var->ndims;i++) {
+	start[i]=0;
+	if(i==var->itime) {
+	  start[i]=t0+t;
+	  count[i]=r;
+	} else if(i==var->igrid)
+	  count[i]=Nloc;
+      }
+      if ((retval = nc_get_vara_double(ncin,varid,start,count,lbuf)))
+	ERR(retval);
+      CloseProcFile(join,p);
+
+      for(o=0;o<r*outer;o++)
+	for(n=0;n<Nown;n++) {
+	  iloc=own[n];
+	  src=lbuf+(o*Nloc+iloc)*inner;
+	  dst=gbuf+(o*Nglobal+map[iloc])*inner;
+	  for(j=0;j<inner;j++) {
+	    dst[j]=src[j];
+	    if(remap) {
+	      iv=(int)src[j];
+	      if(iv>=0 && iv<Nremap && iv!=EMPTY)
+		dst[j]=remap[iv];
+	    } else if(var->remap==JOINREMAPMARK && (int)src[j]==5)
+	      dst[j]=0;
+	  }
+	}
     }
 
+    for(i=0;i<var->ndims;i++) {
+      start[i]=0;
+      if(i==var->itime) {
+	start[i]=t;
+	count[i]=r;
+      } else if(i==var->igrid)
+	count[i]=Nglobal;
+    }
+    if ((retval = nc_put_vara_double(ncout,outid,start,count,gbuf)))
+      ERR(retval);
+  }
 
-    // Allocate memory to the netcdf read in arrays
-    (*ptr)->ncscratch = (REAL *)SunMalloc(grid->Nkmax*grid->Ne*sizeof(REAL),"JoinNetcdf");
-    (*ptr)->nctmpint = (int *)SunMalloc(3*grid->Ne*sizeof(int),"JoinNetcdf");
-
-
-
-}//End function
+  SunFree(gbuf,gsize*sizeof(DREAL),"JoinVariable");
+  SunFree(lbuf,(lsize>0 ? lsize : 1)*sizeof(DREAL),"JoinVariable");
+}
 
- /*
- * Function: alloc_mnptr()
- * -------------------------
+/*
+ * Function: JoinDimLen
+ * Usage: Nc = JoinDimLen(ncid,"Nc");
+ * ----------------------------------
+ * Returns the length of a dimension, as returndimlen in mynetcdf.c.
  *
  */
-static void alloc_mnptr(int ncproc, int Nclocal, ptrT *ptr, int myproc){
-    int i, varid,retval;
-    size_t start[]={0};
-    size_t count[]={Nclocal};
-    //int tmp[Nclocal];
-    //printf("myproc: %d, Nc: %d, Nc(file): %d\n",myproc,Nclocal,returndimlen(ncproc,"Nc"));
-    // Read the data into the array
-    if ((retval = nc_inq_varid(ncproc, "mnptr", &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_int(ncproc, varid,start, count, &ptr->nctmpint[0] )))
-	ERR(retval);
-
-    for(i=0;i<Nclocal;i++){
-	ptr->mnptr[myproc][i]=ptr->nctmpint[i];
-	//printf("myproc: %d, i: %i, mnptr: %i\n",myproc,i,tmp[i]);
-    }
-} // end alloc_mnptr
+static size_t JoinDimLen(int ncid, char *dimname)
+{
+  int retval, dimid;
+  size_t dimlen;
+
+  if ((retval = nc_inq_dimid(ncid,dimname,&dimid)))
+    ERR(retval);
+  if ((retval = nc_inq_dimlen(ncid,dimid,&dimlen)))
+    ERR(retval);
+  return dimlen;
+}
 
 /*
- * Function: alloc_eptr()
- * -------------------------
+ * Function: JoinReadInt
+ * Usage: JoinReadInt(ncid,"mnptr",grid->mnptr);
+ * ---------------------------------------------
+ * Reads an entire integer variable.
  *
  */
-static void alloc_eptr(int ncproc, int Nelocal, ptrT *ptr, int myproc){
-    int j, varid,retval;
-    size_t start[]={0};
-    size_t count[]={Nelocal};
- 
-    //int tmp[Nelocal];
-
-    // Read the data into the array
-    if ((retval = nc_inq_varid(ncproc, "eptr", &varid)))
-	ERR(retval);
-    if ((retval = nc_get_vara_int(ncproc, varid, start, count, &ptr->nctmpint[0] )))
-	ERR(retval);
+static void JoinReadInt(int ncid, char *vname, int *tmparray)
+{
+  int retval, varid;
 
-    for(j=0;j<Nelocal;j++){
-    	ptr->eptr[myproc][j]=ptr->nctmpint[j];
-    }
+  if ((retval = nc_inq_varid(ncid,vname,&varid)))
+    ERR(retval);
+  if ((retval = nc_get_var_int(ncid,varid,tmparray)))
+    ERR(retval);
 }
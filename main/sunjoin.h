@@ -1,15 +1,73 @@
+/*
+ * File: sunjoin.h
+ * ---------------
+ * Header file for the parallel netcdf joining program sunjoin.
+ *
+ */
 #ifndef _sunjoin_h
 #define _sunjoin_h
 
-typedef struct _ptrT {
-    int **mnptr;
-    int **eptr;
+#include "suntans.h"
 
-    //Temporary arrays for netcdf reading
-    double *ncscratch;
-    int *nctmpint;
+// Defaults for the command line options (see ParseJoinFlags)
+#define JOINDEFLATELEVEL 1
+#define JOINBUFFERMB 256
+#define JOINMAXOPENFILES 256
+#define JOINCHUNKBYTES 4194304
 
-} ptrT;
-ptrT *ptr;
+// Index type of a variable with respect to the partitioned grid
+enum {
+  JOINOTHER, JOINCELL, JOINEDGE
+};
+
+// Connectivity variables whose values are local indices that must be remapped,
+// and the edge marker whose interprocessor edges are computational edges once joined
+enum {
+  JOINNOREMAP, JOINREMAPCELL, JOINREMAPEDGE, JOINREMAPMARK
+};
+
+/*
+ * Variable description read from the first per-processor file
+ *
+ */
+typedef struct _joinvarT {
+  char name[BUFFERLENGTH];
+  int xtype;
+  int ndims;
+  int dimids[8];
+  int itime;   // index of the time dimension or -1
+  int igrid;   // index of the Nc/Ne dimension or -1
+  int type;    // JOINOTHER, JOINCELL or JOINEDGE
+  int remap;   // JOINNOREMAP, JOINREMAPCELL, JOINREMAPEDGE or JOINREMAPMARK
+} joinvarT;
+
+/*
+ * Partition maps and work description for the joiner
+ *
+ */
+typedef struct _joinT {
+  int Nproc;             // Number of per-processor files
+  int Nc, Ne;            // Size of the joined grid
+  int *Ncp, *Nep;        // Size of each partitioned grid
+  int **mnptr, **eptr;   // Local to global maps
+  int **cellown, **edgeown; // Local indices owned by each processor
+  int *Ncown, *Neown;
+
+  int ntime;             // Number of records in the per-processor files
+  int stepsperfile;      // Records per joined file
+  int nfiles;            // Number of joined files
+
+  int Nvar;
+  joinvarT *var;
+
+  int *ncid;             // Per-processor file ids (-1 when closed)
+  int keepopen;
+
+  int deflatelevel;
+  size_t bufferbytes;
+
+  char infile[BUFFERLENGTH];
+  char basefile[BUFFERLENGTH];
+} joinT;
 
 #endif
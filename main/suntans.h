@@ -16,7 +16,16 @@
 #include "time.h"
 
 // number of faces (for triangle)
+// Floating point type of the arrays.  Building with PRECISION=single in
+// Makefile.in (-DSINGLEPRECISION) stores them in single precision, while
+// sums, timers, times, the grid coordinates and metrics and the free-surface
+// solver use DREAL.
+#ifdef SINGLEPRECISION
+#define REAL float
+#else
 #define REAL double
+#endif
+#define DREAL double
 #define BUFFERLENGTH 256
 #define NUMEDGECOLUMNS 3
 #define BREAK printf("%d\n",*((int *)0));
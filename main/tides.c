@@ -6,6 +6,21 @@
  * Contains functions that read/write data for specification of tidal
  * components at boundaries of type 2.
  *
+ * With tideforcing=1 the tidal forcing engine (InitTideForcing,
+ * UpdateTideForcing and TideForcing) sets the boundary values from the
+ * partition-independent TideFile instead of the per-processor TideInput
+ * files.  The boundary values are the sums over the constituents of
+ *
+ *   f*A*cos(V0+u-G)
+ *
+ * with the amplitude A and Greenwich phase lag G of each boundary point, and
+ * the nodal factor f, nodal angle u and equilibrium argument V0 of each
+ * constituent at the time basetime+nctime.  The astronomical terms are
+ * computed once per day (tidenodal=1), and between the daily updates the
+ * phasors exp(i(V0+u)) are advanced with their rotation over the time step,
+ * so that each time step only requires a sum of products of the phasors and
+ * the coefficients A*cos(G) and A*sin(G) of each point.
+ *
  * Copyright (C) 2005-2006 The Board of Trustees of the Leland Stanford Junior 
  * University. All Rights Reserved.
  *
@@ -15,9 +30,78 @@
 #include "grid.h"
 #include "tides.h"
 #include "memory.h"
+#include "mympi.h"
+#include "kdtree.h"
+#include <ctype.h>
+#include <string.h>
 
 static void InitTidalArrays(int N);
 static void ReadTidalArrays(FILE *ifid, char *istr, int N);
+static int ConstituentIndex(char *name);
+static void NodalCorrections(DREAL mjd, DREAL *f, DREAL *u);
+static DREAL EquilibriumArgument(int c, DREAL mjd);
+static DREAL DateToMJD(char *date);
+
+/*
+ * Nodal corrections of the constituents (Schureman, 1958), in terms of those of
+ * M2, K1, O1, K2, J1, OO1, Mf and Mm.  L2 uses the correction of M2.
+ *
+ */
+enum {NODALNONE, NODALM2, NODALK1, NODALO1, NODALK2, NODALJ1, NODALOO1, NODALMF, NODALMM,
+      NODALM3, NODALMK3, NODALM4, NODALM6, NODALM8};
+
+/*
+ * Standard tidal constituents and their speeds in degrees per hour, used
+ * to look up the frequencies of the constituents by name.  The equilibrium
+ * argument is V0 = nT*T + ns*s + nh*h + np*p + np1*p1 + phase (degrees),
+ * where T is the hour angle of the mean sun plus 180 degrees, s, h, p and p1
+ * are the mean longitudes of the moon, sun, lunar perigee and solar perigee.
+ *
+ */
+static struct {
+  char *name;
+  REAL speed;
+  int nT, ns, nh, np, np1;
+  REAL phase;
+  int nodal;
+} constituents[] = {
+  {"M2",28.9841042,2,-2,2,0,0,0,NODALM2}, {"S2",30.0000000,2,0,0,0,0,0,NODALNONE},
+  {"N2",28.4397295,2,-3,2,1,0,0,NODALM2}, {"K2",30.0821373,2,0,2,0,0,0,NODALK2},
+  {"2N2",27.8953548,2,-4,2,2,0,0,NODALM2}, {"MU2",27.9682084,2,-4,4,0,0,0,NODALM2},
+  {"NU2",28.5125831,2,-3,4,-1,0,0,NODALM2}, {"L2",29.5284789,2,-1,2,-1,0,180,NODALM2},
+  {"T2",29.9589333,2,0,-1,0,1,0,NODALNONE}, {"K1",15.0410686,1,0,1,0,0,-90,NODALK1},
+  {"O1",13.9430356,1,-2,1,0,0,90,NODALO1}, {"P1",14.9589314,1,0,-1,0,0,90,NODALNONE},
+  {"Q1",13.3986609,1,-3,1,1,0,90,NODALO1}, {"J1",15.5854433,1,1,1,-1,0,-90,NODALJ1},
+  {"OO1",16.1391017,1,2,1,0,0,-90,NODALOO1}, {"S1",15.0000000,1,0,0,0,0,180,NODALNONE},
+  {"M3",43.4761563,3,-3,3,0,0,180,NODALM3}, {"MK3",44.0251729,3,-2,3,0,0,-90,NODALMK3},
+  {"M4",57.9682084,4,-4,4,0,0,0,NODALM4}, {"MS4",58.9841042,4,-2,2,0,0,0,NODALM2},
+  {"MN4",57.4238337,4,-5,4,1,0,0,NODALM4}, {"S4",60.0000000,4,0,0,0,0,0,NODALNONE},
+  {"M6",86.9523127,6,-6,6,0,0,0,NODALM6}, {"M8",115.9364166,8,-8,8,0,0,0,NODALM8},
+  {"MF",1.0980331,0,2,0,0,0,0,NODALMF}, {"MM",0.5443747,0,1,0,-1,0,0,NODALMM},
+  {"SSA",0.0821373,0,0,2,0,0,0,NODALNONE}, {"SA",0.0410686,0,0,1,0,0,0,NODALNONE}
+};
+#define NUMCONSTITUENTS (sizeof(constituents)/sizeof(constituents[0]))
+
+/*
+ * Private type: state of the tidal forcing engine on the local boundary
+ * points, which are the type-2 edges followed by the type-3 cells as in the
+ * TideInput files.
+ *
+ */
+typedef struct _tideT {
+  int Ncon, Nloc, nodal;
+  int *con;             // index of each constituent in constituents[]
+  REAL **hc, **hs;      // A*cos(G) and A*sin(G) of the free surface at each point
+  REAL **uc, **us, **vc, **vs; // and of the easting and northing velocities
+  DREAL mjd0;           // Modified Julian date of basetime
+  DREAL tday, tlast, dtrot; // start of the day of the nodal corrections, last update and its time step
+  DREAL *f, *u;         // nodal factors and angles (radians)
+  DREAL *cosp, *sinp;   // phasor exp(i(V0+u)) of each constituent at tlast
+  DREAL *cosr, *sinr;   // rotation of the phasors over dtrot
+  REAL *C, *S;          // f*cos(V0+u) and f*sin(V0+u) at tlast
+} tideT;
+
+static tideT tide;
 
 /*
  * Function: SetTideComponents
@@ -107,6 +191,392 @@ void SetTideComponents(gridT *grid, int myproc) {
   }
 }
 
+/*
+ * Function: TidalFrequency
+ * Usage: omega = TidalFrequency("M2");
+ * ------------------------------------
+ * Returns the frequency in rad/s of the tidal constituent with the given
+ * name (case insensitive), or -1 if it is not a known constituent.
+ *
+ */
+REAL TidalFrequency(char *name) {
+  int i=ConstituentIndex(name);
+
+  if(i<0)
+    return -1;
+  return constituents[i].speed*PI/180.0/3600.0;
+}
+
+/*
+ * Function: ConstituentIndex
+ * Usage: c = ConstituentIndex("M2");
+ * ----------------------------------
+ * Returns the index in constituents[] of the constituent with the given name
+ * (case insensitive), or -1 if it is not a known constituent.
+ *
+ */
+static int ConstituentIndex(char *name) {
+  int i, j;
+  char str[BUFFERLENGTH];
+
+  for(j=0;name[j]!='\0' && j<BUFFERLENGTH-1;j++)
+    str[j]=toupper(name[j]);
+  str[j]='\0';
+
+  for(i=0;i<NUMCONSTITUENTS;i++)
+    if(!strcmp(str,constituents[i].name))
+      return i;
+  return -1;
+}
+
+/*
+ * Function: InitTideForcing
+ * Usage: InitTideForcing(grid,prop,myproc);
+ * -----------------------------------------
+ * Reads the constituents at the boundary points from TideFile and matches the
+ * local type-2 edges and type-3 cells with their points, so that the same file
+ * is used with any number of processors.  The text file contains
+ *
+ * Ncon Npoints
+ * name[0] ... name[Ncon-1]
+ *
+ * followed by one line for each point with its coordinates x y and then, for
+ * each constituent, the amplitudes and Greenwich phase lags (degrees) of the
+ * free surface (m) and of the easting and northing velocities (m/s):
+ *
+ * x y h_amp[0] h_phase[0] u_amp[0] u_phase[0] v_amp[0] v_phase[0] h_amp[1] ...
+ *
+ * The points are those written to TideOutput (edge centers and cell centers)
+ * and each boundary point must be within TIDEMATCHDIST of a point in the file.
+ *
+ */
+void InitTideForcing(gridT *grid, propT *prop, int myproc) {
+  int i, j, n, m, loc, Ne2, Npoints, flag=0;
+  char filename[BUFFERLENGTH], str[BUFFERLENGTH];
+  REAL *data, dist2;
+  DREAL *x, *y, xb, yb;
+  double xd, yd, val;
+  kdtreeT *tree;
+  FILE *ifid;
+
+  MPI_GetFile(filename,DATAFILE,"TideFile","InitTideForcing",myproc);
+  if(VERBOSE>2 && myproc==0) printf("Reading tidal constituents from %s.\n",filename);
+
+  if((ifid=fopen(filename,"r"))==NULL) {
+    printf("Error opening %s!\n",filename);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  if(fscanf(ifid,"%d %d",&tide.Ncon,&Npoints)!=2 || tide.Ncon<=0 || Npoints<=0) {
+    printf("Error reading the number of constituents and points in %s.\n",filename);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  tide.con = (int *)SunMalloc(tide.Ncon*sizeof(int),"InitTideForcing");
+  for(n=0;n<tide.Ncon;n++) {
+    if(fscanf(ifid,"%s",str)!=1 || (tide.con[n]=ConstituentIndex(str))<0) {
+      printf("Error in %s: unknown tidal constituent %s.\n",filename,str);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  x = (DREAL *)SunMalloc(Npoints*sizeof(DREAL),"InitTideForcing");
+  y = (DREAL *)SunMalloc(Npoints*sizeof(DREAL),"InitTideForcing");
+  data = (REAL *)SunMalloc(6*tide.Ncon*Npoints*sizeof(REAL),"InitTideForcing");
+  for(i=0;i<Npoints && !flag;i++) {
+    if(fscanf(ifid,"%lf %lf",&xd,&yd)!=2)
+      flag=1;
+    x[i]=xd;
+    y[i]=yd;
+    for(m=0;m<6*tide.Ncon && !flag;m++) {
+      if(fscanf(ifid,"%lf",&val)!=1)
+	flag=1;
+      data[6*tide.Ncon*i+m]=val;
+    }
+  }
+  fclose(ifid);
+  if(flag) {
+    printf("Error reading tidal data.  Only %d of %d points in %s.\n",i-1,Npoints,filename);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  Ne2 = grid->edgedist[3]-grid->edgedist[2];
+  tide.Nloc = Ne2+grid->celldist[2]-grid->celldist[1];
+  tide.hc = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+  tide.hs = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+  tide.uc = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+  tide.us = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+  tide.vc = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+  tide.vs = (REAL **)SunMalloc(tide.Nloc*sizeof(REAL *),"InitTideForcing");
+
+  // Match the boundary points with the points in the file
+  tree = KDTreeBuild(x,y,NULL,Npoints);
+  for(loc=0;loc<tide.Nloc;loc++) {
+    if(loc<Ne2) {
+      j = grid->edgep[grid->edgedist[2]+loc];
+      xb = grid->xe[j];
+      yb = grid->ye[j];
+    } else {
+      i = grid->cellp[grid->celldist[1]+loc-Ne2];
+      xb = grid->xv[i];
+      yb = grid->yv[i];
+    }
+    i = KDTreeNearest(tree,xb,yb,&dist2);
+    if(dist2>TIDEMATCHDIST*TIDEMATCHDIST) {
+      printf("Error in %s: no point at boundary point %f %f on processor %d.\n",filename,xb,yb,myproc);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+
+    tide.hc[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    tide.hs[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    tide.uc[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    tide.us[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    tide.vc[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    tide.vs[loc] = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+    for(n=0;n<tide.Ncon;n++) {
+      m = 6*(tide.Ncon*i+n);
+      tide.hc[loc][n] = data[m]*cos(data[m+1]*PI/180);
+      tide.hs[loc][n] = data[m]*sin(data[m+1]*PI/180);
+      tide.uc[loc][n] = data[m+2]*cos(data[m+3]*PI/180);
+      tide.us[loc][n] = data[m+2]*sin(data[m+3]*PI/180);
+      tide.vc[loc][n] = data[m+4]*cos(data[m+5]*PI/180);
+      tide.vs[loc][n] = data[m+4]*sin(data[m+5]*PI/180);
+    }
+  }
+  KDTreeFree(tree);
+  SunFree(x,Npoints*sizeof(DREAL),"InitTideForcing");
+  SunFree(y,Npoints*sizeof(DREAL),"InitTideForcing");
+  SunFree(data,6*tide.Ncon*Npoints*sizeof(REAL),"InitTideForcing");
+
+  tide.f = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.u = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.cosp = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.sinp = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.cosr = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.sinr = (DREAL *)SunMalloc(tide.Ncon*sizeof(DREAL),"InitTideForcing");
+  tide.C = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+  tide.S = (REAL *)SunMalloc(tide.Ncon*sizeof(REAL),"InitTideForcing");
+
+  tide.nodal = prop->tidenodal;
+  tide.mjd0 = DateToMJD(prop->basetime);
+  tide.tday = -INFTY;
+  tide.tlast = -INFTY;
+  tide.dtrot = 0;
+
+  // Frequencies of the constituents, e.g. for TidalConstituents boundary in analysis.c
+  numtides = tide.Ncon;
+  omegas = (REAL *)SunMalloc(numtides*sizeof(REAL),"InitTideForcing");
+  for(n=0;n<numtides;n++)
+    omegas[n]=constituents[tide.con[n]].speed*PI/180.0/3600.0;
+}
+
+/*
+ * Function: UpdateTideForcing
+ * Usage: UpdateTideForcing(prop);
+ * -------------------------------
+ * Advances the phasors of the constituents to the time prop->nctime.  At the
+ * first call of each day the nodal corrections are computed at noon of that day
+ * and the phasors are set from the equilibrium arguments, and at the other calls
+ * they are rotated by the time since the last call, which only requires trigonometric
+ * functions when the time step changes.  With tidenodal=0, f=1 and V0+u is
+ * omega*nctime.
+ *
+ */
+void UpdateTideForcing(propT *prop) {
+  int n;
+  DREAL t=prop->nctime, dt, day, theta, cosp;
+
+  if(t==tide.tlast)
+    return;
+
+  if(t<tide.tday || t>=tide.tday+86400.0) {
+    day = floor(tide.mjd0+t/86400.0);
+    tide.tday = (day-tide.mjd0)*86400.0;
+
+    if(tide.nodal)
+      NodalCorrections(day+0.5,tide.f,tide.u);
+    for(n=0;n<tide.Ncon;n++) {
+      if(tide.nodal)
+	theta = EquilibriumArgument(tide.con[n],tide.mjd0+t/86400.0)+tide.u[n];
+      else {
+	tide.f[n] = 1;
+	theta = fmod(constituents[tide.con[n]].speed/3600.0*t,360.0)*PI/180.0;
+      }
+      tide.cosp[n] = cos(theta);
+      tide.sinp[n] = sin(theta);
+    }
+  } else {
+    dt = t-tide.tlast;
+    if(dt!=tide.dtrot) {
+      tide.dtrot = dt;
+      for(n=0;n<tide.Ncon;n++) {
+	theta = fmod(constituents[tide.con[n]].speed/3600.0*dt,360.0)*PI/180.0;
+	tide.cosr[n] = cos(theta);
+	tide.sinr[n] = sin(theta);
+      }
+    }
+    for(n=0;n<tide.Ncon;n++) {
+      cosp = tide.cosp[n]*tide.cosr[n]-tide.sinp[n]*tide.sinr[n];
+      tide.sinp[n] = tide.sinp[n]*tide.cosr[n]+tide.cosp[n]*tide.sinr[n];
+      tide.cosp[n] = cosp;
+    }
+  }
+  tide.tlast = t;
+
+  for(n=0;n<tide.Ncon;n++) {
+    tide.C[n] = tide.f[n]*tide.cosp[n];
+    tide.S[n] = tide.f[n]*tide.sinp[n];
+  }
+}
+
+/*
+ * Function: TideForcing
+ * Usage: TideForcing(jind,&h,&u,&v);
+ * ----------------------------------
+ * Free surface and easting and northing velocities at boundary point jind (the
+ * type-2 edges jptr-edgedist[2] followed by the type-3 cells) at the time of
+ * the last call to UpdateTideForcing.
+ *
+ */
+void TideForcing(int jind, REAL *h, REAL *u, REAL *v) {
+  int n;
+  REAL *C=tide.C, *S=tide.S;
+
+  *h=*u=*v=0;
+  for(n=0;n<tide.Ncon;n++) {
+    *h+=tide.hc[jind][n]*C[n]+tide.hs[jind][n]*S[n];
+    *u+=tide.uc[jind][n]*C[n]+tide.us[jind][n]*S[n];
+    *v+=tide.vc[jind][n]*C[n]+tide.vs[jind][n]*S[n];
+  }
+}
+
+/*
+ * Function: NodalCorrections
+ * Usage: NodalCorrections(mjd,f,u);
+ * ---------------------------------
+ * Nodal factors f and angles u (radians) of the constituents of the tidal
+ * forcing engine at the Modified Julian date mjd.
+ *
+ */
+static void NodalCorrections(DREAL mjd, DREAL *f, DREAL *u) {
+  int n;
+  DREAL N, fM2, uM2, fK1, uK1;
+
+  // Longitude of the ascending node of the moon
+  N = (125.0445550-0.05295377*(mjd-51544.5))*PI/180;
+
+  fM2 = 1.0004-0.0373*cos(N)+0.0002*cos(2*N);
+  uM2 = -2.14*sin(N);
+  fK1 = 1.0060+0.1150*cos(N)-0.0088*cos(2*N)+0.0006*cos(3*N);
+  uK1 = -8.86*sin(N)+0.68*sin(2*N)-0.07*sin(3*N);
+
+  for(n=0;n<tide.Ncon;n++) {
+    switch(constituents[tide.con[n]].nodal) {
+    case NODALM2:
+      f[n]=fM2;
+      u[n]=uM2;
+      break;
+    case NODALK1:
+      f[n]=fK1;
+      u[n]=uK1;
+      break;
+    case NODALO1:
+      f[n]=1.0089+0.1871*cos(N)-0.0147*cos(2*N)+0.0014*cos(3*N);
+      u[n]=10.80*sin(N)-1.34*sin(2*N)+0.19*sin(3*N);
+      break;
+    case NODALK2:
+      f[n]=1.0241+0.2863*cos(N)+0.0083*cos(2*N)-0.0015*cos(3*N);
+      u[n]=-17.74*sin(N)+0.68*sin(2*N)-0.04*sin(3*N);
+      break;
+    case NODALJ1:
+      f[n]=1.0129+0.1676*cos(N)-0.0170*cos(2*N)+0.0016*cos(3*N);
+      u[n]=-12.94*sin(N)+1.34*sin(2*N)-0.19*sin(3*N);
+      break;
+    case NODALOO1:
+      f[n]=1.1027+0.6504*cos(N)+0.0317*cos(2*N)-0.0014*cos(3*N);
+      u[n]=-36.68*sin(N)+4.02*sin(2*N)-0.57*sin(3*N);
+      break;
+    case NODALMF:
+      f[n]=1.043+0.414*cos(N);
+      u[n]=-23.74*sin(N)+2.68*sin(2*N)-0.38*sin(3*N);
+      break;
+    case NODALMM:
+      f[n]=1.0-0.130*cos(N);
+      u[n]=0;
+      break;
+    case NODALM3:
+      f[n]=pow(fM2,1.5);
+      u[n]=1.5*uM2;
+      break;
+    case NODALMK3:
+      f[n]=fM2*fK1;
+      u[n]=uM2+uK1;
+      break;
+    case NODALM4:
+      f[n]=fM2*fM2;
+      u[n]=2*uM2;
+      break;
+    case NODALM6:
+      f[n]=fM2*fM2*fM2;
+      u[n]=3*uM2;
+      break;
+    case NODALM8:
+      f[n]=fM2*fM2*fM2*fM2;
+      u[n]=4*uM2;
+      break;
+    default:
+      f[n]=1;
+      u[n]=0;
+    }
+    u[n]*=PI/180;
+  }
+}
+
+/*
+ * Function: EquilibriumArgument
+ * Usage: V0 = EquilibriumArgument(c,mjd);
+ * ---------------------------------------
+ * Equilibrium argument (radians) of constituent c at the Modified Julian date
+ * mjd, with the mean longitudes of Meeus (1998).
+ *
+ */
+static DREAL EquilibriumArgument(int c, DREAL mjd) {
+  DREAL D=mjd-51544.5, T, s, h, p, p1, V0;
+
+  T = 180.0+360.0*(mjd-floor(mjd));
+  s = fmod(218.3164591+13.17639648*D,360.0);
+  h = fmod(280.4664567+0.98564736*D,360.0);
+  p = fmod(83.3532465+0.11140353*D,360.0);
+  p1 = fmod(282.9373+0.0000471*D,360.0);
+
+  V0 = constituents[c].nT*T+constituents[c].ns*s+constituents[c].nh*h+
+    constituents[c].np*p+constituents[c].np1*p1+constituents[c].phase;
+  return fmod(V0,360.0)*PI/180;
+}
+
+/*
+ * Function: DateToMJD
+ * Usage: mjd = DateToMJD(prop->basetime);
+ * ---------------------------------------
+ * Modified Julian date of a date string yyyymmdd.HHMMSS (UTC).
+ *
+ */
+static DREAL DateToMJD(char *date) {
+  int year=1990, month=1, day=1, hour=0, minute=0, second=0, a, y, m;
+
+  sscanf(date,"%4d%2d%2d.%2d%2d%2d",&year,&month,&day,&hour,&minute,&second);
+  a = (14-month)/12;
+  y = year+4800-a;
+  m = month+12*a-3;
+  return day+(153*m+2)/5+365*y+y/4-y/100+y/400-32045-2400001+
+    (hour+minute/60.0+second/3600.0)/24.0;
+}
+
 static void InitTidalArrays(int N) {
   int j;
 
@@ -12,7 +12,18 @@
 #ifndef _tides_h
 #define _tides_h
 
+#include "suntans.h"
+#include "grid.h"
+#include "phys.h"
+
+// Largest distance between a boundary point and its point in TideFile
+#define TIDEMATCHDIST 1e-3
+
 void SetTideComponents(gridT *grid, int myproc);
+REAL TidalFrequency(char *name);
+void InitTideForcing(gridT *grid, propT *prop, int myproc);
+void UpdateTideForcing(propT *prop);
+void TideForcing(int jind, REAL *h, REAL *u, REAL *v);
 
 int numtides;
 REAL **u_amp, **v_amp, **h_amp, **u_phase, **v_phase, **h_phase, *omegas;
@@ -20,8 +20,8 @@
  * defined in timer.h.
  *
  */
-extern REAL Timer(void) {
-  return (REAL)MPI_Wtime();
+extern DREAL Timer(void) {
+  return (DREAL)MPI_Wtime();
 }
 
 /*
@@ -31,7 +31,7 @@ extern REAL Timer(void) {
  * 
  */
 void Tic(void) {
-  t_tictoc = (REAL)MPI_Wtime();
+  t_tictoc = (DREAL)MPI_Wtime();
 }
 
 /*
@@ -41,6 +41,6 @@ void Tic(void) {
  * initialization.
  * 
  */
-REAL Toc(void) {
-  return ((REAL)MPI_Wtime() - t_tictoc);
+DREAL Toc(void) {
+  return ((DREAL)MPI_Wtime() - t_tictoc);
 }
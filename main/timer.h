@@ -14,8 +14,8 @@
 
 #include "suntans.h"
 
-// Global variables for timing
-REAL t_start, t_source, t_predictor, t_nonhydro, t_turb, t_transport, t_io, t_comm,
+// Global variables for timing, in double precision for all builds
+DREAL t_start, t_source, t_predictor, t_nonhydro, t_turb, t_transport, t_io, t_comm,
   t_check, t_tictoc;
 
 /*
@@ -26,8 +26,8 @@ REAL t_start, t_source, t_predictor, t_nonhydro, t_turb, t_transport, t_io, t_co
  * defined in timer.h.
  *
  */
-extern REAL Timer(void);
+extern DREAL Timer(void);
 void Tic(void);
-REAL Toc(void);
+DREAL Toc(void);
 
 #endif
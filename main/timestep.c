@@ -0,0 +1,396 @@
+/*
+ * File: timestep.c
+ * ----------------
+ * Advances the simulation time and, when adaptivedt=1 in suntans.dat, adapts
+ * the time step to the maximum Courant number computed in Check():
+ *
+ * adaptivedt     0 - fixed time step dt, 1 - adaptive time step
+ * dtmin, dtmax   bounds of the time step (0 - dt/10 and 10*dt)
+ * dtCtarget      Courant number the time step is adapted to
+ * dtClow         the time step is increased when the Courant number is below dtClow
+ * dtChigh        and decreased when it is above dtChigh
+ * dtgrowth       maximum factor by which the time step is increased at once
+ * DtHistoryFile  file in which processor 0 records the time step history
+ *
+ * The Courant number is max(CmaxU,CmaxW) if thetaM<0.5, otherwise CmaxU, and the
+ * time step only changes on the steps checked by Check (see checkinterval).
+ * Between dtClow and dtChigh the time step is kept, which avoids changing it
+ * at every step.
+ *
+ * dt in suntans.dat remains the nominal time step: nsteps*dt is the length of
+ * the run and ntout, ntoutStore, ntaverage, etc. are output intervals in
+ * units of dt, i.e. output occurs at the simulation times n*ntout*dt.  Steps
+ * are shortened so that they end on the times at which ntout output is due and
+ * on the end of the run, and prop->nsteps holds the estimated number of steps
+ * so that prop->n==prop->nstart+prop->nsteps on the last step.
+ *
+ * The Adams-Bashforth coefficients exfac1..exfac3 of AB2 (ex=2) and AB3 (ex=3) are
+ * recomputed for the variable steps.  Since the explicit terms Cn_U and Cn_W
+ * are stored multiplied by the time step at which they were computed, the
+ * coefficients include the ratios of the time steps.  adaptivedt requires
+ * ex=2 or 3 and the theta method (im=0) for the implicit terms.
+ *
+ * With adaptivedt=1 the store file also holds the simulation time and the time
+ * steps (see StoreTimeStep), so that a restart, which must also use adaptivedt=1,
+ * continues with the same time steps, and nsteps*dt is the length of the
+ * restarted run from the stored time.
+ *
+ */
+#include "suntans.h"
+#include "phys.h"
+#include "mympi.h"
+#include "fileio.h"
+#include "util.h"
+#include "check.h"
+#include "timestep.h"
+
+// Time step state of the adaptive scheme
+static struct {
+  REAL dt0;                  // nominal time step dt from suntans.dat
+  REAL dtmin, dtmax, Ctarget, Clow, Chigh, growth;
+  REAL dtcfl;                // time step set by the Courant number
+  REAL dtold, dtold2;        // time steps of the previous two steps
+  REAL tend;                 // simulation time at the end of the run
+  FILE *fid;                 // time step history (processor 0)
+  int restarted;             // 1 if restart holds the state read by ReadTimeStep
+  REAL restart[NTIMESTEPSTATE];
+} ts;
+
+static REAL CourantNumber(propT *prop);
+static REAL CourantTimeStep(propT *prop, REAL C);
+static void NextTimeStep(propT *prop, REAL C, int myproc);
+static void AdamsBashforthFactors(propT *prop);
+static void WriteTimeStep(propT *prop, REAL C);
+
+/*
+ * Function: InitializeTimeStep
+ * Usage: InitializeTimeStep(prop,myproc);
+ * ---------------------------------------
+ * Reads the adaptive time step parameters from suntans.dat and opens the time
+ * step history file.  In a restart run the time step state read by ReadTimeStep
+ * sets the time and the time step of the first step.
+ *
+ */
+void InitializeTimeStep(propT *prop, int myproc)
+{
+  int status;
+  char str[BUFFERLENGTH], filename[BUFFERLENGTH];
+
+  ts.dt0 = ts.dtcfl = ts.dtold = ts.dtold2 = prop->dt;
+  ts.tend = (prop->nstart+prop->nsteps)*prop->dt;
+  ts.fid = NULL;
+  if(!prop->adaptivedt)
+    return;
+
+  if(prop->ex<2 || prop->im!=0) {
+    if(myproc==0) printf("Error in InitializeTimeStep: adaptivedt=1 requires ex=2 or 3 and im=0.\n");
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  ts.dtmin = MPI_GetValue(DATAFILE,"dtmin","InitializeTimeStep",myproc);
+  ts.dtmax = MPI_GetValue(DATAFILE,"dtmax","InitializeTimeStep",myproc);
+  ts.Ctarget = MPI_GetValue(DATAFILE,"dtCtarget","InitializeTimeStep",myproc);
+  ts.Clow = MPI_GetValue(DATAFILE,"dtClow","InitializeTimeStep",myproc);
+  ts.Chigh = MPI_GetValue(DATAFILE,"dtChigh","InitializeTimeStep",myproc);
+  ts.growth = MPI_GetValue(DATAFILE,"dtgrowth","InitializeTimeStep",myproc);
+  if(ts.dtmin<=0)
+    ts.dtmin = 0.1*ts.dt0;
+  if(ts.dtmax<=0)
+    ts.dtmax = 10*ts.dt0;
+  if(ts.growth<1)
+    ts.growth = 1;
+
+  if(ts.dtmin>ts.dtmax || ts.Clow>ts.Ctarget || ts.Chigh<ts.Ctarget || ts.Chigh>=prop->Cmax) {
+    if(myproc==0)
+      printf("Error in InitializeTimeStep: need dtmin<=dtmax and dtClow<=dtCtarget<=dtChigh<Cmax.\n");
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+
+  if(myproc==0) {
+    GetString(str,DATAFILE,"DtHistoryFile",&status);
+    if(status)
+      MPI_GetFile(filename,DATAFILE,"DtHistoryFile","InitializeTimeStep",myproc);
+    else if(snprintf(filename,BUFFERLENGTH,"%s/%s",DATADIR,DEFAULTDTHISTORYFILE)>=BUFFERLENGTH) {
+      printf("Error in InitializeTimeStep: the path of %s is longer than %d characters.\n",DEFAULTDTHISTORYFILE,BUFFERLENGTH-1);
+      MPI_Finalize();
+      exit(EXIT_FAILURE);
+    }
+    // A restart adds to the history of the stored run
+    ts.fid = MPI_FOpen(filename,ts.restarted?"a":"w","InitializeTimeStep",myproc);
+    if(!ts.restarted)
+      fprintf(ts.fid,"# step time dt Courant\n");
+  }
+
+  // A restart continues with the time and the time steps of the stored run
+  // (see StoreTimeStep), and the run length nsteps*dt starts at its time
+  if(ts.restarted) {
+    prop->rtime = ts.restart[0];
+    prop->nctime = prop->toffSet*86400.0 + prop->rtime;
+    ts.tend = prop->rtime+prop->nsteps*ts.dt0;
+    prop->dt = ts.restart[1];
+    ts.dtold = ts.restart[2];
+    ts.dtold2 = ts.restart[3];
+    ts.dtcfl = ts.restart[5];
+    NextTimeStep(prop,ts.restart[4],myproc);
+  } else if(myproc==0)
+    WriteTimeStep(prop,0);
+}
+
+/*
+ * Function: AdvanceTime
+ * Usage: AdvanceTime(prop);
+ * -------------------------
+ * Sets the simulation and netcdf times at the end of step prop->n and the
+ * Adams-Bashforth coefficients for the time steps of the last three steps.
+ *
+ */
+void AdvanceTime(propT *prop)
+{
+  if(!prop->adaptivedt) {
+    prop->rtime = prop->n*prop->dt;
+    prop->nctime = prop->toffSet*86400.0 + prop->n*prop->dt;
+    return;
+  }
+
+  prop->rtime += prop->dt;
+  prop->nctime = prop->toffSet*86400.0 + prop->rtime;
+
+  // Steps 1 and 2 use forward Euler and AB2 with the nominal dt
+  if(prop->n>2)
+    AdamsBashforthFactors(prop);
+}
+
+/*
+ * Function: UpdateTimeStep
+ * Usage: UpdateTimeStep(prop,myproc);
+ * -----------------------------------
+ * Sets the time step of the next step from the Courant number of the current
+ * step, shortened so that it does not step over the next ntout output time or
+ * the end of the run, and updates the estimated number of steps prop->nsteps.
+ * Called at the end of a step on all processors, which must have the reduced
+ * CmaxU and CmaxW.
+ *
+ */
+void UpdateTimeStep(propT *prop, int myproc)
+{
+  REAL C;
+
+  if(!prop->adaptivedt)
+    return;
+
+  if(ts.tend-prop->rtime<=1e-6*ts.dtmin) {
+    prop->nsteps = prop->n-prop->nstart;
+    return;
+  }
+
+  C = CourantNumber(prop);
+  ts.dtcfl = CourantTimeStep(prop,C);
+  NextTimeStep(prop,C,myproc);
+}
+
+/*
+ * Function: StoreTimeStep
+ * Usage: StoreTimeStep(prop,prop->StoreFID);
+ * ------------------------------------------
+ * Writes the time step state at the end of step prop->n to the store file when
+ * adaptivedt=1: the simulation time, the time steps of the last three steps and
+ * the time step set by the Courant number of the current step, along with that
+ * Courant number.  Called before UpdateTimeStep.
+ *
+ */
+void StoreTimeStep(propT *prop, FILE *fid)
+{
+  REAL state[NTIMESTEPSTATE];
+
+  if(!prop->adaptivedt)
+    return;
+
+  state[0] = prop->rtime;
+  state[1] = prop->dt;
+  state[2] = ts.dtold;
+  state[3] = ts.dtold2;
+  state[4] = CourantNumber(prop);
+  state[5] = CourantTimeStep(prop,state[4]);
+  fwrite(state,sizeof(REAL),NTIMESTEPSTATE,fid);
+}
+
+/*
+ * Function: ReadTimeStep
+ * Usage: ReadTimeStep(prop,prop->StartFID);
+ * -----------------------------------------
+ * Reads the time step state written by StoreTimeStep when adaptivedt=1, which
+ * InitializeTimeStep uses to continue the run with the time step it would have
+ * had without the restart.
+ *
+ */
+void ReadTimeStep(propT *prop, FILE *fid)
+{
+  if(!prop->adaptivedt)
+    return;
+
+  if(fread(ts.restart,sizeof(REAL),NTIMESTEPSTATE,fid) != NTIMESTEPSTATE)
+    printf("Error reading the time step state\n");
+  ts.restarted = 1;
+}
+
+/*
+ * Function: CourantNumber
+ * Usage: C = CourantNumber(prop);
+ * -------------------------------
+ * Returns the Courant number of the steps of length dtcfl.
+ *
+ */
+static REAL CourantNumber(propT *prop)
+{
+  REAL C;
+
+  C = prop->CmaxU;
+  if(prop->thetaM<0.5 && prop->CmaxW>C)
+    C = prop->CmaxW;
+  return C*ts.dtcfl/prop->dt;
+}
+
+/*
+ * Function: CourantTimeStep
+ * Usage: ts.dtcfl = CourantTimeStep(prop,C);
+ * ------------------------------------------
+ * Returns the time step set by the Courant number C of the current step.
+ *
+ */
+static REAL CourantTimeStep(propT *prop, REAL C)
+{
+  REAL dt=ts.dtcfl;
+
+  // Steps 1 and 2 keep the nominal dt (see AdvanceTime)
+  if(CheckActive() && prop->n>=2) {
+    if(C>ts.Chigh)
+      dt *= ts.Ctarget/C;
+    else if(C<ts.Clow)
+      dt *= Min(ts.growth,ts.Ctarget/Max(C,SMALL));
+    dt = Max(ts.dtmin,Min(ts.dtmax,dt));
+  }
+  return dt;
+}
+
+/*
+ * Function: NextTimeStep
+ * Usage: NextTimeStep(prop,C,myproc);
+ * -----------------------------------
+ * Sets the time step of the next step from dtcfl, shortened so that it does not
+ * step over the next ntout output time or the end of the run, and updates the
+ * estimated number of steps prop->nsteps.
+ *
+ */
+static void NextTimeStep(propT *prop, REAL C, int myproc)
+{
+  REAL dt, tnext, remaining, eps=1e-6*ts.dtmin;
+
+  // End on the next output time or on the end of the run, in two equal steps
+  // rather than leaving a very short one
+  tnext = ts.dt0*prop->ntout*(floor(prop->rtime/(ts.dt0*prop->ntout)+1e-6)+1);
+  tnext = Min(tnext,ts.tend);
+  remaining = tnext-prop->rtime;
+  dt = ts.dtcfl;
+  if(dt>=remaining-eps)
+    dt = remaining;
+  else if(dt>0.5*remaining)
+    dt = 0.5*remaining;
+
+  ts.dtold2 = ts.dtold;
+  ts.dtold = prop->dt;
+  if(dt!=prop->dt) {
+    prop->dt = dt;
+    if(myproc==0)
+      WriteTimeStep(prop,C);
+  }
+
+  if(ts.tend-prop->rtime<=dt+eps)
+    prop->nsteps = prop->n+1-prop->nstart;
+  else
+    prop->nsteps = prop->n+1-prop->nstart+(int)ceil((ts.tend-prop->rtime-dt)/ts.dtcfl-1e-6);
+}
+
+/*
+ * Function: IntervalDue
+ * Usage: if(IntervalDue(prop,prop->ntout)) {...}
+ * ----------------------------------------------
+ * Returns 1 if output with an interval of the given number of steps is due at
+ * the current step.  With adaptivedt=1 the interval is in units of the nominal
+ * time step and output is due at the first step that reaches its time.
+ *
+ */
+int IntervalDue(propT *prop, int interval)
+{
+  REAL T;
+
+  if(interval<=0)
+    return 0;
+  if(!prop->adaptivedt)
+    return !(prop->n%interval);
+
+  T = interval*ts.dt0;
+  return floor(prop->rtime/T+1e-6)>floor((prop->rtime-prop->dt)/T+1e-6);
+}
+
+/*
+ * Function: CloseTimeStep
+ * Usage: CloseTimeStep(prop,myproc);
+ * ----------------------------------
+ * Closes the time step history file.
+ *
+ */
+void CloseTimeStep(propT *prop, int myproc)
+{
+  if(ts.fid!=NULL) {
+    fclose(ts.fid);
+    ts.fid = NULL;
+  }
+}
+
+/*
+ * Function: AdamsBashforthFactors
+ * Usage: AdamsBashforthFactors(prop);
+ * -----------------------------------
+ * Variable step AB2 and AB3 coefficients of the explicit terms Cn stored at the
+ * previous steps.  With h, h1 and h2 the current and previous two time steps, the
+ * coefficients b0, b1, b2 of the explicit tendencies at the last three steps are
+ * the averages over [0,h] of their Lagrange polynomials through 0, -h1 and -h1-h2,
+ * and Cn at the previous steps holds h1 and h2 times the tendencies, so
+ * exfac2=b1*h/h1 and exfac3=b2*h/h2.  For constant steps these reduce to
+ * 3/2, -1/2 and 23/12, -4/3, 5/12.
+ *
+ */
+static void AdamsBashforthFactors(propT *prop)
+{
+  REAL h=prop->dt, h1=ts.dtold, h2=ts.dtold2, b0, b1, b2;
+
+  if(prop->ex==2) {
+    b0 = 1+0.5*h/h1;
+    b1 = -0.5*h/h1;
+    prop->exfac1 = b0;
+    prop->exfac2 = b1*h/h1;
+    prop->exfac3 = 0;
+  } else {
+    b0 = (h*h/3+0.5*h*(2*h1+h2)+h1*(h1+h2))/(h1*(h1+h2));
+    b1 = -(h*h/3+0.5*h*(h1+h2))/(h1*h2);
+    b2 = (h*h/3+0.5*h*h1)/(h2*(h1+h2));
+    prop->exfac1 = b0;
+    prop->exfac2 = b1*h/h1;
+    prop->exfac3 = b2*h/h2;
+  }
+}
+
+/*
+ * Function: WriteTimeStep
+ * Usage: WriteTimeStep(prop,C);
+ * -----------------------------
+ * Records the time step of the steps following step prop->n.
+ *
+ */
+static void WriteTimeStep(propT *prop, REAL C)
+{
+  fprintf(ts.fid,"%d %.6e %.6e %.4f\n",prop->n,prop->rtime,prop->dt,C);
+  fflush(ts.fid);
+}
@@ -0,0 +1,27 @@
+/*
+ * File: timestep.h
+ * ----------------
+ * Header file for timestep.c, which advances the simulation time and adapts
+ * the time step to the Courant number when adaptivedt=1.
+ *
+ */
+#ifndef _timestep_h
+#define _timestep_h
+
+#include "suntans.h"
+#include "phys.h"
+
+#define DEFAULTDTHISTORYFILE "dthistory.dat"
+
+// Number of values of the time step state in the store file (see StoreTimeStep)
+#define NTIMESTEPSTATE 6
+
+void InitializeTimeStep(propT *prop, int myproc);
+void AdvanceTime(propT *prop);
+void UpdateTimeStep(propT *prop, int myproc);
+void StoreTimeStep(propT *prop, FILE *fid);
+void ReadTimeStep(propT *prop, FILE *fid);
+int IntervalDue(propT *prop, int interval);
+void CloseTimeStep(propT *prop, int myproc);
+
+#endif
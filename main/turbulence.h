@@ -18,6 +18,47 @@
 // Background length scale
 #define LBACKGROUND 1e-12
 
+// Values of turbmodel
+#define TURBMY25 1
+#define TURBKEPSILON 2
+
+// Minimum turbulent kinetic energy and dissipation of the k-epsilon model
+#define KMIN 1e-10
+#define EPSMIN 1e-14
+
+// Number of transported turbulence quantities (q^2 and q^2 l, or k and epsilon)
+#define NTURB 2
+
+// Number of columns whose tridiagonal systems are solved together in UpdateTurbulence
+#define TURBBATCH 16
+
+/*
+ * Work space of the turbulence models, which advance both of the transported
+ * quantities of a column together.
+ *
+ */
+typedef struct _turbulenceT {
+  REAL ***src1, ***src2; // implicit sink coefficient and explicit source of each quantity [NTURB][Nc][Nk]
+  REAL **Ftop, **Fbot; // values of each quantity at the free surface and at the bed [NTURB][Nc]
+  REAL ***boundary; // values of each quantity at the type 2 and 3 boundaries [NTURB][Nb][Nke+1]
+  REAL ***SfHp, ***SfHm; // face values of each quantity for the TVD scheme [NTURB][Ne][Nke]
+  REAL ***Fh; // horizontal advective flux of each quantity through each face [NTURB][Ne][Nke]
+  REAL ***SumQC; // TVD limiter sums, with the shared inflow flux in SumQC[NTURB] [NTURB+1][Nc][Nk]
+  REAL *ra, *rb, *rc, *rd; // rows of the tridiagonal systems, contiguous for each column [NTURB*TURBBATCH*Nkmax]
+  REAL *a, *b, *c, *d, *x; // the same systems interleaved for TriSolveBatch [NTURB*TURBBATCH*Nkmax]
+  REAL *ap, *am; // vertical advection coefficients of a quantity [Nkmax+1]
+  REAL *bd; // vertical diffusion coefficients with kappa, then with kappa/sigma[n] [(NTURB+1)*(Nkmax+1)]
+  REAL *hs; // horizontal advection of both quantities in a column [NTURB*Nkmax]
+  REAL *av, *ac, *acold; // area ratios Acveff/Ac [Nkmax+1], Acceff/Ac and Acceffold/Ac [Nkmax] of a column
+  REAL *dudz, *dvdz, *drdz, *S2, *N2; // shear and stratification of a column [Nkmax+1]
+  int *bedge; // last type 2 or 3 boundary edge of each cell, or -1 [Nc]
+  int *elist; // faces of the advanced columns, each listed once [Ne]
+  unsigned char *eflag; // marks the faces already in elist, cleared after use [Ne]
+} turbulenceT;
+
+void AllocateTurbulence(gridT *grid, physT *phys, propT *prop);
+void FreeTurbulence(gridT *grid, physT *phys, propT *prop);
 void my25(gridT *grid, physT *phys, propT *prop, REAL **wnew, REAL **q, REAL **q_old, REAL **l, REAL **l_old, REAL **Cn_q, REAL **Cn_l, REAL **nuT, REAL **kappaT, MPI_Comm comm, int myproc);
+void kepsilon(gridT *grid, physT *phys, propT *prop, REAL **wnew, REAL **q, REAL **q_old, REAL **l, REAL **l_old, REAL **nuT, REAL **kappaT, MPI_Comm comm, int myproc);
 //void my25(gridT *grid, physT *phys, propT *prop, REAL **q, REAL **l, REAL **Cn_q, REAL **Cn_l, REAL **nuT, REAL **kappaT, MPI_Comm comm, int myproc) ;
 #endif
@@ -124,6 +124,111 @@ void HorizontalFaceScalars(gridT *grid, physT *phys, propT *prop, REAL **scal, R
   }
 }
 
+/*
+ * Function: HorizontalFaceScalarClasses
+ * Usage: HorizontalFaceScalarClasses(grid,phys,prop,sediments->SediC_old,sediments->boundary_sediC,
+ *                                    sediments->Nsize,sediments->SumQC,sediments->SfHp,sediments->SfHm,
+ *                                    prop->TVDtemp,comm,myproc);
+ * ---------------------------------------------------------------------------
+ * Same as HorizontalFaceScalars for the N scalars scal[0..N-1] that are advected
+ * by the same velocity field.  The sum of the inflow fluxes sumQ does not depend
+ * on the scalar, so it is computed once and stored in sumQC[N], and it is
+ * exchanged together with the sums sumQC[0..N-1] of the scalars in one message.
+ * The face values of scalar m are stored in SfHp[m] and SfHm[m].
+ *
+ */
+void HorizontalFaceScalarClasses(gridT *grid, physT *phys, propT *prop, REAL ***scal, REAL ***boundary_scal, int N,
+				 REAL ***sumQC, REAL ***SfHp, REAL ***SfHm, int TVD, MPI_Comm comm, int myproc) 
+{
+  int i, iptr, j, k, m, n, mf, jptr, ib, nc1, nc2, ne, neigh, normal;
+  REAL u_nptheta, Qminus, r, si, sm, psi, **sumQ, fac1, fac2, fac3;
+
+  fac1=prop->imfac1;
+  fac2=prop->imfac2;
+  fac3=prop->imfac3;
+
+  sumQ = sumQC[N];
+
+  for(iptr=grid->celldist[0];iptr<grid->celldist[2];iptr++) {
+    i = grid->cellp[iptr];
+
+    for(k=grid->ctop[i];k<grid->Nk[i];k++) {
+      sumQ[i][k]=0;
+      for(n=0;n<N;n++)
+	sumQC[n][i][k]=0;
+
+      for(mf=0;mf<grid->nfaces[i];mf++) {
+	ne = grid->face[i*grid->maxfaces+mf];
+	neigh = grid->neigh[i*grid->maxfaces+mf];
+	normal = grid->normal[i*grid->maxfaces+mf];
+
+	u_nptheta = normal*(fac1*phys->u[ne][k]+fac2*phys->u_old[ne][k]+fac3*phys->u_old2[ne][k]);
+	Qminus = 0.5*grid->dzf[ne][k]*grid->df[ne]*fabs(u_nptheta-fabs(u_nptheta));
+	if(neigh!=-1)
+	  for(n=0;n<N;n++)
+	    sumQC[n][i][k]+=Qminus*(scal[n][i][k]-scal[n][neigh][k]);
+	sumQ[i][k]+=Qminus;
+      }
+    }
+  }
+  ISendRecvCellData3DN(sumQC,N+1,grid,myproc,comm);
+
+  for(jptr=grid->edgedist[0];jptr<grid->edgedist[1];jptr++) {
+    j = grid->edgep[jptr];
+
+    nc1 = grid->grad[2*j];
+    nc2 = grid->grad[2*j+1];
+
+    for(n=0;n<N;n++)
+      for(k=0;k<grid->etop[j];k++) 
+	SfHp[n][j][k] = SfHm[n][j][k] = 0;
+      
+    for(k=grid->etop[j];k<grid->Nke[j];k++) {
+
+      u_nptheta = fac1*phys->u[j][k]+fac2*phys->u_old[j][k]+fac3*phys->u_old2[j][k];
+
+      if(u_nptheta>0) {
+	i=nc2;
+	m=nc1;
+      } else {
+	i=nc1;
+	m=nc2;
+      }
+
+      for(n=0;n<N;n++) {
+	si=scal[n][i][k];
+	sm=scal[n][m][k];
+
+	if(sumQ[i][k]!=0 && sm!=si)
+	  r=sumQC[n][i][k]/(sumQ[i][k]*(sm-si));
+	else
+	  r=0;
+
+	psi=Psi(r,TVD);
+	SfHp[n][j][k] = scal[n][nc2][k]+0.5*psi*(scal[n][nc1][k]-scal[n][nc2][k]);
+	SfHm[n][j][k] = scal[n][nc1][k]-0.5*psi*(scal[n][nc1][k]-scal[n][nc2][k]);
+      }
+    }
+  }
+
+  // Type 2/3 boundary specifies flux at faces
+  for(jptr=grid->edgedist[2];jptr<grid->edgedist[4];jptr++) {
+    j = grid->edgep[jptr];
+    
+    ib = grid->grad[2*j];
+    
+    for(n=0;n<N;n++) {
+      for(k=0;k<grid->etop[j];k++)
+	SfHp[n][j][k] = SfHm[n][j][k] = 0;
+    
+      for(k=grid->etop[j];k<grid->Nke[j];k++) {
+	SfHp[n][j][k] = boundary_scal[n][jptr-grid->edgedist[2]][k];  // Coming in if u>0
+	SfHm[n][j][k] = scal[n][ib][k];                               // Going out if u<0
+      }
+    }
+  }
+}
+
 /*
  * Function: Psi
  * Usage: Psi(r, TVD);
@@ -26,6 +26,8 @@
 
 void HorizontalFaceScalars(gridT *grid, physT *phys, propT *prop, REAL **scal, REAL **boundary_scal, int TVD,
 			   MPI_Comm comm, int myproc); 
+void HorizontalFaceScalarClasses(gridT *grid, physT *phys, propT *prop, REAL ***scal, REAL ***boundary_scal, int N,
+				 REAL ***sumQC, REAL ***SfHp, REAL ***SfHm, int TVD, MPI_Comm comm, int myproc);
 void GetApAm(REAL *ap, REAL *am, REAL *wp, REAL *wm, REAL *Cp, REAL *Cm, REAL *rp, REAL *rm,
 	     REAL **w, REAL **dzz, REAL **scal, int i, int Nk, int ktop, REAL dt, int TVD);
 void HorizontalFaceU(REAL **uc, gridT *grid, physT *phys, propT *prop, int TVDscheme,
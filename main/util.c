@@ -87,6 +87,17 @@ void ReOrderRealArray(REAL *a, int *order, REAL *tmp, int N, int Num, int *nface
     return;
   } 
 }
+// Same as ReOrderRealArray with Num=1 for the DREAL grid metrics (xv, Ac, df, ...)
+void ReOrderDoubleArray(DREAL *a, int *order, DREAL *tmp, int N)
+{
+  int n;
+
+  for(n=0;n<N;n++)
+    tmp[n]=a[n];
+  for(n=0;n<N;n++)
+    a[n]=tmp[order[n]];
+}
+
 // corrected, make it to include all the possibility
 void ReOrderIntArray(int *a, int *order, int *tmp, int N, int Num, int *nfaces, int *grad, int maxfaces)
 {
@@ -159,6 +170,31 @@ void Interp(REAL *x, REAL *y, REAL *z, int N, REAL *xi, REAL *yi, REAL *zi, int
   free(points);
 }
 
+/*
+ * Function: InPolygon
+ * Usage: if(InPolygon(x,y,xg,yg,N))
+ * ---------------------------------
+ * Returns true if the point (x,y) is contained within the polygon defined by the
+ * N points defined by xg,yg.
+ *
+ * Copyright (c) 1970-2003, Wm. Randolph Franklin
+ * http://www.ecse.rpi.edu/Homepages/wrf/Research/Short_Notes/pnpoly.html
+ *
+ */
+int InPolygon(REAL x, REAL y, REAL *xg, REAL *yg, int N) {
+
+  int i, j=0, in=0;
+
+  for (i=0; i<N; i++) {
+    j++; if (j==N) j=0;
+    if ((yg[i]<y && yg[j]>=y) || (yg[j]<y && yg[i]>=y)) 
+      if (xg[i]+(y-yg[i])/(yg[j]-yg[i])*(xg[j]-xg[i])<x) 
+        in=!in;
+  }
+
+  return in;
+}
+
 int FindNearest(int *points, REAL *x, REAL *y, int N, int np, REAL xi, REAL yi)
 {
   int i, n;
@@ -202,6 +238,33 @@ void TriSolve(REAL *a, REAL *b, REAL *c, REAL *d, REAL *u, int N)
     u[k] = d[k]/b[k]-c[k]*u[k+1]/b[k];
 }
 
+/*
+ * Function: TriSolveBatch
+ * Usage: TriSolveBatch(a,b,c,d,u,N,M);
+ * ------------------------------------
+ * Solve M tridiagonal systems of size N together with the same algorithm as
+ * TriSolve.  Element k of system m is stored at k*M+m, so that the inner loops
+ * run over the systems.
+ *
+ */
+void TriSolveBatch(REAL *a, REAL *b, REAL *c, REAL *d, REAL *u, int N, int M)
+{
+  int k, m;
+
+  for(k=1;k<N;k++)
+    for(m=0;m<M;m++) {
+      b[k*M+m]-=a[k*M+m]*c[(k-1)*M+m]/b[(k-1)*M+m];
+      d[k*M+m]-=a[k*M+m]*d[(k-1)*M+m]/b[(k-1)*M+m];
+    }
+
+  for(m=0;m<M;m++)
+    u[(N-1)*M+m]=d[(N-1)*M+m]/b[(N-1)*M+m];
+
+  for(k=N-2;k>=0;k--)
+    for(m=0;m<M;m++)
+      u[k*M+m] = d[k*M+m]/b[k*M+m]-c[k*M+m]*u[(k+1)*M+m]/b[k*M+m];
+}
+
 int IsNan(REAL x) 
 {
   if(x!=x)
@@ -334,8 +397,8 @@ int max(int a, int b) {
 * 1-D quadratic interpolation function between 3 points (x0,x1,x2) with values (y0,y1,y2);
 */ 
 
-REAL QuadInterp(REAL x, REAL x0, REAL x1, REAL x2, REAL y0, REAL y1, REAL y2){
-    REAL L0, L1, L2;
+REAL QuadInterp(DREAL x, DREAL x0, DREAL x1, DREAL x2, REAL y0, REAL y1, REAL y2){
+    DREAL L0, L1, L2;
 
 //    printf("x: %f, x0: %f, x1: %f, x2: %f, y0: %f, y1: %f, y2: %f\n",x,x0,x1,x2,y0,y1,y2);
 
@@ -391,8 +454,20 @@ REAL getToffSet(char basetime[15], char starttime[15]){
 */
 void linsolve(REAL **A, REAL *b, int N){
 
+  ludecomp(A,N);
+  lusolve(A,b,N);
+} // End of linsolve
+
+/*
+* Function: ludecomp()
+* --------------------
+* LU decomposition of the square matrix A without pivoting, overwriting A
+* with L (below the diagonal, unit diagonal) and U, so that systems with the
+* same A can be solved with lusolve.
+*/
+void ludecomp(REAL **A, int N){
+
   int i,j,k;
-  REAL sumi;
   
   // Algorithm to find LU decomp - See page 99
   for(k=0;k<N-1;k++){
@@ -403,6 +478,18 @@ void linsolve(REAL **A, REAL *b, int N){
       }
     }
   }
+} // End of ludecomp
+
+/*
+* Function: lusolve()
+* -------------------
+* Solves A.x=b with the LU decomposition of A from ludecomp.
+* The solution x is returned in vector b
+*/
+void lusolve(REAL **A, REAL *b, int N){
+
+  int i,j;
+  REAL sumi;
 
   // Solve L.y=b via forward substitution (Alg 3.1.1);
   b[0] = b[0];
@@ -424,7 +511,7 @@ void linsolve(REAL **A, REAL *b, int N){
     }
     b[i] = (b[i] - sumi)/A[i][i];
   }  
-} // End of linsolve
+} // End of lusolve
 
 
 
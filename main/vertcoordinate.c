@@ -21,6 +21,7 @@
 #include "uservertcoordinate.h"
 #include "physio.h"
 #include "subgrid.h"
+#include "timestep.h"
 
 /*
  * Function: AllocateVertCoordinate
@@ -80,6 +81,8 @@ void AllocateandInitializeVertCoordinate(gridT *grid, propT *prop, int myproc)
   // normal vector
   vert->n1=(REAL *)SunMalloc(grid->Nc*grid->maxfaces*sizeof(REAL),"AllocateVertCoordinate");
   vert->n2=(REAL *)SunMalloc(grid->Nc*grid->maxfaces*sizeof(REAL),"AllocateVertCoordinate");
+  vert->gradx=(REAL *)SunMalloc(grid->Nc*grid->maxfaces*sizeof(REAL),"AllocateVertCoordinate");
+  vert->grady=(REAL *)SunMalloc(grid->Nc*grid->maxfaces*sizeof(REAL),"AllocateVertCoordinate");
   // velocity field at the top and bottom face of each layer
   vert->ul=(REAL **)SunMalloc(grid->Nc*sizeof(REAL *),"AllocateVertCoordinate");
   vert->vl=(REAL **)SunMalloc(grid->Nc*sizeof(REAL *),"AllocateVertCoordinate");
@@ -144,6 +147,8 @@ void AllocateandInitializeVertCoordinate(gridT *grid, propT *prop, int myproc)
     {
       vert->n1[i*grid->maxfaces+k]=0;
       vert->n2[i*grid->maxfaces+k]=0;
+      vert->gradx[i*grid->maxfaces+k]=0;
+      vert->grady[i*grid->maxfaces+k]=0;
     }
 
     for(k=0;k<grid->Nk[i]+1;k++)
@@ -574,6 +579,8 @@ void ComputeUf(gridT *grid, propT *prop, physT *phys, int myproc)
 
   // uf vf and wf
   for(j=0;j<grid->Ne;j++){
+    nc1 = grid->grad[2*j];
+    nc2 = grid->grad[2*j+1];
     Dj = grid->dg[j];
     if(nc1==-1){
       nc1=nc2;
@@ -845,37 +852,30 @@ void ComputeOmega(gridT *grid, propT *prop, physT *phys, int index, int myproc)
 void VertCoordinateHorizontalSource(gridT *grid, physT *phys, propT *prop,
     int myproc, int numprocs, MPI_Comm comm)
 {
-   int i,k;
+   int i,k,Nfields;
+   REAL **fields[4], **dfdx[4], **dfdy[4];
    // compute the relative vorticity
    // 1. compute v and u at each edge center
    ComputeUf(grid, prop, phys,myproc);
 
-   // comment out due to use conservative method
-   // 2. compute dvdx and dudy
+   // 2. compute the gradients of u, v and w, and of q to prepare for the
+   // nonhydrostatic calculation, in one pass over the faces of each cell
+   Nfields=0;
    if(prop->nonlinear)
    {
-     ComputeCellAveragedHorizontalGradient(vert->dvdx, 0, vert->vf, grid, prop, phys, myproc);
-     ComputeCellAveragedHorizontalGradient(vert->dudy, 1, vert->uf, grid, prop, phys, myproc);
-     ComputeCellAveragedHorizontalGradient(vert->dvdy, 1, vert->vf, grid, prop, phys, myproc);
-     ComputeCellAveragedHorizontalGradient(vert->dudx, 0, vert->uf, grid, prop, phys, myproc);
-     if(prop->nonhydrostatic)
-     {
-       ComputeCellAveragedHorizontalGradient(vert->dwdy, 1, vert->wf, grid, prop, phys, myproc);
-       ComputeCellAveragedHorizontalGradient(vert->dwdx, 0, vert->wf, grid, prop, phys, myproc);
+     fields[Nfields]=vert->uf; dfdx[Nfields]=vert->dudx; dfdy[Nfields++]=vert->dudy;
+     fields[Nfields]=vert->vf; dfdx[Nfields]=vert->dvdx; dfdy[Nfields++]=vert->dvdy;
+     if(prop->nonhydrostatic) {
+       fields[Nfields]=vert->wf; dfdx[Nfields]=vert->dwdx; dfdy[Nfields++]=vert->dwdy;
      }
    }
+   if(prop->nonhydrostatic) {
+     fields[Nfields]=vert->qcf; dfdx[Nfields]=vert->dqdx; dfdy[Nfields++]=vert->dqdy;
+   }
+   ComputeCellAveragedHorizontalGradients(dfdx,dfdy,fields,Nfields,grid);
+
    // 3. compute f_r
    ComputeRelativeVorticity(grid,phys,prop,myproc);
-  
-   // 4. prepare for nonhydrostatic calculation
-   if(prop->nonhydrostatic){
-     ComputeCellAveragedHorizontalGradient(vert->dqdy, 1, vert->qcf, grid, prop, phys, myproc);
-     ComputeCellAveragedHorizontalGradient(vert->dqdx, 0, vert->qcf, grid, prop, phys, myproc);     
-     //ComputeCellAveragedHorizontalGradient(vert->dwdy, 1, vert->wf, grid, prop, phys, myproc);
-     //ComputeCellAveragedHorizontalGradient(vert->dwdx, 0, vert->wf, grid, prop, phys, myproc);
-     //ComputeCellAveragedHorizontalGradient(vert->dvdy, 1, vert->vf, grid, prop, phys, myproc);
-     //ComputeCellAveragedHorizontalGradient(vert->dudx, 0, vert->uf, grid, prop, phys, myproc);
-   }
 }
 
 /*
@@ -883,27 +883,61 @@ void VertCoordinateHorizontalSource(gridT *grid, physT *phys, propT *prop,
  * Compute the cell averaged gradient for scalars
  * ----------------------------------------------------
  * direction=0 x gradient, direction=1 y gradient
+ * use ComputeCellAveragedHorizontalGradients for several fields/directions
  */
 void ComputeCellAveragedHorizontalGradient(REAL **gradient, int direction, REAL **scalar, gridT *grid, propT *prop, 
 	physT *phys, int myproc)
 {
-  int i,k,nf,ne;
-  REAL vec;
+  REAL **fields[1]={scalar}, **grad[1]={gradient}, **none[1]={NULL};
+
+  if(direction==0)
+    ComputeCellAveragedHorizontalGradients(grad,none,fields,1,grid);
+  else
+    ComputeCellAveragedHorizontalGradients(none,grad,fields,1,grid);
+}
+
+/*
+ * Function: ComputeCellAveragedHorizontalGradients
+ * Usage: ComputeCellAveragedHorizontalGradients(dfdx,dfdy,fields,Nfields,grid);
+ * ----------------------------------------------------------------------------
+ * Computes the cell-averaged x and y gradients dfdx[m] and dfdy[m] of the
+ * edge fields fields[m], m=0..Nfields-1, in a single pass over the faces of
+ * each cell with the face weights vert->gradx and vert->grady.  Either
+ * gradient of a field is skipped if its array is NULL.
+ *
+ */
+void ComputeCellAveragedHorizontalGradients(REAL ***dfdx, REAL ***dfdy, REAL ***fields, int Nfields, gridT *grid)
+{
+  int i,k,m,nf,ne,ktop,Nk;
+  REAL wx,wy,*f,*gx,*gy;
 
   for(i=0;i<grid->Nc;i++)
   {
-    for(k=grid->ctop[i];k<grid->Nk[i];k++)
-    {
-      gradient[i][k]=0;
-      for(nf=0;nf<grid->nfaces[i];nf++) {
-        ne = grid->face[i*grid->maxfaces+nf];
-        if(direction==0)
-          vec=vert->n1[i*grid->maxfaces+nf];
-        else
-          vec=vert->n2[i*grid->maxfaces+nf];
-        gradient[i][k]+=scalar[ne][k]*grid->df[ne]*vec;
+    ktop=grid->ctop[i];
+    Nk=grid->Nk[i];
+    for(m=0;m<Nfields;m++)
+      for(k=ktop;k<Nk;k++) {
+        if(dfdx[m]) dfdx[m][i][k]=0;
+        if(dfdy[m]) dfdy[m][i][k]=0;
+      }
+
+    for(nf=0;nf<grid->nfaces[i];nf++) {
+      ne=grid->face[i*grid->maxfaces+nf];
+      wx=vert->gradx[i*grid->maxfaces+nf];
+      wy=vert->grady[i*grid->maxfaces+nf];
+      for(m=0;m<Nfields;m++) {
+        f=fields[m][ne];
+        if(dfdx[m]) {
+          gx=dfdx[m][i];
+          for(k=ktop;k<Nk;k++)
+            gx[k]+=f[k]*wx;
+        }
+        if(dfdy[m]) {
+          gy=dfdy[m][i];
+          for(k=ktop;k<Nk;k++)
+            gy[k]+=f[k]*wy;
+        }
       }
-      gradient[i][k]/=grid->Ac[i];
     }
   }
 }
@@ -965,6 +999,8 @@ void ComputeNormalVector(gridT *grid, physT *phys, int myproc)
       Dy=y-grid->yv[i];
       vert->n1[i*grid->maxfaces+nf]=Dx/D;
       vert->n2[i*grid->maxfaces+nf]=Dy/D;
+      vert->gradx[i*grid->maxfaces+nf]=vert->n1[i*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[i];
+      vert->grady[i*grid->maxfaces+nf]=vert->n2[i*grid->maxfaces+nf]*grid->df[ne]/grid->Ac[i];
     }
 }
 
@@ -1014,7 +1050,7 @@ void OutputVertCoordinate(gridT *grid, propT *prop, int myproc, int numprocs, MP
   int i, j, jptr, k, nwritten, arraySize, writeProc,nc1,nc2;
   char str[BUFFERLENGTH], filename[BUFFERLENGTH];
 
-  if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart) { 
+  if(IntervalDue(prop,prop->ntout) || prop->n==1+prop->nstart) { 
     Write3DData(vert->zc,vert->tmp,prop->mergeArrays,vert->zcFID,
     "Error outputting uc-data!\n",grid,numprocs,myproc,comm);
     Write3DData(grid->dzz,vert->tmp,prop->mergeArrays,vert->dzzFID,
@@ -1057,8 +1093,7 @@ void VertCoordinateBasic(gridT *grid, propT *prop, physT *phys, int myproc)
   // compute normal vector
   ComputeNormalVector(grid,phys,myproc);
 
-  ComputeCellAveragedHorizontalGradient(vert->dzdx, 0, vert->zf, grid, prop, phys, myproc);
-  ComputeCellAveragedHorizontalGradient(vert->dzdy, 1, vert->zf, grid, prop, phys, myproc);
+  ComputeCellAveragedHorizontalGradients(&vert->dzdx, &vert->dzdy, &vert->zf, 1, grid);
 
   // compute nodal information
   // prepare for the calculation of nodal relative vorticity
@@ -1074,7 +1109,6 @@ void VertCoordinateBasic(gridT *grid, propT *prop, physT *phys, int myproc)
  */
 void VertCoordinateBasicRestart(gridT *grid, propT *prop, physT *phys, int myproc)
 {
-  int i,k,j;
   // allocate subgrid struture first
   vert=(vertT *)SunMalloc(sizeof(vertT),"VertCoordinateBasic");
 
@@ -1084,6 +1118,43 @@ void VertCoordinateBasicRestart(gridT *grid, propT *prop, physT *phys, int mypro
   // output 
   OpenVertCoordinateFiles(grid,prop->mergeArrays,myproc);
 
+  VertCoordinateGeometry(grid,prop,phys,myproc);
+}
+
+/*
+ * Function: VertCoordinateRepartition
+ * Usage: VertCoordinateRepartition(grid,prop,phys,oldvert,myproc);
+ * ----------------------------------------------------------------
+ * Create the vertical coordinate for the repartitioned grid from its layer
+ * thicknesses and free surface as in a restart.  The output files of the old 
+ * vertical coordinate oldvert are kept open.  The state of oldvert must be
+ * transferred by the caller (see MigrateVertCoordinate in rebalance.c), which
+ * then frees it with FreeVertCoordinate.
+ *
+ */
+void VertCoordinateRepartition(gridT *grid, propT *prop, physT *phys, vertT *oldvert, int myproc)
+{
+  vert=(vertT *)SunMalloc(sizeof(vertT),"VertCoordinateRepartition");
+
+  AllocateandInitializeVertCoordinate(grid,prop,myproc);
+
+  vert->zcFID=oldvert->zcFID;
+  vert->dzzFID=oldvert->dzzFID;
+  vert->omegaFID=oldvert->omegaFID;
+
+  VertCoordinateGeometry(grid,prop,phys,myproc);
+}
+
+/*
+ * Function: VertCoordinateGeometry
+ * Usage: VertCoordinateGeometry(grid,prop,phys,myproc);
+ * -----------------------------------------------------
+ * Compute the layer locations, normal vectors and nodal data of the vertical
+ * coordinate from the current layer thicknesses.
+ *
+ */
+void VertCoordinateGeometry(gridT *grid, propT *prop, physT *phys, int myproc)
+{
   // compute zc
   ComputeZc(grid,prop,phys,0,myproc);
 
@@ -1094,14 +1165,73 @@ void VertCoordinateBasicRestart(gridT *grid, propT *prop, physT *phys, int mypro
   // compute normal vector
   ComputeNormalVector(grid,phys,myproc);
 
-  ComputeCellAveragedHorizontalGradient(vert->dzdx, 0, vert->zf, grid, prop, phys, myproc);
-  ComputeCellAveragedHorizontalGradient(vert->dzdy, 1, vert->zf, grid, prop, phys, myproc);
+  ComputeCellAveragedHorizontalGradients(&vert->dzdx, &vert->dzdy, &vert->zf, 1, grid);
 
   // compute nodal information
   // prepare for the calculation of nodal relative vorticity
   ComputeNodalData(grid,myproc);
 }
 
+/*
+ * Function: FreeVertCoordinate
+ * Usage: FreeVertCoordinate(oldvert,grid,prop);
+ * ---------------------------------------------
+ * Free the arrays of the vertical coordinate v that was allocated on grid by
+ * AllocateandInitializeVertCoordinate.  The output files are not closed.
+ *
+ */
+void FreeVertCoordinate(vertT *v, gridT *grid, propT *prop)
+{
+  int i, j;
+  REAL **edgearrays[] = {v->uf,v->vf,v->wf,v->qcf,v->omegaf,v->zf,v->f_re};
+  REAL **layertops[] = {v->ul,v->vl,v->omega,v->omega_im,v->omega_old,v->omega_old2,
+			v->U3,v->U3_old,v->U3_old2,v->zl};
+  REAL **layers[] = {v->omegac,v->zc,v->zcold,v->f_r,v->dvdx,v->dudy,v->dudx,v->dvdy,
+		     v->dwdx,v->dwdy,v->dzdy,v->dzdx,v->dqdy,v->dqdx,v->Mc,v->dzztmp};
+  int Nedge=sizeof(edgearrays)/sizeof(REAL **), Ntop=sizeof(layertops)/sizeof(REAL **),
+    Nlayer=sizeof(layers)/sizeof(REAL **);
+
+  for(j=0;j<grid->Ne;j++) {
+    for(i=0;i<Nedge;i++)
+      SunFree(edgearrays[i][j],grid->Nkc[j]*sizeof(REAL),"FreeVertCoordinate");
+    SunFree(v->Me_l[j],(grid->Nkc[j]+1)*sizeof(REAL),"FreeVertCoordinate");
+  }
+  for(i=0;i<Nedge;i++)
+    SunFree(edgearrays[i],grid->Ne*sizeof(REAL *),"FreeVertCoordinate");
+  SunFree(v->Me_l,grid->Ne*sizeof(REAL *),"FreeVertCoordinate");
+  SunFree(v->Nkeb,grid->Ne*sizeof(int),"FreeVertCoordinate");
+  SunFree(v->zfb,grid->Ne*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->CCNpe,2*grid->Ne*sizeof(REAL),"FreeVertCoordinate");
+
+  for(j=0;j<grid->Nc;j++) {
+    for(i=0;i<Ntop;i++)
+      SunFree(layertops[i][j],(grid->Nk[j]+1)*sizeof(REAL),"FreeVertCoordinate");
+    for(i=0;i<Nlayer;i++)
+      SunFree(layers[i][j],grid->Nk[j]*sizeof(REAL),"FreeVertCoordinate");
+  }
+  for(i=0;i<Ntop;i++)
+    SunFree(layertops[i],grid->Nc*sizeof(REAL *),"FreeVertCoordinate");
+  for(i=0;i<Nlayer;i++)
+    SunFree(layers[i],grid->Nc*sizeof(REAL *),"FreeVertCoordinate");
+  SunFree(v->Msum,grid->Nc*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->n1,grid->Nc*grid->maxfaces*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->n2,grid->Nc*grid->maxfaces*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->gradx,grid->Nc*grid->maxfaces*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->grady,grid->Nc*grid->maxfaces*sizeof(REAL),"FreeVertCoordinate");
+
+  for(j=0;j<grid->Np;j++)
+    SunFree(v->f_rp[j],grid->Nkp[j]*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->f_rp,grid->Np*sizeof(REAL *),"FreeVertCoordinate");
+  SunFree(v->Ap,grid->Np*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->Nkpmin,grid->Np*sizeof(int),"FreeVertCoordinate");
+  SunFree(v->typep,grid->Np*sizeof(int),"FreeVertCoordinate");
+
+  SunFree(v->tmp,10*grid->Nc*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v->tmp_nc,(grid->Nkmax+1)*sizeof(REAL),"FreeVertCoordinate");
+  if(prop->vertcoord==3)
+    SunFree(v->dsigma,grid->Nkmax*sizeof(REAL),"FreeVertCoordinate");
+  SunFree(v,sizeof(vertT),"FreeVertCoordinate");
+}
 
 /*
  * Function: ComputeDSigma
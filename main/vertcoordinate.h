@@ -33,6 +33,7 @@ REAL **omegac; // the cell-centered vertical contravariant flux [Nc][Nk]
 REAL **U3,**U3_old,**U3_old2; // w-udzdx-vdzdy [Nc][Nk+1] 
 REAL *n1;  // the x component of the outpointing vector from cell center to its face center [Nc*maxfaces*Nc]
 REAL *n2; // the y component of the outpointing vector from cell center to its face center [Nc*maxfaces*Nc]
+REAL *gradx,*grady; // n1*df/Ac and n2*df/Ac, the face weights of the cell-averaged gradients [Nc*maxfaces]
 REAL **zc,**zcold; // the cell center vertical location in the Cartesian coordinate [Nc][Nk]
 REAL **zl; // the cell center vertical location of cell top face in the cartesian coordinate [Nc][Nk+1]
 REAL **f_r; // the cell center relative vorticity dvdx-dudy [Nc][Nk]
@@ -69,11 +70,15 @@ void ComputeZc(gridT *grid, propT *prop, physT *phys, int index, int myproc);
 void ComputeDSigma(gridT *grid, physT *phys, int myproc);
 void VertCoordinateHorizontalSource(gridT *grid, physT *phys, propT *prop, int myproc, int numprocs, MPI_Comm comm);
 void ComputeCellAveragedHorizontalGradient(REAL **gradient, int direction, REAL **scalar, gridT *grid, propT *prop, physT *phys, int myproc);
+void ComputeCellAveragedHorizontalGradients(REAL ***dfdx, REAL ***dfdy, REAL ***fields, int Nfields, gridT *grid);
 void VariationalVertCoordinate(gridT *grid, propT *prop, physT *phys, int myproc,int numprocs, MPI_Comm comm);
 void VariationalVertCoordinateAverageMethod(gridT *grid, propT *prop, physT *phys, int myproc);
 REAL InterpToLayerTopFace(int i, int k, REAL **phi, gridT *grid);
 void VertCoordinateBasic(gridT *grid, propT *prop, physT *phys, int myproc);
 void VertCoordinateBasicRestart(gridT *grid, propT *prop, physT *phys, int myproc);
+void VertCoordinateRepartition(gridT *grid, propT *prop, physT *phys, vertT *oldvert, int myproc);
+void VertCoordinateGeometry(gridT *grid, propT *prop, physT *phys, int myproc);
+void FreeVertCoordinate(vertT *v, gridT *grid, propT *prop);
 void ComputeNormalVector(gridT *grid, physT *phys, int myproc);
 void OpenVertCoordinateFiles(gridT *grid,int mergeArrays, int myproc);
 void OutputVertCoordinate(gridT *grid, propT *prop, int myproc, int numprocs, MPI_Comm comm);
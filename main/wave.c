@@ -24,8 +24,9 @@
 #include "timer.h"
 #include "boundaries.h"
 #include "initialization.h"
+#include "timestep.h"
 
-static REAL InnerProduct2(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm);
+static DREAL InnerProduct2(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm);
 static REAL InterpCgToFace(int m, int n, int j, gridT *grid);
 static REAL semivariogram(REAL Cov0, REAL Dmax, REAL D);
 static void OperatorN(int m, int n, REAL *x, REAL *y, gridT *grid, propT *prop);
@@ -2306,9 +2307,9 @@ static void OperatorN(int m, int n, REAL *x, REAL *y, gridT *grid, propT *prop){
 
 }
 
-static REAL InnerProduct2(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm){
+static DREAL InnerProduct2(REAL *x, REAL *y, gridT *grid, int myproc, int numprocs, MPI_Comm comm){
   int i, iptr;
-  REAL sum, mysum = 0;
+  DREAL sum, mysum = 0;
 
   for(iptr=grid->celldist[0]; iptr<grid->celldist[1]; iptr++){
     i = grid->cellp[iptr];
@@ -2800,7 +2801,7 @@ static void OutputWaveData(gridT *grid, propT *prop,
   REAL *tmp = (REAL *)SunMalloc(grid->Ne*sizeof(REAL),"OutputWaveData");
 
   // change prop->n==prop->nstart+1 to prop->nstart to output initial condition 
-  if(!(prop->n%prop->ntout) || prop->n==prop->nstart || blowup|| prop->n==prop->nsteps+prop->nstart) {
+  if(IntervalDue(prop,prop->ntout) || prop->n==prop->nstart || blowup|| prop->n==prop->nsteps+prop->nstart) {
 
     Write2DData(wave->Hs,prop->mergeArrays,wprop->WaveHeightFID,"Error outputting wave height data!\n", grid,numprocs,myproc,comm);
   
@@ -3159,7 +3160,7 @@ void FetchOutputWave(gridT *grid, physT *phys, propT *prop, int myproc, int nump
   FILE *ofile;
   
   if(wprop->ConstantWind==0){
-    if(!(prop->n%prop->ntout) || prop->n==1+prop->nstart || blowup) { 
+    if(IntervalDue(prop,prop->ntout) || prop->n==1+prop->nstart || blowup) { 
        Write2DData(wave->Fetch,prop->mergeArrays,wprop->FetchFID,"Error outputting fetch data!\n", grid,numprocs,myproc,comm);
        Write2DData(wave->Hwsig,prop->mergeArrays,wprop->HwsigFID,"Error outputting significant wave height data!\n", grid,numprocs,myproc,comm);
        Write2DData(wave->Twsig,prop->mergeArrays,wprop->TwsigFID,"Error outputting significant wave period data!\n", grid,numprocs,myproc,comm);